@@ -593,6 +593,8 @@ struct AsmWaitConfig
 
 enum : cxbyte
 {
+    /// synchronizing instruction (barrier): memory ops must be finished before it
+    ASMDELOP_SYNC = 254,
     ASMDELOP_NONE = 255
 };
 
@@ -617,6 +619,37 @@ struct AsmWaitInstr
     uint16_t waits[ASM_WAIT_MAX_TYPES_NUM];
 };
 
+/// instruction scheduling flags
+enum : cxbyte
+{
+    ASMSCHED_BARRIER = 1,   ///< instruction is not moved and nothing is moved across it
+    ASMSCHED_MEMORY = 2,    ///< memory instruction (order of memory instructions is kept)
+    ASMSCHED_VALU = 4,      ///< vector ALU instruction (producer of hazards)
+    ASMSCHED_SALU = 8       ///< scalar ALU instruction (producer of hazards)
+};
+
+/// hazard: read of registers written by producer that needs wait states
+struct AsmInstrHazard
+{
+    cxbyte producer;    ///< class of producer (ASMSCHED_VALU or ASMSCHED_SALU)
+    cxbyte regType;     ///< type of register variables or 255 (only real registers)
+    uint16_t rstart;    ///< first real register
+    uint16_t rend;      ///< last real register plus one
+    cxuint waitStates;  ///< number of wait states between producer and instruction
+};
+
+/// information about instruction for instruction scheduler
+struct AsmInstrSchedInfo
+{
+    cxbyte flags;       ///< scheduling flags (ASMSCHED_*)
+    cxuint latency;     ///< latency of results (in cycles)
+    cxuint implRegsNum; ///< number of implicit register usages
+    /// implicit register usages (offset and regVar are not used)
+    AsmRegVarUsage implRegs[3];
+    cxuint hazardsNum;  ///< number of hazards
+    AsmInstrHazard hazards[2];  ///< hazards of instruction (as consumer)
+};
+
 /// code flow type
 enum AsmCodeFlowType
 {
@@ -688,6 +721,17 @@ class ISAUsageHandler;
 class ISALinearDepHandler;
 class ISAWaitHandler;
 
+/// alignment of code (padding made by alignment pseudo-op inside code section)
+struct AsmCodeAlignment
+{
+    size_t offset;  ///< offset of padding
+    size_t size;    ///< size of padding
+    uint64_t alignment; ///< alignment
+    uint64_t maxAlign;  ///< max alignment (max padding size, 0 - no limit)
+    bool haveFill;  ///< true if padding filled by value (instead no-op instructions)
+    cxbyte fillValue;   ///< fill value
+};
+
 /// assembler section
 struct AsmSection
 {
@@ -706,6 +750,11 @@ struct AsmSection
     std::unique_ptr<ISAWaitHandler> waitHandler; ///< wait handler
     std::vector<AsmCodeFlowEntry> codeFlow;  ///< code flow info
     AsmSourcePosHandler sourcePosHandler;
+    /// true if differences of labels of section are evaluated (code can not be inserted)
+    bool labelDiffs;
+    AsmSourcePos labelDiffPos;  ///< position of first evaluated difference of labels
+    /// alignments of code (padding will be changed after inserting code)
+    std::vector<AsmCodeAlignment> codeAlignments;
     
     /// constructor
     AsmSection();
@@ -715,7 +764,7 @@ struct AsmSection
                uint64_t _relAddress = UINT64_MAX)
             : name(_name), kernelId(_kernelId), type(_type), flags(_flags),
               alignment(_alignment), size(_size), relSpace(_relSpace),
-              relAddress(_relAddress)
+              relAddress(_relAddress), labelDiffs(false)
     { }
     
     /// copy constructor
@@ -143,6 +143,14 @@ public:
         { }
     };
     
+    /// occupancy parameters of kernels (from kernel config)
+    struct OccupancyConfig
+    {
+        size_t localSize;   ///< LDS size per work-group
+        cxuint workGroupSize;   ///< work-items in work-group (0 - maximal)
+        cxuint extraSGPRsNum;   ///< extra SGPRs (VCC, FLAT_SCRATCH, XNACK)
+    };
+    
     struct KernelBase
     {
         cxuint allocRegs[MAX_REGTYPES_NUM];
@@ -159,6 +167,15 @@ protected:
     // resolve LO32BIT/HI32BIT relocations (partially, helper)
     bool resolveLoHiRelocExpression(const AsmExpression* expr, RelocType& relType,
                     AsmSectionId& relSectionId, uint64_t& relValue);
+    // join registers with current allocated registers in ISA assembler
+    void joinCurrentAllocRegs(const cxuint* allocRegs);
+    // join registers with allocated registers in kernel
+    static void joinKernelAllocRegs(KernelBase& kernel, const cxuint* allocRegs);
+    // get occupancy config for kernel (extra SGPRs from register flags)
+    OccupancyConfig getOccupancyConfig(size_t localSize,
+                const uint32_t* reqdWorkGroupSize, Flags regFlags) const;
+    // join occupancy config of kernel sharing code section
+    static void joinOccupancyConfig(OccupancyConfig& dest, const OccupancyConfig& src);
 public:
     virtual ~AsmFormatHandler();
     
@@ -215,6 +232,14 @@ public:
     /// prepare before section diference resolving
     virtual bool prepareSectionDiffsResolving();
     virtual void setCodeFlags(Flags codeFlags);
+    /// update allocated registers of kernels whose code is in section
+    /** used after register allocation for register variables */
+    virtual void updateAllocatedRegisters(AsmSectionId sectionId,
+                const cxuint* allocRegs);
+    /// get occupancy parameters of kernels whose code is in section
+    /** used by register pressure report. If many kernels share section, then
+     * maximal LDS size and extra SGPRs and minimal work-group size are returned */
+    virtual OccupancyConfig getSectionOccupancyConfig(AsmSectionId sectionId) const;
 };
 
 /// format handler with Kcode (kernel-code) handling
@@ -236,6 +261,7 @@ protected:
     void prepareKcodeState();
 public:
     void handleLabel(const CString& label);
+    void updateAllocatedRegisters(AsmSectionId sectionId, const cxuint* allocRegs);
     
     /// return true if current section is code section
     virtual bool isCodeSection() const = 0;
@@ -343,6 +369,8 @@ public:
     bool prepareBinary();
     void writeBinary(std::ostream& os) const;
     void writeBinary(Array<cxbyte>& array) const;
+    void updateAllocatedRegisters(AsmSectionId sectionId, const cxuint* allocRegs);
+    OccupancyConfig getSectionOccupancyConfig(AsmSectionId sectionId) const;
     /// get output structure pointer
     const AmdInput* getOutput() const
     { return &output; }
@@ -438,6 +466,7 @@ private:
     void restoreCurrentAllocRegs();
     void saveCurrentAllocRegs();
     cxuint getDriverVersion() const;
+    OccupancyConfig getKernelOccupancyConfig(AsmKernelId kernelId) const;
 public:
     /// constructor
     explicit AsmAmdCL2Handler(Assembler& assembler);
@@ -461,6 +490,8 @@ public:
     bool prepareBinary();
     void writeBinary(std::ostream& os) const;
     void writeBinary(Array<cxbyte>& array) const;
+    void updateAllocatedRegisters(AsmSectionId sectionId, const cxuint* allocRegs);
+    OccupancyConfig getSectionOccupancyConfig(AsmSectionId sectionId) const;
     /// get output structure pointer
     const AmdCL2Input* getOutput() const
     { return &output; }
@@ -547,6 +578,7 @@ public:
     bool prepareBinary();
     void writeBinary(std::ostream& os) const;
     void writeBinary(Array<cxbyte>& array) const;
+    OccupancyConfig getSectionOccupancyConfig(AsmSectionId sectionId) const;
     /// get output object (input for bingenerator)
     const GalliumInput* getOutput() const
     { return &output; }
@@ -627,6 +659,7 @@ public:
     bool prepareBinary();
     void writeBinary(std::ostream& os) const;
     void writeBinary(Array<cxbyte>& array) const;
+    OccupancyConfig getSectionOccupancyConfig(AsmSectionId sectionId) const;
     /// get output object (input for bingenerator)
     const ROCmInput* getOutput() const
     { return &output; }
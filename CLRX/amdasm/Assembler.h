@@ -63,10 +63,20 @@ enum: Flags
     ASM_MACRONOCASE = 16, /// disable case-insensitive naming (default)
     ASM_OLDMODPARAM = 32,   ///< use old modifier parametrization (values 0 and 1 only)
     ASM_WAVE32 = 64, ///< use WAVESIZE32
+    ASM_REGALLOC = 128, ///< allocate registers for register variables
+    ASM_AUTOWAIT = 256, ///< insert waits for results of delayed operations
+    ASM_CHECKWAITS = 512, ///< warn about wait instructions that wait for more than needed
+    ASM_RELAXWAITS = 1024, ///< relax wait instructions that wait for more than needed
+    ASM_SCHEDULE = 2048, ///< schedule instructions in basic blocks to hide latencies
+    ASM_SHRINK = 4096, ///< choose shortest encoding of instructions
+    ASM_MERGESTRINGS = 8192, ///< merge strings in string tables of binaries
+    ASM_REGPRESSURE = 16384, ///< collect register usages for register pressure report
     ASM_TESTRESOLVE = (1U<<30), ///< enable resolving symbols if ASM_TESTRUN enabled
     ASM_TESTRUN = (1U<<31), ///< only for running tests
     ASM_ALL = FLAGS_ALL&~(ASM_TESTRUN|ASM_TESTRESOLVE|ASM_BUGGYFPLIT|ASM_MACRONOCASE|
-                    ASM_WAVE32|ASM_OLDMODPARAM)  ///< all flags
+                    ASM_WAVE32|ASM_OLDMODPARAM|ASM_REGALLOC|ASM_AUTOWAIT|
+                    ASM_CHECKWAITS|ASM_RELAXWAITS|ASM_SCHEDULE|ASM_SHRINK|
+                    ASM_MERGESTRINGS|ASM_REGPRESSURE)  ///< all flags
 };
 
 enum: Flags
@@ -274,6 +284,32 @@ public:
     /// get size of instruction
     virtual size_t getInstructionSize(size_t codeSize, const cxbyte* code) const = 0;
     virtual const AsmWaitConfig& getWaitConfig() const = 0;
+    /// set register (allocated for register variable) in instruction field
+    /** \param rvu register variable usage (field and offset of instruction)
+     * \param rreg first real register of allocated range (from register ranges)
+     * \param codeSize size of code in section
+     * \param code section code
+     * \return true if field is supported */
+    virtual bool setRegVarRegister(const AsmRegVarUsage& rvu, cxuint rreg,
+                size_t codeSize, cxbyte* code) const = 0;
+    /// return true if instruction is move between two single registers
+    virtual bool isRegisterMove(size_t codeSize, const cxbyte* code) const = 0;
+    /// set target of relative jump instruction
+    /**
+     * \param offset offset of jump instruction
+     * \param target new target of jump
+     * \param codeSize size of code in section
+     * \param code section code
+     * \return true if instruction is relative jump and target fits to instruction */
+    virtual bool setJumpTarget(size_t offset, size_t target,
+                size_t codeSize, cxbyte* code) const = 0;
+    /// get information about instruction for instruction scheduler
+    /**
+     * \param codeSize size of code after instruction start
+     * \param code instruction code
+     * \return scheduling information */
+    virtual AsmInstrSchedInfo getInstrSchedInfo(size_t codeSize,
+                const cxbyte* code) const = 0;
 };
 
 /// GCN arch assembler
@@ -365,6 +401,46 @@ public:
     bool parseRegisterType(const char*& linePtr, const char* end, cxuint& type);
     size_t getInstructionSize(size_t codeSize, const cxbyte* code) const;
     const AsmWaitConfig& getWaitConfig() const;
+    bool setRegVarRegister(const AsmRegVarUsage& rvu, cxuint rreg,
+                size_t codeSize, cxbyte* code) const;
+    bool isRegisterMove(size_t codeSize, const cxbyte* code) const;
+    bool setJumpTarget(size_t offset, size_t target,
+                size_t codeSize, cxbyte* code) const;
+    AsmInstrSchedInfo getInstrSchedInfo(size_t codeSize, const cxbyte* code) const;
+};
+
+/// map of code offsets after inserting code
+/** code can be inserted before instruction (after labels that points to instruction)
+ * or after instruction (before labels that points to next instruction).
+ * Labels that points to removed instruction points to next instruction */
+class AsmCodeOffsetMap
+{
+private:
+    // old offset and sum of sizes of insertions up to this offset
+    std::vector<std::pair<size_t, size_t> > insertsBefore;
+    std::vector<std::pair<size_t, size_t> > insertsAfter;
+public:
+    /// add insertion before instruction at offset (offsets must be ordered)
+    void insertBefore(size_t offset, size_t size);
+    /// add insertion after instruction that ends at offset (offsets must be ordered)
+    void insertAfter(size_t offset, size_t size);
+    /// add removal of instruction at offset (offsets must be ordered)
+    void removeInstr(size_t offset, size_t size);
+    /// add insertions of map of code placed at offset (offsets must be ordered)
+    void appendMap(size_t offset, const AsmCodeOffsetMap& map);
+    /// clear map
+    void clear()
+    {
+        insertsBefore.clear();
+        insertsAfter.clear();
+    }
+    /// return true if no insertion
+    bool empty() const
+    { return insertsBefore.empty() && insertsAfter.empty(); }
+    /// get new offset of label (symbol, jump target)
+    size_t mapLabel(size_t offset) const;
+    /// get new offset of instruction
+    size_t mapInstr(size_t offset) const;
 };
 
 class AsmRegAllocator
@@ -415,8 +491,71 @@ public:
      // first - orig ssaid, second - dest ssaid
     typedef std::pair<size_t, size_t> SSAReplace;
     typedef std::unordered_map<AsmSingleVReg, VectorSet<SSAReplace> > SSAReplacesMap;
-    // interference graph type
-    typedef Array<DTreeSet<size_t> > InterGraph;
+    /// interference graph
+    /** graph is built from live ranges by sweep over interval endpoints.
+     * Edges are held as sorted adjacency lists (sparse form) or, if graph is dense,
+     * also as bit-matrix that allows to check edge in constant time */
+    class InterGraph
+    {
+    public:
+        /// range of neighbours of node
+        struct NodeRange
+        {
+            const size_t* first;
+            const size_t* last;
+            
+            const size_t* begin() const
+            { return first; }
+            const size_t* end() const
+            { return last; }
+            size_t size() const
+            { return last-first; }
+            bool empty() const
+            { return first==last; }
+        };
+    private:
+        size_t nodesNum;
+        size_t rowWords;    // words per row in bit-matrix (0 - sparse form)
+        Array<uint64_t> bitMatrix;
+        Array<size_t> adjStarts;
+        Array<size_t> adjNodes;
+        
+        void moveEdgesToBitMatrix(std::vector<std::pair<size_t, size_t> >& edges);
+        void createAdjacencyLists(std::vector<std::pair<size_t, size_t> >& edges);
+    public:
+        /// constructor
+        InterGraph() : nodesNum(0), rowWords(0)
+        { }
+        
+        /// build graph from livenesses (live ranges of nodes)
+        void build(size_t nodesNum, const Array<OutLiveness>& livenesses);
+        /// merge nodes (nodeMap maps old nodes to new nodes)
+        void mergeNodes(size_t newNodesNum, const Array<size_t>& nodeMap);
+        /// clear graph
+        void clear();
+        
+        /// get nodes number
+        size_t size() const
+        { return nodesNum; }
+        /// return true if graph held in bit-matrix
+        bool isDense() const
+        { return rowWords!=0; }
+        /// get edges number
+        size_t edgesNum() const
+        { return adjNodes.size()>>1; }
+        /// get neighbours of node (sorted)
+        NodeRange operator[](size_t node) const
+        { return { adjNodes.data() + adjStarts[node],
+                    adjNodes.data() + adjStarts[node+1] }; }
+        /// return true if nodes interferes
+        bool hasEdge(size_t a, size_t b) const
+        {
+            if (rowWords!=0)
+                return (bitMatrix[a*rowWords + (b>>6)] & (1ULL<<(b&63))) != 0;
+            const NodeRange r = (*this)[a];
+            return std::binary_search(r.first, r.last, b);
+        }
+    };
     typedef std::unordered_map<AsmSingleVReg, std::vector<size_t> > VarIndexMap;
     struct LinearDep
     {
@@ -429,6 +568,29 @@ public:
     {
         DTree<size_t> vs[MAX_REGTYPES_NUM];
     };
+    /// move between two single registers (vregs)
+    struct RegMove
+    {
+        size_t offset;  ///< offset of instruction
+        size_t size;    ///< size of instruction
+        size_t dstVidx; ///< destination vreg index
+        size_t srcVidx; ///< source vreg index
+    };
+    /// usage of single vreg (spill candidate) in instruction
+    struct SpillUsage
+    {
+        size_t offset;  ///< offset of instruction
+        size_t vidx;    ///< vreg index
+        AsmSingleVReg svreg;    ///< register variable
+        cxbyte rwFlags; ///< read/write flags
+        cxuint tempColor; ///< temporary register for spilled vreg
+    };
+    /// register pressure in code block
+    struct BlockRegPressure
+    {
+        cxuint maxLiveRegs[MAX_REGTYPES_NUM];   ///< maximal number of live registers
+        size_t peakOffsets[MAX_REGTYPES_NUM];   ///< offset of instruction with peak
+    };
 private:
     Assembler& assembler;
     std::vector<CodeBlock> codeBlocks;
@@ -440,12 +602,50 @@ private:
     VarIndexMap vregIndexMaps[MAX_REGTYPES_NUM]; // indices to igraph for 2 reg types
     InterGraph interGraphs[MAX_REGTYPES_NUM]; // for 2 register 
     Array<cxuint> graphColorMaps[MAX_REGTYPES_NUM];
+    cxuint allocRegsNums[MAX_REGTYPES_NUM]; // number of registers used by regvars
     std::unordered_map<size_t, LinearDep> linearDepMaps[MAX_REGTYPES_NUM];
     // key - routine block, value - set of svvregs (lv indexes) used in routine
     std::unordered_map<size_t, VIdxSetEntry> vidxRoutineMap;
     // key - call block, value - set of svvregs (lv indexes) used between this call point
     std::unordered_map<size_t, VIdxSetEntry> vidxCallMap;
-    
+    std::vector<RegMove> regMoves[MAX_REGTYPES_NUM];
+    std::vector<RegMove> removedMoves;  // moves to remove (sorted by offset)
+    size_t coalescedMovesNum;
+    size_t removedMovesNum;
+    cxuint regsNumLimits[MAX_REGTYPES_NUM]; // 0 - no limit
+    cxuint spillLdsReg; // VGPR with address of LDS spill window (UINT_MAX - none)
+    cxuint spillLdsStride;
+    // spill costs of vregs (negative - vreg can not be spilled)
+    std::vector<double> spillCosts[MAX_REGTYPES_NUM];
+    std::vector<SpillUsage> spillUsages[MAX_REGTYPES_NUM]; // sorted by offset
+    // spill slot for vreg (SIZE_MAX - not spilled)
+    Array<size_t> spillSlots[MAX_REGTYPES_NUM];
+    size_t spilledRegsNums[MAX_REGTYPES_NUM];
+    // VGPRs (colors) that holds spilled SGPRs in lanes
+    std::vector<cxuint> spillLaneRegs;
+    AsmCodeOffsetMap codeOffsetMap;
+    std::vector<BlockRegPressure> blockRegPressures;
+    // regvar usages (in replay order) with first allocated register
+    std::vector<std::pair<AsmRegVarUsage, cxuint> > rregUsages;
+    /* error messages with offsets of instructions (printed by assembler
+     * after allocation), offset is SIZE_MAX if error is not for instruction */
+    std::vector<std::pair<size_t, std::string> > errorMessages;
+    
+    void printError(const char* message)
+    { errorMessages.push_back({ SIZE_MAX, message }); }
+    void printError(size_t offset, const char* message)
+    { errorMessages.push_back({ offset, message }); }
+    
+    void clear();
+    template<typename F>
+    void replayRegVarUsages(ISAUsageHandler& usageHandler, F func);
+    bool colorRegType(size_t regType, size_t colorsNum,
+                const std::vector<cxuint>& reservedColors,
+                std::vector<size_t>& failedNodes);
+    size_t chooseSpilledNode(size_t regType, const std::vector<size_t>& failedNodes) const;
+    bool reserveSpillColors(size_t regType, size_t colorsNum,
+                std::vector<cxuint>& reservedColors);
+    void assignSpillTemps(size_t regType, const std::vector<cxuint>& reservedColors);
 public:
     AsmRegAllocator(Assembler& assembler);
     // constructor for testing
@@ -457,12 +657,42 @@ public:
     void createSSAData(ISAUsageHandler& usageHandler,
                 ISALinearDepHandler& linDepHandler);
     void applySSAReplaces();
+    /// check whether register variables are only in code reachable from start
+    bool checkReachableRegVars();
     void createLivenesses(ISAUsageHandler& usageHandler,
                 ISALinearDepHandler& linDepHandler);
     void createInterferenceGraph();
+    /// compute register pressure in code blocks from livenesses
+    void createRegPressures();
+    /// coalesce vregs joined by moves (conservative coalescing)
+    void coalesceRegMoves(ISAUsageHandler& usageHandler, size_t codeSize,
+                const cxbyte* code);
     void colorInterferenceGraph();
-    
-    void allocateRegisters(AsmSectionId sectionId);
+    /// replace register variables in code by allocated registers
+    bool applyAllocatedRegisters(ISAUsageHandler& usageHandler,
+                size_t codeSize, cxbyte* code);
+    /// remove moves between this same registers (replaced by nops if code
+    /// can not be removed)
+    void removeRedundantMoves(AsmSection& section);
+    /// replace register variables in usages and delayed ops by allocated registers
+    void applyRealRegisters(AsmSection& section);
+    /// return true if code can be inserted to section (spill code)
+    bool canInsertCode(const AsmSection& section) const;
+    /// return true if all jumps in section can be retargeted (no calls and returns),
+    /// otherwise set badOffset to offset of first instruction that prevents it
+    bool canRetargetJumps(const AsmSection& section, size_t* badOffset = nullptr) const;
+    /// compute spill costs of vregs (from loop depth of code blocks)
+    void createSpillCosts(ISAUsageHandler& usageHandler, const AsmSection& section);
+    /// insert spill code to section, remove redundant moves and update offsets in section
+    void insertSpillCode(AsmSection& section);
+    
+    bool allocateRegisters(AsmSectionId sectionId);
+    /// allocate registers in section (can be part of code section)
+    bool allocateRegisters(AsmSection& section);
+    /// analyze register pressure in code blocks of section (code is not changed)
+    bool analyzeRegPressure(AsmSectionId sectionId);
+    /// analyze register pressure in section (can be part of code section)
+    bool analyzeRegPressure(AsmSection& section);
     
     const std::vector<CodeBlock>& getCodeBlocks() const
     { return codeBlocks; }
@@ -470,6 +700,50 @@ public:
     { return ssaReplacesMap; }
     const Array<OutLiveness>* getOutLivenesses() const
     { return outLivenesses; }
+    const InterGraph* getInterGraphs() const
+    { return interGraphs; }
+    const Array<cxuint>* getGraphColorMaps() const
+    { return graphColorMaps; }
+    /// get numbers of registers allocated for register variables (for reg types)
+    const cxuint* getAllocRegsNums() const
+    { return allocRegsNums; }
+    /// get moves between vregs (for reg types)
+    const std::vector<RegMove>* getRegMoves() const
+    { return regMoves; }
+    /// get number of coalesced moves
+    size_t getCoalescedMovesNum() const
+    { return coalescedMovesNum; }
+    /// get number of removed moves
+    size_t getRemovedMovesNum() const
+    { return removedMovesNum; }
+    /// get error messages with offsets of instructions from last allocation
+    const std::vector<std::pair<size_t, std::string> >& getErrorMessages() const
+    { return errorMessages; }
+    
+    /// set limit of registers number for register type (0 - no limit)
+    void setRegsNumLimit(size_t regType, cxuint limit)
+    { regsNumLimits[regType] = limit; }
+    /// set LDS window for spilled VGPRs (address VGPR and stride between slots)
+    void setSpillLds(cxuint reg, cxuint stride)
+    {
+        spillLdsReg = reg;
+        spillLdsStride = stride;
+    }
+    /// get spill costs of vregs (for reg types)
+    const std::vector<double>* getSpillCosts() const
+    { return spillCosts; }
+    /// get spill slots of vregs (for reg types)
+    const Array<size_t>* getSpillSlots() const
+    { return spillSlots; }
+    /// get numbers of spilled vregs (for reg types)
+    const size_t* getSpilledRegsNums() const
+    { return spilledRegsNums; }
+    /// get map of code offsets after inserting spill code
+    const AsmCodeOffsetMap& getCodeOffsetMap() const
+    { return codeOffsetMap; }
+    /// get register pressures of code blocks
+    const std::vector<BlockRegPressure>& getBlockRegPressures() const
+    { return blockRegPressures; }
     
     const std::unordered_map<size_t, LinearDep>* getLinearDepMaps() const
     { return linearDepMaps; }
@@ -483,7 +757,11 @@ public:
     { return vidxCallMap; }
 };
 
+struct WaitState;
+
 /// Assembler Wait scheduler
+/** finds waits needed by accesses of registers used by delayed ops.
+ * Register usages and delayed ops must refer to real registers */
 class AsmWaitScheduler
 {
 private:
@@ -493,17 +771,83 @@ private:
     const AsmRegAllocator::VarIndexMap* vregIndexMaps;
     const Array<cxuint>* graphColorMaps;
     bool onlyWarnings;
+    bool vsCntQueue; // VM ops without results are counted by separate counter
+    bool trackFinished; // track accesses finished by explicit waits (relaxing)
     std::vector<AsmWaitInstr> neededWaitInstrs;
+    std::vector<AsmWaitInstr> relaxedWaitInstrs;
+    
+    void processBlock(const AsmRegAllocator::CodeBlock& cblock, WaitState& state,
+            const std::vector<AsmRegVarUsage>& usages,
+            const std::vector<AsmDelayedOp>& delayedOps,
+            const std::vector<AsmWaitInstr>& waitInstrs,
+            std::vector<AsmWaitInstr>* neededWaits,
+            std::vector<AsmWaitInstr>* waitDemands) const;
+    void findWaits(const std::vector<AsmRegVarUsage>& usages,
+            const std::vector<AsmDelayedOp>& delayedOps,
+            const std::vector<AsmWaitInstr>& waitInstrs,
+            const std::vector<std::vector<size_t> >& nextBlocks,
+            std::vector<AsmWaitInstr>& neededWaits,
+            std::vector<AsmWaitInstr>* waitDemands) const;
 public:
     AsmWaitScheduler(const AsmWaitConfig& asmWaitConfig, Assembler& assembler,
             const std::vector<AsmRegAllocator::CodeBlock>& codeBlocks,
             const AsmRegAllocator::VarIndexMap* vregIndexMaps,
             const Array<cxuint>* graphColorMaps, bool onlyWarnings);
     
+    /// find needed waits (if onlyWarnings, needed waits do not change queue states)
     void schedule(ISAUsageHandler& usageHandler, ISAWaitHandler& waitHandler);
     
+    /// get waits needed before instructions (sorted by offset)
     const std::vector<AsmWaitInstr>& getNeededWaitInstrs() const
     { return neededWaitInstrs; }
+    
+    /// find explicit wait instructions that wait for more than needed
+    void relaxWaits(ISAUsageHandler& usageHandler, ISAWaitHandler& waitHandler);
+    
+    /// get relaxed explicit wait instructions (sorted by offset)
+    const std::vector<AsmWaitInstr>& getRelaxedWaitInstrs() const
+    { return relaxedWaitInstrs; }
+};
+
+/// Assembler instruction scheduler
+/** latency hiding list scheduler. Instructions are reordered only inside segments
+ * of code blocks. Segments are separated by barriers (waits, jumps, instructions
+ * with hazards) and by fixed offsets (labels). Register dependencies and
+ * order of memory instructions are kept. New order is accepted only if it reduces
+ * estimated cycles of segment and if it does not increase register pressure
+ * over budget (peak pressure of section before scheduling) */
+class AsmInstrScheduler: public NonCopyableAndNonMovable
+{
+public:
+    /// instruction moved by scheduler
+    struct InstrMove
+    {
+        size_t offset;      ///< offset of instruction before scheduling
+        size_t size;        ///< size of instruction
+        size_t newOffset;   ///< offset of instruction after scheduling
+    };
+private:
+    Assembler& assembler;
+    const std::vector<AsmRegAllocator::CodeBlock>& codeBlocks;
+    std::vector<InstrMove> instrMoves;
+public:
+    /// constructor
+    AsmInstrScheduler(Assembler& assembler,
+            const std::vector<AsmRegAllocator::CodeBlock>& codeBlocks);
+
+    /// schedule instructions
+    /**
+     * \param codeSize size of code
+     * \param code code of section
+     * \param usageHandler register usages of section
+     * \param fixedOffsets sorted offsets that can not be crossed by instructions
+     */
+    void schedule(size_t codeSize, const cxbyte* code, ISAUsageHandler& usageHandler,
+            const std::vector<size_t>& fixedOffsets);
+
+    /// get moved instructions (sorted by offset)
+    const std::vector<InstrMove>& getInstrMoves() const
+    { return instrMoves; }
 };
 
 /// type of clause
@@ -525,6 +869,30 @@ struct AsmClause
     AsmSourcePos prevIfPos; ///< position of previous if-clause
 };
 
+/// register pressure in code block of section
+struct AsmRegPressureBlock
+{
+    size_t start;   ///< start offset of code block
+    size_t end;     ///< end offset of code block
+    cxuint maxLiveRegs[MAX_REGTYPES_NUM];   ///< maximal number of live registers
+    size_t peakOffsets[MAX_REGTYPES_NUM];   ///< offset of instruction with peak
+    cxuint wavesNum;    ///< waves per SIMD for peak register pressure
+};
+
+/// register pressure report of code section
+struct AsmRegPressureSection
+{
+    AsmSectionId sectionId; ///< section id
+    size_t localSize;   ///< LDS size used by kernels (from kernel config)
+    cxuint workGroupSize;   ///< work-items in work-group (0 - maximal)
+    cxuint extraSGPRsNum;   ///< extra SGPRs (VCC, FLAT_SCRATCH, XNACK)
+    cxuint maxLiveRegs[MAX_REGTYPES_NUM];   ///< maximal number of live registers
+    cxuint wavesNum;    ///< waves per SIMD for whole section
+    std::vector<AsmRegPressureBlock> blocks;    ///< code blocks
+};
+
+struct AsmCodePart;
+
 /// main class of assembler
 class Assembler: public NonCopyableAndNonMovable
 {
@@ -548,6 +916,7 @@ private:
     friend class ISAAssembler;
     friend class AsmRegAllocator;
     friend class AsmWaitScheduler;
+    friend class AsmInstrScheduler;
     
     friend struct AsmParseUtils; // INTERNAL LOGIC
     friend struct AsmPseudoOps; // INTERNAL LOGIC
@@ -595,6 +964,25 @@ private:
     bool buggyFPLit;
     bool macroCase;
     bool oldModParam;
+    bool regAlloc;
+    bool autoWait;
+    size_t insertedWaitsNum;    // waits inserted by autowait mode
+    bool checkWaits;
+    bool relaxWaits;
+    size_t relaxedWaitsNum;     // explicit waits relaxed in relaxwaits mode
+    bool schedule;
+    size_t movedInstrsNum;      // instructions moved by instruction scheduler
+    bool shrink;
+    size_t savedBytesNum;       // code bytes saved in shrink mode
+    cxuint targetOccupancy;
+    cxuint threadsNum;  // threads for post-parse stages (0 - all hardware threads)
+    size_t coalescedMovesNum;   // moves coalesced by register allocator
+    size_t removedMovesNum;     // moves removed by register allocator
+    size_t spilledRegsNums[MAX_REGTYPES_NUM];   // registers spilled by allocator
+    cxuint spillLdsReg; // VGPR with address of LDS spill window (UINT_MAX - none)
+    cxuint spillLdsStride;
+    bool regPressureReport;
+    std::vector<AsmRegPressureSection> regPressures;
     Flags codeFlags;
     
     cxuint inclusionLevel;
@@ -606,6 +994,8 @@ private:
     const char* line;
     bool endOfAssembly;
     bool sectionDiffsPrepared;
+    // if true, evaluated differences of labels are updated after inserting code
+    bool labelDiffsUpdated;
     bool collectSourcePoses; /// collect offset->source positions data
     
     cxuint filenameIndex;
@@ -788,6 +1178,28 @@ private:
     void tryToResolveSymbol(AsmSymbolEntry& symEntry);
     void tryToResolveSymbols(AsmScope* scope);
     void printUnresolvedSymbols(AsmScope* scope);
+    // get code section of kernel (ASMSECT_NONE if no code section)
+    AsmSectionId getKernelCodeSectionId(AsmKernelId kernelId);
+    // get offsets between code of kernels that can be processed separately
+    void getCodeSplitOffsets(AsmSectionId sectionId, std::vector<size_t>& splitOffsets);
+    // split code sections to parts that can be processed in parallel
+    void splitCodeSections(std::vector<std::vector<size_t> >& splitOffsets,
+                std::vector<std::vector<AsmSection> >& sectionParts,
+                std::vector<AsmCodePart>& codeParts);
+    // allocate registers for register variables in code sections
+    bool allocateRegisters();
+    // update offsets in section after inserting code by register allocator
+    void updateSectionOffsets(AsmSectionId sectionId, const AsmCodeOffsetMap& offsetMap);
+    // create register pressure report for code sections
+    void createRegPressureReport();
+    // insert waits for results of delayed operations in code sections
+    bool insertWaitInstrs();
+    // warn about or relax explicit waits that wait for more than needed
+    bool relaxWaitInstrs();
+    // schedule instructions in basic blocks of code sections to hide latencies
+    void scheduleInstrs();
+    // run passes that change code: scheduling, register allocation and waits
+    bool processCode();
     
     bool resolveExprTarget(const AsmExpression* expr, uint64_t value,
                         AsmSectionId sectionId);
@@ -921,6 +1333,72 @@ public:
     /// get true if buggyFPLit enabled
     bool isBuggyFPLit() const
     { return buggyFPLit; }
+    /// get true if register allocation for register variables enabled
+    bool isRegAlloc() const
+    { return regAlloc; }
+    /// get true if waits for results of delayed operations are inserted
+    bool isAutoWait() const
+    { return autoWait; }
+    /// get true if warnings for waits that wait for more than needed are printed
+    bool isCheckWaits() const
+    { return checkWaits; }
+    /// get true if waits that wait for more than needed are relaxed
+    bool isRelaxWaits() const
+    { return relaxWaits; }
+    /// get true if instructions are scheduled to hide latencies
+    bool isSchedule() const
+    { return schedule; }
+    /// get true if shortest encoding of instructions is chosen
+    bool isShrink() const
+    { return shrink; }
+    /// get target occupancy (waves per SIMD) for register allocator (0 - not set)
+    cxuint getTargetOccupancy() const
+    { return targetOccupancy; }
+    /// set target occupancy (waves per SIMD) for register allocator (0 - not set)
+    void setTargetOccupancy(cxuint waves)
+    { targetOccupancy = waves; }
+    /// get number of threads for post-parse stages (0 - all hardware threads)
+    cxuint getThreadsNum() const
+    { return threadsNum; }
+    /// set number of threads for post-parse stages (0 - all hardware threads)
+    void setThreadsNum(cxuint threads)
+    { threadsNum = threads; }
+    /// get number of moves coalesced by register allocator
+    size_t getCoalescedMovesNum() const
+    { return coalescedMovesNum; }
+    /// get number of moves removed by register allocator
+    size_t getRemovedMovesNum() const
+    { return removedMovesNum; }
+    /// get numbers of registers spilled by register allocator (for reg types)
+    const size_t* getSpilledRegsNums() const
+    { return spilledRegsNums; }
+    /// get number of waits inserted in autowait mode
+    size_t getInsertedWaitsNum() const
+    { return insertedWaitsNum; }
+    /// get number of explicit waits relaxed in relaxwaits mode
+    size_t getRelaxedWaitsNum() const
+    { return relaxedWaitsNum; }
+    /// get number of instructions moved by instruction scheduler
+    size_t getMovedInstrsNum() const
+    { return movedInstrsNum; }
+    /// get number of code bytes saved in shrink mode
+    size_t getSavedBytesNum() const
+    { return savedBytesNum; }
+    /// get true if register pressure report will be created
+    bool isRegPressureReport() const
+    { return regPressureReport; }
+    /// enable register pressure report (requires register allocation mode)
+    void setRegPressureReport(bool enable)
+    {
+        regPressureReport = enable;
+        // source positions for error messages
+        collectSourcePoses |= enable;
+    }
+    /// get register pressure report (per code section)
+    const std::vector<AsmRegPressureSection>& getRegPressures() const
+    { return regPressures; }
+    /// write register pressure report in JSON format
+    void writeRegPressureReport(std::ostream& outStream) const;
     /// get include directory list
     const std::vector<CString>& getIncludeDirs() const
     { return includeDirs; }
@@ -520,6 +520,14 @@ public:
     const ROCmDisasmInput* getROCmInput() const
     { return rocmInput; }
     
+    /// get disassembler input
+    const RawCodeInput* getRawInput() const
+    { return rawInput; }
+    
+    /// get binary format
+    BinaryFormat getBinaryFormat() const
+    { return binaryFormat; }
+    
     /// get output stream
     const std::ostream& getOutput() const
     { return output; }
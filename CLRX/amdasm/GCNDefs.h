@@ -123,6 +123,7 @@ enum : cxbyte
     GCNDELOP_EXPVMWRITE,
     GCNDELOP_EXPORT,
     GCNDELOP_MAX = GCNDELOP_EXPORT,
+    GCNDELOP_SYNC = ASMDELOP_SYNC,
     GCNDELOP_NONE = ASMDELOP_NONE
 };
 
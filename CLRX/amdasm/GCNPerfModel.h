@@ -0,0 +1,169 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/*! \file GCNPerfModel.h
+ * \brief static performance model for GCN code
+ */
+
+#ifndef __CLRX_GCNPERFMODEL_H__
+#define __CLRX_GCNPERFMODEL_H__
+
+#include <CLRX/Config.h>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/utils/GPUId.h>
+#include <CLRX/utils/CString.h>
+
+/// main namespace
+namespace CLRX
+{
+
+class Assembler;
+class Disassembler;
+
+/// instruction classes of GCN performance model
+enum : cxbyte
+{
+    GCNPERF_SALU = 0,   ///< scalar ALU instructions
+    GCNPERF_VALU,       ///< vector ALU instructions (include VINTRP)
+    GCNPERF_VMEM,       ///< vector memory instructions (MUBUF, MTBUF, MIMG, FLAT)
+    GCNPERF_SMEM,       ///< scalar memory instructions (SMRD, SMEM)
+    GCNPERF_LDS,        ///< data share instructions (DS)
+    GCNPERF_EXPORT,     ///< export instructions
+    GCNPERF_BRANCH,     ///< jumps, calls, returns and end of program
+    GCNPERF_WAIT,       ///< wait instructions (S_WAITCNT)
+    GCNPERF_ILLEGAL,    ///< illegal instructions
+    GCNPERF_CLASSES_NUM
+};
+
+/// wait counters of GCN performance model
+enum : cxbyte
+{
+    GCNPERF_VMCNT = 0,  ///< vector memory counter
+    GCNPERF_EXPCNT,     ///< export counter
+    GCNPERF_LGKMCNT,    ///< LDS, GDS, scalar memory and message counter
+    GCNPERF_VSCNT,      ///< vector memory store counter (GFX10)
+    GCNPERF_COUNTERS_NUM
+};
+
+/// latencies of delayed operations (in cycles) used to estimate stalls
+struct GCNPerfLatencies
+{
+    cxuint vmem;    ///< latency of vector memory operation
+    cxuint smem;    ///< latency of scalar memory operation and message
+    cxuint lds;     ///< latency of data share operation
+    cxuint exp;     ///< latency of export
+};
+
+/// wait that waits for delayed operations (likely stall point)
+struct GCNPerfStall
+{
+    size_t offset;      ///< offset of wait instruction
+    cxbyte counter;     ///< wait counter (GCNPERF_VMCNT, ...)
+    cxuint count;       ///< counter value in wait instruction
+    size_t opOffset;    ///< offset of youngest awaited operation
+    uint64_t coveredCycles; ///< issue cycles between awaited operation and wait
+    uint64_t stallCycles;   ///< estimated stall cycles
+};
+
+/// performance statistics of code block
+struct GCNPerfBlock
+{
+    size_t start;   ///< start offset of code block
+    size_t end;     ///< end offset of code block
+    cxuint instrsNum[GCNPERF_CLASSES_NUM];  ///< number of instructions in classes
+    uint64_t issueCycles;   ///< estimated issue cycles (include literal cycles)
+    cxuint literalsNum;     ///< number of literal constants
+    uint64_t literalCycles; ///< extra cycles for instructions with literal
+    uint64_t stallCycles;   ///< estimated stall cycles at waits
+    std::vector<GCNPerfStall> stalls;   ///< waits that wait for delayed operations
+};
+
+/// performance statistics of kernel
+struct GCNPerfKernel
+{
+    CString name;   ///< kernel name
+    size_t offset;  ///< offset of kernel code
+    size_t size;    ///< size of kernel code
+    cxuint instrsNum[GCNPERF_CLASSES_NUM];  ///< number of instructions in classes
+    uint64_t issueCycles;   ///< estimated issue cycles (include literal cycles)
+    cxuint literalsNum;     ///< number of literal constants
+    uint64_t literalCycles; ///< extra cycles for instructions with literal
+    uint64_t stallCycles;   ///< estimated stall cycles at waits
+    std::vector<GCNPerfBlock> blocks;   ///< code blocks
+};
+
+/// static performance model of GCN code
+/** model decodes code directly (without disassembling to text) and estimates
+ * instruction mix, issue cycles (from GCN timings), literal overhead and
+ * stall points for every code block. Conditional jumps are treated as not taken.
+ * Object can be used concurrently with other objects.
+ */
+class GCNPerfModel: public NonCopyableAndNonMovable
+{
+private:
+    GPUDeviceType deviceType;
+    cxuint dpFactor;
+    GCNPerfLatencies latencies;
+    std::vector<GCNPerfKernel> kernels;
+public:
+    /// constructor
+    explicit GCNPerfModel(GPUDeviceType deviceType);
+    /// constructor with latencies
+    GCNPerfModel(GPUDeviceType deviceType, const GCNPerfLatencies& latencies);
+
+    /// analyze code of single kernel and add it to kernels
+    /**
+     * \param name kernel name
+     * \param codeSize code size
+     * \param code code of kernel
+     * \param offset offset of code (added to all offsets in statistics)
+     */
+    void analyzeCode(const CString& name, size_t codeSize, const cxbyte* code,
+                size_t offset = 0);
+    /// analyze all kernels from disassembler input
+    void analyzeDisassembler(const Disassembler& disassembler);
+    /// analyze all code sections of assembler (after assembling)
+    void analyzeAssembler(const Assembler& assembler);
+
+    /// get device type
+    GPUDeviceType getDeviceType() const
+    { return deviceType; }
+    /// get DPFACTOR (double precision speed factor) of device
+    cxuint getDPFactor() const
+    { return dpFactor; }
+    /// get latencies
+    const GCNPerfLatencies& getLatencies() const
+    { return latencies; }
+    /// get kernel statistics
+    const std::vector<GCNPerfKernel>& getKernels() const
+    { return kernels; }
+
+    /// write report (in JSON format)
+    /**
+     * \param os output stream
+     * \param fileName name of analyzed file (optional)
+     */
+    void writeReport(std::ostream& os, const char* fileName = nullptr) const;
+};
+
+};
+
+#endif
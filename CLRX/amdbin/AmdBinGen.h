@@ -208,6 +208,8 @@ class AmdGPUBinGenerator: public NonCopyableAndNonMovable
 private:
     bool manageable;
     const AmdInput* input;
+    bool mergeStrings;
+    cxuint threadsNum;
     
     void generateInternal(std::ostream* osPtr, std::vector<char>* vPtr,
              Array<cxbyte>* aPtr) const;
@@ -241,6 +243,18 @@ public:
     /// set input
     void setInput(const AmdInput* input);
     
+    /// enable deduplication and suffix merging in ELF string tables
+    void setMergeStrings(bool merge)
+    { mergeStrings = merge; }
+    
+    /// get number of threads used to generate inner binaries
+    cxuint getThreadsNum() const
+    { return threadsNum; }
+    
+    /// set number of threads used to generate inner binaries (0 - all CPUs)
+    void setThreadsNum(cxuint threads)
+    { threadsNum = threads; }
+    
     /// generates binary
     void generate(Array<cxbyte>& array) const;
     
@@ -61,6 +61,9 @@ enum : Flags {
     AMDBIN_INNER_CREATE_CALNOTES = 0x10000, ///< create CAL notes for AMD inner GPU binary
     
     AMDBIN_CREATE_ALL = ELF_CREATE_ALL | 0xffff0, ///< all AMD binaries creation flags
+    /** parse kernel informations and inner binaries at first access
+     * (only for GPU binaries) */
+    AMDBIN_CREATE_LAZY = 0x100000,
     AMDBIN_INNER_SHIFT = 12 ///< shift for convert inner binary flags into elf binary flags
 };
 
@@ -417,14 +420,28 @@ public:
     typedef Array<std::pair<CString, size_t> > KernelInfoMap;
 protected:
     AmdMainType type;   ///< type of binaries
-    Array<KernelInfo> kernelInfos;    ///< kernel informations
+    /// kernel informations (mutable, because can be parsed at first access)
+    mutable Array<KernelInfo> kernelInfos;
     KernelInfoMap kernelInfosMap;   ///< kernel informations map
+    /// once flags for kernel informations parsed at first access (lazy mode)
+    std::unique_ptr<OnceFlag[]> kernelInfoOnceFlags;
     
     CString driverInfo; ///< driver info string
     CString compileOptions; ///< compiler options string
     
     /// constructor
     explicit AmdMainBinaryBase(AmdMainType type);
+    
+    /// parse kernel info with specified index (for lazy mode)
+    virtual void initKernelInfo(size_t index) const;
+    
+    /// parse kernel info if not parsed (for lazy mode)
+    void prepareKernelInfo(size_t index) const
+    {
+        if (kernelInfoOnceFlags)
+            callOnce(kernelInfoOnceFlags[index], [this, index]()
+                { initKernelInfo(index); });
+    }
 public:
     virtual ~AmdMainBinaryBase();
     
@@ -436,13 +453,20 @@ public:
     size_t getKernelInfosNum() const
     { return kernelInfos.size(); }
     
-    /// get kernel informations array
+    /// get kernel informations array (in lazy mode, parses all kernel informations)
     const KernelInfo* getKernelInfos() const
-    { return kernelInfos.data(); }
+    {
+        for (size_t i = 0; kernelInfoOnceFlags && i < kernelInfos.size(); i++)
+            prepareKernelInfo(i);
+        return kernelInfos.data();
+    }
     
     /// get kernel information with specified index
     const KernelInfo& getKernelInfo(size_t index) const
-    { return kernelInfos[index]; }
+    {
+        prepareKernelInfo(index);
+        return kernelInfos[index];
+    }
     
     /// get kernel information with specified kernel name (requires kernel info map)
     const KernelInfo& getKernelInfo(const char* name) const;
@@ -480,7 +504,16 @@ public:
     /// kernel header map type
     typedef Array<std::pair<CString, size_t> > KernelHeaderMap;
 protected:
-    Array<AmdInnerGPUBinary32> innerBinaries;   ///< inner binaries
+    /// inner binary entry (used to parse inner binary at first access)
+    struct LazyInnerBinary
+    {
+        CString kernelName; ///< kernel name
+        size_t size;    ///< size of inner binary
+        cxbyte* data;   ///< inner binary code
+    };
+    
+    /// inner binaries (mutable, because can be parsed at first access)
+    mutable Array<AmdInnerGPUBinary32> innerBinaries;
     InnerBinaryMap innerBinaryMap;  ///< inner binary map
     std::unique_ptr<AmdGPUKernelMetadata[]> metadatas;  ///< AMD metadatas
     Array<AmdGPUKernelHeader> kernelHeaders;    ///< kernel headers
@@ -488,12 +521,34 @@ protected:
     size_t globalDataSize;  ///< global data size
     cxbyte* globalData; ///< global data content
     
+    Flags innerCreationFlags;   ///< creation flags for inner binaries
+    /// inner binaries to parse at first access (lazy mode)
+    Array<LazyInnerBinary> lazyInnerBinaries;
+    /// once flags for inner binaries (lazy mode)
+    std::unique_ptr<OnceFlag[]> innerBinaryOnceFlags;
+    /// metadata symbol names for kernel informations (lazy mode)
+    Array<const char*> lazyMetadataSymNames;
+    
     /// constructor
     explicit AmdMainGPUBinaryBase(AmdMainType type);
     
     /// initialize main gpu binary (internal use only)
     template<typename Types>
     void initMainGPUBinary(typename Types::ElfBinary& binary);
+    
+    /// parse kernel info with specified index (for lazy mode)
+    void initKernelInfo(size_t index) const;
+    
+    /// parse inner binary with specified index (for lazy mode)
+    void initInnerBinary(size_t index) const;
+    
+    /// parse inner binary if not parsed (for lazy mode)
+    void prepareInnerBinary(size_t index) const
+    {
+        if (innerBinaryOnceFlags)
+            callOnce(innerBinaryOnceFlags[index], [this, index]()
+                { initInnerBinary(index); });
+    }
 public:
     /// get number of inner binaries
     size_t getInnerBinariesNum() const
@@ -501,11 +556,17 @@ public:
     
     /// get inner binary with specified index
     AmdInnerGPUBinary32& getInnerBinary(size_t index)
-    { return innerBinaries[index]; }
+    {
+        prepareInnerBinary(index);
+        return innerBinaries[index];
+    }
     
     /// get inner binary with specified index
     const AmdInnerGPUBinary32& getInnerBinary(size_t index) const
-    { return innerBinaries[index]; }
+    {
+        prepareInnerBinary(index);
+        return innerBinaries[index];
+    }
     
     /// get inner binary with specified name (requires inner binary map)
     const AmdInnerGPUBinary32& getInnerBinary(const char* name) const;
@@ -155,6 +155,7 @@ class AmdCL2GPUBinGenerator: public NonCopyableAndNonMovable
 private:
     bool manageable;
     const AmdCL2Input* input;
+    bool mergeStrings;
     
     void generateInternal(std::ostream* osPtr, std::vector<char>* vPtr,
              Array<cxbyte>* aPtr) const;
@@ -196,6 +197,10 @@ public:
     /// set input
     void setInput(const AmdCL2Input* input);
     
+    /// enable deduplication and suffix merging in ELF string tables
+    void setMergeStrings(bool merge)
+    { mergeStrings = merge; }
+    
     /// generates binary
     void generate(Array<cxbyte>& array) const;
     
@@ -666,6 +666,7 @@ typedef struct
 #define DT_LOPROC   0x70000000  /* Start of processor-specific */
 #define DT_HIPROC   0x7fffffff  /* End of processor-specific */
 #define DT_PROCNUM  DT_MIPS_NUM /* Most used by any processor */
+#define DT_GNU_HASH 0x6ffffef5  /* GNU-style hash table */
 
 /* NOTE: Further definitions has been deleted from this file, because was obsolete */
 
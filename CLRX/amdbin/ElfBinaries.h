@@ -30,6 +30,10 @@
 #include <string>
 #include <utility>
 #include <ostream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 #include <CLRX/amdbin/Elf.h>
 #include <CLRX/utils/MemAccess.h>
 #include <CLRX/utils/Utilities.h>
@@ -139,6 +143,57 @@ struct Elf64Types
     static const cxuint relSymShift = 32;
 };
 
+/// lazily created hash map of names to indices (for sections and symbols)
+/** The map is created by builder at first access. Creation is thread-safe.
+ * Copy of this object doesn't hold the map, it will be created again at first access.
+ */
+class ElfLazyIndexMap
+{
+public:
+    /// hash map type
+    typedef std::unordered_map<const char*, size_t, CStringHash, CStringEqual> Map;
+private:
+    mutable std::atomic<Map*> map;
+    mutable std::mutex mutex;
+public:
+    /// constructor
+    ElfLazyIndexMap() : map(nullptr)
+    { }
+    /// copy constructor (doesn't copy map)
+    ElfLazyIndexMap(const ElfLazyIndexMap&) : map(nullptr)
+    { }
+    /// destructor
+    ~ElfLazyIndexMap()
+    { delete map.load(); }
+    
+    /// copy assignment (only clears map)
+    ElfLazyIndexMap& operator=(const ElfLazyIndexMap& cp)
+    {
+        if (this != &cp)
+            delete map.exchange(nullptr);
+        return *this;
+    }
+    
+    /// get map, create it by using builder if doesn't exist
+    template<typename Builder>
+    const Map& get(Builder builder) const
+    {
+        Map* curMap = map.load(std::memory_order_acquire);
+        if (curMap != nullptr)
+            return *curMap;
+        std::lock_guard<std::mutex> lock(mutex);
+        curMap = map.load(std::memory_order_relaxed);
+        if (curMap == nullptr)
+        {
+            std::unique_ptr<Map> newMap(new Map);
+            builder(*newMap);
+            curMap = newMap.release();
+            map.store(curMap, std::memory_order_release);
+        }
+        return *curMap;
+    }
+};
+
 /// ELF binary class
 /** This object doesn't copy binary code content.
  * Only it takes and uses a binary code.
@@ -148,9 +203,9 @@ class ElfBinaryTemplate
 {
 public:
     /// section index map
-    typedef Array<std::pair<const char*, size_t> > SectionIndexMap;
+    typedef ElfLazyIndexMap::Map SectionIndexMap;
     /// symbol index map
-    typedef Array<std::pair<const char*, size_t> > SymbolIndexMap;
+    typedef ElfLazyIndexMap::Map SymbolIndexMap;
 protected:
     Flags creationFlags;   ///< creation flags holder
     size_t binaryCodeSize;  ///< binary code size
@@ -162,9 +217,11 @@ protected:
     cxbyte* dynSymTable;          ///< pointer to dynamic symbol table
     cxbyte* noteTable;            ///< pointer to note table
     cxbyte* dynamicTable;         ///< pointer to dynamic table
-    SectionIndexMap sectionIndexMap;    ///< section's index map
-    SymbolIndexMap symbolIndexMap;      ///< symbol's index map
-    SymbolIndexMap dynSymIndexMap;      ///< dynamic symbol's index map
+    cxbyte* dynSymHashTable;      ///< pointer to SysV hash table of dynamic symbols
+    cxbyte* dynSymGnuHashTable;   ///< pointer to GNU hash table of dynamic symbols
+    ElfLazyIndexMap sectionIndexMap;    ///< section's index map (created at first use)
+    ElfLazyIndexMap symbolIndexMap;      ///< symbol's index map (created at first use)
+    ElfLazyIndexMap dynSymIndexMap;      ///< dynamic symbol's index map (created at first use)
     
     typename Types::Size symbolsNum;    ///< symbols number
     typename Types::Size dynSymbolsNum; ///< dynamic symbols number
@@ -174,6 +231,12 @@ protected:
     uint16_t dynSymEntSize; ///< dynamic symbol entry size in a dynamic symbol's table
     typename Types::Size dynamicEntSize; ///< get dynamic entry size
     
+    /// get section index map (creates it if needed)
+    const SectionIndexMap& getSectionIndexMap() const;
+    /// get symbol index map (creates it if needed)
+    const SymbolIndexMap& getSymbolIndexMap() const;
+    /// get dynamic symbol index map (creates it if needed)
+    const SymbolIndexMap& getDynSymbolIndexMap() const;
 public:
     ElfBinaryTemplate();
     /** constructor.
@@ -327,14 +390,14 @@ public:
     
     /// get end iterator if section index map
     SectionIndexMap::const_iterator getSectionIterEnd() const
-    { return sectionIndexMap.end(); }
+    { return getSectionIndexMap().end(); }
     
     /// get section iterator with specified name (requires section index map)
     SectionIndexMap::const_iterator getSectionIter(const char* name) const
     {
-        SectionIndexMap::const_iterator it = binaryMapFind(
-                    sectionIndexMap.begin(), sectionIndexMap.end(), name, CStringLess());
-        if (it == sectionIndexMap.end())
+        const SectionIndexMap& map = getSectionIndexMap();
+        SectionIndexMap::const_iterator it = map.find(name);
+        if (it == map.end())
             throw BinException(std::string("Can't find Elf")+Types::bitName+" Section");
         return it;
     }
@@ -345,23 +408,37 @@ public:
     /// get symbol index with specified name (requires symbol index map)
     typename Types::Size getSymbolIndex(const char* name) const;
     
-    /// get dynamic symbol index with specified name (requires dynamic symbol index map)
+    /// get dynamic symbol index with specified name
+    /** uses hash table of dynamic symbols if binary has it,
+     * otherwise requires dynamic symbol index map */
     typename Types::Size getDynSymbolIndex(const char* name) const;
     
+    /// returns true if binary has hash table (SysV or GNU) for dynamic symbols
+    bool hasDynSymbolHashTable() const
+    { return dynSymHashTable != nullptr || dynSymGnuHashTable != nullptr; }
+    
+    /// find dynamic symbol index through hash table (GNU or SysV)
+    /**
+     * \param name symbol name
+     * \param index output symbol index
+     * \return true if symbol found
+     */
+    bool findDynSymbolIndex(const char* name, typename Types::Size& index) const;
+    
     /// get end iterator of symbol index map
     SymbolIndexMap::const_iterator getSymbolIterEnd() const
-    { return symbolIndexMap.end(); }
+    { return getSymbolIndexMap().end(); }
     
     /// get end iterator of dynamic symbol index map
     SymbolIndexMap::const_iterator getDynSymbolIterEnd() const
-    { return dynSymIndexMap.end(); }
+    { return getDynSymbolIndexMap().end(); }
     
     /// get symbol iterator with specified name (requires symbol index map)
     SymbolIndexMap::const_iterator getSymbolIter(const char* name) const
     {
-        SymbolIndexMap::const_iterator it = binaryMapFind(
-                    symbolIndexMap.begin(), symbolIndexMap.end(), name, CStringLess());
-        if (it == symbolIndexMap.end())
+        const SymbolIndexMap& map = getSymbolIndexMap();
+        SymbolIndexMap::const_iterator it = map.find(name);
+        if (it == map.end())
             throw BinException(std::string("Can't find Elf")+Types::bitName+" Symbol");
         return it;
     }
@@ -369,9 +446,9 @@ public:
     /// get dynamic symbol iterator with specified name (requires dynamic symbol index map)
     SymbolIndexMap::const_iterator getDynSymbolIter(const char* name) const
     {
-        SymbolIndexMap::const_iterator it = binaryMapFind(
-                    dynSymIndexMap.begin(), dynSymIndexMap.end(), name, CStringLess());
-        if (it == dynSymIndexMap.end())
+        const SymbolIndexMap& map = getDynSymbolIndexMap();
+        SymbolIndexMap::const_iterator it = map.find(name);
+        if (it == map.end())
             throw BinException(std::string("Can't find Elf")+Types::bitName+" DynSymbol");
         return it;
     }
@@ -817,6 +894,37 @@ typedef ElfSymbolTemplate<Elf32Types> ElfSymbol32;
 /// 64-bit elf symbol
 typedef ElfSymbolTemplate<Elf64Types> ElfSymbol64;
 
+/// string table builder with deduplication and suffix merging
+/** identical names share same string, and name that is suffix of other name
+ * points to end of that name */
+class ElfStrTabBuilder
+{
+private:
+    Array<uint32_t> offsets;
+    Array<char> content;
+public:
+    /// build string table
+    /**
+     * \param namesNum number of names
+     * \param names names (null or empty names points to null character)
+     * \param addNull if true then add null character at beginning
+     */
+    void build(size_t namesNum, const char* const* names, bool addNull);
+    
+    /// return true if no names in string table
+    bool empty() const
+    { return offsets.empty(); }
+    /// get size of string table
+    size_t getSize() const
+    { return content.size(); }
+    /// get offset of name with specified index
+    uint32_t getOffset(size_t index) const
+    { return offsets[index]; }
+    /// get content of string table
+    const char* getContent() const
+    { return content.data(); }
+};
+
 /// ELF binary generator
 template<typename Types>
 class ElfBinaryGenTemplate
@@ -825,6 +933,10 @@ private:
     bool sizeComputed;
     bool addNullSym, addNullDynSym;
     bool addNullSection;
+    bool mergeStrings;
+    ElfStrTabBuilder strTabBuilder;
+    ElfStrTabBuilder dynStrBuilder;
+    ElfStrTabBuilder shStrTabBuilder;
     cxuint addrStartRegion;
     uint16_t shStrTab, strTab, dynStr;
     cxuint shdrTabRegion, phdrTabRegion;
@@ -844,8 +956,21 @@ private:
     uint32_t bucketsNum;
     std::unique_ptr<uint32_t[]> hashCodes;
     bool isHashDynSym;
+    bool hasGnuHash;
+    uint32_t gnuBucketsNum;
+    uint32_t gnuSymOffset;
+    uint32_t gnuBloomSize;
+    uint32_t gnuBloomShift;
+    std::unique_ptr<uint32_t[]> gnuHashCodes;
+    std::vector<ElfSymbolTemplate<Types> > sortedDynSymbols;
+    Array<size_t> dynSymOutIndices;
+    
+    // dynamic symbols in output order (sorted by GNU hash buckets if needed)
+    const std::vector<ElfSymbolTemplate<Types> >& getOutDynSymbols() const
+    { return hasGnuHash ? sortedDynSymbols : dynSymbols; }
     
     void computeSize();
+    void prepareGnuHash();
 public:
     ElfBinaryGenTemplate();
     /// construcrtor
@@ -864,6 +989,10 @@ public:
     void setHeader(const ElfHeaderTemplate<Types>& header)
     { this->header = header; }
     
+    /// enable deduplication and suffix merging in .strtab, .dynstr and .shstrtab
+    void setMergeStrings(bool merge)
+    { mergeStrings = merge; }
+    
     /// add new region (section, user region or shdr/phdr table
     void addRegion(const ElfRegionTemplate<Types>& region);
     /// add new program header
@@ -898,6 +1027,15 @@ public:
     typename Types::Word getRegionOffset(cxuint i) const
     { return regionOffsets[i]; }
     
+    /// get index of dynamic symbol in generated dynamic symbol table
+    /** dynamic symbols are reordered if GNU hash table will be generated.
+     * Must be called after size counting.
+     * \param index index of dynamic symbol in adding order
+     * \return index in generated table (includes null symbol)
+     */
+    size_t getDynSymbolOutIndex(size_t index) const
+    { return hasGnuHash ? dynSymOutIndices[index] : index + addNullDynSym; }
+    
     /// generate binary
     void generate(FastOutputBuffer& fob);
     
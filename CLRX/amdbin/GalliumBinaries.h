@@ -467,6 +467,7 @@ class GalliumBinGenerator: public NonCopyableAndNonMovable
 private:
     bool manageable;
     const GalliumInput* input;
+    bool mergeStrings;
     
     void generateInternal(std::ostream* osPtr, std::vector<char>* vPtr,
              Array<cxbyte>* aPtr) const;
@@ -501,6 +502,10 @@ public:
     /// set input
     void setInput(const GalliumInput* input);
     
+    /// enable deduplication and suffix merging in ELF string tables
+    void setMergeStrings(bool merge)
+    { mergeStrings = merge; }
+    
     /// generates binary to array of bytes
     void generate(Array<cxbyte>& array) const;
     
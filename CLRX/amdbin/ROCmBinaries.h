@@ -240,6 +240,7 @@ private:
     size_t regionsNum;
     std::unique_ptr<ROCmRegion[]> regions;  ///< AMD metadatas
     RegionMap regionsMap;
+    Array<size_t> dynSymRegions; ///< region indices of dynamic symbols
     size_t codeSize;
     cxbyte* code;
     size_t globalDataSize;
@@ -407,7 +408,8 @@ enum: cxuint {
     ROCMSECTID_GPUCONFIG,
     ROCMSECTID_RELADYN,
     ROCMSECTID_GOT,
-    ROCMSECTID_MAX = ROCMSECTID_GOT
+    ROCMSECTID_GNUHASH,
+    ROCMSECTID_MAX = ROCMSECTID_GNUHASH
 };
 
 /// ROCm binary symbol input
@@ -463,6 +465,8 @@ private:
     private:
     bool manageable;
     const ROCmInput* input;
+    bool mergeStrings;
+    bool gnuHash;
     std::unique_ptr<ElfBinaryGen64> elfBinGen64;
     size_t binarySize;
     size_t commentSize;
@@ -479,9 +483,19 @@ private:
     void* rocmRelaDynGen;
     void* rocmLLVMGDataGen;
     Array<CString> kdescSymNames;
+    // code layout while binary generation (used by kernel patching)
+    size_t layoutCodeSize;
+    size_t layoutGlobalDataSize;
+    Array<size_t> layoutSymOffsets;
+    std::string layoutMetadata;
+    // kernel config fields and code properties which feed metadata of kernels
+    std::vector<uint64_t> layoutKernelMDFields;
     
     void generateInternal(std::ostream* osPtr, std::vector<char>* vPtr,
              Array<cxbyte>* aPtr);
+    void generateMetadata(std::string& mdStr, std::vector<cxbyte>& mdBytes);
+    bool isLayoutUnchanged() const;
+    bool isMetadataUnchanged(const ROCmSymbolInput& kernel) const;
 public:
     /// constructor
     ROCmBinGenerator();
@@ -517,6 +531,16 @@ public:
     /// set input
     void setInput(const ROCmInput* input);
     
+    /// enable deduplication and suffix merging in ELF string tables
+    void setMergeStrings(bool merge)
+    { mergeStrings = merge; }
+    
+    /// enable generation of GNU hash table (.gnu.hash) for dynamic symbols
+    /** dynamic symbols will be sorted by hash buckets and buckets number of
+     * SysV hash table (.hash) will be chosen as in GNU linker */
+    void setGnuHash(bool enable)
+    { gnuHash = enable; }
+    
     /// prepare binary generator (for section diffs)
     void prepareBinaryGen();
     /// get section offset (from main section)
@@ -534,6 +558,17 @@ public:
     
     /// generates binary to vector of char
     void generate(std::vector<char>& vector);
+    
+    /// patch kernel code and kernel descriptor in generated binary
+    /** copies kernel code (with kernel descriptor) from current input to binary
+     * that has been generated by this generator. If code size, global data size,
+     * symbol offsets or metadata (for example register counts) has been changed
+     * since generation, then binary will be fully regenerated.
+     * \param binary binary generated by this generator
+     * \param kernelName name of kernel to patch
+     * \return true if binary has been patched in place, false if regenerated
+     */
+    bool patchKernel(Array<cxbyte>& binary, const char* kernelName);
 };
 
 void generateROCmMetadata(const ROCmMetadata& mdInfo,
@@ -550,6 +585,17 @@ void parseROCmMetadataMsgPack(size_t metadataSize, const cxbyte* metadata,
 
 class MsgPackMapParser;
 
+/// view to string or byte-array in MsgPack data (data is not copied)
+struct MsgPackDataRef
+{
+    const cxbyte* data; ///< pointer to content in MsgPack data
+    size_t size;        ///< size in bytes
+    
+    /// get content as characters
+    const char* str() const
+    { return reinterpret_cast<const char*>(data); }
+};
+
 class MsgPackArrayParser
 {
 private:
@@ -566,6 +612,8 @@ public:
     double parseFloat();
     std::string parseString();
     Array<cxbyte> parseData();
+    MsgPackDataRef parseStringRef(); // returns view to string
+    MsgPackDataRef parseDataRef(); // returns view to byte-array
     MsgPackArrayParser parseArray();
     MsgPackMapParser parseMap();
     size_t end(); // return left elements
@@ -597,6 +645,8 @@ public:
     double parseKeyFloat();
     std::string parseKeyString();
     Array<cxbyte> parseKeyData();
+    MsgPackDataRef parseKeyStringRef();
+    MsgPackDataRef parseKeyDataRef();
     MsgPackArrayParser parseKeyArray();
     MsgPackMapParser parseKeyMap();
     void parseValueNil();
@@ -605,6 +655,8 @@ public:
     double parseValueFloat();
     std::string parseValueString();
     Array<cxbyte> parseValueData();
+    MsgPackDataRef parseValueStringRef();
+    MsgPackDataRef parseValueDataRef();
     MsgPackArrayParser parseValueArray();
     MsgPackMapParser parseValueMap();
     void skipValue();
@@ -28,6 +28,7 @@
 #include <iterator>
 #include <algorithm>
 #include <vector>
+#include <list>
 #include <utility>
 #include <unordered_map>
 #include <initializer_list>
@@ -497,63 +498,62 @@ void mapSort(Iter begin, Iter end, Comp comp)
 /** Simple cache **/
 
 /// Simple cache for object. object class should have a weight method
+/* LFU cache: entries are held in buckets with same usage, buckets are
+ * in list sorted by usage. use, put and eviction are done in constant time.
+ * between entries with this same usage, least recently used is evicted first. */
 template<typename K, typename V>
 class SimpleCache
 {
 private:
-    struct Entry
+    typedef std::list<K> KeyList;
+    struct UsageBucket
     {
-        size_t sortedPos;
         size_t usage;
+        KeyList keys;   // most recently used is first
+    };
+    typedef std::list<UsageBucket> BucketList;
+    
+    struct Entry
+    {
+        typename BucketList::iterator bucketIt;
+        typename KeyList::iterator keyIt;
         V value;
     };
     
     size_t totalWeight;
     size_t maxWeight;
     
-    typedef typename std::unordered_map<K, Entry>::iterator EntryMapIt;
-    // sorted entries - sorted by usage
-    std::vector<EntryMapIt> sortedEntries;
+    BucketList buckets; // sorted by usage
     std::unordered_map<K, Entry> entryMap;
     
-    void updateInSortedEntries(EntryMapIt it)
+    // move entry to bucket with next usage
+    void increaseUsage(Entry& entry)
     {
-        const size_t curPos = it->second.sortedPos;
-        if (curPos == 0)
-            return; // first position
-        if (sortedEntries[curPos-1]->second.usage < it->second.usage &&
-            (curPos==1 || sortedEntries[curPos-2]->second.usage >= it->second.usage))
-        {
-            //std::cout << "fast path" << std::endl;
-            std::swap(sortedEntries[curPos-1]->second.sortedPos, it->second.sortedPos);
-            std::swap(sortedEntries[curPos-1], sortedEntries[curPos]);
-            return;
-        }
-        //std::cout << "slow path" << std::endl;
-        auto fit = std::upper_bound(sortedEntries.begin(),
-            sortedEntries.begin()+it->second.sortedPos, it,
-            [](EntryMapIt it1, EntryMapIt it2)
-            { return it1->second.usage > it2->second.usage; });
-        if (fit != sortedEntries.begin()+it->second.sortedPos)
-        {
-            const size_t curPos = it->second.sortedPos;
-            std::swap((*fit)->second.sortedPos, it->second.sortedPos);
-            std::swap(*fit, sortedEntries[curPos]);
-        }
+        const auto curIt = entry.bucketIt;
+        auto nextIt = curIt;
+        ++nextIt;
+        if (nextIt == buckets.end() || nextIt->usage != curIt->usage+1)
+            nextIt = buckets.insert(nextIt, UsageBucket{ curIt->usage+1, KeyList() });
+        nextIt->keys.splice(nextIt->keys.begin(), curIt->keys, entry.keyIt);
+        entry.bucketIt = nextIt;
+        if (curIt->keys.empty())
+            buckets.erase(curIt);
     }
     
-    void insertToSortedEntries(EntryMapIt it)
+    void insertToBuckets(const K& key, Entry& entry)
     {
-        it->second.sortedPos = sortedEntries.size();
-        sortedEntries.push_back(it);
+        if (buckets.empty() || buckets.front().usage != 0)
+            buckets.push_front(UsageBucket{ 0, KeyList() });
+        buckets.front().keys.push_front(key);
+        entry.bucketIt = buckets.begin();
+        entry.keyIt = buckets.front().keys.begin();
     }
     
-    void removeFromSortedEntries(size_t pos)
+    void removeFromBuckets(Entry& entry)
     {
-        // update later element positioning
-        for (size_t i = pos+1; i < sortedEntries.size(); i++)
-            (sortedEntries[i]->second.sortedPos)--;
-        sortedEntries.erase(sortedEntries.begin() + pos);
+        entry.bucketIt->keys.erase(entry.keyIt);
+        if (entry.bucketIt->keys.empty())
+            buckets.erase(entry.bucketIt);
     }
     
 public:
@@ -567,8 +567,7 @@ public:
         auto it = entryMap.find(key);
         if (it != entryMap.end())
         {
-            it->second.usage++;
-            updateInSortedEntries(it);
+            increaseUsage(it->second);
             return &(it->second.value);
         }
         return nullptr;
@@ -581,13 +580,14 @@ public:
     /// put value
     void put(const K& key, const V& value)
     {
-        auto res = entryMap.insert({ key, Entry{ 0, 0, value } });
+        auto res = entryMap.insert({ key, Entry{ typename BucketList::iterator(),
+                    typename KeyList::iterator(), value } });
         if (!res.second)
         {
-            removeFromSortedEntries(res.first->second.sortedPos); // remove old value
+            removeFromBuckets(res.first->second); // remove old value
             // update value
             totalWeight -= res.first->second.value.weight();
-            res.first->second = Entry{ 0, 0, value };
+            res.first->second.value = value;
         }
         const size_t elemWeight = value.weight();
         
@@ -597,17 +597,28 @@ public:
         
         while (totalWeight+elemWeight > maxWeight)
         {
-            // remove min usage element
-            auto minUsageIt = sortedEntries.back();
-            sortedEntries.pop_back();
+            // remove least recently used from min usage elements
+            UsageBucket& minBucket = buckets.front();
+            auto minUsageIt = entryMap.find(minBucket.keys.back());
+            minBucket.keys.pop_back();
+            if (minBucket.keys.empty())
+                buckets.pop_front();
             totalWeight -= minUsageIt->second.value.weight();
             entryMap.erase(minUsageIt);
         }
         
-        insertToSortedEntries(res.first); // new entry in sorted entries
+        insertToBuckets(key, res.first->second); // new entry with zero usage
         
         totalWeight += elemWeight;
     }
+    
+    /// return number of entries
+    size_t size() const
+    { return entryMap.size(); }
+    
+    /// return total weight of entries
+    size_t weight() const
+    { return totalWeight; }
 };
 
 };
@@ -347,38 +347,66 @@ public:
 };
 
 /// fast and direct output buffer
+/** output buffer can write to output stream (through small buffer) or
+ * directly to preallocated memory (without any intermediate copying) */
 class FastOutputBuffer: public NonCopyableAndNonMovable
 {
 private:
-    std::ostream& os;
-    cxuint endPos;
-    cxuint bufSize;
-    std::unique_ptr<char[]> buffer;
+    std::ostream* os;
+    size_t endPos;
+    size_t bufSize;
+    std::unique_ptr<char[]> bufferHolder;
+    char* buffer;
     uint64_t written;
+    
+    // check whether space in direct output is enough
+    void checkDirectSpace(size_t toWrite) const
+    {
+        if (toWrite > bufSize-endPos)
+            throw Exception("Output memory overflow");
+    }
 public:
     /// constructor with inBufSize and output
     /**
      * \param _bufSize max buffer size
      * \param output output stream
      */
-    FastOutputBuffer(cxuint _bufSize, std::ostream& output) : os(output), endPos(0),
-            bufSize(_bufSize), buffer(new char[_bufSize]), written(0)
+    FastOutputBuffer(cxuint _bufSize, std::ostream& output) : os(&output), endPos(0),
+            bufSize(_bufSize), bufferHolder(new char[_bufSize]),
+            buffer(bufferHolder.get()), written(0)
+    { }
+    /// constructor with preallocated output memory (direct writing)
+    /**
+     * \param outSize size of output memory
+     * \param output output memory
+     */
+    FastOutputBuffer(size_t outSize, char* output) : os(nullptr), endPos(0),
+            bufSize(outSize), buffer(output), written(0)
     { }
     /// destructor
     ~FastOutputBuffer()
-    { 
-        flush();
-        os.flush();
+    {
+        if (os != nullptr)
+        {
+            flush();
+            os->flush();
+        }
     }
     
     /// get written bytes number
     uint64_t getWritten() const
     { return written; }
     
-    /// write output buffer
+    /// return true if buffer writes to output stream
+    bool hasOStream() const
+    { return os != nullptr; }
+    
+    /// write output buffer (do nothing if direct writing)
     void flush()
     {
-        os.write(buffer.get(), endPos);
+        if (os == nullptr)
+            return;
+        os->write(buffer, endPos);
         endPos = 0;
     }
     
@@ -386,8 +414,12 @@ public:
     char* reserve(cxuint toReserve)
     {
         if (toReserve > bufSize-endPos)
+        {
+            if (os == nullptr)
+                checkDirectSpace(toReserve);
             flush();
-        return buffer.get() + endPos;
+        }
+        return buffer + endPos;
     }
     
     /// finish reservation and go forward
@@ -402,12 +434,14 @@ public:
     {
         if (length > bufSize-endPos)
         {
+            if (os == nullptr)
+                checkDirectSpace(length);
             flush();
-            os.write(string, length);
+            os->write(string, length);
         }
         else
         {
-            ::memcpy(buffer.get()+endPos, string, length);
+            ::memcpy(buffer+endPos, string, length);
             endPos += length;
         }
         written += length;
@@ -431,7 +465,11 @@ public:
     void put(char c)
     {
         if (endPos == bufSize)
+        {
+            if (os == nullptr)
+                checkDirectSpace(1);
             flush();
+        }
         buffer[endPos++] = c;
         written++;
     }
@@ -439,11 +477,13 @@ public:
     /// fill (put num c character)
     void fill(size_t num, char c)
     {
+        if (os == nullptr)
+            checkDirectSpace(num);
         size_t count = num;
         while (count != 0)
         {
              size_t bufNum = std::min(size_t(bufSize-endPos), count);
-             ::memset(buffer.get()+endPos, c, bufNum);
+             ::memset(buffer+endPos, c, bufNum);
              count -= bufNum;
              endPos += bufNum;
              if (endPos == bufSize)
@@ -452,12 +492,12 @@ public:
         written += num;
     }
     
-    /// get output stream
+    /// get output stream (only if buffer writes to output stream)
     const std::ostream& getOStream() const
-    { return os; }
-    /// get output stream
+    { return *os; }
+    /// get output stream (only if buffer writes to output stream)
     std::ostream& getOStream()
-    { return os; }
+    { return *os; }
 };
 
 };
@@ -32,6 +32,7 @@
 #include <cstdint>
 #include <mutex>
 #include <atomic>
+#include <functional>
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
@@ -805,6 +806,17 @@ extern std::string findMesaOCL();
 /// find LLVM config, returns path if found, otherwise returns empty string
 extern std::string findLLVMConfig();
 
+/// run tasks in thread pool
+/** calls func(i) for every task (tasks must be independent). Calling thread is
+ * also worker. First exception thrown by task stops workers and it is rethrown
+ * after joining threads.
+ * \param tasksNum number of tasks
+ * \param threadsNum number of threads (0 - all hardware threads)
+ * \param func task function
+ */
+extern void runParallelTasks(size_t tasksNum, cxuint threadsNum,
+            const std::function<void(size_t)>& func);
+
 /*
  * Reference support
  */
@@ -1822,6 +1822,68 @@ bool AsmAmdCL2Handler::parsePseudoOp(const CString& firstName,
     return true;
 }
 
+void AsmAmdCL2Handler::updateAllocatedRegisters(AsmSectionId sectionId,
+                const cxuint* allocRegs)
+{
+    if (hsaLayout)
+    {
+        AsmKcodeHandler::updateAllocatedRegisters(sectionId, allocRegs);
+        return;
+    }
+    const AsmKernelId kernelId = sections[sectionId].kernelId;
+    if (kernelId == ASMKERN_GLOBAL || kernelId == ASMKERN_INNER ||
+        kernelStates[kernelId]->codeSection != sectionId)
+        return;
+    joinKernelAllocRegs(*kernelStates[kernelId], allocRegs);
+    // current registers state will be stored to current kernel
+    if (assembler.currentKernel == kernelId && assembler.currentSection == sectionId)
+        joinCurrentAllocRegs(allocRegs);
+}
+
+// get occupancy config from HSA config or from old config of kernel
+AsmFormatHandler::OccupancyConfig AsmAmdCL2Handler::getKernelOccupancyConfig(
+            AsmKernelId kernelId) const
+{
+    const AmdCL2KernelInput& kernel = output.kernels[kernelId];
+    const Kernel& kernelState = *kernelStates[kernelId];
+    if (kernelState.useHsaConfig)
+    {
+        const AsmAmdHsaKernelConfig& config = *kernelState.hsaConfig;
+        return getOccupancyConfig((config.workgroupGroupSegmentSize != BINGEN_DEFAULT) ?
+                config.workgroupGroupSegmentSize : 0, kernel.config.reqdWorkGroupSize,
+                ((config.enableSgprRegisterFlags&AMDHSAFLAG_USE_FLAT_SCRATCH_INIT)!=0 ?
+                        GCN_FLAT : 0) |
+                ((config.enableFeatureFlags&AMDHSAFLAG_USE_XNACK_ENABLED)!=0 ?
+                        GCN_XNACK : 0));
+    }
+    if (!kernel.useConfig)
+        return getOccupancyConfig(0, nullptr, 0);
+    // enqueue and generic pointers require FLAT_SCRATCH and XNACK_MASK
+    return getOccupancyConfig(kernel.config.localSize, kernel.config.reqdWorkGroupSize,
+            (kernel.config.useEnqueue || kernel.config.useGeneric) ?
+                    GCN_FLAT|GCN_XNACK : 0);
+}
+
+AsmFormatHandler::OccupancyConfig AsmAmdCL2Handler::getSectionOccupancyConfig(
+            AsmSectionId sectionId) const
+{
+    if (hsaLayout)
+    {
+        // all kernels share code section, hence join configs of all kernels
+        if (sectionId != codeSection || kernelStates.empty())
+            return getOccupancyConfig(0, nullptr, 0);
+        OccupancyConfig occConfig = getKernelOccupancyConfig(0);
+        for (size_t i = 1; i < kernelStates.size(); i++)
+            joinOccupancyConfig(occConfig, getKernelOccupancyConfig(i));
+        return occConfig;
+    }
+    const AsmKernelId kernelId = sections[sectionId].kernelId;
+    if (kernelId == ASMKERN_GLOBAL || kernelId == ASMKERN_INNER ||
+        kernelStates[kernelId]->codeSection != sectionId)
+        return getOccupancyConfig(0, nullptr, 0);
+    return getKernelOccupancyConfig(kernelId);
+}
+
 bool AsmAmdCL2Handler::prepareBinary()
 {
     bool good = true;
@@ -2362,11 +2424,13 @@ bool AsmAmdCL2Handler::resolveRelocation(const AsmExpression* expr, uint64_t& ou
 void AsmAmdCL2Handler::writeBinary(std::ostream& os) const
 {
     AmdCL2GPUBinGenerator binGenerator(&output);
+    binGenerator.setMergeStrings((assembler.flags & ASM_MERGESTRINGS) != 0);
     binGenerator.generate(os);
 }
 
 void AsmAmdCL2Handler::writeBinary(Array<cxbyte>& array) const
 {
     AmdCL2GPUBinGenerator binGenerator(&output);
+    binGenerator.setMergeStrings((assembler.flags & ASM_MERGESTRINGS) != 0);
     binGenerator.generate(array);
 }
@@ -1696,6 +1696,31 @@ bool AsmAmdHandler::parsePseudoOp(const CString& firstName,
     return true;
 }
 
+void AsmAmdHandler::updateAllocatedRegisters(AsmSectionId sectionId,
+                const cxuint* allocRegs)
+{
+    const AsmKernelId kernelId = sections[sectionId].kernelId;
+    if (kernelId == ASMKERN_GLOBAL ||
+        kernelStates[kernelId]->codeSection != sectionId)
+        return;
+    joinKernelAllocRegs(*kernelStates[kernelId], allocRegs);
+    // current registers state will be stored to current kernel
+    if (assembler.currentKernel == kernelId && assembler.currentSection == sectionId)
+        joinCurrentAllocRegs(allocRegs);
+}
+
+AsmFormatHandler::OccupancyConfig AsmAmdHandler::getSectionOccupancyConfig(
+            AsmSectionId sectionId) const
+{
+    const AsmKernelId kernelId = sections[sectionId].kernelId;
+    if (kernelId == ASMKERN_GLOBAL ||
+        kernelStates[kernelId]->codeSection != sectionId ||
+        !output.kernels[kernelId].useConfig)
+        return getOccupancyConfig(0, nullptr, 0);
+    const AmdKernelConfig& config = output.kernels[kernelId].config;
+    return getOccupancyConfig(config.hwLocalSize, config.reqdWorkGroupSize, 0);
+}
+
 bool AsmAmdHandler::prepareBinary()
 {
     if (assembler.isaAssembler!=nullptr)
@@ -1860,11 +1885,15 @@ bool AsmAmdHandler::prepareBinary()
 void AsmAmdHandler::writeBinary(std::ostream& os) const
 {
     AmdGPUBinGenerator binGenerator(&output);
+    binGenerator.setMergeStrings((assembler.flags & ASM_MERGESTRINGS) != 0);
+    binGenerator.setThreadsNum(assembler.threadsNum);
     binGenerator.generate(os);
 }
 
 void AsmAmdHandler::writeBinary(Array<cxbyte>& array) const
 {
     AmdGPUBinGenerator binGenerator(&output);
+    binGenerator.setMergeStrings((assembler.flags & ASM_MERGESTRINGS) != 0);
+    binGenerator.setThreadsNum(assembler.threadsNum);
     binGenerator.generate(array);
 }
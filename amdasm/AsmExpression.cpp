@@ -439,6 +439,8 @@ AsmTryStatus AsmExpression::tryEvaluate(Assembler& assembler, size_t opStart, si
         size_t opPos = 0;
         size_t messagePosIndex = 0;
         std::vector<RelMultiply> relatives;
+        // sections of relative arguments (with repetitions)
+        std::vector<AsmSectionId> argSections;
         
         // move messagePosIndex and argument position to opStart position
         for (opPos = 0; opPos < opStart; opPos++)
@@ -462,6 +464,7 @@ AsmTryStatus AsmExpression::tryEvaluate(Assembler& assembler, size_t opStart, si
                 {
                     uint64_t ovalue = args[argPos].relValue.value;
                     AsmSectionId osectId = args[argPos].relValue.sectionId;
+                    argSections.push_back(osectId);
                     if (sectDiffsPrepared && sections[osectId].relSpace!=UINT_MAX)
                     {
                         // resolve section in relspace
@@ -945,6 +948,23 @@ AsmTryStatus AsmExpression::tryEvaluate(Assembler& assembler, size_t opStart, si
             value += sections[sectionId].relAddress - sections[newSectionId].relAddress;
             sectionId = newSectionId;
         }
+        
+        /* if offsets in section are used by value of expression (not as single
+         * relative value), value will not be updated after inserting code to section */
+        if (!tryLater && !failed && !assembler.labelDiffsUpdated)
+            for (AsmSectionId argSectId: argSections)
+            {
+                AsmSection& section = assembler.sections[argSectId];
+                if (section.labelDiffs)
+                    continue;
+                if (std::count(argSections.begin(), argSections.end(), argSectId) > 1 ||
+                    relatives.size() != 1 || relatives.front().multiply != 1 ||
+                    relatives.front().sectionId != argSectId)
+                {
+                    section.labelDiffs = true;
+                    section.labelDiffPos = sourcePos;
+                }
+            }
     }
     if (tryLater)
         return AsmTryStatus::TRY_LATER;
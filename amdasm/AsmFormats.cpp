@@ -177,6 +177,57 @@ bool AsmFormatHandler::prepareSectionDiffsResolving()
     return false;
 }
 
+void AsmFormatHandler::updateAllocatedRegisters(AsmSectionId sectionId,
+                const cxuint* allocRegs)
+{ }
+
+void AsmFormatHandler::joinCurrentAllocRegs(const cxuint* allocRegs)
+{
+    size_t regTypesNum;
+    Flags regFlags;
+    const cxuint* curRegs = assembler.isaAssembler->getAllocatedRegisters(
+                regTypesNum, regFlags);
+    cxuint newRegs[MAX_REGTYPES_NUM];
+    for (size_t i = 0; i < regTypesNum; i++)
+        newRegs[i] = std::max(curRegs[i], allocRegs[i]);
+    assembler.isaAssembler->setAllocatedRegisters(newRegs, regFlags);
+}
+
+AsmFormatHandler::OccupancyConfig AsmFormatHandler::getOccupancyConfig(
+            size_t localSize, const uint32_t* reqdWorkGroupSize, Flags regFlags) const
+{
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(assembler.deviceType);
+    cxuint workGroupSize = 0;
+    if (reqdWorkGroupSize != nullptr && reqdWorkGroupSize[0] != 0 &&
+        reqdWorkGroupSize[1] != 0 && reqdWorkGroupSize[2] != 0)
+        workGroupSize = reqdWorkGroupSize[0]*reqdWorkGroupSize[1]*reqdWorkGroupSize[2];
+    return { localSize, workGroupSize,
+            getGPUExtraRegsNum(arch, REGTYPE_SGPR, regFlags|GCN_VCC) };
+}
+
+void AsmFormatHandler::joinOccupancyConfig(OccupancyConfig& dest,
+            const OccupancyConfig& src)
+{
+    dest.localSize = std::max(dest.localSize, src.localSize);
+    // zero work-group size is maximal size
+    if (dest.workGroupSize == 0 || (src.workGroupSize != 0 &&
+            src.workGroupSize < dest.workGroupSize))
+        dest.workGroupSize = src.workGroupSize;
+    dest.extraSGPRsNum = std::max(dest.extraSGPRsNum, src.extraSGPRsNum);
+}
+
+AsmFormatHandler::OccupancyConfig AsmFormatHandler::getSectionOccupancyConfig(
+            AsmSectionId sectionId) const
+{
+    return getOccupancyConfig(0, nullptr, 0);
+}
+
+void AsmFormatHandler::joinKernelAllocRegs(KernelBase& kernel, const cxuint* allocRegs)
+{
+    for (size_t i = 0; i < MAX_REGTYPES_NUM; i++)
+        kernel.allocRegs[i] = std::max(kernel.allocRegs[i], allocRegs[i]);
+}
+
 /* AsmKcodeHandler */
 
 AsmKcodeHandler::AsmKcodeHandler(Assembler& assembler) : AsmFormatHandler(assembler),
@@ -194,6 +245,19 @@ void AsmKcodeHandler::restoreKcodeCurrentAllocRegs()
     }
 }
 
+// all kernels share code section, hence update all kernels
+void AsmKcodeHandler::updateAllocatedRegisters(AsmSectionId sectionId,
+                const cxuint* allocRegs)
+{
+    if (sectionId != codeSection)
+        return;
+    const size_t kernelsNum = getKernelsNum();
+    for (size_t i = 0; i < kernelsNum; i++)
+        joinKernelAllocRegs(getKernelBase(i), allocRegs);
+    // current registers state will be stored to current kernel
+    joinCurrentAllocRegs(allocRegs);
+}
+
 void AsmKcodeHandler::saveKcodeCurrentAllocRegs()
 {
     if (currentKcodeKernel != ASMKERN_GLOBAL)
@@ -330,6 +330,31 @@ bool AsmGalliumHandler::isCodeSection() const
     return sections[assembler.currentSection].type == AsmSectionType::CODE;
 }
 
+// all kernels share code section, hence join configs of all kernels
+AsmFormatHandler::OccupancyConfig AsmGalliumHandler::getSectionOccupancyConfig(
+            AsmSectionId sectionId) const
+{
+    OccupancyConfig occConfig = getOccupancyConfig(0, nullptr, 0);
+    if (sectionId != codeSection)
+        return occConfig;
+    for (size_t i = 0; i < kernelStates.size(); i++)
+    {
+        const AsmAmdHsaKernelConfig* hsaConfig = kernelStates[i]->hsaConfig.get();
+        if (hsaConfig != nullptr)
+            joinOccupancyConfig(occConfig, getOccupancyConfig(
+                (hsaConfig->workgroupGroupSegmentSize != BINGEN_DEFAULT) ?
+                        hsaConfig->workgroupGroupSegmentSize : 0, nullptr,
+                ((hsaConfig->enableSgprRegisterFlags&
+                        AMDHSAFLAG_USE_FLAT_SCRATCH_INIT)!=0 ? GCN_FLAT : 0) |
+                ((hsaConfig->enableFeatureFlags&AMDHSAFLAG_USE_XNACK_ENABLED)!=0 ?
+                        GCN_XNACK : 0)));
+        else if (output.kernels[i].useConfig)
+            joinOccupancyConfig(occConfig, getOccupancyConfig(
+                    output.kernels[i].config.localSize, nullptr, 0));
+    }
+    return occConfig;
+}
+
 AsmKcodeHandler::KernelBase& AsmGalliumHandler::getKernelBase(AsmKernelId index)
 { return *kernelStates[index]; }
 
@@ -1876,11 +1901,13 @@ bool AsmGalliumHandler::prepareBinary()
 void AsmGalliumHandler::writeBinary(std::ostream& os) const
 {
     GalliumBinGenerator binGenerator(&output);
+    binGenerator.setMergeStrings((assembler.flags & ASM_MERGESTRINGS) != 0);
     binGenerator.generate(os);
 }
 
 void AsmGalliumHandler::writeBinary(Array<cxbyte>& array) const
 {
     GalliumBinGenerator binGenerator(&output);
+    binGenerator.setMergeStrings((assembler.flags & ASM_MERGESTRINGS) != 0);
     binGenerator.generate(array);
 }
@@ -23,8 +23,10 @@
 #include <CLRX/Config.h>
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <unordered_set>
 #include <utility>
+#include <algorithm>
 #include <memory>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/amdasm/Assembler.h>
@@ -326,6 +328,16 @@ struct CLRX_INTERNAL AsmPseudoOps: AsmParseUtils
     static void doEnum(Assembler& asmr, const char* linePtr);
     // set policy version
     static void setPolicyVersion(Assembler& asmr, const char* linePtr);
+    // enable register allocation (with optional target occupancy)
+    static void enableRegAlloc(Assembler& asmr, const char* linePtr);
+    // enable insertion of waits for results of delayed operations
+    static void setAutoWait(Assembler& asmr, const char* linePtr, bool enable);
+    // enable checking waits (warnings) or relaxing waits
+    static void enableCheckWaits(Assembler& asmr, const char* linePtr, bool relax);
+    // enable instruction scheduling
+    static void enableSchedule(Assembler& asmr, const char* linePtr);
+    // set LDS window for spilled VGPRs
+    static void setSpillLds(Assembler& asmr, const char* linePtr);
     
     static void ignoreString(Assembler& asmr, const char* linePtr);
     
@@ -382,6 +394,49 @@ extern CLRX_INTERNAL cxbyte cstrtobyte(const char*& str, const char* end);
 
 extern const cxbyte tokenCharTable[96] CLRX_INTERNAL;
 
+// code inserted before and after single instruction
+struct CLRX_INTERNAL AsmInstrCodeInsert
+{
+    size_t offset;  // offset of instruction
+    size_t size;    // size of instruction
+    size_t beforeInstrsNum; // number of instructions before instruction
+    size_t afterInstrsNum;  // number of instructions after instruction
+    bool removeInstr;   // if true, instruction is removed
+};
+
+/* assemble code text (instructions of inserts in order) and insert it to section.
+ * offsets in section data (code flow, usages, waits, source positions) are updated.
+ * Inserted code is not included in section data, data of removed instructions
+ * are removed. Errors have offsets in changed section (SIZE_MAX if unknown) */
+extern CLRX_INTERNAL bool insertCodeToSection(ISAAssembler* isaAsm,
+        GPUDeviceType deviceType, bool wave32, AsmSection& section,
+        const std::string& codeText, const std::vector<AsmInstrCodeInsert>& inserts,
+        AsmCodeOffsetMap& offsetMap,
+        std::vector<std::pair<size_t, std::string> >& errorMessages);
+
+// code section or part of code section (code of kernels) processed by single task
+struct CLRX_INTERNAL AsmCodePart
+{
+    AsmSectionId sectionId;
+    AsmSection* section;    // section or its part
+    size_t start;   // offset of part in section
+};
+
+/* split code section to parts at split offsets (sorted, inside code). Offsets of
+ * section data are relative to start of part. Data at split offset belongs
+ * to next part, except end of code flow. Alignments of code are not copied */
+extern CLRX_INTERNAL void splitCodeSection(ISAAssembler* isaAsm, AsmSection& section,
+        const std::vector<size_t>& splitOffsets, std::vector<AsmSection>& parts);
+
+/* join parts of code section (after splitCodeSection) and fill offset map by
+ * offset maps of parts. Alignments of code are moved to new offsets */
+extern CLRX_INTERNAL void joinCodeSection(ISAAssembler* isaAsm, AsmSection& section,
+        const std::vector<size_t>& splitOffsets, std::vector<AsmSection>& parts,
+        const std::vector<AsmCodeOffsetMap>& partOffsetMaps, AsmCodeOffsetMap& offsetMap);
+
+// write string as JSON string (with escaping), null if string is null
+extern CLRX_INTERNAL void writeJSONString(std::ostream& os, const char* str);
+
 };
 
 #endif
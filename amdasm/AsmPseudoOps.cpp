@@ -85,10 +85,10 @@ enum
 static const char* pseudoOpNamesTbl[] =
 {
     "32bit", "64bit", "abort", "align", "altmacro",
-    "amd", "amd3", "amdcl2", "arch", "ascii", "asciz",
+    "amd", "amd3", "amdcl2", "arch", "ascii", "asciz", "autowait",
     "balign", "balignl", "balignw", "buggyfplit", "byte",
     "cf_call", "cf_cjump", "cf_end",
-    "cf_jump", "cf_ret", "cf_start",
+    "cf_jump", "cf_ret", "cf_start", "checkwaits",
     "data", "double", "else",
     "elseif", "elseif32", "elseif64",
     "elseifarch", "elseifb", "elseifc", "elseifdef",
@@ -111,14 +111,15 @@ static const char* pseudoOpNamesTbl[] =
     "ifne", "ifnes", "ifnfmt", "ifngpu", "ifnotdef", "incbin",
     "include", "int", "irp", "irpc", "kernel", "lflags",
     "line", "ln", "local", "long",
-    "macro", "macrocase", "main", "noaltmacro",
-    "nobuggyfplit", "nomacrocase", "nooldmodparam",
-    "nowave32", "octa", "offset", "oldmodparam", "org",
+    "macro", "macrocase", "main", "noaltmacro", "noautowait",
+    "nobuggyfplit", "nocheckwaits", "nomacrocase", "nooldmodparam", "noregalloc",
+    "norelaxwaits", "noschedule", "noshrink", "nowave32",
+    "octa", "offset", "oldmodparam", "org",
     "p2align", "policy", "print", "purgem", "quad",
-    "rawcode", "regvar", "rept", "rocm", "rodata",
-    "rvlin", "rvlin_once", "sbttl", "scope", "section", "set",
-    "short", "single", "size", "skip",
-    "space", "string", "string16", "string32",
+    "rawcode", "regalloc", "regvar", "relaxwaits", "rept", "rocm", "rodata",
+    "rvlin", "rvlin_once", "sbttl", "schedule", "scope", "section", "set",
+    "short", "shrink", "single", "size", "skip",
+    "space", "spill_lds", "string", "string16", "string32",
     "string64", "struct", "text", "title",
     "undef", "unusing", "usereg", "using", "version",
     "warning", "wave32", "weak", "while", "word"
@@ -129,9 +130,10 @@ enum
 {
     ASMOP_32BIT = 0, ASMOP_64BIT, ASMOP_ABORT, ASMOP_ALIGN, ASMOP_ALTMACRO,
     ASMOP_AMD, ASMOP_AMD3, ASMOP_AMDCL2, ASMOP_ARCH, ASMOP_ASCII, ASMOP_ASCIZ,
+    ASMOP_AUTOWAIT,
     ASMOP_BALIGN, ASMOP_BALIGNL, ASMOP_BALIGNW, ASMOP_BUGGYFPLIT, ASMOP_BYTE,
     ASMOP_CF_CALL, ASMOP_CF_CJUMP, ASMOP_CF_END,
-    ASMOP_CF_JUMP, ASMOP_CF_RET, ASMOP_CF_START,
+    ASMOP_CF_JUMP, ASMOP_CF_RET, ASMOP_CF_START, ASMOP_CHECKWAITS,
     ASMOP_DATA, ASMOP_DOUBLE, ASMOP_ELSE,
     ASMOP_ELSEIF, ASMOP_ELSEIF32, ASMOP_ELSEIF64,
     ASMOP_ELSEIFARCH, ASMOP_ELSEIFB, ASMOP_ELSEIFC, ASMOP_ELSEIFDEF,
@@ -154,14 +156,17 @@ enum
     ASMOP_IFNE, ASMOP_IFNES, ASMOP_IFNFMT, ASMOP_IFNGPU, ASMOP_IFNOTDEF, ASMOP_INCBIN,
     ASMOP_INCLUDE, ASMOP_INT, ASMOP_IRP, ASMOP_IRPC, ASMOP_KERNEL, ASMOP_LFLAGS,
     ASMOP_LINE, ASMOP_LN, ASMOP_LOCAL, ASMOP_LONG,
-    ASMOP_MACRO, ASMOP_MACROCASE, ASMOP_MAIN, ASMOP_NOALTMACRO,
-    ASMOP_NOBUGGYFPLIT, ASMOP_NOMACROCASE, ASMOP_NOOLDMODPARAM,
+    ASMOP_MACRO, ASMOP_MACROCASE, ASMOP_MAIN, ASMOP_NOALTMACRO, ASMOP_NOAUTOWAIT,
+    ASMOP_NOBUGGYFPLIT, ASMOP_NOCHECKWAITS, ASMOP_NOMACROCASE, ASMOP_NOOLDMODPARAM,
+    ASMOP_NOREGALLOC, ASMOP_NORELAXWAITS, ASMOP_NOSCHEDULE, ASMOP_NOSHRINK,
     ASMOP_NOWAVE32, ASMOP_OCTA, ASMOP_OFFSET, ASMOP_OLDMODPARAM, ASMOP_ORG,
     ASMOP_P2ALIGN, ASMOP_POLICY, ASMOP_PRINT, ASMOP_PURGEM, ASMOP_QUAD,
-    ASMOP_RAWCODE, ASMOP_REGVAR, ASMOP_REPT, ASMOP_ROCM, ASMOP_RODATA,
-    ASMOP_RVLIN, ASMOP_RVLIN_ONCE, ASMOP_SBTTL, ASMOP_SCOPE, ASMOP_SECTION, ASMOP_SET,
-    ASMOP_SHORT, ASMOP_SINGLE, ASMOP_SIZE, ASMOP_SKIP,
-    ASMOP_SPACE, ASMOP_STRING, ASMOP_STRING16, ASMOP_STRING32,
+    ASMOP_RAWCODE, ASMOP_REGALLOC, ASMOP_REGVAR, ASMOP_RELAXWAITS,
+    ASMOP_REPT, ASMOP_ROCM, ASMOP_RODATA,
+    ASMOP_RVLIN, ASMOP_RVLIN_ONCE, ASMOP_SBTTL, ASMOP_SCHEDULE,
+    ASMOP_SCOPE, ASMOP_SECTION, ASMOP_SET,
+    ASMOP_SHORT, ASMOP_SHRINK, ASMOP_SINGLE, ASMOP_SIZE, ASMOP_SKIP,
+    ASMOP_SPACE, ASMOP_SPILL_LDS, ASMOP_STRING, ASMOP_STRING16, ASMOP_STRING32,
     ASMOP_STRING64, ASMOP_STRUCT, ASMOP_TEXT, ASMOP_TITLE,
     ASMOP_UNDEF, ASMOP_UNUSING, ASMOP_USEREG, ASMOP_USING, ASMOP_VERSION,
     ASMOP_WARNING, ASMOP_WAVE32, ASMOP_WEAK, ASMOP_WHILE, ASMOP_WORD
@@ -229,6 +234,9 @@ void Assembler::parsePseudoOps(const CString& firstName,
         case ASMOP_ASCIZ:
             AsmPseudoOps::putStrings(*this, stmtPlace, linePtr, true);
             break;
+        case ASMOP_AUTOWAIT:
+            AsmPseudoOps::setAutoWait(*this, linePtr, true);
+            break;
         case ASMOP_BALIGNL:
             AsmPseudoOps::doAlignWord<uint32_t>(*this, stmtPlace, linePtr);
             break;
@@ -297,6 +305,9 @@ void Assembler::parsePseudoOps(const CString& firstName,
             AsmPseudoOps::addCodeFlowEntries(*this, stmtPlace, linePtr,
                                   AsmCodeFlowType::START);
             break;
+        case ASMOP_CHECKWAITS:
+            AsmPseudoOps::enableCheckWaits(*this, linePtr, false);
+            break;
         case ASMOP_DATA:
             AsmPseudoOps::goToSection(*this, stmtPlace, stmtPlace, true);
             break;
@@ -599,10 +610,17 @@ void Assembler::parsePseudoOps(const CString& firstName,
             if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
                 alternateMacro = false;
             break;
+        case ASMOP_NOAUTOWAIT:
+            AsmPseudoOps::setAutoWait(*this, linePtr, false);
+            break;
         case ASMOP_NOBUGGYFPLIT:
             if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
                 buggyFPLit = false;
             break;
+        case ASMOP_NOCHECKWAITS:
+            if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
+                checkWaits = false;
+            break;
         case ASMOP_NOMACROCASE:
             if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
                 macroCase = false;
@@ -611,6 +629,22 @@ void Assembler::parsePseudoOps(const CString& firstName,
             if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
                 oldModParam = false;
             break;
+        case ASMOP_NOREGALLOC:
+            if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
+                regAlloc = false;
+            break;
+        case ASMOP_NORELAXWAITS:
+            if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
+                relaxWaits = false;
+            break;
+        case ASMOP_NOSCHEDULE:
+            if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
+                schedule = false;
+            break;
+        case ASMOP_NOSHRINK:
+            if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
+                shrink = false;
+            break;
         case ASMOP_NOWAVE32:
             if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
             {
@@ -647,9 +681,15 @@ void Assembler::parsePseudoOps(const CString& firstName,
         case ASMOP_QUAD:
             AsmPseudoOps::putIntegers<uint64_t>(*this, stmtPlace, linePtr);
             break;
+        case ASMOP_REGALLOC:
+            AsmPseudoOps::enableRegAlloc(*this, linePtr);
+            break;
         case ASMOP_REGVAR:
             AsmPseudoOps::defRegVar(*this, linePtr);
             break;
+        case ASMOP_RELAXWAITS:
+            AsmPseudoOps::enableCheckWaits(*this, linePtr, true);
+            break;
         case ASMOP_REPT:
             AsmPseudoOps::doRepeat(*this, stmtPlace, linePtr);
             break;
@@ -662,6 +702,9 @@ void Assembler::parsePseudoOps(const CString& firstName,
         case ASMOP_RVLIN_ONCE:
             AsmPseudoOps::declareRegVarLinearDeps(*this, linePtr, true);
             break;
+        case ASMOP_SCHEDULE:
+            AsmPseudoOps::enableSchedule(*this, linePtr);
+            break;
         case ASMOP_SCOPE:
             AsmPseudoOps::openScope(*this, stmtPlace, linePtr);
             break;
@@ -671,6 +714,10 @@ void Assembler::parsePseudoOps(const CString& firstName,
         case ASMOP_SHORT:
             AsmPseudoOps::putIntegers<uint16_t>(*this, stmtPlace, linePtr);
             break;
+        case ASMOP_SHRINK:
+            if (AsmPseudoOps::checkGarbagesAtEnd(*this, linePtr))
+                shrink = true;
+            break;
         case ASMOP_SINGLE:
             AsmPseudoOps::putFloats<uint32_t>(*this, stmtPlace, linePtr);
             break;
@@ -681,6 +728,9 @@ void Assembler::parsePseudoOps(const CString& firstName,
         case ASMOP_SPACE:
             AsmPseudoOps::doSkip(*this, stmtPlace, linePtr);
             break;
+        case ASMOP_SPILL_LDS:
+            AsmPseudoOps::setSpillLds(*this, linePtr);
+            break;
         case ASMOP_STRING:
             AsmPseudoOps::putStrings(*this, stmtPlace, linePtr, true);
             break;
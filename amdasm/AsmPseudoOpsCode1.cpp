@@ -826,9 +826,11 @@ void AsmPseudoOps::setSymbolSize(Assembler& asmr, const char* linePtr)
         ASM_NOTGOOD_BY_ERROR(symNamePlace, "Expected symbol name")
     if (!skipRequiredComma(asmr, linePtr))
         return;
-    // parse size
+    // parse size (sizes are updated after inserting code)
     uint64_t size;
+    asmr.labelDiffsUpdated = true;
     good &= getAbsoluteValueArg(asmr, size, linePtr, true);
+    asmr.labelDiffsUpdated = false;
     bool ignore = false;
     if (symEntry != nullptr)
     {
@@ -1055,6 +1057,12 @@ void AsmPseudoOps::doAlign(Assembler& asmr, const char* pseudoOpPlace,
     if (asmr.currentSection==ASMSECT_ABS && value != 0)
         asmr.printWarning(valuePlace, "Fill value is ignored inside absolute section");
     
+    if (asmr.currentSection!=ASMSECT_ABS &&
+        asmr.sections[asmr.currentSection].type == AsmSectionType::CODE)
+        // remember alignment to recalculate padding after inserting code
+        asmr.sections[asmr.currentSection].codeAlignments.push_back({ size_t(outPos),
+                size_t(bytesToFill), alignment, maxAlign, haveValue, cxbyte(value) });
+    
     if (haveValue || asmr.sections[asmr.currentSection].type != AsmSectionType::CODE)
         asmr.reserveData(bytesToFill, value&0xff);
     else /* only if no value and is code section */
@@ -2267,6 +2275,128 @@ void AsmPseudoOps::setPolicyVersion(Assembler& asmr, const char* linePtr)
     asmr.setPolicyVersion(value);
 }
 
+void AsmPseudoOps::enableRegAlloc(Assembler& asmr, const char* linePtr)
+{
+    const char* end = asmr.line + asmr.lineSize;
+    skipSpacesToEnd(linePtr, end);
+    uint64_t value = asmr.targetOccupancy;
+    const char* valuePlace = linePtr;
+    if (linePtr != end)
+    {
+        // target occupancy (waves per SIMD)
+        if (!getAbsoluteValueArg(asmr, value, linePtr, true))
+            return;
+        if (value == 0)
+            ASM_RETURN_BY_ERROR(valuePlace, "Target occupancy must be non-zero")
+        asmr.printWarningForRange(sizeof(cxuint)*8, value,
+                    asmr.getSourcePos(valuePlace), WS_UNSIGNED);
+    }
+    if (!checkGarbagesAtEnd(asmr, linePtr))
+        return;
+    // register usages are collected only while register allocation is enabled
+    if (!asmr.regAlloc)
+        for (const AsmSection& section: asmr.sections)
+            if (section.type == AsmSectionType::CODE && !section.content.empty())
+                ASM_RETURN_BY_ERROR(valuePlace, "Register allocation must be enabled "
+                        "before code")
+    asmr.regAlloc = true;
+    asmr.targetOccupancy = value;
+    // source positions for error messages
+    asmr.collectSourcePoses = true;
+}
+
+void AsmPseudoOps::setAutoWait(Assembler& asmr, const char* linePtr, bool enable)
+{
+    const char* end = asmr.line + asmr.lineSize;
+    skipSpacesToEnd(linePtr, end);
+    const char* place = linePtr;
+    if (!checkGarbagesAtEnd(asmr, linePtr))
+        return;
+    // waits are inserted to whole code sections, hence mode can not be changed
+    // after code
+    for (const AsmSection& section: asmr.sections)
+        if (section.type == AsmSectionType::CODE && !section.content.empty())
+            ASM_RETURN_BY_ERROR(place, enable ?
+                    "Automatic waits must be enabled before code" :
+                    "Automatic waits must be disabled before code")
+    asmr.autoWait = enable;
+    // source positions for error messages
+    asmr.collectSourcePoses |= enable;
+}
+
+void AsmPseudoOps::enableCheckWaits(Assembler& asmr, const char* linePtr, bool relax)
+{
+    const char* end = asmr.line + asmr.lineSize;
+    skipSpacesToEnd(linePtr, end);
+    const char* place = linePtr;
+    if (!checkGarbagesAtEnd(asmr, linePtr))
+        return;
+    // warnings require source positions, relaxing requires delayed ops
+    const bool collected = relax ? (asmr.autoWait || asmr.regAlloc ||
+                asmr.checkWaits || asmr.relaxWaits || asmr.schedule) :
+                asmr.collectSourcePoses;
+    if (!collected)
+        for (const AsmSection& section: asmr.sections)
+            if (section.type == AsmSectionType::CODE && !section.content.empty())
+                ASM_RETURN_BY_ERROR(place, relax ?
+                        "Relaxing waits must be enabled before code" :
+                        "Checking waits must be enabled before code")
+    if (relax)
+        asmr.relaxWaits = true;
+    else
+    {
+        asmr.checkWaits = true;
+        asmr.collectSourcePoses = true;
+    }
+}
+
+void AsmPseudoOps::enableSchedule(Assembler& asmr, const char* linePtr)
+{
+    const char* end = asmr.line + asmr.lineSize;
+    skipSpacesToEnd(linePtr, end);
+    const char* place = linePtr;
+    if (!checkGarbagesAtEnd(asmr, linePtr))
+        return;
+    // scheduler requires register usages and delayed ops of all instructions
+    if (!asmr.schedule && !asmr.autoWait && !asmr.regAlloc &&
+        !asmr.checkWaits && !asmr.relaxWaits)
+        for (const AsmSection& section: asmr.sections)
+            if (section.type == AsmSectionType::CODE && !section.content.empty())
+                ASM_RETURN_BY_ERROR(place, "Scheduling must be enabled before code")
+    asmr.schedule = true;
+}
+
+void AsmPseudoOps::setSpillLds(Assembler& asmr, const char* linePtr)
+{
+    const char* end = asmr.line + asmr.lineSize;
+    asmr.initializeOutputFormat();
+    skipSpacesToEnd(linePtr, end);
+    const char* regPlace = linePtr;
+    cxuint regStart, regEnd;
+    const AsmRegVar* regVar;
+    if (!asmr.isaAssembler->parseRegisterRange(linePtr, regStart, regEnd, regVar))
+        return;
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    size_t regTypesNum;
+    asmr.isaAssembler->getRegisterRanges(regTypesNum, regRanges);
+    if (regVar != nullptr || regEnd-regStart != 1 ||
+        regStart < regRanges[2*REGTYPE_VGPR] || regStart >= regRanges[2*REGTYPE_VGPR+1])
+        ASM_RETURN_BY_ERROR(regPlace, "Expected single VGPR")
+    if (!skipRequiredComma(asmr, linePtr))
+        return;
+    skipSpacesToEnd(linePtr, end);
+    const char* stridePlace = linePtr;
+    uint64_t stride = 0;
+    if (!getAbsoluteValueArg(asmr, stride, linePtr, true))
+        return;
+    if (stride == 0 || stride > 0xffff)
+        ASM_RETURN_BY_ERROR(stridePlace, "Stride must be in range 1-65535")
+    if (!checkGarbagesAtEnd(asmr, linePtr))
+        return;
+    asmr.spillLdsReg = regStart;
+    asmr.spillLdsStride = stride;
+}
+
 void AsmPseudoOps::ignoreString(Assembler& asmr, const char* linePtr)
 {
     const char* end = asmr.line+asmr.lineSize;
@@ -338,6 +338,34 @@ bool AsmROCmHandler::isCodeSection() const
     return sections[assembler.currentSection].type == AsmSectionType::CODE;
 }
 
+// all kernels share code section, hence join configs of all kernels
+AsmFormatHandler::OccupancyConfig AsmROCmHandler::getSectionOccupancyConfig(
+            AsmSectionId sectionId) const
+{
+    OccupancyConfig occConfig = getOccupancyConfig(0, nullptr, 0);
+    if (sectionId != codeSection)
+        return occConfig;
+    for (size_t i = 0; i < kernelStates.size(); i++)
+    {
+        const ROCmKernelConfig* config = kernelStates[i]->config.get();
+        if (config == nullptr)
+            continue;
+        const uint32_t* reqdWorkGroupSize = (output.useMetadataInfo &&
+                i < output.metadataInfo.kernels.size()) ?
+                output.metadataInfo.kernels[i].reqdWorkGroupSize : nullptr;
+        joinOccupancyConfig(occConfig, getOccupancyConfig(
+                (config->workgroupGroupSegmentSize != BINGEN_DEFAULT) ?
+                        config->workgroupGroupSegmentSize : 0, reqdWorkGroupSize,
+                ((config->enableSgprRegisterFlags&ROCMFLAG_USE_FLAT_SCRATCH_INIT)!=0 ?
+                        GCN_FLAT : 0) |
+                ((config->enableFeatureFlags&ROCMFLAG_USE_XNACK_ENABLED)!=0 ?
+                        GCN_XNACK : 0) |
+                ((config->enableSgprRegisterFlags&ROCMFLAG_USE_WAVE32)!=0 ?
+                        GCN_REG_WAVE32 : 0)));
+    }
+    return occConfig;
+}
+
 AsmKcodeHandler::KernelBase& AsmROCmHandler::getKernelBase(AsmKernelId index)
 { return *kernelStates[index]; }
 
@@ -2712,6 +2740,7 @@ bool AsmROCmHandler::prepareSectionDiffsResolving()
     if (good)
     {
         binGen.reset(new ROCmBinGenerator(&output));
+        binGen->setMergeStrings((assembler.flags & ASM_MERGESTRINGS) != 0);
         binGen->prepareBinaryGen();
         
         // add relSpacesSections
@@ -19,17 +19,20 @@
 
 #include <CLRX/Config.h>
 #include <assert.h>
+#include <cstdio>
 #include <iostream>
 #include <cstddef>
 #include <stack>
 #include <deque>
 #include <vector>
 #include <utility>
+#include <iterator>
 #include <unordered_set>
 #include <map>
 #include <set>
 #include <unordered_map>
 #include <algorithm>
+#include <cmath>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/amdasm/Assembler.h>
@@ -142,12 +145,16 @@ ISALinearDepHandler* ISALinearDepHandler::copy() const
  * Asm register allocator stuff
  */
 
-AsmRegAllocator::AsmRegAllocator(Assembler& _assembler) : assembler(_assembler)
+AsmRegAllocator::AsmRegAllocator(Assembler& _assembler) : assembler(_assembler),
+        regTypesNum(0), allocRegsNums(), coalescedMovesNum(0), removedMovesNum(0),
+        regsNumLimits(), spillLdsReg(UINT_MAX), spillLdsStride(0), spilledRegsNums()
 { }
 
 AsmRegAllocator::AsmRegAllocator(Assembler& _assembler,
         const std::vector<CodeBlock>& _codeBlocks, const SSAReplacesMap& _ssaReplacesMap)
-        : assembler(_assembler), codeBlocks(_codeBlocks), ssaReplacesMap(_ssaReplacesMap)
+        : assembler(_assembler), codeBlocks(_codeBlocks), ssaReplacesMap(_ssaReplacesMap),
+          regTypesNum(0), allocRegsNums(), coalescedMovesNum(0), removedMovesNum(0),
+          regsNumLimits(), spillLdsReg(UINT_MAX), spillLdsStride(0), spilledRegsNums()
 { }
 
 static inline bool codeBlockStartLess(const AsmRegAllocator::CodeBlock& c1,
@@ -567,60 +574,446 @@ void AsmRegAllocator::applySSAReplaces()
     ssaReplacesMap.clear();
 }
 
+void AsmRegAllocator::InterGraph::clear()
+{
+    nodesNum = rowWords = 0;
+    bitMatrix.clear();
+    adjStarts.clear();
+    adjNodes.clear();
+}
+
+void AsmRegAllocator::InterGraph::build(size_t inNodesNum,
+                const Array<OutLiveness>& livenesses)
+{
+    clear();
+    nodesNum = inNodesNum;
+    // events: first - position*2 (end) or position*2+1 (start), second - node
+    // ends at same position are before starts (ranges are half-open)
+    std::vector<std::pair<size_t, size_t> > events;
+    for (size_t li = 0; li < livenesses.size(); li++)
+        for (const std::pair<size_t, size_t>& blk: livenesses[li])
+            if (blk.first < blk.second)
+            {
+                events.push_back({ blk.first*2+1, li });
+                events.push_back({ blk.second*2, li });
+            }
+    std::sort(events.begin(), events.end());
+    
+    // active nodes and their positions in active list
+    std::vector<size_t> active;
+    Array<size_t> activePos(nodesNum);
+    Array<size_t> activeCounts(nodesNum);
+    std::fill(activeCounts.begin(), activeCounts.end(), size_t(0));
+    
+    /* edges are collected as pairs (lesser node, greater node) until pairs
+     * take more memory than bit-matrix, and then they are moved to bit-matrix */
+    std::vector<std::pair<size_t, size_t> > edges;
+    const size_t matrixSize = nodesNum*((nodesNum+63)>>6);
+    const size_t maxEdgesNum = (matrixSize*sizeof(uint64_t)) /
+                sizeof(std::pair<size_t, size_t>);
+    
+    for (const std::pair<size_t, size_t>& event: events)
+    {
+        const size_t node = event.second;
+        if ((event.first&1) == 0)
+        {
+            // end of range, remove from active list
+            if (--activeCounts[node] != 0)
+                continue;
+            const size_t pos = activePos[node];
+            active[pos] = active.back();
+            activePos[active[pos]] = pos;
+            active.pop_back();
+            continue;
+        }
+        // start of range
+        if (activeCounts[node]++ != 0)
+            continue;
+        if (rowWords == 0)
+        {
+            for (size_t other: active)
+                edges.push_back({ std::min(node, other), std::max(node, other) });
+            if (edges.size() > maxEdgesNum)
+                moveEdgesToBitMatrix(edges); // switch to bit-matrix
+        }
+        else
+            for (size_t other: active)
+            {
+                bitMatrix[node*rowWords + (other>>6)] |= 1ULL<<(other&63);
+                bitMatrix[other*rowWords + (node>>6)] |= 1ULL<<(node&63);
+            }
+        activePos[node] = active.size();
+        active.push_back(node);
+    }
+    createAdjacencyLists(edges);
+}
+
+void AsmRegAllocator::InterGraph::moveEdgesToBitMatrix(
+                std::vector<std::pair<size_t, size_t> >& edges)
+{
+    rowWords = (nodesNum+63)>>6;
+    bitMatrix.resize(nodesNum*rowWords);
+    std::fill(bitMatrix.begin(), bitMatrix.end(), uint64_t(0));
+    for (const std::pair<size_t, size_t>& e: edges)
+    {
+        bitMatrix[e.first*rowWords + (e.second>>6)] |= 1ULL<<(e.second&63);
+        bitMatrix[e.second*rowWords + (e.first>>6)] |= 1ULL<<(e.first&63);
+    }
+    std::vector<std::pair<size_t, size_t> >().swap(edges);
+}
+
+// create sorted adjacency lists from bit-matrix (if dense) or from edges
+void AsmRegAllocator::InterGraph::createAdjacencyLists(
+                std::vector<std::pair<size_t, size_t> >& edges)
+{
+    adjStarts.resize(nodesNum+1);
+    std::fill(adjStarts.begin(), adjStarts.end(), size_t(0));
+    if (rowWords != 0)
+    {
+        for (size_t i = 0; i < nodesNum; i++)
+        {
+            size_t degree = 0;
+            const uint64_t* row = bitMatrix.data() + i*rowWords;
+            for (size_t k = 0; k < rowWords; k++)
+                for (uint64_t w = row[k]; w != 0; w &= w-1)
+                    degree++;
+            adjStarts[i+1] = adjStarts[i] + degree;
+        }
+        adjNodes.resize(adjStarts[nodesNum]);
+        size_t* out = adjNodes.data();
+        for (size_t i = 0; i < nodesNum; i++)
+        {
+            const uint64_t* row = bitMatrix.data() + i*rowWords;
+            for (size_t k = 0; k < rowWords; k++)
+                for (uint64_t w = row[k]; w != 0; w &= w-1)
+                    *out++ = (k<<6) + CTZ64(w);
+        }
+    }
+    else
+    {
+        std::sort(edges.begin(), edges.end());
+        edges.resize(std::unique(edges.begin(), edges.end()) - edges.begin());
+        for (const std::pair<size_t, size_t>& e: edges)
+        {
+            adjStarts[e.first+1]++;
+            adjStarts[e.second+1]++;
+        }
+        for (size_t i = 0; i < nodesNum; i++)
+            adjStarts[i+1] += adjStarts[i];
+        adjNodes.resize(adjStarts[nodesNum]);
+        /* edges are sorted by lesser node, hence for every node, the lesser neighbours
+         * will be filled before greater neighbours and all be in order */
+        Array<size_t> fillPos(adjStarts.begin(), adjStarts.end()-1);
+        for (const std::pair<size_t, size_t>& e: edges)
+        {
+            adjNodes[fillPos[e.first]++] = e.second;
+            adjNodes[fillPos[e.second]++] = e.first;
+        }
+    }
+}
+
+void AsmRegAllocator::InterGraph::mergeNodes(size_t newNodesNum,
+                const Array<size_t>& nodeMap)
+{
+    // edges between merged nodes
+    std::vector<std::pair<size_t, size_t> > edges;
+    for (size_t a = 0; a < nodesNum; a++)
+        for (size_t b: (*this)[a])
+        {
+            const size_t na = nodeMap[a], nb = nodeMap[b];
+            if (a < b && na != nb)
+                edges.push_back({ std::min(na, nb), std::max(na, nb) });
+        }
+    clear();
+    nodesNum = newNodesNum;
+    const size_t maxEdgesNum = (nodesNum*((nodesNum+63)>>6)*sizeof(uint64_t)) /
+                sizeof(std::pair<size_t, size_t>);
+    if (edges.size() > maxEdgesNum)
+        moveEdgesToBitMatrix(edges);
+    createAdjacencyLists(edges);
+}
+
 void AsmRegAllocator::createInterferenceGraph()
 {
-    /// construct liveBlockMaps
-    std::set<LiveBlock> liveBlockMaps[MAX_REGTYPES_NUM];
     for (size_t regType = 0; regType < regTypesNum; regType++)
     {
-        std::set<LiveBlock>& liveBlockMap = liveBlockMaps[regType];
         Array<OutLiveness>& liveness = outLivenesses[regType];
-        for (size_t li = 0; li < liveness.size(); li++)
+        interGraphs[regType].build(std::max(graphVregsCounts[regType], liveness.size()),
+                    liveness);
+        liveness.clear();
+    }
+}
+
+static cxuint getRegType(size_t regTypesNum, const cxuint* regRanges,
+            const AsmSingleVReg& svreg)
+{
+    cxuint regType; // regtype
+    if (svreg.regVar!=nullptr)
+        regType = svreg.regVar->type;
+    else
+        for (regType = 0; regType < regTypesNum; regType++)
+            if (svreg.index >= regRanges[regType<<1] &&
+                svreg.index < regRanges[(regType<<1)+1])
+                break;
+    return regType;
+}
+
+/* replay register usages in every code block and call func for every usage
+ * with vreg indices of its registers (SIZE_MAX if register is not in graph) */
+template<typename F>
+void AsmRegAllocator::replayRegVarUsages(ISAUsageHandler& usageHandler, F func)
+{
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    size_t regTypesNum2;
+    assembler.isaAssembler->getRegisterRanges(regTypesNum2, regRanges);
+    std::vector<size_t> vidxes;
+    
+    for (const CodeBlock& cblock: codeBlocks)
+    {
+        ISAUsageHandler::ReadPos usagePos = cblock.usagePos;
+        SVRegMap ssaIdIdxMap;
+        SVRegMap svregWriteOffsets;
+        while (usageHandler.hasNext(usagePos))
         {
-            OutLiveness& lv = liveness[li];
-            for (const std::pair<size_t, size_t>& blk: lv)
-                if (blk.first != blk.second)
-                    liveBlockMap.insert({ blk.first, blk.second, li });
-            lv.clear();
+            const AsmRegVarUsage rvu = usageHandler.nextUsage(usagePos);
+            if (rvu.offset >= cblock.end)
+                break;
+            const cxuint regType = getRegType(regTypesNum, regRanges,
+                        AsmSingleVReg{ rvu.regVar, rvu.rstart });
+            if (regType >= regTypesNum)
+                continue; // register outside graph (special register)
+            vidxes.clear();
+            for (uint16_t rindex = rvu.rstart; rindex < rvu.rend; rindex++)
+            {
+                AsmSingleVReg svreg{ rvu.regVar, rindex };
+                const VarIndexMap& vregIndexMap = vregIndexMaps[regType];
+                if (rvu.regVar == nullptr)
+                {
+                    // real register have only one vreg
+                    auto vit = vregIndexMap.find(svreg);
+                    vidxes.push_back(vit != vregIndexMap.end() ? vit->second[0] : SIZE_MAX);
+                    continue;
+                }
+                size_t outSSAIdIdx = 0;
+                if (checkWriteWithSSA(rvu))
+                {
+                    size_t& ssaIdIdx = ssaIdIdxMap[svreg];
+                    outSSAIdIdx = ++ssaIdIdx;
+                    svregWriteOffsets[svreg] = rvu.offset;
+                }
+                else
+                {
+                    auto svrres = ssaIdIdxMap.insert({ svreg, 0 });
+                    outSSAIdIdx = svrres.first->second;
+                    auto swit = svregWriteOffsets.find(svreg);
+                    if (swit != svregWriteOffsets.end() && swit->second == rvu.offset)
+                        outSSAIdIdx--; // before this write
+                }
+                
+                const SSAInfo& ssaInfo = binaryMapFind(cblock.ssaInfoMap.begin(),
+                        cblock.ssaInfoMap.end(), svreg)->second;
+                size_t ssaId;
+                if (outSSAIdIdx==0)
+                    ssaId = ssaInfo.ssaIdBefore;
+                else if (outSSAIdIdx==1)
+                    ssaId = ssaInfo.ssaIdFirst;
+                else if (outSSAIdIdx<ssaInfo.ssaIdChange)
+                    ssaId = ssaInfo.ssaId + outSSAIdIdx-1;
+                else // last
+                    ssaId = ssaInfo.ssaIdLast;
+                vidxes.push_back(vregIndexMap.find(svreg)->second[ssaId]);
+            }
+            func(rvu, regType, vidxes.data());
         }
-        liveness.clear();
     }
+}
+
+/* conservative coalescing of vregs joined by moves:
+ * vregs (move destination and move source) are merged if they do not interfere and
+ * merged node have less than K neighbours with significant degree (Briggs test).
+ * If one of vregs is real register, then every neighbour of other vreg must
+ * interfere with real register or must have insignificant degree (George test).
+ * Vregs in linear dependencies (register ranges) are not coalesced. */
+void AsmRegAllocator::coalesceRegMoves(ISAUsageHandler& usageHandler, size_t codeSize,
+                const cxbyte* code)
+{
+    coalescedMovesNum = 0;
+    for (size_t regType = 0; regType < MAX_REGTYPES_NUM; regType++)
+        regMoves[regType].clear();
+    
+    // find moves between vregs (usages of single instruction have this same offset)
+    size_t curOffset = SIZE_MAX;
+    bool isMove = false;
+    bool haveRegVar = false;
+    cxuint moveRegType = UINT_MAX;
+    size_t moveVidxes[2]; // destination, source
+    auto addRegMove = [&]()
+    {
+        if (isMove && haveRegVar && moveVidxes[0] != SIZE_MAX && moveVidxes[1] != SIZE_MAX)
+            regMoves[moveRegType].push_back({ curOffset,
+                assembler.isaAssembler->getInstructionSize(codeSize-curOffset,
+                        code+curOffset), moveVidxes[0], moveVidxes[1] });
+    };
+    replayRegVarUsages(usageHandler, [&](const AsmRegVarUsage& rvu, cxuint regType,
+                const size_t* vidxes)
+    {
+        if (rvu.offset != curOffset)
+        {
+            addRegMove();
+            curOffset = rvu.offset;
+            isMove = assembler.isaAssembler->isRegisterMove(codeSize-curOffset,
+                        code+curOffset);
+            haveRegVar = false;
+            moveRegType = regType;
+            moveVidxes[0] = moveVidxes[1] = SIZE_MAX;
+        }
+        if (!isMove)
+            return;
+        const cxuint k = (rvu.rwFlags & ASMRVU_WRITE) ? 0 : 1;
+        if (rvu.rend-rvu.rstart != 1 || regType != moveRegType ||
+            vidxes[0] == SIZE_MAX || moveVidxes[k] != SIZE_MAX)
+        {
+            isMove = false; // not simple move between vregs
+            return;
+        }
+        moveVidxes[k] = vidxes[0];
+        haveRegVar |= (rvu.regVar != nullptr);
+    });
+    addRegMove();
     
-    // create interference graphs
+    cxuint maxRegs[MAX_REGTYPES_NUM];
+    size_t regTypesNum2;
+    assembler.isaAssembler->getMaxRegistersNum(regTypesNum2, maxRegs);
     for (size_t regType = 0; regType < regTypesNum; regType++)
     {
+        std::vector<RegMove>& moves = regMoves[regType];
+        if (moves.empty())
+            continue;
+        const size_t maxColorsNum = maxRegs[regType];
         InterGraph& interGraph = interGraphs[regType];
-        interGraph.resize(graphVregsCounts[regType]);
-        std::set<LiveBlock>& liveBlockMap = liveBlockMaps[regType];
+        const size_t nodesNum = interGraph.size();
         
-        auto lit = liveBlockMap.begin();
-        size_t rangeStart = 0;
-        if (lit != liveBlockMap.end())
-            rangeStart = lit->start;
-        while (lit != liveBlockMap.end())
-        {
-            const size_t blkStart = lit->start;
-            const size_t blkEnd = lit->end;
-            size_t rangeEnd = blkEnd;
-            auto liStart = liveBlockMap.lower_bound({ rangeStart, 0, 0 });
-            auto liEnd = liveBlockMap.lower_bound({ rangeEnd, 0, 0 });
-            // collect from this range, variable indices
-            std::set<size_t> varIndices;
-            for (auto lit2 = liStart; lit2 != liEnd; ++lit2)
-                varIndices.insert(lit2->vidx);
-            // push to intergraph as full subgGraph
-            for (auto vit = varIndices.begin(); vit != varIndices.end(); ++vit)
-                for (auto vit2 = varIndices.begin(); vit2 != varIndices.end(); ++vit2)
-                    if (vit != vit2)
-                        interGraph[*vit].insert(*vit2);
-            // go to next live blocks
-            rangeStart = rangeEnd;
-            for (; lit != liveBlockMap.end(); ++lit)
-                if (lit->start != blkStart && lit->end != blkEnd)
-                    break;
-            if (lit == liveBlockMap.end())
-                break; // 
-            rangeStart = std::max(rangeStart, lit->start);
+        // fixed nodes: real registers (1) and nodes in linear dependencies (2)
+        Array<cxbyte> fixedNodes(nodesNum);
+        std::fill(fixedNodes.begin(), fixedNodes.end(), cxbyte(0));
+        for (const auto& entry: vregIndexMaps[regType])
+            if (entry.first.regVar == nullptr)
+                fixedNodes[entry.second[0]] = 1;
+        for (const auto& entry: linearDepMaps[regType])
+            if (!entry.second.prevVidxes.empty() || !entry.second.nextVidxes.empty() ||
+                entry.second.align > 1)
+                fixedNodes[entry.first] = 2;
+        
+        Array<size_t> parents(nodesNum);
+        for (size_t node = 0; node < nodesNum; node++)
+            parents[node] = node;
+        auto findNode = [&parents](size_t node)
+        {
+            while (parents[node] != node)
+                node = parents[node] = parents[parents[node]];
+            return node;
+        };
+        // adjacency lists of merged nodes (sorted)
+        std::vector<std::vector<size_t> > adjs(nodesNum);
+        for (size_t node = 0; node < nodesNum; node++)
+            adjs[node].assign(interGraph[node].begin(), interGraph[node].end());
+        
+        size_t mergedNum = 0;
+        std::vector<size_t> mergedAdj;
+        for (const RegMove& move: moves)
+        {
+            size_t a = findNode(move.dstVidx);
+            size_t b = findNode(move.srcVidx);
+            if (a == b || fixedNodes[a] == 2 || fixedNodes[b] == 2 ||
+                (fixedNodes[a] == 1 && fixedNodes[b] == 1))
+                continue;
+            if (fixedNodes[b] == 1)
+                std::swap(a, b); // real register is always first
+            const std::vector<size_t>& adjA = adjs[a];
+            const std::vector<size_t>& adjB = adjs[b];
+            if (std::binary_search(adjA.begin(), adjA.end(), b))
+                continue; // interfere
+            
+            mergedAdj.clear();
+            std::set_union(adjA.begin(), adjA.end(), adjB.begin(), adjB.end(),
+                        std::back_inserter(mergedAdj));
+            bool canMerge = true;
+            if (fixedNodes[a] == 1)
+            {
+                // George test
+                for (size_t t: adjB)
+                    if (adjs[t].size() >= maxColorsNum && fixedNodes[t] != 1 &&
+                        !std::binary_search(adjA.begin(), adjA.end(), t))
+                    {
+                        canMerge = false;
+                        break;
+                    }
+            }
+            else
+            {
+                // Briggs test
+                size_t significantNum = 0;
+                for (size_t t: mergedAdj)
+                {
+                    // common neighbour loses one edge after merging
+                    const size_t degree = adjs[t].size() -
+                        ((std::binary_search(adjA.begin(), adjA.end(), t) &&
+                          std::binary_search(adjB.begin(), adjB.end(), t)) ? 1 : 0);
+                    if (degree >= maxColorsNum || fixedNodes[t] == 1)
+                        significantNum++;
+                }
+                canMerge = significantNum < maxColorsNum;
+            }
+            if (!canMerge)
+                continue;
+            
+            // merge b into a: replace b by a in neighbours of b
+            for (size_t t: adjB)
+            {
+                std::vector<size_t>& adjT = adjs[t];
+                adjT.erase(std::lower_bound(adjT.begin(), adjT.end(), b));
+                auto it = std::lower_bound(adjT.begin(), adjT.end(), a);
+                if (it == adjT.end() || *it != a)
+                    adjT.insert(it, a);
+            }
+            adjs[a].swap(mergedAdj);
+            std::vector<size_t>().swap(adjs[b]);
+            parents[b] = a;
+            mergedNum++;
+        }
+        coalescedMovesNum += mergedNum;
+        if (mergedNum == 0)
+            continue;
+        
+        // renumber nodes (merged nodes get index of its representative)
+        Array<size_t> nodeMap(nodesNum);
+        size_t newNodesNum = 0;
+        for (size_t node = 0; node < nodesNum; node++)
+            if (findNode(node) == node)
+                nodeMap[node] = newNodesNum++;
+        for (size_t node = 0; node < nodesNum; node++)
+            nodeMap[node] = nodeMap[findNode(node)];
+        
+        interGraph.mergeNodes(newNodesNum, nodeMap);
+        graphVregsCounts[regType] = newNodesNum;
+        for (auto& entry: vregIndexMaps[regType])
+            for (size_t& vidx: entry.second)
+                vidx = nodeMap[vidx];
+        // order of not merged nodes is preserved, hence vidx sets stay sorted
+        std::unordered_map<size_t, LinearDep> newLinearDepMap;
+        for (auto& entry: linearDepMaps[regType])
+        {
+            for (size_t& vidx: entry.second.prevVidxes)
+                vidx = nodeMap[vidx];
+            for (size_t& vidx: entry.second.nextVidxes)
+                vidx = nodeMap[vidx];
+            newLinearDepMap.insert({ nodeMap[entry.first], entry.second });
+        }
+        linearDepMaps[regType].swap(newLinearDepMap);
+        for (RegMove& move: moves)
+        {
+            move.dstVidx = nodeMap[move.dstVidx];
+            move.srcVidx = nodeMap[move.srcVidx];
         }
     }
 }
@@ -634,101 +1027,797 @@ void AsmRegAllocator::createInterferenceGraph()
  *               try to link free ends of two distinct regranges
  */
 
-void AsmRegAllocator::colorInterferenceGraph()
+/* DSatur coloring: nodes are held in buckets by saturation (number of distinct
+ * colors of neighbours). Every bucket is doubly linked list. For every node,
+ * bitset of forbidden colors is held, hence first free color is found by
+ * searching first zero bit. Nodes with this same saturation are initially
+ * ordered by degree (largest degree first).
+ * Nodes joined by linear dependencies (register ranges) are colored before
+ * DSatur as groups: offsets of nodes in group are found by traversing
+ * prev/next links, and first aligned base color free for all nodes is chosen */
+
+namespace
 {
-    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(
-                    assembler.deviceType);
-    
-    for (size_t regType = 0; regType < regTypesNum; regType++)
+struct LinearGroup
+{
+    size_t span;    // number of registers
+    cxuint align;
+    std::vector<std::pair<size_t, size_t> > nodes; // node and its offset in group
+};
+};
+
+static void createLinearGroups(const std::unordered_map<size_t, LinearDep>& ldepMap,
+            size_t nodesNum, std::vector<LinearGroup>& groups)
+{
+    Array<cxbyte> visited(nodesNum);
+    std::fill(visited.begin(), visited.end(), cxbyte(0));
+    std::unordered_map<size_t, ptrdiff_t> offsets;
+    std::vector<size_t> stack;
+    for (const auto& entry: ldepMap)
     {
-        const size_t maxColorsNum = getGPUMaxRegistersNum(arch, regType);
-        InterGraph& interGraph = interGraphs[regType];
-        const VarIndexMap& vregIndexMap = vregIndexMaps[regType];
-        Array<cxuint>& gcMap = graphColorMaps[regType];
-        
-        const size_t nodesNum = interGraph.size();
-        gcMap.resize(nodesNum);
-        std::fill(gcMap.begin(), gcMap.end(), cxuint(UINT_MAX));
-        Array<size_t> sdoCounts(nodesNum);
-        std::fill(sdoCounts.begin(), sdoCounts.end(), 0);
-        
-        SDOLDOCompare compare(interGraph, sdoCounts);
-        std::set<size_t, SDOLDOCompare> nodeSet(compare);
-        for (size_t i = 0; i < nodesNum; i++)
-            nodeSet.insert(i);
-        
-        cxuint colorsNum = 0;
-        // firstly, allocate real registers
-        for (const auto& entry: vregIndexMap)
-            if (entry.first.regVar == nullptr)
-                gcMap[entry.second[0]] = colorsNum++;
-        
-        for (size_t colored = 0; colored < nodesNum; colored++)
+        if (visited[entry.first] ||
+            (entry.second.prevVidxes.empty() && entry.second.nextVidxes.empty() &&
+                entry.second.align <= 1))
+            continue;
+        // traverse group and compute offsets of nodes
+        offsets.clear();
+        offsets.insert({ entry.first, 0 });
+        visited[entry.first] = 1;
+        stack.push_back(entry.first);
+        ptrdiff_t minOffset = 0, maxOffset = 0;
+        while (!stack.empty())
         {
-            size_t node = *nodeSet.begin();
-            if (gcMap[node] != UINT_MAX)
-                continue; // already colored
-            size_t color = 0;
-            
-            for (color = 0; color <= colorsNum; color++)
+            const size_t node = stack.back();
+            stack.pop_back();
+            const ptrdiff_t offset = offsets.find(node)->second;
+            auto ldit = ldepMap.find(node);
+            if (ldit == ldepMap.end())
+                continue;
+            for (cxuint k = 0; k < 2; k++)
             {
-                // find first usable color
-                bool thisSame = false;
-                for (size_t nb: interGraph[node])
-                    if (gcMap[nb] == color)
+                const VectorSet<size_t>& nbs = (k==0) ? ldit->second.nextVidxes :
+                            ldit->second.prevVidxes;
+                const ptrdiff_t nbOffset = (k==0) ? offset+1 : offset-1;
+                for (size_t nb: nbs)
+                {
+                    auto res = offsets.insert({ nb, nbOffset });
+                    if (!res.second)
                     {
-                        thisSame = true;
-                        break;
+                        if (res.first->second != nbOffset)
+                            throw AsmException("Inconsistent linear dependencies "
+                                    "between register variables");
+                        continue;
                     }
-                if (!thisSame)
-                    break;
+                    visited[nb] = 1;
+                    minOffset = std::min(minOffset, nbOffset);
+                    maxOffset = std::max(maxOffset, nbOffset);
+                    stack.push_back(nb);
+                }
             }
-            if (color==colorsNum) // add new color if needed
+        }
+        
+        LinearGroup group{ size_t(maxOffset-minOffset+1), 1, { } };
+        for (const auto& oentry: offsets)
+        {
+            const size_t offset = oentry.second - minOffset;
+            group.nodes.push_back({ oentry.first, offset });
+            auto ldit = ldepMap.find(oentry.first);
+            if (ldit != ldepMap.end() && ldit->second.align > 1)
             {
-                if (colorsNum >= maxColorsNum)
-                    throw AsmException("Too many register is needed");
-                colorsNum++;
+                // alignment is applied for first register of range
+                if (offset % ldit->second.align != 0)
+                    throw AsmException("Inconsistent alignment of register variables");
+                group.align = std::max(group.align, cxuint(ldit->second.align));
             }
-            
-            gcMap[node] = color;
-            // update SDO for node
-            bool colorExists = false;
-            for (size_t nb: interGraph[node])
-                if (gcMap[nb] == color)
+        }
+        std::sort(group.nodes.begin(), group.nodes.end());
+        groups.push_back(group);
+    }
+    // largest groups are colored first
+    std::stable_sort(groups.begin(), groups.end(),
+            [](const LinearGroup& g1, const LinearGroup& g2)
+            { return g1.span > g2.span; });
+}
+
+/* spill cost of vreg is sum of weights of its usages, where weight of usage is
+ * 10^(loop depth of code block). Loops are found as back edges of depth-first
+ * traversal of code blocks graph; loop body is set of blocks that reach
+ * back edge source without passing loop header. Vregs used in register ranges,
+ * in linear dependencies and together with real registers are not spillable */
+void AsmRegAllocator::createSpillCosts(ISAUsageHandler& usageHandler,
+                const AsmSection& section)
+{
+    const size_t blocksNum = codeBlocks.size();
+    std::vector<std::vector<size_t> > succs(blocksNum);
+    std::vector<std::vector<size_t> > preds(blocksNum);
+    for (size_t bi = 0; bi < blocksNum; bi++)
+    {
+        const CodeBlock& cblock = codeBlocks[bi];
+        for (const NextBlock& next: cblock.nexts)
+            if (!next.isCall)
+                succs[bi].push_back(next.block);
+        if ((cblock.nexts.empty() || cblock.haveCalls) &&
+            !cblock.haveReturn && !cblock.haveEnd && bi+1 < blocksNum)
+            succs[bi].push_back(bi+1);
+        for (size_t next: succs[bi])
+            preds[next].push_back(bi);
+    }
+    
+    // find back edges (header, source)
+    std::vector<std::pair<size_t, size_t> > backEdges;
+    std::vector<cxbyte> visited(blocksNum, 0); // 1 - in path, 2 - done
+    std::vector<std::pair<size_t, size_t> > stack;
+    for (size_t root = 0; root < blocksNum; root++)
+    {
+        if (visited[root] != 0)
+            continue;
+        stack.push_back({ root, 0 });
+        visited[root] = 1;
+        while (!stack.empty())
+        {
+            auto& entry = stack.back();
+            if (entry.second < succs[entry.first].size())
+            {
+                const size_t next = succs[entry.first][entry.second++];
+                if (visited[next] == 1)
+                    backEdges.push_back({ next, entry.first });
+                else if (visited[next] == 0)
                 {
-                    colorExists = true;
+                    visited[next] = 1;
+                    stack.push_back({ next, 0 });
+                }
+            }
+            else
+            {
+                visited[entry.first] = 2;
+                stack.pop_back();
+            }
+        }
+    }
+    
+    // compute loop depths
+    std::vector<cxuint> loopDepths(blocksNum, 0);
+    std::sort(backEdges.begin(), backEdges.end());
+    std::vector<size_t> loopMarks(blocksNum, SIZE_MAX);
+    std::vector<size_t> workList;
+    for (size_t i = 0; i < backEdges.size(); )
+    {
+        const size_t header = backEdges[i].first;
+        loopMarks[header] = header;
+        loopDepths[header]++;
+        for (; i < backEdges.size() && backEdges[i].first == header; i++)
+            if (loopMarks[backEdges[i].second] != header)
+            {
+                loopMarks[backEdges[i].second] = header;
+                loopDepths[backEdges[i].second]++;
+                workList.push_back(backEdges[i].second);
+            }
+        while (!workList.empty())
+        {
+            const size_t block = workList.back();
+            workList.pop_back();
+            for (size_t pred: preds[block])
+                if (loopMarks[pred] != header)
+                {
+                    loopMarks[pred] = header;
+                    loopDepths[pred]++;
+                    workList.push_back(pred);
+                }
+        }
+    }
+    
+    // jump instructions - writes in this instructions can not be spilled,
+    // because store after jump will not be executed
+    std::vector<size_t> jumpOffsets;
+    for (const AsmCodeFlowEntry& entry: section.codeFlow)
+        if (entry.type == AsmCodeFlowType::JUMP || entry.type == AsmCodeFlowType::CJUMP)
+            jumpOffsets.push_back(entry.offset);
+    std::sort(jumpOffsets.begin(), jumpOffsets.end());
+    
+    for (size_t regType = 0; regType < regTypesNum; regType++)
+        if (regType == REGTYPE_SGPR ||
+            (regType == REGTYPE_VGPR && spillLdsReg != UINT_MAX))
+            spillCosts[regType].assign(interGraphs[regType].size(), 0.0);
+    
+    replayRegVarUsages(usageHandler, [&](const AsmRegVarUsage& rvu, cxuint regType,
+                const size_t* vidxes)
+    {
+        std::vector<double>& costs = spillCosts[regType];
+        if (costs.empty())
+            return;
+        const size_t regsNum = rvu.rend - rvu.rstart;
+        if (rvu.regVar == nullptr || regsNum != 1 || rvu.useRegMode ||
+            rvu.regField == ASMFIELD_NONE ||
+            ((rvu.rwFlags & ASMRVU_WRITE) != 0 &&
+             std::binary_search(jumpOffsets.begin(), jumpOffsets.end(), rvu.offset)))
+        {
+            for (size_t k = 0; k < regsNum; k++)
+                if (vidxes[k] != SIZE_MAX)
+                    costs[vidxes[k]] = -1.0;
+            return;
+        }
+        auto cbit = std::upper_bound(codeBlocks.begin(), codeBlocks.end(), rvu.offset,
+                [](size_t offset, const CodeBlock& c) { return offset < c.start; });
+        const cxuint depth = std::min(loopDepths[cbit - codeBlocks.begin() - 1], 8U);
+        if (costs[vidxes[0]] >= 0.0)
+            costs[vidxes[0]] += std::pow(10.0, double(depth));
+        spillUsages[regType].push_back({ rvu.offset, vidxes[0],
+                    AsmSingleVReg{ rvu.regVar, rvu.rstart }, rvu.rwFlags, UINT_MAX });
+    });
+    
+    for (size_t regType = 0; regType < regTypesNum; regType++)
+    {
+        std::vector<double>& costs = spillCosts[regType];
+        if (costs.empty())
+            continue;
+        // vregs in linear dependencies can not be spilled
+        for (const auto& entry: linearDepMaps[regType])
+            if (!entry.second.prevVidxes.empty() || !entry.second.nextVidxes.empty() ||
+                entry.second.align > 1)
+            {
+                costs[entry.first] = -1.0;
+                for (size_t vidx: entry.second.prevVidxes)
+                    costs[vidx] = -1.0;
+                for (size_t vidx: entry.second.nextVidxes)
+                    costs[vidx] = -1.0;
+            }
+        std::stable_sort(spillUsages[regType].begin(), spillUsages[regType].end(),
+                [](const SpillUsage& u1, const SpillUsage& u2)
+                { return u1.offset < u2.offset; });
+    }
+}
+
+/* DSatur coloring of graph for single register type: vreg with highest saturation
+ * (number of distinct colors of neighbours) is colored first by first free color.
+ * Spilled vregs are not colored and reserved colors are not used.
+ * If coloring failed, return false and nodes which could not be colored */
+bool AsmRegAllocator::colorRegType(size_t regType, size_t colorsNum,
+            const std::vector<cxuint>& reservedColors, std::vector<size_t>& failedNodes)
+{
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    size_t regTypesNum2;
+    assembler.isaAssembler->getRegisterRanges(regTypesNum2, regRanges);
+    
+    const size_t maxColorsNum = colorsNum;
+    const InterGraph& interGraph = interGraphs[regType];
+    const VarIndexMap& vregIndexMap = vregIndexMaps[regType];
+    const Array<size_t>& slots = spillSlots[regType];
+    Array<cxuint>& gcMap = graphColorMaps[regType];
+    cxuint& allocRegsNum = allocRegsNums[regType];
+    allocRegsNum = 0;
+    failedNodes.clear();
+    
+    const size_t nodesNum = interGraph.size();
+    gcMap.resize(nodesNum);
+    std::fill(gcMap.begin(), gcMap.end(), cxuint(UINT_MAX));
+    
+    // bitsets of forbidden colors
+    const size_t colorWords = (maxColorsNum+63)>>6;
+    Array<uint64_t> forbiddens(nodesNum*colorWords);
+    std::fill(forbiddens.begin(), forbiddens.end(), uint64_t(0));
+    // reserved colors are forbidden for all vregs
+    for (cxuint color: reservedColors)
+        for (size_t node = 0; node < nodesNum; node++)
+            forbiddens[node*colorWords + (color>>6)] |= 1ULL<<(color&63);
+    Array<size_t> saturations(nodesNum);
+    std::fill(saturations.begin(), saturations.end(), size_t(0));
+    
+    // buckets (saturation is not greater than maxColorsNum)
+    Array<size_t> bucketHeads(maxColorsNum+1);
+    std::fill(bucketHeads.begin(), bucketHeads.end(), SIZE_MAX);
+    Array<size_t> nextNodes(nodesNum);
+    Array<size_t> prevNodes(nodesNum);
+    
+    auto removeFromBucket = [&](size_t node)
+    {
+        if (prevNodes[node] != SIZE_MAX)
+            nextNodes[prevNodes[node]] = nextNodes[node];
+        else
+            bucketHeads[saturations[node]] = nextNodes[node];
+        if (nextNodes[node] != SIZE_MAX)
+            prevNodes[nextNodes[node]] = prevNodes[node];
+    };
+    auto insertToBucket = [&](size_t node)
+    {
+        size_t& head = bucketHeads[saturations[node]];
+        prevNodes[node] = SIZE_MAX;
+        nextNodes[node] = head;
+        if (head != SIZE_MAX)
+            prevNodes[head] = node;
+        head = node;
+    };
+    
+    size_t topBucket = 0;
+    // set color for node and update saturations of its uncolored neighbours
+    auto setNodeColor = [&](size_t node, size_t color)
+    {
+        gcMap[node] = color;
+        if (color >= maxColorsNum)
+            return; // real register outside allocated registers
+        const uint64_t colorMask = 1ULL<<(color&63);
+        for (size_t nb: interGraph[node])
+        {
+            uint64_t& fword = forbiddens[nb*colorWords + (color>>6)];
+            if (gcMap[nb] != UINT_MAX || slots[nb] != SIZE_MAX ||
+                (fword & colorMask) != 0)
+                continue;
+            fword |= colorMask;
+            removeFromBucket(nb);
+            saturations[nb]++;
+            insertToBucket(nb);
+            topBucket = std::max(topBucket, saturations[nb]);
+        }
+    };
+    auto isForbidden = [&](size_t node, size_t color)
+    { return (forbiddens[node*colorWords + (color>>6)] & (1ULL<<(color&63))) != 0; };
+    
+    // firstly, allocate real registers (color is register index)
+    for (const auto& entry: vregIndexMap)
+        if (entry.first.regVar == nullptr)
+            gcMap[entry.second[0]] = entry.first.index - regRanges[2*regType];
+    
+    // put uncolored nodes to first bucket (reversed order of degree)
+    std::vector<size_t> nodesByDegree;
+    for (size_t node = 0; node < nodesNum; node++)
+        if (gcMap[node] == UINT_MAX && slots[node] == SIZE_MAX)
+            nodesByDegree.push_back(node);
+    std::stable_sort(nodesByDegree.begin(), nodesByDegree.end(),
+            [&interGraph](size_t a, size_t b)
+            { return interGraph[a].size() < interGraph[b].size(); });
+    for (size_t node: nodesByDegree)
+        insertToBucket(node);
+    size_t uncoloredNum = nodesByDegree.size();
+    
+    for (size_t node = 0; node < nodesNum; node++)
+        if (gcMap[node] != UINT_MAX)
+            setNodeColor(node, gcMap[node]);
+    
+    // color linear groups
+    std::vector<LinearGroup> linearGroups;
+    createLinearGroups(linearDepMaps[regType], nodesNum, linearGroups);
+    for (const LinearGroup& group: linearGroups)
+    {
+        size_t base = 0, baseEnd = 0;
+        if (group.span <= maxColorsNum)
+        {
+            size_t baseStart = 0;
+            baseEnd = maxColorsNum - group.span + 1;
+            // if some node already colored, base color is fixed
+            for (const auto& gnode: group.nodes)
+                if (gcMap[gnode.first] != UINT_MAX)
+                {
+                    baseStart = gcMap[gnode.first] - gnode.second;
+                    baseEnd = baseStart+1;
                     break;
                 }
-            if (!colorExists)
-                sdoCounts[node]++;
-            // update SDO for neighbors
-            for (size_t nb: interGraph[node])
+            for (base = baseStart; base < baseEnd; base++)
             {
-                colorExists = false;
-                for (size_t nb2: interGraph[nb])
-                    if (gcMap[nb2] == color)
+                if (base % group.align != 0)
+                    continue;
+                bool freeColors = true;
+                for (const auto& gnode: group.nodes)
+                    if (gcMap[gnode.first] == UINT_MAX ?
+                            isForbidden(gnode.first, base + gnode.second) :
+                            gcMap[gnode.first] != base + gnode.second)
                     {
-                        colorExists = true;
+                        freeColors = false;
                         break;
                     }
-                if (!colorExists)
+                if (freeColors)
+                    break;
+            }
+        }
+        if (base >= baseEnd)
+        {
+            for (const auto& gnode: group.nodes)
+                failedNodes.push_back(gnode.first);
+            return false;
+        }
+        for (const auto& gnode: group.nodes)
+            if (gcMap[gnode.first] == UINT_MAX)
+            {
+                removeFromBucket(gnode.first);
+                uncoloredNum--;
+                setNodeColor(gnode.first, base + gnode.second);
+                allocRegsNum = std::max(allocRegsNum, cxuint(base + gnode.second + 1));
+            }
+    }
+    
+    for (; uncoloredNum != 0; uncoloredNum--)
+    {
+        while (bucketHeads[topBucket] == SIZE_MAX)
+            topBucket--;
+        const size_t node = bucketHeads[topBucket];
+        removeFromBucket(node);
+        
+        // find first usable color
+        const uint64_t* forbidden = forbiddens.data() + node*colorWords;
+        size_t color = maxColorsNum;
+        for (size_t k = 0; k < colorWords; k++)
+            if (forbidden[k] != UINT64_MAX)
+            {
+                color = (k<<6) + CTZ64(~forbidden[k]);
+                break;
+            }
+        if (color >= maxColorsNum)
+        {
+            failedNodes.push_back(node);
+            return false;
+        }
+        setNodeColor(node, color);
+        allocRegsNum = std::max(allocRegsNum, cxuint(color+1));
+    }
+    return true;
+}
+
+/* choose vreg to spill: vreg with lowest ratio of spill cost to degree from
+ * uncolored vregs and their neighbours. Vregs whose spilling does not increase
+ * number of temporary registers (spilled vregs in single instruction) are preferred */
+size_t AsmRegAllocator::chooseSpilledNode(size_t regType,
+                const std::vector<size_t>& failedNodes) const
+{
+    const std::vector<double>& costs = spillCosts[regType];
+    if (costs.empty())
+        return SIZE_MAX; // spilling is not possible
+    const InterGraph& interGraph = interGraphs[regType];
+    const Array<size_t>& slots = spillSlots[regType];
+    const std::vector<SpillUsage>& usages = spillUsages[regType];
+    
+    // find vregs that increase number of temporary registers
+    std::vector<size_t> instrSpilledNums;
+    size_t tempsNum = 0;
+    for (size_t i = 0; i < usages.size(); )
+    {
+        size_t j = i, spilledNum = 0;
+        for (; j < usages.size() && usages[j].offset == usages[i].offset; j++)
+            if (slots[usages[j].vidx] != SIZE_MAX)
+                spilledNum++;
+        instrSpilledNums.push_back(spilledNum);
+        tempsNum = std::max(tempsNum, spilledNum);
+        i = j;
+    }
+    std::vector<bool> incTemps(costs.size(), false);
+    for (size_t i = 0, instrIndex = 0; i < usages.size(); instrIndex++)
+    {
+        size_t j = i;
+        for (; j < usages.size() && usages[j].offset == usages[i].offset; j++);
+        if (instrSpilledNums[instrIndex] >= tempsNum)
+            for (size_t k = i; k < j; k++)
+                incTemps[usages[k].vidx] = true;
+        i = j;
+    }
+    
+    size_t bestNode = SIZE_MAX;
+    double bestRatio = 0.0;
+    bool bestIncTemps = true;
+    auto checkNode = [&](size_t node)
+    {
+        if (costs[node] < 0.0 || slots[node] != SIZE_MAX)
+            return;
+        const double ratio = costs[node] / double(interGraph[node].size()+1);
+        if (bestNode == SIZE_MAX || (!incTemps[node] && bestIncTemps) ||
+            (incTemps[node] == bestIncTemps &&
+                (ratio < bestRatio || (ratio == bestRatio && node < bestNode))))
+        {
+            bestNode = node;
+            bestRatio = ratio;
+            bestIncTemps = incTemps[node];
+        }
+    };
+    for (size_t node: failedNodes)
+    {
+        checkNode(node);
+        for (size_t nb: interGraph[node])
+            checkNode(nb);
+    }
+    return bestNode;
+}
+
+/* reserve colors for spilling: temporary registers for spilled vregs
+ * (as many as spilled vregs in single instruction), VGPRs that holds spilled SGPRs
+ * (in lanes) and VGPR with address of LDS window. Reserved colors are highest colors
+ * not used by real registers */
+bool AsmRegAllocator::reserveSpillColors(size_t regType, size_t colorsNum,
+                std::vector<cxuint>& reservedColors)
+{
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    size_t regTypesNum2;
+    assembler.isaAssembler->getRegisterRanges(regTypesNum2, regRanges);
+    const Array<size_t>& slots = spillSlots[regType];
+    const std::vector<SpillUsage>& usages = spillUsages[regType];
+    reservedColors.clear();
+    
+    // number of temporary registers
+    size_t tempsNum = 0;
+    for (size_t i = 0; i < usages.size(); )
+    {
+        size_t j = i, instrTempsNum = 0;
+        for (; j < usages.size() && usages[j].offset == usages[i].offset; j++)
+        {
+            if (slots[usages[j].vidx] == SIZE_MAX)
+                continue;
+            bool first = true;
+            for (size_t k = i; k < j; k++)
+                if (usages[k].vidx == usages[j].vidx)
+                    first = false;
+            if (first)
+                instrTempsNum++;
+        }
+        tempsNum = std::max(tempsNum, instrTempsNum);
+        i = j;
+    }
+    
+    size_t laneRegsNum = 0;
+    cxuint ldsColor = UINT_MAX;
+    if (regType == REGTYPE_VGPR)
+    {
+        const size_t lanesNum = (assembler.codeFlags & ASM_CODE_WAVE32) ? 32 : 64;
+        laneRegsNum = (spilledRegsNums[REGTYPE_SGPR] + lanesNum-1) / lanesNum;
+        if (spilledRegsNums[REGTYPE_VGPR] != 0)
+            ldsColor = spillLdsReg - regRanges[2*REGTYPE_VGPR];
+    }
+    if (tempsNum + laneRegsNum == 0)
+        return true;
+    
+    std::vector<bool> usedColors(colorsNum, false);
+    for (const auto& entry: vregIndexMaps[regType])
+        if (entry.first.regVar == nullptr)
+        {
+            const size_t color = entry.first.index - regRanges[2*regType];
+            if (color < colorsNum)
+                usedColors[color] = true;
+        }
+    if (ldsColor < colorsNum)
+        usedColors[ldsColor] = true;
+    
+    for (size_t color = colorsNum; color > 0 &&
+                reservedColors.size() < tempsNum + laneRegsNum; color--)
+        if (!usedColors[color-1])
+            reservedColors.push_back(color-1);
+    if (reservedColors.size() < tempsNum + laneRegsNum)
+        return false;
+    if (regType == REGTYPE_VGPR)
+        spillLaneRegs.assign(reservedColors.begin() + tempsNum, reservedColors.end());
+    if (ldsColor != UINT_MAX)
+        reservedColors.push_back(ldsColor);
+    return true;
+}
+
+// assign temporary registers for spilled vregs in instructions
+void AsmRegAllocator::assignSpillTemps(size_t regType,
+                const std::vector<cxuint>& reservedColors)
+{
+    const Array<size_t>& slots = spillSlots[regType];
+    std::vector<SpillUsage>& usages = spillUsages[regType];
+    cxuint& allocRegsNum = allocRegsNums[regType];
+    for (size_t i = 0; i < usages.size(); )
+    {
+        size_t j = i, tempIndex = 0;
+        for (; j < usages.size() && usages[j].offset == usages[i].offset; j++)
+        {
+            SpillUsage& usage = usages[j];
+            usage.tempColor = UINT_MAX;
+            if (slots[usage.vidx] == SIZE_MAX)
+                continue;
+            for (size_t k = i; k < j; k++)
+                if (usages[k].vidx == usage.vidx)
+                    usage.tempColor = usages[k].tempColor;
+            if (usage.tempColor == UINT_MAX)
+                usage.tempColor = reservedColors[tempIndex++];
+            allocRegsNum = std::max(allocRegsNum, usage.tempColor+1);
+        }
+        i = j;
+    }
+    if (regType == REGTYPE_VGPR)
+        for (cxuint color: spillLaneRegs)
+            allocRegsNum = std::max(allocRegsNum, color+1);
+}
+
+// throw error if register variables does not fit in available registers
+static void throwTooManyRegisters(size_t regType, size_t colorsNum)
+{
+    char buf[80];
+    snprintf(buf, sizeof buf, "Register variables need more than %zu %s",
+             colorsNum, (regType == REGTYPE_VGPR) ? "VGPRs" : "SGPRs");
+    throw AsmException(buf);
+}
+
+/* color interference graphs. If colors are not enough and spilling is possible,
+ * then vregs with lowest spill cost are spilled and graph is colored again */
+void AsmRegAllocator::colorInterferenceGraph()
+{
+    cxuint maxRegs[MAX_REGTYPES_NUM];
+    size_t regTypesNum2;
+    assembler.isaAssembler->getMaxRegistersNum(regTypesNum2, maxRegs);
+    spillLaneRegs.clear();
+    
+    std::vector<cxuint> reservedColors;
+    std::vector<size_t> failedNodes;
+    for (size_t regType = 0; regType < regTypesNum; regType++)
+    {
+        size_t colorsNum = maxRegs[regType];
+        if (regsNumLimits[regType] != 0)
+            colorsNum = std::min(colorsNum, size_t(regsNumLimits[regType]));
+        Array<size_t>& slots = spillSlots[regType];
+        slots.resize(interGraphs[regType].size());
+        std::fill(slots.begin(), slots.end(), SIZE_MAX);
+        spilledRegsNums[regType] = 0;
+        // VGPRs needs place for spilled SGPRs
+        if (!reserveSpillColors(regType, colorsNum, reservedColors))
+            throwTooManyRegisters(regType, colorsNum);
+        
+        while (!colorRegType(regType, colorsNum, reservedColors, failedNodes))
+        {
+            const size_t node = chooseSpilledNode(regType, failedNodes);
+            if (node == SIZE_MAX)
+                throwTooManyRegisters(regType, colorsNum);
+            slots[node] = spilledRegsNums[regType]++;
+            if (!reserveSpillColors(regType, colorsNum, reservedColors))
+                throwTooManyRegisters(regType, colorsNum);
+        }
+        assignSpillTemps(regType, reservedColors);
+    }
+}
+
+/* replaying register usages in every code block (like in liveness creation)
+ * to get SSA id of every regvar usage, and put allocated register to
+ * instruction field */
+bool AsmRegAllocator::applyAllocatedRegisters(ISAUsageHandler& usageHandler,
+                size_t codeSize, cxbyte* code)
+{
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    size_t regTypesNum2;
+    assembler.isaAssembler->getRegisterRanges(regTypesNum2, regRanges);
+    bool good = true;
+    rregUsages.clear();
+    
+    replayRegVarUsages(usageHandler, [&](const AsmRegVarUsage& rvu, cxuint regType,
+                const size_t* vidxes)
+    {
+        if (rvu.regVar == nullptr)
+            return;
+        const Array<cxuint>& gcMap = graphColorMaps[regType];
+        cxuint firstRReg = regRanges[2*regType] + gcMap[vidxes[0]];
+        if (spillSlots[regType][vidxes[0]] != SIZE_MAX)
+        {
+            // spilled vreg - use temporary register
+            const std::vector<SpillUsage>& usages = spillUsages[regType];
+            auto uit = std::lower_bound(usages.begin(), usages.end(), rvu.offset,
+                    [](const SpillUsage& u, size_t offset) { return u.offset < offset; });
+            for (; uit != usages.end() && uit->offset == rvu.offset; ++uit)
+                if (uit->vidx == vidxes[0])
+                    break;
+            if (uit == usages.end() || uit->offset != rvu.offset)
+            {
+                printError(rvu.offset, "No temporary register for spilled "
+                        "register variable");
+                good = false;
+                return;
+            }
+            firstRReg = regRanges[2*regType] + uit->tempColor;
+        }
+        bool linearRegs = true;
+        for (uint16_t k = 1; k < rvu.rend-rvu.rstart; k++)
+            if (gcMap[vidxes[k]] != gcMap[vidxes[0]] + k)
+                linearRegs = false;
+        if (linearRegs)
+            rregUsages.push_back({ rvu, firstRReg });
+        if (rvu.useRegMode || rvu.regField == ASMFIELD_NONE)
+            return;
+        
+        if (!linearRegs)
+        {
+            printError(rvu.offset, "Registers of register variable are not "
+                    "allocated linearly");
+            good = false;
+        }
+        else if (!assembler.isaAssembler->setRegVarRegister(rvu, firstRReg,
+                    codeSize, code))
+        {
+            printError(rvu.offset, "Unsupported instruction field for "
+                    "register variable");
+            good = false;
+        }
+    });
+    return good;
+}
+
+/* moves are removed while inserting spill code (symbols, jumps and section data
+ * are updated). If code can not be removed from section, move is replaced by nops */
+void AsmRegAllocator::removeRedundantMoves(AsmSection& section)
+{
+    removedMovesNum = 0;
+    removedMoves.clear();
+    const bool canRemove = canInsertCode(section);
+    const size_t codeSize = section.content.size();
+    cxbyte* code = section.content.data();
+    for (size_t regType = 0; regType < regTypesNum; regType++)
+    {
+        const Array<cxuint>& gcMap = graphColorMaps[regType];
+        const Array<size_t>& slots = spillSlots[regType];
+        for (const RegMove& move: regMoves[regType])
+            if (gcMap[move.dstVidx] == gcMap[move.srcVidx] &&
+                slots[move.dstVidx] == SIZE_MAX && slots[move.srcVidx] == SIZE_MAX &&
+                move.offset + move.size <= codeSize)
+            {
+                if (canRemove)
+                    removedMoves.push_back(move);
+                else
+                    assembler.isaAssembler->fillAlignment(move.size, code + move.offset);
+                removedMovesNum++;
+            }
+    }
+    std::sort(removedMoves.begin(), removedMoves.end(),
+            [](const RegMove& m1, const RegMove& m2) { return m1.offset < m2.offset; });
+}
+
+/* after allocation, register usages and delayed ops refer to allocated registers
+ * (temporary registers for spilled vregs), hence passes after register allocation
+ * (wait scheduling) do not need SSA data. Usages are replayed in this same order
+ * as in applyAllocatedRegisters */
+void AsmRegAllocator::applyRealRegisters(AsmSection& section)
+{
+    std::unique_ptr<ISAUsageHandler> newUsageHandler(
+                assembler.isaAssembler->createUsageHandler());
+    ISAUsageHandler::ReadPos usagePos = section.usageHandler->findPositionByOffset(0);
+    auto rrit = rregUsages.begin();
+    while (section.usageHandler->hasNext(usagePos))
+    {
+        AsmRegVarUsage rvu = section.usageHandler->nextUsage(usagePos);
+        if (rvu.regVar != nullptr && rrit != rregUsages.end() &&
+            rrit->first.offset == rvu.offset && rrit->first.regVar == rvu.regVar &&
+            rrit->first.rstart == rvu.rstart && rrit->first.regField == rvu.regField &&
+            rrit->first.rwFlags == rvu.rwFlags)
+        {
+            rvu.regVar = nullptr;
+            rvu.rend = rrit->second + rvu.rend - rvu.rstart;
+            rvu.rstart = rrit->second;
+            ++rrit;
+        }
+        newUsageHandler->pushUsage(rvu);
+    }
+    section.usageHandler = std::move(newUsageHandler);
+    
+    if (section.waitHandler == nullptr)
+        return;
+    std::unique_ptr<ISAWaitHandler> newWaitHandler(new ISAWaitHandler());
+    ISAWaitHandler::ReadPos waitPos = section.waitHandler->findPositionByOffset(0);
+    while (section.waitHandler->hasNext(waitPos))
+    {
+        AsmDelayedOp delOp;
+        AsmWaitInstr waitInstr;
+        if (section.waitHandler->nextInstr(waitPos, delOp, waitInstr))
+        {
+            newWaitHandler->pushWaitInstr(waitInstr);
+            continue;
+        }
+        if (delOp.regVar != nullptr)
+        {
+            // find usage of regvar in instruction (write if delayed op writes)
+            const cxbyte rwFlag = ((delOp.rwFlags | delOp.rwFlags2) & ASMRVU_WRITE) != 0 ?
+                        ASMRVU_WRITE : ASMRVU_READ;
+            auto it = std::lower_bound(rregUsages.begin(), rregUsages.end(), delOp.offset,
+                    [](const std::pair<AsmRegVarUsage, cxuint>& e, size_t offset)
+                    { return e.first.offset < offset; });
+            for (; it != rregUsages.end() && it->first.offset == delOp.offset; ++it)
+                if (it->first.regVar == delOp.regVar &&
+                    it->first.rstart <= delOp.rstart && it->first.rend >= delOp.rend &&
+                    (it->first.rwFlags & rwFlag) != 0)
                 {
-                    if (gcMap[nb] == UINT_MAX)
-                        nodeSet.erase(nb);  // before update we erase from nodeSet
-                    sdoCounts[nb]++;
-                    if (gcMap[nb] == UINT_MAX)
-                        nodeSet.insert(nb); // after update, insert again
+                    const cxuint rreg = it->second + delOp.rstart - it->first.rstart;
+                    delOp.regVar = nullptr;
+                    delOp.rend = rreg + delOp.rend - delOp.rstart;
+                    delOp.rstart = rreg;
+                    break;
                 }
-            }
-            
-            gcMap[node] = color;
         }
+        newWaitHandler->pushDelayedOp(delOp);
     }
+    section.waitHandler = std::move(newWaitHandler);
 }
 
-void AsmRegAllocator::allocateRegisters(AsmSectionId sectionId)
+void AsmRegAllocator::clear()
 {
-    // before any operation, clear all
     codeBlocks.clear();
     for (size_t i = 0; i < MAX_REGTYPES_NUM; i++)
     {
@@ -737,17 +1826,90 @@ void AsmRegAllocator::allocateRegisters(AsmSectionId sectionId)
         interGraphs[i].clear();
         linearDepMaps[i].clear();
         graphColorMaps[i].clear();
+        regMoves[i].clear();
+        allocRegsNums[i] = 0;
+        spillCosts[i].clear();
+        spillUsages[i].clear();
+        spillSlots[i].clear();
+        spilledRegsNums[i] = 0;
     }
     ssaReplacesMap.clear();
+    removedMoves.clear();
+    errorMessages.clear();
+    codeOffsetMap.clear();
+    blockRegPressures.clear();
+    rregUsages.clear();
+}
+
+/* SSA data are created only for code reachable from start of section (other starts
+ * of code are not followed), hence register variables in other code
+ * can not be handled */
+bool AsmRegAllocator::checkReachableRegVars()
+{
+    for (const CodeBlock& cblock: codeBlocks)
+        for (const auto& ssaEntry: cblock.ssaInfoMap)
+            if (ssaEntry.first.regVar != nullptr && ssaEntry.second.ssaId == SIZE_MAX)
+            {
+                printError(cblock.start, "Register variables in code not reachable "
+                        "from start of code are not supported");
+                return false;
+            }
+    return true;
+}
+
+bool AsmRegAllocator::allocateRegisters(AsmSectionId sectionId)
+{
+    return allocateRegisters(assembler.sections[sectionId]);
+}
+
+bool AsmRegAllocator::allocateRegisters(AsmSection& section)
+{
+    // before any operation, clear all
+    clear();
     cxuint maxRegs[MAX_REGTYPES_NUM];
     assembler.isaAssembler->getMaxRegistersNum(regTypesNum, maxRegs);
     
     // set up
-    const AsmSection& section = assembler.sections[sectionId];
     createCodeStructure(section.codeFlow, section.content.size(), section.content.data());
     createSSAData(*section.usageHandler, *section.linearDepHandler);
+    if (!checkReachableRegVars())
+        return false;
     applySSAReplaces();
     createLivenesses(*section.usageHandler, *section.linearDepHandler);
     createInterferenceGraph();
+    coalesceRegMoves(*section.usageHandler, section.content.size(),
+                section.content.data());
+    if (canInsertCode(section))
+        createSpillCosts(*section.usageHandler, section);
     colorInterferenceGraph();
+    if (!applyAllocatedRegisters(*section.usageHandler, section.content.size(),
+                section.content.data()))
+        return false;
+    removeRedundantMoves(section);
+    applyRealRegisters(section);
+    if (spilledRegsNums[REGTYPE_SGPR] != 0 || spilledRegsNums[REGTYPE_VGPR] != 0 ||
+        !removedMoves.empty())
+        insertSpillCode(section);
+    return errorMessages.empty();
+}
+
+bool AsmRegAllocator::analyzeRegPressure(AsmSectionId sectionId)
+{
+    return analyzeRegPressure(assembler.sections[sectionId]);
+}
+
+bool AsmRegAllocator::analyzeRegPressure(AsmSection& section)
+{
+    clear();
+    cxuint maxRegs[MAX_REGTYPES_NUM];
+    assembler.isaAssembler->getMaxRegistersNum(regTypesNum, maxRegs);
+    
+    createCodeStructure(section.codeFlow, section.content.size(), section.content.data());
+    createSSAData(*section.usageHandler, *section.linearDepHandler);
+    if (!checkReachableRegVars())
+        return false;
+    applySSAReplaces();
+    createLivenesses(*section.usageHandler, *section.linearDepHandler);
+    createRegPressures();
+    return errorMessages.empty();
 }
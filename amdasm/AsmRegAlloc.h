@@ -216,50 +216,6 @@ struct CLRX_INTERNAL RoutineData
     { return weight_; }
 };
 
-struct CLRX_INTERNAL LastAccessBlockPos
-{
-    size_t blockIndex;
-    bool inSubroutines; // true if last access in some called subroutine
-    
-    bool operator==(const LastAccessBlockPos& v) const
-    { return blockIndex==v.blockIndex; }
-    bool operator!=(const LastAccessBlockPos& v) const
-    { return blockIndex!=v.blockIndex; }
-};
-
-struct CLRX_INTERNAL LastVRegStackPos
-{
-    size_t stackPos;
-    bool inSubroutines; // true if last access in some called subroutine
-};
-
-typedef std::unordered_map<AsmSingleVReg, VectorSet<LastAccessBlockPos> > LastAccessMap;
-typedef std::unordered_map<AsmSingleVReg, LastAccessBlockPos> RoutineCurAccessMap;
-class CLRX_INTERNAL LastStackPosMap
-        : public std::unordered_map<AsmSingleVReg, LastVRegStackPos>
-{
-public:
-    LastStackPosMap()
-    { }
-    
-    size_t weight() const
-    { return size(); }
-};
-
-// Routine data for createLivenesses - holds svreg read before writes and
-// last access of the svregs
-struct CLRX_INTERNAL RoutineDataLv
-{
-    SVRegMap rbwSSAIdMap;
-    // holds all vreg SSA's used in routine (used while creating call point)
-    // includes subroutines called in this routines
-    std::unordered_set<size_t> allSSAs[MAX_REGTYPES_NUM];
-    // key - svreg, value - list of the last codeblocks where is svreg
-    LastAccessMap lastAccessMap;
-    std::unordered_set<size_t> haveReturnBlocks;
-    bool fromSecondPass;
-};
-
 // used by createSSAData
 struct CLRX_INTERNAL FlowStackEntry
 {
@@ -277,25 +233,6 @@ struct CLRX_INTERNAL FlowStackEntry2
     size_t nextIndex;
 };
 
-
-// used by createLivenesses
-struct CLRX_INTERNAL FlowStackEntry3
-{
-    BlockIndex blockIndex;
-    size_t nextIndex;
-    bool isCall;
-    bool havePath;
-};
-
-struct CLRX_INTERNAL FlowStackEntry4
-{
-    size_t blockIndex;
-    size_t nextIndex;
-    bool isCall;
-    bool haveReturn;
-    RoutineCurAccessMap prevCurSVRegMap;
-};
-
 struct CLRX_INTERNAL CallStackEntry
 {
     BlockIndex callBlock; // index
@@ -304,7 +241,6 @@ struct CLRX_INTERNAL CallStackEntry
 };
 
 typedef std::unordered_map<BlockIndex, RoutineData> RoutineMap;
-typedef std::unordered_map<BlockIndex, RoutineDataLv> RoutineLvMap;
 
 typedef std::unordered_map<size_t, std::pair<size_t, size_t> > PrevWaysIndexMap;
 
@@ -428,67 +364,9 @@ struct CLRX_INTERNAL Liveness
 
 typedef AsmRegAllocator::VarIndexMap VarIndexMap;
 
-typedef std::deque<FlowStackEntry3>::const_iterator FlowStackCIter;
-
-// key - singlevreg, value - code block chain
-typedef std::unordered_map<AsmSingleVReg, std::vector<LastVRegStackPos> > LastVRegMap;
-
-struct CLRX_INTERNAL LiveBlock
-{
-    size_t start;
-    size_t end;
-    size_t vidx;
-    
-    bool operator==(const LiveBlock& b) const
-    { return start==b.start && end==b.end && vidx==b.vidx; }
-    
-    bool operator<(const LiveBlock& b) const
-    { return start<b.start || (start==b.start &&
-            (end<b.end || (end==b.end && vidx<b.vidx))); }
-};
-
 typedef AsmRegAllocator::LinearDep LinearDep;
 typedef std::unordered_map<size_t, LinearDep> LinearDepMap;
 
-typedef AsmRegAllocator::InterGraph InterGraph;
-
-struct CLRX_INTERNAL SDOLDOCompare
-{
-    const InterGraph& interGraph;
-    const Array<size_t>& sdoCounts;
-    
-    SDOLDOCompare(const InterGraph& _interGraph, const Array<size_t>&_sdoCounts)
-        : interGraph(_interGraph), sdoCounts(_sdoCounts)
-    { }
-    
-    bool operator()(size_t a, size_t b) const
-    {
-        if (sdoCounts[a] > sdoCounts[b])
-            return true;
-        return interGraph[a].size() > interGraph[b].size();
-    }
-};
-
-};
-
-namespace std
-{
-
-template<>
-struct hash<LastAccessBlockPos>
-{
-    typedef LastAccessBlockPos argument_type;    ///< argument type
-    typedef std::size_t result_type;    ///< result type
-    
-    /// a calling operator
-    size_t operator()(const LastAccessBlockPos& r1) const
-    {
-        std::hash<size_t> h1;
-        std::hash<bool> h2;
-        return h1(r1.blockIndex) ^ h2(r1.inSubroutines);
-    }
 };
 
-}
-
 #endif
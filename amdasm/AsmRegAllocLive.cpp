@@ -20,11 +20,9 @@
 #include <CLRX/Config.h>
 #include <assert.h>
 #include <iostream>
-#include <stack>
 #include <deque>
 #include <vector>
 #include <utility>
-#include <unordered_set>
 #include <unordered_map>
 #include <algorithm>
 #include <CLRX/utils/Utilities.h>
@@ -44,22 +42,80 @@ namespace CLRX
 
 struct CLRX_INTERNAL LivenessState
 {
-    const std::deque<FlowStackEntry3>& flowStack;
-    const std::vector<CodeBlock>& codeBlocks;
-    std::vector<bool>& waysToCache;
-    ResSecondPointsToCache& cblocksToCache;
-    PrevWaysIndexMap& prevWaysIndexMap;
     std::vector<Liveness>* livenesses;
     const VarIndexMap* vregIndexMaps;
-    std::unordered_map<size_t, VIdxSetEntry>& vidxCallMap;
-    std::unordered_map<size_t, VIdxSetEntry>& vidxRoutineMap;
-    RoutineLvMap& routineMap;
     size_t regTypesNum;
     const cxuint* regRanges;
 };
 
+/* dense bitsets over graph vregs (all register types, vidx shifted by
+ * base of the register type), one row per code block or per routine */
+class CLRX_INTERNAL LvBitSets
+{
+private:
+    size_t wordsNum;
+    Array<uint64_t> bits;
+public:
+    LvBitSets(size_t rowsNum = 0, size_t bitsNum = 0) : wordsNum((bitsNum+63)>>6),
+            bits(rowsNum*wordsNum)
+    { std::fill(bits.begin(), bits.end(), uint64_t(0)); }
+    
+    size_t getWordsNum() const
+    { return wordsNum; }
+    
+    uint64_t* operator[](size_t i)
+    { return bits.data() + i*wordsNum; }
+    const uint64_t* operator[](size_t i) const
+    { return bits.data() + i*wordsNum; }
+};
+
+/* state of the iterative backward dataflow solver.
+ * flow contexts: first is main code (from first code block), next are routines.
+ * body of context holds blocks reachable from its start without following calls */
+struct CLRX_INTERNAL LivenessDataFlow
+{
+    const std::vector<CodeBlock>& codeBlocks;
+    size_t gvregsNum;
+    // code blocks reachable from start and their postorder
+    std::vector<bool> reachable;
+    std::vector<size_t> postOrder;
+    // blocks whose live-out depends on live-in of the block
+    std::vector<std::vector<size_t> > dependents;
+    // key - routine block, value - flow context index
+    std::unordered_map<size_t, size_t> routineContexts;
+    std::vector<size_t> ctxStarts;
+    std::vector<std::vector<size_t> > ctxBodies; // blocks in postorder
+    std::vector<std::vector<size_t> > ctxCalls; // blocks with calls in body
+    std::vector<std::vector<size_t> > ctxCallees; // called routines (contexts)
+    LvBitSets genSets; // svregs read before write in block
+    LvBitSets killSets; // all graph vregs of svregs accessed in block
+    LvBitSets liveIns;
+    LvBitSets allVRegs; // single row with all graph vregs
+    // routine summaries: live-in at routine start if nothing or everything
+    // is live after return
+    LvBitSets routineLiveIns;
+    LvBitSets routineLiveThrough;
+    // all graph vregs of svregs accessed in routine (with called subroutines)
+    LvBitSets routineAccesses;
+    // live after return: svregs accessed in routine and live after its call points
+    LvBitSets routineLiveOuts;
+    // temporary flags for solver
+    std::vector<bool> inBody;
+    std::vector<bool> inWorkList;
+    
+    LivenessDataFlow(const std::vector<CodeBlock>& _codeBlocks, size_t _gvregsNum)
+            : codeBlocks(_codeBlocks), gvregsNum(_gvregsNum)
+    { }
+};
+
 };
 
+static inline bool haveFallThrough(const CodeBlock& cblock)
+{
+    return (cblock.nexts.empty() || cblock.haveCalls) &&
+            !cblock.haveReturn && !cblock.haveEnd;
+}
+
 static cxuint getRegType(size_t regTypesNum, const cxuint* regRanges,
             const AsmSingleVReg& svreg)
 {
@@ -93,10 +149,6 @@ static void getVIdx(const AsmSingleVReg& svreg, size_t ssaIdIdx,
     regType = getRegType(ls.regTypesNum, ls.regRanges, svreg); // regtype
     const VarIndexMap& vregIndexMap = ls.vregIndexMaps[regType];
     const std::vector<size_t>& vidxes = vregIndexMap.find(svreg)->second;
-    /*ARDOut << "lvn[" << regType << "][" << vidxes[ssaId] << "]. ssaIdIdx: " <<
-            ssaIdIdx << ". ssaId: " << ssaId << ". svreg: " << svreg.regVar << ":" <<
-            svreg.index << "\n";*/
-    //return livenesses[regType][ssaIdIndices[ssaId]];
     vidx = vidxes[ssaId];
 }
 
@@ -109,704 +161,6 @@ static inline Liveness& getLiveness(const AsmSingleVReg& svreg, size_t ssaIdIdx,
     return ls.livenesses[regType][vidx];
 }
 
-static void getVIdx2(const AsmSingleVReg& svreg, size_t ssaId, LivenessState& ls,
-        cxuint& regType, size_t& vidx)
-{
-    regType = getRegType(ls.regTypesNum, ls.regRanges, svreg); // regtype
-    const VarIndexMap& vregIndexMap = ls.vregIndexMaps[regType];
-    const std::vector<size_t>& vidxes = vregIndexMap.find(svreg)->second;
-    /*ARDOut << "lvn[" << regType << "][" << vidxes[ssaId] << "]. ssaId: " <<
-            ssaId << ". svreg: " << svreg.regVar << ":" << svreg.index << "\n";*/
-    vidx = vidxes[ssaId];
-}
-
-
-static void addVIdxToCallEntry(size_t blockIndex, cxuint regType, size_t vidx,
-                LivenessState& ls)
-{
-    const CodeBlock& cblock = ls.codeBlocks[blockIndex];
-    if (cblock.haveCalls)
-    {
-        VIdxSetEntry& varCallEntry = ls.vidxCallMap[blockIndex];
-        for (const NextBlock& next: cblock.nexts)
-            if (next.isCall)
-            {
-                auto vidxRIt = ls.vidxRoutineMap.find(next.block);
-                if (vidxRIt == ls.vidxRoutineMap.end())
-                    continue;
-                const auto& allLvs = vidxRIt->second;
-                if (allLvs.vs[regType].find(vidx) == allLvs.vs[regType].end())
-                    // add callLiveTime only if vreg not present in routine
-                    varCallEntry.vs[regType].insert(vidx);
-            }
-    }
-}
-
-static void fillUpInsideRoutine(LivenessState& ls,
-            size_t startBlock, size_t routineBlock, const AsmSingleVReg& svreg,
-            Liveness& lv, cxuint lvRType /* lv register type */, size_t vidx,
-            size_t ssaId, const RoutineDataLv& rdata,
-            std::unordered_set<size_t>& havePathBlocks)
-{
-    const std::unordered_set<size_t>& haveReturnBlocks = rdata.haveReturnBlocks;
-    std::deque<FlowStackEntry3> flowStack;
-    std::unordered_set<size_t> visited;
-    
-    flowStack.push_back({ startBlock, 0 });
-    
-    size_t startSSAId = ssaId;
-    bool fromStartPos = false;
-    // determine first SSAId and whether filling should begin from start of the routine
-    if (routineBlock == startBlock)
-    {
-        const CodeBlock& cblock = ls.codeBlocks[startBlock];
-        auto sinfoIt = binaryMapFind(cblock.ssaInfoMap.begin(),
-                cblock.ssaInfoMap.end(), svreg);
-        
-        auto rbwIt = rdata.rbwSSAIdMap.find(svreg);
-        if (sinfoIt != cblock.ssaInfoMap.end())
-        {
-            const SSAInfo& sinfo = sinfoIt->second;
-            if (sinfo.readBeforeWrite && sinfo.ssaIdBefore==ssaId)
-                // if ssaId is first read, then we assume start at routine start pos
-                fromStartPos = true;
-            else if (sinfo.ssaIdChange == 0 || sinfo.ssaIdLast != ssaId)
-                // do nothing (last SSAId doesnt match or no change
-                return;
-        }
-        else if (rbwIt != rdata.rbwSSAIdMap.end())
-        {
-            fromStartPos = true;
-            startSSAId = rbwIt->second;
-        }
-        else
-            return; // do nothing
-    }
-    if (startSSAId != ssaId)
-        return; // also, do nothing
-    
-    while (!flowStack.empty())
-    {
-        FlowStackEntry3& entry = flowStack.back();
-        const CodeBlock& cblock = ls.codeBlocks[entry.blockIndex.index];
-        
-        bool endOfPath = false;
-        if (entry.nextIndex == 0)
-        {
-            if (visited.insert(entry.blockIndex.index).second &&
-                haveReturnBlocks.find(entry.blockIndex.index) != haveReturnBlocks.end())
-            {
-                auto sinfoIt = binaryMapFind(cblock.ssaInfoMap.begin(),
-                            cblock.ssaInfoMap.end(), svreg);
-                if (flowStack.size() > 1 && sinfoIt != cblock.ssaInfoMap.end())
-                {
-                    if (!sinfoIt->second.readBeforeWrite)
-                    {
-                        // no read before write skip this path
-                        flowStack.pop_back();
-                        continue;
-                    }
-                    else
-                        // we end path at first read
-                        endOfPath = true;
-                }
-            }
-            else
-            {
-                const bool prevPath = havePathBlocks.find(entry.blockIndex.index) !=
-                        havePathBlocks.end();
-                flowStack.pop_back();
-                // propagate haveReturn to previous block
-                if (prevPath)
-                {
-                    flowStack.back().havePath = true;
-                    havePathBlocks.insert(flowStack.back().blockIndex.index);
-                }
-                continue;
-            }
-        }
-        
-        // skip calls
-        if (!endOfPath)
-            for (; entry.nextIndex < cblock.nexts.size() &&
-                    cblock.nexts[entry.nextIndex].isCall; entry.nextIndex++);
-        
-        if (!endOfPath && entry.nextIndex < cblock.nexts.size())
-        {
-            flowStack.push_back({ cblock.nexts[entry.nextIndex].block, 0 });
-            entry.nextIndex++;
-        }
-        else if (!endOfPath &&
-            ((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            flowStack.push_back({ entry.blockIndex+1, 0 });
-            entry.nextIndex++;
-        }
-        else
-        {
-            if (endOfPath || cblock.haveReturn)
-            {
-                havePathBlocks.insert(entry.blockIndex.index);
-                // we have path only if have return and if have path
-                entry.havePath = true;
-            }
-            
-            const bool curHavePath = entry.havePath;
-            if (curHavePath)
-            {
-                // fill up block when in path
-                auto sinfoIt = binaryMapFind(cblock.ssaInfoMap.begin(),
-                            cblock.ssaInfoMap.end(), svreg);
-                size_t cbStart = cblock.start;
-                size_t cbEnd = cblock.end;
-                if (flowStack.size() == 1 && !fromStartPos)
-                {
-                    // if first block, then get last occurrence in this path
-                    if (sinfoIt != cblock.ssaInfoMap.end())
-                        cbStart = sinfoIt->second.lastPos+1;
-                }
-                if (endOfPath && sinfoIt != cblock.ssaInfoMap.end())
-                    cbEnd = sinfoIt->second.firstPos+1;
-                // fill up block
-                lv.insert(cbStart, cbEnd);
-                if (cblock.end == cbEnd)
-                    addVIdxToCallEntry(entry.blockIndex.index, lvRType, vidx, ls);
-            }
-            
-            // back
-            flowStack.pop_back();
-            // propagate havePath
-            if (!flowStack.empty())
-            {
-                if (curHavePath)
-                    havePathBlocks.insert(flowStack.back().blockIndex.index);
-                flowStack.back().havePath |= curHavePath;
-            }
-        }
-    }
-}
-
-static void joinVRegRecur(LivenessState& ls, LastVRegStackPos flowStkStart,
-            const AsmSingleVReg& svreg, size_t ssaId, bool skipLastBlock = false)
-{
-    struct JoinEntry
-    {
-        size_t blockIndex; // block index where is call
-        size_t nextIndex; // next index of routine call
-        size_t lastAccessIndex; // last access pos index
-        bool inSubroutines;
-        size_t routineBlock;
-        const RoutineDataLv* rdata;
-    };
-    
-    std::unordered_set<LastAccessBlockPos> visited;
-    std::unordered_set<size_t> havePathBlocks;
-    
-    FlowStackCIter flitEnd = ls.flowStack.end();
-    if (skipLastBlock)
-        --flitEnd; // before last element
-    cxuint lvRegType;
-    size_t vidx;
-    getVIdx2(svreg, ssaId, ls, lvRegType, vidx);
-    Liveness& lv = ls.livenesses[lvRegType][vidx];
-    
-    std::stack<JoinEntry> rjStack; // routine join stack
-    if (flowStkStart.inSubroutines)
-        rjStack.push({ ls.flowStack[flowStkStart.stackPos].blockIndex.index,
-                            0, 0, true, SIZE_MAX, nullptr });
-    
-    while (!rjStack.empty())
-    {
-        JoinEntry& entry = rjStack.top();
-        const CodeBlock& cblock = ls.codeBlocks[entry.blockIndex];
-        
-        if (entry.inSubroutines && entry.nextIndex < cblock.nexts.size())
-        {
-            bool doNextIndex = false; // true if to next call
-            if (cblock.nexts[entry.nextIndex].isCall)
-            {
-                const size_t routineBlock = cblock.nexts[entry.nextIndex].block;
-                const RoutineDataLv& rdata =
-                        ls.routineMap.find(routineBlock)->second;
-                auto lastAccessIt = rdata.lastAccessMap.find(svreg);
-                if (lastAccessIt != rdata.lastAccessMap.end())
-                {
-                    if (entry.lastAccessIndex < lastAccessIt->second.size())
-                    {
-                        // we have new path in subroutine to fill
-                        const auto& lastAccess =
-                                lastAccessIt->second[entry.lastAccessIndex];
-                        
-                        if (visited.insert(lastAccess).second)
-                            rjStack.push({ lastAccess.blockIndex, 0, 0,
-                                    lastAccess.inSubroutines, routineBlock, &rdata });
-                        
-                        entry.lastAccessIndex++;
-                        if (entry.lastAccessIndex == lastAccessIt->second.size())
-                            doNextIndex = true;
-                    }
-                    else
-                        doNextIndex = true;
-                }
-                else
-                    doNextIndex = true;
-            }
-            else
-                doNextIndex = true;
-            
-            if (doNextIndex)
-            {
-                // to next call
-                entry.nextIndex++;
-                entry.lastAccessIndex = 0;
-            }
-        }
-        else
-        {
-            // fill up next block in path (do not fill start block)
-            /* if inSubroutines, then first block
-             * (that with subroutines calls) will be skipped */
-            if (rjStack.size() > 1)
-                fillUpInsideRoutine(ls, entry.blockIndex + (entry.inSubroutines),
-                        entry.routineBlock, svreg, lv, lvRegType, vidx, ssaId,
-                        *entry.rdata, havePathBlocks);
-            rjStack.pop();
-        }
-    }
-    
-    auto flit = ls.flowStack.begin() + flowStkStart.stackPos;
-    // applyVIdx to call entry (if needed, and if some join inside subroutines)
-    // resolve this vidx before these call point and if nexts>1
-    if (flowStkStart.inSubroutines &&
-        lv.contain(ls.codeBlocks[flit->blockIndex.index].end-1) &&
-        ls.codeBlocks[flit->blockIndex.index].nexts.size() > 1)
-        // just apply, only if join before call
-        addVIdxToCallEntry(flit->blockIndex.index, lvRegType, vidx, ls);
-    
-    if (flowStkStart.inSubroutines)
-        ++flit; // skip this codeblock before call
-    
-    const CodeBlock& lastBlk = ls.codeBlocks[flit->blockIndex.index];
-    if (flit != flitEnd)
-    {
-        auto sinfoIt = binaryMapFind(lastBlk.ssaInfoMap.begin(),
-                    lastBlk.ssaInfoMap.end(), svreg);
-        size_t lastPos = lastBlk.start;
-        if (sinfoIt != lastBlk.ssaInfoMap.end())
-        {
-            if (flit->nextIndex > lastBlk.nexts.size())
-                // only if pass this routine
-                addVIdxToCallEntry(flit->blockIndex.index, lvRegType, vidx, ls);
-            // if begin at some point at last block
-            lastPos = sinfoIt->second.lastPos;
-            lv.insert(lastPos + 1, lastBlk.end);
-            ++flit; // skip last block in stack
-        }
-    }
-    // fill up to this
-    for (; flit != flitEnd; ++flit)
-    {
-        const CodeBlock& cblock = ls.codeBlocks[flit->blockIndex.index];
-        if (flit->nextIndex > cblock.nexts.size())
-            // only if pass this routine
-            addVIdxToCallEntry(flit->blockIndex.index, lvRegType, vidx, ls);
-        lv.insert(cblock.start, cblock.end);
-    }
-}
-
-/* handle many start points in this code (for example many kernel's in same code)
- * replace sets by vector, and sort and remove same values on demand
- */
-
-/* join livenesses between consecutive code blocks */
-static void putCrossBlockLivenesses(LivenessState& ls, const LastVRegMap& lastVRegMap)
-{
-    ARDOut << "putCrossBlockLv block: " << ls.flowStack.back().blockIndex << "\n";
-    const CodeBlock& cblock = ls.codeBlocks[ls.flowStack.back().blockIndex.index];
-    for (const auto& entry: cblock.ssaInfoMap)
-        if (entry.second.readBeforeWrite)
-        {
-            // find last
-            auto lvrit = lastVRegMap.find(entry.first);
-            LastVRegStackPos flowStackStart = (lvrit != lastVRegMap.end()) ?
-                lvrit->second.back() : LastVRegStackPos{ 0, false };
-            
-            joinVRegRecur(ls, flowStackStart, entry.first, entry.second.ssaIdBefore, true);
-        }
-}
-
-// add new join second cache entry with readBeforeWrite for all encountered regvars
-static void addJoinSecCacheEntry(LivenessState& ls,
-                SimpleCache<size_t, SVRegMap>& joinSecondPointsCache,
-                size_t nextBlock)
-{
-    ARDOut << "addJoinSecCacheEntry: " << nextBlock << "\n";
-    //std::stack<CallStackEntry> callStack = prevCallStack;
-    // traverse by graph from next block
-    std::deque<FlowStackEntry3> flowStack;
-    flowStack.push_back({ nextBlock, 0 });
-    std::unordered_set<size_t> visited;
-    
-    // already read in current path
-    // key - vreg, value - source block where vreg of conflict found
-    SVRegBlockMap alreadyReadMap;
-    SVRegMap cacheSecPoints;
-    
-    while (!flowStack.empty())
-    {
-        FlowStackEntry3& entry = flowStack.back();
-        const CodeBlock& cblock = ls.codeBlocks[entry.blockIndex.index];
-        
-        if (entry.nextIndex == 0)
-        {
-            // process current block
-            if (visited.insert(entry.blockIndex.index).second)
-            {
-                ARDOut << "  resolv (cache): " << entry.blockIndex << "\n";
-                
-                const SVRegMap* resSecondPoints =
-                            joinSecondPointsCache.use(entry.blockIndex.index);
-                if (resSecondPoints == nullptr)
-                {
-                    // if joinSecondPointCache not found
-                    for (auto& sentry: cblock.ssaInfoMap)
-                    {
-                        const SSAInfo& sinfo = sentry.second;
-                        auto res = alreadyReadMap.insert(
-                                    { sentry.first, entry.blockIndex });
-                        
-                        if (res.second && sinfo.readBeforeWrite)
-                            cacheSecPoints[sentry.first] = sinfo.ssaIdBefore;
-                    }
-                }
-                else // to use cache
-                {
-                    // add to current cache sec points
-                    for (const auto& rsentry: *resSecondPoints)
-                    {
-                        const bool alreadyRead =
-                            alreadyReadMap.find(rsentry.first) != alreadyReadMap.end();
-                        if (!alreadyRead)
-                            cacheSecPoints[rsentry.first] = rsentry.second;
-                    }
-                    flowStack.pop_back();
-                    continue;
-                }
-            }
-            else
-            {
-                // back, already visited
-                ARDOut << "join already (cache): " << entry.blockIndex << "\n";
-                flowStack.pop_back();
-                continue;
-            }
-        }
-        
-        if (entry.nextIndex < cblock.nexts.size())
-        {
-            flowStack.push_back({ cblock.nexts[entry.nextIndex].block, 0 });
-            entry.nextIndex++;
-        }
-        else if (((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            // add alreadyReadMap ssaIds inside called routines
-            for (const auto& next: cblock.nexts)
-                if (next.isCall)
-                {
-                    const RoutineDataLv& rdata = ls.routineMap.find(next.block)->second;
-                    for (const auto& v: rdata.rbwSSAIdMap)
-                        alreadyReadMap.insert({v.first, entry.blockIndex });
-                    for (const auto& v: rdata.lastAccessMap)
-                        alreadyReadMap.insert({v.first, entry.blockIndex });
-                }
-            
-            flowStack.push_back({ entry.blockIndex+1, 0 });
-            entry.nextIndex++;
-        }
-        else // back
-        {
-            // remove old to resolve in leaved way to allow collecting next ssaId
-            // before write (can be different due to earlier visit)
-            for (const auto& next: cblock.nexts)
-                if (next.isCall)
-                {
-                    const RoutineDataLv& rdata = ls.routineMap.find(next.block)->second;
-                    for (const auto& v: rdata.rbwSSAIdMap)
-                    {
-                        auto it = alreadyReadMap.find(v.first);
-                        if (it != alreadyReadMap.end() && it->second == entry.blockIndex)
-                            alreadyReadMap.erase(it);
-                    }
-                    for (const auto& v: rdata.lastAccessMap)
-                    {
-                        auto it = alreadyReadMap.find(v.first);
-                        if (it != alreadyReadMap.end() && it->second == entry.blockIndex)
-                            alreadyReadMap.erase(it);
-                    }
-                }
-            
-            for (const auto& sentry: cblock.ssaInfoMap)
-            {
-                auto it = alreadyReadMap.find(sentry.first);
-                if (it != alreadyReadMap.end() && it->second == entry.blockIndex)
-                    // remove old to resolve in leaved way to allow collecting next ssaId
-                    // before write (can be different due to earlier visit)
-                    alreadyReadMap.erase(it);
-            }
-            ARDOut << "  popjoin (cache)\n";
-            flowStack.pop_back();
-        }
-    }
-    
-    joinSecondPointsCache.put(nextBlock, cacheSecPoints);
-}
-
-// apply calls (changes from these calls) from code blocks to stack var map
-static void applyCallToStackVarMap(const CodeBlock& cblock, const RoutineLvMap& routineMap,
-        LastStackPosMap& stackVarMap, size_t pfPos, size_t nextIndex)
-{
-    for (const NextBlock& next: cblock.nexts)
-        if (next.isCall)
-        {
-            ARDOut << "  japplycall: " << pfPos << ": " <<
-                    nextIndex << ": " << next.block << "\n";
-            const LastAccessMap& regVarMap =
-                    routineMap.find(next.block)->second.lastAccessMap;
-            for (const auto& sentry: regVarMap)
-            {
-                // MSVC error fix
-                auto& v = stackVarMap[sentry.first];
-                v = LastVRegStackPos{ pfPos, true };
-            }
-        }
-}
-
-static void joinRegVarLivenesses(LivenessState& ls,
-        SimpleCache<size_t, LastStackPosMap>& joinFirstPointsCache,
-        SimpleCache<size_t, SVRegMap>& joinSecondPointsCache)
-{
-    size_t nextBlock = ls.flowStack.back().blockIndex.index;
-    auto pfEnd = ls.flowStack.end();
-    --pfEnd;
-    ARDOut << "startJoinLv: " << (pfEnd-1)->blockIndex << "," << nextBlock << "\n";
-    // key - varreg, value - last position in previous flowStack
-    LastStackPosMap stackVarMap;
-    
-    size_t pfStartIndex = 0;
-    {
-        auto pfPrev = pfEnd;
-        --pfPrev;
-        auto it = ls.prevWaysIndexMap.find(pfPrev->blockIndex.index);
-        if (it != ls.prevWaysIndexMap.end())
-        {
-            const LastStackPosMap* cached = joinFirstPointsCache.use(it->second.first);
-            if (cached!=nullptr)
-            {
-                ARDOut << "use pfcached: " << it->second.first << ", " <<
-                        it->second.second << "\n";
-                stackVarMap = *cached;
-                pfStartIndex = it->second.second+1;
-                
-                // apply missing calls at end of the cached
-                const CodeBlock& cblock = ls.codeBlocks[it->second.first];
-                
-                const FlowStackEntry3& entry = *(ls.flowStack.begin()+pfStartIndex-1);
-                if (entry.nextIndex > cblock.nexts.size())
-                    applyCallToStackVarMap(cblock, ls.routineMap, stackVarMap,
-                                    pfStartIndex-1, -1);
-            }
-        }
-    }
-    
-    // collect previous svreg from current path
-    for (auto pfit = ls.flowStack.begin()+pfStartIndex; pfit != pfEnd; ++pfit)
-    {
-        const FlowStackEntry3& entry = *pfit;
-        const CodeBlock& cblock = ls.codeBlocks[entry.blockIndex.index];
-        for (const auto& sentry: cblock.ssaInfoMap)
-        {
-            // MSVC error fix
-            auto& v = stackVarMap[sentry.first];
-            v = { size_t(pfit - ls.flowStack.begin()), false };
-        }
-        
-        if (entry.nextIndex > cblock.nexts.size())
-            applyCallToStackVarMap(cblock, ls.routineMap, stackVarMap,
-                        pfit - ls.flowStack.begin(), entry.nextIndex);
-        
-        // put to first point cache
-        if (ls.waysToCache[pfit->blockIndex.index] &&
-            !joinFirstPointsCache.hasKey(pfit->blockIndex.index))
-        {
-            ARDOut << "put pfcache " << pfit->blockIndex << "\n";
-            joinFirstPointsCache.put(pfit->blockIndex.index, stackVarMap);
-        }
-    }
-    
-    SVRegMap cacheSecPoints;
-    const bool toCache = (!joinSecondPointsCache.hasKey(nextBlock)) &&
-                ls.cblocksToCache.count(nextBlock)>=2;
-    
-    // traverse by graph from next block
-    std::deque<FlowStackEntry3> flowStack;
-    flowStack.push_back({ nextBlock, 0 });
-    std::vector<bool> visited(ls.codeBlocks.size(), false);
-    
-    // already read in current path
-    // key - vreg, value - source block where vreg of conflict found
-    SVRegMap alreadyReadMap;
-    
-    while (!flowStack.empty())
-    {
-        FlowStackEntry3& entry = flowStack.back();
-        const CodeBlock& cblock = ls.codeBlocks[entry.blockIndex.index];
-        
-        if (entry.nextIndex == 0)
-        {
-            // process current block
-            if (!visited[entry.blockIndex.index])
-            {
-                visited[entry.blockIndex.index] = true;
-                ARDOut << "  lvjoin: " << entry.blockIndex << "\n";
-                
-                const SVRegMap* joinSecondPoints =
-                        joinSecondPointsCache.use(entry.blockIndex.index);
-                
-                if (joinSecondPoints == nullptr)
-                    for (const auto& sentry: cblock.ssaInfoMap)
-                    {
-                        const SSAInfo& sinfo = sentry.second;
-                        auto res = alreadyReadMap.insert(
-                                    { sentry.first, entry.blockIndex.index });
-                        
-                        if (toCache)
-                            cacheSecPoints[sentry.first] = sinfo.ssaIdBefore;
-                        
-                        if (res.second && sinfo.readBeforeWrite)
-                        {
-                            auto it = stackVarMap.find(sentry.first);
-                            LastVRegStackPos stackPos = (it != stackVarMap.end() ?
-                                        it->second : LastVRegStackPos{ 0, false });
-                            
-                            joinVRegRecur(ls, stackPos, sentry.first,
-                                sentry.second.ssaIdBefore, true);
-                        }
-                    }
-                else
-                {
-                    ARDOut << "use join secPointCache: " << entry.blockIndex << "\n";
-                    // add to current cache sec points
-                    for (const auto& rsentry: *joinSecondPoints)
-                    {
-                        const bool alreadyRead =
-                            alreadyReadMap.find(rsentry.first) != alreadyReadMap.end();
-                        
-                        if (!alreadyRead)
-                        {
-                            if (toCache)
-                                cacheSecPoints[rsentry.first] = rsentry.second;
-                            
-                            auto it = stackVarMap.find(rsentry.first);
-                            LastVRegStackPos stackPos = (it != stackVarMap.end() ?
-                                        it->second : LastVRegStackPos{ 0, false });
-                            
-                            joinVRegRecur(ls, stackPos, rsentry.first,
-                                          rsentry.second, true);
-                        }
-                    }
-                    flowStack.pop_back();
-                    continue;
-                }
-            }
-            else
-            {
-                ls.cblocksToCache.increase(entry.blockIndex);
-                ARDOut << "jcblockToCache: " << entry.blockIndex << "=" <<
-                            ls.cblocksToCache.count(entry.blockIndex) << "\n";
-                // back, already visited
-                ARDOut << "join already: " << entry.blockIndex << "\n";
-                flowStack.pop_back();
-                continue;
-            }
-        }
-        
-        if (entry.nextIndex < cblock.nexts.size())
-        {
-            flowStack.push_back({ cblock.nexts[entry.nextIndex].block, 0 });
-            entry.nextIndex++;
-        }
-        else if (((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            // add alreadReadMap ssaIds inside called routines
-            for (const auto& next: cblock.nexts)
-                if (next.isCall)
-                {
-                    const RoutineDataLv& rdata = ls.routineMap.find(next.block)->second;
-                    for (const auto& v: rdata.rbwSSAIdMap)
-                        alreadyReadMap.insert({v.first, entry.blockIndex.index });
-                    for (const auto& v: rdata.lastAccessMap)
-                        alreadyReadMap.insert({v.first, entry.blockIndex.index });
-                }
-            
-            flowStack.push_back({ entry.blockIndex+1, 0 });
-            entry.nextIndex++;
-        }
-        else // back
-        {
-            // remove old to resolve in leaved way to allow collecting next ssaId
-            // before write (can be different due to earlier visit)
-            for (const auto& next: cblock.nexts)
-                if (next.isCall)
-                {
-                    const RoutineDataLv& rdata = ls.routineMap.find(next.block)->second;
-                    for (const auto& v: rdata.rbwSSAIdMap)
-                    {
-                        auto it = alreadyReadMap.find(v.first);
-                        if (it != alreadyReadMap.end() &&
-                            it->second == entry.blockIndex.index)
-                            alreadyReadMap.erase(it);
-                    }
-                    for (const auto& v: rdata.lastAccessMap)
-                    {
-                        auto it = alreadyReadMap.find(v.first);
-                        if (it != alreadyReadMap.end() &&
-                            it->second == entry.blockIndex.index)
-                            alreadyReadMap.erase(it);
-                    }
-                }
-            
-            for (const auto& sentry: cblock.ssaInfoMap)
-            {
-                auto it = alreadyReadMap.find(sentry.first);
-                if (it != alreadyReadMap.end() && it->second == entry.blockIndex.index)
-                    // remove old to resolve in leaved way to allow collecting next ssaId
-                    // before write (can be different due to earlier visit)
-                    alreadyReadMap.erase(it);
-            }
-            ARDOut << "  popjoin\n";
-            
-            if (ls.cblocksToCache.count(entry.blockIndex)==2 &&
-                !joinSecondPointsCache.hasKey(entry.blockIndex.index))
-                // add to cache
-                addJoinSecCacheEntry(ls, joinSecondPointsCache, entry.blockIndex.index);
-            
-            flowStack.pop_back();
-        }
-    }
-    
-    if (toCache)
-        joinSecondPointsCache.put(nextBlock, cacheSecPoints);
-}
-
 static bool addUsageDeps(const cxbyte* ldeps, const std::vector<AsmRegVarUsage>& rvus,
             const std::vector<AsmRegVarLinearDep>& instrLinDeps, LinearDepMap* ldepsOut,
             Array<std::pair<AsmSingleVReg, SSAInfo> >& ssaInfoMap,
@@ -941,260 +295,394 @@ static bool addUsageDeps(const cxbyte* ldeps, const std::vector<AsmRegVarUsage>&
         // add from linear deps for read vidxes (prevVidxes)
         if (haveReadVidxes)
         {
-            ldepsOut[regType][prevVidxes[0]].align = 
-                std::max(ldepsOut[regType][prevVidxes[0]].align, cxbyte(0));
-            for (size_t j = 1; j < prevVidxes.size(); j++)
+            ldepsOut[regType][prevVidxes[0]].align = 
+                std::max(ldepsOut[regType][prevVidxes[0]].align, cxbyte(0));
+            for (size_t j = 1; j < prevVidxes.size(); j++)
+            {
+                ldepsOut[regType][prevVidxes[j-1]].nextVidxes.insertValue(prevVidxes[j]);
+                ldepsOut[regType][prevVidxes[j]].prevVidxes.insertValue(prevVidxes[j-1]);
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * iterative backward dataflow over code blocks
+ */
+
+static inline bool orBits(uint64_t* dest, const uint64_t* src, size_t wordsNum)
+{
+    bool changed = false;
+    for (size_t k = 0; k < wordsNum; k++)
+    {
+        const uint64_t v = dest[k] | src[k];
+        changed |= (v != dest[k]);
+        dest[k] = v;
+    }
+    return changed;
+}
+
+static inline bool copyBits(uint64_t* dest, const uint64_t* src, size_t wordsNum)
+{
+    bool changed = false;
+    for (size_t k = 0; k < wordsNum; k++)
+    {
+        changed |= (src[k] != dest[k]);
+        dest[k] = src[k];
+    }
+    return changed;
+}
+
+/* collect code blocks reachable from first block, their postorder,
+ * flow contexts (main code and routines) and dependencies between
+ * live-ins and live-outs */
+static void createLvFlowStructure(LivenessDataFlow& df)
+{
+    const std::vector<CodeBlock>& codeBlocks = df.codeBlocks;
+    const size_t blocksNum = codeBlocks.size();
+    df.reachable.assign(blocksNum, false);
+    df.dependents.resize(blocksNum);
+    if (blocksNum == 0)
+        return;
+    
+    // DFS: calls are followed like any other next block
+    df.ctxStarts.push_back(0);
+    std::deque<FlowStackEntry2> flowStack;
+    flowStack.push_back({ 0, 0 });
+    df.reachable[0] = true;
+    while (!flowStack.empty())
+    {
+        FlowStackEntry2& entry = flowStack.back();
+        const CodeBlock& cblock = codeBlocks[entry.blockIndex];
+        size_t nextBlock;
+        if (entry.nextIndex < cblock.nexts.size())
+        {
+            const NextBlock& next = cblock.nexts[entry.nextIndex];
+            nextBlock = next.block;
+            if (next.isCall && df.routineContexts.insert(
+                        { nextBlock, df.ctxStarts.size() }).second)
+                df.ctxStarts.push_back(nextBlock);
+        }
+        else if (entry.nextIndex == cblock.nexts.size() && haveFallThrough(cblock) &&
+                entry.blockIndex+1 < blocksNum)
+            nextBlock = entry.blockIndex+1;
+        else
+        {
+            // back
+            df.postOrder.push_back(entry.blockIndex);
+            flowStack.pop_back();
+            continue;
+        }
+        entry.nextIndex++;
+        if (!df.reachable[nextBlock])
+        {
+            df.reachable[nextBlock] = true;
+            flowStack.push_back({ nextBlock, 0 });
+        }
+    }
+    
+    std::vector<size_t> postIndices(blocksNum, SIZE_MAX);
+    for (size_t i = 0; i < df.postOrder.size(); i++)
+        postIndices[df.postOrder[i]] = i;
+    
+    for (size_t bi: df.postOrder)
+    {
+        const CodeBlock& cblock = codeBlocks[bi];
+        for (const NextBlock& next: cblock.nexts)
+            if (!next.isCall)
+                df.dependents[next.block].push_back(bi);
+        if (haveFallThrough(cblock) && bi+1 < blocksNum)
+            df.dependents[bi+1].push_back(bi);
+    }
+    
+    // bodies of flow contexts
+    const size_t ctxNum = df.ctxStarts.size();
+    df.ctxBodies.resize(ctxNum);
+    df.ctxCalls.resize(ctxNum);
+    df.ctxCallees.resize(ctxNum);
+    std::vector<bool> inBody(blocksNum, false);
+    for (size_t ctx = 0; ctx < ctxNum; ctx++)
+    {
+        std::vector<size_t>& body = df.ctxBodies[ctx];
+        std::vector<size_t>& callees = df.ctxCallees[ctx];
+        std::vector<size_t> blockStack;
+        blockStack.push_back(df.ctxStarts[ctx]);
+        inBody[df.ctxStarts[ctx]] = true;
+        while (!blockStack.empty())
+        {
+            const size_t bi = blockStack.back();
+            blockStack.pop_back();
+            body.push_back(bi);
+            const CodeBlock& cblock = codeBlocks[bi];
+            if (cblock.haveCalls)
+                df.ctxCalls[ctx].push_back(bi);
+            for (const NextBlock& next: cblock.nexts)
+                if (next.isCall)
+                    callees.push_back(df.routineContexts.find(next.block)->second);
+                else if (!inBody[next.block])
+                {
+                    inBody[next.block] = true;
+                    blockStack.push_back(next.block);
+                }
+            if (haveFallThrough(cblock) && bi+1 < blocksNum && !inBody[bi+1])
             {
-                ldepsOut[regType][prevVidxes[j-1]].nextVidxes.insertValue(prevVidxes[j]);
-                ldepsOut[regType][prevVidxes[j]].prevVidxes.insertValue(prevVidxes[j-1]);
+                inBody[bi+1] = true;
+                blockStack.push_back(bi+1);
             }
         }
+        for (size_t bi: body)
+            inBody[bi] = false;
+        std::sort(body.begin(), body.end(), [&postIndices](size_t b1, size_t b2)
+                { return postIndices[b1] < postIndices[b2]; });
+        std::sort(callees.begin(), callees.end());
+        callees.resize(std::unique(callees.begin(), callees.end()) - callees.begin());
     }
-    return true;
 }
 
-static void joinRoutineDataLv(RoutineDataLv& dest, VIdxSetEntry& destVars,
-            RoutineCurAccessMap& curSVRegMap, FlowStackEntry4& entry,
-            const RoutineDataLv& src, const VIdxSetEntry& srcVars)
+// retLiveOut - live-out of blocks with return
+static void computeLiveOut(const LivenessDataFlow& df, size_t blockIndex,
+            const uint64_t* retLiveOut, uint64_t* liveOut)
+{
+    const size_t wordsNum = df.liveIns.getWordsNum();
+    const CodeBlock& cblock = df.codeBlocks[blockIndex];
+    std::fill(liveOut, liveOut + wordsNum, uint64_t(0));
+    
+    for (const NextBlock& next: cblock.nexts)
+        if (!next.isCall)
+            orBits(liveOut, df.liveIns[next.block], wordsNum);
+    
+    const uint64_t* afterCall = (haveFallThrough(cblock) &&
+            blockIndex+1 < df.codeBlocks.size()) ? df.liveIns[blockIndex+1] : nullptr;
+    if (cblock.haveCalls)
+    {
+        // apply summaries of called routines
+        for (const NextBlock& next: cblock.nexts)
+            if (next.isCall)
+            {
+                const size_t r = df.routineContexts.find(next.block)->second;
+                const uint64_t* rLiveIn = df.routineLiveIns[r];
+                const uint64_t* rLiveThrough = df.routineLiveThrough[r];
+                for (size_t k = 0; k < wordsNum; k++)
+                    liveOut[k] |= rLiveIn[k] |
+                            (afterCall != nullptr ? afterCall[k] & rLiveThrough[k] : 0);
+            }
+    }
+    else if (afterCall != nullptr)
+        orBits(liveOut, afterCall, wordsNum);
+    
+    if (cblock.haveReturn && retLiveOut != nullptr)
+        orBits(liveOut, retLiveOut, wordsNum);
+}
+
+/* solve liveness inside body of flow context. worklist is initialized
+ * by postorder (reverse postorder of reversed flow graph) */
+static void solveLivenesses(LivenessDataFlow& df, size_t ctx, const uint64_t* retLiveOut)
 {
-    dest.rbwSSAIdMap.insert(src.rbwSSAIdMap.begin(), src.rbwSSAIdMap.end());
-    for (size_t i = 0; i < MAX_REGTYPES_NUM; i++)
-        destVars.vs[i].insert(srcVars.vs[i].begin(), srcVars.vs[i].end());
+    const size_t wordsNum = df.liveIns.getWordsNum();
+    const std::vector<size_t>& body = df.ctxBodies[ctx];
+    std::vector<bool>& inBody = df.inBody;
+    std::vector<bool>& inWorkList = df.inWorkList;
+    std::deque<size_t> workList;
+    for (size_t bi: body)
+    {
+        std::fill(df.liveIns[bi], df.liveIns[bi] + wordsNum, uint64_t(0));
+        workList.push_back(bi);
+        inBody[bi] = inWorkList[bi] = true;
+    }
     
-    // join source lastAccessMap with curSVRegMap
-    for (const auto& sentry: src.lastAccessMap)
+    Array<uint64_t> liveOut(wordsNum);
+    while (!workList.empty())
     {
-        auto res = curSVRegMap.insert({ sentry.first, { entry.blockIndex, true } });
-        if (!res.second)
-        {   // not added because is present in map
-            if (res.first->second.blockIndex != entry.blockIndex)
-                entry.prevCurSVRegMap.insert(*res.first);
-            // otherwise, it is same code block but inside routines
-            // and do not change prevCurSVRegMap for revert
-            // update entry
-            res.first->second = { entry.blockIndex, true };
+        const size_t bi = workList.front();
+        workList.pop_front();
+        inWorkList[bi] = false;
+        
+        computeLiveOut(df, bi, retLiveOut, liveOut.data());
+        const uint64_t* gen = df.genSets[bi];
+        const uint64_t* kill = df.killSets[bi];
+        uint64_t* liveIn = df.liveIns[bi];
+        bool changed = false;
+        for (size_t k = 0; k < wordsNum; k++)
+        {
+            const uint64_t v = gen[k] | (liveOut[k] & ~kill[k]);
+            changed |= (v != liveIn[k]);
+            liveIn[k] = v;
         }
-        else
-            entry.prevCurSVRegMap.insert({ sentry.first, { SIZE_MAX, true } });
+        if (changed)
+            for (size_t dep: df.dependents[bi])
+                if (inBody[dep] && !inWorkList[dep])
+                {
+                    workList.push_back(dep);
+                    inWorkList[dep] = true;
+                }
     }
+    for (size_t bi: body)
+        inBody[bi] = false;
 }
 
-static void createRoutineDataLv(LivenessState& ls, RoutineDataLv& rdata,
-        VIdxSetEntry& routineVIdxes, size_t routineBlock)
+/* routine summaries: live-in at routine start (if nothing is live after return)
+ * and live-in for everything live after return. Since liveness is distributive,
+ * live-in at call point is: rLiveIn | (liveAfterCall & rLiveThrough).
+ * for recursive routines, summaries are iterated to fixpoint */
+static void createRoutineSummaries(LivenessDataFlow& df)
 {
-    ARDOut << "--------- createRoutineDataLv(" << routineBlock << ")\n";
-    std::deque<FlowStackEntry4> flowStack;
-    std::unordered_set<size_t> visited;
+    const size_t ctxNum = df.ctxStarts.size();
+    const size_t wordsNum = df.liveIns.getWordsNum();
+    df.routineLiveIns = LvBitSets(ctxNum, df.gvregsNum);
+    df.routineLiveThrough = LvBitSets(ctxNum, df.gvregsNum);
+    df.routineAccesses = LvBitSets(ctxNum, df.gvregsNum);
     
-    // already read in current path
-    // key - vreg, value - source block where vreg of conflict found
-    SVRegMap alreadyReadMap;
-    std::unordered_set<AsmSingleVReg> vregsNotInAllRets;
-    std::unordered_set<AsmSingleVReg> vregsInFirstReturn;
-    std::unordered_set<size_t>& haveReturnBlocks = rdata.haveReturnBlocks;
+    for (size_t r = 1; r < ctxNum; r++)
+        for (size_t bi: df.ctxBodies[r])
+            orBits(df.routineAccesses[r], df.killSets[bi], wordsNum);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t r = 1; r < ctxNum; r++)
+            for (size_t callee: df.ctxCallees[r])
+                changed |= orBits(df.routineAccesses[r], df.routineAccesses[callee],
+                            wordsNum);
+    }
     
-    bool notFirstReturn = false;
-    flowStack.push_back({ routineBlock, 0 });
-    RoutineCurAccessMap curSVRegMap; // key - svreg, value - block index
+    changed = true;
+    while (changed)
+    {
+        changed = false;
+        // deeper routines are usually discovered later
+        for (size_t r = ctxNum-1; r > 0; r--)
+        {
+            const size_t routineBlock = df.ctxStarts[r];
+            solveLivenesses(df, r, nullptr);
+            changed |= copyBits(df.routineLiveIns[r], df.liveIns[routineBlock],
+                        wordsNum);
+            solveLivenesses(df, r, df.allVRegs[0]);
+            changed |= copyBits(df.routineLiveThrough[r], df.liveIns[routineBlock],
+                        wordsNum);
+        }
+    }
+}
+
+/* solve all flow contexts. live after routine return is join of
+ * live-ins after its call points (from all contexts) limited to
+ * svregs accessed inside routine (other svregs pass by call points) */
+static void solveFlowContexts(LivenessDataFlow& df)
+{
+    const size_t ctxNum = df.ctxStarts.size();
+    const size_t wordsNum = df.liveIns.getWordsNum();
+    const size_t blocksNum = df.codeBlocks.size();
+    df.routineLiveOuts = LvBitSets(ctxNum, df.gvregsNum);
     
-    while (!flowStack.empty())
+    std::deque<size_t> ctxWorkList;
+    std::vector<bool> inCtxWorkList(ctxNum, true);
+    for (size_t ctx = 0; ctx < ctxNum; ctx++)
+        ctxWorkList.push_back(ctx);
+    while (!ctxWorkList.empty())
     {
-        FlowStackEntry4& entry = flowStack.back();
-        const CodeBlock& cblock = ls.codeBlocks[entry.blockIndex];
+        const size_t ctx = ctxWorkList.front();
+        ctxWorkList.pop_front();
+        inCtxWorkList[ctx] = false;
         
-        if (entry.nextIndex == 0)
+        solveLivenesses(df, ctx, df.routineLiveOuts[ctx]);
+        for (size_t callBlock: df.ctxCalls[ctx])
         {
-            // process current block
-            if (visited.insert(entry.blockIndex).second)
-            {
-                ARDOut << "  cpjproc: " << entry.blockIndex << "\n";
-                
-                for (const auto& sentry: cblock.ssaInfoMap)
+            const CodeBlock& cblock = df.codeBlocks[callBlock];
+            if (!haveFallThrough(cblock) || callBlock+1 >= blocksNum)
+                continue;
+            const uint64_t* afterCall = df.liveIns[callBlock+1];
+            for (const NextBlock& next: cblock.nexts)
+                if (next.isCall)
                 {
-                    if (sentry.second.readBeforeWrite)
-                        if (alreadyReadMap.insert(
-                                    { sentry.first, entry.blockIndex }).second)
-                        {
-                            auto res = rdata.rbwSSAIdMap.insert({ sentry.first,
-                                        sentry.second.ssaIdBefore });
-                            if (res.second && notFirstReturn)
-                                // first readBeforeWrite and notFirstReturn
-                                vregsNotInAllRets.insert(sentry.first);
-                        }
-                    
-                    auto res = curSVRegMap.insert({ sentry.first,
-                        LastAccessBlockPos{ entry.blockIndex, false } });
-                    if (!res.second)
-                    {   // not added because is present in map
-                        entry.prevCurSVRegMap.insert(*res.first);
-                        res.first->second = { entry.blockIndex, false };
+                    const size_t r = df.routineContexts.find(next.block)->second;
+                    const uint64_t* accesses = df.routineAccesses[r];
+                    uint64_t* rLiveOut = df.routineLiveOuts[r];
+                    bool changed = false;
+                    for (size_t k = 0; k < wordsNum; k++)
+                    {
+                        const uint64_t v = rLiveOut[k] | (afterCall[k] & accesses[k]);
+                        changed |= (v != rLiveOut[k]);
+                        rLiveOut[k] = v;
                     }
-                    else
-                        entry.prevCurSVRegMap.insert(
-                                        { sentry.first, { SIZE_MAX, false } });
-                    
-                    // all SSAs
-                    const SSAInfo& sinfo = sentry.second;
-                    const AsmSingleVReg& svreg = sentry.first;
-                    cxuint regType = getRegType(ls.regTypesNum, ls.regRanges, svreg);
-                    const VarIndexMap& vregIndexMap = ls.vregIndexMaps[regType];
-                    const std::vector<size_t>& vidxes =
-                                vregIndexMap.find(svreg)->second;
-                    
-                    // add SSA indices to allSSAs
-                    if (sinfo.readBeforeWrite)
-                        routineVIdxes.vs[regType].insert(vidxes[sinfo.ssaIdBefore]);
-                    if (sinfo.ssaIdChange != 0)
+                    if (changed && !inCtxWorkList[r])
                     {
-                        routineVIdxes.vs[regType].insert(vidxes[sinfo.ssaIdFirst]);
-                        for (size_t i = 1; i < sinfo.ssaIdChange-1; i++)
-                            routineVIdxes.vs[regType].insert(vidxes[sinfo.ssaId+i]);
-                        routineVIdxes.vs[regType].insert(vidxes[sinfo.ssaIdLast]);
+                        ctxWorkList.push_back(r);
+                        inCtxWorkList[r] = true;
                     }
                 }
-            }
-            else
-            {
-                const bool prevReturn = haveReturnBlocks.find(entry.blockIndex) !=
-                        haveReturnBlocks.end();
-                flowStack.pop_back();
-                // propagate haveReturn to previous block
-                if (prevReturn)
-                {
-                    flowStack.back().haveReturn = true;
-                    haveReturnBlocks.insert(flowStack.back().blockIndex);
-                }
-                continue;
-            }
         }
-        
-        // join and skip calls
-        {
-            std::vector<size_t> calledRoutines;
-            for (; entry.nextIndex < cblock.nexts.size() &&
-                        cblock.nexts[entry.nextIndex].isCall; entry.nextIndex++)
+    }
+}
+
+// returns true if called routine (context) calls back caller context
+static bool isRecursiveCall(const LivenessDataFlow& df, size_t ctx, size_t routineCtx)
+{
+    if (ctx == 0)
+        return false;
+    std::vector<bool> visited(df.ctxStarts.size(), false);
+    std::vector<size_t> ctxStack;
+    ctxStack.push_back(routineCtx);
+    visited[routineCtx] = true;
+    while (!ctxStack.empty())
+    {
+        const size_t cur = ctxStack.back();
+        ctxStack.pop_back();
+        if (cur == ctx)
+            return true;
+        for (size_t callee: df.ctxCallees[cur])
+            if (!visited[callee])
             {
-                BlockIndex rblock = cblock.nexts[entry.nextIndex].block;
-                if (rblock != routineBlock /*&&
-                    recurseBlocks.find(rblock.index) == recurseBlocks.end()*/)
-                    calledRoutines.push_back(rblock.index);
+                visited[callee] = true;
+                ctxStack.push_back(callee);
             }
-            
-            for (size_t srcRoutBlock: calledRoutines)
+    }
+    return false;
+}
+
+// put all vidxes of SSA's used in routine (with called subroutines)
+static void createVIdxRoutineMap(const LivenessDataFlow& df, LivenessState& ls,
+            std::unordered_map<size_t, VIdxSetEntry>& vidxRoutineMap)
+{
+    const size_t ctxNum = df.ctxStarts.size();
+    std::vector<VIdxSetEntry*> routineVIdxes(ctxNum, nullptr);
+    for (size_t r = 1; r < ctxNum; r++)
+    {
+        VIdxSetEntry& rvidxes = vidxRoutineMap[df.ctxStarts[r]];
+        routineVIdxes[r] = &rvidxes;
+        for (size_t bi: df.ctxBodies[r])
+            for (const auto& sentry: df.codeBlocks[bi].ssaInfoMap)
             {
-                auto srcRIt = ls.routineMap.find(srcRoutBlock);
-                if (srcRIt == ls.routineMap.end())
-                    continue; // skip not initialized recursion
-                // update svregs 'not in all returns'
-                const RoutineDataLv& srcRdata = srcRIt->second;
-                if (notFirstReturn)
-                    for (const auto& vrentry: srcRdata.rbwSSAIdMap)
-                        if (rdata.rbwSSAIdMap.find(vrentry.first)==rdata.rbwSSAIdMap.end())
-                            vregsNotInAllRets.insert(vrentry.first);
+                const SSAInfo& sinfo = sentry.second;
+                cxuint regType = getRegType(ls.regTypesNum, ls.regRanges, sentry.first);
+                const std::vector<size_t>& vidxes =
+                            ls.vregIndexMaps[regType].find(sentry.first)->second;
                 
-                joinRoutineDataLv(rdata, routineVIdxes, curSVRegMap, entry,
-                        srcRdata, ls.vidxRoutineMap.find(srcRoutBlock)->second);
-            }
-        }
-        
-        if (entry.nextIndex < cblock.nexts.size())
-        {
-            flowStack.push_back({ cblock.nexts[entry.nextIndex].block, 0 });
-            entry.nextIndex++;
-        }
-        else if (((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            flowStack.push_back({ entry.blockIndex+1, 0 });
-            entry.nextIndex++;
-        }
-        else
-        {
-            if (cblock.haveReturn)
-            {
-                // handle return
-                // add curSVReg access positions to lastAccessMap
-                for (const auto& entry: curSVRegMap)
+                if (sinfo.readBeforeWrite)
+                    rvidxes.vs[regType].insert(vidxes[sinfo.ssaIdBefore]);
+                if (sinfo.ssaIdChange != 0)
                 {
-                    auto res = rdata.lastAccessMap.insert({ entry.first,
-                                    { entry.second } });
-                    if (!res.second)
-                        res.first->second.insertValue(entry.second);
+                    rvidxes.vs[regType].insert(vidxes[sinfo.ssaIdFirst]);
+                    for (size_t i = 1; i < sinfo.ssaIdChange-1; i++)
+                        rvidxes.vs[regType].insert(vidxes[sinfo.ssaId+i]);
+                    rvidxes.vs[regType].insert(vidxes[sinfo.ssaIdLast]);
                 }
-                
-                entry.haveReturn = true;
-                haveReturnBlocks.insert(entry.blockIndex);
-            }
-            
-            // handle vidxes not in all paths (both end and returns)
-            if (cblock.haveReturn || cblock.haveEnd)
-            {
-                for (const auto& entry: curSVRegMap)
-                    if (!notFirstReturn)
-                        // fill up vregs for first return
-                        vregsInFirstReturn.insert(entry.first);
-                if (notFirstReturn && cblock.haveReturn)
-                    for (const AsmSingleVReg& vreg: vregsInFirstReturn)
-                        if (curSVRegMap.find(vreg) == curSVRegMap.end())
-                            // not found in this path then add to 'not in all paths'
-                            vregsNotInAllRets.insert(vreg);
-                notFirstReturn = true;
-            }
-            
-            const bool curHaveReturn = entry.haveReturn;
-            
-            // revert curSVRegMap
-            for (const auto& sentry: entry.prevCurSVRegMap)
-                if (sentry.second.blockIndex != SIZE_MAX)
-                    curSVRegMap.find(sentry.first)->second = sentry.second;
-                else // no before that
-                    curSVRegMap.erase(sentry.first);
-            
-            for (const auto& sentry: cblock.ssaInfoMap)
-            {
-                auto it = alreadyReadMap.find(sentry.first);
-                if (it != alreadyReadMap.end() && it->second == entry.blockIndex)
-                    // remove old to resolve in leaved way to allow collecting next ssaId
-                    // before write (can be different due to earlier visit)
-                    alreadyReadMap.erase(it);
             }
-            ARDOut << "  popjoin\n";
-            flowStack.pop_back();
-            // set up haveReturn
-            if (!flowStack.empty())
-            {
-                flowStack.back().haveReturn |= curHaveReturn;
-                if (flowStack.back().haveReturn)
-                    haveReturnBlocks.insert(flowStack.back().blockIndex);
-            }
-        }
     }
-    
-    // handle unused svregs in this path (from routine start) and
-    // used other paths and have this same ssaId as at routine start.
-    // just add to lastAccessMap svreg for start to join through all routine
-    for (const AsmSingleVReg& svreg: vregsNotInAllRets)
-    {
-        auto res = rdata.lastAccessMap.insert({ svreg, { { routineBlock, false } } });
-        if (!res.second)
-        {
-            VectorSet<LastAccessBlockPos>& sset = res.first->second;
-            sset.insertValue({ routineBlock, false });
-        }
-    }
-}
-
-static inline void revertLastSVReg(LastVRegMap& lastVRegMap, const AsmSingleVReg& svreg)
-{
-    auto lvrit = lastVRegMap.find(svreg);
-    if (lvrit != lastVRegMap.end())
+    // join with called subroutines
+    bool changed = true;
+    while (changed)
     {
-        std::vector<LastVRegStackPos>& lastPos = lvrit->second;
-        lastPos.pop_back();
-        if (lastPos.empty()) // just remove from lastVRegs
-            lastVRegMap.erase(lvrit);
+        changed = false;
+        for (size_t r = 1; r < ctxNum; r++)
+            for (size_t callee: df.ctxCallees[r])
+                if (callee != r)
+                    for (size_t i = 0; i < MAX_REGTYPES_NUM; i++)
+                    {
+                        const size_t oldSize = routineVIdxes[r]->vs[i].size();
+                        const DTree<size_t>& srcVs = routineVIdxes[callee]->vs[i];
+                        routineVIdxes[r]->vs[i].insert(srcVs.begin(), srcVs.end());
+                        changed |= (routineVIdxes[r]->vs[i].size() != oldSize);
+                    }
     }
 }
 
@@ -1205,12 +693,43 @@ void AsmRegAllocator::createLivenesses(ISAUsageHandler& usageHandler,
     // construct var index maps
     cxuint regRanges[MAX_REGTYPES_NUM*2];
     std::fill(graphVregsCounts, graphVregsCounts+MAX_REGTYPES_NUM, size_t(0));
-    size_t regTypesNum;
     assembler.isaAssembler->getRegisterRanges(regTypesNum, regRanges);
     
+    /* ssaInfoMap is sorted by regvar addresses, hence graph vregs are numbered
+     * in order of first occurrence of svregs in code. allocation should not
+     * depend on memory layout */
+    std::unordered_map<AsmSingleVReg, size_t> svregOrders;
+    {
+        ISAUsageHandler::ReadPos usagePos = usageHandler.findPositionByOffset(0);
+        while (usageHandler.hasNext(usagePos))
+        {
+            const AsmRegVarUsage rvu = usageHandler.nextUsage(usagePos);
+            for (uint16_t rindex = rvu.rstart; rindex < rvu.rend; rindex++)
+            {
+                const size_t order = svregOrders.size();
+                svregOrders.insert({ AsmSingleVReg{ rvu.regVar, rindex }, order });
+            }
+        }
+    }
+    auto svregOrder = [&svregOrders](const AsmSingleVReg& svreg)
+    {
+        auto it = svregOrders.find(svreg);
+        return it != svregOrders.end() ? it->second : SIZE_MAX;
+    };
+    
+    std::vector<const std::pair<AsmSingleVReg, SSAInfo>*> orderedEntries;
     for (const CodeBlock& cblock: codeBlocks)
+    {
+        orderedEntries.clear();
         for (const auto& entry: cblock.ssaInfoMap)
+            orderedEntries.push_back(&entry);
+        std::stable_sort(orderedEntries.begin(), orderedEntries.end(),
+                [&svregOrder](const std::pair<AsmSingleVReg, SSAInfo>* e1,
+                        const std::pair<AsmSingleVReg, SSAInfo>* e2)
+                { return svregOrder(e1->first) < svregOrder(e2->first); });
+        for (const auto* entryPtr: orderedEntries)
         {
+            const auto& entry = *entryPtr;
             const SSAInfo& sinfo = entry.second;
             cxuint regType = getRegType(regTypesNum, regRanges, entry.first);
             VarIndexMap& vregIndices = vregIndexMaps[regType];
@@ -1255,413 +774,259 @@ void AsmRegAllocator::createLivenesses(ISAUsageHandler& usageHandler,
             if (entry.first.regVar==nullptr && vidxes[0] == SIZE_MAX)
                 vidxes[0] = graphVregsCount++;
         }
+    }
+    
+    // graph vregs of all register types in one bit space
+    size_t vidxBases[MAX_REGTYPES_NUM+1];
+    vidxBases[0] = 0;
+    for (size_t i = 0; i < regTypesNum; i++)
+        vidxBases[i+1] = vidxBases[i] + graphVregsCounts[i];
+    const size_t gvregsNum = vidxBases[regTypesNum];
+    std::vector<const AsmSingleVReg*> gvregSVRegs(gvregsNum);
+    std::vector<cxuint> gvregTypes(gvregsNum);
+    for (size_t i = 0; i < regTypesNum; i++)
+        for (const auto& entry: vregIndexMaps[i])
+            for (size_t vidx: entry.second)
+                if (vidx != SIZE_MAX)
+                {
+                    gvregSVRegs[vidxBases[i] + vidx] = &entry.first;
+                    gvregTypes[vidxBases[i] + vidx] = i;
+                }
     
-    // construct vreg liveness
-    std::deque<CallStackEntry> callStack;
-    std::deque<FlowStackEntry3> flowStack;
-    CBlockBitPool visited(codeBlocks.size(), false);
-    // hold last vreg ssaId and position
-    LastVRegMap lastVRegMap;
+    const size_t blocksNum = codeBlocks.size();
+    LivenessDataFlow df(codeBlocks, gvregsNum);
+    createLvFlowStructure(df);
     
-    // key - current res first key, value - previous first key and its flowStack pos
-    PrevWaysIndexMap prevWaysIndexMap;
-    // to track ways last block indices pair: block index, flowStackPos)
-    std::pair<size_t, size_t> lastCommonCacheWayPoint{ SIZE_MAX, SIZE_MAX };
-    std::vector<bool> waysToCache(codeBlocks.size(), false);
-    ResSecondPointsToCache cblocksToCache(codeBlocks.size());
-    std::unordered_set<BlockIndex> callBlocks;
-    std::unordered_set<size_t> recurseBlocks;
+    df.genSets = LvBitSets(blocksNum, gvregsNum);
+    df.killSets = LvBitSets(blocksNum, gvregsNum);
+    df.liveIns = LvBitSets(blocksNum, gvregsNum);
+    df.allVRegs = LvBitSets(1, gvregsNum);
+    df.inBody.assign(blocksNum, false);
+    df.inWorkList.assign(blocksNum, false);
+    const size_t wordsNum = df.liveIns.getWordsNum();
+    for (size_t gv = 0; gv < gvregsNum; gv++)
+        df.allVRegs[0][gv>>6] |= uint64_t(1)<<(gv&63);
+    for (size_t bi: df.postOrder)
+        for (const auto& sentry: codeBlocks[bi].ssaInfoMap)
+        {
+            const SSAInfo& sinfo = sentry.second;
+            cxuint regType = getRegType(regTypesNum, regRanges, sentry.first);
+            const std::vector<size_t>& vidxes =
+                        vregIndexMaps[regType].find(sentry.first)->second;
+            const size_t vidxBase = vidxBases[regType];
+            if (sinfo.readBeforeWrite)
+            {
+                const size_t gv = vidxBase + vidxes[sentry.first.regVar!=nullptr ?
+                            sinfo.ssaIdBefore : 0];
+                df.genSets[bi][gv>>6] |= uint64_t(1)<<(gv&63);
+            }
+            // any access of svreg ends liveness of its previous SSA's
+            for (size_t vidx: vidxes)
+                if (vidx != SIZE_MAX)
+                {
+                    const size_t gv = vidxBase + vidx;
+                    df.killSets[bi][gv>>6] |= uint64_t(1)<<(gv&63);
+                }
+        }
     
-    size_t rbwCount = 0;
-    size_t wrCount = 0;
+    createRoutineSummaries(df);
+    solveFlowContexts(df);
     
-    RoutineLvMap routineMap;
     std::vector<Liveness> livenesses[MAX_REGTYPES_NUM];
-    
     for (size_t i = 0; i < regTypesNum; i++)
         livenesses[i].resize(graphVregsCounts[i]);
     
-    // callLiveTime - call live time where routine will be called
-    // reverse counted, begin from SIZE_MAX, used for joining svreg from routines
-    // and svreg used in this time
-    size_t curLiveTime = 0;
-    flowStack.push_back({ 0, 0 });
-    
     // structure to pass many arguments in compact pack
-    LivenessState ls = { flowStack, codeBlocks, waysToCache, cblocksToCache,
-        prevWaysIndexMap, livenesses, vregIndexMaps, vidxCallMap, vidxRoutineMap,
-        routineMap, regTypesNum, regRanges };
+    LivenessState ls = { livenesses, vregIndexMaps, regTypesNum, regRanges };
+    
+    createVIdxRoutineMap(df, ls, vidxRoutineMap);
     
     const size_t linearDepSize = linDepHandler.size();
     
-    while (!flowStack.empty())
+    // livenesses inside code blocks
+    for (size_t bi = 0; bi < blocksNum; bi++)
     {
-        FlowStackEntry3& entry = flowStack.back();
-        CodeBlock& cblock = codeBlocks[entry.blockIndex.index];
+        if (!df.reachable[bi])
+            continue;
+        CodeBlock& cblock = codeBlocks[bi];
+        const size_t curLiveTime = cblock.start;
+        
+        // main routine to handle ssaInfos
+        SVRegMap ssaIdIdxMap;
+        std::vector<AsmRegVarUsage> instrRVUs;
         
-        if (entry.nextIndex == 0)
+        std::vector<AsmSingleVReg> readSVRegs;
+        std::vector<AsmSingleVReg> writtenSVRegs;
+        
+        ISAUsageHandler::ReadPos usagePos = cblock.usagePos;
+        size_t oldOffset = usageHandler.hasNext(usagePos) ? cblock.start : cblock.end;
+        
+        size_t linearDepPos = linDepHandler.findPositionByOffset(cblock.start);
+        
+        // register in liveness
+        bool rvuFirst = true;
+        while (true)
         {
-            curLiveTime = cblock.start;
-            // process current block
-            if (!visited[entry.blockIndex])
+            AsmRegVarUsage rvu = { 0U, nullptr, 0U, 0U };
+            bool hasNext = false;
+            if (usageHandler.hasNext(usagePos) && oldOffset < cblock.end)
             {
-                visited[entry.blockIndex] = true;
-                ARDOut << "joinpush: " << entry.blockIndex << "\n";
-                if (flowStack.size() > 1)
-                    putCrossBlockLivenesses(ls, lastVRegMap);
-                // update last vreg position
-                for (const auto& sentry: cblock.ssaInfoMap)
-                {
-                    // update
-                    auto res = lastVRegMap.insert({ sentry.first,
-                                { { flowStack.size()-1, false } } });
-                    if (!res.second) // if not first seen, just update
-                        // update last
-                        res.first->second.push_back({ flowStack.size()-1, false });
-                    
-                    // count read before writes (for cache weight)
-                    if (sentry.second.readBeforeWrite)
-                        rbwCount++;
-                    if (sentry.second.ssaIdChange!=0)
-                        wrCount++;
-                }
-                
-                // main routine to handle ssaInfos
-                SVRegMap ssaIdIdxMap;
-                std::vector<AsmRegVarUsage> instrRVUs;
-                
-                std::vector<AsmSingleVReg> readSVRegs;
-                std::vector<AsmSingleVReg> writtenSVRegs;
-                
-                ISAUsageHandler::ReadPos usagePos = cblock.usagePos;
-                size_t oldOffset = usageHandler.hasNext(usagePos) ?
-                        cblock.start : cblock.end;
-                
-                size_t linearDepPos = linDepHandler.findPositionByOffset(cblock.start);
-                
-                // register in liveness
-                bool rvuFirst = true;
-                while (true)
+                hasNext = true;
+                rvu = usageHandler.nextUsage(usagePos);
+                if (rvuFirst)
                 {
-                    AsmRegVarUsage rvu = { 0U, nullptr, 0U, 0U };
-                    bool hasNext = false;
-                    if (usageHandler.hasNext(usagePos) && oldOffset < cblock.end)
-                    {
-                        hasNext = true;
-                        rvu = usageHandler.nextUsage(usagePos);
-                        if (rvuFirst)
-                        {
-                            oldOffset = rvu.offset;
-                            rvuFirst = false;
-                        }
-                    }
-                    const size_t liveTime = oldOffset;
-                    if ((!hasNext || rvu.offset > oldOffset) && oldOffset < cblock.end)
-                    {
-                        ARDOut << "apply to liveness. offset: " << oldOffset << "\n";
-                        // apply to liveness
-                        for (AsmSingleVReg svreg: readSVRegs)
-                        {
-                            auto svrres = ssaIdIdxMap.insert({ svreg, 0 });
-                            Liveness& lv = getLiveness(svreg, svrres.first->second,
-                                    binaryMapFind(cblock.ssaInfoMap.begin(),
-                                        cblock.ssaInfoMap.end(), svreg)->second, ls);
-                            if (svrres.second)
-                                // begin region from this block
-                                lv.insert(curLiveTime, liveTime+1);
-                            else
-                                lv.expand(liveTime+1);
-                        }
-                        for (AsmSingleVReg svreg: writtenSVRegs)
-                        {
-                            size_t& ssaIdIdx = ssaIdIdxMap[svreg];
-                            if (svreg.regVar != nullptr)
-                                ssaIdIdx++;
-                            SSAInfo& sinfo = binaryMapFind(cblock.ssaInfoMap.begin(),
-                                        cblock.ssaInfoMap.end(), svreg)->second;
-                            Liveness& lv = getLiveness(svreg, ssaIdIdx, sinfo, ls);
-                            // works only with ISA where smallest instruction have 2 bytes!
-                            // after previous read, but not after instruction.
-                            // if var is not used anywhere then this liveness region
-                            // blocks assignment for other vars
-                            lv.insert(liveTime+1, liveTime+2);
-                        }
-                        
-                        // collecting linear deps for instruction
-                        std::vector<AsmRegVarLinearDep> instrLinDeps;
-                        AsmRegVarLinearDep linDep = { 0, nullptr, 0, 0 };
-                        bool haveLdep = false;
-                        if (oldOffset == 0 && linearDepPos < linearDepSize)
-                        {
-                            // special case: if offset is zero, force get linear dep
-                            linDep = linDepHandler.getLinearDep(linearDepPos++);
-                            haveLdep = true;
-                        }
-                        while (linDep.offset < oldOffset && linearDepPos < linearDepSize)
-                        {
-                            linDep = linDepHandler.getLinearDep(linearDepPos++);
-                            haveLdep = true;
-                        }
-                        // if found
-                        if (haveLdep)
-                            while (linDep.offset == oldOffset)
-                            {
-                                // just put
-                                instrLinDeps.push_back(linDep);
-                                if (linearDepPos < linearDepSize)
-                                    linDep = linDepHandler.getLinearDep(linearDepPos++);
-                                else // no data
-                                    break;
-                            }
-                        // get linear deps and equal to
-                        cxbyte lDeps[16];
-                        usageHandler.getUsageDependencies(instrRVUs.size(),
-                                    instrRVUs.data(), lDeps);
-                        
-                        if (!addUsageDeps(lDeps, instrRVUs, instrLinDeps, linearDepMaps,
-                                cblock.ssaInfoMap, ssaIdIdxMap,
-                                readSVRegs, writtenSVRegs, ls))
-                            assembler.printError(nullptr, "Linear deps failed");
-                        
-                        readSVRegs.clear();
-                        writtenSVRegs.clear();
-                        if (!hasNext)
-                            break;
-                        oldOffset = rvu.offset;
-                        instrRVUs.clear();
-                    }
-                    if (hasNext && oldOffset < cblock.end && !rvu.useRegMode)
-                        instrRVUs.push_back(rvu);
-                    if (oldOffset >= cblock.end)
-                        break;
-                    
-                    for (uint16_t rindex = rvu.rstart; rindex < rvu.rend; rindex++)
-                    {
-                        // per register/singlvreg
-                        AsmSingleVReg svreg{ rvu.regVar, rindex };
-                        if (checkWriteWithSSA(rvu))
-                            writtenSVRegs.push_back(svreg);
-                        else // read or treat as reading // expand previous region
-                            readSVRegs.push_back(svreg);
-                    }
+                    oldOffset = rvu.offset;
+                    rvuFirst = false;
                 }
             }
-            else
+            const size_t liveTime = oldOffset;
+            if ((!hasNext || rvu.offset > oldOffset) && oldOffset < cblock.end)
             {
-                cblocksToCache.increase(entry.blockIndex);
-                ARDOut << "jcblockToCache: " << entry.blockIndex << "=" <<
-                            cblocksToCache.count(entry.blockIndex) << "\n";
-                
-                // back, already visited
-                flowStack.pop_back();
-                
-                size_t curWayBIndex = flowStack.back().blockIndex.index;
-                if (lastCommonCacheWayPoint.first != SIZE_MAX)
+                ARDOut << "apply to liveness. offset: " << oldOffset << "\n";
+                // apply to liveness
+                for (AsmSingleVReg svreg: readSVRegs)
                 {
-                    // mark point of way to cache (res first point)
-                    waysToCache[lastCommonCacheWayPoint.first] = true;
-                    ARDOut << "mark to pfcache " <<
-                            lastCommonCacheWayPoint.first << ", " <<
-                            curWayBIndex << "\n";
-                    prevWaysIndexMap[curWayBIndex] = lastCommonCacheWayPoint;
+                    auto svrres = ssaIdIdxMap.insert({ svreg, 0 });
+                    Liveness& lv = getLiveness(svreg, svrres.first->second,
+                            binaryMapFind(cblock.ssaInfoMap.begin(),
+                                cblock.ssaInfoMap.end(), svreg)->second, ls);
+                    if (svrres.second)
+                        // begin region from this block
+                        lv.insert(curLiveTime, liveTime+1);
+                    else
+                        lv.expand(liveTime+1);
                 }
-                lastCommonCacheWayPoint = { curWayBIndex, flowStack.size()-1 };
-                ARDOut << "lastCcwP: " << curWayBIndex << "\n";
-                continue;
-            }
-        }
-        
-        if (!callStack.empty() &&
-            entry.blockIndex == callStack.back().callBlock &&
-            entry.nextIndex-1 == callStack.back().callNextIndex)
-        {
-            ARDOut << " ret: " << entry.blockIndex << "\n";
-            const BlockIndex routineBlock = callStack.back().routineBlock;
-            auto res = routineMap.insert({ routineBlock.index, { } });
-            
-            // while second pass in recursion: the routine's insertion was happened
-            // later in first pass (after return from second pass)
-            // we check whether second pass happened for this routine
-            // order: create in second pass recursion
-            //           (fromSecondPass && rblock.pass==0 avoids
-            //            doubles creating in second pass)
-            //        create in first pass recursion
-            if (res.second || (res.first->second.fromSecondPass && routineBlock.pass==0))
-            {
-                res.first->second.fromSecondPass = routineBlock.pass==1;
-                auto varRes = vidxRoutineMap.insert({ routineBlock.index, VIdxSetEntry{} });
-                createRoutineDataLv(ls, res.first->second, varRes.first->second,
-                        routineBlock.index);
-            }
-            else
-            {
-                // already added join livenesses from all readBeforeWrites
-                for (const auto& entry: res.first->second.rbwSSAIdMap)
+                for (AsmSingleVReg svreg: writtenSVRegs)
                 {
-                    // find last
-                    auto lvrit = lastVRegMap.find(entry.first);
-                    LastVRegStackPos flowStackStart = (lvrit != lastVRegMap.end()) ?
-                            lvrit->second.back() : LastVRegStackPos{ 0, false };
-                    
-                    joinVRegRecur(ls, flowStackStart, entry.first, entry.second, false);
+                    size_t& ssaIdIdx = ssaIdIdxMap[svreg];
+                    if (svreg.regVar != nullptr)
+                        ssaIdIdx++;
+                    SSAInfo& sinfo = binaryMapFind(cblock.ssaInfoMap.begin(),
+                                cblock.ssaInfoMap.end(), svreg)->second;
+                    Liveness& lv = getLiveness(svreg, ssaIdIdx, sinfo, ls);
+                    // works only with ISA where smallest instruction have 2 bytes!
+                    // after previous read, but not after instruction.
+                    // if var is not used anywhere then this liveness region
+                    // blocks assignment for other vars
+                    lv.insert(liveTime+1, liveTime+2);
                 }
-            }
-            callBlocks.erase(routineBlock);
-            callStack.pop_back(); // just return from call
-        }
-        
-        if (entry.nextIndex < cblock.nexts.size())
-        {
-            BlockIndex nextBlock = cblock.nexts[entry.nextIndex].block;
-            nextBlock.pass = entry.blockIndex.pass;
-            if (cblock.nexts[entry.nextIndex].isCall)
-            {
-                if (!callBlocks.insert(nextBlock).second)
+                
+                // collecting linear deps for instruction
+                std::vector<AsmRegVarLinearDep> instrLinDeps;
+                AsmRegVarLinearDep linDep = { 0, nullptr, 0, 0 };
+                bool haveLdep = false;
+                if (oldOffset == 0 && linearDepPos < linearDepSize)
                 {
-                    // just skip recursion (is good?)
-                    if (recurseBlocks.insert(nextBlock.index).second)
-                    {
-                        ARDOut << "   -- recursion: " << nextBlock << "\n";
-                        nextBlock.pass = 1;
-                    }
-                    else if (entry.blockIndex.pass==1)
-                    {
-                        /// mark that is routine call to skip
-                        entry.nextIndex++;
-                        continue;
-                    }
+                    // special case: if offset is zero, force get linear dep
+                    linDep = linDepHandler.getLinearDep(linearDepPos++);
+                    haveLdep = true;
                 }
-                else if (entry.blockIndex.pass==1 &&
-                    recurseBlocks.find(nextBlock.index) != recurseBlocks.end())
+                while (linDep.offset < oldOffset && linearDepPos < linearDepSize)
                 {
-                    /// mark that is routine call to skip
-                    entry.nextIndex++;
-                    continue;
+                    linDep = linDepHandler.getLinearDep(linearDepPos++);
+                    haveLdep = true;
                 }
-                
-                callStack.push_back({ entry.blockIndex,
-                            entry.nextIndex, nextBlock });
-            }
-            
-            flowStack.push_back({ nextBlock, 0 });
-            entry.nextIndex++;
-        }
-        else if (((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            if (entry.nextIndex!=0) // if back from calls (just return from calls)
-            {
-                std::unordered_set<AsmSingleVReg> regSVRegs;
-                // just add last access of svreg from call routines to lastVRegMap
-                // and join svregs from routine with svreg used at this time
-                for (const NextBlock& next: cblock.nexts)
-                    if (next.isCall)
+                // if found
+                if (haveLdep)
+                    while (linDep.offset == oldOffset)
                     {
-                        auto rit = routineMap.find(next.block);
-                        if (rit == routineMap.end())
-                            continue;
-                        const RoutineDataLv& rdata = rit->second;
-                        for (const auto& entry: rdata.lastAccessMap)
-                            if (regSVRegs.insert(entry.first).second)
-                            {
-                                auto res = lastVRegMap.insert({ entry.first,
-                                        { { flowStack.size()-1, true } } });
-                                if (!res.second) // if not first seen, just update
-                                    // update last
-                                    res.first->second.push_back(
-                                                { flowStack.size()-1, true });
-                            }
+                        // just put
+                        instrLinDeps.push_back(linDep);
+                        if (linearDepPos < linearDepSize)
+                            linDep = linDepHandler.getLinearDep(linearDepPos++);
+                        else // no data
+                            break;
                     }
+                // get linear deps and equal to
+                cxbyte lDeps[16];
+                usageHandler.getUsageDependencies(instrRVUs.size(),
+                            instrRVUs.data(), lDeps);
+                
+                if (!addUsageDeps(lDeps, instrRVUs, instrLinDeps, linearDepMaps,
+                        cblock.ssaInfoMap, ssaIdIdxMap,
+                        readSVRegs, writtenSVRegs, ls))
+                    printError(oldOffset, "Linear deps failed");
+                
+                readSVRegs.clear();
+                writtenSVRegs.clear();
+                if (!hasNext)
+                    break;
+                oldOffset = rvu.offset;
+                instrRVUs.clear();
             }
+            if (hasNext && oldOffset < cblock.end && !rvu.useRegMode)
+                instrRVUs.push_back(rvu);
+            if (oldOffset >= cblock.end)
+                break;
             
-            flowStack.push_back({ entry.blockIndex+1, 0 });
-            entry.nextIndex++;
-        }
-        else // back
-        {
-            // revert lastSSAIdMap
-            flowStack.pop_back();
-            
-            // revert lastVRegs in call
-            std::unordered_set<AsmSingleVReg> revertedSVRegs;
-            for (const NextBlock& next: cblock.nexts)
-                if (next.isCall)
-                {
-                    auto rit = routineMap.find(next.block);
-                    if (rit == routineMap.end())
-                        continue;
-                    const RoutineDataLv& rdata = rit->second;
-                    for (const auto& entry: rdata.lastAccessMap)
-                        if (revertedSVRegs.insert(entry.first).second)
-                            revertLastSVReg(lastVRegMap, entry.first);
-                }
-            
-            for (const auto& sentry: cblock.ssaInfoMap)
-                revertLastSVReg(lastVRegMap, sentry.first);
-            
-            if (!flowStack.empty() && lastCommonCacheWayPoint.first != SIZE_MAX &&
-                    lastCommonCacheWayPoint.second >= flowStack.size() &&
-                    flowStack.back().blockIndex.pass == 0)
+            for (uint16_t rindex = rvu.rstart; rindex < rvu.rend; rindex++)
             {
-                lastCommonCacheWayPoint =
-                        { flowStack.back().blockIndex.index, flowStack.size()-1 };
-                ARDOut << "POPlastCcwP: " << lastCommonCacheWayPoint.first << "\n";
+                // per register/singlvreg
+                AsmSingleVReg svreg{ rvu.regVar, rindex };
+                if (checkWriteWithSSA(rvu))
+                    writtenSVRegs.push_back(svreg);
+                else // read or treat as reading // expand previous region
+                    readSVRegs.push_back(svreg);
             }
         }
     }
     
-    // after, that resolve joins (join with already visited code)
-    // SVRegMap in this cache: key - vreg, value - last flowStack entry position
-    SimpleCache<size_t, LastStackPosMap> joinFirstPointsCache(wrCount<<1);
-    // SVRegMap in this cache: key - vreg, value - first readBefore in second part
-    SimpleCache<size_t, SVRegMap> joinSecondPointsCache(rbwCount<<1);
-    
-    flowStack.clear();
-    std::fill(visited.begin(), visited.end(), false);
-    
-    flowStack.push_back({ 0, 0 });
-    
-    while (!flowStack.empty())
+    // livenesses between code blocks: fill from last access (or block start)
+    // to end of block for every live-out graph vreg in every flow context
+    Array<uint64_t> liveOut(wordsNum);
+    for (size_t ctx = 0; ctx < df.ctxStarts.size(); ctx++)
     {
-        FlowStackEntry3& entry = flowStack.back();
-        CodeBlock& cblock = codeBlocks[entry.blockIndex.index];
-        
-        if (entry.nextIndex == 0)
+        solveLivenesses(df, ctx, df.routineLiveOuts[ctx]);
+        for (size_t bi: df.ctxBodies[ctx])
         {
-            // process current block
-            if (!visited[entry.blockIndex])
-                visited[entry.blockIndex] = true;
-            else
-            {
-                joinRegVarLivenesses(ls, joinFirstPointsCache, joinSecondPointsCache);
-                // back, already visited
-                flowStack.pop_back();
+            const CodeBlock& cblock = codeBlocks[bi];
+            computeLiveOut(df, bi, df.routineLiveOuts[ctx], liveOut.data());
+            const uint64_t* kill = df.killSets[bi];
+            for (size_t k = 0; k < wordsNum; k++)
+                for (uint64_t w = liveOut[k]; w != 0; w &= w-1)
+                {
+                    const size_t gv = (k<<6) + CTZ64(w);
+                    const cxuint regType = gvregTypes[gv];
+                    Liveness& lv = livenesses[regType][gv - vidxBases[regType]];
+                    size_t cbStart = cblock.start;
+                    if ((kill[k] & (uint64_t(1)<<(gv&63))) != 0)
+                        // begin after last access of svreg in this block
+                        cbStart = binaryMapFind(cblock.ssaInfoMap.begin(),
+                                cblock.ssaInfoMap.end(),
+                                *gvregSVRegs[gv])->second.lastPos+1;
+                    if (cbStart < cblock.end)
+                        lv.insert(cbStart, cblock.end);
+                }
+            
+            if (!cblock.haveCalls || !haveFallThrough(cblock) || bi+1 >= blocksNum)
                 continue;
-            }
-        }
-        
-        if (entry.nextIndex < cblock.nexts.size())
-        {
-            flowStack.push_back({ cblock.nexts[entry.nextIndex].block, 0 });
-            entry.nextIndex++;
-        }
-        else if (((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            flowStack.push_back({ entry.blockIndex+1, 0 });
-            entry.nextIndex++;
-        }
-        else // back
-        {
-            if (cblocksToCache.count(entry.blockIndex)==2 &&
-                !joinSecondPointsCache.hasKey(entry.blockIndex.index))
-                // add to cache
-                addJoinSecCacheEntry(ls, joinSecondPointsCache, entry.blockIndex.index);
-            flowStack.pop_back();
+            // call entry: vregs live through call point,
+            // add vidx only if vreg not present in routine
+            VIdxSetEntry* callEntry = nullptr;
+            for (const NextBlock& next: cblock.nexts)
+                if (next.isCall && isRecursiveCall(df, ctx,
+                            df.routineContexts.find(next.block)->second))
+                    // call point inside recursion is always recorded
+                    callEntry = &vidxCallMap[bi];
+            const uint64_t* afterCall = df.liveIns[bi+1];
+            for (size_t k = 0; k < wordsNum; k++)
+                for (uint64_t w = liveOut[k] & afterCall[k]; w != 0; w &= w-1)
+                {
+                    const size_t gv = (k<<6) + CTZ64(w);
+                    const cxuint regType = gvregTypes[gv];
+                    const size_t vidx = gv - vidxBases[regType];
+                    for (const NextBlock& next: cblock.nexts)
+                        if (next.isCall)
+                        {
+                            const auto& allLvs = vidxRoutineMap.find(next.block)->second;
+                            if (allLvs.vs[regType].find(vidx) == allLvs.vs[regType].end())
+                            {
+                                if (callEntry == nullptr)
+                                    callEntry = &vidxCallMap[bi];
+                                callEntry->vs[regType].insert(vidx);
+                            }
+                        }
+                }
         }
     }
     
@@ -1681,3 +1046,49 @@ void AsmRegAllocator::createLivenesses(ISAUsageHandler& usageHandler,
         livenesses2.clear();
     }
 }
+
+/* register pressure is number of vregs (register variables and normal registers)
+ * whose live ranges cover position. instruction reads at its offset and writes
+ * at offset+1 (like in livenesses), hence peak offset is position
+ * with cleared lowest bit */
+void AsmRegAllocator::createRegPressures()
+{
+    blockRegPressures.assign(codeBlocks.size(), BlockRegPressure());
+    for (size_t regType = 0; regType < regTypesNum; regType++)
+    {
+        // events: first - position, second - change of number of live vregs
+        std::vector<std::pair<size_t, int> > events;
+        for (const OutLiveness& lv: outLivenesses[regType])
+            for (const std::pair<size_t, size_t>& range: lv)
+                if (range.first < range.second)
+                {
+                    events.push_back({ range.first, 1 });
+                    events.push_back({ range.second, -1 });
+                }
+        std::sort(events.begin(), events.end());
+        
+        size_t ei = 0;
+        cxuint liveRegs = 0;
+        for (size_t bi = 0; bi < codeBlocks.size(); bi++)
+        {
+            const CodeBlock& cblock = codeBlocks[bi];
+            BlockRegPressure& pressure = blockRegPressures[bi];
+            // apply all events before block and at its start
+            for (; ei < events.size() && events[ei].first <= cblock.start; ei++)
+                liveRegs += events[ei].second;
+            pressure.maxLiveRegs[regType] = liveRegs;
+            pressure.peakOffsets[regType] = cblock.start;
+            while (ei < events.size() && events[ei].first < cblock.end)
+            {
+                const size_t pos = events[ei].first;
+                for (; ei < events.size() && events[ei].first == pos; ei++)
+                    liveRegs += events[ei].second;
+                if (liveRegs > pressure.maxLiveRegs[regType])
+                {
+                    pressure.maxLiveRegs[regType] = liveRegs;
+                    pressure.peakOffsets[regType] = pos & ~size_t(1);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,713 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/utils/Containers.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "AsmRegAlloc.h"
+
+using namespace CLRX;
+
+/*
+ * AsmCodeOffsetMap
+ */
+
+void AsmCodeOffsetMap::insertBefore(size_t offset, size_t size)
+{
+    const size_t total = (insertsBefore.empty() ? 0 : insertsBefore.back().second) + size;
+    if (!insertsBefore.empty() && insertsBefore.back().first == offset)
+        insertsBefore.back().second = total;
+    else
+        insertsBefore.push_back({ offset, total });
+}
+
+void AsmCodeOffsetMap::insertAfter(size_t offset, size_t size)
+{
+    const size_t total = (insertsAfter.empty() ? 0 : insertsAfter.back().second) + size;
+    if (!insertsAfter.empty() && insertsAfter.back().first == offset)
+        insertsAfter.back().second = total;
+    else
+        insertsAfter.push_back({ offset, total });
+}
+
+void AsmCodeOffsetMap::removeInstr(size_t offset, size_t size)
+{
+    // removal is insertion of negative size after instruction (sums are modular)
+    insertAfter(offset + size, size_t(0) - size);
+}
+
+void AsmCodeOffsetMap::appendMap(size_t offset, const AsmCodeOffsetMap& map)
+{
+    // cumulative sums of map are converted to sizes of single insertions
+    size_t prevTotal = 0;
+    for (const std::pair<size_t, size_t>& entry: map.insertsBefore)
+    {
+        insertBefore(offset + entry.first, entry.second - prevTotal);
+        prevTotal = entry.second;
+    }
+    prevTotal = 0;
+    for (const std::pair<size_t, size_t>& entry: map.insertsAfter)
+    {
+        insertAfter(offset + entry.first, entry.second - prevTotal);
+        prevTotal = entry.second;
+    }
+}
+
+// get sum of sizes of insertions at offsets less than (or equal if withEqual) offset
+static size_t getInsertsSize(const std::vector<std::pair<size_t, size_t> >& inserts,
+                size_t offset, bool withEqual)
+{
+    auto it = withEqual ?
+        std::upper_bound(inserts.begin(), inserts.end(), offset,
+                [](size_t o, const std::pair<size_t, size_t>& e)
+                { return o < e.first; }) :
+        std::lower_bound(inserts.begin(), inserts.end(), offset,
+                [](const std::pair<size_t, size_t>& e, size_t o)
+                { return e.first < o; });
+    return (it != inserts.begin()) ? (it-1)->second : 0;
+}
+
+/* label points to code inserted before instruction, and after code inserted
+ * after previous instruction */
+size_t AsmCodeOffsetMap::mapLabel(size_t offset) const
+{
+    return offset + getInsertsSize(insertsBefore, offset, false) +
+            getInsertsSize(insertsAfter, offset, true);
+}
+
+// instruction (and any place inside instruction) is after all code inserted before it
+size_t AsmCodeOffsetMap::mapInstr(size_t offset) const
+{
+    return offset + getInsertsSize(insertsBefore, offset, true) +
+            getInsertsSize(insertsAfter, offset, true);
+}
+
+/*
+ * spill code insertion
+ */
+
+/* code can be inserted only if all jumps can be retargeted and differences of labels
+ * are not evaluated (evaluated values in code or data can not be updated) */
+bool AsmRegAllocator::canInsertCode(const AsmSection& section) const
+{
+    return !section.labelDiffs && canRetargetJumps(section);
+}
+
+/* calls and returns are not supported, because spill code can not be placed after
+ * call and unknown targets of jumps can not be updated */
+bool AsmRegAllocator::canRetargetJumps(const AsmSection& section,
+            size_t* badOffset) const
+{
+    std::vector<cxbyte> code(section.content);
+    for (const AsmCodeFlowEntry& entry: section.codeFlow)
+        if (entry.type == AsmCodeFlowType::CALL || entry.type == AsmCodeFlowType::RETURN ||
+            ((entry.type == AsmCodeFlowType::JUMP || entry.type == AsmCodeFlowType::CJUMP) &&
+            !assembler.isaAssembler->setJumpTarget(entry.offset, entry.target,
+                        code.size(), code.data())))
+        {
+            if (badOffset != nullptr)
+                *badOffset = entry.offset;
+            return false;
+        }
+    return true;
+}
+
+/* SGPRs are spilled to lanes of VGPRs (v_readlane/v_writelane),
+ * VGPRs are spilled to LDS window (ds_read_b32/ds_write_b32).
+ * Spilled vreg is loaded to temporary register before instruction which reads it and
+ * stored after instruction which writes it. Instructions are assembled by separate
+ * assembler and inserted to section. Redundant moves are removed in this same pass.
+ * Offsets in section data (code flow, usages, waits, source positions) are updated */
+void AsmRegAllocator::insertSpillCode(AsmSection& section)
+{
+    ISAAssembler* isaAsm = assembler.isaAssembler;
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    size_t regTypesNum2;
+    isaAsm->getRegisterRanges(regTypesNum2, regRanges);
+    const AsmWaitConfig& waitConfig = isaAsm->getWaitConfig();
+    const bool wave32 = (assembler.codeFlags & ASM_CODE_WAVE32) != 0;
+    const size_t lanesNum = wave32 ? 32 : 64;
+    static const char* waitNames[3] = { "vmcnt", "lgkmcnt", "expcnt" };
+    const cxuint ldsReg = spillLdsReg - regRanges[2*REGTYPE_VGPR];
+
+    const std::vector<SpillUsage>& sgprUsages = spillUsages[REGTYPE_SGPR];
+    const std::vector<SpillUsage>& vgprUsages = spillUsages[REGTYPE_VGPR];
+    const Array<size_t>& sgprSlots = spillSlots[REGTYPE_SGPR];
+    const Array<size_t>& vgprSlots = spillSlots[REGTYPE_VGPR];
+
+    std::vector<AsmInstrCodeInsert> instrCodes;
+    std::string spillText;
+    std::string afterText;
+    size_t si = 0, vi = 0;
+    while (si < sgprUsages.size() || vi < vgprUsages.size())
+    {
+        const size_t offset = std::min(
+            si < sgprUsages.size() ? sgprUsages[si].offset : SIZE_MAX,
+            vi < vgprUsages.size() ? vgprUsages[vi].offset : SIZE_MAX);
+        const size_t sEnd = std::find_if(sgprUsages.begin()+si, sgprUsages.end(),
+                [offset](const SpillUsage& u) { return u.offset != offset; }) -
+                sgprUsages.begin();
+        const size_t vEnd = std::find_if(vgprUsages.begin()+vi, vgprUsages.end(),
+                [offset](const SpillUsage& u) { return u.offset != offset; }) -
+                vgprUsages.begin();
+
+        AsmInstrCodeInsert instrCode{ offset, 0, 0, 0, false };
+        afterText.clear();
+        char buf[100];
+        bool loadSGPRs = false, loadVGPRs = false;
+        cxbyte waitMask = 0;
+        // spill usages in instruction: loads before instruction, stores after
+        for (size_t regType = REGTYPE_SGPR; regType <= REGTYPE_VGPR; regType++)
+        {
+            const bool isSGPR = regType == REGTYPE_SGPR;
+            const std::vector<SpillUsage>& usages = isSGPR ? sgprUsages : vgprUsages;
+            const Array<size_t>& slots = isSGPR ? sgprSlots : vgprSlots;
+            const size_t first = isSGPR ? si : vi;
+            const size_t end = isSGPR ? sEnd : vEnd;
+            for (size_t i = first; i < end; i++)
+            {
+                const SpillUsage& usage = usages[i];
+                const size_t slot = slots.empty() ? SIZE_MAX : slots[usage.vidx];
+                if (slot == SIZE_MAX)
+                    continue;
+                bool firstUsage = true;
+                cxbyte rwFlags = 0;
+                for (size_t k = first; k < end; k++)
+                    if (usages[k].vidx == usage.vidx)
+                    {
+                        if (k < i)
+                            firstUsage = false;
+                        rwFlags |= usages[k].rwFlags;
+                    }
+                if (!firstUsage)
+                    continue;
+
+                if (!isSGPR && slot * spillLdsStride > 0xffff)
+                {
+                    snprintf(buf, sizeof buf, "Offset of LDS spill slot %zu "
+                            "is out of range", slot);
+                    printError(offset, buf);
+                    return;
+                }
+                if ((rwFlags & ASMRVU_READ) != 0)
+                {
+                    if (isSGPR)
+                        snprintf(buf, sizeof buf, "v_readlane_b32 s%u, v%u, %zu\n",
+                            usage.tempColor, spillLaneRegs[slot / lanesNum],
+                            slot % lanesNum);
+                    else
+                        snprintf(buf, sizeof buf, "ds_read_b32 v%u, v%u offset:%zu\n",
+                            usage.tempColor, ldsReg, slot * spillLdsStride);
+                    spillText += buf;
+                    instrCode.beforeInstrsNum++;
+                    if (isSGPR)
+                        loadSGPRs = true;
+                    else
+                        loadVGPRs = true;
+                }
+                if ((rwFlags & ASMRVU_WRITE) != 0)
+                {
+                    if (isSGPR)
+                        snprintf(buf, sizeof buf, "v_writelane_b32 v%u, s%u, %zu\n",
+                            spillLaneRegs[slot / lanesNum], usage.tempColor,
+                            slot % lanesNum);
+                    else
+                        snprintf(buf, sizeof buf, "ds_write_b32 v%u, v%u offset:%zu\n",
+                            ldsReg, usage.tempColor, slot * spillLdsStride);
+                    afterText += buf;
+                    instrCode.afterInstrsNum++;
+                }
+
+                if (section.waitHandler == nullptr)
+                    continue;
+                /* wait for delayed results (or for register readout) of
+                 * instruction before storing temporary register */
+                ISAWaitHandler::ReadPos waitPos =
+                        section.waitHandler->findPositionByOffset(offset);
+                while (section.waitHandler->hasNext(waitPos))
+                {
+                    AsmDelayedOp delOp;
+                    AsmWaitInstr waitInstr;
+                    if (section.waitHandler->nextInstr(waitPos, delOp, waitInstr))
+                        break;
+                    if (delOp.offset != offset)
+                        break;
+                    // delayed ops refer to temporary register (allocated register)
+                    const cxuint tempReg = regRanges[2*regType] + usage.tempColor;
+                    if (delOp.regVar != nullptr ||
+                        tempReg < delOp.rstart || tempReg >= delOp.rend)
+                        continue;
+                    for (cxuint k = 0; k < 2; k++)
+                    {
+                        const cxbyte opType = k==0 ? delOp.delayedOpType :
+                                    delOp.delayedOpType2;
+                        const cxbyte opRWFlags = k==0 ? delOp.rwFlags : delOp.rwFlags2;
+                        if (opType == ASMDELOP_NONE)
+                            continue;
+                        const AsmDelayedOpTypeEntry& opEntry =
+                                    waitConfig.delayOpTypes[opType];
+                        if (((opRWFlags & ASMRVU_WRITE) != 0 ||
+                            ((opRWFlags & ASMRVU_READ) != 0 &&
+                                    opEntry.finishOnRegReadOut)) &&
+                            opEntry.waitType < 3)
+                            waitMask |= 1U<<opEntry.waitType;
+                    }
+                }
+            }
+        }
+
+        if (loadVGPRs)
+        {
+            spillText += "s_waitcnt lgkmcnt(0)\n";
+            instrCode.beforeInstrsNum++;
+        }
+        // SGPR written by VALU (v_readlane) needs wait states before usage
+        if (loadSGPRs)
+        {
+            spillText += "s_nop 4\n";
+            instrCode.beforeInstrsNum++;
+        }
+        if (waitMask != 0)
+        {
+            spillText += "s_waitcnt";
+            for (cxuint k = 0; k < 3; k++)
+                if ((waitMask & (1U<<k)) != 0)
+                {
+                    spillText += ' ';
+                    spillText += waitNames[k];
+                    spillText += "(0)";
+                }
+            spillText += '\n';
+            instrCode.afterInstrsNum++;
+        }
+        spillText += afterText;
+        if (instrCode.beforeInstrsNum != 0 || instrCode.afterInstrsNum != 0)
+        {
+            instrCode.size = isaAsm->getInstructionSize(
+                        section.content.size() - offset, section.content.data() + offset);
+            instrCodes.push_back(instrCode);
+        }
+        si = sEnd;
+        vi = vEnd;
+    }
+    // redundant moves (their registers are not spilled, hence no spill code)
+    if (!removedMoves.empty())
+    {
+        for (const RegMove& move: removedMoves)
+            instrCodes.push_back({ move.offset, move.size, 0, 0, true });
+        std::stable_sort(instrCodes.begin(), instrCodes.end(),
+                [](const AsmInstrCodeInsert& i1, const AsmInstrCodeInsert& i2)
+                { return i1.offset < i2.offset; });
+    }
+
+    // errors of spill code are reported at first instruction with spill code
+    const size_t firstOffset = instrCodes.empty() ? SIZE_MAX : instrCodes.front().offset;
+    std::vector<std::pair<size_t, std::string> > insertErrors;
+    if (!insertCodeToSection(isaAsm, assembler.getDeviceType(), wave32, section,
+                spillText, instrCodes, codeOffsetMap, insertErrors))
+        printError(firstOffset, "Can't assemble spill code");
+    for (const std::pair<size_t, std::string>& error: insertErrors)
+        printError(error.first != SIZE_MAX ? error.first : firstOffset,
+                    error.second.c_str());
+}
+
+bool CLRX::insertCodeToSection(ISAAssembler* isaAsm, GPUDeviceType deviceType,
+        bool wave32, AsmSection& section, const std::string& codeText,
+        const std::vector<AsmInstrCodeInsert>& inserts, AsmCodeOffsetMap& offsetMap,
+        std::vector<std::pair<size_t, std::string> >& errorMessages)
+{
+    // assemble inserted code
+    std::istringstream codeInput(codeText);
+    std::ostringstream codeMessages;
+    Assembler codeAsm("<inserted code>", codeInput, wave32 ? ASM_WAVE32 : 0,
+                BinaryFormat::RAWCODE, deviceType, codeMessages, codeMessages);
+    std::vector<cxbyte> insCode;
+    if (!codeText.empty())
+    {
+        if (!codeAsm.assemble())
+        {
+            // forward messages of assembler of inserted code
+            std::istringstream messagesInput(codeMessages.str());
+            std::string line;
+            while (std::getline(messagesInput, line))
+                if (!line.empty())
+                    errorMessages.push_back({ SIZE_MAX, line });
+            return false;
+        }
+        insCode = codeAsm.getSections()[0].content;
+    }
+    // offsets of removed instructions
+    std::vector<size_t> removedOffsets;
+    for (const AsmInstrCodeInsert& insert: inserts)
+        if (insert.removeInstr)
+            removedOffsets.push_back(insert.offset);
+    auto isRemoved = [&removedOffsets](size_t offset)
+    {
+        return std::binary_search(removedOffsets.begin(), removedOffsets.end(), offset);
+    };
+
+    // insert code
+    std::vector<cxbyte> newContent;
+    newContent.reserve(section.content.size() + insCode.size());
+    const std::vector<cxbyte>& content = section.content;
+    size_t pos = 0, insPos = 0;
+    auto appendInsCode = [&](size_t instrsNum)
+    {
+        size_t size = 0;
+        for (size_t k = 0; k < instrsNum; k++)
+            size += isaAsm->getInstructionSize(insCode.size() - insPos - size,
+                        insCode.data() + insPos + size);
+        newContent.insert(newContent.end(), insCode.begin() + insPos,
+                    insCode.begin() + insPos + size);
+        insPos += size;
+        return size;
+    };
+    // recalculate paddings of alignments placed before offset
+    std::vector<AsmCodeAlignment> newCodeAlignments;
+    auto alignIt = section.codeAlignments.begin();
+    auto applyAlignments = [&](size_t offset)
+    {
+        for (; alignIt != section.codeAlignments.end() && alignIt->offset <= offset;
+                    ++alignIt)
+        {
+            AsmCodeAlignment codeAlign = *alignIt;
+            newContent.insert(newContent.end(), content.begin() + pos,
+                    content.begin() + codeAlign.offset);
+            const size_t newPos = newContent.size();
+            size_t padSize = ((newPos & (codeAlign.alignment-1)) != 0) ?
+                    codeAlign.alignment - (newPos & (codeAlign.alignment-1)) : 0;
+            if (codeAlign.maxAlign != 0 && padSize > codeAlign.maxAlign)
+                padSize = 0;
+            newContent.resize(newPos + padSize, codeAlign.fillValue);
+            if (!codeAlign.haveFill)
+                isaAsm->fillAlignment(padSize, newContent.data() + newPos);
+            pos = codeAlign.offset + codeAlign.size;
+            // code after padding is moved by difference of padding sizes
+            offsetMap.insertAfter(pos, padSize - codeAlign.size);
+            codeAlign.offset = newPos;
+            codeAlign.size = padSize;
+            newCodeAlignments.push_back(codeAlign);
+        }
+    };
+    for (const AsmInstrCodeInsert& insert: inserts)
+    {
+        applyAlignments(insert.offset);
+        newContent.insert(newContent.end(), content.begin() + pos,
+                    content.begin() + insert.offset);
+        const size_t beforeSize = appendInsCode(insert.beforeInstrsNum);
+        pos = insert.offset + insert.size;
+        if (!insert.removeInstr)
+            newContent.insert(newContent.end(), content.begin() + insert.offset,
+                        content.begin() + pos);
+        const size_t afterSize = appendInsCode(insert.afterInstrsNum);
+        offsetMap.insertBefore(insert.offset, beforeSize);
+        if (insert.removeInstr)
+            offsetMap.removeInstr(insert.offset, insert.size);
+        offsetMap.insertAfter(pos, afterSize);
+    }
+    applyAlignments(SIZE_MAX);
+    newContent.insert(newContent.end(), content.begin() + pos, content.end());
+    section.content.swap(newContent);
+    section.codeAlignments.swap(newCodeAlignments);
+
+    // update code flow and jumps
+    for (AsmCodeFlowEntry& entry: section.codeFlow)
+    {
+        if (entry.type == AsmCodeFlowType::START || entry.type == AsmCodeFlowType::END)
+        {
+            entry.offset = offsetMap.mapLabel(entry.offset);
+            continue;
+        }
+        entry.offset = offsetMap.mapInstr(entry.offset);
+        entry.target = offsetMap.mapLabel(entry.target);
+        if (!isaAsm->setJumpTarget(entry.offset, entry.target, section.content.size(),
+                    section.content.data()))
+            errorMessages.push_back({ entry.offset,
+                        "Jump out of range after inserting code" });
+    }
+
+    // update register usages
+    std::unique_ptr<ISAUsageHandler> newUsageHandler(isaAsm->createUsageHandler());
+    ISAUsageHandler::ReadPos usagePos = section.usageHandler->findPositionByOffset(0);
+    while (section.usageHandler->hasNext(usagePos))
+    {
+        AsmRegVarUsage rvu = section.usageHandler->nextUsage(usagePos);
+        if (!rvu.useRegMode && isRemoved(rvu.offset))
+            continue;
+        rvu.offset = rvu.useRegMode ? offsetMap.mapLabel(rvu.offset) :
+                    offsetMap.mapInstr(rvu.offset);
+        newUsageHandler->pushUsage(rvu);
+    }
+    section.usageHandler = std::move(newUsageHandler);
+
+    if (section.linearDepHandler != nullptr)
+    {
+        std::unique_ptr<ISALinearDepHandler> newLinearDepHandler(new ISALinearDepHandler());
+        for (size_t i = 0; i < section.linearDepHandler->size(); i++)
+        {
+            AsmRegVarLinearDep linearDep = section.linearDepHandler->getLinearDep(i);
+            linearDep.offset = offsetMap.mapLabel(linearDep.offset);
+            newLinearDepHandler->pushLinearDep(linearDep);
+        }
+        section.linearDepHandler = std::move(newLinearDepHandler);
+    }
+
+    if (section.waitHandler != nullptr)
+    {
+        std::unique_ptr<ISAWaitHandler> newWaitHandler(new ISAWaitHandler());
+        ISAWaitHandler::ReadPos waitPos = section.waitHandler->findPositionByOffset(0);
+        while (section.waitHandler->hasNext(waitPos))
+        {
+            AsmDelayedOp delOp;
+            AsmWaitInstr waitInstr;
+            if (section.waitHandler->nextInstr(waitPos, delOp, waitInstr))
+            {
+                if (isRemoved(waitInstr.offset))
+                    continue;
+                waitInstr.offset = offsetMap.mapInstr(waitInstr.offset);
+                newWaitHandler->pushWaitInstr(waitInstr);
+            }
+            else
+            {
+                if (isRemoved(delOp.offset))
+                    continue;
+                delOp.offset = offsetMap.mapInstr(delOp.offset);
+                newWaitHandler->pushDelayedOp(delOp);
+            }
+        }
+        section.waitHandler = std::move(newWaitHandler);
+    }
+
+    AsmSourcePosHandler newSourcePosHandler;
+    AsmSourcePosHandler::ReadPos sourcePosPos =
+                section.sourcePosHandler.findPositionByOffset(0);
+    while (section.sourcePosHandler.hasNext(sourcePosPos))
+    {
+        const std::pair<size_t, AsmSourcePos> entry =
+                section.sourcePosHandler.nextSourcePos(sourcePosPos);
+        if (isRemoved(entry.first))
+            continue;
+        newSourcePosHandler.pushSourcePos(offsetMap.mapInstr(entry.first),
+                    entry.second);
+    }
+    section.sourcePosHandler = newSourcePosHandler;
+    return true;
+}
+
+/*
+ * splitting code section to parts
+ */
+
+void CLRX::splitCodeSection(ISAAssembler* isaAsm, AsmSection& section,
+        const std::vector<size_t>& splitOffsets, std::vector<AsmSection>& parts)
+{
+    const size_t partsNum = splitOffsets.size()+1;
+    std::vector<size_t> partStarts(1, size_t(0));
+    partStarts.insert(partStarts.end(), splitOffsets.begin(), splitOffsets.end());
+    // instruction (and label) at split offset belongs to next part
+    auto getPart = [&splitOffsets](size_t offset)
+    {
+        return size_t(std::upper_bound(splitOffsets.begin(), splitOffsets.end(),
+                    offset) - splitOffsets.begin());
+    };
+    
+    parts.clear();
+    parts.reserve(partsNum);
+    for (size_t k = 0; k < partsNum; k++)
+    {
+        const size_t partEnd = (k+1 < partsNum) ? partStarts[k+1] :
+                    section.content.size();
+        parts.push_back(AsmSection(section.name, section.kernelId, section.type,
+                    section.flags, section.alignment, 0, section.relSpace,
+                    section.relAddress));
+        AsmSection& part = parts.back();
+        part.content.assign(section.content.begin() + partStarts[k],
+                    section.content.begin() + partEnd);
+        part.usageHandler.reset(isaAsm->createUsageHandler());
+        if (section.linearDepHandler != nullptr)
+            part.linearDepHandler.reset(new ISALinearDepHandler());
+        if (section.waitHandler != nullptr)
+            part.waitHandler.reset(new ISAWaitHandler());
+        part.labelDiffs = section.labelDiffs;
+        part.labelDiffPos = section.labelDiffPos;
+    }
+    
+    for (const AsmCodeFlowEntry& entry: section.codeFlow)
+    {
+        // end of code at split offset belongs to previous part
+        const size_t k = (entry.type == AsmCodeFlowType::END) ?
+                size_t(std::lower_bound(splitOffsets.begin(), splitOffsets.end(),
+                    entry.offset) - splitOffsets.begin()) : getPart(entry.offset);
+        AsmCodeFlowEntry newEntry = entry;
+        newEntry.offset -= partStarts[k];
+        if (entry.type != AsmCodeFlowType::START && entry.type != AsmCodeFlowType::END &&
+            entry.type != AsmCodeFlowType::RETURN)
+            newEntry.target -= partStarts[k];
+        parts[k].codeFlow.push_back(newEntry);
+    }
+    
+    ISAUsageHandler::ReadPos usagePos = section.usageHandler->findPositionByOffset(0);
+    while (section.usageHandler->hasNext(usagePos))
+    {
+        AsmRegVarUsage rvu = section.usageHandler->nextUsage(usagePos);
+        const size_t k = getPart(rvu.offset);
+        rvu.offset -= partStarts[k];
+        parts[k].usageHandler->pushUsage(rvu);
+    }
+    
+    if (section.linearDepHandler != nullptr)
+        for (size_t i = 0; i < section.linearDepHandler->size(); i++)
+        {
+            AsmRegVarLinearDep linearDep = section.linearDepHandler->getLinearDep(i);
+            const size_t k = getPart(linearDep.offset);
+            linearDep.offset -= partStarts[k];
+            parts[k].linearDepHandler->pushLinearDep(linearDep);
+        }
+    
+    if (section.waitHandler != nullptr)
+    {
+        ISAWaitHandler::ReadPos waitPos = section.waitHandler->findPositionByOffset(0);
+        while (section.waitHandler->hasNext(waitPos))
+        {
+            AsmDelayedOp delOp;
+            AsmWaitInstr waitInstr;
+            if (section.waitHandler->nextInstr(waitPos, delOp, waitInstr))
+            {
+                const size_t k = getPart(waitInstr.offset);
+                waitInstr.offset -= partStarts[k];
+                parts[k].waitHandler->pushWaitInstr(waitInstr);
+            }
+            else
+            {
+                const size_t k = getPart(delOp.offset);
+                delOp.offset -= partStarts[k];
+                parts[k].waitHandler->pushDelayedOp(delOp);
+            }
+        }
+    }
+    
+    AsmSourcePosHandler::ReadPos sourcePosPos =
+                section.sourcePosHandler.findPositionByOffset(0);
+    while (section.sourcePosHandler.hasNext(sourcePosPos))
+    {
+        const std::pair<size_t, AsmSourcePos> entry =
+                section.sourcePosHandler.nextSourcePos(sourcePosPos);
+        const size_t k = getPart(entry.first);
+        parts[k].sourcePosHandler.pushSourcePos(entry.first - partStarts[k],
+                    entry.second);
+    }
+}
+
+void CLRX::joinCodeSection(ISAAssembler* isaAsm, AsmSection& section,
+        const std::vector<size_t>& splitOffsets, std::vector<AsmSection>& parts,
+        const std::vector<AsmCodeOffsetMap>& partOffsetMaps, AsmCodeOffsetMap& offsetMap)
+{
+    std::vector<cxbyte> newContent;
+    std::vector<AsmCodeFlowEntry> newCodeFlow;
+    std::unique_ptr<ISAUsageHandler> newUsageHandler(isaAsm->createUsageHandler());
+    std::unique_ptr<ISALinearDepHandler> newLinearDepHandler;
+    if (section.linearDepHandler != nullptr)
+        newLinearDepHandler.reset(new ISALinearDepHandler());
+    std::unique_ptr<ISAWaitHandler> newWaitHandler;
+    if (section.waitHandler != nullptr)
+        newWaitHandler.reset(new ISAWaitHandler());
+    AsmSourcePosHandler newSourcePosHandler;
+    
+    offsetMap.clear();
+    for (size_t k = 0; k < parts.size(); k++)
+    {
+        AsmSection& part = parts[k];
+        // new start of part
+        const size_t start = newContent.size();
+        offsetMap.appendMap((k != 0) ? splitOffsets[k-1] : 0, partOffsetMaps[k]);
+        newContent.insert(newContent.end(), part.content.begin(), part.content.end());
+        
+        // jumps are inside part, hence they are not changed
+        for (AsmCodeFlowEntry entry: part.codeFlow)
+        {
+            entry.offset += start;
+            if (entry.type != AsmCodeFlowType::START && entry.type != AsmCodeFlowType::END &&
+                entry.type != AsmCodeFlowType::RETURN)
+                entry.target += start;
+            newCodeFlow.push_back(entry);
+        }
+        
+        ISAUsageHandler::ReadPos usagePos = part.usageHandler->findPositionByOffset(0);
+        while (part.usageHandler->hasNext(usagePos))
+        {
+            AsmRegVarUsage rvu = part.usageHandler->nextUsage(usagePos);
+            rvu.offset += start;
+            newUsageHandler->pushUsage(rvu);
+        }
+        
+        if (newLinearDepHandler != nullptr)
+            for (size_t i = 0; i < part.linearDepHandler->size(); i++)
+            {
+                AsmRegVarLinearDep linearDep = part.linearDepHandler->getLinearDep(i);
+                linearDep.offset += start;
+                newLinearDepHandler->pushLinearDep(linearDep);
+            }
+        
+        if (newWaitHandler != nullptr)
+        {
+            ISAWaitHandler::ReadPos waitPos = part.waitHandler->findPositionByOffset(0);
+            while (part.waitHandler->hasNext(waitPos))
+            {
+                AsmDelayedOp delOp;
+                AsmWaitInstr waitInstr;
+                if (part.waitHandler->nextInstr(waitPos, delOp, waitInstr))
+                {
+                    waitInstr.offset += start;
+                    newWaitHandler->pushWaitInstr(waitInstr);
+                }
+                else
+                {
+                    delOp.offset += start;
+                    newWaitHandler->pushDelayedOp(delOp);
+                }
+            }
+        }
+        
+        AsmSourcePosHandler::ReadPos sourcePosPos =
+                    part.sourcePosHandler.findPositionByOffset(0);
+        while (part.sourcePosHandler.hasNext(sourcePosPos))
+        {
+            const std::pair<size_t, AsmSourcePos> entry =
+                    part.sourcePosHandler.nextSourcePos(sourcePosPos);
+            newSourcePosHandler.pushSourcePos(entry.first + start, entry.second);
+        }
+    }
+    
+    section.content.swap(newContent);
+    section.codeFlow.swap(newCodeFlow);
+    section.usageHandler = std::move(newUsageHandler);
+    section.linearDepHandler = std::move(newLinearDepHandler);
+    section.waitHandler = std::move(newWaitHandler);
+    section.sourcePosHandler = newSourcePosHandler;
+    // paddings of alignments are not changed (code is not inserted to them)
+    for (AsmCodeAlignment& codeAlign: section.codeAlignments)
+        codeAlign.offset = offsetMap.mapLabel(codeAlign.offset);
+}
@@ -0,0 +1,915 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/utils/Containers.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "AsmInternals.h"
+
+using namespace CLRX;
+
+/* AsmInstrScheduler */
+
+AsmInstrScheduler::AsmInstrScheduler(Assembler& _assembler,
+            const std::vector<AsmRegAllocator::CodeBlock>& _codeBlocks)
+        : assembler(_assembler), codeBlocks(_codeBlocks)
+{ }
+
+// keys of registers: real registers have keys below, regvars have keys above
+static const size_t schedRegVarKeysStart = 1024;
+// issue cycles of single instruction
+static const cxuint schedIssueCycles = 4;
+
+// single register access of instruction
+struct CLRX_INTERNAL SchedRegAccess
+{
+    size_t key;
+    cxbyte rwFlags;
+};
+
+struct CLRX_INTERNAL SchedInstr
+{
+    size_t offset;
+    size_t size;
+    AsmInstrSchedInfo info;
+    bool barrier;
+    // register accesses (range in regAccesses)
+    size_t accessStart;
+    size_t accessEnd;
+};
+
+// segment of code block (instructions between barriers and fixed offsets)
+struct CLRX_INTERNAL SchedSegment
+{
+    size_t instrStart;
+    size_t instrEnd;
+    // number of live registers (per type) which are live at end and not used in segment
+    cxuint liveThrough[MAX_REGTYPES_NUM];
+    // keys of registers live at end of segment (used in segment)
+    std::vector<size_t> liveEndKeys;
+};
+
+typedef std::vector<uint64_t> SchedBitSet;
+
+static inline bool bitSetHas(const SchedBitSet& set, size_t key)
+{ return (set[key>>6] & (1ULL<<(key&63))) != 0; }
+
+static inline void bitSetAdd(SchedBitSet& set, size_t key)
+{ set[key>>6] |= (1ULL<<(key&63)); }
+
+static inline void bitSetRemove(SchedBitSet& set, size_t key)
+{ set[key>>6] &= ~(1ULL<<(key&63)); }
+
+// dependency edge of segment graph
+struct CLRX_INTERNAL SchedEdge
+{
+    size_t instr;
+    cxuint latency;
+};
+
+// returns true if register is in registers of hazard
+static inline bool isHazardReg(const AsmInstrHazard& hazard, size_t key,
+            const std::vector<cxbyte>& keyTypes)
+{
+    if (key < schedRegVarKeysStart)
+        return key >= hazard.rstart && key < hazard.rend;
+    return keyTypes[key] == hazard.regType;
+}
+
+// returns true if consumer reads register written by producer that needs wait states
+static bool haveHazard(const std::vector<SchedRegAccess>& regAccesses,
+            const std::vector<cxbyte>& keyTypes, const SchedInstr* producer,
+            const SchedInstr& consumer, const AsmInstrHazard& hazard)
+{
+    if (producer != nullptr && (producer->info.flags & hazard.producer) == 0)
+        return false;
+    for (size_t j = consumer.accessStart; j < consumer.accessEnd; j++)
+    {
+        const SchedRegAccess& access = regAccesses[j];
+        if ((access.rwFlags & ASMRVU_READ) == 0 ||
+            !isHazardReg(hazard, access.key, keyTypes))
+            continue;
+        // unknown producer can write any register
+        if (producer == nullptr)
+            return true;
+        for (size_t k = producer->accessStart; k < producer->accessEnd; k++)
+            if (regAccesses[k].key == access.key &&
+                (regAccesses[k].rwFlags & ASMRVU_WRITE) != 0)
+                return true;
+    }
+    return false;
+}
+
+/* register pressure of segment in incremental way. Accesses of single register are
+ * divided into groups (value): initial group (before first write) and group per write.
+ * Register is live if its current group have unscheduled reads or if group is last
+ * and register is live at end of segment */
+class CLRX_INTERNAL SchedPressure
+{
+private:
+    struct KeyInfo
+    {
+        cxbyte type;
+        bool liveEnd;
+        size_t groupsStart;  // first group in groupReads
+        size_t groupsNum;
+        size_t curGroup;
+        size_t remReads;
+    };
+    const std::vector<SchedInstr>& instrs;
+    const std::vector<SchedRegAccess>& regAccesses;
+    std::vector<KeyInfo> keyInfos;
+    std::vector<size_t> groupReads;
+    // local key index for every access of instruction of segment
+    std::vector<size_t> localKeys;
+    size_t accessStart;
+    cxuint liveCount[MAX_REGTYPES_NUM];
+    cxuint initLiveCount[MAX_REGTYPES_NUM];
+    size_t regTypesNum;
+
+    bool isLive(const KeyInfo& kinfo) const
+    { return kinfo.remReads != 0 ||
+            (kinfo.liveEnd && kinfo.curGroup+1 == kinfo.groupsNum); }
+public:
+    SchedPressure(const std::vector<SchedInstr>& instrs,
+            const std::vector<SchedRegAccess>& regAccesses,
+            const std::vector<cxbyte>& keyTypes, const SchedSegment& segment,
+            size_t regTypesNum);
+
+    void reset();
+    // get peak pressure at instruction if it will be scheduled
+    void getPressure(size_t instr, cxuint* pressure) const;
+    // schedule instruction (update state)
+    void apply(size_t instr);
+    const cxuint* getLiveCount() const
+    { return liveCount; }
+};
+
+SchedPressure::SchedPressure(const std::vector<SchedInstr>& _instrs,
+            const std::vector<SchedRegAccess>& _regAccesses,
+            const std::vector<cxbyte>& keyTypes, const SchedSegment& segment,
+            size_t _regTypesNum)
+        : instrs(_instrs), regAccesses(_regAccesses), regTypesNum(_regTypesNum)
+{
+    accessStart = instrs[segment.instrStart].accessStart;
+    const size_t accessEnd = instrs[segment.instrEnd-1].accessEnd;
+    localKeys.resize(accessEnd - accessStart);
+    std::unordered_map<size_t, size_t> keyMap;
+    // collect keys and number of their groups
+    for (size_t i = accessStart; i < accessEnd; i++)
+    {
+        const SchedRegAccess& access = regAccesses[i];
+        auto res = keyMap.insert({ access.key, keyInfos.size() });
+        if (res.second)
+            keyInfos.push_back({ keyTypes[access.key], false, 0, 1, 0, 0 });
+        localKeys[i - accessStart] = res.first->second;
+        if ((access.rwFlags & ASMRVU_WRITE) != 0)
+            keyInfos[res.first->second].groupsNum++;
+    }
+    for (size_t key: segment.liveEndKeys)
+    {
+        auto it = keyMap.find(key);
+        if (it != keyMap.end())
+            keyInfos[it->second].liveEnd = true;
+    }
+    size_t groupsNum = 0;
+    for (KeyInfo& kinfo: keyInfos)
+    {
+        kinfo.groupsStart = groupsNum;
+        groupsNum += kinfo.groupsNum;
+    }
+    // count reads in groups
+    groupReads.resize(groupsNum);
+    for (size_t i = accessStart; i < accessEnd; i++)
+    {
+        const SchedRegAccess& access = regAccesses[i];
+        KeyInfo& kinfo = keyInfos[localKeys[i - accessStart]];
+        if ((access.rwFlags & ASMRVU_READ) != 0)
+            groupReads[kinfo.groupsStart + kinfo.curGroup]++;
+        if ((access.rwFlags & ASMRVU_WRITE) != 0)
+            kinfo.curGroup++;
+    }
+    std::copy(segment.liveThrough, segment.liveThrough + MAX_REGTYPES_NUM,
+              initLiveCount);
+    for (KeyInfo& kinfo: keyInfos)
+    {
+        kinfo.curGroup = 0;
+        kinfo.remReads = groupReads[kinfo.groupsStart];
+        if (kinfo.type < regTypesNum && isLive(kinfo))
+            initLiveCount[kinfo.type]++;
+    }
+    std::copy(initLiveCount, initLiveCount + MAX_REGTYPES_NUM, liveCount);
+}
+
+void SchedPressure::reset()
+{
+    for (KeyInfo& kinfo: keyInfos)
+    {
+        kinfo.curGroup = 0;
+        kinfo.remReads = groupReads[kinfo.groupsStart];
+    }
+    std::copy(initLiveCount, initLiveCount + MAX_REGTYPES_NUM, liveCount);
+}
+
+void SchedPressure::getPressure(size_t instr, cxuint* pressure) const
+{
+    const SchedInstr& sinstr = instrs[instr];
+    std::copy(liveCount, liveCount + MAX_REGTYPES_NUM, pressure);
+    // registers used by instruction are in distinct accesses
+    for (size_t i = sinstr.accessStart; i < sinstr.accessEnd; i++)
+    {
+        const SchedRegAccess& access = regAccesses[i];
+        KeyInfo kinfo = keyInfos[localKeys[i - accessStart]];
+        if (kinfo.type >= regTypesNum)
+            continue;
+        const bool wasLive = isLive(kinfo);
+        if ((access.rwFlags & ASMRVU_READ) != 0)
+            kinfo.remReads--;
+        if ((access.rwFlags & ASMRVU_WRITE) != 0)
+        {
+            kinfo.curGroup++;
+            kinfo.remReads = groupReads[kinfo.groupsStart + kinfo.curGroup];
+            // written register is live at least at instruction
+            if (!wasLive)
+                pressure[kinfo.type]++;
+        }
+        else if (wasLive && !isLive(kinfo))
+            pressure[kinfo.type]--;
+    }
+    // pressure after instruction can not be lower than before (dead reads)
+    for (size_t t = 0; t < regTypesNum; t++)
+        pressure[t] = std::max(pressure[t], liveCount[t]);
+}
+
+void SchedPressure::apply(size_t instr)
+{
+    const SchedInstr& sinstr = instrs[instr];
+    for (size_t i = sinstr.accessStart; i < sinstr.accessEnd; i++)
+    {
+        const SchedRegAccess& access = regAccesses[i];
+        KeyInfo& kinfo = keyInfos[localKeys[i - accessStart]];
+        const bool wasLive = isLive(kinfo);
+        if ((access.rwFlags & ASMRVU_READ) != 0)
+            kinfo.remReads--;
+        if ((access.rwFlags & ASMRVU_WRITE) != 0)
+        {
+            kinfo.curGroup++;
+            kinfo.remReads = groupReads[kinfo.groupsStart + kinfo.curGroup];
+        }
+        if (kinfo.type >= regTypesNum)
+            continue;
+        const bool nowLive = isLive(kinfo);
+        if (wasLive && !nowLive)
+            liveCount[kinfo.type]--;
+        else if (!wasLive && nowLive)
+            liveCount[kinfo.type]++;
+    }
+}
+
+// evaluate order of instructions: estimated cycles and peak pressure
+static uint64_t evaluateSchedOrder(const std::vector<SchedInstr>& instrs,
+            const std::vector<std::vector<SchedEdge> >& preds,
+            size_t instrStart, const std::vector<size_t>& order,
+            SchedPressure& pressure, size_t regTypesNum, cxuint* peak)
+{
+    const size_t n = order.size();
+    std::vector<uint64_t> issueTimes(n);
+    pressure.reset();
+    std::copy(pressure.getLiveCount(), pressure.getLiveCount() + MAX_REGTYPES_NUM, peak);
+    uint64_t time = 0;
+    uint64_t cycles = 0;
+    for (size_t i: order)
+    {
+        uint64_t issueTime = time;
+        for (const SchedEdge& edge: preds[i])
+            issueTime = std::max(issueTime, issueTimes[edge.instr] + edge.latency);
+        issueTimes[i] = issueTime;
+        time = issueTime + schedIssueCycles;
+        cycles = std::max(cycles, issueTime + std::max(schedIssueCycles,
+                    instrs[instrStart + i].info.latency));
+        cxuint curPressure[MAX_REGTYPES_NUM];
+        pressure.getPressure(instrStart + i, curPressure);
+        for (size_t t = 0; t < regTypesNum; t++)
+            peak[t] = std::max(peak[t], curPressure[t]);
+        pressure.apply(instrStart + i);
+    }
+    return cycles;
+}
+
+/* list scheduling of segment: ready instruction that can be issued without stall
+ * and that have longest path to end of segment is chosen first.
+ * Instructions that increase register pressure over budget are chosen at last.
+ * Hazards are kept by minimal distances (in instructions) between producer and consumer
+ * inside segment, minimal positions (hazardMinPos) and minimal distances
+ * to end of segment (hazardMinDistEnd) for hazards between segments */
+static void scheduleSegment(const std::vector<SchedInstr>& instrs,
+            const std::vector<SchedRegAccess>& regAccesses,
+            const std::vector<cxbyte>& keyTypes, const std::vector<cxuint>& hazardMinPos,
+            const std::vector<cxuint>& hazardMinDistEnd,
+            size_t instrStart, size_t instrEnd, SchedPressure& pressure,
+            size_t regTypesNum, const cxuint* budget, std::vector<size_t>& newOrder,
+            bool& improved)
+{
+    improved = false;
+    const size_t n = instrEnd - instrStart;
+    std::vector<std::vector<SchedEdge> > preds(n);
+    std::vector<std::vector<SchedEdge> > succs(n);
+    auto addEdge = [&preds, &succs](size_t from, size_t to, cxuint latency)
+    {
+        preds[to].push_back({ from, latency });
+        succs[from].push_back({ to, latency });
+    };
+
+    /* build dependency graph: read after write (with latency), write after read,
+     * write after write and order of memory instructions */
+    std::unordered_map<size_t, size_t> lastWrites;
+    std::unordered_map<size_t, std::vector<size_t> > lastReads;
+    // last writes of VALU and SALU instructions (hazard producers)
+    std::unordered_map<size_t, size_t> lastProducerWrites[2];
+    std::vector<std::vector<SchedEdge> > hazardPreds(n);
+    size_t lastMemInstr = SIZE_MAX;
+    for (size_t i = 0; i < n; i++)
+    {
+        const SchedInstr& sinstr = instrs[instrStart + i];
+        // minimal distances between producers and consumer (original order is kept)
+        for (cxuint k = 0; k < sinstr.info.hazardsNum; k++)
+        {
+            const AsmInstrHazard& hazard = sinstr.info.hazards[k];
+            const auto& producerWrites =
+                    lastProducerWrites[hazard.producer == ASMSCHED_SALU];
+            for (size_t j = sinstr.accessStart; j < sinstr.accessEnd; j++)
+            {
+                const SchedRegAccess& access = regAccesses[j];
+                if ((access.rwFlags & ASMRVU_READ) == 0 ||
+                    !isHazardReg(hazard, access.key, keyTypes))
+                    continue;
+                auto pit = producerWrites.find(access.key);
+                if (pit != producerWrites.end())
+                    hazardPreds[i].push_back({ pit->second,
+                            cxuint(std::min(size_t(hazard.waitStates+1), i-pit->second)) });
+            }
+        }
+        for (cxuint c = 0; c < 2; c++)
+            if ((sinstr.info.flags & (c==0 ? ASMSCHED_VALU : ASMSCHED_SALU)) != 0)
+                for (size_t j = sinstr.accessStart; j < sinstr.accessEnd; j++)
+                    if ((regAccesses[j].rwFlags & ASMRVU_WRITE) != 0)
+                        lastProducerWrites[c][regAccesses[j].key] = i;
+        for (size_t j = sinstr.accessStart; j < sinstr.accessEnd; j++)
+        {
+            const SchedRegAccess& access = regAccesses[j];
+            auto wit = lastWrites.find(access.key);
+            if ((access.rwFlags & ASMRVU_READ) != 0 && wit != lastWrites.end())
+                addEdge(wit->second, i, instrs[instrStart + wit->second].info.latency);
+            if ((access.rwFlags & ASMRVU_WRITE) != 0)
+            {
+                std::vector<size_t>& reads = lastReads[access.key];
+                for (size_t r: reads)
+                    addEdge(r, i, 0);
+                reads.clear();
+                if (wit != lastWrites.end() && (access.rwFlags & ASMRVU_READ) == 0)
+                    addEdge(wit->second, i, 0);
+                lastWrites[access.key] = i;
+            }
+            else
+                lastReads[access.key].push_back(i);
+        }
+        if ((sinstr.info.flags & ASMSCHED_MEMORY) != 0)
+        {
+            if (lastMemInstr != SIZE_MAX)
+                addEdge(lastMemInstr, i, 0);
+            lastMemInstr = i;
+        }
+    }
+
+    // heights: longest path to end of segment (results of long latency are used later)
+    std::vector<uint64_t> heights(n);
+    for (size_t i = n; i > 0; i--)
+    {
+        uint64_t height = std::max(schedIssueCycles, instrs[instrStart + i-1].info.latency);
+        for (const SchedEdge& edge: succs[i-1])
+            height = std::max(height, std::max(edge.latency, schedIssueCycles) +
+                        heights[edge.instr]);
+        heights[i-1] = height;
+    }
+
+    std::vector<size_t> origOrder(n);
+    for (size_t i = 0; i < n; i++)
+        origOrder[i] = i;
+    cxuint origPeak[MAX_REGTYPES_NUM];
+    const uint64_t origCycles = evaluateSchedOrder(instrs, preds, instrStart, origOrder,
+                pressure, regTypesNum, origPeak);
+
+    // list scheduling
+    std::vector<size_t> predsLeft(n);
+    std::vector<uint64_t> earliest(n, 0);
+    std::vector<size_t> positions(n);
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < n; i++)
+    {
+        predsLeft[i] = preds[i].size();
+        if (predsLeft[i] == 0)
+            ready.push_back(i);
+    }
+    pressure.reset();
+    newOrder.clear();
+    uint64_t time = 0;
+    while (!ready.empty())
+    {
+        const size_t pos = newOrder.size();
+        size_t bestPos = SIZE_MAX;
+        bool bestForced = false;
+        uint64_t bestOver = UINT64_MAX, bestStart = 0;
+        for (size_t k = 0; k < ready.size(); k++)
+        {
+            const size_t i = ready[k];
+            // instruction can not be placed before minimal position of hazard
+            size_t minPos = hazardMinPos[instrStart + i];
+            for (const SchedEdge& edge: hazardPreds[i])
+                minPos = std::max(minPos, positions[edge.instr] + edge.latency);
+            if (pos < minPos)
+                continue;
+            // last position that keeps distance to end of segment
+            const cxuint minDistEnd = hazardMinDistEnd[instrStart + i];
+            const bool forced = minDistEnd != 0 && pos + minDistEnd >= n;
+            cxuint curPressure[MAX_REGTYPES_NUM];
+            pressure.getPressure(instrStart + i, curPressure);
+            uint64_t over = 0;
+            for (size_t t = 0; t < regTypesNum; t++)
+                if (curPressure[t] > budget[t])
+                    over += curPressure[t] - budget[t];
+            const uint64_t start = std::max(time, earliest[i]);
+            if (bestPos == SIZE_MAX || (forced && !bestForced))
+            {
+                bestPos = k;
+                bestForced = forced;
+                bestOver = over;
+                bestStart = start;
+                continue;
+            }
+            const size_t best = ready[bestPos];
+            if (forced == bestForced && (over < bestOver || (over == bestOver &&
+                (start < bestStart || (start == bestStart && (heights[i] > heights[best] ||
+                    (heights[i] == heights[best] && i < best)))))))
+            {
+                bestPos = k;
+                bestOver = over;
+                bestStart = start;
+            }
+        }
+        // no instruction can be placed without breaking hazard
+        if (bestPos == SIZE_MAX)
+            return;
+        const size_t i = ready[bestPos];
+        ready.erase(ready.begin() + bestPos);
+        positions[i] = pos;
+        newOrder.push_back(i);
+        pressure.apply(instrStart + i);
+        time = bestStart + schedIssueCycles;
+        for (const SchedEdge& edge: succs[i])
+        {
+            earliest[edge.instr] = std::max(earliest[edge.instr],
+                        bestStart + edge.latency);
+            if (--predsLeft[edge.instr] == 0)
+                ready.push_back(edge.instr);
+        }
+    }
+
+    if (newOrder == origOrder)
+        return;
+    // check hazards (original order always satisfies them)
+    for (size_t i = 0; i < n; i++)
+    {
+        if (positions[i] < hazardMinPos[instrStart + i] ||
+            n - positions[i] < hazardMinDistEnd[instrStart + i])
+            return;
+        for (const SchedEdge& edge: hazardPreds[i])
+            if (positions[i] < positions[edge.instr] + edge.latency)
+                return;
+    }
+    cxuint newPeak[MAX_REGTYPES_NUM];
+    const uint64_t newCycles = evaluateSchedOrder(instrs, preds, instrStart, newOrder,
+                pressure, regTypesNum, newPeak);
+    if (newCycles >= origCycles)
+        return;
+    for (size_t t = 0; t < regTypesNum; t++)
+        if (newPeak[t] > std::max(budget[t], origPeak[t]))
+            return;
+    improved = true;
+}
+
+void AsmInstrScheduler::schedule(size_t codeSize, const cxbyte* code,
+            ISAUsageHandler& usageHandler, const std::vector<size_t>& fixedOffsets)
+{
+    instrMoves.clear();
+    ISAAssembler* isaAsm = assembler.isaAssembler;
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    size_t regTypesNum;
+    isaAsm->getRegisterRanges(regTypesNum, regRanges);
+
+    // types of keys (255 - register is not counted in pressure)
+    std::vector<cxbyte> keyTypes(schedRegVarKeysStart, 255);
+    for (size_t t = 0; t < regTypesNum; t++)
+        for (cxuint r = regRanges[2*t]; r < regRanges[2*t+1] &&
+                    r < schedRegVarKeysStart; r++)
+            keyTypes[r] = t;
+    std::unordered_map<const AsmRegVar*, size_t> regVarKeys;
+    auto getKey = [&regVarKeys, &keyTypes](const AsmRegVar* regVar, size_t reg)
+    {
+        if (regVar == nullptr)
+            return reg;
+        auto res = regVarKeys.insert({ regVar, keyTypes.size() });
+        if (res.second)
+            keyTypes.resize(keyTypes.size() + regVar->size, regVar->type);
+        return res.first->second + reg;
+    };
+
+    // read register usages
+    std::vector<AsmRegVarUsage> usages;
+    ISAUsageHandler::ReadPos usagePos = usageHandler.findPositionByOffset(0);
+    while (usageHandler.hasNext(usagePos))
+    {
+        const AsmRegVarUsage rvu = usageHandler.nextUsage(usagePos);
+        if (!rvu.useRegMode)
+            usages.push_back(rvu);
+    }
+
+    /* decode instructions of code blocks and collect register accesses */
+    std::vector<SchedInstr> instrs;
+    std::vector<SchedRegAccess> regAccesses;
+    std::vector<size_t> blockInstrStarts(codeBlocks.size()+1);
+    auto usageIt = usages.begin();
+    auto fixedIt = fixedOffsets.begin();
+    for (size_t b = 0; b < codeBlocks.size(); b++)
+    {
+        const AsmRegAllocator::CodeBlock& cblock = codeBlocks[b];
+        blockInstrStarts[b] = instrs.size();
+        size_t pos = cblock.start;
+        while (pos < cblock.end)
+        {
+            const size_t size = isaAsm->getInstructionSize(codeSize - pos, code + pos);
+            if (size == 0 || pos + size > cblock.end)
+                break;
+            SchedInstr sinstr{ pos, size, isaAsm->getInstrSchedInfo(codeSize - pos,
+                        code + pos), false, regAccesses.size(), 0 };
+            sinstr.barrier = (sinstr.info.flags & ASMSCHED_BARRIER) != 0;
+            // fixed offsets inside instruction (relocations)
+            while (fixedIt != fixedOffsets.end() && *fixedIt <= pos)
+                ++fixedIt;
+            if (fixedIt != fixedOffsets.end() && *fixedIt < pos + size)
+                sinstr.barrier = true;
+
+            while (usageIt != usages.end() && usageIt->offset < pos)
+                ++usageIt;
+            // instruction without register usages can be data
+            if (usageIt == usages.end() || usageIt->offset != pos)
+                sinstr.barrier = true;
+            auto addAccess = [&regAccesses, &sinstr](size_t key, cxbyte rwFlags)
+            {
+                // join accesses of this same register
+                for (size_t k = sinstr.accessStart; k < regAccesses.size(); k++)
+                    if (regAccesses[k].key == key)
+                    {
+                        regAccesses[k].rwFlags |= rwFlags;
+                        return;
+                    }
+                regAccesses.push_back({ key, rwFlags });
+            };
+            for (; usageIt != usages.end() && usageIt->offset == pos; ++usageIt)
+                for (size_t r = usageIt->rstart; r < usageIt->rend; r++)
+                    addAccess(getKey(usageIt->regVar, r),
+                              usageIt->rwFlags & ASMRVU_ACCESS_MASK);
+            for (cxuint k = 0; k < sinstr.info.implRegsNum; k++)
+            {
+                const AsmRegVarUsage& implReg = sinstr.info.implRegs[k];
+                for (size_t r = implReg.rstart; r < implReg.rend; r++)
+                    addAccess(r, implReg.rwFlags & ASMRVU_ACCESS_MASK);
+            }
+            sinstr.accessEnd = regAccesses.size();
+            instrs.push_back(sinstr);
+            pos += size;
+        }
+    }
+    blockInstrStarts[codeBlocks.size()] = instrs.size();
+
+    /* liveness of registers at ends of code blocks (dataflow) */
+    const size_t keysNum = keyTypes.size();
+    const size_t bitSetSize = (keysNum+63)>>6;
+    std::vector<SchedBitSet> blockUses(codeBlocks.size(), SchedBitSet(bitSetSize));
+    std::vector<SchedBitSet> blockDefs(codeBlocks.size(), SchedBitSet(bitSetSize));
+    std::vector<SchedBitSet> liveIns(codeBlocks.size(), SchedBitSet(bitSetSize));
+    std::vector<SchedBitSet> liveOuts(codeBlocks.size(), SchedBitSet(bitSetSize));
+    for (size_t b = 0; b < codeBlocks.size(); b++)
+    {
+        for (size_t i = blockInstrStarts[b]; i < blockInstrStarts[b+1]; i++)
+            for (size_t k = instrs[i].accessStart; k < instrs[i].accessEnd; k++)
+            {
+                const SchedRegAccess& access = regAccesses[k];
+                if ((access.rwFlags & ASMRVU_READ) != 0 &&
+                    !bitSetHas(blockDefs[b], access.key))
+                    bitSetAdd(blockUses[b], access.key);
+                if ((access.rwFlags & ASMRVU_WRITE) != 0)
+                    bitSetAdd(blockDefs[b], access.key);
+            }
+        liveIns[b] = blockUses[b];
+        // after return all registers can be used
+        if (codeBlocks[b].haveReturn)
+            std::fill(liveOuts[b].begin(), liveOuts[b].end(), UINT64_MAX);
+    }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t b = codeBlocks.size(); b > 0; b--)
+        {
+            const AsmRegAllocator::CodeBlock& cblock = codeBlocks[b-1];
+            SchedBitSet& liveOut = liveOuts[b-1];
+            auto addNext = [&liveOut, &liveIns](size_t next)
+            {
+                for (size_t w = 0; w < liveOut.size(); w++)
+                    liveOut[w] |= liveIns[next][w];
+            };
+            for (const AsmRegAllocator::NextBlock& next: cblock.nexts)
+                addNext(next.block);
+            if (((cblock.nexts.empty() && !cblock.haveEnd) || cblock.haveCalls) &&
+                b < codeBlocks.size())
+                addNext(b);
+            for (size_t w = 0; w < liveOut.size(); w++)
+            {
+                const uint64_t liveIn = blockUses[b-1][w] |
+                        (liveOut[w] & ~blockDefs[b-1][w]);
+                if (liveIn != liveIns[b-1][w])
+                {
+                    liveIns[b-1][w] = liveIn;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    /* divide code blocks into segments (between barriers and fixed offsets) */
+    std::vector<SchedSegment> segments;
+    std::vector<size_t> blockSegmentStarts(codeBlocks.size()+1);
+    for (size_t b = 0; b < codeBlocks.size(); b++)
+    {
+        blockSegmentStarts[b] = segments.size();
+        size_t segStart = blockInstrStarts[b];
+        auto closeSegment = [&segments, &segStart](size_t segEnd)
+        {
+            // only segments with two or more instructions can be scheduled
+            if (segEnd - segStart >= 2)
+                segments.push_back({ segStart, segEnd });
+        };
+        for (size_t i = blockInstrStarts[b]; i < blockInstrStarts[b+1]; i++)
+            if (instrs[i].barrier)
+            {
+                closeSegment(i);
+                segStart = i+1;
+            }
+            else if (i != segStart && std::binary_search(fixedOffsets.begin(),
+                        fixedOffsets.end(), instrs[i].offset))
+            {
+                closeSegment(i);
+                segStart = i;
+            }
+        closeSegment(blockInstrStarts[b+1]);
+    }
+    blockSegmentStarts[codeBlocks.size()] = segments.size();
+    if (segments.empty())
+        return;
+
+    /* find registers live at end of segments */
+    for (size_t b = 0; b < codeBlocks.size(); b++)
+    {
+        SchedBitSet live = liveOuts[b];
+        size_t segIndex = blockSegmentStarts[b+1];
+        for (size_t i = blockInstrStarts[b+1]; ; i--)
+        {
+            // skip segments that starts after this point
+            while (segIndex > blockSegmentStarts[b] &&
+                        segments[segIndex-1].instrStart >= i)
+                segIndex--;
+            if (segIndex > blockSegmentStarts[b] && segments[segIndex-1].instrEnd == i)
+            {
+                SchedSegment& segment = segments[segIndex-1];
+                std::fill(segment.liveThrough, segment.liveThrough + MAX_REGTYPES_NUM, 0);
+                SchedBitSet liveThrough = live;
+                for (size_t k = instrs[segment.instrStart].accessStart;
+                            k < instrs[segment.instrEnd-1].accessEnd; k++)
+                {
+                    const size_t key = regAccesses[k].key;
+                    if (bitSetHas(liveThrough, key))
+                    {
+                        bitSetRemove(liveThrough, key);
+                        segment.liveEndKeys.push_back(key);
+                    }
+                }
+                for (size_t w = 0; w < bitSetSize; w++)
+                    for (uint64_t bits = liveThrough[w]; bits != 0; bits &= bits-1)
+                    {
+                        const size_t key = (w<<6) + CTZ64(bits);
+                        if (key < keysNum && keyTypes[key] < regTypesNum)
+                            segment.liveThrough[keyTypes[key]]++;
+                    }
+            }
+            if (i == blockInstrStarts[b])
+                break;
+            // update liveness before instruction
+            const SchedInstr& sinstr = instrs[i-1];
+            for (size_t k = sinstr.accessStart; k < sinstr.accessEnd; k++)
+                if ((regAccesses[k].rwFlags & ASMRVU_WRITE) != 0)
+                    bitSetRemove(live, regAccesses[k].key);
+            for (size_t k = sinstr.accessStart; k < sinstr.accessEnd; k++)
+                if ((regAccesses[k].rwFlags & ASMRVU_READ) != 0)
+                    bitSetAdd(live, regAccesses[k].key);
+        }
+    }
+
+    /* hazards between segments: producer keeps distance to end of its segment and
+     * consumer keeps distance to start of its segment, hence distance between them
+     * can not be lower than needed wait states (or original distance) after
+     * scheduling both segments. Unknown producers are after calls (returns from routine)
+     * and unknown consumers are after returns */
+    std::vector<cxuint> hazardMinPos(instrs.size(), 0);
+    std::vector<cxuint> hazardMinDistEnd(instrs.size(), 0);
+    std::vector<AsmInstrHazard> allHazards;
+    cxuint maxHazardDist = 0;
+    for (const SchedInstr& sinstr: instrs)
+        for (cxuint k = 0; k < sinstr.info.hazardsNum; k++)
+        {
+            const AsmInstrHazard& hazard = sinstr.info.hazards[k];
+            maxHazardDist = std::max(maxHazardDist, hazard.waitStates+1);
+            if (std::find_if(allHazards.begin(), allHazards.end(),
+                    [&hazard](const AsmInstrHazard& h)
+                    { return h.producer == hazard.producer &&
+                        h.regType == hazard.regType && h.rstart == hazard.rstart &&
+                        h.rend == hazard.rend && h.waitStates == hazard.waitStates; })
+                    == allHazards.end())
+                allHazards.push_back(hazard);
+        }
+    std::vector<size_t> instrSegments(instrs.size(), SIZE_MAX);
+    for (size_t s = 0; s < segments.size(); s++)
+        std::fill(instrSegments.begin() + segments[s].instrStart,
+                  instrSegments.begin() + segments[s].instrEnd, s);
+    /* walk through code that follows producer (or unknown producer if producer is
+     * SIZE_MAX) while distance can be lower than wait states of hazards */
+    auto findHazardConsumers = [&](size_t producer, size_t block, size_t instrStart)
+    {
+        const SchedInstr* sproducer = (producer != SIZE_MAX) ? &instrs[producer] : nullptr;
+        const size_t prodSegment = (producer != SIZE_MAX) ?
+                instrSegments[producer] : SIZE_MAX;
+        // distance between producer and first instruction of walk
+        const size_t prodDist = (prodSegment != SIZE_MAX) ?
+                segments[prodSegment].instrEnd - producer : 1;
+        struct WalkEntry
+        {
+            size_t block;
+            size_t instr;
+            size_t dist;    // distance from start of walk
+            size_t depth;
+        };
+        std::vector<WalkEntry> stack;
+        stack.push_back({ block, instrStart, 0, 0 });
+        while (!stack.empty())
+        {
+            WalkEntry entry = stack.back();
+            stack.pop_back();
+            bool tooFar = false;
+            for (; entry.instr < blockInstrStarts[entry.block+1]; entry.instr++, entry.dist++)
+            {
+                const SchedInstr& consumer = instrs[entry.instr];
+                const size_t consSegment = instrSegments[entry.instr];
+                const size_t consPos = (consSegment != SIZE_MAX) ?
+                        entry.instr - segments[consSegment].instrStart : 0;
+                // fixed distance (not changed by scheduling)
+                const size_t fixedDist = prodDist + entry.dist - consPos;
+                if (1 + entry.dist - consPos >= maxHazardDist)
+                {
+                    tooFar = true;
+                    break;
+                }
+                for (cxuint k = 0; k < consumer.info.hazardsNum; k++)
+                {
+                    const AsmInstrHazard& hazard = consumer.info.hazards[k];
+                    if (!haveHazard(regAccesses, keyTypes, sproducer, consumer, hazard))
+                        continue;
+                    const size_t dist = std::min(size_t(hazard.waitStates+1),
+                                prodDist + entry.dist);
+                    if (prodSegment != SIZE_MAX)
+                        hazardMinDistEnd[producer] = std::max(hazardMinDistEnd[producer],
+                                    cxuint(std::min(prodDist, dist)));
+                    if (consSegment != SIZE_MAX && dist > fixedDist)
+                        hazardMinPos[entry.instr] = std::max(hazardMinPos[entry.instr],
+                                    cxuint(std::min(consPos, dist - fixedDist)));
+                }
+            }
+            if (tooFar)
+                continue;
+            const AsmRegAllocator::CodeBlock& cblock = codeBlocks[entry.block];
+            if (cblock.haveReturn && prodSegment != SIZE_MAX)
+                // unknown consumers after return
+                for (const AsmInstrHazard& hazard: allHazards)
+                    for (size_t k = sproducer->accessStart; k < sproducer->accessEnd; k++)
+                        if ((sproducer->info.flags & hazard.producer) != 0 &&
+                            (regAccesses[k].rwFlags & ASMRVU_WRITE) != 0 &&
+                            isHazardReg(hazard, regAccesses[k].key, keyTypes))
+                            hazardMinDistEnd[producer] = std::max(
+                                    hazardMinDistEnd[producer], cxuint(std::min(
+                                        prodDist, size_t(hazard.waitStates+1))));
+            // empty blocks do not increase distance
+            if (entry.depth >= 64)
+                continue;
+            for (const AsmRegAllocator::NextBlock& next: cblock.nexts)
+                stack.push_back({ next.block, blockInstrStarts[next.block], entry.dist,
+                            entry.depth+1 });
+            if (((cblock.nexts.empty() && !cblock.haveEnd) || cblock.haveCalls) &&
+                entry.block+1 < codeBlocks.size())
+                stack.push_back({ entry.block+1, blockInstrStarts[entry.block+1],
+                            entry.dist, entry.depth+1 });
+        }
+    };
+    if (maxHazardDist != 0)
+        for (size_t b = 0; b < codeBlocks.size(); b++)
+        {
+            if (b != 0 && codeBlocks[b-1].haveCalls)
+                // unknown producers before return from routine
+                findHazardConsumers(SIZE_MAX, b, blockInstrStarts[b]);
+            for (size_t i = blockInstrStarts[b]; i < blockInstrStarts[b+1]; i++)
+                if ((instrs[i].info.flags & (ASMSCHED_VALU|ASMSCHED_SALU)) != 0)
+                {
+                    const size_t seg = instrSegments[i];
+                    const size_t walkStart = (seg != SIZE_MAX) ? segments[seg].instrEnd : i+1;
+                    findHazardConsumers(i, b, walkStart);
+                }
+        }
+
+    /* budget of register pressure: peak pressure of section before scheduling */
+    cxuint budget[MAX_REGTYPES_NUM] = { };
+    for (const SchedSegment& segment: segments)
+    {
+        SchedPressure pressure(instrs, regAccesses, keyTypes, segment, regTypesNum);
+        for (size_t t = 0; t < regTypesNum; t++)
+            budget[t] = std::max(budget[t], pressure.getLiveCount()[t]);
+        for (size_t i = segment.instrStart; i < segment.instrEnd; i++)
+        {
+            cxuint curPressure[MAX_REGTYPES_NUM];
+            pressure.getPressure(i, curPressure);
+            for (size_t t = 0; t < regTypesNum; t++)
+                budget[t] = std::max(budget[t], curPressure[t]);
+            pressure.apply(i);
+        }
+    }
+
+    /* schedule segments. segments are independent (also segments of different
+     * kernels in this same section), hence they are scheduled in the thread pool */
+    std::vector<std::vector<InstrMove> > segmentMoves(segments.size());
+    runParallelTasks(segments.size(), assembler.threadsNum, [&](size_t s)
+    {
+        const SchedSegment& segment = segments[s];
+        SchedPressure pressure(instrs, regAccesses, keyTypes, segment, regTypesNum);
+        std::vector<size_t> newOrder;
+        bool improved;
+        scheduleSegment(instrs, regAccesses, keyTypes, hazardMinPos, hazardMinDistEnd,
+                    segment.instrStart, segment.instrEnd, pressure, regTypesNum, budget,
+                    newOrder, improved);
+        if (!improved)
+            return;
+        std::vector<InstrMove>& moves = segmentMoves[s];
+        size_t newOffset = instrs[segment.instrStart].offset;
+        for (size_t i: newOrder)
+        {
+            const SchedInstr& sinstr = instrs[segment.instrStart + i];
+            if (sinstr.offset != newOffset)
+                moves.push_back({ sinstr.offset, sinstr.size, newOffset });
+            newOffset += sinstr.size;
+        }
+        std::sort(moves.begin(), moves.end(),
+            [](const InstrMove& a, const InstrMove& b)
+            { return a.offset < b.offset; });
+    });
+    // segments are ordered by offset
+    for (const std::vector<InstrMove>& moves: segmentMoves)
+        instrMoves.insert(instrMoves.end(), moves.begin(), moves.end());
+}
@@ -28,6 +28,7 @@
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdasm/GCNDefs.h>
 #include "AsmRegAlloc.h"
 
 using namespace CLRX;
@@ -75,1008 +76,621 @@ ISAWaitHandler::ReadPos ISAWaitHandler::findPositionByOffset(size_t offset) cons
 static inline uint16_t qregVal(uint16_t reg, bool write)
 { return reg | (write ? 0x8000 : 0); }
 
-static inline bool qregWrite(uint16_t qreg)
-{ return (qreg & 0x8000)!=0; }
-
-static inline uint16_t qregReg(uint16_t qreg)
-{ return qreg & 0x7fff; }
+// QReg of newest delayed op without register results (memory writes)
+static const uint16_t memOpQReg = 0x7fff;
 
 namespace CLRX
 {
 
-struct QueueEntry1
+// pending access of register by delayed op in queue
+struct CLRX_INTERNAL WaitQueueReg
 {
-    std::unordered_set<uint16_t> regs;
-    bool haveDelayedOp;
-    
-    QueueEntry1() : haveDelayedOp(false)
-    { }
+    uint16_t age;   // number of delayed ops in queue issued after this delayed op
+    bool ordered;   // false if delayed op can be finished in random order
     
-    bool empty() const
-    { return haveDelayedOp || !regs.empty(); }
-    
-    void join(const QueueEntry1& b)
-    {
-        regs.insert(b.regs.begin(), b.regs.end());
-        haveDelayedOp |= b.haveDelayedOp;
-    }
+    bool operator==(const WaitQueueReg& b) const
+    { return age == b.age && ordered == b.ordered; }
+};
 
-    // toBEntry - difference offset between output orderedStartPos and
-    // b entry orderedStartPos
-    void joinWithRegPlaces(const QueueEntry1& b, uint16_t toBEntry,
-            uint16_t opos, std::unordered_map<uint16_t, uint16_t>& regPlaces)
+// register access finished by explicit wait instructions (used by relaxing waits)
+struct CLRX_INTERNAL WaitFinishedReg
+{
+    uint16_t age;   // number of delayed ops in queue issued after this delayed op
+    bool ordered;   // false if delayed op can be finished in random order
+    // explicit wait index and maximal count of this wait that finishes access
+    std::vector<std::pair<size_t, uint16_t> > waits;
+    
+    // join with other way: return true if state has been changed
+    bool join(const WaitFinishedReg& b)
     {
-        for (auto e: b.regs)
-            if (regs.insert(e).second)
+        bool changed = false;
+        if (b.age < age || (ordered && !b.ordered))
+        {
+            age = std::min(age, b.age);
+            ordered &= b.ordered;
+            changed = true;
+        }
+        for (const auto& bw: b.waits)
+        {
+            auto it = std::find_if(waits.begin(), waits.end(),
+                    [&bw](const std::pair<size_t, uint16_t>& w)
+                    { return w.first == bw.first; });
+            if (it == waits.end())
+            {
+                waits.push_back(bw);
+                changed = true;
+            }
+            else if (bw.second < it->second)
             {
-                auto rres = regPlaces.insert(std::make_pair(e, opos));
-                if (rres.second && rres.first->second+toBEntry < opos)
-                    rres.first->second = opos;
+                it->second = bw.second;
+                changed = true;
             }
-        regs.insert(b.regs.begin(), b.regs.end());
-        haveDelayedOp |= b.haveDelayedOp;
+        }
+        return changed;
     }
-    
-    size_t size() const
-    { return regs.size(); }
 };
 
-// toBEntry - difference offset between output orderedStartPos and
-// regPlaces entry orderedStartPos
-static inline void updateRegPlaces(const QueueEntry1& b, uint16_t toBEntry,
-                uint16_t opos, std::unordered_map<uint16_t, uint16_t>& regPlaces)
-{
-    for (auto e: b.regs)
-    {
-        auto rres = regPlaces.insert(std::make_pair(e, opos));
-        if (rres.second && rres.first->second+toBEntry < opos)
-            rres.first->second = opos;
-    }
-}
-
-
-struct CLRX_INTERNAL QueueState1
+struct CLRX_INTERNAL WaitQueueState
 {
-    cxuint maxQueueSize;
-    uint16_t minQueueIndex;
-    uint16_t orderedStartPos;
-    std::deque<QueueEntry1> ordered;  // ordered items
-    QueueEntry1 random;   // items in random order
-    // register place in queue - key - reg, value - position
-    std::unordered_map<uint16_t, uint16_t> regPlaces;
-    // request queue size at start of block (by enqueuing and waiting/flushing)
-    // used while joining with previous block
-    cxuint requestedQueueSize;
-    bool firstFlush;
-    bool reallyFlushed; // if really already flushed (queue size has been shrinked)
-    
-    QueueState1(cxuint _maxQueueSize = 0) : maxQueueSize(_maxQueueSize),
-                minQueueIndex(0), orderedStartPos(0), requestedQueueSize(_maxQueueSize),
-                firstFlush(true), reallyFlushed(false)
+    // key - qreg (register and access type)
+    std::unordered_map<uint16_t, WaitQueueReg> regs;
+    bool randomPending; // true if any delayed op in random order is not finished
+    // accesses that would be pending if explicit waits were removed
+    std::unordered_map<uint16_t, WaitFinishedReg> finishedRegs;
+    // explicit waits which finished delayed ops in random order
+    std::vector<size_t> randomFinishWaits;
+    
+    WaitQueueState() : randomPending(false)
     { }
     
-    void setMaxQueueSize(cxuint _maxQueueSize)
-    { requestedQueueSize = maxQueueSize = _maxQueueSize; }
+    // get wait count needed to finish access of register (UINT16_MAX - not needed)
+    uint16_t getWaitForReg(uint16_t qreg) const
+    {
+        auto it = regs.find(qreg);
+        if (it == regs.end())
+            return UINT16_MAX;
+        // delayed op in random order can finish after newer ops
+        return (it->second.ordered && !randomPending) ? it->second.age : 0;
+    }
     
-    void pushOrdered(uint16_t reg)
+    // wait until only waitCnt delayed ops are pending
+    void flushTo(uint16_t waitCnt)
     {
-        if (reg == UINT16_MAX)
+        if (waitCnt == 0)
         {
-            // push same delayed op (no reg)
-            ordered.back().haveDelayedOp = true;
+            regs.clear();
+            randomPending = false;
             return;
         }
-        regPlaces[reg] = orderedStartPos + ordered.size()-1;
-        ordered.back().regs.insert(reg);
+        if (randomPending)
+            return; // any delayed op can be still pending
+        for (auto it = regs.begin(); it != regs.end();)
+            if (it->second.age >= waitCnt)
+                it = regs.erase(it);
+            else
+                ++it;
     }
     
-    void pushRandom(uint16_t reg)
+    /* explicit wait: remember accesses finished by this wait. Accesses finished
+     * by previous waits, which can be finished also by this wait, are assigned
+     * to this wait (wait closest to access), hence previous waits can be relaxed */
+    void flushToByWait(uint16_t waitCnt, size_t waitIndex)
     {
-        if (reg != UINT16_MAX)
-            random.regs.insert(reg);
-        else
-            // push same delayed op (no reg)
-            random.haveDelayedOp = true;
+        const bool randomFinished = randomPending || !randomFinishWaits.empty();
+        for (auto& e: finishedRegs)
+            if (waitCnt == 0 || (!randomFinished && e.second.ordered &&
+                    e.second.age >= waitCnt))
+                e.second.waits.assign(1, std::make_pair(waitIndex,
+                        e.second.ordered ? e.second.age : uint16_t(0)));
+        if (waitCnt == 0 && randomFinished)
+            randomFinishWaits.assign(1, waitIndex);
+        for (const auto& e: regs)
+        {
+            if (e.first == memOpQReg ||
+                (waitCnt != 0 && (randomPending || e.second.age < waitCnt)))
+                continue;
+            // maximal count that finishes this access
+            const uint16_t maxCnt = e.second.ordered ? e.second.age : 0;
+            WaitFinishedReg newReg{ e.second.age, e.second.ordered,
+                        { { waitIndex, maxCnt } } };
+            auto res = finishedRegs.insert({ e.first, newReg });
+            if (!res.second)
+                res.first->second.join(newReg);
+        }
+        flushTo(waitCnt);
     }
     
-    void nextEntry()
+    // push next delayed op to queue
+    void nextEntry(uint16_t queueSize)
     {
-        if (ordered.empty() || !ordered.back().empty())
-            // push only if empty or previous is filled
-            ordered.push_back(QueueEntry1());
-        
-        if (ordered.size() == maxQueueSize)
+        for (auto it = regs.begin(); it != regs.end();)
         {
-            // move first entry in ordered queue to first ordered
-            QueueEntry1& firstOrdered = ordered.front();
-            orderedStartPos++; // next start pos for ordered queue for first entry
-            if (orderedStartPos-minQueueIndex > 10000)
+            if (!it->second.ordered)
             {
-                for (auto e: firstOrdered.regs)
-                {
-                    auto rpit = regPlaces.find(e);
-                    // update regPlaces for firstOrdered before joining
-                    rpit->second = orderedStartPos;
-                }
-                minQueueIndex = orderedStartPos;
+                ++it;
+                continue;
             }
-            auto ordit = ordered.begin();
-            ++ordit; // second entry
-            QueueEntry1& second = *ordit;
-            // to second entry
-            second.regs.insert(firstOrdered.regs.begin(), firstOrdered.regs.end());
-            ordered.pop_front();
-        }
-        requestedQueueSize = std::max(requestedQueueSize+1, maxQueueSize);
-    }
-    void flushTo(cxuint size)
-    {
-        if (firstFlush && ordered.size() < size)
-        {
-            // if higher than queue size and higher than requested queue size
-            requestedQueueSize = size;
-            firstFlush = false;
-            return;
+            it->second.age++;
+            // queue can not hold more delayed ops, hence it has been finished
+            if (it->second.age >= queueSize-1)
+                it = regs.erase(it);
+            else
+                ++it;
         }
-        reallyFlushed = (ordered.size() <= size);
-        firstFlush = false;
-        if (size == 0)
-            random.regs.clear(); // clear randomly ordered if must be empty
-        while (size < ordered.size())
+        for (auto it = finishedRegs.begin(); it != finishedRegs.end();)
         {
-            for (auto e: ordered.front().regs)
+            if (!it->second.ordered)
             {
-                auto prit = regPlaces.find(e);
-                if (prit != regPlaces.end() && prit->second == orderedStartPos)
-                    regPlaces.erase(prit); // remove from regPlaces if in this place
+                ++it;
+                continue;
             }
-            ordered.pop_front();
-            orderedStartPos++;
+            it->second.age++;
+            if (it->second.age >= queueSize-1)
+                it = finishedRegs.erase(it);
+            else
+                ++it;
         }
-        minQueueIndex = orderedStartPos;
-        requestedQueueSize = std::min(size, requestedQueueSize);
     }
     
-    uint16_t findMinQueueSizeForReg(uint16_t reg) const
+    void pushReg(uint16_t qreg, bool ordered)
     {
-        auto it = regPlaces.find(reg);
-        if (it == regPlaces.end())
-            // if found, then 0 otherwize not found (UINT_MAX)
-            return random.regs.find(reg) != random.regs.end() ? 0 : UINT16_MAX;
-        const uint16_t pos = std::min(
-                    int(maxQueueSize), int(it->second - orderedStartPos));
-        return ordered.size()-1 - cxuint(pos);
+        regs[qreg] = WaitQueueReg{ 0, ordered };
+        // new delayed op replaces previous access
+        finishedRegs.erase(qreg);
+        if (!ordered)
+            randomPending = true;
     }
     
-    void joinWay(const QueueState1& way)
+    // join with other way: return true if state has been changed
+    bool join(const WaitQueueState& b)
     {
-        random.join(way.random);
-        
-        auto oit1 = ordered.begin();
-        auto oit2 = way.ordered.begin();
-        const int queueSizeDiff = way.ordered.size() - ordered.size();
-        uint16_t qpos = orderedStartPos;
-        uint16_t wayStartPos = way.orderedStartPos;
-        if (queueSizeDiff > 0)
+        bool changed = false;
+        for (const auto& e: b.regs)
         {
-            ordered.insert(ordered.begin(), way.ordered.begin(),
-                    way.ordered.begin() + queueSizeDiff);
-            oit2 += queueSizeDiff;
-            orderedStartPos -= queueSizeDiff;
-            oit1 = ordered.begin() + queueSizeDiff;
-            qpos = orderedStartPos;
-            // update regPlaces after pushing to front
-            for (auto oitx = ordered.begin(); oitx != oit1; ++oitx, ++qpos)
-                updateRegPlaces(*oitx, orderedStartPos-wayStartPos, qpos, regPlaces);
+            auto res = regs.insert(e);
+            if (res.second)
+                changed = true;
+            else if (!(res.first->second == e.second))
+            {
+                WaitQueueReg& r = res.first->second;
+                const WaitQueueReg old = r;
+                r.age = std::min(r.age, e.second.age);
+                r.ordered &= e.second.ordered;
+                changed |= !(old == r);
+            }
         }
-        else
+        if (b.randomPending && !randomPending)
         {
-            oit1 -= queueSizeDiff;
-            qpos -= queueSizeDiff;
+            randomPending = true;
+            changed = true;
         }
-        // join entries
-        for (; oit1 != ordered.end(); ++oit1, ++oit2, ++qpos)
-            oit1->joinWithRegPlaces(*oit2, orderedStartPos-wayStartPos, qpos, regPlaces);
-        
-        firstFlush |= way.firstFlush;
-        requestedQueueSize = std::max(requestedQueueSize, way.requestedQueueSize);
-    }
-    
-    bool joinNext(const QueueState1& next)
-    {
-        if (!reallyFlushed)
+        for (const auto& e: b.finishedRegs)
         {
-            if (next.random.empty() && next.ordered.empty() &&
-                next.requestedQueueSize == maxQueueSize)
-                // no change
-                return false;
-            
-            cxuint nextReqQSize = std::min(next.requestedQueueSize, requestedQueueSize);
-            const cxuint oldOrderedSize = ordered.size();
-            const cxuint prevOrderedSize = (nextReqQSize!=ordered.size() ?
-                    nextReqQSize-ordered.size() : next.ordered.size());
-            ordered.erase(ordered.begin(), ordered.end()-prevOrderedSize);
-            ordered.insert(ordered.end(), next.ordered.begin(), next.ordered.end());
-            orderedStartPos += ordered.size()-oldOrderedSize;
-            uint16_t nextStartPos = next.orderedStartPos - prevOrderedSize;
-            uint16_t qpos = orderedStartPos;
-            // update regplaces for front
-            for (auto oitx = ordered.begin() + prevOrderedSize; oitx != ordered.end();
-                        ++oitx, ++qpos)
-                updateRegPlaces(*oitx, orderedStartPos-nextStartPos, qpos, regPlaces);
-            
-            if (ordered.size() > maxQueueSize)
+            auto res = finishedRegs.insert(e);
+            if (res.second)
+                changed = true;
+            else
+                changed |= res.first->second.join(e.second);
+        }
+        for (size_t waitIndex: b.randomFinishWaits)
+            if (std::find(randomFinishWaits.begin(), randomFinishWaits.end(),
+                    waitIndex) == randomFinishWaits.end())
             {
-                // push to first ordered
-                size_t toFirst = ordered.size() - maxQueueSize;
-                auto firstOrderedIt = ordered.begin() + toFirst;
-                for (auto it = ordered.begin(); it!=firstOrderedIt; ++it)
-                    firstOrderedIt->joinWithRegPlaces(*it, 0,
-                            orderedStartPos + toFirst, regPlaces);
-                ordered.erase(ordered.begin(), firstOrderedIt);
-                orderedStartPos += toFirst;
+                randomFinishWaits.push_back(waitIndex);
+                changed = true;
             }
-            random.join(next.random);
-            requestedQueueSize = std::min(nextReqQSize, maxQueueSize);
-            return true;
-        }
-        
-        return false;
-    }
-    
-    size_t weight() const
-    {
-        size_t w = random.size();
-        for (const QueueEntry1& e: ordered)
-            w += e.size();
-        return w;
-    }
-};
-
-struct CLRX_INTERNAL WaitFirstCacheEntry
-{
-    QueueState1 queues[ASM_WAIT_MAX_TYPES_NUM];
-    
-    size_t weight() const
-    {
-        size_t w = 0;
-        for (const QueueState1& q: queues)
-            w += q.weight();
-        return w;
+        return changed;
     }
 };
 
-struct CLRX_INTERNAL RRegInfo
+struct CLRX_INTERNAL WaitState
 {
-    size_t offset;  /// offset where is usage
-    uint16_t qsizes[ASM_WAIT_MAX_TYPES_NUM];  /// queue sizes in this reg usage
-    uint16_t waits[ASM_WAIT_MAX_TYPES_NUM];  /// pending waits from block to this place
+    WaitQueueState queues[ASM_WAIT_MAX_TYPES_NUM];
 };
 
-typedef std::unordered_map<uint16_t, RRegInfo> RRegMap;
-
-struct CLRX_INTERNAL WaitSecRRegTreeEntry
-{
-    size_t blockIndex;
-    std::vector<uint16_t> firstRegs; // sorted
-    std::vector<size_t> nextBlocks;
 };
 
-struct CLRX_INTERNAL WaitSecCacheEntry
-{
-    RRegMap firstRegs;
-    // tree of first regs, first entry is start point
-    // nextBlocks points to next points of ways
-    std::vector<WaitSecCacheEntry> firstRegsOrdering;
-    
-    size_t weight() const
-    { return firstRegs.size() + firstRegsOrdering.size(); }
-};
-
-struct CLRX_INTERNAL WaitFlowStackEntry0
-{
-    size_t blockIndex;
-    size_t nextIndex;
-    bool isCall;
-    bool haveReturn;
-    
-    QueueState1 queues[ASM_WAIT_MAX_TYPES_NUM];
-    
-    WaitFlowStackEntry0(size_t _blockIndex, size_t _nextIndex,
-                        const AsmWaitConfig& waitConfig)
-            : blockIndex(_blockIndex), nextIndex(_nextIndex), isCall(false)
-    {
-        setMaxQueueSizes(waitConfig);
-    }
-    
-    WaitFlowStackEntry0(size_t _blockIndex, size_t _nextIndex, bool _isCall,
-                        const AsmWaitConfig& waitConfig)
-            : blockIndex(_blockIndex), nextIndex(_nextIndex), isCall(_isCall)
-    {
-        setMaxQueueSizes(waitConfig);
-    }
-    
-    WaitFlowStackEntry0(size_t _blockIndex, size_t _nextIndex,
-                        const WaitFlowStackEntry0& prev,
-                        const AsmWaitConfig& waitConfig)
-            : blockIndex(_blockIndex), nextIndex(_nextIndex)
-    {
-        setMaxQueueSizes(waitConfig);
-        std::copy(prev.queues, prev.queues + waitConfig.waitQueuesNum, queues);
-    }
-    
-    void setMaxQueueSizes(const AsmWaitConfig& waitConfig)
-    {
-        for (cxuint i = 0; i < waitConfig.waitQueuesNum; i++)
-            queues[i].setMaxQueueSize(waitConfig.waitQueueSizes[i]);
-    }
-};
-
-struct CLRX_INTERNAL WaitInstrXInfo
-{
-    size_t offset;
-    uint16_t waits[ASM_WAIT_MAX_TYPES_NUM];
-    uint16_t qsizes[ASM_WAIT_MAX_TYPES_NUM];
-};
-
-struct CLRX_INTERNAL WaitCodeBlock
-{
-    QueueState1 queues[ASM_WAIT_MAX_TYPES_NUM];
-    std::vector<AsmWaitInstr> waitInstrs;
-    // before wait instrs for delayed op in this block
-    std::vector<WaitInstrXInfo> firstWaitInstrs;
-    std::vector<std::pair<uint16_t, RRegInfo> > firstRegs; ///< first occurence of reg
-    
-    void setMaxQueueSizes(const AsmWaitConfig& waitConfig)
-    {
-        for (cxuint i = 0; i < waitConfig.waitQueuesNum; i++)
-            queues[i].setMaxQueueSize(waitConfig.waitQueueSizes[i]);
-    }
-};
-
-};
-
-static cxuint getRegType(size_t regTypesNum, const cxuint* regRanges,
-            const AsmSingleVReg& svreg)
-{
-    cxuint regType; // regtype
-    if (svreg.regVar!=nullptr)
-        regType = svreg.regVar->type;
-    else
-        for (regType = 0; regType < regTypesNum; regType++)
-            if (svreg.index >= regRanges[regType<<1] &&
-                svreg.index < regRanges[(regType<<1)+1])
-                break;
-    return regType;
-}
-
-static void getVIdx(const AsmSingleVReg& svreg, size_t ssaIdIdx,
-        const AsmRegAllocator::SSAInfo& ssaInfo, const VarIndexMap* vregIndexMaps,
-        size_t regTypesNum, const cxuint* regRanges, cxuint& regType, size_t& vidx)
-{
-    size_t ssaId;
-    if (svreg.regVar==nullptr)
-        ssaId = 0;
-    else if (ssaIdIdx==0)
-        ssaId = ssaInfo.ssaIdBefore;
-    else if (ssaIdIdx==1)
-        ssaId = ssaInfo.ssaIdFirst;
-    else if (ssaIdIdx<ssaInfo.ssaIdChange)
-        ssaId = ssaInfo.ssaId + ssaIdIdx-1;
-    else // last
-        ssaId = ssaInfo.ssaIdLast;
-    
-    regType = getRegType(regTypesNum, regRanges, svreg); // regtype
-    const VarIndexMap& vregIndexMap = vregIndexMaps[regType];
-    const std::vector<size_t>& vidxes = vregIndexMap.find(svreg)->second;
-    /*ARDOut << "lvn[" << regType << "][" << vidxes[ssaId] << "]. ssaIdIdx: " <<
-            ssaIdIdx << ". ssaId: " << ssaId << ". svreg: " << svreg.regVar << ":" <<
-            svreg.index << "\n";*/
-    //return livenesses[regType][ssaIdIndices[ssaId]];
-    vidx = vidxes[ssaId];
-}
-
-static cxuint getRRegFromSVReg(const AsmSingleVReg& svreg, size_t outSSAIdIdx,
-        const CodeBlock& cblock, const VarIndexMap* vregIndexMaps,
-        const Array<cxuint>* graphColorMaps, size_t regTypesNum, const cxuint* regRanges)
-{
-    cxuint rreg = svreg.index;
-    
-    if (svreg.regVar != nullptr)
-    {
-        // if regvar, get vidx and get from vidx register index
-        // get real register index
-        const SSAInfo& ssaInfo = binaryMapFind(cblock.ssaInfoMap.begin(),
-                cblock.ssaInfoMap.end(), svreg)->second;
-        cxuint regType;
-        size_t vidx;
-        getVIdx(svreg, outSSAIdIdx, ssaInfo, vregIndexMaps,
-                regTypesNum, regRanges, regType, vidx);
-        rreg = regRanges[2*regType] + graphColorMaps[regType][vidx];
-    }
-    
-    return rreg;
-}
+AsmWaitScheduler::AsmWaitScheduler(const AsmWaitConfig& _asmWaitConfig,
+        Assembler& _assembler, const std::vector<CodeBlock>& _codeBlocks,
+        const VarIndexMap* _vregIndexMaps, const Array<cxuint>* _graphColorMaps,
+        bool _onlyWarnings)
+        : waitConfig(_asmWaitConfig), assembler(_assembler), codeBlocks(_codeBlocks),
+          vregIndexMaps(_vregIndexMaps), graphColorMaps(_graphColorMaps),
+          onlyWarnings(_onlyWarnings), vsCntQueue(false), trackFinished(false)
+{ }
 
-static void processQueueBlock(const CodeBlock& cblock, WaitCodeBlock& wblock,
-        ISAWaitHandler& waitHandler, ISAWaitHandler::ReadPos& waitPos,
-        ISAUsageHandler& usageHandler, const AsmWaitConfig& waitConfig,
-        const VarIndexMap* vregIndexMaps, const Array<cxuint>* graphColorMaps,
-        size_t regTypesNum, const cxuint* regRanges, bool onlyWarnings)
+/* process instructions of code block: find waits needed by register accesses
+ * (read after delayed write, write after delayed write or delayed read out) and
+ * update queue states. If neededWaits is not null then put needed waits to it.
+ * If waitDemands is not null then lower counts of explicit wait instructions
+ * (indexed as waitInstrs) to counts that finish accesses needed later
+ * or accesses finished before synchronizing instructions (barriers) */
+void AsmWaitScheduler::processBlock(const CodeBlock& cblock, WaitState& state,
+        const std::vector<AsmRegVarUsage>& usages,
+        const std::vector<AsmDelayedOp>& delayedOps,
+        const std::vector<AsmWaitInstr>& waitInstrs,
+        std::vector<AsmWaitInstr>* neededWaits,
+        std::vector<AsmWaitInstr>* waitDemands) const
 {
-    // fill usage of registers (real access) to wCblock
-    ISAUsageHandler::ReadPos usagePos = cblock.usagePos;
-    
-    SVRegMap ssaIdIdxMap;
-    SVRegMap svregWriteOffsets;
-    std::vector<AsmRegVarUsage> instrRVUs;
-    
-    RRegMap firstRegs;
-    // process waits and delayed ops
-    AsmWaitInstr waitInstr;
-    AsmDelayedOp delayedOp;
-    size_t instrOffset = SIZE_MAX;
-    bool isWaitInstr = false;
-    if (waitHandler.hasNext(waitPos))
-    {
-        isWaitInstr = waitHandler.nextInstr(waitPos, delayedOp, waitInstr);
-        instrOffset = (isWaitInstr ? waitInstr.offset : delayedOp.offset);
-    }
-    
-    uint16_t curQueueSizes[ASM_WAIT_MAX_TYPES_NUM];
-    uint16_t curWaits[ASM_WAIT_MAX_TYPES_NUM];
-    std::fill(curWaits, curWaits + waitConfig.waitQueuesNum, uint16_t(0));
-    // we assume that current queue size at start is not limited
-    std::fill(curQueueSizes, curQueueSizes + waitConfig.waitQueuesNum, UINT16_MAX);
-    
-    cxuint flushedQueues = 0;
-    while (usageHandler.hasNext(usagePos))
+    const cxuint queuesNum = waitConfig.waitQueuesNum;
+    auto uit = std::lower_bound(usages.begin(), usages.end(), cblock.start,
+            [](const AsmRegVarUsage& u, size_t offset) { return u.offset < offset; });
+    auto dit = std::lower_bound(delayedOps.begin(), delayedOps.end(), cblock.start,
+            [](const AsmDelayedOp& d, size_t offset) { return d.offset < offset; });
+    auto wit = std::lower_bound(waitInstrs.begin(), waitInstrs.end(), cblock.start,
+            [](const AsmWaitInstr& w, size_t offset) { return w.offset < offset; });
+    
+    while (true)
     {
-        const AsmRegVarUsage rvu = usageHandler.nextUsage(usagePos);
-        if (rvu.offset >= cblock.end && instrOffset >= cblock.end)
+        const size_t offset = std::min(std::min(
+                uit != usages.end() ? uit->offset : SIZE_MAX,
+                dit != delayedOps.end() ? dit->offset : SIZE_MAX),
+                wit != waitInstrs.end() ? wit->offset : SIZE_MAX);
+        if (offset >= cblock.end)
             break;
+        const auto dend = std::find_if(dit, delayedOps.end(),
+                [offset](const AsmDelayedOp& d) { return d.offset != offset; });
         
-        bool genWaitCnt = false;
-        // gwaitI - current wait instruction
-        AsmWaitInstr gwaitI { rvu.offset, { } };
-        for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
-            gwaitI.waits[q] = waitConfig.waitQueueSizes[q]-1;
-        
-        std::vector<std::pair<uint16_t, RRegInfo> > curRegs;
-        
-        if (rvu.offset < cblock.end && rvu.offset <= instrOffset)
+        AsmWaitInstr waitI{ offset, { } };
+        for (cxuint q = 0; q < queuesNum; q++)
+            waitI.waits[q] = waitConfig.waitQueueSizes[q]-1;
+        bool genWait = false;
+        // demand count of explicit wait that finished access
+        auto demandWait = [&](size_t waitIndex, cxuint q, uint16_t maxCnt)
+        {
+            uint16_t& cnt = (*waitDemands)[waitIndex].waits[q];
+            cnt = std::min(cnt, maxCnt);
+        };
+        auto checkReg = [&](uint16_t qreg, cxint ownQueue)
         {
-            // process RegVar usage
-            for (uint16_t rindex = rvu.rstart; rindex < rvu.rend; rindex++)
+            for (cxuint q = 0; q < queuesNum; q++)
             {
-                AsmSingleVReg svreg{ rvu.regVar, rindex };
-                
-                size_t outSSAIdIdx = 0;
-                if (rvu.regVar != nullptr)
+                const WaitQueueState& queue = state.queues[q];
+                auto it = queue.regs.find(qreg);
+                if (it != queue.regs.end())
                 {
-                    // if regvar, get vidx and get from vidx register index
-                    if (checkWriteWithSSA(rvu))
-                    {
-                        size_t& ssaIdIdx = ssaIdIdxMap[svreg];
-                        if (svreg.regVar != nullptr)
-                            ssaIdIdx++;
-                        outSSAIdIdx = ssaIdIdx;
-                        svregWriteOffsets.insert({ svreg, rvu.offset });
-                    }
-                    else // insert zero
-                    {
-                        outSSAIdIdx = 0;
-                        auto svrres = ssaIdIdxMap.insert({ svreg, 0 });
-                        outSSAIdIdx = svrres.first->second;
-                        auto swit = svregWriteOffsets.find(svreg);
-                        if (swit != svregWriteOffsets.end() && swit->second == rvu.offset)
-                            outSSAIdIdx--; // before this write
-                    }
-                }
-                const cxuint rreg = getRRegFromSVReg(svreg, outSSAIdIdx, cblock,
-                            vregIndexMaps, graphColorMaps, regTypesNum, regRanges);
-                
-                // put to readRegs and writeRegs
-                if ((rvu.rwFlags & ASMRVU_READ) != 0)
-                    curRegs.push_back({ qregVal(rreg, false), { rvu.offset } });
-                if ((rvu.rwFlags & ASMRVU_WRITE) != 0)
-                    curRegs.push_back({ qregVal(rreg, true), { rvu.offset } });
-                
-                // rreg
-                if ((rvu.rwFlags & ASMRVU_READ) != 0)
-                    for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
-                    {
-                        uint16_t waitCnt = wblock.queues[q]
-                            .findMinQueueSizeForReg(qregVal(rreg, false));
-                        if (waitCnt != UINT16_MAX)
-                        {
-                            if (!onlyWarnings)
-                            {
-                                gwaitI.waits[q] = std::min(gwaitI.waits[q], waitCnt);
-                                genWaitCnt = true;
-                            }
-                        }
-                    }
-                if ((rvu.rwFlags & ASMRVU_WRITE) != 0)
-                    for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
+                    // without waits that finished delayed ops in random order,
+                    // needed wait would be different
+                    if (waitDemands != nullptr && it->second.ordered && !queue.randomPending)
+                        for (size_t waitIndex: queue.randomFinishWaits)
+                            demandWait(waitIndex, q, 0);
+                    // write by ordered delayed op in this same queue finishes later
+                    if (!(cxint(q) == ownQueue && it->second.ordered &&
+                            !queue.randomPending))
                     {
-                        uint16_t waitCnt = wblock.queues[q]
-                            .findMinQueueSizeForReg(qregVal(rreg, true));
-                        if (waitCnt != UINT16_MAX)
+                        const uint16_t waitCnt = queue.getWaitForReg(qreg);
+                        if (waitCnt < waitI.waits[q])
                         {
-                            if (!onlyWarnings)
-                            {
-                                gwaitI.waits[q] = std::min(gwaitI.waits[q], waitCnt);
-                                genWaitCnt = true;
-                            }
+                            waitI.waits[q] = waitCnt;
+                            genWait = true;
                         }
                     }
+                }
+                if (waitDemands == nullptr)
+                    continue;
+                // access finished by explicit waits: these waits must finish it
+                auto fit = queue.finishedRegs.find(qreg);
+                if (fit == queue.finishedRegs.end() ||
+                    (cxint(q) == ownQueue && fit->second.ordered && !queue.randomPending &&
+                        queue.randomFinishWaits.empty()))
+                    continue;
+                for (const auto& w: fit->second.waits)
+                    demandWait(w.first, q, w.second);
+                for (size_t waitIndex: queue.randomFinishWaits)
+                    demandWait(waitIndex, q, 0);
             }
-            
-            if (genWaitCnt && rvu.offset != instrOffset)
+        };
+        for (; uit != usages.end() && uit->offset == offset; ++uit)
+            for (uint16_t rreg = uit->rstart; rreg < uit->rend; rreg++)
             {
-                // generate wait instr
-                wblock.waitInstrs.push_back(gwaitI);
-                for (cxuint w = 0; w < waitConfig.waitQueuesNum; w++)
-                    wblock.queues[w].flushTo(gwaitI.waits[w]);
+                if ((uit->rwFlags & ASMRVU_READ) != 0)
+                    checkReg(qregVal(rreg, true), -1);
+                if ((uit->rwFlags & ASMRVU_WRITE) == 0)
+                    continue;
+                // find queue of ordered delayed op which writes this register
+                cxint ownQueue = -1;
+                for (auto it = dit; it != dend; ++it)
+                    if (it->regVar == nullptr && (it->rwFlags & ASMRVU_WRITE) != 0 &&
+                        rreg >= it->rstart && rreg < it->rend &&
+                        waitConfig.delayOpTypes[it->delayedOpType].ordered)
+                        ownQueue = waitConfig.delayOpTypes[it->delayedOpType].waitType;
+                checkReg(qregVal(rreg, true), ownQueue);
+                checkReg(qregVal(rreg, false), -1);
             }
-        }
         
-        if (instrOffset < cblock.end && rvu.offset >= instrOffset && isWaitInstr)
-        {
-            // process wait instr
-            if (genWaitCnt)
+        /* synchronizing instruction (barrier): memory ops finished by explicit waits
+         * must be still finished before it (other waves access memory after it) */
+        if (waitDemands != nullptr && std::any_of(dit, dend, [](const AsmDelayedOp& d)
+                    { return d.delayedOpType == ASMDELOP_SYNC; }))
+            for (cxuint q = 0; q < queuesNum; q++)
             {
-                // if user waitinstr and generate wait instr
-                // then choose min queue sizes in wait instr and generate new
-                // wait instr.
-                for (cxuint w = 0; w < waitConfig.waitQueuesNum; w++)
-                    gwaitI.waits[w] = std::min(gwaitI.waits[w], waitInstr.waits[w]);
-                wblock.waitInstrs.push_back(gwaitI);
-                for (cxuint w = 0; w < waitConfig.waitQueuesNum; w++)
-                    wblock.queues[w].flushTo(gwaitI.waits[w]);
+                const WaitQueueState& queue = state.queues[q];
+                for (const auto& e: queue.finishedRegs)
+                    for (const auto& w: e.second.waits)
+                        demandWait(w.first, q, w.second);
+                for (size_t waitIndex: queue.randomFinishWaits)
+                    demandWait(waitIndex, q, 0);
             }
-            else
-            {
-                wblock.waitInstrs.push_back(waitInstr);
-                for (cxuint w = 0; w < waitConfig.waitQueuesNum; w++)
+        
+        if (genWait)
+        {
+            if (neededWaits != nullptr)
+                neededWaits->push_back(waitI);
+            if (!onlyWarnings)
+                for (cxuint q = 0; q < queuesNum; q++)
                 {
-                    wblock.queues[w].flushTo(waitInstr.waits[w]);
-                    gwaitI.waits[w] = waitInstr.waits[w];
-                    genWaitCnt = true;
+                    WaitQueueState& queue = state.queues[q];
+                    queue.flushTo(waitI.waits[q]);
+                    // needed wait finishes all accesses also without explicit waits
+                    if (waitI.waits[q] == 0)
+                    {
+                        queue.finishedRegs.clear();
+                        queue.randomFinishWaits.clear();
+                    }
                 }
-            }
         }
-        
-        // update curQueue sizes from curent waitcnt
-        if (genWaitCnt && flushedQueues < waitConfig.waitQueuesNum)
-            for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
+        // explicit wait instruction
+        for (; wit != waitInstrs.end() && wit->offset == offset; ++wit)
+        {
+            const size_t waitIndex = wit - waitInstrs.begin();
+            if (waitDemands != nullptr)
             {
-                if (!wblock.queues[q].reallyFlushed)
+                // delayed ops without register results (memory writes) that are
+                // finished by wait must be finished also by relaxed wait
+                AsmWaitInstr& demand = (*waitDemands)[waitIndex];
+                demand.offset = offset;
+                for (cxuint q = 0; q < queuesNum; q++)
                 {
-                    // update wait after flush
-                    curQueueSizes[q] = wblock.queues[q].requestedQueueSize;
-                    curWaits[q] = std::min(curWaits[q],
-                                uint16_t(wblock.queues[q].ordered.size()));
-                }
-                else
-                {
-                    // increment flushQueues when queue has been flushed now
-                    if (curWaits[q] != UINT16_MAX)
-                        flushedQueues++;
-                    curWaits[q] = UINT16_MAX;
+                    const uint16_t memOpCnt = state.queues[q].getWaitForReg(memOpQReg);
+                    if (memOpCnt != UINT16_MAX && wit->waits[q] <= memOpCnt)
+                        demandWait(waitIndex, q, memOpCnt);
                 }
             }
+            for (cxuint q = 0; q < queuesNum; q++)
+                if (trackFinished)
+                    state.queues[q].flushToByWait(wit->waits[q], waitIndex);
+                else
+                    state.queues[q].flushTo(wit->waits[q]);
+        }
         
-        if (instrOffset < cblock.end && rvu.offset >= instrOffset)
+        if (dit == dend)
+            continue;
+        // next entries in queues used by instruction
+        bool usedQueues[ASM_WAIT_MAX_TYPES_NUM] = { };
+        bool writingQueues[ASM_WAIT_MAX_TYPES_NUM] = { };
+        bool orderedQueues[ASM_WAIT_MAX_TYPES_NUM] = { };
+        for (auto it = dit; it != dend; ++it)
         {
-            if (!isWaitInstr)
-            {
-                // delayed op
-                const AsmDelayedOpTypeEntry& delOpEntry = waitConfig.delayOpTypes[
-                                delayedOp.delayedOpType];
-                const cxuint queue1Idx = delOpEntry.waitType;
-                const cxuint queue2Idx = delayedOp.delayedOpType!=ASMDELOP_NONE ?
-                        waitConfig.delayOpTypes[delayedOp.delayedOpType].waitType :
-                        UINT_MAX;
-                // next entry
-                wblock.queues[queue1Idx].nextEntry();
-                if (queue2Idx != UINT_MAX)
-                    wblock.queues[queue2Idx].nextEntry();
-                cxuint rcount = 0, rcount2 = 0;
-                
-                for (uint16_t rindex = delayedOp.rstart;
-                                    rindex < delayedOp.rend; rindex++)
+            const cxbyte opTypes[2] = { it->delayedOpType, it->delayedOpType2 };
+            for (cxuint k = 0; k < 2; k++)
+                if (opTypes[k] != ASMDELOP_NONE && opTypes[k] != ASMDELOP_SYNC)
                 {
-                    AsmSingleVReg svreg{ delayedOp.regVar, rindex };
-                    const size_t ssaIdIdx = ssaIdIdxMap.find(svreg)->second;
-                    const cxuint rreg = getRRegFromSVReg(svreg, ssaIdIdx, cblock,
-                            vregIndexMaps, graphColorMaps, regTypesNum, regRanges);
-                    
-                    if ((delayedOp.rwFlags & ASMRVU_READ) != 0 &&
-                                delOpEntry.finishOnRegReadOut)
-                    {
-                        const uint16_t qreg = qregVal(rreg, false);
-                        if (delOpEntry.ordered)
-                            wblock.queues[queue1Idx].pushOrdered(qreg);
-                        else
-                            wblock.queues[queue1Idx].pushRandom(qreg);
-                    }
-                    if ((delayedOp.rwFlags & ASMRVU_WRITE) != 0)
+                    // GCN 1.5: VM ops without results are counted by separate counter
+                    const cxbyte rwFlags = k==0 ? it->rwFlags : it->rwFlags2;
+                    const AsmDelayedOpTypeEntry& opEntry =
+                                waitConfig.delayOpTypes[opTypes[k]];
+                    if (!vsCntQueue || opTypes[k] != GCNDELOP_VMOP ||
+                        (rwFlags & ASMRVU_WRITE) != 0)
                     {
-                        const uint16_t qreg = qregVal(rreg, true);
-                        if (delOpEntry.ordered)
-                            wblock.queues[queue1Idx].pushOrdered(qreg);
-                        else
-                            wblock.queues[queue1Idx].pushRandom(qreg);
-                    }
-                    // if queue2
-                    if (queue2Idx != UINT_MAX)
-                    {
-                        const AsmDelayedOpTypeEntry& delOpEntry2 =
-                                waitConfig.delayOpTypes[delayedOp.delayedOpType2];
-                        if ((delayedOp.rwFlags2 & ASMRVU_READ) != 0 &&
-                                delOpEntry2.finishOnRegReadOut)
-                        {
-                            const uint16_t qreg = qregVal(rreg, false);
-                            if (delOpEntry2.ordered)
-                                wblock.queues[queue2Idx].pushOrdered(qreg);
-                            else
-                                wblock.queues[queue2Idx].pushRandom(qreg);
-                        }
-                        if ((delayedOp.rwFlags2 & ASMRVU_WRITE) != 0)
-                        {
-                            const uint16_t qreg = qregVal(rreg, true);
-                            if (delOpEntry2.ordered)
-                                wblock.queues[queue2Idx].pushOrdered(qreg);
-                            else
-                                wblock.queues[queue2Idx].pushRandom(qreg);
-                        }
-                        // do next queue entry if registered per element
-                        rcount2 += 4;
-                        if (delOpEntry2.counting!=255 && delOpEntry2.counting <= rcount)
-                        {
-                            // new entry
-                            wblock.queues[queue2Idx].nextEntry();
-                            rcount2 = 0;
-                        }
-                    }
-                    
-                    // do next queue entry if registered per element
-                    rcount += 4;
-                    if (delOpEntry.counting!=255 && delOpEntry.counting <= rcount)
-                    {
-                        // new entry
-                        wblock.queues[queue1Idx].nextEntry();
-                        rcount = 0;
-                    }
-                }
-                
-                // update current queue sizes from last delayed ops
-                if (flushedQueues < waitConfig.waitQueuesNum)
-                {
-                    curQueueSizes[queue1Idx] = wblock.queues[queue1Idx].requestedQueueSize;
-                    // increment curWait for queue1
-                    curWaits[queue1Idx] = std::min(uint16_t(curWaits[queue1Idx]+1),
-                                    waitConfig.waitQueueSizes[queue1Idx]);
-                    if (queue2Idx != UINT_MAX)
-                    {
-                        curQueueSizes[queue2Idx] =
-                                wblock.queues[queue2Idx].requestedQueueSize;
-                        // increment curWait for queue2
-                        curWaits[queue2Idx] = std::min(uint16_t(curWaits[queue2Idx]+1),
-                                    waitConfig.waitQueueSizes[queue2Idx]);
+                        usedQueues[opEntry.waitType] = true;
+                        orderedQueues[opEntry.waitType] = opEntry.ordered;
                     }
+                    if ((rwFlags & ASMRVU_WRITE) != 0)
+                        writingQueues[opEntry.waitType] = true;
                 }
+        }
+        for (cxuint q = 0; q < queuesNum; q++)
+            if (usedQueues[q])
+            {
+                state.queues[q].nextEntry(waitConfig.waitQueueSizes[q]);
+                // delayed op without results (memory write) must be tracked
+                if (!writingQueues[q])
+                    state.queues[q].pushReg(memOpQReg, orderedQueues[q]);
             }
-            
-            // only if any not flushed queue
-            if (flushedQueues < waitConfig.waitQueuesNum)
+        
+        for (; dit != dend; ++dit)
+        {
+            const cxbyte opTypes[2] = { dit->delayedOpType, dit->delayedOpType2 };
+            const cxbyte rwFlags[2] = { dit->rwFlags, dit->rwFlags2 };
+            for (cxuint k = 0; k < 2; k++)
             {
-                // update current queue sizes
-                for (auto& re: curRegs)
+                if (opTypes[k] == ASMDELOP_NONE || opTypes[k] == ASMDELOP_SYNC)
+                    continue;
+                const AsmDelayedOpTypeEntry& opEntry = waitConfig.delayOpTypes[opTypes[k]];
+                WaitQueueState& queue = state.queues[opEntry.waitType];
+                if (!opEntry.ordered)
+                    queue.randomPending = true;
+                // register variables are not allocated
+                if (dit->regVar != nullptr)
+                    continue;
+                for (uint16_t rreg = dit->rstart; rreg < dit->rend; rreg++)
                 {
-                    std::copy(curQueueSizes, curQueueSizes + waitConfig.waitQueuesNum,
-                                re.second.qsizes);
-                    std::copy(curWaits, curWaits + waitConfig.waitQueuesNum,
-                                re.second.waits);
+                    if ((rwFlags[k] & ASMRVU_WRITE) != 0)
+                        queue.pushReg(qregVal(rreg, true), opEntry.ordered);
+                    if ((rwFlags[k] & ASMRVU_READ) != 0 && opEntry.finishOnRegReadOut)
+                        queue.pushReg(qregVal(rreg, false), opEntry.ordered);
                 }
-                // put current regs to firstRegs
-                firstRegs.insert(curRegs.begin(), curRegs.end());
-            }
-            // get next instr
-            if (!waitHandler.hasNext(waitPos))
-                instrOffset = SIZE_MAX;
-            else
-            {
-                isWaitInstr = waitHandler.nextInstr(waitPos, delayedOp, waitInstr);
-                instrOffset = (isWaitInstr ? waitInstr.offset : delayedOp.offset);
             }
         }
-        
-        // copy to wblock as array
-        wblock.firstRegs.resize(firstRegs.size());
-        std::copy(firstRegs.begin(), firstRegs.end(), wblock.firstRegs.begin());
-        mapSort(wblock.firstRegs.begin(), wblock.firstRegs.end());
     }
 }
 
-static void optimizeWaitInstrs(const AsmWaitConfig& waitConfig,
-                std::vector<WaitInstrXInfo>& waitInstrs)
+// collect usages of real registers, delayed ops and wait instructions
+static bool collectWaitInput(ISAUsageHandler& usageHandler, ISAWaitHandler& waitHandler,
+        std::vector<AsmRegVarUsage>& usages, std::vector<AsmDelayedOp>& delayedOps,
+        std::vector<AsmWaitInstr>& waitInstrs)
 {
-    uint16_t extraQSizes[ASM_WAIT_MAX_TYPES_NUM];
-    std::fill(extraQSizes, extraQSizes + waitConfig.waitQueuesNum, uint16_t(UINT16_MAX));
-    for (WaitInstrXInfo& wi: waitInstrs)
+    bool allRegsReal = true;
+    ISAUsageHandler::ReadPos usagePos = usageHandler.findPositionByOffset(0);
+    while (usageHandler.hasNext(usagePos))
     {
-        cxuint toRemove = 0;
-        for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
-        {
-            if (wi.waits[q] - wi.qsizes[q] >= extraQSizes[q])
-            {
-                // mark to remove
-                wi.waits[q] = UINT16_MAX;
-                toRemove++;
-            }
-            else
-                // update new extraQSize for this queue
-                extraQSizes[q] = wi.waits[q] - wi.qsizes[q];
-        }
-        
-        if (toRemove == waitConfig.waitQueuesNum)
-            wi.offset = SIZE_MAX; // to remove
+        const AsmRegVarUsage rvu = usageHandler.nextUsage(usagePos);
+        // skip usereg pseudo-ops and not allocated register variables
+        if (!rvu.useRegMode && rvu.regVar == nullptr)
+            usages.push_back(rvu);
+        else if (!rvu.useRegMode)
+            allRegsReal = false;
+    }
+    ISAWaitHandler::ReadPos waitPos = waitHandler.findPositionByOffset(0);
+    while (waitHandler.hasNext(waitPos))
+    {
+        AsmDelayedOp delOp;
+        AsmWaitInstr waitInstr;
+        if (waitHandler.nextInstr(waitPos, delOp, waitInstr))
+            waitInstrs.push_back(waitInstr);
         else
-            // correct waits
-            for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
-                if (wi.waits[q] == UINT16_MAX)
-                    wi.waits[q] = waitConfig.waitQueueSizes[q] - 1;
+            delayedOps.push_back(delOp);
     }
-    
-    const size_t newSize = std::remove_if(waitInstrs.begin(), waitInstrs.end(),
-                [](const WaitInstrXInfo& wi)
-                { return wi.offset == SIZE_MAX; }) - waitInstrs.begin();
-    waitInstrs.resize(newSize);
+    return allRegsReal;
 }
 
-static void generateWaitInstrsWhileJoining(const AsmWaitConfig& waitConfig,
-        QueueState1* queues, const std::vector<std::pair<uint16_t, RRegInfo> >& firstRegs,
-        std::vector<WaitInstrXInfo>& waitInstrs, uint16_t* extraMinQueueSizes,
-        bool onlyWarnings)
+// next blocks (return from routine goes to all blocks after calls)
+static void getNextBlocks(const std::vector<CodeBlock>& codeBlocks,
+            std::vector<std::vector<size_t> >& nextBlocks)
 {
-    std::fill(extraMinQueueSizes,
-              extraMinQueueSizes + waitConfig.waitQueuesNum, UINT16_MAX);
-    for (const auto& entry: firstRegs)
+    const size_t blocksNum = codeBlocks.size();
+    std::vector<size_t> afterCallBlocks;
+    for (size_t i = 0; i + 1 < blocksNum; i++)
+        if (codeBlocks[i].haveCalls)
+            afterCallBlocks.push_back(i+1);
+    nextBlocks.assign(blocksNum, std::vector<size_t>());
+    for (size_t i = 0; i < blocksNum; i++)
     {
-        bool genWaitCnt = false;
-        WaitInstrXInfo gwaitI { entry.second.offset, { } };
-        for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
-        {
-            gwaitI.waits[q] = waitConfig.waitQueueSizes[q]-1;
-            gwaitI.qsizes[q] = entry.second.qsizes[q];
-        }
-        
-        for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
+        const CodeBlock& cblock = codeBlocks[i];
+        for (const NextBlock& next: cblock.nexts)
+            nextBlocks[i].push_back(next.block);
+        if ((cblock.nexts.empty() || cblock.haveCalls) &&
+            !cblock.haveReturn && !cblock.haveEnd && i+1 < blocksNum)
+            nextBlocks[i].push_back(i+1);
+        if (cblock.haveReturn)
+            nextBlocks[i].insert(nextBlocks[i].end(), afterCallBlocks.begin(),
+                        afterCallBlocks.end());
+    }
+}
+
+/* queue states are propagated through code blocks (states of ways are joined
+ * at start of block) until they will not be changed, and after that
+ * needed waits are generated for every code block */
+void AsmWaitScheduler::findWaits(const std::vector<AsmRegVarUsage>& usages,
+        const std::vector<AsmDelayedOp>& delayedOps,
+        const std::vector<AsmWaitInstr>& waitInstrs,
+        const std::vector<std::vector<size_t> >& nextBlocks,
+        std::vector<AsmWaitInstr>& neededWaits,
+        std::vector<AsmWaitInstr>* waitDemands) const
+{
+    const size_t blocksNum = codeBlocks.size();
+    std::vector<WaitState> inStates(blocksNum);
+    std::deque<size_t> workQueue;
+    std::vector<bool> inWorkQueue(blocksNum, true);
+    for (size_t i = 0; i < blocksNum; i++)
+        workQueue.push_back(i);
+    while (!workQueue.empty())
+    {
+        const size_t i = workQueue.front();
+        workQueue.pop_front();
+        inWorkQueue[i] = false;
+        WaitState state = inStates[i];
+        processBlock(codeBlocks[i], state, usages, delayedOps, waitInstrs,
+                    nullptr, nullptr);
+        for (size_t next: nextBlocks[i])
         {
-            uint16_t waitCnt = queues[q].findMinQueueSizeForReg(entry.first);
-            if (waitCnt != UINT16_MAX)
+            bool changed = false;
+            for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
+                changed |= inStates[next].queues[q].join(state.queues[q]);
+            if (changed && !inWorkQueue[next])
             {
-                waitCnt = std::min(gwaitI.waits[q], waitCnt);
-                if (!onlyWarnings && waitCnt < entry.second.qsizes[q])
-                {
-                    gwaitI.waits[q] = waitCnt;
-                    genWaitCnt = true;
-                }
-                extraMinQueueSizes[q] = std::min(
-                            uint16_t(entry.second.qsizes[q] - entry.second.waits[q]),
-                            extraMinQueueSizes[q]);
+                inWorkQueue[next] = true;
+                workQueue.push_back(next);
             }
         }
-        if (genWaitCnt)
-            waitInstrs.push_back(gwaitI);
     }
     
-    std::sort(waitInstrs.begin(), waitInstrs.end(),
-              [](const WaitInstrXInfo& a, const WaitInstrXInfo& b)
-              { return a.offset < b.offset; });
-    optimizeWaitInstrs(waitConfig, waitInstrs);
+    // generate needed waits
+    neededWaits.clear();
+    for (size_t i = 0; i < blocksNum; i++)
+    {
+        WaitState state = inStates[i];
+        processBlock(codeBlocks[i], state, usages, delayedOps, waitInstrs,
+                    &neededWaits, waitDemands);
+    }
 }
 
-AsmWaitScheduler::AsmWaitScheduler(const AsmWaitConfig& _asmWaitConfig,
-        Assembler& _assembler, const std::vector<CodeBlock>& _codeBlocks,
-        const VarIndexMap* _vregIndexMaps, const Array<cxuint>* _graphColorMaps,
-        bool _onlyWarnings)
-        : waitConfig(_asmWaitConfig), assembler(_assembler), codeBlocks(_codeBlocks),
-          vregIndexMaps(_vregIndexMaps), graphColorMaps(_graphColorMaps),
-          onlyWarnings(_onlyWarnings)
-{ }
-
+/* wait scheduling operates on real registers (register variables must be allocated).
+ * Memory ordering is not modeled: waits for memory writes before barriers
+ * must be written by programmer */
 void AsmWaitScheduler::schedule(ISAUsageHandler& usageHandler, ISAWaitHandler& waitHandler)
 {
+    neededWaitInstrs.clear();
     if (codeBlocks.empty())
         return;
     
-    cxuint regRanges[MAX_REGTYPES_NUM*2];
-    size_t regTypesNum;
-    std::vector<WaitCodeBlock> waitCodeBlocks(codeBlocks.size());
-    for(WaitCodeBlock& wblock: waitCodeBlocks)
-        wblock.setMaxQueueSizes(waitConfig);
+    vsCntQueue = getGPUArchitectureFromDeviceType(assembler.getDeviceType()) >=
+                GPUArchitecture::GCN1_5;
     
-    assembler.isaAssembler->getRegisterRanges(regTypesNum, regRanges);
+    std::vector<AsmRegVarUsage> usages;
+    std::vector<AsmDelayedOp> delayedOps;
+    std::vector<AsmWaitInstr> waitInstrs;
+    collectWaitInput(usageHandler, waitHandler, usages, delayedOps, waitInstrs);
+    std::vector<std::vector<size_t> > nextBlocks;
+    getNextBlocks(codeBlocks, nextBlocks);
+    findWaits(usages, delayedOps, waitInstrs, nextBlocks, neededWaitInstrs, nullptr);
+}
+
+/* explicit wait instruction can be relaxed if it does not cause new needed waits.
+ * Queue states hold also accesses finished by explicit waits (which would be
+ * pending without these waits). Access of these registers demands that waits
+ * still finish them, hence relaxed count is minimal demanded count (single pass).
+ * Delayed ops without register results (memory writes) that have been finished
+ * by original wait must be finished also by relaxed wait (memory ordering
+ * can not be checked by queue model) */
+void AsmWaitScheduler::relaxWaits(ISAUsageHandler& usageHandler,
+            ISAWaitHandler& waitHandler)
+{
+    relaxedWaitInstrs.clear();
+    if (codeBlocks.empty())
+        return;
     
-    // fill queue states
-    ISAWaitHandler::ReadPos waitPos{ 0, 0 };
-    for (size_t i = 0; i < codeBlocks.size(); i++)
-        processQueueBlock(codeBlocks[i], waitCodeBlocks[i], waitHandler, waitPos,
-                usageHandler, waitConfig, vregIndexMaps, graphColorMaps, regTypesNum,
-                regRanges, onlyWarnings);
+    vsCntQueue = getGPUArchitectureFromDeviceType(assembler.getDeviceType()) >=
+                GPUArchitecture::GCN1_5;
     
-    // key - current res first key, value - previous first key and its flowStack pos
-    PrevWaysIndexMap prevWaysIndexMap;
-    // to track ways last block indices pair: block index, flowStackPos)
-    std::pair<size_t, size_t> lastCommonCacheWayPoint{ SIZE_MAX, SIZE_MAX };
-    ResSecondPointsToCache cblocksToCache(codeBlocks.size());
-    std::vector<bool> waysToCache(codeBlocks.size(), false);
-    // main loop variables
-    std::deque<CallStackEntry> callStack;
-    std::unordered_set<BlockIndex> callBlocks;
-    std::deque<WaitFlowStackEntry0> flowStack;
-    flowStack.push_back(WaitFlowStackEntry0(0, 0, waitConfig));
-    std::vector<bool> visited(codeBlocks.size(), false);
+    std::vector<AsmRegVarUsage> usages;
+    std::vector<AsmDelayedOp> delayedOps;
+    std::vector<AsmWaitInstr> waitInstrs;
+    // register accesses of not allocated register variables are unknown
+    if (!collectWaitInput(usageHandler, waitHandler, usages, delayedOps, waitInstrs))
+        return;
+    if (waitInstrs.empty())
+        return;
+    std::vector<std::vector<size_t> > nextBlocks;
+    getNextBlocks(codeBlocks, nextBlocks);
     
-    /*
-     * main loop to fill up ssaInfos
-     */
-    while (!flowStack.empty())
+    const cxuint queuesNum = waitConfig.waitQueuesNum;
+    // initially, explicit waits are not demanded (SIZE_MAX - unreachable wait)
+    std::vector<AsmWaitInstr> waitDemands(waitInstrs.size());
+    for (AsmWaitInstr& demand: waitDemands)
     {
-        WaitFlowStackEntry0& entry = flowStack.back();
-        const CodeBlock& cblock = codeBlocks[entry.blockIndex];
-        WaitCodeBlock& wblock = waitCodeBlocks[entry.blockIndex];
-        
-        if (entry.nextIndex == 0)
-        {
-            // process current block
-            if (!visited[entry.blockIndex])
-            {
-                uint16_t minExtraQueueSizes[ASM_WAIT_MAX_TYPES_NUM];
-                visited[entry.blockIndex] = true;
-                std::vector<WaitInstrXInfo> thisWaitInstrs;
-                generateWaitInstrsWhileJoining(waitConfig, entry.queues, wblock.firstRegs,
-                            thisWaitInstrs, minExtraQueueSizes, onlyWarnings);
-                // insert to firstWaitInstrs in wblock
-                wblock.firstWaitInstrs.insert(wblock.firstWaitInstrs.end(),
-                            thisWaitInstrs.begin(), thisWaitInstrs.end());
-                // code to join queue state in previous with current block
-                for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
-                {
-                    if (minExtraQueueSizes[q]!=UINT16_MAX &&
-                        !wblock.queues[q].reallyFlushed)
-                        entry.queues[q].requestedQueueSize = std::min(
-                            size_t(entry.queues[q].requestedQueueSize),
-                            minExtraQueueSizes[q] + wblock.queues[q].ordered.size());
-                    entry.queues[q].joinNext(wblock.queues[q]);
-                }
-            }
-            else
-            {
-                cblocksToCache.increase(entry.blockIndex);
-                ARDOut << "jcblockToCache: " << entry.blockIndex << "=" <<
-                            cblocksToCache.count(entry.blockIndex) << "\n";
-                
-                // back, already visited
-                flowStack.pop_back();
-                
-                size_t curWayBIndex = flowStack.back().blockIndex;
-                if (lastCommonCacheWayPoint.first != SIZE_MAX)
-                {
-                    // mark point of way to cache (res first point)
-                    waysToCache[lastCommonCacheWayPoint.first] = true;
-                    ARDOut << "mark to pfcache " <<
-                            lastCommonCacheWayPoint.first << ", " <<
-                            curWayBIndex << "\n";
-                    prevWaysIndexMap[curWayBIndex] = lastCommonCacheWayPoint;
-                }
-                lastCommonCacheWayPoint = { curWayBIndex, flowStack.size()-1 };
-                ARDOut << "lastCcwP: " << curWayBIndex << "\n";
-                continue;
-            }
-        }
-        
-        if (!callStack.empty() &&
-            entry.blockIndex == callStack.back().callBlock.index &&
-            entry.nextIndex-1 == callStack.back().callNextIndex)
-        {
-            const BlockIndex routineBlock = callStack.back().routineBlock;
-            callBlocks.erase(routineBlock);
-            callStack.pop_back(); // just return from call
-        }
-        
-        if (entry.nextIndex < cblock.nexts.size())
-        {
-            size_t nextBlock = cblock.nexts[entry.nextIndex].block;
-            //nextBlock.pass = entry.blockIndex.pass;
-            
-            flowStack.push_back(WaitFlowStackEntry0(nextBlock, 0, waitConfig));
-            entry.nextIndex++;
-        }
-        
-        else if (((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            if (entry.nextIndex!=0) // if back from calls (just return from calls)
-            {
-            }
-            flowStack.push_back(WaitFlowStackEntry0(entry.blockIndex+1, 0, waitConfig));
-            entry.nextIndex++;
-        }
-        else
-        {
-            // back
-            flowStack.pop_back();
-            
-            if (!flowStack.empty() && lastCommonCacheWayPoint.first != SIZE_MAX &&
-                    lastCommonCacheWayPoint.second >= flowStack.size())
-            {
-                lastCommonCacheWayPoint =
-                        { flowStack.back().blockIndex, flowStack.size()-1 };
-                ARDOut << "POPlastCcwP: " << lastCommonCacheWayPoint.first << "\n";
-            }
-        }
+        demand.offset = SIZE_MAX;
+        for (cxuint q = 0; q < queuesNum; q++)
+            demand.waits[q] = waitConfig.waitQueueSizes[q]-1;
     }
+    std::vector<AsmWaitInstr> neededWaits;
+    trackFinished = true;
+    findWaits(usages, delayedOps, waitInstrs, nextBlocks, neededWaits, &waitDemands);
+    trackFinished = false;
     
-    // after, that resolve joins (join with already visited code)
-    // next loop
-    flowStack.clear();
-    std::deque<FlowStackEntry2> flowStack2;
-    
-    std::fill(visited.begin(), visited.end(), false);
-    flowStack2.push_back({ 0, 0 });
-    SimpleCache<size_t, WaitFirstCacheEntry> resFirstPointsCache(codeBlocks.size()*256);
-    SimpleCache<size_t, WaitSecCacheEntry> resSecondPointsCache(codeBlocks.size()*128);
-    
-    while (!flowStack2.empty())
+    for (size_t i = 0; i < waitInstrs.size(); i++)
     {
-        FlowStackEntry2& entry = flowStack2.back();
-        const CodeBlock& cblock = codeBlocks[entry.blockIndex];
-        
-        if (entry.nextIndex == 0)
-        {
-            // process current block
-            if (!visited[entry.blockIndex])
-                visited[entry.blockIndex] = true;
-            else
+        AsmWaitInstr waitInstr = waitInstrs[i];
+        if (waitDemands[i].offset == SIZE_MAX)
+            continue;
+        bool relaxed = false;
+        for (cxuint q = 0; q < queuesNum; q++)
+            if (waitDemands[i].waits[q] > waitInstr.waits[q])
             {
-                /*resolveSSAConflicts(flowStack2, routineMap, codeBlocks,
-                            prevWaysIndexMap, waysToCache, cblocksToCache,
-                            resFirstPointsCache, resSecondPointsCache, ssaReplacesMap);*/
-                
-                // back, already visited
-                flowStack2.pop_back();
-                continue;
+                waitInstr.waits[q] = waitDemands[i].waits[q];
+                relaxed = true;
             }
-        }
-        
-        if (entry.nextIndex < cblock.nexts.size())
-        {
-            flowStack2.push_back({ cblock.nexts[entry.nextIndex].block, 0 });
-            entry.nextIndex++;
-        }
-        else if (((entry.nextIndex==0 && cblock.nexts.empty()) ||
-                // if have any call then go to next block
-                (cblock.haveCalls && entry.nextIndex==cblock.nexts.size())) &&
-                 !cblock.haveReturn && !cblock.haveEnd)
-        {
-            flowStack2.push_back({ entry.blockIndex+1, 0 });
-            entry.nextIndex++;
-        }
-        else // back
-        {
-            /*if (cblocksToCache.count(entry.blockIndex)==2 &&
-                !resSecondPointsCache.hasKey(entry.blockIndex))
-                // add to cache
-                addResSecCacheEntry(routineMap, codeBlocks, resSecondPointsCache,
-                            entry.blockIndex);*/
-            flowStack2.pop_back();
-        }
+        if (relaxed)
+            relaxedWaitInstrs.push_back(waitInstr);
     }
 }
@@ -18,6 +18,7 @@
  */
 
 #include <CLRX/Config.h>
+#include <cstdio>
 #include <string>
 #include <cassert>
 #include <fstream>
@@ -26,6 +27,8 @@
 #include <deque>
 #include <utility>
 #include <algorithm>
+#include <unordered_set>
+#include <sstream>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/MemAccess.h>
 #include <CLRX/utils/GPUId.h>
@@ -70,6 +73,10 @@ AsmSection::AsmSection(const AsmSection& section)
     if (section.waitHandler!=nullptr)
         waitHandler.reset(section.waitHandler->copy());
     codeFlow = section.codeFlow;
+    sourcePosHandler = section.sourcePosHandler;
+    labelDiffs = section.labelDiffs;
+    labelDiffPos = section.labelDiffPos;
+    codeAlignments = section.codeAlignments;
 }
 
 // copy assignment - includes usageHandler copying
@@ -92,6 +99,10 @@ AsmSection& AsmSection::operator=(const AsmSection& section)
     if (section.waitHandler!=nullptr)
         waitHandler.reset(section.waitHandler->copy());
     codeFlow = section.codeFlow;
+    sourcePosHandler = section.sourcePosHandler;
+    labelDiffs = section.labelDiffs;
+    labelDiffPos = section.labelDiffPos;
+    codeAlignments = section.codeAlignments;
     return *this;
 }
 
@@ -780,13 +791,30 @@ Assembler::Assembler(const CString& filename, std::istream& input, Flags _flags,
     buggyFPLit = (flags & ASM_BUGGYFPLIT)!=0;
     macroCase = (flags & ASM_MACRONOCASE)==0;
     oldModParam = (flags & ASM_OLDMODPARAM)!=0;
+    regAlloc = (flags & ASM_REGALLOC)!=0;
+    autoWait = (flags & ASM_AUTOWAIT)!=0;
+    insertedWaitsNum = 0;
+    checkWaits = (flags & ASM_CHECKWAITS)!=0;
+    relaxWaits = (flags & ASM_RELAXWAITS)!=0;
+    relaxedWaitsNum = 0;
+    schedule = (flags & ASM_SCHEDULE)!=0;
+    movedInstrsNum = 0;
+    shrink = (flags & ASM_SHRINK)!=0;
+    savedBytesNum = 0;
+    targetOccupancy = 0;
+    threadsNum = 0;
+    coalescedMovesNum = removedMovesNum = 0;
+    std::fill(spilledRegsNums, spilledRegsNums + MAX_REGTYPES_NUM, size_t(0));
+    spillLdsReg = UINT_MAX;
+    spillLdsStride = 0;
+    regPressureReport = (flags & ASM_REGPRESSURE)!=0;
     codeFlags = ((flags & ASM_WAVE32)!=0)?ASM_CODE_WAVE32:0;
     localCount = macroCount = inclusionLevel = 0;
     macroSubstLevel = repetitionLevel = 0;
     lineAlreadyRead = false;
     good = true;
     resolvingRelocs = false;
-    collectSourcePoses = false;
+    collectSourcePoses = checkWaits || autoWait || regAlloc || regPressureReport;
     formatHandler = nullptr;
     input.exceptions(std::ios::badbit);
     std::unique_ptr<AsmInputFilter> thatInputFilter(
@@ -823,13 +851,30 @@ Assembler::Assembler(const Array<CString>& _filenames, Flags _flags,
     buggyFPLit = (flags & ASM_BUGGYFPLIT)!=0;
     macroCase = (flags & ASM_MACRONOCASE)==0;
     oldModParam = (flags & ASM_OLDMODPARAM)!=0;
+    regAlloc = (flags & ASM_REGALLOC)!=0;
+    autoWait = (flags & ASM_AUTOWAIT)!=0;
+    insertedWaitsNum = 0;
+    checkWaits = (flags & ASM_CHECKWAITS)!=0;
+    relaxWaits = (flags & ASM_RELAXWAITS)!=0;
+    relaxedWaitsNum = 0;
+    schedule = (flags & ASM_SCHEDULE)!=0;
+    movedInstrsNum = 0;
+    shrink = (flags & ASM_SHRINK)!=0;
+    savedBytesNum = 0;
+    targetOccupancy = 0;
+    threadsNum = 0;
+    coalescedMovesNum = removedMovesNum = 0;
+    std::fill(spilledRegsNums, spilledRegsNums + MAX_REGTYPES_NUM, size_t(0));
+    spillLdsReg = UINT_MAX;
+    spillLdsStride = 0;
+    regPressureReport = (flags & ASM_REGPRESSURE)!=0;
     codeFlags = ((flags & ASM_WAVE32)!=0)?ASM_CODE_WAVE32:0;
     localCount = macroCount = inclusionLevel = 0;
     macroSubstLevel = repetitionLevel = 0;
     lineAlreadyRead = false;
     good = true;
     resolvingRelocs = false;
-    collectSourcePoses = false;
+    collectSourcePoses = checkWaits || autoWait || regAlloc || regPressureReport;
     formatHandler = nullptr;
     if (filenames.empty())
         throw AsmException("Filename list is empty");
@@ -2862,11 +2907,1077 @@ void Assembler::printUnresolvedSymbols(AsmScope* thisScope)
     }
 }
 
+// get VGPRs budget for target occupancy (waves per SIMD)
+static cxuint getOccupancyVGPRsNum(GPUArchitecture arch, cxuint waves, bool wave32)
+{
+    const bool isGCN15 = arch >= GPUArchitecture::GCN1_5;
+    // VGPRs per SIMD lane and allocation granularity
+    const cxuint simdVGPRsNum = isGCN15 ? (wave32 ? 1024 : 512) : 256;
+    const cxuint granule = isGCN15 ? 8 : 4;
+    const cxuint vgprsNum = (simdVGPRsNum / waves) & ~(granule-1);
+    return std::min(vgprsNum, getGPUMaxRegistersNum(arch, REGTYPE_VGPR));
+}
+
+// get waves per SIMD for registers number, LDS size and work-group size of kernel
+static cxuint getOccupancyWavesNum(GPUArchitecture arch, cxuint sgprsNum,
+                cxuint vgprsNum, const AsmRegPressureSection& pressSection, bool wave32)
+{
+    sgprsNum += pressSection.extraSGPRsNum;
+    if (sgprsNum > getGPUMaxRegistersNum(arch, REGTYPE_SGPR) ||
+        vgprsNum > getGPUMaxRegistersNum(arch, REGTYPE_VGPR))
+        return 0; // registers does not fit
+    const bool isGCN15 = arch >= GPUArchitecture::GCN1_5;
+    // allocated register blocks are in PGMRSRC1 fields
+    const uint32_t pgmRSrc1 = calculatePgmRSrc1(arch, std::max(vgprsNum, 1U),
+                std::max(sgprsNum, 1U), 0, 0, false, false, false, false);
+    const cxuint simdVGPRsNum = isGCN15 ? (wave32 ? 1024 : 512) : 256;
+    const cxuint vgprsGranule = isGCN15 ? 8 : 4;
+    cxuint waves = std::min(isGCN15 ? 20U : 10U,
+                simdVGPRsNum / (((pgmRSrc1 & 0x3f)+1) * vgprsGranule));
+    if (!isGCN15)
+    {
+        // SGPRs are allocated per SIMD (by 8 registers)
+        const cxuint simdSGPRsNum = (arch >= GPUArchitecture::GCN1_2) ? 800 : 512;
+        waves = std::min(waves, simdSGPRsNum / ((((pgmRSrc1>>6) & 15)+1) * 8));
+    }
+    if (pressSection.localSize != 0)
+    {
+        // 64KB LDS per compute unit (4 SIMDs), maximal work-group has 256 work-items
+        const cxuint waveSize = wave32 ? 32 : 64;
+        const cxuint workGroupSize = (pressSection.workGroupSize != 0) ?
+                std::min(pressSection.workGroupSize, 256U) : 256U;
+        const size_t groupWavesNum = (workGroupSize + waveSize-1) / waveSize;
+        waves = std::min(size_t(waves),
+                (65536 / pressSection.localSize) * groupWavesNum / 4);
+    }
+    return waves;
+}
+
+// collect symbols from scope and its children
+static void collectScopeSymbols(AsmScope& scope, std::unordered_set<AsmSymbol*>& symbols)
+{
+    for (AsmSymbolEntry& symEntry: scope.symbolMap)
+        symbols.insert(&symEntry.second);
+    for (const auto& scopeEntry: scope.scopeMap)
+        collectScopeSymbols(*scopeEntry.second, symbols);
+}
+
+// code section of kernel is section '.text' of kernel or global section '.text'
+AsmSectionId Assembler::getKernelCodeSectionId(AsmKernelId kernelId)
+{
+    if (formatHandler == nullptr)
+        return ASMSECT_NONE;
+    const AsmKernelId oldKernel = currentKernel;
+    currentKernel = kernelId;
+    AsmSectionId sectionId = formatHandler->getSectionId(".text");
+    if (sectionId == ASMSECT_NONE)
+    {
+        currentKernel = ASMKERN_GLOBAL;
+        sectionId = formatHandler->getSectionId(".text");
+    }
+    currentKernel = oldKernel;
+    return sectionId;
+}
+
+/* update offsets of symbols, relocations and kernel code regions in section
+ * after inserting code to section by register allocator */
+void Assembler::updateSectionOffsets(AsmSectionId sectionId,
+                const AsmCodeOffsetMap& offsetMap)
+{
+    std::unordered_set<AsmSymbol*> symbols;
+    collectScopeSymbols(globalScope, symbols);
+    for (AsmSymbolEntry* symEntry: symbolSnapshots)
+        symbols.insert(&symEntry->second);
+    for (AsmSymbolEntry* symEntry: symbolClones)
+        symbols.insert(&symEntry->second);
+    for (AsmSymbol* symbol: symbols)
+        if (symbol->hasValue && !symbol->regRange && symbol->sectionId == sectionId)
+        {
+            // size of symbol is difference of labels (end and start of symbol)
+            const uint64_t symEnd = offsetMap.mapLabel(symbol->value + symbol->size);
+            symbol->value = offsetMap.mapLabel(symbol->value);
+            if (symbol->size != 0)
+                symbol->size = symEnd - symbol->value;
+        }
+    
+    for (AsmRelocation& reloc: relocations)
+        if (reloc.sectionId == sectionId)
+            reloc.offset = offsetMap.mapInstr(reloc.offset);
+    
+    if (formatHandler == nullptr)
+        return;
+    // kernel code regions
+    for (AsmKernelId i = 0; i < kernels.size(); i++)
+    {
+        if (getKernelCodeSectionId(i) != sectionId)
+            continue;
+        for (std::pair<size_t, size_t>& region: kernels[i].codeRegions)
+        {
+            region.first = offsetMap.mapLabel(region.first);
+            if (region.second != SIZE_MAX)
+                region.second = offsetMap.mapLabel(region.second);
+        }
+    }
+}
+
+/* code of kernels in single code section is split at starts and ends of code
+ * regions of kernels. Split offset is removed if jump, call or end of code
+ * (falling through to next instruction) crosses it */
+void Assembler::getCodeSplitOffsets(AsmSectionId sectionId,
+            std::vector<size_t>& splitOffsets)
+{
+    splitOffsets.clear();
+    const AsmSection& section = sections[sectionId];
+    const size_t codeSize = section.content.size();
+    for (AsmKernelId i = 0; i < kernels.size(); i++)
+    {
+        if (getKernelCodeSectionId(i) != sectionId)
+            continue;
+        for (const std::pair<size_t, size_t>& region: kernels[i].codeRegions)
+        {
+            if (region.first != 0 && region.first < codeSize)
+                splitOffsets.push_back(region.first);
+            if (region.second != 0 && region.second < codeSize)
+                splitOffsets.push_back(region.second);
+        }
+    }
+    if (splitOffsets.empty())
+        return;
+    std::sort(splitOffsets.begin(), splitOffsets.end());
+    splitOffsets.resize(std::unique(splitOffsets.begin(), splitOffsets.end()) -
+                splitOffsets.begin());
+    
+    std::vector<bool> removedSplits(splitOffsets.size(), false);
+    // remove split offsets in range (first, last]
+    auto removeSplits = [&splitOffsets, &removedSplits](size_t first, size_t last)
+    {
+        auto it = std::upper_bound(splitOffsets.begin(), splitOffsets.end(), first);
+        for (; it != splitOffsets.end() && *it <= last; ++it)
+            removedSplits[it - splitOffsets.begin()] = true;
+    };
+    std::vector<size_t> codeEnds;
+    std::vector<size_t> codeStarts;
+    for (const AsmCodeFlowEntry& entry: section.codeFlow)
+    {
+        if (entry.type == AsmCodeFlowType::START)
+        {
+            codeStarts.push_back(entry.offset);
+            continue;
+        }
+        if (entry.type == AsmCodeFlowType::END)
+        {
+            codeEnds.push_back(entry.offset);
+            continue;
+        }
+        const size_t instrAfter = entry.offset + isaAssembler->getInstructionSize(
+                    codeSize - entry.offset, section.content.data() + entry.offset);
+        if (entry.type == AsmCodeFlowType::JUMP || entry.type == AsmCodeFlowType::RETURN)
+            codeEnds.push_back(instrAfter);
+        if (entry.type == AsmCodeFlowType::RETURN)
+            continue;
+        // jump target is treated as start of code
+        codeStarts.push_back(entry.target);
+        removeSplits(std::min(entry.offset, entry.target),
+                     std::max(entry.offset, entry.target));
+    }
+    std::sort(codeEnds.begin(), codeEnds.end());
+    std::sort(codeStarts.begin(), codeStarts.end());
+    for (size_t k = 0; k < splitOffsets.size(); k++)
+    {
+        // code must be ended before split offset and not started after its end
+        const size_t split = splitOffsets[k];
+        auto endIt = std::upper_bound(codeEnds.begin(), codeEnds.end(), split);
+        if (endIt == codeEnds.begin())
+        {
+            removedSplits[k] = true;
+            continue;
+        }
+        const size_t codeEnd = *(endIt-1);
+        auto startIt = std::lower_bound(codeStarts.begin(), codeStarts.end(), codeEnd);
+        if (startIt != codeStarts.end() && *startIt < split)
+            removedSplits[k] = true;
+    }
+    size_t j = 0;
+    for (size_t k = 0; k < splitOffsets.size(); k++)
+        if (!removedSplits[k])
+            splitOffsets[j++] = splitOffsets[k];
+    splitOffsets.resize(j);
+}
+
+/* code sections with code of many kernels are split to parts. Sections with
+ * single part are processed in place */
+void Assembler::splitCodeSections(std::vector<std::vector<size_t> >& splitOffsets,
+            std::vector<std::vector<AsmSection> >& sectionParts,
+            std::vector<AsmCodePart>& codeParts)
+{
+    splitOffsets.assign(sections.size(), std::vector<size_t>());
+    sectionParts.assign(sections.size(), std::vector<AsmSection>());
+    codeParts.clear();
+    for (AsmSectionId i = 0; i < sections.size(); i++)
+    {
+        AsmSection& section = sections[i];
+        if (section.type != AsmSectionType::CODE || section.usageHandler == nullptr ||
+            section.content.empty())
+            continue;
+        getCodeSplitOffsets(i, splitOffsets[i]);
+        if (splitOffsets[i].empty())
+        {
+            codeParts.push_back({ i, &section, 0 });
+            continue;
+        }
+        splitCodeSection(isaAssembler, section, splitOffsets[i], sectionParts[i]);
+        for (size_t k = 0; k < sectionParts[i].size(); k++)
+            codeParts.push_back({ i, &sectionParts[i][k],
+                        (k != 0) ? splitOffsets[i][k-1] : 0 });
+    }
+}
+
+// get source position of instruction at offset (empty if not collected)
+static AsmSourcePos getInstrSourcePos(AsmSection& section, size_t offset)
+{
+    AsmSourcePosHandler::ReadPos sourcePos = { 0, 0 };
+    while (section.sourcePosHandler.hasNext(sourcePos))
+    {
+        const std::pair<size_t, AsmSourcePos> offsetPos =
+                section.sourcePosHandler.nextSourcePos(sourcePos);
+        if (offsetPos.first == offset)
+            return offsetPos.second;
+        if (offsetPos.first > offset)
+            break;
+    }
+    return AsmSourcePos();
+}
+
+// result of register allocation for single code part
+struct CLRX_INTERNAL RegAllocSectionResult
+{
+    bool done;  // true if part have register variables
+    bool good;
+    std::vector<std::pair<AsmSourcePos, std::string> > errorMessages;
+    cxuint allocRegs[MAX_REGTYPES_NUM];
+    size_t coalescedMovesNum;
+    size_t removedMovesNum;
+    size_t spilledRegsNums[MAX_REGTYPES_NUM];
+    AsmCodeOffsetMap codeOffsetMap; // offsets after inserting spill code
+};
+
+// return true if code section have register variables
+static bool haveSectionRegVars(const AsmSection& section)
+{
+    if (section.type != AsmSectionType::CODE || section.usageHandler == nullptr ||
+        section.content.empty())
+        return false;
+    ISAUsageHandler& usageHandler = *section.usageHandler;
+    ISAUsageHandler::ReadPos usagePos = usageHandler.findPositionByOffset(0);
+    while (usageHandler.hasNext(usagePos))
+        if (usageHandler.nextUsage(usagePos).regVar != nullptr)
+            return true;
+    return false;
+}
+
+/* code sections and code of kernels in single section are independent, hence
+ * register allocation is done in the thread pool (any part has own allocator).
+ * results are stored per part and merged in section order, so output does not
+ * depend on thread scheduling */
+bool Assembler::allocateRegisters()
+{
+    bool good = true;
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(deviceType);
+    std::vector<std::vector<size_t> > splitOffsets;
+    std::vector<std::vector<AsmSection> > sectionParts;
+    std::vector<AsmCodePart> codeParts;
+    splitCodeSections(splitOffsets, sectionParts, codeParts);
+    std::vector<RegAllocSectionResult> results(codeParts.size());
+    
+    runParallelTasks(codeParts.size(), threadsNum, [&](size_t i)
+    {
+        RegAllocSectionResult& result = results[i];
+        result.done = result.good = false;
+        AsmSection& section = *codeParts[i].section;
+        // skip code without register variables
+        if (!haveSectionRegVars(section))
+            return;
+        AsmRegAllocator regAllocator(*this);
+        if (spillLdsReg != UINT_MAX)
+            regAllocator.setSpillLds(spillLdsReg, spillLdsStride);
+        // VGPRs are limited by target occupancy (spilled if LDS window is set)
+        if (targetOccupancy != 0)
+            regAllocator.setRegsNumLimit(REGTYPE_VGPR, getOccupancyVGPRsNum(arch,
+                    targetOccupancy, (codeFlags & ASM_CODE_WAVE32) != 0));
+        result.done = true;
+        try
+        {
+            result.good = regAllocator.allocateRegisters(section);
+            // errors are reported at instructions (section is not joined yet)
+            for (const auto& error: regAllocator.getErrorMessages())
+                result.errorMessages.push_back({ error.first != SIZE_MAX ?
+                        getInstrSourcePos(section, error.first) : AsmSourcePos(),
+                        error.second });
+        }
+        catch(const AsmException& ex)
+        {
+            result.errorMessages.push_back({ AsmSourcePos(), ex.what() });
+            result.good = false;
+            return;
+        }
+        std::copy(regAllocator.getAllocRegsNums(),
+                  regAllocator.getAllocRegsNums() + MAX_REGTYPES_NUM,
+                  result.allocRegs);
+        result.coalescedMovesNum = regAllocator.getCoalescedMovesNum();
+        result.removedMovesNum = regAllocator.getRemovedMovesNum();
+        std::copy(regAllocator.getSpilledRegsNums(),
+                  regAllocator.getSpilledRegsNums() + MAX_REGTYPES_NUM,
+                  result.spilledRegsNums);
+        result.codeOffsetMap = regAllocator.getCodeOffsetMap();
+    });
+    
+    // merge results in section order
+    const bool wave32 = (codeFlags & ASM_CODE_WAVE32) != 0;
+    for (size_t i = 0; i < codeParts.size(); )
+    {
+        const AsmSectionId sectionId = codeParts[i].sectionId;
+        bool sectionDone = false;
+        bool sectionGood = true;
+        cxuint allocRegs[MAX_REGTYPES_NUM];
+        std::fill(allocRegs, allocRegs + MAX_REGTYPES_NUM, 0U);
+        std::vector<AsmCodeOffsetMap> partOffsetMaps;
+        for (; i < codeParts.size() && codeParts[i].sectionId == sectionId; i++)
+        {
+            const RegAllocSectionResult& result = results[i];
+            partOffsetMaps.push_back(result.done ? result.codeOffsetMap :
+                        AsmCodeOffsetMap());
+            if (!result.done)
+                continue;
+            sectionDone = true;
+            for (const auto& message: result.errorMessages)
+                printError(message.first, message.second.c_str());
+            if (!result.good || !result.errorMessages.empty())
+            {
+                sectionGood = false;
+                continue;
+            }
+            coalescedMovesNum += result.coalescedMovesNum;
+            removedMovesNum += result.removedMovesNum;
+            for (size_t k = 0; k < MAX_REGTYPES_NUM; k++)
+            {
+                spilledRegsNums[k] += result.spilledRegsNums[k];
+                allocRegs[k] = std::max(allocRegs[k], result.allocRegs[k]);
+            }
+        }
+        if (!sectionDone)
+            continue;
+        if (!sectionGood)
+        {
+            good = false;
+            continue;
+        }
+        
+        if (!splitOffsets[sectionId].empty())
+        {
+            // join code of kernels and realign code after joining
+            AsmSection& section = sections[sectionId];
+            AsmCodeOffsetMap offsetMap;
+            joinCodeSection(isaAssembler, section, splitOffsets[sectionId],
+                        sectionParts[sectionId], partOffsetMaps, offsetMap);
+            updateSectionOffsets(sectionId, offsetMap);
+            if (!section.codeAlignments.empty())
+            {
+                offsetMap.clear();
+                std::vector<std::pair<size_t, std::string> > alignErrors;
+                insertCodeToSection(isaAssembler, deviceType, wave32, section, "",
+                            {}, offsetMap, alignErrors);
+                for (const auto& error: alignErrors)
+                    printError(getInstrSourcePos(section, error.first),
+                            error.second.c_str());
+                updateSectionOffsets(sectionId, offsetMap);
+                if (!alignErrors.empty())
+                {
+                    good = false;
+                    continue;
+                }
+            }
+        }
+        else if (!partOffsetMaps[0].empty())
+            updateSectionOffsets(sectionId, partOffsetMaps[0]);
+        if (formatHandler != nullptr)
+            formatHandler->updateAllocatedRegisters(sectionId, allocRegs);
+    }
+    return good;
+}
+
+// get source of wait instruction (only waits in queues that are used)
+static std::string getWaitInstrText(const AsmWaitConfig& waitConfig,
+            const AsmWaitInstr& waitInstr)
+{
+    static const char* waitNames[3] = { "vmcnt", "lgkmcnt", "expcnt" };
+    std::string waitText = "s_waitcnt";
+    bool haveWaits = false;
+    for (cxuint q = 0; q < std::min(waitConfig.waitQueuesNum, 3U); q++)
+        if (waitInstr.waits[q] < waitConfig.waitQueueSizes[q]-1)
+        {
+            char buf[20];
+            snprintf(buf, sizeof buf, " %s(%u)", waitNames[q],
+                        cxuint(waitInstr.waits[q]));
+            waitText += buf;
+            haveWaits = true;
+        }
+    if (!haveWaits)
+    {
+        // no waits: use maximal count for first queue
+        char buf[20];
+        snprintf(buf, sizeof buf, " %s(%u)", waitNames[0],
+                    cxuint(waitConfig.waitQueueSizes[0]-1));
+        waitText += buf;
+    }
+    return waitText;
+}
+
+// result of inserting waits to single code section
+struct CLRX_INTERNAL WaitSectionResult
+{
+    size_t insertedWaitsNum;
+    std::vector<std::pair<AsmSourcePos, std::string> > errorMessages;
+    AsmCodeOffsetMap codeOffsetMap; // offsets after inserting waits
+};
+
+/* waits are found by wait scheduler (after register allocation, hence for real
+ * registers) and inserted before instructions that need them. Code sections and
+ * code of kernels in single section are independent, hence waits are found in
+ * the thread pool, inserted per section and results are merged in section order */
+bool Assembler::insertWaitInstrs()
+{
+    bool good = true;
+    const AsmWaitConfig& waitConfig = isaAssembler->getWaitConfig();
+    const bool wave32 = (codeFlags & ASM_CODE_WAVE32) != 0;
+    std::vector<std::vector<size_t> > splitOffsets;
+    std::vector<std::vector<AsmSection> > sectionParts;
+    std::vector<AsmCodePart> codeParts;
+    splitCodeSections(splitOffsets, sectionParts, codeParts);
+    std::vector<std::vector<AsmWaitInstr> > partWaits(codeParts.size());
+    runParallelTasks(codeParts.size(), threadsNum, [&](size_t i)
+    {
+        AsmSection& section = *codeParts[i].section;
+        if (section.waitHandler == nullptr)
+            return;
+        AsmRegAllocator regAlloc(*this);
+        regAlloc.createCodeStructure(section.codeFlow, section.content.size(),
+                    section.content.data());
+        AsmWaitScheduler waitScheduler(waitConfig, *this, regAlloc.getCodeBlocks(),
+                    nullptr, nullptr, false);
+        waitScheduler.schedule(*section.usageHandler, *section.waitHandler);
+        partWaits[i] = waitScheduler.getNeededWaitInstrs();
+        for (AsmWaitInstr& waitInstr: partWaits[i])
+            waitInstr.offset += codeParts[i].start;
+    });
+    // parts are in order, hence waits of section are sorted by offset
+    std::vector<std::vector<AsmWaitInstr> > sectionWaits(sections.size());
+    for (size_t i = 0; i < codeParts.size(); i++)
+        sectionWaits[codeParts[i].sectionId].insert(
+                    sectionWaits[codeParts[i].sectionId].end(),
+                    partWaits[i].begin(), partWaits[i].end());
+    
+    std::vector<WaitSectionResult> results(sections.size());
+    runParallelTasks(sections.size(), threadsNum, [&](size_t i)
+    {
+        WaitSectionResult& result = results[i];
+        result.insertedWaitsNum = 0;
+        AsmSection& section = sections[i];
+        const std::vector<AsmWaitInstr>& neededWaits = sectionWaits[i];
+        if (neededWaits.empty())
+            return;
+        if (section.labelDiffs)
+        {
+            result.errorMessages.push_back({ section.labelDiffPos, "Waits can not be "
+                    "inserted to code, because difference of its labels is used" });
+            return;
+        }
+        AsmRegAllocator regAlloc(*this);
+        size_t badOffset = 0;
+        if (!regAlloc.canRetargetJumps(section, &badOffset))
+        {
+            result.errorMessages.push_back({ getInstrSourcePos(section, badOffset),
+                    "Waits can not be inserted to code with calls, returns or "
+                    "unresolved jumps" });
+            return;
+        }
+        
+        std::string waitText;
+        std::vector<AsmInstrCodeInsert> inserts;
+        for (const AsmWaitInstr& waitInstr: neededWaits)
+        {
+            waitText += getWaitInstrText(waitConfig, waitInstr);
+            waitText += '\n';
+            inserts.push_back({ waitInstr.offset, isaAssembler->getInstructionSize(
+                        section.content.size() - waitInstr.offset,
+                        section.content.data() + waitInstr.offset), 1, 0, false });
+        }
+        std::vector<std::pair<size_t, std::string> > insertErrors;
+        if (!insertCodeToSection(isaAssembler, deviceType, wave32, section, waitText,
+                    inserts, result.codeOffsetMap, insertErrors))
+            insertErrors.push_back({ SIZE_MAX, "Can't assemble wait instructions" });
+        // errors of inserted code are reported at first instruction that needs wait
+        for (const auto& error: insertErrors)
+            result.errorMessages.push_back({ getInstrSourcePos(section,
+                        error.first != SIZE_MAX ? error.first :
+                        neededWaits.front().offset), error.second });
+        result.insertedWaitsNum = neededWaits.size();
+    });
+    
+    // merge results in section order
+    for (AsmSectionId i = 0; i < sections.size(); i++)
+    {
+        const WaitSectionResult& result = results[i];
+        for (const auto& message: result.errorMessages)
+            printError(message.first, message.second.c_str());
+        if (!result.errorMessages.empty())
+        {
+            good = false;
+            continue;
+        }
+        if (!result.codeOffsetMap.empty())
+            updateSectionOffsets(i, result.codeOffsetMap);
+        insertedWaitsNum += result.insertedWaitsNum;
+    }
+    return good;
+}
+
+// result of wait analysis of single code section
+struct CLRX_INTERNAL RelaxWaitsSectionResult
+{
+    bool checked;   // false if waits can not be checked
+    size_t badOffset;   // offset of instruction that prevents checking
+    std::vector<AsmWaitInstr> relaxedWaits;
+};
+
+/* explicit waits are relaxed by wait scheduler (after register allocation).
+ * Relaxed wait instruction is replaced by new instruction in this same place.
+ * Waits of code sections and code of kernels are analyzed in the thread pool */
+bool Assembler::relaxWaitInstrs()
+{
+    bool good = true;
+    const AsmWaitConfig& waitConfig = isaAssembler->getWaitConfig();
+    const bool wave32 = (codeFlags & ASM_CODE_WAVE32) != 0;
+    std::vector<std::vector<size_t> > splitOffsets;
+    std::vector<std::vector<AsmSection> > sectionParts;
+    std::vector<AsmCodePart> codeParts;
+    splitCodeSections(splitOffsets, sectionParts, codeParts);
+    std::vector<RelaxWaitsSectionResult> partResults(codeParts.size());
+    runParallelTasks(codeParts.size(), threadsNum, [&](size_t i)
+    {
+        AsmSection& section = *codeParts[i].section;
+        RelaxWaitsSectionResult& result = partResults[i];
+        result.checked = true;
+        if (section.waitHandler == nullptr)
+            return;
+        AsmRegAllocator regAlloc(*this);
+        regAlloc.createCodeStructure(section.codeFlow, section.content.size(),
+                    section.content.data());
+        if (!regAlloc.canRetargetJumps(section, &result.badOffset))
+        {
+            result.checked = false;
+            result.badOffset += codeParts[i].start;
+            return;
+        }
+        AsmWaitScheduler waitScheduler(waitConfig, *this, regAlloc.getCodeBlocks(),
+                    nullptr, nullptr, false);
+        waitScheduler.relaxWaits(*section.usageHandler, *section.waitHandler);
+        result.relaxedWaits = waitScheduler.getRelaxedWaitInstrs();
+        for (AsmWaitInstr& waitInstr: result.relaxedWaits)
+            waitInstr.offset += codeParts[i].start;
+    });
+    // join results of parts (code of section is checked if all parts are checked)
+    std::vector<RelaxWaitsSectionResult> results(sections.size());
+    for (RelaxWaitsSectionResult& result: results)
+        result.checked = true;
+    for (size_t i = 0; i < codeParts.size(); i++)
+    {
+        RelaxWaitsSectionResult& result = results[codeParts[i].sectionId];
+        if (!result.checked)
+            continue;
+        if (!partResults[i].checked)
+        {
+            result.checked = false;
+            result.badOffset = partResults[i].badOffset;
+            continue;
+        }
+        result.relaxedWaits.insert(result.relaxedWaits.end(),
+                    partResults[i].relaxedWaits.begin(),
+                    partResults[i].relaxedWaits.end());
+    }
+    
+    for (AsmSectionId i = 0; i < sections.size(); i++)
+    {
+        AsmSection& section = sections[i];
+        if (!results[i].checked)
+        {
+            printWarning(getInstrSourcePos(section, results[i].badOffset),
+                    "Waits in code with calls, returns or unresolved jumps "
+                    "are not checked");
+            continue;
+        }
+        const std::vector<AsmWaitInstr>& relaxedWaits = results[i].relaxedWaits;
+        if (relaxedWaits.empty())
+            continue;
+        
+        if (checkWaits)
+        {
+            AsmSourcePosHandler::ReadPos sourcePos = { 0, 0 };
+            std::pair<size_t, AsmSourcePos> offsetPos{ 0, AsmSourcePos() };
+            bool haveSourcePos = false;
+            for (const AsmWaitInstr& waitInstr: relaxedWaits)
+            {
+                // source positions are sorted by offset
+                while ((!haveSourcePos || offsetPos.first < waitInstr.offset) &&
+                        section.sourcePosHandler.hasNext(sourcePos))
+                {
+                    offsetPos = section.sourcePosHandler.nextSourcePos(sourcePos);
+                    haveSourcePos = true;
+                }
+                bool needed = false;
+                for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
+                    needed |= waitInstr.waits[q] < waitConfig.waitQueueSizes[q]-1;
+                const std::string message = needed ?
+                        "Wait instruction can be relaxed to '" +
+                        getWaitInstrText(waitConfig, waitInstr) + "'" :
+                        std::string("Wait instruction is not needed");
+                printWarning((haveSourcePos && offsetPos.first == waitInstr.offset) ?
+                        offsetPos.second : AsmSourcePos(), message.c_str());
+            }
+        }
+        if (!relaxWaits)
+            continue;
+        
+        /* not needed waits are removed from code (replaced by nops if difference
+         * of labels of section is used), other waits are replaced in place */
+        std::string waitText;
+        std::vector<AsmWaitInstr> replacedWaits;
+        std::vector<size_t> nopOffsets;
+        std::vector<AsmInstrCodeInsert> removes;
+        for (const AsmWaitInstr& waitInstr: relaxedWaits)
+        {
+            bool needed = false;
+            for (cxuint q = 0; q < waitConfig.waitQueuesNum; q++)
+                needed |= waitInstr.waits[q] < waitConfig.waitQueueSizes[q]-1;
+            if (!needed && !section.labelDiffs)
+            {
+                removes.push_back({ waitInstr.offset, isaAssembler->getInstructionSize(
+                        section.content.size() - waitInstr.offset,
+                        section.content.data() + waitInstr.offset), 0, 0, true });
+                continue;
+            }
+            waitText += needed ? getWaitInstrText(waitConfig, waitInstr) : "s_nop 0";
+            waitText += '\n';
+            if (!needed)
+                nopOffsets.push_back(waitInstr.offset);
+            replacedWaits.push_back(waitInstr);
+        }
+        std::istringstream waitInput(waitText);
+        std::ostringstream waitMessages;
+        Assembler waitAsm("", waitInput, wave32 ? ASM_WAVE32 : 0, BinaryFormat::RAWCODE,
+                    deviceType, waitMessages, waitMessages);
+        if (!replacedWaits.empty() && !waitAsm.assemble())
+        {
+            printError(getInstrSourcePos(section, replacedWaits.front().offset),
+                    "Can't assemble wait instructions");
+            good = false;
+            continue;
+        }
+        size_t waitPos = 0;
+        bool replaced = true;
+        for (const AsmWaitInstr& waitInstr: replacedWaits)
+        {
+            const std::vector<cxbyte>& waitCode = waitAsm.getSections()[0].content;
+            const size_t size = isaAssembler->getInstructionSize(
+                        waitCode.size() - waitPos, waitCode.data() + waitPos);
+            if (size != isaAssembler->getInstructionSize(
+                        section.content.size() - waitInstr.offset,
+                        section.content.data() + waitInstr.offset))
+            {
+                printError(getInstrSourcePos(section, waitInstr.offset),
+                        "Relaxed wait instruction has different size");
+                replaced = false;
+                break;
+            }
+            std::copy(waitCode.begin() + waitPos, waitCode.begin() + waitPos + size,
+                    section.content.begin() + waitInstr.offset);
+            waitPos += size;
+        }
+        if (!replaced)
+        {
+            good = false;
+            continue;
+        }
+        
+        // update waits in wait handler (nops are not wait instructions)
+        std::unique_ptr<ISAWaitHandler> newWaitHandler(new ISAWaitHandler());
+        ISAWaitHandler::ReadPos waitReadPos = section.waitHandler->findPositionByOffset(0);
+        auto rwit = replacedWaits.begin();
+        while (section.waitHandler->hasNext(waitReadPos))
+        {
+            AsmDelayedOp delOp;
+            AsmWaitInstr waitInstr;
+            if (section.waitHandler->nextInstr(waitReadPos, delOp, waitInstr))
+            {
+                while (rwit != replacedWaits.end() && rwit->offset < waitInstr.offset)
+                    ++rwit;
+                if (rwit == replacedWaits.end() || rwit->offset != waitInstr.offset)
+                    newWaitHandler->pushWaitInstr(waitInstr);
+                else if (!std::binary_search(nopOffsets.begin(), nopOffsets.end(),
+                            waitInstr.offset))
+                    newWaitHandler->pushWaitInstr(*rwit);
+            }
+            else
+                newWaitHandler->pushDelayedOp(delOp);
+        }
+        section.waitHandler = std::move(newWaitHandler);
+        
+        if (!removes.empty())
+        {
+            // errors of removing are reported at first removed wait instruction
+            const AsmSourcePos removePos = getInstrSourcePos(section,
+                        removes.front().offset);
+            AsmCodeOffsetMap offsetMap;
+            std::vector<std::pair<size_t, std::string> > removeErrors;
+            if (!insertCodeToSection(isaAssembler, deviceType, wave32, section, "",
+                        removes, offsetMap, removeErrors))
+                removeErrors.push_back({ SIZE_MAX, "Can't remove wait instructions" });
+            for (const auto& error: removeErrors)
+                printError(error.first != SIZE_MAX ? getInstrSourcePos(section,
+                        error.first) : removePos, error.second.c_str());
+            updateSectionOffsets(i, offsetMap);
+            if (!removeErrors.empty())
+            {
+                good = false;
+                continue;
+            }
+        }
+        relaxedWaitsNum += relaxedWaits.size();
+    }
+    return good;
+}
+
+/* instructions are scheduled before register allocation and before inserting waits.
+ * Instructions are only permuted inside segments, hence labels, relocations
+ * and jumps stay in their places */
+void Assembler::scheduleInstrs()
+{
+    std::unordered_set<AsmSymbol*> symbols;
+    collectScopeSymbols(globalScope, symbols);
+    for (AsmSymbolEntry* symEntry: symbolSnapshots)
+        symbols.insert(&symEntry->second);
+    for (AsmSymbolEntry* symEntry: symbolClones)
+        symbols.insert(&symEntry->second);
+    
+    for (AsmSectionId i = 0; i < sections.size(); i++)
+    {
+        AsmSection& section = sections[i];
+        if (section.type != AsmSectionType::CODE || section.usageHandler == nullptr ||
+            section.content.empty())
+            continue;
+        // offsets that can not be crossed by moved instructions
+        std::vector<size_t> fixedOffsets;
+        for (AsmSymbol* symbol: symbols)
+            if (symbol->hasValue && !symbol->regRange && symbol->sectionId == i)
+                fixedOffsets.push_back(symbol->value);
+        for (const AsmRelocation& reloc: relocations)
+            if (reloc.sectionId == i)
+                fixedOffsets.push_back(reloc.offset);
+        for (const AsmKernel& kernel: kernels)
+            for (const std::pair<size_t, size_t>& region: kernel.codeRegions)
+            {
+                fixedOffsets.push_back(region.first);
+                fixedOffsets.push_back(region.second);
+            }
+        ISAUsageHandler::ReadPos usagePos = section.usageHandler->findPositionByOffset(0);
+        while (section.usageHandler->hasNext(usagePos))
+        {
+            const AsmRegVarUsage rvu = section.usageHandler->nextUsage(usagePos);
+            if (rvu.useRegMode)
+                fixedOffsets.push_back(rvu.offset);
+        }
+        if (section.linearDepHandler != nullptr)
+            for (size_t k = 0; k < section.linearDepHandler->size(); k++)
+                fixedOffsets.push_back(section.linearDepHandler->getLinearDep(k).offset);
+        std::sort(fixedOffsets.begin(), fixedOffsets.end());
+        fixedOffsets.resize(std::unique(fixedOffsets.begin(), fixedOffsets.end()) -
+                    fixedOffsets.begin());
+        
+        AsmRegAllocator regAlloc(*this);
+        regAlloc.createCodeStructure(section.codeFlow, section.content.size(),
+                    section.content.data());
+        AsmInstrScheduler instrScheduler(*this, regAlloc.getCodeBlocks());
+        instrScheduler.schedule(section.content.size(), section.content.data(),
+                    *section.usageHandler, fixedOffsets);
+        const std::vector<AsmInstrScheduler::InstrMove>& moves =
+                    instrScheduler.getInstrMoves();
+        if (moves.empty())
+            continue;
+        
+        // move instructions
+        std::vector<cxbyte> newContent(section.content);
+        for (const AsmInstrScheduler::InstrMove& move: moves)
+            std::copy(section.content.begin() + move.offset,
+                    section.content.begin() + move.offset + move.size,
+                    newContent.begin() + move.newOffset);
+        section.content.swap(newContent);
+        
+        // map offset of instruction (offsets inside instruction are moved with it)
+        auto mapInstr = [&moves](size_t offset)
+        {
+            auto it = std::upper_bound(moves.begin(), moves.end(), offset,
+                    [](size_t o, const AsmInstrScheduler::InstrMove& move)
+                    { return o < move.offset; });
+            if (it == moves.begin())
+                return offset;
+            --it;
+            return (offset < it->offset + it->size) ?
+                    it->newOffset + offset - it->offset : offset;
+        };
+        
+        // update register usages (usages of single instruction keep their order)
+        std::vector<AsmRegVarUsage> rvus;
+        usagePos = section.usageHandler->findPositionByOffset(0);
+        while (section.usageHandler->hasNext(usagePos))
+        {
+            AsmRegVarUsage rvu = section.usageHandler->nextUsage(usagePos);
+            if (!rvu.useRegMode)
+                rvu.offset = mapInstr(rvu.offset);
+            rvus.push_back(rvu);
+        }
+        std::stable_sort(rvus.begin(), rvus.end(),
+                [](const AsmRegVarUsage& a, const AsmRegVarUsage& b)
+                { return a.offset < b.offset ||
+                        (a.offset == b.offset && a.useRegMode && !b.useRegMode); });
+        std::unique_ptr<ISAUsageHandler> newUsageHandler(
+                    isaAssembler->createUsageHandler());
+        for (const AsmRegVarUsage& rvu: rvus)
+            newUsageHandler->pushUsage(rvu);
+        section.usageHandler = std::move(newUsageHandler);
+        
+        if (section.waitHandler != nullptr)
+        {
+            std::vector<AsmDelayedOp> delOps;
+            std::vector<AsmWaitInstr> waitInstrs;
+            ISAWaitHandler::ReadPos waitPos = section.waitHandler->findPositionByOffset(0);
+            while (section.waitHandler->hasNext(waitPos))
+            {
+                AsmDelayedOp delOp;
+                AsmWaitInstr waitInstr;
+                if (section.waitHandler->nextInstr(waitPos, delOp, waitInstr))
+                {
+                    waitInstr.offset = mapInstr(waitInstr.offset);
+                    waitInstrs.push_back(waitInstr);
+                }
+                else
+                {
+                    delOp.offset = mapInstr(delOp.offset);
+                    delOps.push_back(delOp);
+                }
+            }
+            std::stable_sort(delOps.begin(), delOps.end(),
+                    [](const AsmDelayedOp& a, const AsmDelayedOp& b)
+                    { return a.offset < b.offset; });
+            std::stable_sort(waitInstrs.begin(), waitInstrs.end(),
+                    [](const AsmWaitInstr& a, const AsmWaitInstr& b)
+                    { return a.offset < b.offset; });
+            std::unique_ptr<ISAWaitHandler> newWaitHandler(new ISAWaitHandler());
+            for (const AsmDelayedOp& delOp: delOps)
+                newWaitHandler->pushDelayedOp(delOp);
+            for (const AsmWaitInstr& waitInstr: waitInstrs)
+                newWaitHandler->pushWaitInstr(waitInstr);
+            section.waitHandler = std::move(newWaitHandler);
+        }
+        
+        std::vector<std::pair<size_t, AsmSourcePos> > sourcePoses;
+        AsmSourcePosHandler::ReadPos sourcePosPos =
+                    section.sourcePosHandler.findPositionByOffset(0);
+        while (section.sourcePosHandler.hasNext(sourcePosPos))
+        {
+            std::pair<size_t, AsmSourcePos> entry =
+                    section.sourcePosHandler.nextSourcePos(sourcePosPos);
+            entry.first = mapInstr(entry.first);
+            sourcePoses.push_back(entry);
+        }
+        std::stable_sort(sourcePoses.begin(), sourcePoses.end(),
+                [](const std::pair<size_t, AsmSourcePos>& a,
+                   const std::pair<size_t, AsmSourcePos>& b)
+                { return a.first < b.first; });
+        AsmSourcePosHandler newSourcePosHandler;
+        for (const std::pair<size_t, AsmSourcePos>& entry: sourcePoses)
+            newSourcePosHandler.pushSourcePos(entry.first, entry.second);
+        section.sourcePosHandler = newSourcePosHandler;
+        movedInstrsNum += moves.size();
+    }
+}
+
+/* register pressure is analyzed before register allocation, hence
+ * it is pressure of register variables and normal registers in source code */
+void Assembler::createRegPressureReport()
+{
+    regPressures.clear();
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(deviceType);
+    const bool wave32 = (codeFlags & ASM_CODE_WAVE32) != 0;
+    // code of kernels in single section is analyzed separately
+    std::vector<std::vector<size_t> > splitOffsets;
+    std::vector<std::vector<AsmSection> > sectionParts;
+    std::vector<AsmCodePart> codeParts;
+    splitCodeSections(splitOffsets, sectionParts, codeParts);
+    AsmRegAllocator regAllocator(*this);
+    for (size_t pi = 0; pi < codeParts.size(); )
+    {
+        const AsmSectionId i = codeParts[pi].sectionId;
+        AsmRegPressureSection pressSection{ i, 0, 0,
+                getGPUExtraRegsNum(arch, REGTYPE_SGPR, GCN_VCC), { }, 0, { } };
+        if (formatHandler != nullptr)
+        {
+            const AsmFormatHandler::OccupancyConfig occConfig =
+                        formatHandler->getSectionOccupancyConfig(i);
+            pressSection.localSize = occConfig.localSize;
+            pressSection.workGroupSize = occConfig.workGroupSize;
+            pressSection.extraSGPRsNum = occConfig.extraSGPRsNum;
+        }
+        bool analyzed = true;
+        for (; pi < codeParts.size() && codeParts[pi].sectionId == i; pi++)
+        {
+            AsmSection& section = *codeParts[pi].section;
+            const size_t start = codeParts[pi].start;
+            try
+            {
+                // errors without offset are reported at start of code
+                if (!regAllocator.analyzeRegPressure(section))
+                {
+                    for (const auto& error: regAllocator.getErrorMessages())
+                        printError(getInstrSourcePos(section, error.first != SIZE_MAX ?
+                                error.first : 0), error.second.c_str());
+                    analyzed = false;
+                    continue;
+                }
+            }
+            catch(const AsmException& ex)
+            {
+                printError(getInstrSourcePos(section, 0), ex.what());
+                analyzed = false;
+                continue;
+            }
+            
+            const std::vector<AsmRegAllocator::CodeBlock>& codeBlocks =
+                        regAllocator.getCodeBlocks();
+            const std::vector<AsmRegAllocator::BlockRegPressure>& blockPressures =
+                        regAllocator.getBlockRegPressures();
+            for (size_t bi = 0; bi < codeBlocks.size(); bi++)
+            {
+                const AsmRegAllocator::BlockRegPressure& pressure = blockPressures[bi];
+                AsmRegPressureBlock pressBlock{ start + codeBlocks[bi].start,
+                        start + codeBlocks[bi].end, { }, { }, 0 };
+                for (size_t k = 0; k < MAX_REGTYPES_NUM; k++)
+                {
+                    pressBlock.maxLiveRegs[k] = pressure.maxLiveRegs[k];
+                    pressBlock.peakOffsets[k] = start + pressure.peakOffsets[k];
+                    pressSection.maxLiveRegs[k] = std::max(pressSection.maxLiveRegs[k],
+                                pressure.maxLiveRegs[k]);
+                }
+                pressBlock.wavesNum = getOccupancyWavesNum(arch,
+                        pressBlock.maxLiveRegs[REGTYPE_SGPR],
+                        pressBlock.maxLiveRegs[REGTYPE_VGPR], pressSection, wave32);
+                pressSection.blocks.push_back(pressBlock);
+            }
+        }
+        if (!analyzed)
+            continue;
+        pressSection.wavesNum = getOccupancyWavesNum(arch,
+                    pressSection.maxLiveRegs[REGTYPE_SGPR],
+                    pressSection.maxLiveRegs[REGTYPE_VGPR], pressSection, wave32);
+        regPressures.push_back(std::move(pressSection));
+    }
+}
+
+// write string as JSON string (with escaping)
+void CLRX::writeJSONString(std::ostream& os, const char* str)
+{
+    if (str == nullptr)
+    {
+        os << "null";
+        return;
+    }
+    os << '"';
+    for (; *str != 0; str++)
+    {
+        const unsigned char c = *str;
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if (c < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", c);
+            os << buf;
+        }
+        else
+            os << c;
+    }
+    os << '"';
+}
+
+void Assembler::writeRegPressureReport(std::ostream& os) const
+{
+    os << "{\n  \"device\": ";
+    writeJSONString(os, getGPUDeviceTypeName(deviceType));
+    os << ",\n  \"sections\": [";
+    for (size_t i = 0; i < regPressures.size(); i++)
+    {
+        const AsmRegPressureSection& pressSection = regPressures[i];
+        const AsmSection& section = sections[pressSection.sectionId];
+        os << ((i != 0) ? ",\n" : "\n") << "    {\n      \"section\": ";
+        writeJSONString(os, section.name);
+        os << ",\n      \"kernel\": ";
+        writeJSONString(os, (section.kernelId < kernels.size()) ?
+                    kernels[section.kernelId].name : nullptr);
+        os << ",\n      \"localSize\": " << pressSection.localSize <<
+            ",\n      \"workGroupSize\": " << pressSection.workGroupSize <<
+            ",\n      \"extraSGPRs\": " << pressSection.extraSGPRsNum <<
+            ",\n      \"maxSGPRs\": " << pressSection.maxLiveRegs[REGTYPE_SGPR] <<
+            ",\n      \"maxVGPRs\": " << pressSection.maxLiveRegs[REGTYPE_VGPR] <<
+            ",\n      \"waves\": " << pressSection.wavesNum <<
+            ",\n      \"blocks\": [";
+        for (size_t bi = 0; bi < pressSection.blocks.size(); bi++)
+        {
+            const AsmRegPressureBlock& block = pressSection.blocks[bi];
+            os << ((bi != 0) ? ",\n" : "\n") <<
+                "        { \"start\": " << block.start <<
+                ", \"end\": " << block.end <<
+                ", \"maxSGPRs\": " << block.maxLiveRegs[REGTYPE_SGPR] <<
+                ", \"sgprsPeakOffset\": " << block.peakOffsets[REGTYPE_SGPR] <<
+                ", \"maxVGPRs\": " << block.maxLiveRegs[REGTYPE_VGPR] <<
+                ", \"vgprsPeakOffset\": " << block.peakOffsets[REGTYPE_VGPR] <<
+                ", \"waves\": " << block.wavesNum << " }";
+        }
+        os << (pressSection.blocks.empty() ? "]\n    }" : "\n      ]\n    }");
+    }
+    os << (regPressures.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+bool Assembler::processCode()
+{
+    if (isaAssembler == nullptr)
+        return good;
+    if (schedule)
+        scheduleInstrs();
+    if (good && regPressureReport)
+        createRegPressureReport();
+    if (good && regAlloc)
+        good = allocateRegisters();
+    if (good && (checkWaits || relaxWaits))
+        good = relaxWaitInstrs();
+    if (good && autoWait)
+        good = insertWaitInstrs();
+    return good;
+}
+
 bool Assembler::assemble()
 {
     resolvingRelocs = false;
     doNotRemoveFromSymbolClones = false;
     sectionDiffsPrepared = false;
+    labelDiffsUpdated = false;
     
     for (const DefSym& defSym: defSyms)
         if (defSym.first!=".")
@@ -3105,6 +4216,10 @@ bool Assembler::assemble()
     
     if (withSectionDiffs())
     {
+        /* binary generator gets code of sections while preparing section differences,
+         * hence code must be changed before */
+        if (good)
+            good = processCode();
         formatHandler->prepareSectionDiffsResolving();
         sectionDiffsPrepared = true;
     }
@@ -3134,18 +4249,15 @@ bool Assembler::assemble()
     
     printUnresolvedSymbols(&globalScope);
     
+    if (good && !withSectionDiffs())
+        good = processCode();
+    
     if (good && formatHandler!=nullptr)
     {
         // code opened regions for kernels
         for (AsmKernelId i = 0; i < kernels.size(); i++)
         {
-            currentKernel = i;
-            AsmSectionId sectionId = formatHandler->getSectionId(".text");
-            if (sectionId == ASMSECT_NONE)
-            {
-                currentKernel = ASMKERN_GLOBAL;
-                sectionId = formatHandler->getSectionId(".text");
-            }
+            const AsmSectionId sectionId = getKernelCodeSectionId(i);
             const size_t contentSize = (sectionId != ASMSECT_NONE) ?
                     sections[sectionId].content.size() : size_t(0);
             kernels[i].closeCodeRegion(contentSize);
@@ -879,6 +879,10 @@ bool GCNAsmUtils::parseSOPPEncoding(Assembler& asmr, const GCNAsmInstruction& gc
             if (gcnInsn.code1 == 1 || gcnInsn.code1 == 27)
                 asmr.sections[asmr.currentSection].addCodeFlowEntry({ 
                     size_t(asmr.currentOutPos+4), size_t(0), AsmCodeFlowType::END });
+            // s_barrier synchronizes memory accesses of waves in work-group
+            if (gcnInsn.code1 == 10)
+                gcnAsm->delayedOps[0] = { output.size(), nullptr, uint16_t(0),
+                        uint16_t(0), 0, GCNDELOP_SYNC, GCNDELOP_NONE, cxbyte(0) };
             break;
         default:
             good &= parseImm(asmr, linePtr, imm16, &imm16Expr);
@@ -1331,6 +1335,13 @@ static void encodeVOP3Words(GPUArchMask arch, const GCNAsmInstruction& gcnInsn,
     wordsNum++;
 }
 
+// bytes saved by VOP encoding instead of VOP3 encoding (GCN1.5 VOP3 can hold literal)
+static inline cxuint getVOPSavedBytesNum(bool isGCN15, bool haveLiteral, cxuint wordsNum)
+{
+    const cxuint vop3WordsNum = (isGCN15 && haveLiteral) ? 3 : 2;
+    return (vop3WordsNum > wordsNum) ? (vop3WordsNum - wordsNum)<<2 : 0;
+}
+
 bool GCNAsmUtils::parseVOP2Encoding(Assembler& asmr, const GCNAsmInstruction& gcnInsn,
                   const char* instrPlace, const char* linePtr, GPUArchMask arch,
                   std::vector<cxbyte>& output, GCNAssembler::Regs& gcnRegs,
@@ -1345,6 +1356,10 @@ bool GCNAsmUtils::parseVOP2Encoding(Assembler& asmr, const GCNAsmInstruction& gc
     const bool isGCN15 = (arch & ARCH_GCN_1_5)!=0;
     GCNAssembler* gcnAsm = static_cast<GCNAssembler*>(asmr.isaAssembler);
     const bool wave32 = (asmr.codeFlags & ASM_CODE_WAVE32)!=0;
+    // in shrink mode, _e64 suffix does not force VOP3 encoding
+    const bool shrinkEncSize = asmr.shrink && gcnEncSize==GCNEncSize::BIT64;
+    if (shrinkEncSize)
+        gcnEncSize = GCNEncSize::UNKNOWN;
     
     RegRange dstReg(0, 0);
     RegRange dstCCReg(0, 0);
@@ -1466,11 +1481,7 @@ bool GCNAsmUtils::parseVOP2Encoding(Assembler& asmr, const GCNAsmInstruction& gc
     
     extraMods.needSDWA |= ((src0Op.vopMods | src1Op.vopMods) & VOPOP_SEXT) != 0;
     // determine whether VOP3 encoding is needed
-    bool vop3 = /* src1=sgprs and not (DS1_SGPR|src1_SGPR) */
-        //((src1Op.range.start<256) ^ sgprRegInSrc1) ||
-        ((!isGCN14 || !extraMods.needSDWA) &&
-                (src1Op.range.isNonVGPR() ^ sgprRegInSrc1)) ||
-        (!isGCN12 && (src0Op.vopMods!=0 || src1Op.vopMods!=0)) ||
+    bool vop3 = (!isGCN12 && (src0Op.vopMods!=0 || src1Op.vopMods!=0)) ||
         (modifiers&~(VOP3_BOUNDCTRL|(extraMods.needSDWA?VOP3_CLAMP:0)|
             /* exclude OMOD if RXVEGA and SDWA used */
             ((isGCN14 && extraMods.needSDWA) ? 3 : 0)))!=0 ||
@@ -1478,13 +1489,36 @@ bool GCNAsmUtils::parseVOP2Encoding(Assembler& asmr, const GCNAsmInstruction& gc
         //(haveDstCC && dstCCReg.start!=106) || (haveSrcCC && srcCCReg.start!=106) ||
         (haveDstCC && !dstCCReg.isVal(106)) || (haveSrcCC && !srcCCReg.isVal(106)) ||
         ((opMods.opselMod & 15) != 0) || (gcnEncSize==GCNEncSize::BIT64);
+    /* src1=sgprs and not (DS1_SGPR|src1_SGPR) */
+    const bool src1NeedVOP3 = ((!isGCN14 || !extraMods.needSDWA) &&
+                (src1Op.range.isNonVGPR() ^ sgprRegInSrc1));
+    
+    AsmRegVarUsage* rvus = gcnAsm->instrRVUs;
+    const GCNAsmInstruction* swappedInsn = nullptr;
+    // in shrink mode, swap SRC0 and SRC1 if only SRC1 requires VOP3 encoding
+    if (asmr.shrink && !vop3 && src1NeedVOP3 && !sgprRegInSrc1 &&
+        mode1 != GCN_ARG1_IMM && mode1 != GCN_ARG2_IMM &&
+        gcnVOPEnc==GCNVOPEnc::NORMAL && !extraMods.needSDWA && !extraMods.needDPP &&
+        !extraMods.needDPP8 && (src0Op.vopMods|src1Op.vopMods)==0 &&
+        src0Op.range.isVGPR() &&
+        (swappedInsn = findSwappedInstruction(gcnInsn, arch))!=nullptr)
+    {
+        std::swap(src0Op, src1Op);
+        std::swap(src0OpExpr, src1OpExpr);
+        std::swap(rvus[2], rvus[3]);
+        if (rvus[2].regField != ASMFIELD_NONE)
+            rvus[2].regField = GCNFIELD_VOP_SRC0;
+        if (rvus[3].regField != ASMFIELD_NONE)
+            rvus[3].regField = GCNFIELD_VOP_VSRC1;
+    }
+    else
+        vop3 |= src1NeedVOP3;
     
     if ((src0Op.range.isVal(255) || src1Op.range.isVal(255)) &&
         (src0Op.range.isSGPR() || src0Op.range.isVal(124) ||
          src1Op.range.isSGPR() || src1Op.range.isVal(124)))
         ASM_FAIL_BY_ERROR(instrPlace, "Literal with SGPR or M0 is illegal")
     
-    AsmRegVarUsage* rvus = gcnAsm->instrRVUs;
     if (vop3) // modify fields in reg usage
     {
         if (rvus[0].regField != ASMFIELD_NONE)
@@ -1584,7 +1618,8 @@ bool GCNAsmUtils::parseVOP2Encoding(Assembler& asmr, const GCNAsmInstruction& gc
     uint32_t words[2];
     if (!vop3)
         // VOP2 encoding
-        encodeVOPWords((uint32_t(gcnInsn.code1)<<25) |
+        encodeVOPWords(
+                (uint32_t((swappedInsn!=nullptr ? *swappedInsn : gcnInsn).code1)<<25) |
                 (uint32_t(src1Op.range.bstart()&0xff)<<9) |
                 (uint32_t(dstReg.bstart()&0xff)<<17),
                 modifiers, extraMods, src0Op, src1Op, immValue, mode1,
@@ -1596,6 +1631,9 @@ bool GCNAsmUtils::parseVOP2Encoding(Assembler& asmr, const GCNAsmInstruction& gc
     
     if (!checkGCNEncodingSize(asmr, instrPlace, gcnEncSize, wordsNum))
         return false;
+    if ((shrinkEncSize || swappedInsn!=nullptr) && !vop3)
+        asmr.savedBytesNum += getVOPSavedBytesNum(isGCN15, src0Op.range.isVal(255) ||
+                    src1Op.range.isVal(255), wordsNum);
     
     output.insert(output.end(), reinterpret_cast<cxbyte*>(words),
             reinterpret_cast<cxbyte*>(words + wordsNum));
@@ -1639,6 +1677,11 @@ bool GCNAsmUtils::parseVOP1Encoding(Assembler& asmr, const GCNAsmInstruction& gc
     const GCNInsnMode mode2 = (gcnInsn.mode & GCN_LITMASK);
     const bool isGCN12 = (arch & ARCH_GCN_1_2_4_5)!=0;
     const bool isGCN14 = (arch & ARCH_GCN_1_4_5)!=0;
+    const bool isGCN15 = (arch & ARCH_GCN_1_5)!=0;
+    // in shrink mode, _e64 suffix does not force VOP3 encoding
+    const bool shrinkEncSize = asmr.shrink && gcnEncSize==GCNEncSize::BIT64;
+    if (shrinkEncSize)
+        gcnEncSize = GCNEncSize::UNKNOWN;
     
     GCNAssembler* gcnAsm = static_cast<GCNAssembler*>(asmr.isaAssembler);
     RegRange dstReg(0, 0);
@@ -1753,6 +1796,9 @@ bool GCNAsmUtils::parseVOP1Encoding(Assembler& asmr, const GCNAsmInstruction& gc
     
     if (!checkGCNEncodingSize(asmr, instrPlace, gcnEncSize, wordsNum))
         return false;
+    if (shrinkEncSize && !vop3)
+        asmr.savedBytesNum += getVOPSavedBytesNum(isGCN15, src0Op.range.isVal(255),
+                    wordsNum);
     
     output.insert(output.end(), reinterpret_cast<cxbyte*>(words),
             reinterpret_cast<cxbyte*>(words + wordsNum));
@@ -1785,6 +1831,10 @@ bool GCNAsmUtils::parseVOPCEncoding(Assembler& asmr, const GCNAsmInstruction& gc
     const bool isGCN14 = (arch & ARCH_GCN_1_4_5)!=0;
     const bool isGCN15 = (arch & ARCH_GCN_1_5)!=0;
     const bool wave32 = (asmr.codeFlags & ASM_CODE_WAVE32)!=0;
+    // in shrink mode, _e64 suffix does not force VOP3 encoding
+    const bool shrinkEncSize = asmr.shrink && gcnEncSize==GCNEncSize::BIT64;
+    if (shrinkEncSize)
+        gcnEncSize = GCNEncSize::UNKNOWN;
     
     GCNAssembler* gcnAsm = static_cast<GCNAssembler*>(asmr.isaAssembler);
     RegRange dstReg(0, 0);
@@ -1850,12 +1900,33 @@ bool GCNAsmUtils::parseVOPCEncoding(Assembler& asmr, const GCNAsmInstruction& gc
     extraMods.needSDWA |= ((src0Op.vopMods | src1Op.vopMods) & VOPOP_SEXT) != 0;
     bool vop3 = //(dstReg.start!=106) || (src1Op.range.start<256) ||
         ((!isGCN14 || !extraMods.needSDWA) && !dstReg.isVal(vccCode)) ||
-        ((!isGCN14 || !extraMods.needSDWA) && src1Op.range.isNonVGPR()) ||
         (!isGCN12 && (src0Op.vopMods!=0 || src1Op.vopMods!=0)) ||
         (modifiers&~(VOP3_BOUNDCTRL|(extraMods.needSDWA?VOP3_CLAMP:0)|
             /* exclude OMOD if RXVEGA and SDWA used */
             ((isGCN14 && extraMods.needSDWA) ? 3 : 0)))!=0 ||
         ((opMods.opselMod & 15) != 0) || (gcnEncSize==GCNEncSize::BIT64);
+    const bool src1NeedVOP3 = ((!isGCN14 || !extraMods.needSDWA) &&
+                src1Op.range.isNonVGPR());
+    
+    AsmRegVarUsage* rvus = gcnAsm->instrRVUs;
+    const GCNAsmInstruction* swappedInsn = nullptr;
+    // in shrink mode, swap SRC0 and SRC1 (and reverse condition) if only SRC1
+    // requires VOP3 encoding
+    if (asmr.shrink && !vop3 && src1NeedVOP3 && gcnVOPEnc==GCNVOPEnc::NORMAL &&
+        !extraMods.needSDWA && !extraMods.needDPP && !extraMods.needDPP8 &&
+        (src0Op.vopMods|src1Op.vopMods)==0 && src0Op.range.isVGPR() &&
+        (swappedInsn = findSwappedInstruction(gcnInsn, arch))!=nullptr)
+    {
+        std::swap(src0Op, src1Op);
+        std::swap(src0OpExpr, src1OpExpr);
+        std::swap(rvus[1], rvus[2]);
+        if (rvus[1].regField != ASMFIELD_NONE)
+            rvus[1].regField = GCNFIELD_VOP_SRC0;
+        if (rvus[2].regField != ASMFIELD_NONE)
+            rvus[2].regField = GCNFIELD_VOP_VSRC1;
+    }
+    else
+        vop3 |= src1NeedVOP3;
     
     if ((src0Op.range.isVal(255) || src1Op.range.isVal(255)) &&
         (src0Op.range.isSGPR() || src0Op.range.isVal(124) ||
@@ -1866,7 +1937,6 @@ bool GCNAsmUtils::parseVOPCEncoding(Assembler& asmr, const GCNAsmInstruction& gc
         /* include VCCs (???) */
         ASM_FAIL_BY_ERROR(instrPlace, "More than one SGPR to read in instruction")
     
-    AsmRegVarUsage* rvus = gcnAsm->instrRVUs;
     if (vop3)
     {
         // modify fields in reg usage
@@ -1933,7 +2003,8 @@ bool GCNAsmUtils::parseVOPCEncoding(Assembler& asmr, const GCNAsmInstruction& gc
         const uint32_t dstMods = (isGCN14 ? 0x10000 : 0) |
                 ((isGCN14 && !dstReg.isVal(106)) ? ((dstReg.bstart()|0x80)<<8) : 0);
         
-        encodeVOPWords(0x7c000000U | (uint32_t(gcnInsn.code1)<<17) |
+        encodeVOPWords(0x7c000000U |
+                (uint32_t((swappedInsn!=nullptr ? *swappedInsn : gcnInsn).code1)<<17) |
                 (uint32_t(src1Op.range.bstart()&0xff)<<9),
                 modifiers, extraMods, src0Op, src1Op, 0, 0,
                 dstMods, wordsNum, words);
@@ -1945,6 +2016,9 @@ bool GCNAsmUtils::parseVOPCEncoding(Assembler& asmr, const GCNAsmInstruction& gc
     
     if (!checkGCNEncodingSize(asmr, instrPlace, gcnEncSize, wordsNum))
         return false;
+    if ((shrinkEncSize || swappedInsn!=nullptr) && !vop3)
+        asmr.savedBytesNum += getVOPSavedBytesNum(isGCN15, src0Op.range.isVal(255) ||
+                    src1Op.range.isVal(255), wordsNum);
     output.insert(output.end(), reinterpret_cast<cxbyte*>(words),
             reinterpret_cast<cxbyte*>(words + wordsNum));
     /// prevent freeing expression
@@ -1255,6 +1255,48 @@ static const size_t ssourceNamesGCN14TblSize = sizeof(ssourceNamesGCN14Tbl) /
         sizeof(std::pair<const char*, uint16_t>);
 
 // main routine to parse operand
+/* find inline constant that gives this same value as 32-bit or 16-bit literal
+ * (used in shrink mode). Float constants are used only if operand is
+ * FP32 or FP16 or if operand is scalar (SALU does not have 16-bit operands) */
+static bool findInlineConstForLiteral(uint64_t value, Flags instrOpMask, cxuint regsNum,
+            bool isGCN12, uint16_t& reg)
+{
+    const Flags opType = instrOpMask & INSTROP_TYPE_MASK;
+    if (regsNum > 1 || opType == INSTROP_V64BIT || (instrOpMask & INSTROP_VOP3P)!=0)
+        return false;
+    if (opType == INSTROP_F16)
+    {
+        static const uint16_t f16Consts[9] = { 0x3800, 0xb800, 0x3c00, 0xbc00,
+                0x4000, 0xc000, 0x4400, 0xc400, 0x3118 };
+        for (cxuint i = 0; i < (isGCN12 ? 9U : 8U); i++)
+            if (value == f16Consts[i])
+            {
+                reg = 240+i;
+                return true;
+            }
+        return false;
+    }
+    if ((value>>32) != 0)
+        return false;
+    // negative 32-bit integers
+    if (value >= 0xfffffff0U)
+    {
+        reg = 192 + (0x100000000ULL-value);
+        return true;
+    }
+    if (opType == INSTROP_INT && (instrOpMask & INSTROP_VREGS)!=0)
+        return false;
+    static const uint32_t f32Consts[9] = { 0x3f000000, 0xbf000000, 0x3f800000,
+            0xbf800000, 0x40000000, 0xc0000000, 0x40800000, 0xc0800000, 0x3e22f983 };
+    for (cxuint i = 0; i < (isGCN12 ? 9U : 8U); i++)
+        if (value == f32Consts[i])
+        {
+            reg = 240+i;
+            return true;
+        }
+    return false;
+}
+
 bool GCNAsmUtils::parseOperand(Assembler& asmr, const char*& linePtr, GCNOperand& operand,
              std::unique_ptr<AsmExpression>* outTargetExpr, GPUArchMask arch,
              cxuint regsNum, Flags instrOpMask, AsmRegField regField)
@@ -1776,6 +1818,15 @@ bool GCNAsmUtils::parseOperand(Assembler& asmr, const char*& linePtr, GCNOperand
                     operand.range = { 192-value, 0 };
                     return true;
                 }
+                uint16_t constReg = 0;
+                if (asmr.shrink && findInlineConstForLiteral(value, instrOpMask,
+                            regsNum, isGCN12, constReg))
+                {
+                    if ((instrOpMask & INSTROP_ONLYINLINECONSTS)==0)
+                        asmr.savedBytesNum += 4;
+                    operand.range = { constReg, 0 };
+                    return true;
+                }
             }
         }
         if (encodeAsLiteral)
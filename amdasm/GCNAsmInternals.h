@@ -314,6 +314,9 @@ struct CLRX_INTERNAL GCNAsmUtils: AsmParseUtils
     // checking whether VOP encoding is match
     static bool checkGCNVOPEncoding(Assembler& asmr, GPUArchMask arch, const char* insnPtr,
             GCNVOPEnc vopEnc, GCNInsnMode insnMode, const VOPExtraModifiers* modifiers);
+    // find instruction that gives same result for swapped SRC0 and SRC1 (shrink mode)
+    static const GCNAsmInstruction* findSwappedInstruction(
+                const GCNAsmInstruction& gcnInsn, GPUArchMask arch);
     // checking whether VOP extra modifiers match
     static bool checkGCNVOPExtraModifers(Assembler& asmr, GPUArchMask arch,
                  bool needImm, bool sextFlags, bool vop3, GCNVOPEnc gcnVOPEnc,
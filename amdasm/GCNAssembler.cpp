@@ -19,6 +19,7 @@
 
 #include <CLRX/Config.h>
 #include <cstdio>
+#include <string>
 #include <vector>
 #include <memory>
 #include <cstring>
@@ -29,6 +30,7 @@
 #include <CLRX/utils/GPUId.h>
 #include <CLRX/amdasm/GCNDefs.h>
 #include "GCNAsmInternals.h"
+#include "GCNDisasmInternals.h"
 
 using namespace CLRX;
 
@@ -119,6 +121,121 @@ static void initializeGCNAssembler()
     gcnInstrSortedTable.resize(j); // final size
 }
 
+// VOP2 instructions whose SRC0 and SRC1 can be swapped (sorted)
+static const char* gcnCommutativeInstrsTbl[] =
+{
+    "v_add_co_ci_u32", "v_add_co_u32", "v_add_f16", "v_add_f32", "v_add_i32",
+    "v_add_nc_u32", "v_add_u16", "v_add_u32", "v_addc_co_u32", "v_addc_u32",
+    "v_and_b32", "v_max_f16", "v_max_f32", "v_max_i16", "v_max_i32", "v_max_u16",
+    "v_max_u32", "v_min_f16", "v_min_f32", "v_min_i16", "v_min_i32", "v_min_u16",
+    "v_min_u32", "v_mul_f16", "v_mul_f32", "v_mul_hi_i32_i24", "v_mul_hi_u32_u24",
+    "v_mul_i32_i24", "v_mul_legacy_f32", "v_mul_lo_u16", "v_mul_u32_u24",
+    "v_or_b32", "v_xnor_b32", "v_xor_b32"
+};
+
+// VOP2 instructions with reversed operands (sorted by first)
+static const std::pair<const char*, const char*> gcnReversedInstrsTbl[] =
+{
+    { "v_ashr_i32", "v_ashrrev_i32" },
+    { "v_ashrrev_i32", "v_ashr_i32" },
+    { "v_lshl_b32", "v_lshlrev_b32" },
+    { "v_lshlrev_b32", "v_lshl_b32" },
+    { "v_lshr_b32", "v_lshrrev_b32" },
+    { "v_lshrrev_b32", "v_lshr_b32" },
+    { "v_sub_co_ci_u32", "v_subrev_co_ci_u32" },
+    { "v_sub_co_u32", "v_subrev_co_u32" },
+    { "v_sub_f16", "v_subrev_f16" },
+    { "v_sub_f32", "v_subrev_f32" },
+    { "v_sub_i32", "v_subrev_i32" },
+    { "v_sub_nc_u32", "v_subrev_nc_u32" },
+    { "v_sub_u16", "v_subrev_u16" },
+    { "v_sub_u32", "v_subrev_u32" },
+    { "v_subb_co_u32", "v_subbrev_co_u32" },
+    { "v_subb_u32", "v_subbrev_u32" },
+    { "v_subbrev_co_u32", "v_subb_co_u32" },
+    { "v_subbrev_u32", "v_subb_u32" },
+    { "v_subrev_co_ci_u32", "v_sub_co_ci_u32" },
+    { "v_subrev_co_u32", "v_sub_co_u32" },
+    { "v_subrev_f16", "v_sub_f16" },
+    { "v_subrev_f32", "v_sub_f32" },
+    { "v_subrev_i32", "v_sub_i32" },
+    { "v_subrev_nc_u32", "v_sub_nc_u32" },
+    { "v_subrev_u16", "v_sub_u16" },
+    { "v_subrev_u32", "v_sub_u32" }
+};
+
+// VOPC conditions with reversed operands (sorted by first)
+static const std::pair<const char*, const char*> gcnReversedCmpCondsTbl[] =
+{
+    { "eq", "eq" }, { "f", "f" }, { "ge", "le" }, { "gt", "lt" }, { "le", "ge" },
+    { "lg", "lg" }, { "lt", "gt" }, { "ne", "ne" }, { "neq", "neq" }, { "nge", "nle" },
+    { "ngt", "nlt" }, { "nle", "nge" }, { "nlg", "nlg" }, { "nlt", "ngt" },
+    { "o", "o" }, { "t", "t" }, { "tru", "tru" }, { "u", "u" }
+};
+
+static bool compareCStrPair(const std::pair<const char*, const char*>& p1,
+                const std::pair<const char*, const char*>& p2)
+{ return ::strcmp(p1.first, p2.first)<0; }
+
+const GCNAsmInstruction* GCNAsmUtils::findSwappedInstruction(
+            const GCNAsmInstruction& gcnInsn, GPUArchMask arch)
+{
+    const char* mnemonic = gcnInsn.mnemonic;
+    std::string swappedMnemonic;
+    if (gcnInsn.encoding == GCNENC_VOP2)
+    {
+        const char** tblEnd = gcnCommutativeInstrsTbl +
+                    sizeof(gcnCommutativeInstrsTbl)/sizeof(const char*);
+        const char** cit = binaryFind(gcnCommutativeInstrsTbl, tblEnd, mnemonic,
+                    [](const char* s1, const char* s2)
+                    { return ::strcmp(s1, s2)<0; });
+        if (cit != tblEnd)
+            return &gcnInsn;
+        const std::pair<const char*, const char*>* rtblEnd = gcnReversedInstrsTbl +
+                    sizeof(gcnReversedInstrsTbl)/sizeof(gcnReversedInstrsTbl[0]);
+        auto rit = binaryFind(gcnReversedInstrsTbl, rtblEnd,
+                    std::make_pair(mnemonic, (const char*)nullptr), compareCStrPair);
+        if (rit == rtblEnd)
+            return nullptr;
+        swappedMnemonic = rit->second;
+    }
+    else if (gcnInsn.encoding == GCNENC_VOPC && ::strncmp(mnemonic, "v_cmp", 5)==0)
+    {
+        // v_cmp[x|s|sx]_COND_TYPE
+        const char* condStart = ::strchr(mnemonic, '_');
+        if (condStart == nullptr || (condStart = ::strchr(condStart+1, '_')) == nullptr)
+            return nullptr;
+        condStart++;
+        const char* condEnd = ::strchr(condStart, '_');
+        if (condEnd == nullptr)
+            return nullptr;
+        const std::string cond(condStart, condEnd);
+        const std::pair<const char*, const char*>* ctblEnd = gcnReversedCmpCondsTbl +
+                    sizeof(gcnReversedCmpCondsTbl)/sizeof(gcnReversedCmpCondsTbl[0]);
+        auto cit = binaryFind(gcnReversedCmpCondsTbl, ctblEnd,
+                    std::make_pair(cond.c_str(), (const char*)nullptr), compareCStrPair);
+        if (cit == ctblEnd)
+            return nullptr;
+        if (::strcmp(cit->first, cit->second)==0)
+            return &gcnInsn;
+        swappedMnemonic = std::string(mnemonic, condStart) + cit->second + condEnd;
+    }
+    else
+        return nullptr;
+    
+    // find instruction with this same encoding for current architecture
+    auto it = binaryFind(gcnInstrSortedTable.begin(), gcnInstrSortedTable.end(),
+               GCNAsmInstruction{swappedMnemonic.c_str()},
+               [](const GCNAsmInstruction& instr1, const GCNAsmInstruction& instr2)
+               { return ::strcmp(instr1.mnemonic, instr2.mnemonic)<0; });
+    for (; it != gcnInstrSortedTable.end() &&
+            ::strcmp(it->mnemonic, swappedMnemonic.c_str())==0; ++it)
+        if (it->encoding == gcnInsn.encoding && (it->archMask & arch)!=0 &&
+            it->mode == gcnInsn.mode)
+            return it;
+    return nullptr;
+}
+
 // GCN Usage handler
 
 GCNUsageHandler::GCNUsageHandler() : ISAUsageHandler()
@@ -334,8 +451,12 @@ void GCNAssembler::assemble(const CString& inMnemonic, const char* mnemPlace,
         default:
             break;
     }
-    // register RegVarUsage in tests, do not apply normal usage
-    if (good && (assembler.getFlags() & ASM_TESTRUN) != 0)
+    // register RegVarUsage in tests, for register allocation, for wait analysis
+    // or for register pressure report
+    if (good && ((assembler.getFlags() & ASM_TESTRUN) != 0 || assembler.isRegAlloc() ||
+                assembler.isAutoWait() || assembler.isCheckWaits() ||
+                assembler.isRelaxWaits() || assembler.isSchedule() ||
+                assembler.isRegPressureReport()))
     {
         flushInstrRVUs(usageHandler);
         flushWaitInstrs(waitHandler);
@@ -851,3 +972,388 @@ const AsmWaitConfig& GCNAssembler::getWaitConfig() const
         return gcnWaitConfig10;
     return (curArchMask&ARCH_GCN_1_4)!=0 ? gcnWaitConfig14 : gcnWaitConfig;
 }
+
+// set register allocated for register variable in instruction field.
+// field values are encoded as zeroes (regvar's bstart() returns 0) while assemblying
+bool GCNAssembler::setRegVarRegister(const AsmRegVarUsage& rvu, cxuint rreg,
+                size_t codeSize, cxbyte* code) const
+{
+    const bool isGCN12 = (curArchMask & ARCH_GCN_1_2_4_5)!=0;
+    const bool isGCN15 = (curArchMask & ARCH_GCN_1_5)!=0;
+    if (rvu.offset + 4 > codeSize)
+        return false;
+    cxbyte regField = rvu.regField;
+    if (isGCN12 && (regField == GCNFIELD_VOP3_VDST || regField == GCNFIELD_VOP3_SRC1))
+    {
+        /* VOP3 VINTRP instruction can be encoded as VINTRP (one word), then
+         * its fields have VINTRP layout */
+        const uint32_t insnCode = ULEV(*reinterpret_cast<const uint32_t*>(
+                        code + rvu.offset)) & 0xfc000000U;
+        if (insnCode == (isGCN15 ? 0xc8000000U : 0xd4000000U))
+            regField = (regField == GCNFIELD_VOP3_VDST) ? GCNFIELD_VINTRP_VDST :
+                        GCNFIELD_VINTRP_VSRC0;
+    }
+    // offset of second instruction word
+    const size_t wordOffset = (regField == GCNFIELD_SSRC0 ||
+            regField == GCNFIELD_SSRC1 || regField == GCNFIELD_SDST ||
+            regField == GCNFIELD_VOP_SRC0 || regField == GCNFIELD_VOP_VSRC1 ||
+            regField == GCNFIELD_VOP_SSRC1 || regField == GCNFIELD_VOP_VDST ||
+            regField == GCNFIELD_VOP_SDST || regField == GCNFIELD_VOP3_VDST ||
+            regField == GCNFIELD_VOP3_SDST0 || regField == GCNFIELD_VOP3_SDST1 ||
+            regField == GCNFIELD_VINTRP_VSRC0 || regField == GCNFIELD_VINTRP_VDST ||
+            regField == GCNFIELD_SMRD_SBASE || regField == GCNFIELD_SMRD_SDST ||
+            (regField == GCNFIELD_SMRD_SOFFSET && !isGCN12)) ? 0 : 4;
+    if (rvu.offset + wordOffset + 4 > codeSize)
+        return false;
+    
+    uint32_t* wordPtr = reinterpret_cast<uint32_t*>(code + rvu.offset + wordOffset);
+    const cxuint reg = rreg & 0xff; // register index (for 8-bit fields)
+    uint32_t value = 0;
+    switch (regField)
+    {
+        case GCNFIELD_SSRC0:
+        case GCNFIELD_VINTRP_VSRC0:
+        case GCNFIELD_VOP3_VDST:
+        case GCNFIELD_VOP3_SDST0:
+        case GCNFIELD_DPPSDWA_SRC0:
+        case GCNFIELD_DPPSDWA_SSRC0:
+        case GCNFIELD_DS_ADDR:
+        case GCNFIELD_M_VADDR:
+        case GCNFIELD_FLAT_ADDR:
+        case GCNFIELD_EXP_VSRC0:
+            value = reg;
+            break;
+        case GCNFIELD_SSRC1:
+        case GCNFIELD_VOP3_SDST1:
+        case GCNFIELD_SDWAB_SDST:
+        case GCNFIELD_DS_DATA0:
+        case GCNFIELD_M_VDATA:
+        case GCNFIELD_FLAT_DATA:
+        case GCNFIELD_EXP_VSRC1:
+            value = reg<<8;
+            break;
+        case GCNFIELD_SDST:
+        case GCNFIELD_DS_DATA1:
+        case GCNFIELD_FLAT_SADDR:
+        case GCNFIELD_EXP_VSRC2:
+            value = reg<<16;
+            break;
+        case GCNFIELD_DS_VDST:
+        case GCNFIELD_M_SOFFSET:
+        case GCNFIELD_FLAT_VDST:
+        case GCNFIELD_EXP_VSRC3:
+            value = reg<<24;
+            break;
+        case GCNFIELD_VOP_SRC0:
+        case GCNFIELD_VOP3_SRC0:
+            value = rreg; // 9-bit source operand
+            break;
+        case GCNFIELD_VOP3_SRC1:
+            value = rreg<<9;
+            break;
+        case GCNFIELD_VOP3_SRC2:
+        case GCNFIELD_VOP3_SSRC:
+            value = rreg<<18;
+            break;
+        case GCNFIELD_VOP_VSRC1:
+        case GCNFIELD_VOP_SSRC1:
+            value = reg<<9;
+            break;
+        case GCNFIELD_VOP_VDST:
+        case GCNFIELD_VOP_SDST:
+            value = reg<<17;
+            break;
+        case GCNFIELD_VINTRP_VDST:
+            value = reg<<18;
+            break;
+        case GCNFIELD_SMRD_SBASE:
+            value = isGCN12 ? (reg>>1) : ((reg>>1)<<9);
+            break;
+        case GCNFIELD_SMRD_SDST:
+            value = isGCN12 ? (reg<<6) : (reg<<15);
+            break;
+        case GCNFIELD_SMRD_SOFFSET:
+            // SOFFSET in SMEM is stored in higher bits if GCN 1.5 or SOE enabled
+            if (isGCN12 && (isGCN15 || (ULEV(*reinterpret_cast<const uint32_t*>(
+                        code + rvu.offset)) & 0x4000U) != 0))
+                value = reg<<25;
+            else
+                value = reg;
+            break;
+        case GCNFIELD_M_SRSRC:
+            value = (reg>>2)<<16;
+            break;
+        case GCNFIELD_MIMG_SSAMP:
+            value = (reg>>2)<<21;
+            break;
+        case GCNFIELD_SMRD_SDSTH:
+        case GCNFIELD_M_VDATAH:
+        case GCNFIELD_M_VDATALAST:
+        case GCNFIELD_FLAT_VDSTLAST:
+            // these fields are covered by main field
+            return true;
+        default:
+            // unsupported fields (implicit VCC or multiple VADDRs)
+            return false;
+    }
+    SULEV(*wordPtr, ULEV(*wordPtr) | value);
+    return true;
+}
+
+bool GCNAssembler::isRegisterMove(size_t codeSize, const cxbyte* code) const
+{
+    if (codeSize < 4)
+        return false;
+    const uint32_t word = ULEV(*reinterpret_cast<const uint32_t*>(code));
+    if ((word & 0xff800000U) == 0xbe800000U)
+    {
+        // SOP1 encoding: s_mov_b32 with register source
+        const cxuint opcode = (word>>8) & 0xff;
+        const cxuint ssrc0 = word & 0xff;
+        return opcode == ((curArchMask & ARCH_GCN_1_2_4)!=0 ? 0U : 3U) && ssrc0 < 128;
+    }
+    if ((word & 0xfe000000U) == 0x7e000000U)
+    {
+        // VOP1 encoding: v_mov_b32 with register source (without DPP or SDWA)
+        const cxuint opcode = (word>>9) & 0xff;
+        const cxuint src0 = word & 0x1ff;
+        return opcode == 1 && (src0 >= 256 || src0 < 128);
+    }
+    return false;
+}
+
+bool GCNAssembler::setJumpTarget(size_t offset, size_t target,
+                size_t codeSize, cxbyte* code) const
+{
+    if (offset+4 > codeSize)
+        return false;
+    const uint32_t word = ULEV(*reinterpret_cast<const uint32_t*>(code+offset));
+    // only SOPP encoding (s_branch, s_cbranch_*)
+    if ((word & 0xff800000U) != 0xbf800000U)
+        return false;
+    int64_t outOffset = (int64_t(target)-int64_t(offset)-4);
+    if ((outOffset & 3) != 0)
+        return false;
+    outOffset >>= 2;
+    if (outOffset > INT16_MAX || outOffset < INT16_MIN)
+        return false;
+    SULEV(*reinterpret_cast<uint16_t*>(code+offset), outOffset);
+    return true;
+}
+
+/* instruction is decoded by disassembler routines. Instructions that changes
+ * control flow, waits, instructions with hazards that needs wait states
+ * (readlane, movrel, DPP, div_fmas, GDS) and unknown instructions are barriers.
+ * Hazards of instructions (reads of results of VALU or SALU which needs wait states)
+ * are given to keep distance between producer and consumer while scheduling.
+ * SCC is pseudo register 253 (code of SCC source operand) */
+AsmInstrSchedInfo GCNAssembler::getInstrSchedInfo(size_t codeSize,
+                const cxbyte* code) const
+{
+    AsmInstrSchedInfo info{ ASMSCHED_BARRIER, 4, 0 };
+    if (codeSize < 4)
+        return info;
+    GCNDisasmUtils::initializeInstrTables();
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(assembler.getDeviceType());
+    const bool isGCN124 = (curArchMask & ARCH_GCN_1_2_4) != 0;
+    const bool isGCN15 = (curArchMask & ARCH_GCN_1_5) != 0;
+    uint32_t codeWords[5] = { 0, 0, 0, 0, 0 };
+    const size_t codeWordsNum = std::min(codeSize>>2, size_t(5));
+    for (size_t i = 0; i < codeWordsNum; i++)
+        codeWords[i] = ULEV(*reinterpret_cast<const uint32_t*>(code + (i<<2)));
+    size_t pos = 1;
+    uint32_t insnCodes[5] = { codeWords[0], 0, 0, 0, 0 };
+    const cxbyte gcnEncoding = GCNDisasmUtils::fetchInstrWords(codeWords, codeWordsNum,
+                pos, arch, insnCodes);
+    if (gcnEncoding == GCNENC_NONE ||
+        (isGCN15 && gcnEncoding == GCNENC_VOP3P && (insnCodes[0] & 0x3000000U)!=0))
+        return info;
+    cxuint opcode;
+    bool isIllegal;
+    cxbyte mainEncoding;
+    const GCNInstruction* gcnInsn = GCNDisasmUtils::findInstruction(gcnEncoding,
+                insnCodes[0], insnCodes[1], arch, opcode, isIllegal, mainEncoding);
+    if (isIllegal)
+        return info;
+    const char* mnemonic = gcnInsn->mnemonic;
+    auto hasName = [mnemonic](const char* name)
+    { return ::strstr(mnemonic, name) != nullptr; };
+    
+    const AsmRegVarUsage sccUsage = { 0, nullptr, 253, 254, ASMFIELD_NONE,
+                ASMRVU_READ|ASMRVU_WRITE, 0, false };
+    const AsmRegVarUsage execRead = { 0, nullptr, 126, 128, ASMFIELD_NONE,
+                ASMRVU_READ, 0, false };
+    const AsmRegVarUsage m0Read = { 0, nullptr, 124, 125, ASMFIELD_NONE,
+                ASMRVU_READ, 0, false };
+    const AsmRegVarUsage vccRead = { 0, nullptr, 106, 108, ASMFIELD_NONE,
+                ASMRVU_READ, 0, false };
+    // hazards: SGPRs written by VALU, VGPRs written by VALU, M0 written by SALU
+    auto addHazard = [&info](cxbyte producer, cxbyte regType, uint16_t rstart,
+                uint16_t rend, cxuint waitStates)
+    { info.hazards[info.hazardsNum++] = { producer, regType, rstart, rend, waitStates }; };
+    auto addM0Hazard = [&addHazard]()
+    { addHazard(ASMSCHED_SALU, 255, 124, 125, 1); };
+    // M0 and EXEC are not in register usages, hence they are decoded from operands
+    cxbyte execFlags = 0, m0Flags = 0;
+    auto addSpecialOperand = [&execFlags, &m0Flags](uint32_t reg, cxbyte rwFlags)
+    {
+        if (reg == 124)
+            m0Flags |= rwFlags;
+        else if (reg == 126 || reg == 127)
+            execFlags |= rwFlags;
+    };
+    auto addSpecialRegs = [&info, &execFlags, &m0Flags, &execRead, &m0Read]()
+    {
+        if (execFlags != 0)
+        {
+            info.implRegs[info.implRegsNum] = execRead;
+            info.implRegs[info.implRegsNum++].rwFlags = execFlags;
+        }
+        if (m0Flags != 0)
+        {
+            info.implRegs[info.implRegsNum] = m0Read;
+            info.implRegs[info.implRegsNum++].rwFlags = m0Flags;
+        }
+    };
+    switch(gcnEncoding)
+    {
+        case GCNENC_SOPP:
+            return info;
+        case GCNENC_SOPC:
+        case GCNENC_SOP1:
+        case GCNENC_SOP2:
+        case GCNENC_SOPK:
+            info.flags |= ASMSCHED_SALU;
+            if (hasName("pc_") || hasName("rfe") || hasName("movrel") ||
+                hasName("cbranch") || hasName("gpr_idx") || hasName("setvskip") ||
+                hasName("setreg") || hasName("getreg") || hasName("waitcnt") ||
+                hasName("call") || hasName("version") || hasName("subvector"))
+                return info;
+            info.implRegs[info.implRegsNum++] = sccUsage;
+            // saveexec and wrexec instructions
+            if (hasName("exec"))
+                execFlags = ASMRVU_READ|ASMRVU_WRITE;
+            if (gcnEncoding != GCNENC_SOPC)
+                addSpecialOperand((insnCodes[0]>>16) & 0x7f,
+                        gcnEncoding == GCNENC_SOPK ? ASMRVU_READ|ASMRVU_WRITE : ASMRVU_WRITE);
+            if (gcnEncoding != GCNENC_SOPK)
+                addSpecialOperand(insnCodes[0] & 0xff, ASMRVU_READ);
+            if (gcnEncoding == GCNENC_SOP2 || gcnEncoding == GCNENC_SOPC)
+                addSpecialOperand((insnCodes[0]>>8) & 0xff, ASMRVU_READ);
+            addSpecialRegs();
+            break;
+        case GCNENC_SMRD:
+            if (hasName("dcache") || hasName("memtime") || hasName("memrealtime") ||
+                hasName("atc_probe"))
+                return info;
+            info.flags = ASMSCHED_MEMORY;
+            info.latency = 32;
+            return info;
+        case GCNENC_VOPC:
+        case GCNENC_VOP1:
+        case GCNENC_VOP2:
+        case GCNENC_VOP3A:
+        case GCNENC_VOP3B:
+        case GCNENC_VOP3P:
+        {
+            info.flags |= ASMSCHED_VALU;
+            const uint32_t src0 = insnCodes[0] & 0x1ff;
+            const bool isVOP3 = gcnEncoding == GCNENC_VOP3A ||
+                    gcnEncoding == GCNENC_VOP3B || gcnEncoding == GCNENC_VOP3P;
+            const bool isDPP = !isVOP3 &&
+                    ((isGCN124 && src0 == 0xfa) || (isGCN15 && (src0 == 0xe9 ||
+                    src0 == 0xea)));
+            if (isDPP)
+            {
+                // DPP reads VGPRs and EXEC written by VALU
+                info.implRegs[info.implRegsNum++] = execRead;
+                addHazard(ASMSCHED_VALU, REGTYPE_VGPR, 256, 512, 2);
+                addHazard(ASMSCHED_VALU, 255, 126, 128, 5);
+                return info;
+            }
+            if (hasName("readlane") || hasName("writelane"))
+            {
+                // lane select written by VALU
+                addHazard(ASMSCHED_VALU, REGTYPE_SGPR, 0, 108, 4);
+                return info;
+            }
+            if (hasName("div_fmas"))
+            {
+                info.implRegs[info.implRegsNum++] = vccRead;
+                addHazard(ASMSCHED_VALU, 255, 106, 108, 4);
+                return info;
+            }
+            if (hasName("lane") || hasName("movrel"))
+                return info;
+            execFlags = ASMRVU_READ;
+            if (::strncmp(mnemonic, "v_cmpx", 6) == 0)
+                execFlags |= ASMRVU_WRITE;
+            if (isVOP3)
+            {
+                // scalar destination of compare or carry (VOP3B)
+                if (::strncmp(mnemonic, "v_cmp", 5) == 0)
+                    addSpecialOperand(insnCodes[0] & 0xff, ASMRVU_WRITE);
+                else if (gcnEncoding == GCNENC_VOP3B)
+                    addSpecialOperand((insnCodes[0]>>8) & 0x7f, ASMRVU_WRITE);
+                for (cxuint k = 0; k < 3; k++)
+                    addSpecialOperand((insnCodes[1] >> (9*k)) & 0x1ff, ASMRVU_READ);
+            }
+            else
+                addSpecialOperand(src0, ASMRVU_READ);
+            addSpecialRegs();
+            // LDS direct operand reads M0 written by SALU
+            if ((isVOP3 ? (insnCodes[1] & 0x1ff) : src0) == 0xfe)
+            {
+                info.implRegs[info.implRegsNum++] = m0Read;
+                addM0Hazard();
+            }
+            break;
+        }
+        case GCNENC_VINTRP:
+            info.implRegs[info.implRegsNum++] = execRead;
+            info.implRegs[info.implRegsNum++] = m0Read;
+            addM0Hazard();
+            break;
+        case GCNENC_DS:
+            // GDS and ordered count instructions
+            if ((!isGCN124 && (insnCodes[0] & 0x20000U) != 0) ||
+                (isGCN124 && (insnCodes[0] & 0x10000U) != 0) ||
+                hasName("gws") || hasName("ordered") || hasName("barrier"))
+                return info;
+            info.flags = ASMSCHED_MEMORY;
+            info.latency = 64;
+            info.implRegs[info.implRegsNum++] = execRead;
+            info.implRegs[info.implRegsNum++] = m0Read;
+            // LDS add-TID instructions
+            if (hasName("addtid"))
+                addM0Hazard();
+            break;
+        case GCNENC_MUBUF:
+            // loads to LDS
+            if ((insnCodes[0] & 0x10000U) != 0)
+            {
+                info.implRegs[info.implRegsNum++] = m0Read;
+                addM0Hazard();
+                return info;
+            }
+            // fall through
+        case GCNENC_MTBUF:
+        case GCNENC_MIMG:
+        case GCNENC_FLAT:
+            info.flags = ASMSCHED_MEMORY;
+            info.latency = 400;
+            info.implRegs[info.implRegsNum++] = execRead;
+            info.implRegs[info.implRegsNum++] = m0Read;
+            // SGPRs (resources, offsets) written by VALU
+            addHazard(ASMSCHED_VALU, REGTYPE_SGPR, 0, 108, 5);
+            break;
+        case GCNENC_EXP:
+            info.flags = ASMSCHED_MEMORY;
+            info.implRegs[info.implRegsNum++] = execRead;
+            break;
+        default:
+            return info;
+    }
+    info.flags &= ~ASMSCHED_BARRIER;
+    return info;
+}
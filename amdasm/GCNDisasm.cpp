@@ -235,7 +235,7 @@ static void initializeGCNDisassembler()
 GCNDisassembler::GCNDisassembler(Disassembler& disassembler)
         : ISADisassembler(disassembler), instrOutOfCode(false)
 {
-    callOnce(clrxGCNDisasmOnceFlag, initializeGCNDisassembler);
+    GCNDisasmUtils::initializeInstrTables();
 }
 
 GCNDisassembler::~GCNDisassembler()
@@ -596,6 +596,299 @@ static const GCNEncodingOpcodeBits gcnEncodingOpcode15Table[GCNENC_MAXVAL+2] =
     { 16, 7 } /* GCNENC_VOP3P, opcode = (7bit)<<16 */
 };
 
+/* fetch words of instruction from code and determine its encoding.
+ * insnCodes[0] must hold first word of instruction, pos points to next word */
+cxbyte GCNDisasmUtils::fetchInstrWords(const uint32_t* codeWords, size_t codeWordsNum,
+            size_t& pos, GPUArchitecture arch, uint32_t* insnCodes)
+{
+    const bool isGCN11 = (arch == GPUArchitecture::GCN1_1);
+    const bool isGCN124 = (arch >= GPUArchitecture::GCN1_2);
+    const bool isGCN15 = (arch == GPUArchitecture::GCN1_5 || arch >= GPUArchitecture::GCN1_5_1);
+    const uint32_t insnCode = insnCodes[0];
+    cxbyte gcnEncoding = GCNENC_NONE;
+    
+    /* determine GCN encoding */
+    if ((insnCode & 0x80000000U) != 0)
+    {
+        if ((insnCode & 0x40000000U) == 0)
+        {
+            // SOP???
+            if  ((insnCode & 0x30000000U) == 0x30000000U)
+            {
+                // SOP1/SOPK/SOPC/SOPP
+                const uint32_t encPart = (insnCode & 0x0f800000U);
+                if (encPart == 0x0e800000U)
+                {
+                    // SOP1
+                    if ((insnCode&0xff) == 0xff) // literal
+                    {
+                        if (pos < codeWordsNum)
+                            insnCodes[1] = ULEV(codeWords[pos++]);
+                    }
+                    gcnEncoding = GCNENC_SOP1;
+                }
+                else if (encPart == 0x0f000000U)
+                {
+                    // SOPC
+                    if ((insnCode&0xff) == 0xff ||
+                        (insnCode&0xff00) == 0xff00) // literal
+                    {
+                        if (pos < codeWordsNum)
+                            insnCodes[1] = ULEV(codeWords[pos++]);
+                    }
+                    gcnEncoding = GCNENC_SOPC;
+                }
+                else if (encPart == 0x0f800000U) // SOPP
+                    gcnEncoding = GCNENC_SOPP;
+                else // SOPK
+                {
+                    gcnEncoding = GCNENC_SOPK;
+                    const uint32_t opcode = ((insnCode>>23)&0x1f);
+                    if (((!isGCN124 || isGCN15) && opcode == 21) ||
+                        (isGCN124 && !isGCN15 && opcode == 20))
+                    {
+                        if (pos < codeWordsNum)
+                            insnCodes[1] = ULEV(codeWords[pos++]);
+                    }
+                }
+            }
+            else
+            {
+                // SOP2
+                if ((insnCode&0xff) == 0xff || (insnCode&0xff00) == 0xff00)
+                {
+                    // literal
+                    if (pos < codeWordsNum)
+                        insnCodes[1] = ULEV(codeWords[pos++]);
+                }
+                gcnEncoding = GCNENC_SOP2;
+            }
+        }
+        else
+        {
+            // SMRD and others
+            const uint32_t encPart = (insnCode&0x3c000000U)>>26;
+            if (isGCN15)
+            {
+                if (gcnSize15Table[encPart]==GCNENCSCH_MIMG_DWORDS)
+                {
+                    cxuint extraDwords = ((insnCode>>1)&3) + 1;
+                    if (pos+extraDwords <= codeWordsNum)
+                    {
+                        if (extraDwords>=1)
+                            insnCodes[1] = ULEV(codeWords[pos]);
+                        if (extraDwords>=2)
+                            insnCodes[2] = ULEV(codeWords[pos+1]);
+                        if (extraDwords>=3)
+                            insnCodes[3] = ULEV(codeWords[pos+2]);
+                        if (extraDwords>=4)
+                            insnCodes[4] = ULEV(codeWords[pos+3]);
+                        pos += extraDwords;
+                    }
+                }
+                if (gcnSize15Table[encPart] && pos < codeWordsNum)
+                    insnCodes[1] = ULEV(codeWords[pos++]);
+                if (isGCN15 && (encPart==3 || encPart==5))
+                {
+                    // include VOP3 literal
+                    if ((insnCodes[1] & 0x1ff) == 0xff || ((insnCodes[1]>>9) & 0x1ff) == 0xff ||
+                        ((insnCodes[1]>>18) & 0x1ff) == 0xff)
+                    {
+                        if (pos < codeWordsNum)
+                            insnCodes[2] = ULEV(codeWords[pos++]);
+                    }
+                }
+            }
+            else if (isGCN11 && encPart==0 && (insnCode&0x1ff)==0xff)
+            {
+                if (pos < codeWordsNum)
+                    insnCodes[1] = ULEV(codeWords[pos++]);
+            }
+            else if ((!isGCN124 && gcnSize11Table[encPart] && (encPart != 7 || isGCN11)) ||
+                (isGCN124 && gcnSize12Table[encPart]))
+            {
+                if (pos < codeWordsNum)
+                    insnCodes[1] = ULEV(codeWords[pos++]);
+            }
+            if (isGCN15)
+                gcnEncoding = gcnEncoding15Table[encPart];
+            else if (isGCN124)
+                gcnEncoding = gcnEncoding12Table[encPart];
+            else
+                gcnEncoding = gcnEncoding11Table[encPart];
+            if (gcnEncoding == GCNENC_FLAT && !isGCN11 && !isGCN124)
+                gcnEncoding = GCNENC_NONE; // illegal if not GCN1.1
+        }
+    }
+    else
+    {
+        // some vector instructions
+        const uint32_t src0 = (insnCode&0x1ff);
+        if ((insnCode & 0x7e000000U) == 0x7c000000U)
+        {
+            // VOPC
+            if (src0 == 0xff || // literal
+                // SDWA, DPP
+                (isGCN124 && (src0 == 0xf9 || src0 == 0xfa)) ||
+                (isGCN15 && (src0 == 0xe9 || src0 == 0xea)))
+            {
+                if (pos < codeWordsNum)
+                    insnCodes[1] = ULEV(codeWords[pos++]);
+            }
+            gcnEncoding = GCNENC_VOPC;
+        }
+        else if ((insnCode & 0x7e000000U) == 0x7e000000U)
+        {
+            // VOP1
+            if (src0 == 0xff || // literal
+                // SDWA, DPP
+                (isGCN124 && (src0 == 0xf9 || src0 == 0xfa)) ||
+                (isGCN15 && (src0 == 0xe9 || src0 == 0xea)))
+            {
+                if (pos < codeWordsNum)
+                    insnCodes[1] = ULEV(codeWords[pos++]);
+            }
+            gcnEncoding = GCNENC_VOP1;
+        }
+        else
+        {
+            // VOP2
+            const cxuint opcode = (insnCode >> 25)&0x3f;
+            if ((!isGCN124 && (opcode == 32 || opcode == 33)) ||
+                (isGCN124 && !isGCN15 && (opcode == 23 || opcode == 24 ||
+                opcode == 36 || opcode == 37)) ||
+                (isGCN15 && (opcode == 32 || opcode == 33 || // V_MADMK and V_MADAK
+                    opcode == 44 || opcode == 45 || // V_FMAMK_F32, V_FMAAK_F32
+                    opcode == 55 || opcode == 56))) // V_MADMK and V_MADAK
+            {
+                if (pos < codeWordsNum)
+                    insnCodes[1] = ULEV(codeWords[pos++]);
+            }
+            else if (src0 == 0xff || // literal
+                // SDWA, DDP
+                (isGCN124 && (src0 == 0xf9 || src0 == 0xfa)) ||
+                (isGCN15 && (src0 == 0xe9 || src0 == 0xea)))
+            {
+                if (pos < codeWordsNum)
+                    insnCodes[1] = ULEV(codeWords[pos++]);
+            }
+            gcnEncoding = GCNENC_VOP2;
+        }
+    }
+    return gcnEncoding;
+}
+
+/* find instruction in instruction table by its encoding and code.
+ * set opcode, isIllegal (if instruction is not legal for this architecture) and
+ * encoding of instruction from main table (before applying overrides) */
+const GCNInstruction* GCNDisasmUtils::findInstruction(cxbyte gcnEncoding,
+            uint32_t insnCode, uint32_t insnCode2, GPUArchitecture arch,
+            cxuint& opcode, bool& isIllegal, cxbyte& mainEncoding)
+{
+    const bool isGCN124 = (arch >= GPUArchitecture::GCN1_2);
+    const bool isGCN14 = (arch == GPUArchitecture::GCN1_4 || arch == GPUArchitecture::GCN1_4_1);
+    const bool isGCN15 = (arch == GPUArchitecture::GCN1_5 || arch >= GPUArchitecture::GCN1_5_1);
+    const GPUArchMask curArchMask = 1U<<int(arch);
+    
+    const GCNEncodingOpcodeBits* encodingOpcodeTable =
+            (isGCN15) ? gcnEncodingOpcode15Table :
+            ((isGCN124) ? gcnEncodingOpcode12Table : gcnEncodingOpcodeTable);
+    opcode =
+            (insnCode>>encodingOpcodeTable[gcnEncoding].bitPos) & 
+            ((1U<<encodingOpcodeTable[gcnEncoding].bits)-1U);
+    if (encodingOpcodeTable[gcnEncoding].bitPos2!=0)
+    {
+        // next bits in opcode
+        cxuint val = 0;
+        if (encodingOpcodeTable[gcnEncoding].bitPos2>=32)
+            val = (insnCode2>>(encodingOpcodeTable[gcnEncoding].bitPos2-32));
+        else
+            val = insnCode2>>(encodingOpcodeTable[gcnEncoding].bitPos2);
+        opcode |= (val&((1U<<encodingOpcodeTable[gcnEncoding].bits2)-1U)) <<
+                    encodingOpcodeTable[gcnEncoding].bits;
+    }
+    
+    /* decode instruction and put to output */
+    const GCNEncodingSpace& encSpace =
+        (isGCN15) ? gcnInstrTableByCodeSpaces[GCN_GFX10_ENCSPACE_IDX + gcnEncoding] :
+        ((isGCN124) ? gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+3 + gcnEncoding] :
+          gcnInstrTableByCodeSpaces[gcnEncoding]);
+    const GCNInstruction* gcnInsn = gcnInstrTableByCode.get() +
+            encSpace.offset + opcode;
+    
+    // try to replace by FMA_MIX for VEGA20
+    if ((curArchMask&ARCH_VEGA20) != 0 && gcnInsn->code>=928 && gcnInsn->code<=930)
+    {
+        const GCNEncodingSpace& encSpace4 =
+            gcnInstrTableByCodeSpaces[2*GCNENC_MAXVAL+4 + 1];
+        const GCNInstruction* thisGCNInstr =
+                gcnInstrTableByCode.get() + encSpace4.offset + opcode;
+        if (thisGCNInstr->mnemonic != nullptr)
+            // replace
+            gcnInsn = thisGCNInstr;
+    }
+    mainEncoding = gcnInsn->encoding;
+    
+    isIllegal = false;
+    if (!isGCN124 && gcnInsn->mnemonic != nullptr &&
+        (curArchMask & gcnInsn->archMask) == 0 &&
+        gcnEncoding == GCNENC_VOP3A)
+    {    /* new overrides (VOP3A) */
+        const GCNEncodingSpace& encSpace2 =
+                gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+1];
+        gcnInsn = gcnInstrTableByCode.get() + encSpace2.offset + opcode;
+        if (gcnInsn->mnemonic == nullptr ||
+                (curArchMask & gcnInsn->archMask) == 0)
+            isIllegal = true; // illegal
+    }
+    else if (isGCN14 && gcnInsn->mnemonic != nullptr &&
+        (curArchMask & gcnInsn->archMask) == 0 &&
+        (gcnEncoding == GCNENC_VOP3A || gcnEncoding == GCNENC_VOP2 ||
+            gcnEncoding == GCNENC_VOP1))
+    {
+        /* new overrides (VOP1/VOP3A/VOP2 for GCN 1.4) */
+        const GCNEncodingSpace& encSpace4 =
+                gcnInstrTableByCodeSpaces[2*GCNENC_MAXVAL+4 +
+                        (gcnEncoding != GCNENC_VOP2) +
+                        (gcnEncoding == GCNENC_VOP1)];
+        gcnInsn = gcnInstrTableByCode.get() + encSpace4.offset + opcode;
+        if (gcnInsn->mnemonic == nullptr ||
+                (curArchMask & gcnInsn->archMask) == 0)
+            isIllegal = true; // illegal
+    }
+    else if (isGCN14 && gcnEncoding == GCNENC_FLAT && ((insnCode>>14)&3)!=0)
+    {
+        // GLOBAL_/SCRATCH_* instructions
+        const GCNEncodingSpace& encSpace4 =
+            gcnInstrTableByCodeSpaces[2*(GCNENC_MAXVAL+1)+2+3 +
+                ((insnCode>>14)&3)-1];
+        gcnInsn = gcnInstrTableByCode.get() + encSpace4.offset + opcode;
+        if (gcnInsn->mnemonic == nullptr ||
+                (curArchMask & gcnInsn->archMask) == 0)
+            isIllegal = true; // illegal
+    }
+    else if (isGCN15 && gcnEncoding == GCNENC_FLAT && ((insnCode>>14)&3)!=0)
+    {
+        // GLOBAL_/SCRATCH_* instructions
+        const GCNEncodingSpace& encSpace4 =
+            gcnInstrTableByCodeSpaces[GCN_GFX10_ENCSPACE_IDX + GCNENC_VOP3P +
+                ((insnCode>>14)&3)];
+        gcnInsn = gcnInstrTableByCode.get() + encSpace4.offset + opcode;
+        if (gcnInsn->mnemonic == nullptr ||
+                (curArchMask & gcnInsn->archMask) == 0)
+            isIllegal = true; // illegal
+    }
+    else if (gcnInsn->mnemonic == nullptr ||
+        (curArchMask & gcnInsn->archMask) == 0)
+        isIllegal = true;
+    return gcnInsn;
+}
+
+void GCNDisasmUtils::initializeInstrTables()
+{
+    callOnce(clrxGCNDisasmOnceFlag, initializeGCNDisassembler);
+}
+
 /* main routine */
 
 void GCNDisassembler::disassemble()
@@ -616,9 +909,7 @@ void GCNDisassembler::disassemble()
     const GPUArchitecture arch = getGPUArchitectureFromDeviceType(
                 disassembler.getDeviceType());
     // set up GCN indicators
-    const bool isGCN11 = (arch == GPUArchitecture::GCN1_1);
     const bool isGCN124 = (arch >= GPUArchitecture::GCN1_2);
-    const bool isGCN14 = (arch == GPUArchitecture::GCN1_4 || arch == GPUArchitecture::GCN1_4_1);
     const bool isGCN15 = (arch == GPUArchitecture::GCN1_5 || arch >= GPUArchitecture::GCN1_5_1);
     const GPUArchMask curArchMask = 
             1U<<int(getGPUArchitectureFromDeviceType(disassembler.getDeviceType()));
@@ -640,7 +931,6 @@ void GCNDisassembler::disassemble()
             break;
         
         const size_t oldPos = pos;
-        cxbyte gcnEncoding = GCNENC_NONE;
         const uint32_t insnCode = ULEV(codeWords[pos++]);
         if (insnCode == 0)
         {
@@ -659,176 +949,13 @@ void GCNDisassembler::disassemble()
             output.forward(bufPos);
             continue;
         }
-        uint32_t insnCode2 = 0;
-        uint32_t insnCode3 = 0;
-        uint32_t insnCode4 = 0;
-        uint32_t insnCode5 = 0;
-        
-        /* determine GCN encoding */
-        if ((insnCode & 0x80000000U) != 0)
-        {
-            if ((insnCode & 0x40000000U) == 0)
-            {
-                // SOP???
-                if  ((insnCode & 0x30000000U) == 0x30000000U)
-                {
-                    // SOP1/SOPK/SOPC/SOPP
-                    const uint32_t encPart = (insnCode & 0x0f800000U);
-                    if (encPart == 0x0e800000U)
-                    {
-                        // SOP1
-                        if ((insnCode&0xff) == 0xff) // literal
-                        {
-                            if (pos < codeWordsNum)
-                                insnCode2 = ULEV(codeWords[pos++]);
-                        }
-                        gcnEncoding = GCNENC_SOP1;
-                    }
-                    else if (encPart == 0x0f000000U)
-                    {
-                        // SOPC
-                        if ((insnCode&0xff) == 0xff ||
-                            (insnCode&0xff00) == 0xff00) // literal
-                        {
-                            if (pos < codeWordsNum)
-                                insnCode2 = ULEV(codeWords[pos++]);
-                        }
-                        gcnEncoding = GCNENC_SOPC;
-                    }
-                    else if (encPart == 0x0f800000U) // SOPP
-                        gcnEncoding = GCNENC_SOPP;
-                    else // SOPK
-                    {
-                        gcnEncoding = GCNENC_SOPK;
-                        const uint32_t opcode = ((insnCode>>23)&0x1f);
-                        if (((!isGCN124 || isGCN15) && opcode == 21) ||
-                            (isGCN124 && !isGCN15 && opcode == 20))
-                        {
-                            if (pos < codeWordsNum)
-                                insnCode2 = ULEV(codeWords[pos++]);
-                        }
-                    }
-                }
-                else
-                {
-                    // SOP2
-                    if ((insnCode&0xff) == 0xff || (insnCode&0xff00) == 0xff00)
-                    {
-                        // literal
-                        if (pos < codeWordsNum)
-                            insnCode2 = ULEV(codeWords[pos++]);
-                    }
-                    gcnEncoding = GCNENC_SOP2;
-                }
-            }
-            else
-            {
-                // SMRD and others
-                const uint32_t encPart = (insnCode&0x3c000000U)>>26;
-                if (isGCN15)
-                {
-                    if (gcnSize15Table[encPart]==GCNENCSCH_MIMG_DWORDS)
-                    {
-                        cxuint extraDwords = ((insnCode>>1)&3) + 1;
-                        if (pos+extraDwords <= codeWordsNum)
-                        {
-                            if (extraDwords>=1)
-                                insnCode2 = ULEV(codeWords[pos]);
-                            if (extraDwords>=2)
-                                insnCode3 = ULEV(codeWords[pos+1]);
-                            if (extraDwords>=3)
-                                insnCode4 = ULEV(codeWords[pos+2]);
-                            if (extraDwords>=4)
-                                insnCode5 = ULEV(codeWords[pos+3]);
-                            pos += extraDwords;
-                        }
-                    }
-                    if (gcnSize15Table[encPart] && pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                    if (isGCN15 && (encPart==3 || encPart==5))
-                    {
-                        // include VOP3 literal
-                        if ((insnCode2 & 0x1ff) == 0xff || ((insnCode2>>9) & 0x1ff) == 0xff ||
-                            ((insnCode2>>18) & 0x1ff) == 0xff)
-                            insnCode3 = ULEV(codeWords[pos++]);
-                    }
-                }
-                else if (isGCN11 && encPart==0 && (insnCode&0x1ff)==0xff)
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                else if ((!isGCN124 && gcnSize11Table[encPart] && (encPart != 7 || isGCN11)) ||
-                    (isGCN124 && gcnSize12Table[encPart]))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                if (isGCN15)
-                    gcnEncoding = gcnEncoding15Table[encPart];
-                else if (isGCN124)
-                    gcnEncoding = gcnEncoding12Table[encPart];
-                else
-                    gcnEncoding = gcnEncoding11Table[encPart];
-                if (gcnEncoding == GCNENC_FLAT && !isGCN11 && !isGCN124)
-                    gcnEncoding = GCNENC_NONE; // illegal if not GCN1.1
-            }
-        }
-        else
-        {
-            // some vector instructions
-            const uint32_t src0 = (insnCode&0x1ff);
-            if ((insnCode & 0x7e000000U) == 0x7c000000U)
-            {
-                // VOPC
-                if (src0 == 0xff || // literal
-                    // SDWA, DPP
-                    (isGCN124 && (src0 == 0xf9 || src0 == 0xfa)) ||
-                    (isGCN15 && (src0 == 0xe9 || src0 == 0xea)))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                gcnEncoding = GCNENC_VOPC;
-            }
-            else if ((insnCode & 0x7e000000U) == 0x7e000000U)
-            {
-                // VOP1
-                if (src0 == 0xff || // literal
-                    // SDWA, DPP
-                    (isGCN124 && (src0 == 0xf9 || src0 == 0xfa)) ||
-                    (isGCN15 && (src0 == 0xe9 || src0 == 0xea)))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                gcnEncoding = GCNENC_VOP1;
-            }
-            else
-            {
-                // VOP2
-                const cxuint opcode = (insnCode >> 25)&0x3f;
-                if ((!isGCN124 && (opcode == 32 || opcode == 33)) ||
-                    (isGCN124 && !isGCN15 && (opcode == 23 || opcode == 24 ||
-                    opcode == 36 || opcode == 37)) ||
-                    (isGCN15 && (opcode == 32 || opcode == 33 || // V_MADMK and V_MADAK
-                        opcode == 44 || opcode == 45 || // V_FMAMK_F32, V_FMAAK_F32
-                        opcode == 55 || opcode == 56))) // V_MADMK and V_MADAK
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                else if (src0 == 0xff || // literal
-                    // SDWA, DDP
-                    (isGCN124 && (src0 == 0xf9 || src0 == 0xfa)) ||
-                    (isGCN15 && (src0 == 0xe9 || src0 == 0xea)))
-                {
-                    if (pos < codeWordsNum)
-                        insnCode2 = ULEV(codeWords[pos++]);
-                }
-                gcnEncoding = GCNENC_VOP2;
-            }
-        }
+        uint32_t insnCodes[5] = { insnCode, 0, 0, 0, 0 };
+        cxbyte gcnEncoding = GCNDisasmUtils::fetchInstrWords(codeWords, codeWordsNum,
+                    pos, arch, insnCodes);
+        const uint32_t insnCode2 = insnCodes[1];
+        const uint32_t insnCode3 = insnCodes[2];
+        const uint32_t insnCode4 = insnCodes[3];
+        const uint32_t insnCode5 = insnCodes[4];
         
         prevIsTwoWord = (oldPos+2 == pos);
         
@@ -904,100 +1031,14 @@ void GCNDisassembler::disassemble()
         }
         else
         {
-            const GCNEncodingOpcodeBits* encodingOpcodeTable =
-                    (isGCN15) ? gcnEncodingOpcode15Table :
-                    ((isGCN124) ? gcnEncodingOpcode12Table : gcnEncodingOpcodeTable);
-            cxuint opcode =
-                    (insnCode>>encodingOpcodeTable[gcnEncoding].bitPos) & 
-                    ((1U<<encodingOpcodeTable[gcnEncoding].bits)-1U);
-            if (encodingOpcodeTable[gcnEncoding].bitPos2!=0)
-            {
-                // next bits in opcode
-                cxuint val = 0;
-                if (encodingOpcodeTable[gcnEncoding].bitPos2>=32)
-                    val = (insnCode2>>(encodingOpcodeTable[gcnEncoding].bitPos2-32));
-                else
-                    val = insnCode2>>(encodingOpcodeTable[gcnEncoding].bitPos2);
-                opcode |= (val&((1U<<encodingOpcodeTable[gcnEncoding].bits2)-1U)) <<
-                            encodingOpcodeTable[gcnEncoding].bits;
-            }
-            
-            /* decode instruction and put to output */
-            const GCNEncodingSpace& encSpace =
-                (isGCN15) ? gcnInstrTableByCodeSpaces[GCN_GFX10_ENCSPACE_IDX + gcnEncoding] :
-                ((isGCN124) ? gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+3 + gcnEncoding] :
-                  gcnInstrTableByCodeSpaces[gcnEncoding]);
-            const GCNInstruction* gcnInsn = gcnInstrTableByCode.get() +
-                    encSpace.offset + opcode;
-            
-            const GCNInstruction defaultInsn = { nullptr, gcnInsn->encoding, GCN_STDMODE,
+            cxuint opcode;
+            bool isIllegal;
+            cxbyte mainEncoding;
+            const GCNInstruction* gcnInsn = GCNDisasmUtils::findInstruction(gcnEncoding,
+                        insnCode, insnCode2, arch, opcode, isIllegal, mainEncoding);
+            const GCNInstruction defaultInsn = { nullptr, mainEncoding, GCN_STDMODE,
                         0, 0 };
-            
-            // try to replace by FMA_MIX for VEGA20
-            if ((curArchMask&ARCH_VEGA20) != 0 && gcnInsn->code>=928 && gcnInsn->code<=930)
-            {
-                const GCNEncodingSpace& encSpace4 =
-                    gcnInstrTableByCodeSpaces[2*GCNENC_MAXVAL+4 + 1];
-                const GCNInstruction* thisGCNInstr =
-                        gcnInstrTableByCode.get() + encSpace4.offset + opcode;
-                if (thisGCNInstr->mnemonic != nullptr)
-                    // replace
-                    gcnInsn = thisGCNInstr;
-            }
-            
             cxuint spacesToAdd = 16;
-            bool isIllegal = false;
-            if (!isGCN124 && gcnInsn->mnemonic != nullptr &&
-                (curArchMask & gcnInsn->archMask) == 0 &&
-                gcnEncoding == GCNENC_VOP3A)
-            {    /* new overrides (VOP3A) */
-                const GCNEncodingSpace& encSpace2 =
-                        gcnInstrTableByCodeSpaces[GCNENC_MAXVAL+1];
-                gcnInsn = gcnInstrTableByCode.get() + encSpace2.offset + opcode;
-                if (gcnInsn->mnemonic == nullptr ||
-                        (curArchMask & gcnInsn->archMask) == 0)
-                    isIllegal = true; // illegal
-            }
-            else if (isGCN14 && gcnInsn->mnemonic != nullptr &&
-                (curArchMask & gcnInsn->archMask) == 0 &&
-                (gcnEncoding == GCNENC_VOP3A || gcnEncoding == GCNENC_VOP2 ||
-                    gcnEncoding == GCNENC_VOP1))
-            {
-                /* new overrides (VOP1/VOP3A/VOP2 for GCN 1.4) */
-                const GCNEncodingSpace& encSpace4 =
-                        gcnInstrTableByCodeSpaces[2*GCNENC_MAXVAL+4 +
-                                (gcnEncoding != GCNENC_VOP2) +
-                                (gcnEncoding == GCNENC_VOP1)];
-                gcnInsn = gcnInstrTableByCode.get() + encSpace4.offset + opcode;
-                if (gcnInsn->mnemonic == nullptr ||
-                        (curArchMask & gcnInsn->archMask) == 0)
-                    isIllegal = true; // illegal
-            }
-            else if (isGCN14 && gcnEncoding == GCNENC_FLAT && ((insnCode>>14)&3)!=0)
-            {
-                // GLOBAL_/SCRATCH_* instructions
-                const GCNEncodingSpace& encSpace4 =
-                    gcnInstrTableByCodeSpaces[2*(GCNENC_MAXVAL+1)+2+3 +
-                        ((insnCode>>14)&3)-1];
-                gcnInsn = gcnInstrTableByCode.get() + encSpace4.offset + opcode;
-                if (gcnInsn->mnemonic == nullptr ||
-                        (curArchMask & gcnInsn->archMask) == 0)
-                    isIllegal = true; // illegal
-            }
-            else if (isGCN15 && gcnEncoding == GCNENC_FLAT && ((insnCode>>14)&3)!=0)
-            {
-                // GLOBAL_/SCRATCH_* instructions
-                const GCNEncodingSpace& encSpace4 =
-                    gcnInstrTableByCodeSpaces[GCN_GFX10_ENCSPACE_IDX + GCNENC_VOP3P +
-                        ((insnCode>>14)&3)];
-                gcnInsn = gcnInstrTableByCode.get() + encSpace4.offset + opcode;
-                if (gcnInsn->mnemonic == nullptr ||
-                        (curArchMask & gcnInsn->archMask) == 0)
-                    isIllegal = true; // illegal
-            }
-            else if (gcnInsn->mnemonic == nullptr ||
-                (curArchMask & gcnInsn->archMask) == 0)
-                isIllegal = true;
             
             if (!isIllegal)
             {
@@ -42,6 +42,15 @@ enum FloatLitType: cxbyte
 struct CLRX_INTERNAL GCNDisasmUtils
 {
     typedef GCNDisassembler::RelocIter RelocIter;
+    // initialize instruction tables (if not initialized)
+    static void initializeInstrTables();
+    // fetch words of instruction and determine encoding (insnCodes - 5 words)
+    static cxbyte fetchInstrWords(const uint32_t* codeWords, size_t codeWordsNum,
+              size_t& pos, GPUArchitecture arch, uint32_t* insnCodes);
+    // find instruction by encoding and first two words of instruction
+    static const GCNInstruction* findInstruction(cxbyte gcnEncoding,
+              uint32_t insnCode, uint32_t insnCode2, GPUArchitecture arch,
+              cxuint& opcode, bool& isIllegal, cxbyte& mainEncoding);
     static void printLiteral(GCNDisassembler& dasm, size_t codePos, RelocIter& relocIter,
               uint32_t literal, FloatLitType floatLit, bool optional,
               bool useSRMDLit = false);
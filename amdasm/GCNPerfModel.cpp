@@ -0,0 +1,713 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <cstring>
+#include <climits>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <ostream>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/utils/MemAccess.h>
+#include <CLRX/utils/GPUId.h>
+#include <CLRX/amdbin/ROCmBinaries.h>
+#include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdasm/Disassembler.h>
+#include <CLRX/amdasm/GCNPerfModel.h>
+#include "AsmInternals.h"
+#include "GCNDisasmInternals.h"
+
+using namespace CLRX;
+
+/* default latencies of delayed operations. these values are rough estimates
+ * (GCN timings gives only issue cycles of memory instructions) */
+static const GCNPerfLatencies defaultGCNPerfLatencies = { 400, 32, 64, 16 };
+
+static const char* gcnPerfClassNames[GCNPERF_CLASSES_NUM] =
+{ "salu", "valu", "vmem", "smem", "lds", "export", "branch", "wait", "illegal" };
+
+static const char* gcnPerfCounterNames[GCNPERF_COUNTERS_NUM] =
+{ "vmcnt", "expcnt", "lgkmcnt", "vscnt" };
+
+// DPFACTOR from GCN timings (professional Hawaii is not distinguished)
+static cxuint getGCNDPFactor(GPUDeviceType deviceType)
+{
+    switch(deviceType)
+    {
+        case GPUDeviceType::TAHITI:
+            return 2;
+        case GPUDeviceType::HAWAII:
+            return 4;
+        case GPUDeviceType::GFX906:
+        case GPUDeviceType::GFX907:
+            return 1;   // VEGA20 - DP speed 1/2
+        default:
+            return 8;
+    }
+}
+
+GCNPerfModel::GCNPerfModel(GPUDeviceType _deviceType)
+        : deviceType(_deviceType), dpFactor(getGCNDPFactor(_deviceType)),
+          latencies(defaultGCNPerfLatencies)
+{ }
+
+GCNPerfModel::GCNPerfModel(GPUDeviceType _deviceType, const GCNPerfLatencies& _latencies)
+        : deviceType(_deviceType), dpFactor(getGCNDPFactor(_deviceType)),
+          latencies(_latencies)
+{ }
+
+static inline bool startsWith(const char* str, const char* prefix)
+{ return ::strncmp(str, prefix, ::strlen(prefix)) == 0; }
+
+static inline bool endsWith(const char* str, size_t len, const char* suffix)
+{
+    const size_t suffixLen = ::strlen(suffix);
+    return len >= suffixLen && ::strcmp(str + len - suffixLen, suffix) == 0;
+}
+
+static inline bool hasString(const char* str, const char* substr)
+{ return ::strstr(str, substr) != nullptr; }
+
+static bool isGCNBranchInstr(const char* mnemonic)
+{
+    return startsWith(mnemonic, "s_branch") || startsWith(mnemonic, "s_cbranch") ||
+        startsWith(mnemonic, "s_setpc") || startsWith(mnemonic, "s_swappc") ||
+        startsWith(mnemonic, "s_call") || startsWith(mnemonic, "s_endpgm") ||
+        startsWith(mnemonic, "s_subvector_loop") || startsWith(mnemonic, "s_rfe");
+}
+
+// get class of instruction
+static cxbyte getGCNPerfClass(cxbyte gcnEncoding, const char* mnemonic)
+{
+    switch(gcnEncoding)
+    {
+        case GCNENC_SOPC:
+        case GCNENC_SOPP:
+        case GCNENC_SOP1:
+        case GCNENC_SOP2:
+        case GCNENC_SOPK:
+            if (startsWith(mnemonic, "s_waitcnt"))
+                return GCNPERF_WAIT;
+            return isGCNBranchInstr(mnemonic) ? GCNPERF_BRANCH : GCNPERF_SALU;
+        case GCNENC_SMRD:
+            return GCNPERF_SMEM;
+        case GCNENC_VOPC:
+        case GCNENC_VOP1:
+        case GCNENC_VOP2:
+        case GCNENC_VOP3A:
+        case GCNENC_VOP3B:
+        case GCNENC_VOP3P:
+        case GCNENC_VINTRP:
+            return GCNPERF_VALU;
+        case GCNENC_DS:
+            return GCNPERF_LDS;
+        case GCNENC_MUBUF:
+        case GCNENC_MTBUF:
+        case GCNENC_MIMG:
+        case GCNENC_FLAT:
+            return GCNPERF_VMEM;
+        case GCNENC_EXP:
+            return GCNPERF_EXPORT;
+        default:
+            return GCNPERF_ILLEGAL;
+    }
+}
+
+// timings of VALU instructions (VOP1, VOP2, VOPC, VOP3 tables)
+static cxuint getGCNVALUCycles(const char* mnemonic, size_t len, cxuint dpFactor)
+{
+    const bool isF64 = hasString(mnemonic, "_f64");
+    static const char* transPrefixes[] =
+    { "v_rcp_", "v_rsq_", "v_sqrt_", "v_exp_", "v_log_", "v_sin_", "v_cos_" };
+    for (const char* prefix: transPrefixes)
+        if (startsWith(mnemonic, prefix))
+            return isF64 ? dpFactor*8 : 16;
+
+    static const char* quarterRatePrefixes[] =
+    { "v_mul_hi_", "v_mul_lo_", "v_mad_u64_u32", "v_mad_i64_i32", "v_qsad_",
+      "v_mqsad_", "v_div_fixup_f32", "v_div_fmas_f32", "v_div_scale_f32" };
+    for (const char* prefix: quarterRatePrefixes)
+        if (startsWith(mnemonic, prefix))
+            return 16;
+
+    static const char* dpSlowPrefixes[] =
+    { "v_fma_f64", "v_mul_f64", "v_div_fmas_f64", "v_trig_preop_f64" };
+    for (const char* prefix: dpSlowPrefixes)
+        if (startsWith(mnemonic, prefix))
+            return dpFactor*8;
+
+    if (startsWith(mnemonic, "v_fma_f32"))
+        return (dpFactor <= 4) ? 4 : 16;
+    if (startsWith(mnemonic, "v_swap_b32"))
+        return 8;
+    if (isF64 ||
+        // 64-bit shifts and 64-bit comparisons
+        ((startsWith(mnemonic, "v_lshl") || startsWith(mnemonic, "v_lshr") ||
+          startsWith(mnemonic, "v_ashr")) && endsWith(mnemonic, len, "64")) ||
+        (startsWith(mnemonic, "v_cmp") &&
+          (endsWith(mnemonic, len, "_i64") || endsWith(mnemonic, len, "_u64"))))
+        return dpFactor*4;
+    return 4;
+}
+
+// timings of DS instructions
+static cxuint getGCNDSCycles(const char* mnemonic, size_t len)
+{
+    const bool is64 = endsWith(mnemonic, len, "_b64") || endsWith(mnemonic, len, "_u64") ||
+            endsWith(mnemonic, len, "_i64") || endsWith(mnemonic, len, "_f64");
+    if (startsWith(mnemonic, "ds_read") || startsWith(mnemonic, "ds_load"))
+    {
+        const bool isRead2 = hasString(mnemonic, "read2") || hasString(mnemonic, "2addr");
+        if (endsWith(mnemonic, len, "_b128") || endsWith(mnemonic, len, "_b96") ||
+            (isRead2 && is64))
+            return 16;
+        return (is64 || isRead2) ? 8 : 4;
+    }
+    if (startsWith(mnemonic, "ds_write") || startsWith(mnemonic, "ds_store"))
+    {
+        const bool isWrite2 = hasString(mnemonic, "write2") ||
+                hasString(mnemonic, "2addr");
+        if (hasString(mnemonic, "_src2_"))
+            return is64 ? 20 : 12;
+        if (endsWith(mnemonic, len, "_b128") || (isWrite2 && is64))
+            return 20;
+        if (endsWith(mnemonic, len, "_b96"))
+            return 16;
+        return (is64 || isWrite2) ? 12 : 8;
+    }
+    if (hasString(mnemonic, "_src2_"))
+        return is64 ? 8 : 4;
+    if (hasString(mnemonic, "cmpst") || hasString(mnemonic, "mskor") ||
+        hasString(mnemonic, "wrxchg2"))
+        return is64 ? 20 : 12;
+    if (startsWith(mnemonic, "ds_swizzle") || startsWith(mnemonic, "ds_nop") ||
+        startsWith(mnemonic, "ds_append") || startsWith(mnemonic, "ds_consume") ||
+        startsWith(mnemonic, "ds_gws") || startsWith(mnemonic, "ds_ordered") ||
+        startsWith(mnemonic, "ds_permute") || startsWith(mnemonic, "ds_bpermute"))
+        return 4;
+    return is64 ? 12 : 8;
+}
+
+// timings of MUBUF instructions (used also for MTBUF, MIMG and FLAT)
+static cxuint getGCNVMEMCycles(const char* mnemonic, size_t len)
+{
+    if (hasString(mnemonic, "_atomic_"))
+        return hasString(mnemonic, "cmpswap") ? 32 : 16;
+    if (hasString(mnemonic, "_store") || startsWith(mnemonic, "image_"))
+        return 16;
+    if (endsWith(mnemonic, len, "x2") || endsWith(mnemonic, len, "x3") ||
+        endsWith(mnemonic, len, "x4") || endsWith(mnemonic, len, "_xy") ||
+        endsWith(mnemonic, len, "_xyz") || endsWith(mnemonic, len, "_xyzw"))
+        return 16;
+    return 8;
+}
+
+// get issue cycles of instruction (from GCN timings)
+static cxuint getGCNInstrCycles(const char* mnemonic, cxbyte perfClass, cxuint dpFactor)
+{
+    const size_t len = ::strlen(mnemonic);
+    switch(perfClass)
+    {
+        case GCNPERF_SALU:
+            if (hasString(mnemonic, "_saveexec_b64") || startsWith(mnemonic, "s_setreg"))
+                return 8;
+            return 4;
+        case GCNPERF_SMEM:
+            if (endsWith(mnemonic, len, "x16"))
+                return 16;
+            return endsWith(mnemonic, len, "x8") ? 8 : 4;
+        case GCNPERF_VALU:
+            return getGCNVALUCycles(mnemonic, len, dpFactor);
+        case GCNPERF_LDS:
+            return getGCNDSCycles(mnemonic, len);
+        case GCNPERF_VMEM:
+            return getGCNVMEMCycles(mnemonic, len);
+        case GCNPERF_BRANCH:
+            // unconditional jump is always performed
+            return (::strcmp(mnemonic, "s_branch") == 0) ? 20 : 4;
+        default:
+            return 4;
+    }
+}
+
+// decoded instruction for performance model
+struct CLRX_INTERNAL GCNPerfInstr
+{
+    size_t offset;
+    uint32_t insnCode;
+    const char* mnemonic;
+    cxbyte encoding;
+    cxbyte perfClass;
+    bool hasLiteral;
+    bool isStore;
+    cxuint cycles;
+};
+
+// delayed operation waiting in queue of wait counter
+struct CLRX_INTERNAL GCNPerfDelayedOp
+{
+    size_t offset;
+    uint64_t issueTime;
+    cxuint latency;
+};
+
+static void addBlockStats(GCNPerfKernel& kernel, const GCNPerfBlock& block)
+{
+    for (cxuint i = 0; i < GCNPERF_CLASSES_NUM; i++)
+        kernel.instrsNum[i] += block.instrsNum[i];
+    kernel.issueCycles += block.issueCycles;
+    kernel.literalsNum += block.literalsNum;
+    kernel.literalCycles += block.literalCycles;
+    kernel.stallCycles += block.stallCycles;
+}
+
+static void initPerfBlock(GCNPerfBlock& block, size_t start)
+{
+    block.start = block.end = start;
+    std::fill(block.instrsNum, block.instrsNum + GCNPERF_CLASSES_NUM, 0);
+    block.issueCycles = 0;
+    block.literalsNum = 0;
+    block.literalCycles = 0;
+    block.stallCycles = 0;
+}
+
+void GCNPerfModel::analyzeCode(const CString& name, size_t codeSize, const cxbyte* code,
+                size_t offset)
+{
+    GCNDisasmUtils::initializeInstrTables();
+    const GPUArchitecture arch = getGPUArchitectureFromDeviceType(deviceType);
+    const bool isGCN124 = (arch >= GPUArchitecture::GCN1_2);
+    const bool isGCN14 = (arch >= GPUArchitecture::GCN1_4);
+    const bool isGCN15 = (arch == GPUArchitecture::GCN1_5 ||
+                arch >= GPUArchitecture::GCN1_5_1);
+
+    const uint32_t* codeWords = reinterpret_cast<const uint32_t*>(code);
+    const size_t codeWordsNum = (codeSize>>2);
+
+    /* decode instructions and collect jump targets */
+    std::vector<GCNPerfInstr> instrs;
+    std::vector<size_t> blockStarts;
+    blockStarts.push_back(0);
+    size_t pos = 0;
+    while (pos < codeWordsNum)
+    {
+        const size_t oldPos = pos;
+        uint32_t insnCodes[5] = { ULEV(codeWords[pos++]), 0, 0, 0, 0 };
+        if (insnCodes[0] == 0)
+            continue;   // skip fill (zeroes)
+
+        cxbyte gcnEncoding = GCNDisasmUtils::fetchInstrWords(codeWords, codeWordsNum,
+                    pos, arch, insnCodes);
+        if (isGCN15 && gcnEncoding == GCNENC_VOP3P && (insnCodes[0] & 0x3000000U)!=0)
+        {
+            // unknown encoding
+            gcnEncoding = GCNENC_NONE;
+            pos--;
+        }
+        GCNPerfInstr instr{ oldPos<<2, insnCodes[0], "", gcnEncoding, GCNPERF_ILLEGAL,
+                    false, false, 4 };
+        if (gcnEncoding != GCNENC_NONE)
+        {
+            cxuint opcode;
+            bool isIllegal;
+            cxbyte mainEncoding;
+            const GCNInstruction* gcnInsn = GCNDisasmUtils::findInstruction(gcnEncoding,
+                    insnCodes[0], insnCodes[1], arch, opcode, isIllegal, mainEncoding);
+            if (!isIllegal)
+            {
+                instr.mnemonic = gcnInsn->mnemonic;
+                instr.perfClass = getGCNPerfClass(gcnEncoding, gcnInsn->mnemonic);
+                instr.cycles = getGCNInstrCycles(gcnInsn->mnemonic, instr.perfClass,
+                                dpFactor);
+                instr.isStore = hasString(gcnInsn->mnemonic, "_store");
+                // jump target is next block start
+                if ((gcnEncoding == GCNENC_SOPP || gcnEncoding == GCNENC_SOPK) &&
+                    (gcnInsn->mode & GCN_MASK1) == GCN_IMM_REL)
+                {
+                    const int64_t target = (int64_t(oldPos) +
+                            int16_t(insnCodes[0]&0xffff) + 1)<<2;
+                    if (target >= 0 && uint64_t(target) < codeSize)
+                        blockStarts.push_back(target);
+                }
+            }
+
+            /* determine whether instruction has literal:
+             * instruction is longer than its base encoding (except SDWA/DPP and MIMG) */
+            const size_t baseWords = (gcnEncoding <= GCNENC_SOPK ||
+                    gcnEncoding == GCNENC_VOPC || gcnEncoding == GCNENC_VOP1 ||
+                    gcnEncoding == GCNENC_VOP2 || gcnEncoding == GCNENC_VINTRP ||
+                    (gcnEncoding == GCNENC_SMRD && !isGCN124)) ? 1 : 2;
+            const uint32_t src0 = insnCodes[0] & 0x1ff;
+            const bool isVOPSDWAOrDPP = (gcnEncoding == GCNENC_VOPC ||
+                    gcnEncoding == GCNENC_VOP1 || gcnEncoding == GCNENC_VOP2) &&
+                    ((isGCN124 && (src0 == 0xf9 || src0 == 0xfa)) ||
+                     (isGCN15 && (src0 == 0xe9 || src0 == 0xea)));
+            instr.hasLiteral = (pos - oldPos > baseWords) &&
+                    gcnEncoding != GCNENC_MIMG && !isVOPSDWAOrDPP;
+        }
+        if (instr.perfClass == GCNPERF_BRANCH)
+            blockStarts.push_back(pos<<2);
+        instrs.push_back(instr);
+    }
+    std::sort(blockStarts.begin(), blockStarts.end());
+    blockStarts.resize(std::unique(blockStarts.begin(), blockStarts.end()) -
+                blockStarts.begin());
+    // remove jump targets that are not at instruction start
+    blockStarts.resize(std::remove_if(blockStarts.begin()+1, blockStarts.end(),
+        [&instrs, codeWordsNum](size_t start)
+        {
+            if (start >= (codeWordsNum<<2))
+                return false;
+            auto it = std::lower_bound(instrs.begin(), instrs.end(), start,
+                [](const GCNPerfInstr& instr, size_t v)
+                { return instr.offset < v; });
+            return it == instrs.end() || it->offset != start;
+        }) - blockStarts.begin());
+
+    GCNPerfKernel kernel;
+    kernel.name = name;
+    kernel.offset = offset;
+    kernel.size = codeSize;
+    std::fill(kernel.instrsNum, kernel.instrsNum + GCNPERF_CLASSES_NUM, 0);
+    kernel.issueCycles = 0;
+    kernel.literalsNum = 0;
+    kernel.literalCycles = 0;
+    kernel.stallCycles = 0;
+
+    /* simulate issue of instructions in code order (jumps are not followed) */
+    // GCN1.2 and later fetch two-dword instructions in full speed
+    const cxuint literalCycles = isGCN124 ? 0 : 4;
+    std::deque<GCNPerfDelayedOp> opQueues[GCNPERF_COUNTERS_NUM];
+    uint64_t curTime = 0;
+    GCNPerfBlock block;
+    initPerfBlock(block, offset);
+    std::vector<size_t>::const_iterator nextBlockStart = blockStarts.begin()+1;
+    for (const GCNPerfInstr& instr: instrs)
+    {
+        while (nextBlockStart != blockStarts.end() && *nextBlockStart <= instr.offset)
+        {
+            // start new block
+            block.end = offset + *nextBlockStart;
+            if (block.end != block.start)
+            {
+                addBlockStats(kernel, block);
+                kernel.blocks.push_back(std::move(block));
+            }
+            initPerfBlock(block, offset + *nextBlockStart);
+            ++nextBlockStart;
+        }
+
+        block.instrsNum[instr.perfClass]++;
+        uint64_t cycles = instr.cycles;
+        if (instr.hasLiteral)
+        {
+            block.literalsNum++;
+            block.literalCycles += literalCycles;
+            cycles += literalCycles;
+        }
+        block.issueCycles += cycles;
+        const uint64_t issueTime = curTime;
+        curTime += cycles;
+
+        switch(instr.perfClass)
+        {
+            case GCNPERF_VMEM:
+            {
+                const cxbyte counter = (isGCN15 && instr.isStore) ?
+                            GCNPERF_VSCNT : GCNPERF_VMCNT;
+                opQueues[counter].push_back({ instr.offset, issueTime, latencies.vmem });
+                if (instr.encoding == GCNENC_FLAT &&
+                    !hasString(instr.mnemonic, "global_") &&
+                    !hasString(instr.mnemonic, "scratch_"))
+                    // FLAT can access LDS
+                    opQueues[GCNPERF_LGKMCNT].push_back({ instr.offset, issueTime,
+                                latencies.vmem });
+                break;
+            }
+            case GCNPERF_SMEM:
+                opQueues[GCNPERF_LGKMCNT].push_back({ instr.offset, issueTime,
+                            latencies.smem });
+                break;
+            case GCNPERF_LDS:
+                opQueues[GCNPERF_LGKMCNT].push_back({ instr.offset, issueTime,
+                            latencies.lds });
+                break;
+            case GCNPERF_EXPORT:
+                opQueues[GCNPERF_EXPCNT].push_back({ instr.offset, issueTime,
+                            latencies.exp });
+                break;
+            case GCNPERF_SALU:
+                if (startsWith(instr.mnemonic, "s_sendmsg"))
+                    opQueues[GCNPERF_LGKMCNT].push_back({ instr.offset, issueTime,
+                                latencies.smem });
+                break;
+            case GCNPERF_BRANCH:
+                if (startsWith(instr.mnemonic, "s_endpgm"))
+                    // end of program - no pending operations
+                    for (std::deque<GCNPerfDelayedOp>& queue: opQueues)
+                        queue.clear();
+                break;
+            case GCNPERF_WAIT:
+            {
+                // get counter values from wait instruction
+                cxuint counts[GCNPERF_COUNTERS_NUM] = { UINT_MAX, UINT_MAX,
+                            UINT_MAX, UINT_MAX };
+                const cxuint imm16 = instr.insnCode & 0xffff;
+                if (::strcmp(instr.mnemonic, "s_waitcnt") == 0)
+                {
+                    counts[GCNPERF_VMCNT] = (imm16&15) | (isGCN14 ? ((imm16>>10)&0x30) : 0);
+                    counts[GCNPERF_EXPCNT] = (imm16>>4)&7;
+                    counts[GCNPERF_LGKMCNT] = (imm16>>8) & (isGCN15 ? 0x3f : 15);
+                }
+                else if (::strcmp(instr.mnemonic, "s_waitcnt_vmcnt") == 0)
+                    counts[GCNPERF_VMCNT] = imm16;
+                else if (::strcmp(instr.mnemonic, "s_waitcnt_expcnt") == 0)
+                    counts[GCNPERF_EXPCNT] = imm16;
+                else if (::strcmp(instr.mnemonic, "s_waitcnt_lgkmcnt") == 0)
+                    counts[GCNPERF_LGKMCNT] = imm16;
+                else if (::strcmp(instr.mnemonic, "s_waitcnt_vscnt") == 0)
+                    counts[GCNPERF_VSCNT] = imm16;
+
+                uint64_t readyTime = curTime;
+                for (cxuint c = 0; c < GCNPERF_COUNTERS_NUM; c++)
+                {
+                    std::deque<GCNPerfDelayedOp>& queue = opQueues[c];
+                    if (queue.size() <= counts[c])
+                        continue;
+                    // wait for oldest operations
+                    uint64_t counterReadyTime = 0;
+                    GCNPerfDelayedOp lastOp{};
+                    while (queue.size() > counts[c])
+                    {
+                        lastOp = queue.front();
+                        counterReadyTime = std::max(counterReadyTime,
+                                    lastOp.issueTime + lastOp.latency);
+                        queue.pop_front();
+                    }
+                    const uint64_t stall = (counterReadyTime > curTime) ?
+                                counterReadyTime - curTime : 0;
+                    block.stalls.push_back({ offset + instr.offset, cxbyte(c), counts[c],
+                            offset + lastOp.offset, issueTime - lastOp.issueTime, stall });
+                    readyTime = std::max(readyTime, counterReadyTime);
+                }
+                block.stallCycles += readyTime - curTime;
+                curTime = readyTime;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    block.end = offset + (codeWordsNum<<2);
+    if (block.end != block.start)
+    {
+        addBlockStats(kernel, block);
+        kernel.blocks.push_back(std::move(block));
+    }
+    kernels.push_back(std::move(kernel));
+}
+
+void GCNPerfModel::analyzeDisassembler(const Disassembler& disassembler)
+{
+    switch(disassembler.getBinaryFormat())
+    {
+        case BinaryFormat::AMD:
+            for (const AmdDisasmKernelInput& kinput: disassembler.getAmdInput()->kernels)
+                if (kinput.code != nullptr)
+                    analyzeCode(kinput.kernelName, kinput.codeSize, kinput.code);
+            break;
+        case BinaryFormat::AMDCL2:
+        {
+            const AmdCL2DisasmInput* input = disassembler.getAmdCL2Input();
+            for (const AmdCL2DisasmKernelInput& kinput: input->kernels)
+                if (kinput.code != nullptr)
+                {
+                    // offset in code if kernel code is in whole code
+                    const size_t offset = (input->code != nullptr &&
+                            kinput.code >= input->code &&
+                            kinput.code < input->code + input->codeSize) ?
+                            kinput.code - input->code : 0;
+                    analyzeCode(kinput.kernelName, kinput.codeSize, kinput.code, offset);
+                }
+            break;
+        }
+        case BinaryFormat::ROCM:
+        {
+            const ROCmDisasmInput* input = disassembler.getROCmInput();
+            // kernel code begins after kernel config
+            const size_t kconfigSize = input->llvm10BinFormat ? 0 :
+                        sizeof(ROCmKernelConfig);
+            for (const ROCmDisasmRegionInput& region: input->regions)
+                if ((region.type == ROCmRegionType::KERNEL ||
+                    region.type == ROCmRegionType::FKERNEL) &&
+                    region.offset + kconfigSize <= input->codeSize &&
+                    region.size >= kconfigSize)
+                {
+                    const size_t size = std::min(region.size,
+                                input->codeSize - region.offset) - kconfigSize;
+                    analyzeCode(region.regionName, size,
+                            input->code + region.offset + kconfigSize,
+                            region.offset + kconfigSize);
+                }
+            break;
+        }
+        case BinaryFormat::GALLIUM:
+        {
+            const GalliumDisasmInput* input = disassembler.getGalliumInput();
+            std::vector<size_t> offsets;
+            for (const GalliumDisasmKernelInput& kinput: input->kernels)
+                offsets.push_back(kinput.offset);
+            offsets.push_back(input->codeSize);
+            std::sort(offsets.begin(), offsets.end());
+            // kernel code begins after AMD HSA config
+            const size_t kconfigSize = input->isAMDHSA ? sizeof(ROCmKernelConfig) : 0;
+            for (const GalliumDisasmKernelInput& kinput: input->kernels)
+            {
+                const size_t end = *std::upper_bound(offsets.begin(), offsets.end()-1,
+                            size_t(kinput.offset));
+                if (kinput.offset + kconfigSize <= end)
+                    analyzeCode(kinput.kernelName, end - kinput.offset - kconfigSize,
+                            input->code + kinput.offset + kconfigSize,
+                            kinput.offset + kconfigSize);
+            }
+            break;
+        }
+        default:
+        {
+            const RawCodeInput* input = disassembler.getRawInput();
+            analyzeCode(CString(), input->codeSize, input->code);
+            break;
+        }
+    }
+}
+
+void GCNPerfModel::analyzeAssembler(const Assembler& assembler)
+{
+    const std::vector<AsmSection>& sections = assembler.getSections();
+    const std::vector<AsmKernel>& kernelsList = assembler.getKernels();
+    const AsmSymbolMap& symbolMap = assembler.getSymbolMap();
+    // kernel symbols points to kernel config (AMD HSA config) in these formats
+    const size_t kconfigSize = ((assembler.getBinaryFormat() == BinaryFormat::ROCM &&
+                !assembler.isLLVM10BinFormat()) ||
+            (assembler.getBinaryFormat() == BinaryFormat::GALLIUM &&
+                assembler.getLLVMVersion() >= 40000)) ? sizeof(ROCmKernelConfig) : 0;
+    for (AsmSectionId sectionId = 0; sectionId < sections.size(); sectionId++)
+    {
+        const AsmSection& section = sections[sectionId];
+        if (section.type != AsmSectionType::CODE || section.content.empty())
+            continue;
+        const size_t sectionSize = section.content.size();
+        const cxbyte* content = section.content.data();
+        if (section.kernelId < kernelsList.size())
+        {
+            // code section of single kernel
+            analyzeCode(kernelsList[section.kernelId].name, sectionSize, content);
+            continue;
+        }
+        // find kernel symbols in section
+        std::vector<std::pair<size_t, const char*> > kernelOffsets;
+        for (const AsmKernel& kernel: kernelsList)
+        {
+            auto it = symbolMap.find(kernel.name);
+            if (it != symbolMap.end() && it->second.hasValue &&
+                it->second.sectionId == sectionId && it->second.value < sectionSize)
+                kernelOffsets.push_back({ size_t(it->second.value), kernel.name });
+        }
+        std::sort(kernelOffsets.begin(), kernelOffsets.end());
+        if (kernelOffsets.empty() || kernelOffsets[0].first != 0)
+        {
+            // code before first kernel
+            const size_t end = kernelOffsets.empty() ? sectionSize : kernelOffsets[0].first;
+            analyzeCode(section.name, end, content);
+        }
+        for (size_t i = 0; i < kernelOffsets.size(); i++)
+        {
+            const size_t start = kernelOffsets[i].first + kconfigSize;
+            const size_t end = (i+1 < kernelOffsets.size()) ?
+                        kernelOffsets[i+1].first : sectionSize;
+            if (start <= end)
+                analyzeCode(kernelOffsets[i].second, end-start, content + start, start);
+        }
+    }
+}
+
+static void writeGCNPerfStats(std::ostream& os, const cxuint* instrsNum,
+            uint64_t issueCycles, cxuint literalsNum, uint64_t literalCycles,
+            uint64_t stallCycles)
+{
+    os << "\"instrs\": {";
+    for (cxuint i = 0; i < GCNPERF_CLASSES_NUM; i++)
+        os << ((i != 0) ? ", \"" : " \"") << gcnPerfClassNames[i] << "\": " <<
+                    instrsNum[i];
+    os << " }, \"issueCycles\": " << issueCycles <<
+            ", \"literals\": " << literalsNum <<
+            ", \"literalCycles\": " << literalCycles <<
+            ", \"stallCycles\": " << stallCycles <<
+            ", \"cycles\": " << (issueCycles + stallCycles);
+}
+
+void GCNPerfModel::writeReport(std::ostream& os, const char* fileName) const
+{
+    os << "{\n";
+    if (fileName != nullptr)
+    {
+        os << "  \"file\": ";
+        writeJSONString(os, fileName);
+        os << ",\n";
+    }
+    os << "  \"device\": ";
+    writeJSONString(os, getGPUDeviceTypeName(deviceType));
+    os << ",\n  \"dpFactor\": " << dpFactor << ",\n  \"kernels\": [";
+    for (size_t i = 0; i < kernels.size(); i++)
+    {
+        const GCNPerfKernel& kernel = kernels[i];
+        os << ((i != 0) ? ",\n" : "\n") << "    {\n      \"kernel\": ";
+        writeJSONString(os, kernel.name.empty() ? nullptr : kernel.name.c_str());
+        os << ",\n      \"offset\": " << kernel.offset <<
+            ",\n      \"size\": " << kernel.size << ",\n      ";
+        writeGCNPerfStats(os, kernel.instrsNum, kernel.issueCycles, kernel.literalsNum,
+                    kernel.literalCycles, kernel.stallCycles);
+        os << ",\n      \"blocks\": [";
+        for (size_t bi = 0; bi < kernel.blocks.size(); bi++)
+        {
+            const GCNPerfBlock& block = kernel.blocks[bi];
+            os << ((bi != 0) ? ",\n" : "\n") <<
+                "        { \"start\": " << block.start <<
+                ", \"end\": " << block.end << ", ";
+            writeGCNPerfStats(os, block.instrsNum, block.issueCycles, block.literalsNum,
+                    block.literalCycles, block.stallCycles);
+            os << ",\n          \"stalls\": [";
+            for (size_t si = 0; si < block.stalls.size(); si++)
+            {
+                const GCNPerfStall& stall = block.stalls[si];
+                os << ((si != 0) ? ", " : " ") <<
+                    "{ \"offset\": " << stall.offset <<
+                    ", \"counter\": \"" << gcnPerfCounterNames[stall.counter] <<
+                    "\", \"count\": " << stall.count <<
+                    ", \"opOffset\": " << stall.opOffset <<
+                    ", \"coveredCycles\": " << stall.coveredCycles <<
+                    ", \"stallCycles\": " << stall.stallCycles << " }";
+            }
+            os << (block.stalls.empty() ? "] }" : " ] }");
+        }
+        os << (kernel.blocks.empty() ? "]\n    }" : "\n      ]\n    }");
+    }
+    os << (kernels.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
@@ -29,6 +29,7 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/MemAccess.h>
@@ -190,17 +191,18 @@ void AmdInput::addEmptyKernel(const char* kernelName)
     kernels.push_back(std::move(kernel));
 }
 
-AmdGPUBinGenerator::AmdGPUBinGenerator() : manageable(false), input(nullptr)
+AmdGPUBinGenerator::AmdGPUBinGenerator() : manageable(false), input(nullptr),
+        mergeStrings(false), threadsNum(0)
 { }
 
 AmdGPUBinGenerator::AmdGPUBinGenerator(const AmdInput* amdInput)
-        : manageable(false), input(amdInput)
+        : manageable(false), input(amdInput), mergeStrings(false), threadsNum(0)
 { }
 
 AmdGPUBinGenerator::AmdGPUBinGenerator(bool _64bitMode, GPUDeviceType deviceType,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        const std::vector<AmdKernelInput>& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), mergeStrings(false), threadsNum(0)
 {
     std::unique_ptr<AmdInput> _input(new AmdInput{});
     _input->is64Bit = _64bitMode;
@@ -217,7 +219,7 @@ AmdGPUBinGenerator::AmdGPUBinGenerator(bool _64bitMode, GPUDeviceType deviceType
 AmdGPUBinGenerator::AmdGPUBinGenerator(bool _64bitMode, GPUDeviceType deviceType,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        std::vector<AmdKernelInput>&& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), mergeStrings(false), threadsNum(0)
 {
     std::unique_ptr<AmdInput> _input(new AmdInput{});
     _input->is64Bit = _64bitMode;
@@ -637,18 +639,58 @@ public:
     }
 };
 
+// minimal number of kernels to generate inner binaries concurrently
+static const size_t CL1_PARALLEL_KERNELS_MIN = 16;
+
 class CLRX_INTERNAL CL1MainTextGen: public ElfRegionContent
 {
 private:
     Array<TempAmdKernelData>& tempDatas;
+    cxuint threadsNum;
+    
+    // generate inner binaries concurrently into their parts of output
+    void generateParallel(size_t workersNum, const Array<size_t>& offsets,
+                cxbyte* output) const
+    {
+        runParallelTasks(tempDatas.size(), workersNum, [&](size_t i)
+        {
+            FastOutputBuffer kfob(offsets[i+1]-offsets[i],
+                        reinterpret_cast<char*>(output + offsets[i]));
+            tempDatas[i].elfBinGen.generate(kfob);
+        });
+    }
 public:
-    CL1MainTextGen(Array<TempAmdKernelData>& _tempDatas) : tempDatas(_tempDatas)
+    CL1MainTextGen(Array<TempAmdKernelData>& _tempDatas, cxuint _threadsNum)
+            : tempDatas(_tempDatas), threadsNum(_threadsNum)
     { }
     
     void operator()(FastOutputBuffer& fob) const
     {
-        for (TempAmdKernelData& kernel: tempDatas)
-            kernel.elfBinGen.generate(fob);
+        const size_t workersNum = std::min(size_t((threadsNum != 0) ? threadsNum :
+                    std::thread::hardware_concurrency()), tempDatas.size());
+        if (tempDatas.size() < CL1_PARALLEL_KERNELS_MIN || workersNum <= 1)
+        {
+            for (TempAmdKernelData& kernel: tempDatas)
+                kernel.elfBinGen.generate(fob);
+            return;
+        }
+        // inner binaries are generated independently and put in kernel order
+        Array<size_t> offsets(tempDatas.size()+1);
+        offsets[0] = 0;
+        for (size_t i = 0; i < tempDatas.size(); i++)
+            offsets[i+1] = offsets[i] + tempDatas[i].innerBinSize;
+        const size_t allInnerBinSize = offsets[tempDatas.size()];
+        if (!fob.hasOStream() && allInnerBinSize <= UINT32_MAX)
+        {
+            // direct writing: generate inner binaries in place
+            cxbyte* output = reinterpret_cast<cxbyte*>(fob.reserve(allInnerBinSize));
+            generateParallel(workersNum, offsets, output);
+            fob.forward(allInnerBinSize);
+            return;
+        }
+        Array<cxbyte> output(allInnerBinSize);
+        generateParallel(workersNum, offsets, output.data());
+        fob.writeArray(output.size(), output.data());
     }
 };
 
@@ -1652,6 +1694,10 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
     else
         elfBinGen32.reset(new ElfBinaryGen32({ 0, 0, ELFOSABI_SYSV, 0, ET_EXEC, 
             gpuDeviceCodeTable[cxuint(input->deviceType)], EV_CURRENT, UINT_MAX, 0, 0 }));
+    if (input->is64Bit)
+        elfBinGen64->setMergeStrings(mergeStrings);
+    else
+        elfBinGen32->setMergeStrings(mergeStrings);
     
     Array<TempAmdKernelData> tempAmdKernelDatas(kernelsNum);
     cxuint uniqueId = 1024;
@@ -1754,6 +1800,7 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
         
         kelfBinGen.setHeader({ 0, 0, 0x64, 1, ET_EXEC, 0x7dU, EV_CURRENT,
                     UINT_MAX, 0, 1 });
+        kelfBinGen.setMergeStrings(mergeStrings);
         kelfBinGen.addRegion(ElfRegion32::programHeaderTable());
         // CALNoteDir entries
         kelfBinGen.addRegion(ElfRegion32(sizeof(CALEncodingEntry),
@@ -1806,7 +1853,7 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
         rodataSize += input->globalDataSize;
     
     CL1MainRoDataGen rodataGen(input, tempAmdKernelDatas);
-    CL1MainTextGen textGen(tempAmdKernelDatas);
+    CL1MainTextGen textGen(tempAmdKernelDatas, threadsNum);
     CL1MainCommentGen commentGen(input, driverInfo);
     CL1MainStrTabGen mainStrTabGen(driverVersion, input);
     CL1MainSymTabGen<Elf32Types> mainSymTabGen32(driverVersion, input, tempAmdKernelDatas);
@@ -1833,29 +1880,35 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
     /****
      * prepare for write binary to output
      ****/
-    std::unique_ptr<std::ostream> outStreamHolder;
+    std::unique_ptr<FastOutputBuffer> fobHolder;
     std::ostream* os = nullptr;
     if (aPtr != nullptr)
     {
+        // write directly to output array
         aPtr->resize(binarySize);
-        outStreamHolder.reset(
-            new ArrayOStream(binarySize, reinterpret_cast<char*>(aPtr->data())));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize,
+                    reinterpret_cast<char*>(aPtr->data())));
     }
     else if (vPtr != nullptr)
     {
+        // write directly to output vector
         vPtr->resize(binarySize);
-        outStreamHolder.reset(new VectorOStream(*vPtr));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize, vPtr->data()));
     }
-    else // from argument
+    else
+    {
+        // from argument
         os = osPtr;
+        fobHolder.reset(new FastOutputBuffer(256, *os));
+    }
     
-    const std::ios::iostate oldExceptions = os->exceptions();
-    FastOutputBuffer fob(256, *os);
+    const std::ios::iostate oldExceptions = (os != nullptr) ?
+                os->exceptions() : std::ios::goodbit;
+    FastOutputBuffer& fob = *fobHolder;
     try
     {
-        os->exceptions(std::ios::failbit | std::ios::badbit);
+        if (os != nullptr)
+            os->exceptions(std::ios::failbit | std::ios::badbit);
         if (input->is64Bit)
             elfBinGen64->generate(fob);
         else
@@ -1863,10 +1916,12 @@ void AmdGPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>
     }
     catch(...)
     {
-        os->exceptions(oldExceptions);
+        if (os != nullptr)
+            os->exceptions(oldExceptions);
         throw;
     }
-    os->exceptions(oldExceptions);
+    if (os != nullptr)
+        os->exceptions(oldExceptions);
     assert(fob.getWritten() == binarySize);
 }
 
@@ -616,12 +616,16 @@ AmdMainBinaryBase::AmdMainBinaryBase(AmdMainType _type) : type(_type)
 AmdMainBinaryBase::~AmdMainBinaryBase()
 { }
 
+void AmdMainBinaryBase::initKernelInfo(size_t index) const
+{ }
+
 const KernelInfo& AmdMainBinaryBase::getKernelInfo(const char* name) const
 {
     KernelInfoMap::const_iterator it = binaryMapFind(
         kernelInfosMap.begin(), kernelInfosMap.end(), name);
     if (it == kernelInfosMap.end())
         throw BinException("Can't find kernel name");
+    prepareKernelInfo(it->second);
     return kernelInfos[it->second];
 }
 
@@ -1110,7 +1114,8 @@ struct CLRX_INTERNAL AmdGPU64Types: Elf64Types
 };
 
 AmdMainGPUBinaryBase::AmdMainGPUBinaryBase(AmdMainType type)
-        : AmdMainBinaryBase(type), metadatas(nullptr), globalDataSize(0), globalData(0)
+        : AmdMainBinaryBase(type), metadatas(nullptr), globalDataSize(0), globalData(0),
+          innerCreationFlags(0)
 { }
 
 template<typename Types>
@@ -1131,6 +1136,9 @@ void AmdMainGPUBinaryBase::initMainGPUBinary(typename Types::ElfBinary& mainElf)
     const bool doKernelHeaders = (creationFlags & AMDBIN_CREATE_KERNELHEADERS) != 0;
     const bool doKernelInfo = (creationFlags & AMDBIN_CREATE_KERNELINFO) != 0;
     const bool doInfoStrings = (creationFlags & AMDBIN_CREATE_INFOSTRINGS) != 0;
+    const bool lazy = (creationFlags & AMDBIN_CREATE_LAZY) != 0;
+    innerCreationFlags = (creationFlags >> AMDBIN_INNER_SHIFT) &
+                AMDBIN_INNER_INT_CREATE_ALL;
     size_t compileOptionsEnd = 0;
     uint16_t compileOptionShIndex = SHN_UNDEF;
     
@@ -1212,6 +1220,12 @@ void AmdMainGPUBinaryBase::initMainGPUBinary(typename Types::ElfBinary& mainElf)
         const typename Types::Shdr& textHdr = mainElf.getSectionHeader(textIndex);
         cxbyte* textContent = mainElf.getBinaryCode() + ULEV(textHdr.sh_offset);
         
+        if (lazy)
+        {
+            // inner binaries will be parsed at first access
+            lazyInnerBinaries.resize(choosenSyms.size());
+            innerBinaryOnceFlags.reset(new OnceFlag[choosenSyms.size()]);
+        }
         /* create table of innerBinaries */
         size_t ki = 0;
         for (auto it: choosenSyms)
@@ -1227,15 +1241,24 @@ void AmdMainGPUBinaryBase::initMainGPUBinary(typename Types::ElfBinary& mainElf)
             if (usumGt(symvalue, symsize, ULEV(textHdr.sh_size)))
                 throw BinException("Inner binary offset+size out of range!");
             
-            innerBinaries[ki++] = AmdInnerGPUBinary32(CString(symName+9, len-16),
-                symsize, textContent+symvalue,
-                (creationFlags >> AMDBIN_INNER_SHIFT) & AMDBIN_INNER_INT_CREATE_ALL);
+            if (lazy)
+            {
+                LazyInnerBinary& entry = lazyInnerBinaries[ki++];
+                entry.kernelName.assign(symName+9, len-16);
+                entry.size = symsize;
+                entry.data = textContent+symvalue;
+            }
+            else
+                innerBinaries[ki++] = AmdInnerGPUBinary32(CString(symName+9, len-16),
+                    symsize, textContent+symvalue, innerCreationFlags);
         }
         if ((creationFlags & AMDBIN_CREATE_INNERBINMAP) != 0)
         {
             innerBinaryMap.resize(innerBinaries.size());
             for (size_t i = 0; i < innerBinaries.size(); i++)
-                innerBinaryMap[i] = std::make_pair(innerBinaries[i].getKernelName(), i);
+                innerBinaryMap[i] = std::make_pair(lazy ?
+                        lazyInnerBinaries[i].kernelName :
+                        innerBinaries[i].getKernelName(), i);
             mapSort(innerBinaryMap.begin(), innerBinaryMap.end());
         }
     }
@@ -1244,6 +1267,12 @@ void AmdMainGPUBinaryBase::initMainGPUBinary(typename Types::ElfBinary& mainElf)
     {
         kernelInfos.resize(choosenSymsMetadata.size());
         metadatas.reset(new AmdGPUKernelMetadata[kernelInfos.size()]);
+        if (lazy)
+        {
+            // kernel informations will be parsed at first access
+            lazyMetadataSymNames.resize(kernelInfos.size());
+            kernelInfoOnceFlags.reset(new OnceFlag[kernelInfos.size()]);
+        }
         
         typename Types::Size ki = 0;
         for (typename Types::Size it: choosenSymsMetadata)
@@ -1265,10 +1294,17 @@ void AmdMainGPUBinaryBase::initMainGPUBinary(typename Types::ElfBinary& mainElf)
             if (usumGt(symvalue, symsize, ULEV(rodataHdr.sh_size)))
                 throw BinException("Metadata offset+size out of range");
             
-            // parse AMDGPU kernel metadata
-            parseAmdGpuKernelMetadata(symName, symsize,
-                  reinterpret_cast<const char*>(secContent + symvalue),
-                  kernelInfos[ki]);
+            if (lazy)
+            {
+                // only kernel name (required by kernel info map)
+                kernelInfos[ki].kernelName.assign(symName+9, ::strlen(symName)-18);
+                lazyMetadataSymNames[ki] = symName;
+            }
+            else
+                // parse AMDGPU kernel metadata
+                parseAmdGpuKernelMetadata(symName, symsize,
+                      reinterpret_cast<const char*>(secContent + symvalue),
+                      kernelInfos[ki]);
             metadatas[ki].size = symsize;
             metadatas[ki].data = reinterpret_cast<char*>(secContent + symvalue);
             ki++;
@@ -1324,12 +1360,27 @@ void AmdMainGPUBinaryBase::initMainGPUBinary(typename Types::ElfBinary& mainElf)
     }
 }
 
+void AmdMainGPUBinaryBase::initKernelInfo(size_t index) const
+{
+    // parse AMDGPU kernel metadata
+    parseAmdGpuKernelMetadata(lazyMetadataSymNames[index], metadatas[index].size,
+                  metadatas[index].data, kernelInfos[index]);
+}
+
+void AmdMainGPUBinaryBase::initInnerBinary(size_t index) const
+{
+    const LazyInnerBinary& entry = lazyInnerBinaries[index];
+    innerBinaries[index] = AmdInnerGPUBinary32(entry.kernelName, entry.size,
+                entry.data, innerCreationFlags);
+}
+
 const AmdInnerGPUBinary32& AmdMainGPUBinaryBase::getInnerBinary(const char* name) const
 {
     InnerBinaryMap::const_iterator it = binaryMapFind(innerBinaryMap.begin(),
                   innerBinaryMap.end(), name);
     if (it == innerBinaryMap.end())
         throw BinException("Can't find inner binary");
+    prepareInnerBinary(it->second);
     return innerBinaries[it->second];
 }
 
@@ -52,11 +52,12 @@ void AmdCL2Input::addEmptyKernel(const char* kernelName)
     kernels.push_back(std::move(kernel));
 }
 
-AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator() : manageable(false), input(nullptr)
+AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator() : manageable(false), input(nullptr),
+        mergeStrings(false)
 { }
 
 AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(const AmdCL2Input* amdInput)
-        : manageable(false), input(amdInput)
+        : manageable(false), input(amdInput), mergeStrings(false)
 { }
 
 AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(bool _64bitMode,
@@ -64,7 +65,7 @@ AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(bool _64bitMode,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        size_t rwDataSize, const cxbyte* rwData, 
        const std::vector<AmdCL2KernelInput>& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), mergeStrings(false)
 {
     std::unique_ptr<AmdCL2Input> _input(new AmdCL2Input{});
     _input->is64Bit = _64bitMode;
@@ -90,7 +91,7 @@ AmdCL2GPUBinGenerator::AmdCL2GPUBinGenerator(bool _64bitMode,
        uint32_t driverVersion, size_t globalDataSize, const cxbyte* globalData,
        size_t rwDataSize, const cxbyte* rwData,
        std::vector<AmdCL2KernelInput>&& kernelInputs)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), mergeStrings(false)
 {
     std::unique_ptr<AmdCL2Input> _input(new AmdCL2Input{});
     _input->is64Bit = _64bitMode;
@@ -2521,6 +2522,10 @@ void AmdCL2GPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<ch
     else
         elfBinGen32.reset(new ElfBinaryGen32({ 0, 0, ELFOSABI_SYSV, 0, ET_EXEC, 0xaf5a,
                 EV_CURRENT, UINT_MAX, 0, deviceCodeTable[cxuint(input->deviceType)] }));
+    if (input->is64Bit)
+        elfBinGen64->setMergeStrings(mergeStrings);
+    else
+        elfBinGen32->setMergeStrings(mergeStrings);
     
     CString aclVersion = input->aclVersion;
     if (aclVersion.empty())
@@ -2643,6 +2648,7 @@ void AmdCL2GPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<ch
                         UINT_MAX, 0, 0 }, (input->driverVersion>=200406), true, true, 
                         /* globaldata sectionid: for 200406 - 4, for older - 1 */
                         (!is16_3Ver) ? 1 : 4));
+        innerBinGen->setMergeStrings(mergeStrings);
         innerBinGen->addRegion(ElfRegion64::programHeaderTable());
         
         if (is16_3Ver)
@@ -2884,29 +2890,35 @@ void AmdCL2GPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<ch
     /****
      * prepare for write binary to output
      ****/
-    std::unique_ptr<std::ostream> outStreamHolder;
+    std::unique_ptr<FastOutputBuffer> fobHolder;
     std::ostream* os = nullptr;
     if (aPtr != nullptr)
     {
+        // write directly to output array
         aPtr->resize(binarySize);
-        outStreamHolder.reset(
-            new ArrayOStream(binarySize, reinterpret_cast<char*>(aPtr->data())));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize,
+                    reinterpret_cast<char*>(aPtr->data())));
     }
     else if (vPtr != nullptr)
     {
+        // write directly to output vector
         vPtr->resize(binarySize);
-        outStreamHolder.reset(new VectorOStream(*vPtr));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize, vPtr->data()));
     }
-    else // from argument
+    else
+    {
+        // from argument
         os = osPtr;
+        fobHolder.reset(new FastOutputBuffer(256, *os));
+    }
     
-    const std::ios::iostate oldExceptions = os->exceptions();
-    FastOutputBuffer fob(256, *os);
+    const std::ios::iostate oldExceptions = (os != nullptr) ?
+                os->exceptions() : std::ios::goodbit;
+    FastOutputBuffer& fob = *fobHolder;
     try
     {
-        os->exceptions(std::ios::failbit | std::ios::badbit);
+        if (os != nullptr)
+            os->exceptions(std::ios::failbit | std::ios::badbit);
         if (input->is64Bit)
             elfBinGen64->generate(fob);
         else
@@ -2914,10 +2926,12 @@ void AmdCL2GPUBinGenerator::generateInternal(std::ostream* osPtr, std::vector<ch
     }
     catch(...)
     {
-        os->exceptions(oldExceptions);
+        if (os != nullptr)
+            os->exceptions(oldExceptions);
         throw;
     }
-    os->exceptions(oldExceptions);
+    if (os != nullptr)
+        os->exceptions(oldExceptions);
     assert(fob.getWritten() == binarySize);
 }
 
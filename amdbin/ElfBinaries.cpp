@@ -60,6 +60,30 @@ static size_t unfinishedRegionOfStringTable(const cxbyte* table, size_t size)
     return (table[k]==0)?k+1:k;
 }
 
+// SysV ELF hash function
+static uint32_t calculateSysVHash(const char* name)
+{
+    uint32_t h = 0, g;
+    const cxbyte* p = reinterpret_cast<const cxbyte*>(name);
+    while(*p!=0)
+    {
+        h = (h<<4) + *p++;
+        g = h & 0xf0000000U;
+        if (g) h ^= g>>24;
+        h &= ~g;
+    }
+    return h;
+}
+
+// GNU ELF hash function
+static inline uint32_t calculateGnuHash(const char* name)
+{
+    uint32_t h = 5381;
+    for (const cxbyte* p = reinterpret_cast<const cxbyte*>(name); *p != 0; p++)
+        h = (h<<5) + h + *p;
+    return h;
+}
+
 /* elf32 types */
 
 const cxbyte CLRX::Elf32Types::ELFCLASS = ELFCLASS32;
@@ -78,7 +102,8 @@ template<typename Types>
 ElfBinaryTemplate<Types>::ElfBinaryTemplate() : binaryCodeSize(0), binaryCode(nullptr),
         sectionStringTable(nullptr), symbolStringTable(nullptr),
         symbolTable(nullptr), dynSymStringTable(nullptr), dynSymTable(nullptr),
-        noteTable(nullptr), symbolsNum(0), dynSymbolsNum(0),
+        noteTable(nullptr), dynamicTable(nullptr), dynSymHashTable(nullptr),
+        dynSymGnuHashTable(nullptr), symbolsNum(0), dynSymbolsNum(0),
         noteTableSize(0), dynamicsNum(0), symbolEntSize(0), dynSymEntSize(0),
         dynamicEntSize(0)
 { }
@@ -93,7 +118,8 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
         binaryCodeSize(_binaryCodeSize), binaryCode(_binaryCode),
         sectionStringTable(nullptr), symbolStringTable(nullptr),
         symbolTable(nullptr), dynSymStringTable(nullptr), dynSymTable(nullptr),
-        noteTable(nullptr), symbolsNum(0), dynSymbolsNum(0),
+        noteTable(nullptr), dynamicTable(nullptr), dynSymHashTable(nullptr),
+        dynSymGnuHashTable(nullptr), symbolsNum(0), dynSymbolsNum(0),
         noteTableSize(0), dynamicsNum(0), symbolEntSize(0), dynSymEntSize(0),
         dynamicEntSize(0)     
 {
@@ -158,10 +184,10 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
         const typename Types::Shdr* dynSymTableHdr = nullptr;
         const typename Types::Shdr* noteTableHdr = nullptr;
         const typename Types::Shdr* dynamicTableHdr = nullptr;
+        const typename Types::Shdr* hashTableHdr = nullptr;
+        const typename Types::Shdr* gnuHashTableHdr = nullptr;
         
         cxuint shnum = ULEV(ehdr->e_shnum);
-        if ((creationFlags & ELF_CREATE_SECTIONMAP) != 0)
-            sectionIndexMap.resize(shnum);
         for (cxuint i = 0; i < shnum; i++)
         {
             const typename Types::Shdr& shdr = getSectionHeader(i);
@@ -181,11 +207,6 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
             if (sh_nameindx >= unfinishedShstrPos)
                 throw BinException("Unfinished section name!");
             
-            const char* shname =
-                reinterpret_cast<const char*>(sectionStringTable + sh_nameindx);
-            
-            if ((creationFlags & ELF_CREATE_SECTIONMAP) != 0)
-                sectionIndexMap[i] = std::make_pair(shname, i);
             // set symbol table and dynamic symbol table pointers
             if (ULEV(shdr.sh_type) == SHT_SYMTAB)
                 symTableHdr = &shdr;
@@ -195,10 +216,11 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
                 noteTableHdr = &shdr;
             if (ULEV(shdr.sh_type) == SHT_DYNAMIC)
                 dynamicTableHdr = &shdr;
+            if (ULEV(shdr.sh_type) == SHT_HASH)
+                hashTableHdr = &shdr;
+            if (ULEV(shdr.sh_type) == SHT_GNU_HASH)
+                gnuHashTableHdr = &shdr;
         }
-        // sort section's map (really is array of sections)
-        if ((creationFlags & ELF_CREATE_SECTIONMAP) != 0)
-            mapSort(sectionIndexMap.begin(), sectionIndexMap.end(), CStringLess());
         
         if (symTableHdr != nullptr)
         {
@@ -217,8 +239,6 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
             const size_t unfinishedSymstrPos = unfinishedRegionOfStringTable(
                     symbolStringTable, ULEV(symstrShdr.sh_size));
             symbolsNum = ULEV(symTableHdr->sh_size)/ULEV(symTableHdr->sh_entsize);
-            if ((creationFlags & ELF_CREATE_SYMBOLMAP) != 0)
-                symbolIndexMap.resize(symbolsNum);
             
             for (typename Types::Size i = 0; i < symbolsNum; i++)
             {
@@ -230,16 +250,7 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
                 // check whether name is finished in string section content
                 if (symnameindx >= unfinishedSymstrPos)
                     throw BinException("Unfinished symbol name!");
-                
-                const char* symname =
-                    reinterpret_cast<const char*>(symbolStringTable + symnameindx);
-                // add to symbol map
-                if ((creationFlags & ELF_CREATE_SYMBOLMAP) != 0)
-                    symbolIndexMap[i] = std::make_pair(symname, i);
             }
-            // sort symbol's map (really is array of symbols)
-            if ((creationFlags & ELF_CREATE_SYMBOLMAP) != 0)
-                mapSort(symbolIndexMap.begin(), symbolIndexMap.end(), CStringLess());
         }
         if (dynSymTableHdr != nullptr)
         {
@@ -260,9 +271,6 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
             const size_t unfinishedSymstrPos = unfinishedRegionOfStringTable(
                     dynSymStringTable, ULEV(dynSymstrShdr.sh_size));
             
-            if ((creationFlags & ELF_CREATE_DYNSYMMAP) != 0)
-                dynSymIndexMap.resize(dynSymbolsNum);
-            
             for (typename Types::Size i = 0; i < dynSymbolsNum; i++)
             {
                 /* verify symbol names */
@@ -273,16 +281,42 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
                 // check whether name is finished in string section content
                 if (symnameindx >= unfinishedSymstrPos)
                     throw BinException("Unfinished dynsymbol name!");
-                
-                const char* symname =
-                    reinterpret_cast<const char*>(dynSymStringTable + symnameindx);
-                // add to symbol map
-                if ((creationFlags & ELF_CREATE_DYNSYMMAP) != 0)
-                    dynSymIndexMap[i] = std::make_pair(symname, i);
             }
-            // sort dynamic symbol's map (really is array of dynamic symbols)
-            if ((creationFlags & ELF_CREATE_DYNSYMMAP) != 0)
-                mapSort(dynSymIndexMap.begin(), dynSymIndexMap.end(), CStringLess());
+            
+            /* hash tables for dynamic symbols
+             * (tables with wrong sizes are ignored, lookup falls back to map) */
+            if (hashTableHdr != nullptr &&
+                &getSectionHeader(ULEV(hashTableHdr->sh_link)) == dynSymTableHdr)
+            {
+                const cxbyte* table = binaryCode + ULEV(hashTableHdr->sh_offset);
+                const uint64_t size = ULEV(hashTableHdr->sh_size);
+                if (size >= 8)
+                {
+                    const uint32_t* words = reinterpret_cast<const uint32_t*>(table);
+                    const uint64_t bucketsNum = ULEV(words[0]);
+                    const uint64_t chainsNum = ULEV(words[1]);
+                    if (bucketsNum != 0 && chainsNum == dynSymbolsNum &&
+                        8 + 4*(bucketsNum + chainsNum) <= size)
+                        dynSymHashTable = binaryCode + ULEV(hashTableHdr->sh_offset);
+                }
+            }
+            if (gnuHashTableHdr != nullptr &&
+                &getSectionHeader(ULEV(gnuHashTableHdr->sh_link)) == dynSymTableHdr)
+            {
+                const cxbyte* table = binaryCode + ULEV(gnuHashTableHdr->sh_offset);
+                const uint64_t size = ULEV(gnuHashTableHdr->sh_size);
+                if (size >= 16)
+                {
+                    const uint32_t* words = reinterpret_cast<const uint32_t*>(table);
+                    const uint64_t bucketsNum = ULEV(words[0]);
+                    const uint64_t symOffset = ULEV(words[1]);
+                    const uint64_t bloomSize = ULEV(words[2]);
+                    if (bucketsNum != 0 && bloomSize != 0 && symOffset <= dynSymbolsNum &&
+                        16 + bloomSize*sizeof(typename Types::Word) +
+                            4*(bucketsNum + dynSymbolsNum - symOffset) <= size)
+                        dynSymGnuHashTable = binaryCode + ULEV(gnuHashTableHdr->sh_offset);
+                }
+            }
         }
         if (noteTableHdr != nullptr)
         {
@@ -304,15 +338,61 @@ ElfBinaryTemplate<Types>::ElfBinaryTemplate(size_t _binaryCodeSize, cxbyte* _bin
     }
 }
 
+/* index maps are created at first lookup, if creation flag is set.
+ * if name is repeated then map holds first index */
+
+template<typename Types>
+const typename ElfBinaryTemplate<Types>::SectionIndexMap&
+ElfBinaryTemplate<Types>::getSectionIndexMap() const
+{
+    return sectionIndexMap.get([this](SectionIndexMap& map)
+    {
+        if (!hasSectionMap() || sectionStringTable == nullptr)
+            return;
+        const cxuint shnum = getSectionHeadersNum();
+        map.reserve(shnum);
+        for (cxuint i = 0; i < shnum; i++)
+            map.insert(std::make_pair(getSectionName(i), i));
+    });
+}
+
+template<typename Types>
+const typename ElfBinaryTemplate<Types>::SymbolIndexMap&
+ElfBinaryTemplate<Types>::getSymbolIndexMap() const
+{
+    return symbolIndexMap.get([this](SymbolIndexMap& map)
+    {
+        if (!hasSymbolMap())
+            return;
+        map.reserve(symbolsNum);
+        for (typename Types::Size i = 0; i < symbolsNum; i++)
+            map.insert(std::make_pair(getSymbolName(i), i));
+    });
+}
+
+template<typename Types>
+const typename ElfBinaryTemplate<Types>::SymbolIndexMap&
+ElfBinaryTemplate<Types>::getDynSymbolIndexMap() const
+{
+    return dynSymIndexMap.get([this](SymbolIndexMap& map)
+    {
+        if (!hasDynSymbolMap())
+            return;
+        map.reserve(dynSymbolsNum);
+        for (typename Types::Size i = 0; i < dynSymbolsNum; i++)
+            map.insert(std::make_pair(getDynSymbolName(i), i));
+    });
+}
+
 template<typename Types>
 uint16_t ElfBinaryTemplate<Types>::getSectionIndex(const char* name) const
 {
     if (hasSectionMap())
     {
-        // find in section map (sorted array)
-        SectionIndexMap::const_iterator it = binaryMapFind(
-                    sectionIndexMap.begin(), sectionIndexMap.end(), name, CStringLess());
-        if (it == sectionIndexMap.end())
+        // find in section map (hash map)
+        const SectionIndexMap& map = getSectionIndexMap();
+        SectionIndexMap::const_iterator it = map.find(name);
+        if (it == map.end())
             throw BinException(std::string("Can't find Elf")+Types::bitName+" Section");
         return it->second;
     }
@@ -331,19 +411,97 @@ uint16_t ElfBinaryTemplate<Types>::getSectionIndex(const char* name) const
 template<typename Types>
 typename Types::Size ElfBinaryTemplate<Types>::getSymbolIndex(const char* name) const
 {
-    SymbolIndexMap::const_iterator it = binaryMapFind(
-                    symbolIndexMap.begin(), symbolIndexMap.end(), name, CStringLess());
-    if (it == symbolIndexMap.end())
+    const SymbolIndexMap& map = getSymbolIndexMap();
+    SymbolIndexMap::const_iterator it = map.find(name);
+    if (it == map.end())
         throw BinException(std::string("Can't find Elf")+Types::bitName+" Symbol");
     return it->second;
 }
 
+template<typename Types>
+bool ElfBinaryTemplate<Types>::findDynSymbolIndex(const char* name,
+                typename Types::Size& index) const
+{
+    if (dynSymGnuHashTable != nullptr)
+    {
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(dynSymGnuHashTable);
+        const uint32_t bucketsNum = ULEV(words[0]);
+        const uint32_t symOffset = ULEV(words[1]);
+        const uint32_t bloomSize = ULEV(words[2]);
+        const uint32_t bloomShift = ULEV(words[3]);
+        const typename Types::Word* bloom =
+                reinterpret_cast<const typename Types::Word*>(words + 4);
+        const uint32_t* buckets = reinterpret_cast<const uint32_t*>(bloom + bloomSize);
+        const uint32_t* chains = buckets + bucketsNum;
+        const cxuint wordBits = Types::bitness;
+        
+        const uint32_t h = calculateGnuHash(name);
+        // check bloom filter
+        const typename Types::Word bloomWord = ULEV(bloom[(h / wordBits) % bloomSize]);
+        if (((bloomWord >> (h % wordBits)) & (bloomWord >> ((h >> bloomShift) % wordBits)) &
+                1) == 0)
+            return false;
+        typename Types::Size symIndex = ULEV(buckets[h % bucketsNum]);
+        if (symIndex < symOffset)
+            return false;
+        for (; symIndex < dynSymbolsNum; symIndex++)
+        {
+            const uint32_t h2 = ULEV(chains[symIndex - symOffset]);
+            if ((h|1) == (h2|1) && ::strcmp(getDynSymbolName(symIndex), name) == 0)
+            {
+                index = symIndex;
+                return true;
+            }
+            if ((h2 & 1) != 0)
+                break; // end of chain
+        }
+        return false;
+    }
+    if (dynSymHashTable != nullptr)
+    {
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(dynSymHashTable);
+        const uint32_t bucketsNum = ULEV(words[0]);
+        const uint32_t chainsNum = ULEV(words[1]);
+        const uint32_t* buckets = words + 2;
+        const uint32_t* chains = buckets + bucketsNum;
+        
+        uint32_t symIndex = ULEV(buckets[calculateSysVHash(name) % bucketsNum]);
+        // limit steps to chains number (protection against cycles)
+        for (uint32_t k = 0; symIndex != STN_UNDEF && symIndex < chainsNum &&
+                    k < chainsNum; k++)
+        {
+            if (::strcmp(getDynSymbolName(symIndex), name) == 0)
+            {
+                index = symIndex;
+                return true;
+            }
+            symIndex = ULEV(chains[symIndex]);
+        }
+        return false;
+    }
+    // no hash table, use dynamic symbol map
+    const SymbolIndexMap& map = getDynSymbolIndexMap();
+    SymbolIndexMap::const_iterator it = map.find(name);
+    if (it == map.end())
+        return false;
+    index = it->second;
+    return true;
+}
+
 template<typename Types>
 typename Types::Size ElfBinaryTemplate<Types>::getDynSymbolIndex(const char* name) const
 {
-    SymbolIndexMap::const_iterator it = binaryMapFind(
-                    dynSymIndexMap.begin(), dynSymIndexMap.end(), name, CStringLess());
-    if (it == dynSymIndexMap.end())
+    typename Types::Size index;
+    if (hasDynSymbolHashTable())
+    {
+        // find through hash table
+        if (!findDynSymbolIndex(name, index))
+            throw BinException(std::string("Can't find Elf")+Types::bitName+" DynSymbol");
+        return index;
+    }
+    const SymbolIndexMap& map = getDynSymbolIndexMap();
+    SymbolIndexMap::const_iterator it = map.find(name);
+    if (it == map.end())
         throw BinException(std::string("Can't find Elf")+Types::bitName+" DynSymbol");
     return it->second;
 }
@@ -407,26 +565,36 @@ static std::unique_ptr<uint32_t[]> calculateHashValuesForSymbols(bool addNullSym
     if (addNullSymbol)
         hashCodes[0] = 0;
     for (size_t i = 0; i < symbols.size(); i++)
+        hashCodes[i+addNullSymbol] = calculateSysVHash(symbols[i].name);
+    return hashCodes;
+}
+
+// buckets numbers (primes) used by GNU linker
+static const uint32_t gnuHashBucketsTable[] =
+{
+    1, 3, 17, 37, 67, 97, 131, 197, 263, 521, 1031, 2053, 4099, 8209,
+    16411, 32771, 65537, 131101, 262147
+};
+
+/// return bucket number as in GNU linker (for GNU and SysV hash tables)
+static uint32_t getLinkerHashBucketsNum(uint32_t hashNum)
+{
+    uint32_t bucketsNum = 1;
+    for (size_t i = 0; i < sizeof(gnuHashBucketsTable)/sizeof(uint32_t); i++)
     {
-        // main routine of hash
-        uint32_t h = 0, g;
-        const cxbyte* name = reinterpret_cast<const cxbyte*>(symbols[i].name);
-        while(*name!=0)
-        {
-            h = (h<<4) + *name++;
-            g = h & 0xf0000000U;
-            if (g) h ^= g>>24;
-            h &= ~g;
-        }
-        hashCodes[i+addNullSymbol] = h;
+        if (hashNum < gnuHashBucketsTable[i])
+            break;
+        bucketsNum = gnuHashBucketsTable[i];
     }
-    return hashCodes;
+    return bucketsNum;
 }
 
 /// return bucket number
 static uint32_t optimizeHashBucketsNum(uint32_t hashNum, bool skipFirst,
                            const uint32_t* hashCodes)
 {
+    if (hashNum <= uint32_t(skipFirst))
+        return 1; // empty hash table
     uint32_t bestBucketNum = 0;
     uint64_t bestValue = UINT64_MAX;
     uint32_t firstStep = std::max(uint32_t(hashNum>>2), 1U);
@@ -455,11 +623,198 @@ static uint32_t optimizeHashBucketsNum(uint32_t hashNum, bool skipFirst,
     return bestBucketNum;
 }
 
+/* GNU hash table */
+
+template<typename Types>
+void ElfBinaryGenTemplate<Types>::prepareGnuHash()
+{
+    /* unhashed symbols (local and undefined) must be before hashed symbols,
+     * hashed symbols must be sorted by bucket */
+    const size_t symsNum = dynSymbols.size();
+    std::vector<size_t> order;
+    order.reserve(symsNum);
+    for (size_t i = 0; i < symsNum; i++)
+        if (ELF32_ST_BIND(dynSymbols[i].info)==STB_LOCAL ||
+            dynSymbols[i].sectionIndex==SHN_UNDEF)
+            order.push_back(i);
+    const size_t unhashedNum = order.size();
+    const uint32_t hashedNum = symsNum - unhashedNum;
+    gnuSymOffset = unhashedNum + addNullDynSym;
+    
+    gnuBucketsNum = getLinkerHashBucketsNum(hashedNum);
+    
+    // bloom filter size (in words) and shift as in GNU linker
+    cxuint maskBitsLog2 = 0;
+    while (maskBitsLog2 < 32 && (1U<<maskBitsLog2) < hashedNum)
+        maskBitsLog2++;
+    maskBitsLog2++;
+    if (maskBitsLog2 < 3)
+        maskBitsLog2 = 5;
+    else if (((1U << (maskBitsLog2-2)) & hashedNum) != 0)
+        maskBitsLog2 += 3;
+    else
+        maskBitsLog2 += 2;
+    const cxuint wordBitsLog2 = (Types::bitness==64) ? 6 : 5;
+    maskBitsLog2 = std::max(maskBitsLog2, wordBitsLog2);
+    gnuBloomShift = maskBitsLog2;
+    gnuBloomSize = 1U << (maskBitsLog2 - wordBitsLog2);
+    
+    std::unique_ptr<uint32_t[]> codes(new uint32_t[symsNum]);
+    for (size_t i = 0; i < symsNum; i++)
+        codes[i] = calculateGnuHash(dynSymbols[i].name != nullptr ?
+                    dynSymbols[i].name : "");
+    for (size_t i = 0; i < symsNum; i++)
+        if (ELF32_ST_BIND(dynSymbols[i].info)!=STB_LOCAL &&
+            dynSymbols[i].sectionIndex!=SHN_UNDEF)
+            order.push_back(i);
+    const uint32_t bucketsNum = gnuBucketsNum;
+    std::stable_sort(order.begin() + unhashedNum, order.end(),
+            [&codes, bucketsNum](size_t a, size_t b)
+            { return codes[a] % bucketsNum < codes[b] % bucketsNum; });
+    
+    sortedDynSymbols.resize(symsNum);
+    dynSymOutIndices.resize(symsNum);
+    gnuHashCodes.reset(new uint32_t[symsNum]);
+    for (size_t i = 0; i < symsNum; i++)
+    {
+        sortedDynSymbols[i] = dynSymbols[order[i]];
+        dynSymOutIndices[order[i]] = i + addNullDynSym;
+        gnuHashCodes[i] = codes[order[i]];
+    }
+}
+
+// create GNU hash table: header, bloom filter, buckets and chains
+template<typename Types>
+static void createGnuHashTable(uint32_t bucketsNum, uint32_t symOffset,
+            uint32_t bloomSize, uint32_t bloomShift, size_t symsNum, bool addNullSym,
+            const uint32_t* hashCodes, FastOutputBuffer& fob)
+{
+    typedef typename Types::Word Word;
+    const cxuint wordBits = Types::bitness;
+    const uint32_t header[4] = { LEV(bucketsNum), LEV(symOffset),
+                LEV(bloomSize), LEV(bloomShift) };
+    fob.writeArray(4, header);
+    
+    // hash codes of hashed symbols
+    const uint32_t* hcodes = hashCodes + symOffset - addNullSym;
+    const size_t hashedNum = symsNum + addNullSym - symOffset;
+    Array<Word> bloom(bloomSize);
+    std::fill(bloom.begin(), bloom.end(), Word(0));
+    for (size_t i = 0; i < hashedNum; i++)
+    {
+        const uint32_t h = hcodes[i];
+        bloom[(h / wordBits) % bloomSize] |= (Word(1) << (h % wordBits)) |
+                (Word(1) << ((h >> bloomShift) % wordBits));
+    }
+    for (Word& w: bloom)
+        SLEV(w, w);
+    fob.writeArray(bloomSize, bloom.data());
+    
+    Array<uint32_t> buckets(bucketsNum);
+    Array<uint32_t> chains(hashedNum);
+    std::fill(buckets.begin(), buckets.end(), 0U);
+    for (size_t i = 0; i < hashedNum; i++)
+    {
+        const uint32_t bucket = hcodes[i] % bucketsNum;
+        // symbols are sorted by bucket, first symbol in bucket starts chain
+        if (i == 0 || hcodes[i-1] % bucketsNum != bucket)
+            buckets[bucket] = symOffset + i;
+        // last symbol in chain has set lowest bit
+        const bool lastInChain = (i+1 == hashedNum ||
+                hcodes[i+1] % bucketsNum != bucket);
+        chains[i] = (hcodes[i] & ~1U) | uint32_t(lastInChain);
+    }
+    for (uint32_t& v: buckets)
+        SLEV(v, v);
+    for (uint32_t& v: chains)
+        SLEV(v, v);
+    fob.writeArray(bucketsNum, buckets.data());
+    fob.writeArray(hashedNum, chains.data());
+}
+
+// compare reversed strings (true if a is greater than b)
+static inline bool reversedStrGreater(const char* a, size_t alen,
+                    const char* b, size_t blen)
+{
+    while (alen != 0 && blen != 0)
+    {
+        const cxbyte ca = a[--alen];
+        const cxbyte cb = b[--blen];
+        if (ca != cb)
+            return ca > cb;
+    }
+    return alen > blen;
+}
+
+void ElfStrTabBuilder::build(size_t namesNum, const char* const* names, bool addNull)
+{
+    struct NameEntry
+    {
+        const char* name;
+        size_t length;
+        size_t index;
+    };
+    std::vector<NameEntry> entries;
+    for (size_t i = 0; i < namesNum; i++)
+        if (names[i] != nullptr && names[i][0] != 0)
+            entries.push_back({ names[i], ::strlen(names[i]), i });
+    /* sort by reversed names in descending order: names that are suffixes of
+     * other names directly follow these names */
+    std::sort(entries.begin(), entries.end(), [](const NameEntry& a, const NameEntry& b)
+        { return reversedStrGreater(a.name, a.length, b.name, b.length); });
+    
+    offsets.resize(namesNum);
+    size_t size = addNull;
+    std::vector<const NameEntry*> putEntries;
+    const NameEntry* prev = nullptr;
+    size_t prevOffset = 0;
+    for (const NameEntry& entry: entries)
+    {
+        if (prev != nullptr && entry.length <= prev->length &&
+            ::memcmp(prev->name + prev->length - entry.length, entry.name,
+                     entry.length) == 0)
+        {
+            // suffix of previous name (or same name)
+            offsets[entry.index] = prevOffset + prev->length - entry.length;
+            continue;
+        }
+        prev = &entry;
+        prevOffset = offsets[entry.index] = size;
+        putEntries.push_back(&entry);
+        size += entry.length+1;
+    }
+    
+    content.resize(size);
+    if (addNull)
+        content[0] = 0;
+    for (const NameEntry* entry: putEntries)
+        ::memcpy(content.data() + offsets[entry->index], entry->name, entry->length+1);
+    
+    // empty names points to null character
+    const uint32_t nullOffset = (addNull || putEntries.empty()) ? 0 :
+            putEntries[0]->length;
+    for (size_t i = 0; i < namesNum; i++)
+        if (names[i] == nullptr || names[i][0] == 0)
+            offsets[i] = nullOffset;
+}
+
+template<typename Types>
+static void buildSymbolStrTab(ElfStrTabBuilder& builder,
+        const std::vector<ElfSymbolTemplate<Types> >& symbols, bool addNull)
+{
+    std::unique_ptr<const char*[]> names(new const char*[symbols.size()]);
+    for (size_t i = 0; i < symbols.size(); i++)
+        names[i] = symbols[i].name;
+    builder.build(symbols.size(), names.get(), addNull);
+}
+
 template<typename Types>
 ElfBinaryGenTemplate<Types>::ElfBinaryGenTemplate()
         : sizeComputed(false), addNullSym(true), addNullDynSym(true), addNullSection(true),
-          addrStartRegion(0), shStrTab(0), strTab(0), dynStr(0), shdrTabRegion(0),
-          phdrTabRegion(0), bucketsNum(0), isHashDynSym(false)
+          mergeStrings(false), addrStartRegion(0), shStrTab(0), strTab(0), dynStr(0),
+          shdrTabRegion(0), phdrTabRegion(0), bucketsNum(0), isHashDynSym(false),
+          hasGnuHash(false), gnuBucketsNum(0), gnuSymOffset(0), gnuBloomSize(0),
+          gnuBloomShift(0)
 { }
 
 template<typename Types>
@@ -467,9 +822,11 @@ ElfBinaryGenTemplate<Types>::ElfBinaryGenTemplate(const ElfHeaderTemplate<Types>
             bool _addNullSym, bool _addNullDynSym, bool _addNullSection,
             cxuint addrCountingFromRegion)
         : sizeComputed(false), addNullSym(_addNullSym), addNullDynSym(_addNullDynSym),
-          addNullSection(_addNullSection),  addrStartRegion(addrCountingFromRegion),
+          addNullSection(_addNullSection), mergeStrings(false),
+          addrStartRegion(addrCountingFromRegion),
           shStrTab(0), strTab(0), dynStr(0), shdrTabRegion(0), phdrTabRegion(0),
-          header(_header), bucketsNum(0), isHashDynSym(false)
+          header(_header), bucketsNum(0), isHashDynSym(false), hasGnuHash(false),
+          gnuBucketsNum(0), gnuSymOffset(0), gnuBloomSize(0), gnuBloomShift(0)
 { }
 
 template<typename Types>
@@ -515,12 +872,15 @@ void ElfBinaryGenTemplate<Types>::computeSize()
     size = sizeof(typename Types::Ehdr);
     sectionsNum = addNullSection; // if add null section
     cxuint hashSymSectionIdx = UINT_MAX;
+    cxuint gnuHashSymSectionIdx = UINT_MAX;
     bool haveDynamic = false;
     for (const auto& region: regions)
         if (region.type == ElfRegionType::SECTION)
         {
             if (region.section.type==SHT_HASH)
                 hashSymSectionIdx = region.section.link;
+            else if (region.section.type==SHT_GNU_HASH)
+                gnuHashSymSectionIdx = region.section.link;
             else if (region.section.type==SHT_DYNAMIC)
                 haveDynamic = true;
             sectionsNum++;
@@ -558,6 +918,27 @@ void ElfBinaryGenTemplate<Types>::computeSize()
             throw BinGenException("Wrong Hash Sym is not detected!");
     }
     
+    hasGnuHash = false;
+    if (gnuHashSymSectionIdx!=UINT_MAX)
+    {
+        // GNU hash table can be only for dynamic symbols
+        sectionCount = addNullSection;
+        for (const auto& region: regions)
+            if (region.type == ElfRegionType::SECTION)
+            {
+                if (gnuHashSymSectionIdx==sectionCount)
+                {
+                    if (region.section.type!=SHT_DYNSYM)
+                        throw BinGenException("Wrong GNU Hash Sym section!");
+                    hasGnuHash = true;
+                }
+                sectionCount++;
+            }
+        if (!hasGnuHash)
+            throw BinGenException("GNU Hash Sym section is not detected!");
+        prepareGnuHash();
+    }
+    
     sectionRegions.reset(new cxuint[sectionsNum+1]);
     // first section can be null, if not null section provided this will be filed later
     sectionRegions[0] = UINT_MAX;
@@ -565,6 +946,7 @@ void ElfBinaryGenTemplate<Types>::computeSize()
     typename Types::Word address = (addrStartRegion==PHREGION_FILESTART) ? size : 0;
     
     std::unique_ptr<typename Types::Word[]> dynValTable;
+    typename Types::Word gnuHashAddress = 0;
     if (haveDynamic)
     {
         // prepare dynamic structures
@@ -658,6 +1040,10 @@ void ElfBinaryGenTemplate<Types>::computeSize()
                         dynValTable[DT_HASH] = resolveSectionAddress(header, region,
                                  regionAddresses[i]);
                         break;
+                    case SHT_GNU_HASH:
+                        gnuHashAddress = resolveSectionAddress(header, region,
+                                 regionAddresses[i]);
+                        break;
                     case SHT_RELA:
                         dynValTable[DT_RELA] = resolveSectionAddress(header, region,
                                  regionAddresses[i]);
@@ -687,15 +1073,22 @@ void ElfBinaryGenTemplate<Types>::computeSize()
                 else if (region.section.type == SHT_HASH)
                 {
                     const std::vector<ElfSymbolTemplate<Types> >& hashSymbols = 
-                        (isHashDynSym) ? dynSymbols : symbols;
+                        (isHashDynSym) ? getOutDynSymbols() : symbols;
                     bool addNullHashSym = (isHashDynSym) ? addNullDynSym : addNullSym;
                     // calculating hashes of symbols and optimizing hash buckets
-                    hashCodes = calculateHashValuesForSymbols(addNullDynSym, hashSymbols);
-                    bucketsNum = optimizeHashBucketsNum(hashSymbols.size()+addNullHashSym,
-                           addNullHashSym, hashCodes.get());
+                    hashCodes = calculateHashValuesForSymbols(addNullHashSym, hashSymbols);
+                    /* if GNU hash table is generated, then buckets number is
+                     * sized as in GNU linker, otherwise as in old generator */
+                    bucketsNum = hasGnuHash ? getLinkerHashBucketsNum(hashSymbols.size()) :
+                            optimizeHashBucketsNum(hashSymbols.size()+addNullHashSym,
+                                    addNullHashSym, hashCodes.get());
                     // and add these hash size to size
                     size += 4*(bucketsNum + hashSymbols.size()+addNullHashSym + 2);
                 }
+                else if (region.section.type == SHT_GNU_HASH)
+                    size += 16 + uint64_t(gnuBloomSize)*sizeof(typename Types::Word) +
+                        4*(uint64_t(gnuBucketsNum) + dynSymbols.size() + addNullDynSym -
+                            gnuSymOffset);
                 else if (region.section.type == SHT_DYNAMIC)
                     size += (dynamics.size()+1) * sizeof(typename Types::Dyn);
                 else if (region.section.type == SHT_NOTE)
@@ -716,27 +1109,57 @@ void ElfBinaryGenTemplate<Types>::computeSize()
                 {
                     if (::strcmp(region.section.name, ".strtab") == 0)
                     {
-                        size += (addNullSym);
-                        for (const auto& sym: symbols)
-                            if (sym.name != nullptr && sym.name[0] != 0)
-                                size += ::strlen(sym.name)+1;
+                        if (mergeStrings)
+                        {
+                            buildSymbolStrTab(strTabBuilder, symbols, addNullSym);
+                            size += strTabBuilder.getSize();
+                        }
+                        else
+                        {
+                            size += (addNullSym);
+                            for (const auto& sym: symbols)
+                                if (sym.name != nullptr && sym.name[0] != 0)
+                                    size += ::strlen(sym.name)+1;
+                        }
                     }
                     else if (::strcmp(region.section.name, ".dynstr") == 0)
                     {
-                        size += (addNullDynSym);
-                        for (const auto& sym: dynSymbols)
-                            if (sym.name != nullptr && sym.name[0] != 0)
-                                size += ::strlen(sym.name)+1;
+                        if (mergeStrings)
+                        {
+                            buildSymbolStrTab(dynStrBuilder, getOutDynSymbols(),
+                                        addNullDynSym);
+                            size += dynStrBuilder.getSize();
+                        }
+                        else
+                        {
+                            size += (addNullDynSym);
+                            for (const auto& sym: dynSymbols)
+                                if (sym.name != nullptr && sym.name[0] != 0)
+                                    size += ::strlen(sym.name)+1;
+                        }
                     }
                     else if (::strcmp(region.section.name, ".shstrtab") == 0)
                     {
-                        size += (addNullSection);
-                        for (const auto& region2: regions)
+                        if (mergeStrings)
                         {
-                            if (region2.type == ElfRegionType::SECTION &&
-                                region2.section.name != nullptr &&
-                                region2.section.name[0] != 0)
-                                size += ::strlen(region2.section.name)+1;
+                            std::vector<const char*> names;
+                            for (const auto& region2: regions)
+                                if (region2.type == ElfRegionType::SECTION)
+                                    names.push_back(region2.section.name);
+                            shStrTabBuilder.build(names.size(), names.data(),
+                                        addNullSection);
+                            size += shStrTabBuilder.getSize();
+                        }
+                        else
+                        {
+                            size += (addNullSection);
+                            for (const auto& region2: regions)
+                            {
+                                if (region2.type == ElfRegionType::SECTION &&
+                                    region2.section.name != nullptr &&
+                                    region2.section.name[0] != 0)
+                                    size += ::strlen(region2.section.name)+1;
+                            }
                         }
                     }
                 }
@@ -773,6 +1196,8 @@ void ElfBinaryGenTemplate<Types>::computeSize()
         for (size_t i = 0; i < dynamics.size(); i++)
             if (dynamics[i] >= 0 && dynamics[i] < dynTableSize)
                 dynamicValues[i] = dynValTable[dynamics[i]];
+            else if (dynamics[i] == DT_GNU_HASH)
+                dynamicValues[i] = gnuHashAddress;
     }
     
     sizeComputed = true;
@@ -1016,13 +1441,17 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
             if (addNullSection)
                 fob.fill(sizeof(typename Types::Shdr), 0);
             uint32_t nameOffset = (addNullSection);
+            size_t sectionIndex = 0;
             for (cxuint j = 0; j < regions.size(); j++)
             {
                 const auto& region2 = regions[j];
                 if (region2.type == ElfRegionType::SECTION)
                 {
                     typename Types::Shdr shdr;
-                    if (region2.section.name!=nullptr && region2.section.name[0]!=0)
+                    if (!shStrTabBuilder.empty())
+                        // from merged string table
+                        SLEV(shdr.sh_name, shStrTabBuilder.getOffset(sectionIndex));
+                    else if (region2.section.name!=nullptr && region2.section.name[0]!=0)
                         SLEV(shdr.sh_name, nameOffset);
                     else // set empty name offset
                         SLEV(shdr.sh_name, nullSectionNameOffset);
@@ -1048,7 +1477,7 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
                     {
                         // otherwise if default for symtabs, put count of last local
                         const auto& symbolsList = (region2.section.type == SHT_SYMTAB) ?
-                            symbols : dynSymbols;
+                            symbols : getOutDynSymbols();
                         cxuint lastLocal = 0;
                         for (size_t l = 0; l < symbolsList.size(); l++)
                             if (ELF32_ST_BIND(symbolsList[l].info)==STB_LOCAL)
@@ -1084,6 +1513,7 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
                         SLEV(shdr.sh_entsize, region2.section.entSize);
                     if (region2.section.name!=nullptr && region2.section.name[0]!=0)
                         nameOffset += ::strlen(region2.section.name)+1;
+                    sectionIndex++;
                     fob.writeObject(shdr);
                 }
             }
@@ -1114,11 +1544,17 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
                         nameOffset = 1;
                     }
                     const auto& symbolsList = (region.section.type == SHT_SYMTAB) ?
-                            symbols : dynSymbols;
-                    for (const auto& inSym: symbolsList)
+                            symbols : getOutDynSymbols();
+                    const ElfStrTabBuilder& symStrTab = (region.section.type == SHT_SYMTAB) ?
+                            strTabBuilder : dynStrBuilder;
+                    for (size_t k = 0; k < symbolsList.size(); k++)
                     {
+                        const auto& inSym = symbolsList[k];
                         typename Types::Sym sym;
-                        if (inSym.name != nullptr && inSym.name[0] != 0)
+                        if (!symStrTab.empty())
+                            // from merged string table
+                            SLEV(sym.st_name, symStrTab.getOffset(k));
+                        else if (inSym.name != nullptr && inSym.name[0] != 0)
                             SLEV(sym.st_name, nameOffset);
                         else  // set empty name offset (symbol or dynamic symbol)
                             SLEV(sym.st_name, (region.section.type == SHT_SYMTAB) ?
@@ -1171,7 +1607,7 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
                 {
                     // creating hash table and put it
                     const std::vector<ElfSymbolTemplate<Types> >& hashSymbols = 
-                        (isHashDynSym) ? dynSymbols : symbols;
+                        (isHashDynSym) ? getOutDynSymbols() : symbols;
                     bool addNullHashSym = (isHashDynSym) ? addNullDynSym : addNullSym;
                     Array<uint32_t> hashTable(2 + hashSymbols.size() + addNullHashSym +
                                 bucketsNum);
@@ -1179,6 +1615,10 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
                                 addNullHashSym, hashCodes.get(), hashTable.data());
                     fob.writeArray(hashTable.size(), hashTable.data());
                 }
+                else if (region.section.type == SHT_GNU_HASH)
+                    createGnuHashTable<Types>(gnuBucketsNum, gnuSymOffset, gnuBloomSize,
+                            gnuBloomShift, dynSymbols.size(), addNullDynSym,
+                            gnuHashCodes.get(), fob);
                 else if (region.section.type == SHT_NOTE)
                 {
                     // putting ELF notes
@@ -1202,7 +1642,18 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
                 else if (region.section.type == SHT_STRTAB)
                 {
                     // put symbol names and section names
-                    if (::strcmp(region.section.name, ".strtab") == 0)
+                    if (mergeStrings && (::strcmp(region.section.name, ".strtab") == 0 ||
+                        ::strcmp(region.section.name, ".dynstr") == 0 ||
+                        ::strcmp(region.section.name, ".shstrtab") == 0))
+                    {
+                        // merged string tables
+                        const ElfStrTabBuilder& builder =
+                            (::strcmp(region.section.name, ".strtab") == 0) ?
+                            strTabBuilder : (::strcmp(region.section.name, ".dynstr") == 0) ?
+                            dynStrBuilder : shStrTabBuilder;
+                        fob.write(builder.getSize(), builder.getContent());
+                    }
+                    else if (::strcmp(region.section.name, ".strtab") == 0)
                     {
                         if (addNullSym)
                             fob.put(0);
@@ -1214,7 +1665,7 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
                     {
                         if (addNullDynSym)
                             fob.put(0);
-                        for (const auto& sym: dynSymbols)
+                        for (const auto& sym: getOutDynSymbols())
                             if (sym.name != nullptr && sym.name[0] != 0)
                                 fob.write(::strlen(sym.name)+1, sym.name);
                     }
@@ -1241,7 +1692,8 @@ void ElfBinaryGenTemplate<Types>::generate(FastOutputBuffer& fob)
         }
     }
     fob.flush();
-    fob.getOStream().flush();
+    if (fob.hasOStream())
+        fob.getOStream().flush();
     assert(size == fob.getWritten()-startOffset);
 }
 
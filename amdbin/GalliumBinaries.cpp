@@ -450,18 +450,19 @@ void GalliumInput::addEmptyKernel(const char* kernelName, cxuint llvmVersion)
  * GalliumBinGenerator 
  */
 
-GalliumBinGenerator::GalliumBinGenerator() : manageable(false), input(nullptr)
+GalliumBinGenerator::GalliumBinGenerator() : manageable(false), input(nullptr),
+        mergeStrings(false)
 { }
 
 GalliumBinGenerator::GalliumBinGenerator(const GalliumInput* galliumInput)
-        : manageable(false), input(galliumInput)
+        : manageable(false), input(galliumInput), mergeStrings(false)
 { }
 
 GalliumBinGenerator::GalliumBinGenerator(bool _64bitMode, GPUDeviceType deviceType,
         size_t codeSize, const cxbyte* code,
         size_t globalDataSize, const cxbyte* globalData,
         const std::vector<GalliumKernelInput>& kernels)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), mergeStrings(false)
 {
     std::unique_ptr<GalliumInput> _input(new GalliumInput{});
     _input->is64BitElf = _64bitMode;
@@ -481,7 +482,7 @@ GalliumBinGenerator::GalliumBinGenerator(bool _64bitMode, GPUDeviceType deviceTy
         size_t codeSize, const cxbyte* code,
         size_t globalDataSize, const cxbyte* globalData,
         std::vector<GalliumKernelInput>&& kernels)
-        : manageable(true), input(nullptr)
+        : manageable(true), input(nullptr), mergeStrings(false)
 {
     std::unique_ptr<GalliumInput> _input(new GalliumInput{});
     _input->is64BitElf = _64bitMode;
@@ -825,6 +826,7 @@ void GalliumBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char
         else
             elfBinGen32.reset(new ElfBinaryGen32({ 0, 0, 0x40, 0,  ET_REL, 0xe0,
                         EV_CURRENT, UINT_MAX, 0, 0 }));
+        elfBinGen32->setMergeStrings(mergeStrings);
         putSectionsAndSymbols(*elfBinGen32, input, kernelsOrder, amdGpuConfigContent,
                         relTextContent32);
         elfSize = elfBinGen32->countSize();
@@ -838,6 +840,7 @@ void GalliumBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char
         else // new Mesa3D 17.0.0
             elfBinGen64.reset(new ElfBinaryGen64({ 0, 0, 0x40, 0,  ET_REL, 0xe0,
                         EV_CURRENT, UINT_MAX, 0, 0 }));
+        elfBinGen64->setMergeStrings(mergeStrings);
         putSectionsAndSymbols(*elfBinGen64, input, kernelsOrder, amdGpuConfigContent,
                         relTextContent64);
         elfSize = elfBinGen64->countSize();
@@ -859,32 +862,38 @@ void GalliumBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char
     /****
      * prepare for write binary to output
      ****/
-    std::unique_ptr<std::ostream> outStreamHolder;
+    std::unique_ptr<FastOutputBuffer> fobHolder;
     std::ostream* os = nullptr;
     if (aPtr != nullptr)
     {
+        // write directly to output array
         aPtr->resize(binarySize);
-        outStreamHolder.reset(
-                new ArrayOStream(binarySize, reinterpret_cast<char*>(aPtr->data())));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize,
+                    reinterpret_cast<char*>(aPtr->data())));
     }
     else if (vPtr != nullptr)
     {
+        // write directly to output vector
         vPtr->resize(binarySize);
-        outStreamHolder.reset(new VectorOStream(*vPtr));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize, vPtr->data()));
     }
-    else // from argument
+    else
+    {
+        // from argument
         os = osPtr;
+        fobHolder.reset(new FastOutputBuffer(256, *os));
+    }
     
-    const std::ios::iostate oldExceptions = os->exceptions();
+    const std::ios::iostate oldExceptions = (os != nullptr) ?
+                os->exceptions() : std::ios::goodbit;
     try
     {
-    os->exceptions(std::ios::failbit | std::ios::badbit);
+    if (os != nullptr)
+        os->exceptions(std::ios::failbit | std::ios::badbit);
     /****
      * write binary to output
      ****/
-    FastOutputBuffer bos(256, *os);
+    FastOutputBuffer& bos = *fobHolder;
     bos.writeObject<uint32_t>(LEV(kernelsNum));
     // write Gallium kernel info
     for (uint32_t korder: kernelsOrder)
@@ -924,10 +933,12 @@ void GalliumBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char
     }
     catch(...)
     {
-        os->exceptions(oldExceptions);
+        if (os != nullptr)
+            os->exceptions(oldExceptions);
         throw;
     }
-    os->exceptions(oldExceptions);
+    if (os != nullptr)
+        os->exceptions(oldExceptions);
 }
 
 void GalliumBinGenerator::generate(Array<cxbyte>& array) const
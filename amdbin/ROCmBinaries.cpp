@@ -209,6 +209,28 @@ ROCmBinary::ROCmBinary(size_t binaryCodeSize, cxbyte* binaryCode, Flags creation
             region.size = std::min(regSize, region.size);
     }
     
+    if (!hasRegionMap() && hasDynSymbolHashTable())
+    {
+        // map dynamic symbols to regions (for lookup through hash table)
+        const size_t dynSymbolsNum = getDynSymbolsNum();
+        dynSymRegions.resize(dynSymbolsNum);
+        for (size_t i = 0; i < dynSymbolsNum; i++)
+        {
+            dynSymRegions[i] = SIZE_MAX;
+            const uint64_t value = ULEV(getDynSymbol(i).st_value);
+            const char* symName = getDynSymbolName(i);
+            // regions with this same offset
+            const RegionOffsetEntry* it = std::lower_bound(symOffsets.get(),
+                    symOffsets.get()+regionsNum, std::make_pair(value, size_t(0)));
+            for (; it != symOffsets.get()+regionsNum && it->first == value; ++it)
+                if (::strcmp(regions[it->second].regionName.c_str(), symName) == 0)
+                {
+                    dynSymRegions[i] = it->second;
+                    break;
+                }
+        }
+    }
+    
     // load got symbols
     if (relaDynIndex != SHN_UNDEF && gotIndex != SHN_UNDEF)
     {
@@ -363,6 +385,14 @@ GPUDeviceType ROCmBinary::determineGPUDeviceType(uint32_t& outArchMinor,
 
 const ROCmRegion& ROCmBinary::getRegion(const char* name) const
 {
+    if (!hasRegionMap() && hasDynSymbolHashTable())
+    {
+        // find region by dynamic symbol (through hash table)
+        uint64_t symIndex;
+        if (!findDynSymbolIndex(name, symIndex) || dynSymRegions[symIndex] == SIZE_MAX)
+            throw BinException("Can't find region name");
+        return regions[dynSymRegions[symIndex]];
+    }
     RegionMap::const_iterator it = binaryMapFind(regionsMap.begin(),
                              regionsMap.end(), name);
     if (it == regionsMap.end())
@@ -430,8 +460,10 @@ class CLRX_INTERNAL ROCmRelaDynGen: public ElfRegionContent
 private:
     size_t gotOffset;
     const ROCmInput* input;
+    const ElfBinaryGen64& gen;
 public:
-    explicit ROCmRelaDynGen(const ROCmInput* _input) : gotOffset(0), input(_input)
+    ROCmRelaDynGen(const ROCmInput* _input, const ElfBinaryGen64& _gen)
+            : gotOffset(0), input(_input), gen(_gen)
     { }
     
     void setGotOffset(size_t _gotOffset)
@@ -444,7 +476,8 @@ public:
             size_t symIndex = input->gotSymbols[i];
             Elf64_Rela rela{};
             SLEV(rela.r_offset, gotOffset + 8*i);
-            SLEV(rela.r_info, ELF64_R_INFO(symIndex + 1, 3));
+            // dynamic symbols can be reordered by GNU hash table
+            SLEV(rela.r_info, ELF64_R_INFO(gen.getDynSymbolOutIndex(symIndex), 3));
             rela.r_addend = 0;
             fob.writeObject(rela);
         }
@@ -467,6 +500,9 @@ public:
         kernelOffsets = std::move(_kernelOffsets);
     }
     
+    void setGlobalData(const cxbyte* _gdata)
+    { gdata = _gdata; }
+    
     void operator()(FastOutputBuffer& fob) const
     {
         size_t p = 0;
@@ -493,19 +529,19 @@ public:
  */
 
 ROCmBinGenerator::ROCmBinGenerator() : manageable(false), input(nullptr),
-                rocmLLVMGDataGen(nullptr)
+                mergeStrings(false), gnuHash(false), rocmLLVMGDataGen(nullptr)
 { }
 
 ROCmBinGenerator::ROCmBinGenerator(const ROCmInput* rocmInput)
-        : manageable(false), input(rocmInput), rocmGotGen(nullptr), rocmRelaDynGen(nullptr),
-          rocmLLVMGDataGen(nullptr)
+        : manageable(false), input(rocmInput), mergeStrings(false), gnuHash(false),
+          rocmGotGen(nullptr), rocmRelaDynGen(nullptr), rocmLLVMGDataGen(nullptr)
 { }
 
 ROCmBinGenerator::ROCmBinGenerator(GPUDeviceType deviceType,
         uint32_t archMinor, uint32_t archStepping, size_t codeSize, const cxbyte* code,
         size_t globalDataSize, const cxbyte* globalData,
-        const std::vector<ROCmSymbolInput>& symbols) :
-        rocmGotGen(nullptr), rocmRelaDynGen(nullptr), rocmLLVMGDataGen(nullptr)
+        const std::vector<ROCmSymbolInput>& symbols) : mergeStrings(false),
+        gnuHash(false), rocmGotGen(nullptr), rocmRelaDynGen(nullptr), rocmLLVMGDataGen(nullptr)
 {
     std::unique_ptr<ROCmInput> _input(new ROCmInput{});
     _input->deviceType = deviceType;
@@ -534,8 +570,8 @@ ROCmBinGenerator::ROCmBinGenerator(GPUDeviceType deviceType,
 ROCmBinGenerator::ROCmBinGenerator(GPUDeviceType deviceType,
         uint32_t archMinor, uint32_t archStepping, size_t codeSize, const cxbyte* code,
         size_t globalDataSize, const cxbyte* globalData,
-        std::vector<ROCmSymbolInput>&& symbols) :
-        rocmGotGen(nullptr), rocmRelaDynGen(nullptr), rocmLLVMGDataGen(nullptr)
+        std::vector<ROCmSymbolInput>&& symbols) : mergeStrings(false),
+        gnuHash(false), rocmGotGen(nullptr), rocmRelaDynGen(nullptr), rocmLLVMGDataGen(nullptr)
 {
     std::unique_ptr<ROCmInput> _input(new ROCmInput{});
     _input->deviceType = deviceType;
@@ -593,6 +629,93 @@ static inline void addMainSectionToTable(cxuint& sectionsNum, uint16_t* builtinT
                 cxuint elfSectId)
 { builtinTable[elfSectId - ELFSECTID_START] = sectionsNum++; }
 
+static const size_t ROCMKERNEL_MDFIELDS_NUM = 19;
+
+// get fields of kernel metadata info and kernel config (or kernel descriptor)
+// which are written to code properties of kernel in metadata
+static void getKernelMDFields(const ROCmKernelMetadata& kernel,
+            const ROCmKernelConfig* config, const ROCmKernelDescriptor* kdesc,
+            uint64_t* fields)
+{
+    std::fill(fields, fields + ROCMKERNEL_MDFIELDS_NUM, uint64_t(0));
+    fields[0] = kernel.kernargSegmentSize;
+    fields[1] = kernel.groupSegmentFixedSize;
+    fields[2] = kernel.privateSegmentFixedSize;
+    fields[3] = kernel.kernargSegmentAlign;
+    fields[4] = kernel.wavefrontSize;
+    fields[5] = kernel.sgprsNum;
+    fields[6] = kernel.vgprsNum;
+    fields[7] = kernel.maxFlatWorkGroupSize;
+    fields[8] = kernel.spilledSgprs;
+    fields[9] = kernel.spilledVgprs;
+    if (config != nullptr)
+    {
+        fields[10] = ULEV(config->kernargSegmentSize);
+        fields[11] = ULEV(config->workgroupGroupSegmentSize);
+        fields[12] = ULEV(config->workitemPrivateSegmentSize);
+        fields[13] = config->kernargSegmentAlignment;
+        fields[14] = config->wavefrontSize;
+        fields[15] = ULEV(config->wavefrontSgprCount);
+        fields[16] = ULEV(config->workitemVgprCount);
+    }
+    if (kdesc != nullptr)
+    {
+        fields[17] = ULEV(kdesc->groupSegmentFixedSize);
+        fields[18] = ULEV(kdesc->privateSegmentFixedSize);
+    }
+}
+
+// generate ROCm metadata from metadata info (YAML or MsgPack)
+void ROCmBinGenerator::generateMetadata(std::string& mdStr,
+            std::vector<cxbyte>& mdBytes)
+{
+    std::vector<std::pair<CString, size_t> > symbolIndices(input->symbols.size());
+    // create sorted indices of symbols by its name
+    for (size_t k = 0; k < input->symbols.size(); k++)
+        symbolIndices[k] = std::make_pair(input->symbols[k].symbolName, k);
+    mapSort(symbolIndices.begin(), symbolIndices.end());
+    
+    const size_t mdKernelsNum = input->metadataInfo.kernels.size();
+    // remember metadata fields of kernels (for kernel patching)
+    layoutKernelMDFields.resize(mdKernelsNum*ROCMKERNEL_MDFIELDS_NUM);
+    if (!input->metadataV3Format)
+    {
+        std::unique_ptr<const ROCmKernelConfig*[]> kernelConfigPtrs(
+                new const ROCmKernelConfig*[mdKernelsNum]);
+        // generate ROCm kernel config pointers
+        for (size_t k = 0; k < mdKernelsNum; k++)
+        {
+            auto it = binaryMapFind(symbolIndices.begin(), symbolIndices.end(),
+                        input->metadataInfo.kernels[k].name);
+            if (it == symbolIndices.end() ||
+                (input->symbols[it->second].type != ROCmRegionType::FKERNEL &&
+                input->symbols[it->second].type != ROCmRegionType::KERNEL))
+                throw BinGenException("Kernel in metadata doesn't exists in code");
+            kernelConfigPtrs[k] = reinterpret_cast<const ROCmKernelConfig*>(
+                        input->code + input->symbols[it->second].offset);
+            getKernelMDFields(input->metadataInfo.kernels[k], kernelConfigPtrs[k],
+                        nullptr, layoutKernelMDFields.data() + k*ROCMKERNEL_MDFIELDS_NUM);
+        }
+        // just generate ROCm metadata from info
+        generateROCmMetadata(input->metadataInfo, kernelConfigPtrs.get(), mdStr);
+    }
+    else
+    {
+        std::unique_ptr<const ROCmKernelDescriptor*[]> kernelDescPtrs(
+                new const ROCmKernelDescriptor*[mdKernelsNum]);
+        for (size_t k = 0; k < mdKernelsNum; k++)
+        {
+            kernelDescPtrs[k] = reinterpret_cast<const ROCmKernelDescriptor*>(
+                        input->globalData + k*sizeof(ROCmKernelDescriptor));
+            getKernelMDFields(input->metadataInfo.kernels[k], nullptr, kernelDescPtrs[k],
+                        layoutKernelMDFields.data() + k*ROCMKERNEL_MDFIELDS_NUM);
+        }
+        // just generate ROCm metadata from info
+        generateROCmMetadataMsgPack(input->metadataInfo,
+                            kernelDescPtrs.get(), mdBytes);
+    }
+}
+
 void ROCmBinGenerator::prepareBinaryGen()
 {
     if (input->globalData == nullptr && (input->llvm10BinFormat || input->metadataV3Format))
@@ -632,6 +755,8 @@ void ROCmBinGenerator::prepareBinaryGen()
             addMainSectionToTable(mainSectionsNum, mainBuiltinSectTable, ELFSECTID_RODATA);
     addMainSectionToTable(mainSectionsNum, mainBuiltinSectTable, ELFSECTID_DYNSYM);
     addMainSectionToTable(mainSectionsNum, mainBuiltinSectTable, ROCMSECTID_HASH);
+    if (gnuHash)
+        addMainSectionToTable(mainSectionsNum, mainBuiltinSectTable, ROCMSECTID_GNUHASH);
     addMainSectionToTable(mainSectionsNum, mainBuiltinSectTable, ELFSECTID_DYNSTR);
     if (input->llvm10BinFormat)
         if (input->globalData != nullptr)
@@ -658,10 +783,13 @@ void ROCmBinGenerator::prepareBinaryGen()
     elfBinGen64.reset(new ElfBinaryGen64({ 0U, 0U, 0x40, abiVer, ET_DYN, 0xe0, EV_CURRENT,
             cxuint(input->newBinFormat ? execProgHeaderRegionIndex : UINT_MAX), 0, eflags },
             true, true, true, PHREGION_FILESTART));
+    elfBinGen64->setMergeStrings(mergeStrings);
     
     static const int32_t dynTags[] = {
         DT_SYMTAB, DT_SYMENT, DT_STRTAB, DT_STRSZ, DT_HASH };
     elfBinGen64->addDynamics(sizeof(dynTags)/sizeof(int32_t), dynTags);
+    if (gnuHash)
+        elfBinGen64->addDynamic(DT_GNU_HASH);
     
     // elf program headers
     elfBinGen64->addProgramHeader({ PT_PHDR, PF_R, 0, 1,
@@ -714,49 +842,20 @@ void ROCmBinGenerator::prepareBinaryGen()
     metadata = input->metadata;
     if (input->useMetadataInfo)
     {
-        // generate ROCm metadata
-        std::vector<std::pair<CString, size_t> > symbolIndices(input->symbols.size());
-        // create sorted indices of symbols by its name
-        for (size_t k = 0; k < input->symbols.size(); k++)
-            symbolIndices[k] = std::make_pair(input->symbols[k].symbolName, k);
-        mapSort(symbolIndices.begin(), symbolIndices.end());
-        
-        const size_t mdKernelsNum = input->metadataInfo.kernels.size();
+        generateMetadata(metadataStr, metadataBytes);
         if (!input->metadataV3Format)
         {
-            std::unique_ptr<const ROCmKernelConfig*[]> kernelConfigPtrs(
-                    new const ROCmKernelConfig*[mdKernelsNum]);
-            // generate ROCm kernel config pointers
-            for (size_t k = 0; k < mdKernelsNum; k++)
-            {
-                auto it = binaryMapFind(symbolIndices.begin(), symbolIndices.end(),
-                            input->metadataInfo.kernels[k].name);
-                if (it == symbolIndices.end() ||
-                    (input->symbols[it->second].type != ROCmRegionType::FKERNEL &&
-                    input->symbols[it->second].type != ROCmRegionType::KERNEL))
-                    throw BinGenException("Kernel in metadata doesn't exists in code");
-                kernelConfigPtrs[k] = reinterpret_cast<const ROCmKernelConfig*>(
-                            input->code + input->symbols[it->second].offset);
-            }
-            // just generate ROCm metadata from info
-            generateROCmMetadata(input->metadataInfo, kernelConfigPtrs.get(), metadataStr);
             metadataSize = metadataStr.size();
             metadata = metadataStr.c_str();
         }
         else
         {
-            std::unique_ptr<const ROCmKernelDescriptor*[]> kernelDescPtrs(
-                    new const ROCmKernelDescriptor*[mdKernelsNum]);
-            for (size_t k = 0; k < mdKernelsNum; k++)
-                kernelDescPtrs[k] = reinterpret_cast<const ROCmKernelDescriptor*>(
-                            input->globalData + k*sizeof(ROCmKernelDescriptor));
-            // just generate ROCm metadata from info
-            generateROCmMetadataMsgPack(input->metadataInfo,
-                                kernelDescPtrs.get(), metadataBytes);
             metadataSize = metadataBytes.size();
             metadata = (const char*)metadataBytes.data();
         }
     }
+    else
+        layoutKernelMDFields.clear();
     
     if (metadataSize != 0)
     {
@@ -781,6 +880,11 @@ void ROCmBinGenerator::prepareBinaryGen()
                 ".hash", SHT_HASH, SHF_ALLOC,
                 mainBuiltinSectTable[ELFSECTID_DYNSYM-ELFSECTID_START], 0,
                 Elf64Types::nobase));
+    if (gnuHash)
+        elfBinGen64->addRegion(ElfRegion64(0, (const cxbyte*)nullptr, 8,
+                    ".gnu.hash", SHT_GNU_HASH, SHF_ALLOC,
+                    mainBuiltinSectTable[ELFSECTID_DYNSYM-ELFSECTID_START], 0,
+                    Elf64Types::nobase));
     elfBinGen64->addRegion(ElfRegion64(0, (const cxbyte*)nullptr, 1, ".dynstr", SHT_STRTAB,
                 SHF_ALLOC, 0, 0, Elf64Types::nobase));
     if (input->llvm10BinFormat)
@@ -802,7 +906,7 @@ void ROCmBinGenerator::prepareBinaryGen()
         }
     if (!input->gotSymbols.empty())
     {
-        ROCmRelaDynGen* sgen = new ROCmRelaDynGen(input);
+        ROCmRelaDynGen* sgen = new ROCmRelaDynGen(input, *elfBinGen64);
         rocmRelaDynGen = (void*)sgen;
         elfBinGen64->addRegion(ElfRegion64(input->gotSymbols.size()*sizeof(Elf64_Rela),
                 sgen, 8, ".rela.dyn", SHT_RELA, SHF_ALLOC,
@@ -846,6 +950,14 @@ void ROCmBinGenerator::prepareBinaryGen()
     updateSymbols();
     binarySize = elfBinGen64->countSize();
     
+    // remember code layout (for kernel patching)
+    layoutCodeSize = input->codeSize;
+    layoutGlobalDataSize = input->globalDataSize;
+    layoutSymOffsets.resize(input->symbols.size());
+    for (size_t i = 0; i < input->symbols.size(); i++)
+        layoutSymOffsets[i] = input->symbols[i].offset;
+    layoutMetadata.assign(metadata != nullptr ? metadata : "", metadataSize);
+    
     if (rocmRelaDynGen != nullptr)
         ((ROCmRelaDynGen*)rocmRelaDynGen)->setGotOffset(
                 elfBinGen64->getRegionOffset(
@@ -928,32 +1040,38 @@ void ROCmBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>*
     /****
      * prepare for write binary to output
      ****/
-    std::unique_ptr<std::ostream> outStreamHolder;
+    std::unique_ptr<FastOutputBuffer> fobHolder;
     std::ostream* os = nullptr;
     if (aPtr != nullptr)
     {
+        // write directly to output array
         aPtr->resize(binarySize);
-        outStreamHolder.reset(
-                new ArrayOStream(binarySize, reinterpret_cast<char*>(aPtr->data())));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize,
+                    reinterpret_cast<char*>(aPtr->data())));
     }
     else if (vPtr != nullptr)
     {
+        // write directly to output vector
         vPtr->resize(binarySize);
-        outStreamHolder.reset(new VectorOStream(*vPtr));
-        os = outStreamHolder.get();
+        fobHolder.reset(new FastOutputBuffer(binarySize, vPtr->data()));
     }
-    else // from argument
+    else
+    {
+        // from argument
         os = osPtr;
+        fobHolder.reset(new FastOutputBuffer(256, *os));
+    }
     
-    const std::ios::iostate oldExceptions = os->exceptions();
+    const std::ios::iostate oldExceptions = (os != nullptr) ?
+                os->exceptions() : std::ios::goodbit;
     try
     {
-    os->exceptions(std::ios::failbit | std::ios::badbit);
+    if (os != nullptr)
+        os->exceptions(std::ios::failbit | std::ios::badbit);
     /****
      * write binary to output
      ****/
-    FastOutputBuffer bos(256, *os);
+    FastOutputBuffer& bos = *fobHolder;
     elfBinGen64->generate(bos);
     assert(bos.getWritten() == binarySize);
     
@@ -970,10 +1088,12 @@ void ROCmBinGenerator::generateInternal(std::ostream* osPtr, std::vector<char>*
     }
     catch(...)
     {
-        os->exceptions(oldExceptions);
+        if (os != nullptr)
+            os->exceptions(oldExceptions);
         throw;
     }
-    os->exceptions(oldExceptions);
+    if (os != nullptr)
+        os->exceptions(oldExceptions);
 }
 
 void ROCmBinGenerator::generate(Array<cxbyte>& array)
@@ -981,6 +1101,96 @@ void ROCmBinGenerator::generate(Array<cxbyte>& array)
     generateInternal(nullptr, nullptr, &array);
 }
 
+bool ROCmBinGenerator::isLayoutUnchanged() const
+{
+    if (input->codeSize != layoutCodeSize ||
+        input->globalDataSize != layoutGlobalDataSize ||
+        input->symbols.size() != layoutSymOffsets.size())
+        return false;
+    for (size_t i = 0; i < layoutSymOffsets.size(); i++)
+        if (input->symbols[i].offset != layoutSymOffsets[i])
+            return false;
+    return true;
+}
+
+bool ROCmBinGenerator::isMetadataUnchanged(const ROCmSymbolInput& kernel) const
+{
+    if (!input->useMetadataInfo)
+        return input->metadataSize == layoutMetadata.size() &&
+            (input->metadataSize == 0 ||
+             ::memcmp(input->metadata, layoutMetadata.data(), input->metadataSize) == 0);
+    const size_t mdKernelsNum = input->metadataInfo.kernels.size();
+    if (mdKernelsNum*ROCMKERNEL_MDFIELDS_NUM != layoutKernelMDFields.size())
+        return false;
+    // compare only fields of patched kernel which feed metadata
+    for (size_t k = 0; k < mdKernelsNum; k++)
+    {
+        const ROCmKernelMetadata& mdKernel = input->metadataInfo.kernels[k];
+        if (mdKernel.name != kernel.symbolName)
+            continue;
+        uint64_t fields[ROCMKERNEL_MDFIELDS_NUM];
+        if (!input->metadataV3Format)
+            getKernelMDFields(mdKernel, reinterpret_cast<const ROCmKernelConfig*>(
+                        input->code + kernel.offset), nullptr, fields);
+        else
+            getKernelMDFields(mdKernel, nullptr,
+                    reinterpret_cast<const ROCmKernelDescriptor*>(
+                        input->globalData + k*sizeof(ROCmKernelDescriptor)), fields);
+        return std::equal(fields, fields + ROCMKERNEL_MDFIELDS_NUM,
+                    layoutKernelMDFields.begin() + k*ROCMKERNEL_MDFIELDS_NUM);
+    }
+    return true;
+}
+
+bool ROCmBinGenerator::patchKernel(Array<cxbyte>& binary, const char* kernelName)
+{
+    const ROCmSymbolInput* kernel = nullptr;
+    for (const ROCmSymbolInput& symbol: input->symbols)
+        if ((symbol.type == ROCmRegionType::KERNEL ||
+             symbol.type == ROCmRegionType::FKERNEL) && symbol.symbolName == kernelName)
+        {
+            kernel = &symbol;
+            break;
+        }
+    if (kernel == nullptr)
+        throw BinGenException("Kernel not found");
+    
+    if (elfBinGen64 == nullptr || binary.size() != binarySize || !isLayoutUnchanged() ||
+        !isMetadataUnchanged(*kernel))
+    {
+        // layout or metadata has been changed, regenerate binary
+        if (rocmLLVMGDataGen != nullptr)
+        {
+            delete (ROCmLLVM10GlobalDataGen*)rocmLLVMGDataGen;
+            rocmLLVMGDataGen = nullptr;
+        }
+        elfBinGen64.reset();
+        generate(binary);
+        return false;
+    }
+    
+    // kernel code ends at next symbol or at end of code
+    size_t codeEnd = input->codeSize;
+    for (const ROCmSymbolInput& symbol: input->symbols)
+        if (symbol.offset > kernel->offset && symbol.offset < codeEnd)
+            codeEnd = symbol.offset;
+    if (kernel->offset > codeEnd)
+        throw BinGenException("Kernel offset out of range");
+    ::memcpy(binary.data() + getSectionOffset(ELFSECTID_TEXT) + kernel->offset,
+             input->code + kernel->offset, codeEnd - kernel->offset);
+    
+    if (rocmLLVMGDataGen != nullptr)
+    {
+        // kernel descriptors are in global data (rewrite them)
+        FastOutputBuffer fob(input->globalDataSize, reinterpret_cast<char*>(
+                binary.data() + getSectionOffset(ELFSECTID_RODATA)));
+        ROCmLLVM10GlobalDataGen* sgen = (ROCmLLVM10GlobalDataGen*)rocmLLVMGDataGen;
+        sgen->setGlobalData(input->globalData);
+        (*sgen)(fob);
+    }
+    return true;
+}
+
 void ROCmBinGenerator::generate(std::ostream& os)
 {
     generateInternal(&os, nullptr, nullptr);
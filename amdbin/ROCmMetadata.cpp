@@ -162,9 +162,95 @@ static YAMLValType parseYAMLType(const char*& ptr, const char* end, size_t lineN
     throw ParseException(lineNo, "Unknown YAML value type");
 }
 
+/// perfect hash for YAML keywords
+/** hash seed is found at construction, such that every keyword has own slot */
+class CLRX_INTERNAL YAMLKeywordHash
+{
+private:
+    static const cxuint slotsNum = 64;
+    static const cxuint maxKeywordsNum = 32;
+    
+    uint32_t seed;
+    size_t keywordsNum;
+    const char* keywords[maxKeywordsNum];
+    size_t lengths[maxKeywordsNum];
+    cxbyte slots[slotsNum]; // keyword index + 1, zero - no keyword
+    
+    static uint32_t hash(const char* str, size_t length, uint32_t seed)
+    {
+        uint32_t h = seed ^ uint32_t(length);
+        for (size_t i = 0; i < length; i++)
+            h = (h ^ cxbyte(str[i])) * 16777619U;
+        return h ^ (h>>15);
+    }
+public:
+    /// constructor from keyword table
+    YAMLKeywordHash(size_t _keywordsNum, const char* const* _keywords)
+            : seed(0), keywordsNum(_keywordsNum)
+    {
+        for (size_t i = 0; i < keywordsNum; i++)
+            keywords[i] = _keywords[i];
+        initialize();
+    }
+    
+    /// constructor from names of the map (name, value)
+    template<typename T>
+    YAMLKeywordHash(size_t _keywordsNum, const std::pair<const char*, T>* namesMap)
+            : seed(0), keywordsNum(_keywordsNum)
+    {
+        for (size_t i = 0; i < keywordsNum; i++)
+            keywords[i] = namesMap[i].first;
+        initialize();
+    }
+    
+    void initialize()
+    {
+        for (size_t i = 0; i < keywordsNum; i++)
+            lengths[i] = ::strlen(keywords[i]);
+        // find seed without collisions
+        for (seed = 1; ; seed++)
+        {
+            std::fill(slots, slots + slotsNum, cxbyte(0));
+            size_t i = 0;
+            for (; i < keywordsNum; i++)
+            {
+                cxbyte& slot = slots[hash(keywords[i], lengths[i], seed) & (slotsNum-1)];
+                if (slot != 0)
+                    break; // collision
+                slot = i+1;
+            }
+            if (i == keywordsNum)
+                break;
+        }
+    }
+    
+    /// find keyword, returns keywords number if not found
+    size_t find(const char* str, const char* strEnd) const
+    {
+        const size_t length = strEnd - str;
+        const cxbyte slot = slots[hash(str, length, seed) & (slotsNum-1)];
+        if (slot == 0 || lengths[slot-1] != length ||
+            ::memcmp(keywords[slot-1], str, length) != 0)
+            return keywordsNum;
+        return slot-1;
+    }
+};
+
+/// string value view (to metadata content or to decoding buffer)
+struct CLRX_INTERNAL YAMLStrRef
+{
+    const char* start;
+    const char* end;
+    
+    bool empty() const
+    { return start == end; }
+    CString toCString() const
+    { return CString(start, end); }
+};
+
 // parse YAML key (keywords - recognized keys)
 static size_t parseYAMLKey(const char*& ptr, const char* end, size_t lineNo,
-            size_t keywordsNum, const char** keywords)
+            const YAMLKeywordHash& keywords)
 {
     const char* keyPtr = ptr;
     while (ptr != end && (isAlnum(*ptr) || *ptr=='_')) ptr++;
@@ -180,10 +266,7 @@ static size_t parseYAMLKey(const char*& ptr, const char* end, size_t lineNo,
     if (afterColon == ptr && ptr != end && *ptr!='\n')
         // only if not immediate newline
         throw ParseException(lineNo, "After key and colon must be space");
-    CString keyword(keyPtr, keyEnd);
-    const size_t index = binaryFind(keywords, keywords+keywordsNum,
-                        keyword.c_str(), CStringLess()) - keywords;
-    return index;
+    return keywords.find(keyPtr, keyEnd);
 }
 
 // parse YAML integer value
@@ -238,12 +321,12 @@ static bool parseYAMLBoolValue(const char*& ptr, const char* end, size_t& lineNo
     
     const char* wordPtr = ptr;
     while(ptr != end && isAlnum(*ptr)) ptr++;
-    CString word(wordPtr, ptr);
+    const size_t wordLen = ptr - wordPtr;
     
     bool value = false;
     bool isSet = false;
     for (const char* v: { "1", "true", "t", "on", "yes", "y"})
-        if (::strcasecmp(word.c_str(), v) == 0)
+        if (::strlen(v) == wordLen && ::strncasecmp(wordPtr, v, wordLen) == 0)
         {
             isSet = true;
             value = true;
@@ -251,7 +334,7 @@ static bool parseYAMLBoolValue(const char*& ptr, const char* end, size_t& lineNo
         }
     if (!isSet)
         for (const char* v: { "0", "false", "f", "off", "no", "n"})
-            if (::strcasecmp(word.c_str(), v) == 0)
+            if (::strlen(v) == wordLen && ::strncasecmp(wordPtr, v, wordLen) == 0)
             {
                 isSet = true;
                 value = false;
@@ -266,21 +349,18 @@ static bool parseYAMLBoolValue(const char*& ptr, const char* end, size_t& lineNo
 }
 
 // trim spaces (remove spaces from start and end)
-static std::string trimStrSpaces(const std::string& str)
+static YAMLStrRef trimStrSpaces(YAMLStrRef str)
 {
-    size_t i = 0;
-    const size_t sz = str.size();
-    while (i!=sz && isSpace(str[i])) i++;
-    if (i == sz) return "";
-    size_t j = sz-1;
-    while (j>i && isSpace(str[j])) j--;
-    return str.substr(i, j-i+1);
+    while (str.start != str.end && isSpace(*str.start)) str.start++;
+    while (str.end != str.start && isSpace(str.end[-1])) str.end--;
+    return str;
 }
 
-static std::string parseYAMLString(const char*& linePtr, const char* end,
-            size_t& lineNo)
+/* parse quoted string. if string has no escapes and newlines then
+ * returns view to content, otherwise decodes string to strarray */
+static YAMLStrRef parseYAMLString(const char*& linePtr, const char* end,
+            size_t& lineNo, std::string& strarray)
 {
-    std::string strarray;
     if (linePtr == end || (*linePtr != '"' && *linePtr != '\''))
     {
         while (linePtr != end && !isSpace(*linePtr) && *linePtr != ',') linePtr++;
@@ -289,6 +369,19 @@ static std::string parseYAMLString(const char*& linePtr, const char* end,
     const char termChar = *linePtr;
     linePtr++;
     
+    {
+        // fast path: plain string without escapes
+        const char* strStart = linePtr;
+        const char* p = linePtr;
+        while (p != end && *p != termChar && *p != '\\' && *p != '\n') p++;
+        if (p != end && *p == termChar)
+        {
+            linePtr = p+1;
+            return { strStart, p };
+        }
+    }
+    strarray.clear();
+    
     // main loop, where is character parsing
     while (linePtr != end && *linePtr != termChar)
     {
@@ -390,15 +483,18 @@ static std::string parseYAMLString(const char*& linePtr, const char* end,
     if (linePtr == end)
         throw ParseException(lineNo, "Unterminated string");
     linePtr++;
-    return strarray;
+    return { strarray.data(), strarray.data() + strarray.size() };
 }
 
-static std::string parseYAMLStringValue(const char*& ptr, const char* end, size_t& lineNo,
-                    cxuint prevIndent, bool singleValue = false, bool blockAccept = true)
+/* parse YAML string value. returns view to metadata content or
+ * to buf (if string must be decoded) */
+static YAMLStrRef parseYAMLStringValue(const char*& ptr, const char* end, size_t& lineNo,
+                    cxuint prevIndent, std::string& buf, bool singleValue = false,
+                    bool blockAccept = true)
 {
     skipSpacesToLineEnd(ptr, end);
     if (ptr == end)
-        return "";
+        return { ptr, ptr };
     
     // skip !!str
     YAMLValType valType = parseYAMLType(ptr, end, lineNo);
@@ -406,14 +502,14 @@ static std::string parseYAMLStringValue(const char*& ptr, const char* end, size_
     {   // if 
         skipSpacesToLineEnd(ptr, end);
         if (ptr == end)
-            return "";
+            return { ptr, ptr };
     }
     else if (valType != YAMLValType::NONE)
         throw ParseException(lineNo, "Expected value of string type");
     
-    std::string buf;
+    YAMLStrRef strRef;
     if (*ptr=='"' || *ptr== '\'')
-        buf = parseYAMLString(ptr, end, lineNo);
+        strRef = parseYAMLString(ptr, end, lineNo, buf);
     // otherwise parse stream
     else if (*ptr == '|' || *ptr == '>')
     {
@@ -426,7 +522,7 @@ static std::string parseYAMLStringValue(const char*& ptr, const char* end, size_
         if (ptr!=end && *ptr!='\n')
             throw ParseException(lineNo, "Garbages at string block");
         if (ptr == end)
-            return ""; // end
+            return { ptr, ptr }; // end
         lineNo++;
         ptr++; // skip newline
         const char* lineStart = ptr;
@@ -435,7 +531,7 @@ static std::string parseYAMLStringValue(const char*& ptr, const char* end, size_
         if (indent <= prevIndent)
             throw ParseException(lineNo, "Unindented string block");
         
-        std::string buf;
+        buf.clear();
         while(ptr != end)
         {
             const char* strStart = ptr;
@@ -472,7 +568,7 @@ static std::string parseYAMLStringValue(const char*& ptr, const char* end, size_
                     buf.append("\n"); // always add newline at last line
                     if (ptr != end)
                         ptr = lineStart;
-                    return buf;
+                    return { buf.data(), buf.data() + buf.size() };
                 }
                 else // if this same and not end of line
                     break;
@@ -485,7 +581,7 @@ static std::string parseYAMLStringValue(const char*& ptr, const char* end, size_
             // to indent
             ptr = lineStart + indent;
         }
-        return buf;
+        return { buf.data(), buf.data() + buf.size() };
     }
     else
     {
@@ -502,12 +598,12 @@ static std::string parseYAMLStringValue(const char*& ptr, const char* end, size_
         if (strEnd != end && !isSpace(*strEnd))
             strEnd++;
         
-        buf.assign(strStart, strEnd);
+        strRef = { strStart, strEnd };
     }
     
     if (singleValue)
         skipSpacesToNextLine(ptr, end, lineNo);
-    return buf;
+    return strRef;
 }
 
 /// element consumer class
@@ -671,6 +767,7 @@ class CLRX_INTERNAL YAMLPrintfVectorConsumer: public YAMLElemConsumer
 {
 private:
     std::unordered_set<cxuint> printfIds;
+    std::string strBuf;
 public:
     std::vector<ROCmPrintfInfo>& printfInfos;
     
@@ -682,13 +779,13 @@ public:
                 cxuint prevIndent, bool singleValue, bool blockAccept)
     {
         const size_t oldLineNo = lineNo;
-        std::string str = parseYAMLStringValue(ptr, end, lineNo, prevIndent,
-                                singleValue, blockAccept);
+        const YAMLStrRef str = parseYAMLStringValue(ptr, end, lineNo, prevIndent,
+                                strBuf, singleValue, blockAccept);
         // parse printf string
         ROCmPrintfInfo printfInfo{};
         
-        const char* ptr2 = str.c_str();
-        const char* end2 = str.c_str() + str.size();
+        const char* ptr2 = str.start;
+        const char* end2 = str.end;
         parsePrintfInfoString(ptr2, end2, oldLineNo, lineNo, printfInfo, printfIds);
         
         printfInfos.push_back(printfInfo);
@@ -820,6 +917,9 @@ static const char* mainMetadataKeywords[] =
 static const size_t mainMetadataKeywordsNum =
         sizeof(mainMetadataKeywords) / sizeof(const char*);
 
+static const YAMLKeywordHash mainMetadataKeywordsHash(
+            mainMetadataKeywordsNum, mainMetadataKeywords);
+
 enum {
     ROCMMT_KERNEL_ARGS = 0, ROCMMT_KERNEL_ATTRS, ROCMMT_KERNEL_CODEPROPS,
     ROCMMT_KERNEL_LANGUAGE, ROCMMT_KERNEL_LANGUAGE_VERSION,
@@ -834,6 +934,9 @@ static const char* kernelMetadataKeywords[] =
 static const size_t kernelMetadataKeywordsNum =
         sizeof(kernelMetadataKeywords) / sizeof(const char*);
 
+static const YAMLKeywordHash kernelMetadataKeywordsHash(
+            kernelMetadataKeywordsNum, kernelMetadataKeywords);
+
 enum {
     ROCMMT_ATTRS_REQD_WORK_GROUP_SIZE = 0, ROCMMT_ATTRS_RUNTIME_HANDLE,
     ROCMMT_ATTRS_VECTYPEHINT, ROCMMT_ATTRS_WORK_GROUP_SIZE_HINT
@@ -847,6 +950,9 @@ static const char* kernelAttrMetadataKeywords[] =
 static const size_t kernelAttrMetadataKeywordsNum =
         sizeof(kernelAttrMetadataKeywords) / sizeof(const char*);
 
+static const YAMLKeywordHash kernelAttrMetadataKeywordsHash(
+            kernelAttrMetadataKeywordsNum, kernelAttrMetadataKeywords);
+
 enum {
     ROCMMT_CODEPROPS_FIXED_WORK_GROUP_SIZE = 0, ROCMMT_CODEPROPS_GROUP_SEGMENT_FIXED_SIZE,
     ROCMMT_CODEPROPS_KERNARG_SEGMENT_ALIGN, ROCMMT_CODEPROPS_KERNARG_SEGMENT_SIZE,
@@ -867,6 +973,9 @@ static const char* kernelCodePropsKeywords[] =
 static const size_t kernelCodePropsKeywordsNum =
         sizeof(kernelCodePropsKeywords) / sizeof(const char*);
 
+static const YAMLKeywordHash kernelCodePropsKeywordsHash(
+            kernelCodePropsKeywordsNum, kernelCodePropsKeywords);
+
 enum {
     ROCMMT_ARGS_ACCQUAL = 0, ROCMMT_ARGS_ACTUALACCQUAL, ROCMMT_ARGS_ADDRSPACEQUAL,
     ROCMMT_ARGS_ALIGN, ROCMMT_ARGS_ISCONST, ROCMMT_ARGS_ISPIPE, ROCMMT_ARGS_ISRESTRICT,
@@ -885,6 +994,9 @@ static const char* kernelArgInfosKeywords[] =
 static const size_t kernelArgInfosKeywordsNum =
         sizeof(kernelArgInfosKeywords) / sizeof(const char*);
 
+static const YAMLKeywordHash kernelArgInfosKeywordsHash(
+            kernelArgInfosKeywordsNum, kernelArgInfosKeywords);
+
 static const std::pair<const char*, ROCmValueKind> rocmValueKindNamesMap[] =
 {
     { "ByValue", ROCmValueKind::BY_VALUE },
@@ -907,6 +1019,9 @@ static const std::pair<const char*, ROCmValueKind> rocmValueKindNamesMap[] =
 static const size_t rocmValueKindNamesNum =
         sizeof(rocmValueKindNamesMap) / sizeof(std::pair<const char*, ROCmValueKind>);
 
+static const YAMLKeywordHash rocmValueKindNamesHash(rocmValueKindNamesNum,
+            rocmValueKindNamesMap);
+
 static const std::pair<const char*, ROCmValueType> rocmValueTypeNamesMap[] =
 {
     { "F16", ROCmValueType::FLOAT16 },
@@ -926,6 +1041,9 @@ static const std::pair<const char*, ROCmValueType> rocmValueTypeNamesMap[] =
 static const size_t rocmValueTypeNamesNum =
         sizeof(rocmValueTypeNamesMap) / sizeof(std::pair<const char*, ROCmValueType>);
 
+static const YAMLKeywordHash rocmValueTypeNamesHash(rocmValueTypeNamesNum,
+            rocmValueTypeNamesMap);
+
 static const char* rocmAddrSpaceTypesTbl[] =
 { "Private", "Global", "Constant", "Local", "Generic", "Region" };
 
@@ -944,6 +1062,8 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
     metadataInfo.version[0] = metadataInfo.version[1] = 0;
     
     std::vector<ROCmKernelMetadata>& kernels = metadataInfo.kernels;
+    // buffer for decoded strings (reused by all string values)
+    std::string strBuf;
     
     cxuint levels[6] = { UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX };
     cxuint curLevel = 0;
@@ -1024,7 +1144,7 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                 break; // end of the document
             
             const size_t keyIndex = parseYAMLKey(ptr, end, lineNo,
-                        mainMetadataKeywordsNum, mainMetadataKeywords);
+                        mainMetadataKeywordsHash);
             
             switch(keyIndex)
             {
@@ -1070,7 +1190,7 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
         {
             // in kernel
             const size_t keyIndex = parseYAMLKey(ptr, end, lineNo,
-                        kernelMetadataKeywordsNum, kernelMetadataKeywords);
+                        kernelMetadataKeywordsHash);
             
             ROCmKernelMetadata& kernel = kernels.back();
             switch(keyIndex)
@@ -1112,7 +1232,8 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                     canToNextLevel = true;
                     break;
                 case ROCMMT_KERNEL_LANGUAGE:
-                    kernel.language = parseYAMLStringValue(ptr, end, lineNo, level, true);
+                    kernel.language = parseYAMLStringValue(ptr, end, lineNo, level,
+                                strBuf, true).toCString();
                     break;
                 case ROCMMT_KERNEL_LANGUAGE_VERSION:
                 {
@@ -1121,10 +1242,12 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                     break;
                 }
                 case ROCMMT_KERNEL_NAME:
-                    kernel.name = parseYAMLStringValue(ptr, end, lineNo, level, true);
+                    kernel.name = parseYAMLStringValue(ptr, end, lineNo, level,
+                                strBuf, true).toCString();
                     break;
                 case ROCMMT_KERNEL_SYMBOLNAME:
-                    kernel.symbolName = parseYAMLStringValue(ptr, end, lineNo, level, true);
+                    kernel.symbolName = parseYAMLStringValue(ptr, end, lineNo, level,
+                                strBuf, true).toCString();
                     break;
                 default:
                     skipYAMLValue(ptr, end, lineNo, level);
@@ -1136,7 +1259,7 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
         {
             // in kernel attributes
             const size_t keyIndex = parseYAMLKey(ptr, end, lineNo,
-                        kernelAttrMetadataKeywordsNum, kernelAttrMetadataKeywords);
+                        kernelAttrMetadataKeywordsHash);
             
             ROCmKernelMetadata& kernel = kernels.back();
             switch(keyIndex)
@@ -1149,11 +1272,11 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                 }
                 case ROCMMT_ATTRS_RUNTIME_HANDLE:
                     kernel.runtimeHandle = parseYAMLStringValue(
-                                ptr, end, lineNo, level, true);
+                                ptr, end, lineNo, level, strBuf, true).toCString();
                     break;
                 case ROCMMT_ATTRS_VECTYPEHINT:
                     kernel.vecTypeHint = parseYAMLStringValue(
-                                ptr, end, lineNo, level, true);
+                                ptr, end, lineNo, level, strBuf, true).toCString();
                     break;
                 case ROCMMT_ATTRS_WORK_GROUP_SIZE_HINT:
                 {
@@ -1171,7 +1294,7 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
         {
             // in kernel codeProps
             const size_t keyIndex = parseYAMLKey(ptr, end, lineNo,
-                        kernelCodePropsKeywordsNum, kernelCodePropsKeywords);
+                        kernelCodePropsKeywordsHash);
             
             ROCmKernelMetadata& kernel = kernels.back();
             switch(keyIndex)
@@ -1245,7 +1368,7 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
         {
             // in kernel argument
             const size_t keyIndex = parseYAMLKey(ptr, end, lineNo,
-                        kernelArgInfosKeywordsNum, kernelArgInfosKeywords);
+                        kernelArgInfosKeywordsHash);
             
             ROCmKernelArgInfo& kernelArg = kernels.back().argInfos.back();
             
@@ -1255,11 +1378,14 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                 case ROCMMT_ARGS_ACCQUAL:
                 case ROCMMT_ARGS_ACTUALACCQUAL:
                 {
-                    const std::string acc = trimStrSpaces(parseYAMLStringValue(
-                                    ptr, end, lineNo, level, true));
+                    const YAMLStrRef acc = trimStrSpaces(parseYAMLStringValue(
+                                    ptr, end, lineNo, level, strBuf, true));
+                    const size_t accLen = acc.end - acc.start;
                     size_t accIndex = 0;
                     for (; accIndex < 4; accIndex++)
-                        if (::strcmp(rocmAccessQualifierTbl[accIndex], acc.c_str())==0)
+                        if (::strlen(rocmAccessQualifierTbl[accIndex]) == accLen &&
+                            ::memcmp(rocmAccessQualifierTbl[accIndex],
+                                     acc.start, accLen)==0)
                             break;
                     if (accIndex == 4)
                         throw ParseException(lineNo, "Wrong access qualifier");
@@ -1271,12 +1397,14 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                 }
                 case ROCMMT_ARGS_ADDRSPACEQUAL:
                 {
-                    const std::string aspace = trimStrSpaces(parseYAMLStringValue(
-                                    ptr, end, lineNo, level, true));
+                    const YAMLStrRef aspace = trimStrSpaces(parseYAMLStringValue(
+                                    ptr, end, lineNo, level, strBuf, true));
+                    const size_t aspaceLen = aspace.end - aspace.start;
                     size_t aspaceIndex = 0;
                     for (; aspaceIndex < 6; aspaceIndex++)
-                        if (::strcasecmp(rocmAddrSpaceTypesTbl[aspaceIndex],
-                                    aspace.c_str())==0)
+                        if (::strlen(rocmAddrSpaceTypesTbl[aspaceIndex]) == aspaceLen &&
+                            ::strncasecmp(rocmAddrSpaceTypesTbl[aspaceIndex],
+                                    aspace.start, aspaceLen)==0)
                             break;
                     if (aspaceIndex == 6)
                         throw ParseException(valLineNo, "Wrong address space");
@@ -1299,7 +1427,8 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                     kernelArg.isVolatile = parseYAMLBoolValue(ptr, end, lineNo, true);
                     break;
                 case ROCMMT_ARGS_NAME:
-                    kernelArg.name = parseYAMLStringValue(ptr, end, lineNo, level, true);
+                    kernelArg.name = parseYAMLStringValue(ptr, end, lineNo, level,
+                                strBuf, true).toCString();
                     break;
                 case ROCMMT_ARGS_POINTEE_ALIGN:
                     kernelArg.pointeeAlign =
@@ -1309,16 +1438,15 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                     kernelArg.size = parseYAMLIntValue<uint64_t>(ptr, end, lineNo);
                     break;
                 case ROCMMT_ARGS_TYPENAME:
-                    kernelArg.typeName =
-                                parseYAMLStringValue(ptr, end, lineNo, level, true);
+                    kernelArg.typeName = parseYAMLStringValue(ptr, end, lineNo,
+                                level, strBuf, true).toCString();
                     break;
                 case ROCMMT_ARGS_VALUEKIND:
                 {
-                    const std::string vkind = trimStrSpaces(parseYAMLStringValue(
-                                ptr, end, lineNo, level, true));
-                    const size_t vkindIndex = binaryMapFind(rocmValueKindNamesMap,
-                            rocmValueKindNamesMap + rocmValueKindNamesNum, vkind.c_str(),
-                            CStringLess()) - rocmValueKindNamesMap;
+                    const YAMLStrRef vkind = trimStrSpaces(parseYAMLStringValue(
+                                ptr, end, lineNo, level, strBuf, true));
+                    const size_t vkindIndex = rocmValueKindNamesHash.find(
+                                vkind.start, vkind.end);
                     // if unknown kind
                     if (vkindIndex == rocmValueKindNamesNum)
                         throw ParseException(valLineNo, "Wrong argument value kind");
@@ -1327,11 +1455,10 @@ void CLRX::parseROCmMetadata(size_t metadataSize, const char* metadata,
                 }
                 case ROCMMT_ARGS_VALUETYPE:
                 {
-                    const std::string vtype = trimStrSpaces(parseYAMLStringValue(
-                                    ptr, end, lineNo, level, true));
-                    const size_t vtypeIndex = binaryMapFind(rocmValueTypeNamesMap,
-                            rocmValueTypeNamesMap + rocmValueTypeNamesNum, vtype.c_str(),
-                            CStringLess()) - rocmValueTypeNamesMap;
+                    const YAMLStrRef vtype = trimStrSpaces(parseYAMLStringValue(
+                                    ptr, end, lineNo, level, strBuf, true));
+                    const size_t vtypeIndex = rocmValueTypeNamesHash.find(
+                                vtype.start, vtype.end);
                     // if unknown type
                     if (vtypeIndex == rocmValueTypeNamesNum)
                         throw ParseException(valLineNo, "Wrong argument value type");
@@ -1368,18 +1495,6 @@ static const char* rocmValueTypeNames[] =
     "Struct", "I8", "U8", "I16", "U16", "F16", "I32", "U32", "F32", "I64", "U64", "F64"
 };
 
-static void genArrayValue(cxuint n, const cxuint* values, std::string& output)
-{
-    char numBuf[24];
-    output += "[ ";
-    for (cxuint i = 0; i < n; i++)
-    {
-        itocstrCStyle(values[i], numBuf, 24);
-        output += numBuf;
-        output += (i+1<n) ? ", " : " ]\n";
-    }
-}
-
 // helper for checking whether value is supplied
 static inline bool hasValue(cxuint value)
 { return value!=BINGEN_NOTSUPPLIED && value!=BINGEN_DEFAULT; }
@@ -1387,59 +1502,174 @@ static inline bool hasValue(cxuint value)
 static inline bool hasValue(uint64_t value)
 { return value!=BINGEN64_NOTSUPPLIED && value!=BINGEN64_DEFAULT; }
 
-// get escaped YAML string if needed, otherwise get this same string
-static std::string escapeYAMLString(const CString& input)
+// returns true if YAML string must be escaped
+static bool isYAMLStringToEscape(const char* str, size_t length)
 {
-    bool toEscape = false;
-    const char* s;
-    for (s = input.c_str(); *s!=0; s++)
+    for (size_t i = 0; i < length; i++)
     {
-        cxbyte c = *s;
+        cxbyte c = str[i];
         if (c < 0x20 || c >= 0x80 || c=='*' || c=='&' || c=='!' || c=='@' ||
             c=='\'' || c=='\"')
-            toEscape = true;
+            return true;
     }
     // if spaces in begin and end
-    if (isSpace(input[0]) || isDigit(input[0]) ||
-        (!input.empty() && isSpace(s[-1])))
-        toEscape = true;
+    return length != 0 && (isSpace(str[0]) || isDigit(str[0]) ||
+                isSpace(str[length-1]));
+}
+
+/* YAML metadata is generated in two passes: first pass computes upper bound of
+ * output size (exact except escaped strings), second pass writes metadata
+ * directly to preallocated output */
+
+/// computes upper bound of size of YAML metadata
+class CLRX_INTERNAL ROCmYAMLSizeCounter
+{
+private:
+    size_t size;
+public:
+    // one byte for null-character after last number or escaped string
+    ROCmYAMLSizeCounter() : size(1)
+    { }
+    
+    void put(char c)
+    { size++; }
+    void put(const char* str, size_t length)
+    { size += length; }
+    void put(const char* str)
+    { size += ::strlen(str); }
     
-    if (toEscape)
+    template<typename T>
+    void putNumber(T value)
     {
-        std::string out = "'";
-        out += escapeStringCStyle(s-input.c_str(), input.c_str());
-        out += "'";
-        return out;
+        size++;
+        for (; value >= 10; value /= 10)
+            size++;
     }
-    return input.c_str();
-}
+    
+    void putArray(cxuint n, const cxuint* values)
+    {
+        size += 2 + 2*(n-1) + 3;
+        for (cxuint i = 0; i < n; i++)
+            putNumber(values[i]);
+    }
+    
+    void putYAMLString(const CString& str)
+    {
+        // escaped character takes at most 4 characters, and two apostrophes
+        size += isYAMLStringToEscape(str.c_str(), str.size()) ?
+                    4*str.size() + 2 : str.size();
+    }
+    
+    void putYAMLDefaultSymbolName(const CString& kernelName)
+    // always escaped due to '@'
+    { size += 4*(kernelName.size()+3) + 2; }
+    
+    void putPrintfFormat(const CString& format)
+    { size += 4*format.size(); }
+    
+    size_t getSize() const
+    { return size; }
+};
 
-static std::string escapePrintfFormat(const std::string& fmt)
+/// writes YAML metadata to preallocated output
+class CLRX_INTERNAL ROCmYAMLWriter
 {
-    std::string out;
-    out.reserve(fmt.size());
-    for (char c: fmt)
-        if (c!=':')
-            out.push_back(c);
+private:
+    std::string& output;
+    char* ptr;
+    std::string tempBuf;
+    
+    void putYAMLString(const char* str, size_t length)
+    {
+        if (isYAMLStringToEscape(str, length))
+        {
+            size_t outSize;
+            put('\'');
+            escapeStringCStyle(length, str, 4*length+1, ptr, outSize);
+            ptr += outSize;
+            put('\'');
+        }
         else
-            out += "\\72";
-    return out;
-}
+            put(str, length);
+    }
+public:
+    ROCmYAMLWriter(size_t maxSize, std::string& _output) : output(_output)
+    {
+        output.resize(maxSize);
+        ptr = &output[0];
+    }
+    
+    /// finish writing (trim output to written size)
+    void finish()
+    { output.resize(ptr - output.data()); }
+    
+    void put(char c)
+    { *ptr++ = c; }
+    void put(const char* str, size_t length)
+    {
+        ::memcpy(ptr, str, length);
+        ptr += length;
+    }
+    void put(const char* str)
+    { put(str, ::strlen(str)); }
+    
+    template<typename T>
+    void putNumber(T value)
+    { ptr += itocstrCStyle(value, ptr, 24); }
+    
+    void putArray(cxuint n, const cxuint* values)
+    {
+        put("[ ", 2);
+        for (cxuint i = 0; i < n; i++)
+        {
+            putNumber(values[i]);
+            if (i+1<n)
+                put(", ", 2);
+            else
+                put(" ]\n", 3);
+        }
+    }
+    
+    // put escaped YAML string if needed, otherwise put this same string
+    void putYAMLString(const CString& str)
+    { putYAMLString(str.c_str(), str.size()); }
+    
+    // put default symbol name of kernel (kernel name + '@kd')
+    void putYAMLDefaultSymbolName(const CString& kernelName)
+    {
+        tempBuf.assign(kernelName.c_str(), kernelName.size());
+        tempBuf += "@kd";
+        putYAMLString(tempBuf.c_str(), tempBuf.size());
+    }
+    
+    // put escaped printf format (colons are replaced by '\72')
+    void putPrintfFormat(const CString& format)
+    {
+        size_t outSize;
+        tempBuf.resize(4*format.size()+1);
+        escapeStringCStyle(format.size(), format.c_str(), tempBuf.size(),
+                        &tempBuf[0], outSize);
+        for (size_t i = 0; i < outSize; i++)
+            if (tempBuf[i]!=':')
+                put(tempBuf[i]);
+            else
+                put("\\72", 3);
+    }
+};
 
-void CLRX::generateROCmMetadata(const ROCmMetadata& mdInfo,
-                    const ROCmKernelConfig** kconfigs, std::string& output)
+template<typename YAMLWriter>
+static void generateROCmMetadataYAML(const ROCmMetadata& mdInfo,
+                    const ROCmKernelConfig** kconfigs, YAMLWriter& writer)
 {
-    output.clear();
-    char numBuf[24];
-    output += "---\n";
+    writer.put("---\n");
     // version
-    output += "Version:         ";
+    writer.put("Version:         ");
     if (hasValue(mdInfo.version[0]))
-        genArrayValue(2, mdInfo.version, output);
+        writer.putArray(2, mdInfo.version);
     else // default
-        output += "[ 1, 0 ]\n";
+        writer.put("[ 1, 0 ]\n");
     if (!mdInfo.printfInfos.empty())
-        output += "Printf:          \n";
+        writer.put("Printf:          \n");
     // check print ids uniquness
     {
         std::unordered_set<cxuint> printfIds;
@@ -1461,56 +1691,47 @@ void CLRX::generateROCmMetadata(const ROCmMetadata& mdInfo,
                 printfId = freePrintfId++;
             }
             
-            output += "  - '";
-            itocstrCStyle(printfId, numBuf, 24);
-            output += numBuf;
-            output += ':';
-            itocstrCStyle(printfInfo.argSizes.size(), numBuf, 24);
-            output += numBuf;
-            output += ':';
+            writer.put("  - '");
+            writer.putNumber(printfId);
+            writer.put(':');
+            writer.putNumber(printfInfo.argSizes.size());
+            writer.put(':');
             for (size_t argSize: printfInfo.argSizes)
             {
-                itocstrCStyle(argSize, numBuf, 24);
-                output += numBuf;
-                output += ':';
+                writer.putNumber(argSize);
+                writer.put(':');
             }
             // printf format
-            std::string escapedFmt = escapeStringCStyle(printfInfo.format);
-            escapedFmt = escapePrintfFormat(escapedFmt);
-            output += escapedFmt;
-            output += "'\n";
+            writer.putPrintfFormat(printfInfo.format);
+            writer.put("'\n");
         }
     }
     
     if (!mdInfo.kernels.empty())
-        output += "Kernels:         \n";
+        writer.put("Kernels:         \n");
     // kernels
     for (size_t i = 0; i < mdInfo.kernels.size(); i++)
     {
         const ROCmKernelMetadata& kernel = mdInfo.kernels[i];
-        output += "  - Name:            ";
-        output.append(kernel.name.c_str(), kernel.name.size());
-        output += "\n    SymbolName:      ";
+        writer.put("  - Name:            ");
+        writer.put(kernel.name.c_str(), kernel.name.size());
+        writer.put("\n    SymbolName:      ");
         if (!kernel.symbolName.empty())
-            output += escapeYAMLString(kernel.symbolName);
+            writer.putYAMLString(kernel.symbolName);
         else
-        {
             // default is kernel name + '@kd'
-            std::string symName = kernel.name.c_str();
-            symName += "@kd";
-            output += escapeYAMLString(symName);
-        }
-        output += "\n";
+            writer.putYAMLDefaultSymbolName(kernel.name);
+        writer.put("\n");
         if (!kernel.language.empty())
         {
-            output += "    Language:        ";
-            output += escapeYAMLString(kernel.language);
-            output += "\n";
+            writer.put("    Language:        ");
+            writer.putYAMLString(kernel.language);
+            writer.put("\n");
         }
         if (kernel.langVersion[0] != BINGEN_NOTSUPPLIED)
         {
-            output += "    LanguageVersion: ";
-            genArrayValue(2, kernel.langVersion, output);
+            writer.put("    LanguageVersion: ");
+            writer.putArray(2, kernel.langVersion);
         }
         // kernel attributes
         if (kernel.reqdWorkGroupSize[0] != 0 || kernel.reqdWorkGroupSize[1] != 0 ||
@@ -1519,74 +1740,71 @@ void CLRX::generateROCmMetadata(const ROCmMetadata& mdInfo,
             kernel.workGroupSizeHint[2] != 0 ||
             !kernel.vecTypeHint.empty() || !kernel.runtimeHandle.empty())
         {
-            output += "    Attrs:           \n";
+            writer.put("    Attrs:           \n");
             if (kernel.workGroupSizeHint[0] != 0 || kernel.workGroupSizeHint[1] != 0 ||
                 kernel.workGroupSizeHint[2] != 0)
             {
-                output += "      WorkGroupSizeHint: ";
-                genArrayValue(3, kernel.workGroupSizeHint, output);
+                writer.put("      WorkGroupSizeHint: ");
+                writer.putArray(3, kernel.workGroupSizeHint);
             }
             if (kernel.reqdWorkGroupSize[0] != 0 || kernel.reqdWorkGroupSize[1] != 0 ||
                 kernel.reqdWorkGroupSize[2] != 0)
             {
-                output += "      ReqdWorkGroupSize: ";
-                genArrayValue(3, kernel.reqdWorkGroupSize, output);
+                writer.put("      ReqdWorkGroupSize: ");
+                writer.putArray(3, kernel.reqdWorkGroupSize);
             }
             if (!kernel.vecTypeHint.empty())
             {
-                output += "      VecTypeHint:     ";
-                output += escapeYAMLString(kernel.vecTypeHint);
-                output += "\n";
+                writer.put("      VecTypeHint:     ");
+                writer.putYAMLString(kernel.vecTypeHint);
+                writer.put("\n");
             }
             if (!kernel.runtimeHandle.empty())
             {
-                output += "      RuntimeHandle:   ";
-                output += escapeYAMLString(kernel.runtimeHandle);
-                output += "\n";
+                writer.put("      RuntimeHandle:   ");
+                writer.putYAMLString(kernel.runtimeHandle);
+                writer.put("\n");
             }
         }
         // kernel arguments
         if (!kernel.argInfos.empty())
-            output += "    Args:            \n";
+            writer.put("    Args:            \n");
         for (const ROCmKernelArgInfo& argInfo: kernel.argInfos)
         {
-            output += "      - ";
+            writer.put("      - ");
             if (!argInfo.name.empty())
             {
-                output += "Name:            ";
-                output += escapeYAMLString(argInfo.name);
-                output += "\n        ";
+                writer.put("Name:            ");
+                writer.putYAMLString(argInfo.name);
+                writer.put("\n        ");
             }
             if (!argInfo.typeName.empty())
             {
-                output += "TypeName:        ";
-                output += escapeYAMLString(argInfo.typeName);
-                output += "\n        ";
+                writer.put("TypeName:        ");
+                writer.putYAMLString(argInfo.typeName);
+                writer.put("\n        ");
             }
-            output += "Size:            ";
-            itocstrCStyle(argInfo.size, numBuf, 24);
-            output += numBuf;
-            output += "\n        Align:           ";
-            itocstrCStyle(argInfo.align, numBuf, 24);
-            output += numBuf;
-            output += "\n        ValueKind:       ";
+            writer.put("Size:            ");
+            writer.putNumber(argInfo.size);
+            writer.put("\n        Align:           ");
+            writer.putNumber(argInfo.align);
+            writer.put("\n        ValueKind:       ");
             
             if (argInfo.valueKind > ROCmValueKind::MAX_VALUE)
                 throw BinGenException("Unknown ValueKind");
-            output += rocmValueKindNames[cxuint(argInfo.valueKind)];
+            writer.put(rocmValueKindNames[cxuint(argInfo.valueKind)]);
             
             if (argInfo.valueType > ROCmValueType::MAX_VALUE)
                 throw BinGenException("Unknown ValueType");
-            output += "\n        ValueType:       ";
-            output += rocmValueTypeNames[cxuint(argInfo.valueType)];
-            output += "\n";
+            writer.put("\n        ValueType:       ");
+            writer.put(rocmValueTypeNames[cxuint(argInfo.valueType)]);
+            writer.put("\n");
             
             if (argInfo.valueKind == ROCmValueKind::DYN_SHARED_PTR)
             {
-                output += "        PointeeAlign:    ";
-                itocstrCStyle(argInfo.pointeeAlign, numBuf, 24);
-                output += numBuf;
-                output += "\n";
+                writer.put("        PointeeAlign:    ");
+                writer.putNumber(argInfo.pointeeAlign);
+                writer.put("\n");
             }
             if (argInfo.valueKind == ROCmValueKind::DYN_SHARED_PTR ||
                 argInfo.valueKind == ROCmValueKind::GLOBAL_BUFFER)
@@ -1594,18 +1812,18 @@ void CLRX::generateROCmMetadata(const ROCmMetadata& mdInfo,
                 if (argInfo.addressSpace > ROCmAddressSpace::MAX_VALUE ||
                     argInfo.addressSpace == ROCmAddressSpace::NONE)
                     throw BinGenException("Unknown AddressSpace");
-                output += "        AddrSpaceQual:   ";
-                output += rocmAddrSpaceTypesTbl[cxuint(argInfo.addressSpace)-1];
-                output += "\n";
+                writer.put("        AddrSpaceQual:   ");
+                writer.put(rocmAddrSpaceTypesTbl[cxuint(argInfo.addressSpace)-1]);
+                writer.put("\n");
             }
             if (argInfo.valueKind == ROCmValueKind::IMAGE ||
                 argInfo.valueKind == ROCmValueKind::PIPE)
             {
                 if (argInfo.accessQual> ROCmAccessQual::MAX_VALUE)
                     throw BinGenException("Unknown AccessQualifier");
-                output += "        AccQual:         ";
-                output += rocmAccessQualifierTbl[cxuint(argInfo.accessQual)];
-                output += "\n";
+                writer.put("        AccQual:         ");
+                writer.put(rocmAccessQualifierTbl[cxuint(argInfo.accessQual)]);
+                writer.put("\n");
             }
             if (argInfo.valueKind == ROCmValueKind::GLOBAL_BUFFER ||
                 argInfo.valueKind == ROCmValueKind::IMAGE ||
@@ -1613,83 +1831,81 @@ void CLRX::generateROCmMetadata(const ROCmMetadata& mdInfo,
             {
                 if (argInfo.actualAccessQual> ROCmAccessQual::MAX_VALUE)
                     throw BinGenException("Unknown ActualAccessQualifier");
-                output += "        ActualAccQual:   ";
-                output += rocmAccessQualifierTbl[cxuint(argInfo.actualAccessQual)];
-                output += "\n";
+                writer.put("        ActualAccQual:   ");
+                writer.put(rocmAccessQualifierTbl[cxuint(argInfo.actualAccessQual)]);
+                writer.put("\n");
             }
             if (argInfo.isConst)
-                output += "        IsConst:         true\n";
+                writer.put("        IsConst:         true\n");
             if (argInfo.isRestrict)
-                output += "        IsRestrict:      true\n";
+                writer.put("        IsRestrict:      true\n");
             if (argInfo.isVolatile)
-                output += "        IsVolatile:      true\n";
+                writer.put("        IsVolatile:      true\n");
             if (argInfo.isPipe)
-                output += "        IsPipe:          true\n";
+                writer.put("        IsPipe:          true\n");
         }
         
         // kernel code properties
         const ROCmKernelConfig& kconfig = *kconfigs[i];
         
-        output += "    CodeProps:       \n";
-        output += "      KernargSegmentSize: ";
-        itocstrCStyle(hasValue(kernel.kernargSegmentSize) ?
-                kernel.kernargSegmentSize : ULEV(kconfig.kernargSegmentSize),
-                numBuf, 24);
-        output += numBuf;
-        output += "\n      GroupSegmentFixedSize: ";
-        itocstrCStyle(hasValue(kernel.groupSegmentFixedSize) ?
+        writer.put("    CodeProps:       \n");
+        writer.put("      KernargSegmentSize: ");
+        writer.putNumber(hasValue(kernel.kernargSegmentSize) ?
+                kernel.kernargSegmentSize : ULEV(kconfig.kernargSegmentSize));
+        writer.put("\n      GroupSegmentFixedSize: ");
+        writer.putNumber(hasValue(kernel.groupSegmentFixedSize) ?
                 kernel.groupSegmentFixedSize :
-                uint64_t(ULEV(kconfig.workgroupGroupSegmentSize)),
-                numBuf, 24);
-        output += numBuf;
-        output += "\n      PrivateSegmentFixedSize: ";
-        itocstrCStyle(hasValue(kernel.privateSegmentFixedSize) ?
+                uint64_t(ULEV(kconfig.workgroupGroupSegmentSize)));
+        writer.put("\n      PrivateSegmentFixedSize: ");
+        writer.putNumber(hasValue(kernel.privateSegmentFixedSize) ?
                 kernel.privateSegmentFixedSize :
-                uint64_t(ULEV(kconfig.workitemPrivateSegmentSize)),
-                numBuf, 24);
-        output += numBuf;
-        output += "\n      KernargSegmentAlign: ";
-        itocstrCStyle(hasValue(kernel.kernargSegmentAlign) ?
+                uint64_t(ULEV(kconfig.workitemPrivateSegmentSize)));
+        writer.put("\n      KernargSegmentAlign: ");
+        writer.putNumber(hasValue(kernel.kernargSegmentAlign) ?
                 kernel.kernargSegmentAlign :
-                uint64_t(1ULL<<kconfig.kernargSegmentAlignment),
-                numBuf, 24);
-        output += numBuf;
-        output += "\n      WavefrontSize:   ";
-        itocstrCStyle(hasValue(kernel.wavefrontSize) ? kernel.wavefrontSize :
-                cxuint(1U<<kconfig.wavefrontSize), numBuf, 24);
-        output += numBuf;
-        output += "\n      NumSGPRs:        ";
-        itocstrCStyle(hasValue(kernel.sgprsNum) ? kernel.sgprsNum :
-                cxuint(ULEV(kconfig.wavefrontSgprCount)), numBuf, 24);
-        output += numBuf;
-        output += "\n      NumVGPRs:        ";
-        itocstrCStyle(hasValue(kernel.vgprsNum) ? kernel.vgprsNum :
-                cxuint(ULEV(kconfig.workitemVgprCount)), numBuf, 24);
-        output += numBuf;
+                uint64_t(1ULL<<kconfig.kernargSegmentAlignment));
+        writer.put("\n      WavefrontSize:   ");
+        writer.putNumber(hasValue(kernel.wavefrontSize) ? kernel.wavefrontSize :
+                cxuint(1U<<kconfig.wavefrontSize));
+        writer.put("\n      NumSGPRs:        ");
+        writer.putNumber(hasValue(kernel.sgprsNum) ? kernel.sgprsNum :
+                cxuint(ULEV(kconfig.wavefrontSgprCount)));
+        writer.put("\n      NumVGPRs:        ");
+        writer.putNumber(hasValue(kernel.vgprsNum) ? kernel.vgprsNum :
+                cxuint(ULEV(kconfig.workitemVgprCount)));
         // spilled registers
         if (hasValue(kernel.spilledSgprs))
         {
-            output += "\n      NumSpilledSGPRs: ";
-            itocstrCStyle(kernel.spilledSgprs, numBuf, 24);
-            output += numBuf;
+            writer.put("\n      NumSpilledSGPRs: ");
+            writer.putNumber(kernel.spilledSgprs);
         }
         if (hasValue(kernel.spilledVgprs))
         {
-            output += "\n      NumSpilledVGPRs: ";
-            itocstrCStyle(kernel.spilledVgprs, numBuf, 24);
-            output += numBuf;
+            writer.put("\n      NumSpilledVGPRs: ");
+            writer.putNumber(kernel.spilledVgprs);
         }
-        output += "\n      MaxFlatWorkGroupSize: ";
-        itocstrCStyle(hasValue(kernel.maxFlatWorkGroupSize) ?
-                    kernel.maxFlatWorkGroupSize : uint64_t(256), numBuf, 24);
-        output += numBuf;
-        output += "\n";
+        writer.put("\n      MaxFlatWorkGroupSize: ");
+        writer.putNumber(hasValue(kernel.maxFlatWorkGroupSize) ?
+                    kernel.maxFlatWorkGroupSize : uint64_t(256));
+        writer.put("\n");
         if (kernel.fixedWorkGroupSize[0] != 0 || kernel.fixedWorkGroupSize[1] != 0 ||
             kernel.fixedWorkGroupSize[2] != 0)
         {
-            output += "      FixedWorkGroupSize:   ";
-            genArrayValue(3, kernel.fixedWorkGroupSize, output);
+            writer.put("      FixedWorkGroupSize:   ");
+            writer.putArray(3, kernel.fixedWorkGroupSize);
         }
     }
-    output += "...\n";
+    writer.put("...\n");
+}
+
+void CLRX::generateROCmMetadata(const ROCmMetadata& mdInfo,
+                    const ROCmKernelConfig** kconfigs, std::string& output)
+{
+    // first pass: compute size of output
+    ROCmYAMLSizeCounter sizeCounter;
+    generateROCmMetadataYAML(mdInfo, kconfigs, sizeCounter);
+    // second pass: write directly to output
+    ROCmYAMLWriter writer(sizeCounter.getSize(), output);
+    generateROCmMetadataYAML(mdInfo, kconfigs, writer);
+    writer.finish();
 }
@@ -39,15 +39,66 @@ void parsePrintfInfoString(const char* ptr2, const char* end2, size_t oldLineNo,
 using namespace CLRX;
 
 // trim spaces (remove spaces from start and end)
-static std::string trimStrSpaces(const std::string& str)
+static MsgPackDataRef trimStrSpaces(MsgPackDataRef str)
 {
-    size_t i = 0;
-    const size_t sz = str.size();
-    while (i!=sz && isSpace(str[i])) i++;
-    if (i == sz) return "";
-    size_t j = sz-1;
-    while (j>i && isSpace(str[j])) j--;
-    return str.substr(i, j-i+1);
+    while (str.size != 0 && isSpace(str.data[0]))
+    { str.data++; str.size--; }
+    while (str.size != 0 && isSpace(str.data[str.size-1])) str.size--;
+    return str;
+}
+
+static inline CString toCString(const MsgPackDataRef& str)
+{ return CString(str.str(), str.str() + str.size); }
+
+// compare null-terminated string with string view
+static int compareMsgPackStr(const char* s1, const MsgPackDataRef& s2,
+                bool ignoreCase = false)
+{
+    const size_t len1 = ::strlen(s1);
+    const size_t len = std::min(len1, s2.size);
+    if (!ignoreCase)
+    {
+        const int ret = ::memcmp(s1, s2.data, len);
+        if (ret != 0)
+            return ret;
+    }
+    else
+        for (size_t i = 0; i < len; i++)
+        {
+            const cxbyte c1 = toLower(s1[i]);
+            const cxbyte c2 = toLower(char(s2.data[i]));
+            if (c1 != c2)
+                return int(c1) - int(c2);
+        }
+    return (len1 < s2.size) ? -1 : (len1 > s2.size) ? 1 : 0;
+}
+
+static inline bool equalMsgPackStr(const MsgPackDataRef& s1, const char* s2)
+{ return compareMsgPackStr(s2, s1) == 0; }
+
+// find string view in sorted table of names, returns tableSize if not found
+static size_t findMsgPackName(const char* const* table, size_t tableSize,
+                const MsgPackDataRef& name)
+{
+    const char* const* it = std::lower_bound(table, table + tableSize, name,
+            [](const char* a, const MsgPackDataRef& b)
+            { return compareMsgPackStr(a, b) < 0; });
+    if (it != table + tableSize && compareMsgPackStr(*it, name) == 0)
+        return it - table;
+    return tableSize;
+}
+
+// find string view in sorted map, returns mapSize if not found
+template<typename T>
+static size_t findMsgPackMapName(const std::pair<const char*, T>* map, size_t mapSize,
+                const MsgPackDataRef& name, bool ignoreCase = false)
+{
+    const std::pair<const char*, T>* it = std::lower_bound(map, map + mapSize, name,
+            [ignoreCase](const std::pair<const char*, T>& a, const MsgPackDataRef& b)
+            { return compareMsgPackStr(a.first, b, ignoreCase) < 0; });
+    if (it != map + mapSize && compareMsgPackStr(it->first, name, ignoreCase) == 0)
+        return it - map;
+    return mapSize;
 }
 
 /*
@@ -170,7 +221,8 @@ static double parseMsgPackFloat(const cxbyte*& dataPtr, const cxbyte* dataEnd)
         throw ParseException("MsgPack: Can't parse float value");
 }
 
-static std::string parseMsgPackString(const cxbyte*& dataPtr, const cxbyte* dataEnd)
+static MsgPackDataRef parseMsgPackStringRef(const cxbyte*& dataPtr,
+                const cxbyte* dataEnd)
 {
     if (dataPtr>=dataEnd)
         throw ParseException("MsgPack: Can't parse string");
@@ -207,13 +259,19 @@ static std::string parseMsgPackString(const cxbyte*& dataPtr, const cxbyte* data
     
     if (dataPtr+size > dataEnd)
         throw ParseException("MsgPack: Can't parse string");
-    const char* strData = reinterpret_cast<const char*>(dataPtr);
-    std::string out(strData, strData + size);
+    const MsgPackDataRef out = { dataPtr, size };
     dataPtr += size;
     return out;
 }
 
-static Array<cxbyte> parseMsgPackData(const cxbyte*& dataPtr, const cxbyte* dataEnd)
+static inline std::string parseMsgPackString(const cxbyte*& dataPtr,
+                const cxbyte* dataEnd)
+{
+    const MsgPackDataRef ref = parseMsgPackStringRef(dataPtr, dataEnd);
+    return std::string(ref.str(), ref.str() + ref.size);
+}
+
+static MsgPackDataRef parseMsgPackDataRef(const cxbyte*& dataPtr, const cxbyte* dataEnd)
 {
     if (dataPtr>=dataEnd)
         throw ParseException("MsgPack: Can't parse byte-array");
@@ -244,11 +302,18 @@ static Array<cxbyte> parseMsgPackData(const cxbyte*& dataPtr, const cxbyte* data
     
     if (dataPtr+size > dataEnd)
         throw ParseException("MsgPack: Can't parse byte-array");
-    Array<cxbyte> out(dataPtr, dataPtr + size);
+    const MsgPackDataRef out = { dataPtr, size };
     dataPtr += size;
     return out;
 }
 
+static inline Array<cxbyte> parseMsgPackData(const cxbyte*& dataPtr,
+                const cxbyte* dataEnd)
+{
+    const MsgPackDataRef ref = parseMsgPackDataRef(dataPtr, dataEnd);
+    return Array<cxbyte>(ref.data, ref.data + ref.size);
+}
+
 static void skipMsgPackObject(const cxbyte*& dataPtr, const cxbyte* dataEnd)
 {
     if (dataPtr>=dataEnd)
@@ -442,6 +507,22 @@ Array<cxbyte> MsgPackArrayParser::parseData()
     return v;
 }
 
+MsgPackDataRef MsgPackArrayParser::parseStringRef()
+{
+    handleErrors();
+    auto v = parseMsgPackStringRef(dataPtr, dataEnd);
+    count--;
+    return v;
+}
+
+MsgPackDataRef MsgPackArrayParser::parseDataRef()
+{
+    handleErrors();
+    auto v = parseMsgPackDataRef(dataPtr, dataEnd);
+    count--;
+    return v;
+}
+
 MsgPackArrayParser MsgPackArrayParser::parseArray()
 {
     handleErrors();
@@ -545,6 +626,22 @@ Array<cxbyte> MsgPackMapParser::parseKeyData()
     return v;
 }
 
+MsgPackDataRef MsgPackMapParser::parseKeyStringRef()
+{
+    handleErrors(true);
+    auto v = parseMsgPackStringRef(dataPtr, dataEnd);
+    keyLeft = false;
+    return v;
+}
+
+MsgPackDataRef MsgPackMapParser::parseKeyDataRef()
+{
+    handleErrors(true);
+    auto v = parseMsgPackDataRef(dataPtr, dataEnd);
+    keyLeft = false;
+    return v;
+}
+
 MsgPackArrayParser MsgPackMapParser::parseKeyArray()
 {
     handleErrors(true);
@@ -605,6 +702,24 @@ Array<cxbyte> MsgPackMapParser::parseValueData()
     return v;
 }
 
+MsgPackDataRef MsgPackMapParser::parseValueStringRef()
+{
+    handleErrors(false);
+    auto v = parseMsgPackStringRef(dataPtr, dataEnd);
+    keyLeft = true;
+    count--;
+    return v;
+}
+
+MsgPackDataRef MsgPackMapParser::parseValueDataRef()
+{
+    handleErrors(false);
+    auto v = parseMsgPackDataRef(dataPtr, dataEnd);
+    keyLeft = true;
+    count--;
+    return v;
+}
+
 MsgPackArrayParser MsgPackMapParser::parseValueArray()
 {
     handleErrors(false);
@@ -724,19 +839,18 @@ static void parseROCmMetadataKernelArgMsgPack(MsgPackArrayParser& argsParser,
     MsgPackMapParser aParser = argsParser.parseMap();
     while (aParser.haveElements())
     {
-        const std::string name = aParser.parseKeyString();
-        const size_t index = binaryFind(rocmMetadataMPKernelArgNames,
-                    rocmMetadataMPKernelArgNames + rocmMetadataMPKernelArgNamesSize,
-                    name.c_str(), CStringLess()) - rocmMetadataMPKernelArgNames;
+        const MsgPackDataRef name = aParser.parseKeyStringRef();
+        const size_t index = findMsgPackName(rocmMetadataMPKernelArgNames,
+                    rocmMetadataMPKernelArgNamesSize, name);
         switch(index)
         {
             case ROCMMP_ARG_ACCESS:
             case ROCMMP_ARG_ACTUAL_ACCESS:
             {
-                const std::string acc = trimStrSpaces(aParser.parseValueString());
+                const MsgPackDataRef acc = trimStrSpaces(aParser.parseValueStringRef());
                 size_t accIndex = 0;
                 for (; accIndex < 3; accIndex++)
-                    if (::strcmp(rocmMPAccessQualifierTbl[accIndex], acc.c_str())==0)
+                    if (equalMsgPackStr(acc, rocmMPAccessQualifierTbl[accIndex]))
                         break;
                 if (accIndex == 3)
                     throw ParseException("Wrong access qualifier");
@@ -748,11 +862,12 @@ static void parseROCmMetadataKernelArgMsgPack(MsgPackArrayParser& argsParser,
             }
             case ROCMMP_ARG_ADDRESS_SPACE:
             {
-                const std::string aspace = trimStrSpaces(aParser.parseValueString());
+                const MsgPackDataRef aspace =
+                            trimStrSpaces(aParser.parseValueStringRef());
                 size_t aspaceIndex = 0;
                 for (; aspaceIndex < 6; aspaceIndex++)
-                    if (::strcasecmp(rocmMPAddrSpaceTypesTbl[aspaceIndex],
-                                aspace.c_str())==0)
+                    if (compareMsgPackStr(rocmMPAddrSpaceTypesTbl[aspaceIndex],
+                                aspace, true)==0)
                         break;
                 if (aspaceIndex == 6)
                     throw ParseException("Wrong address space");
@@ -772,7 +887,7 @@ static void parseROCmMetadataKernelArgMsgPack(MsgPackArrayParser& argsParser,
                 argInfo.isVolatile = aParser.parseValueBool();
                 break;
             case ROCMMP_ARG_NAME:
-                argInfo.name = aParser.parseValueString();
+                argInfo.name = toCString(aParser.parseValueStringRef());
                 break;
             case ROCMMP_ARG_OFFSET:
                 argInfo.offset = aParser.parseValueInteger(MSGPACK_WS_UNSIGNED);
@@ -784,14 +899,13 @@ static void parseROCmMetadataKernelArgMsgPack(MsgPackArrayParser& argsParser,
                 argInfo.size = aParser.parseValueInteger(MSGPACK_WS_UNSIGNED);
                 break;
             case ROCMMP_ARG_TYPE_NAME:
-                argInfo.typeName = aParser.parseValueString();
+                argInfo.typeName = toCString(aParser.parseValueStringRef());
                 break;
             case ROCMMP_ARG_VALUE_KIND:
             {
-                const std::string vkind = trimStrSpaces(aParser.parseValueString());
-                const size_t vkindIndex = binaryMapFind(rocmMPValueKindNamesMap,
-                            rocmMPValueKindNamesMap + rocmMPValueKindNamesNum, vkind.c_str(),
-                            CStringLess()) - rocmMPValueKindNamesMap;
+                const MsgPackDataRef vkind = trimStrSpaces(aParser.parseValueStringRef());
+                const size_t vkindIndex = findMsgPackMapName(rocmMPValueKindNamesMap,
+                            rocmMPValueKindNamesNum, vkind);
                     // if unknown kind
                     if (vkindIndex == rocmMPValueKindNamesNum)
                         throw ParseException("Wrong argument value kind");
@@ -800,10 +914,9 @@ static void parseROCmMetadataKernelArgMsgPack(MsgPackArrayParser& argsParser,
             }
             case ROCMMP_ARG_VALUE_TYPE:
             {
-                const std::string vtype = trimStrSpaces(aParser.parseValueString());
-                const size_t vtypeIndex = binaryMapFind(rocmValueTypeNamesMap,
-                        rocmValueTypeNamesMap + rocmValueTypeNamesNum, vtype.c_str(),
-                        CStringCaseLess()) - rocmValueTypeNamesMap;
+                const MsgPackDataRef vtype = trimStrSpaces(aParser.parseValueStringRef());
+                const size_t vtypeIndex = findMsgPackMapName(rocmValueTypeNamesMap,
+                        rocmValueTypeNamesNum, vtype, true);
                 // if unknown type
                 if (vtypeIndex == rocmValueTypeNamesNum)
                     throw ParseException("Wrong argument value type");
@@ -848,10 +961,9 @@ static void parseROCmMetadataKernelMsgPack(MsgPackArrayParser& kernelsParser,
     MsgPackMapParser kParser = kernelsParser.parseMap();
     while (kParser.haveElements())
     {
-        const std::string name = kParser.parseKeyString();
-        const size_t index = binaryFind(rocmMetadataMPKernelNames,
-                    rocmMetadataMPKernelNames + rocmMetadataMPKernelNamesSize,
-                    name.c_str(), CStringLess()) - rocmMetadataMPKernelNames;
+        const MsgPackDataRef name = kParser.parseKeyStringRef();
+        const size_t index = findMsgPackName(rocmMetadataMPKernelNames,
+                    rocmMetadataMPKernelNamesSize, name);
         
         switch(index)
         {
@@ -860,14 +972,14 @@ static void parseROCmMetadataKernelMsgPack(MsgPackArrayParser& kernelsParser,
                 MsgPackArrayParser argsParser = kParser.parseValueArray();
                 while (argsParser.haveElements())
                 {
-                    ROCmKernelArgInfo arg{};
-                    parseROCmMetadataKernelArgMsgPack(argsParser, arg);
-                    kernel.argInfos.push_back(arg);
+                    // parse directly into the new argument
+                    kernel.argInfos.push_back(ROCmKernelArgInfo{});
+                    parseROCmMetadataKernelArgMsgPack(argsParser, kernel.argInfos.back());
                 }
                 break;
             }
             case ROCMMP_KERNEL_DEVICE_ENQUEUE_SYMBOL:
-                kernel.deviceEnqueueSymbol = kParser.parseValueString();
+                kernel.deviceEnqueueSymbol = toCString(kParser.parseValueStringRef());
                 break;
             case ROCMMP_KERNEL_GROUP_SEGMENT_FIXED_SIZE:
                 kernel.groupSegmentFixedSize = kParser.
@@ -882,7 +994,7 @@ static void parseROCmMetadataKernelMsgPack(MsgPackArrayParser& kernelsParser,
                                     parseValueInteger(MSGPACK_WS_UNSIGNED);
                 break;
             case ROCMMP_KERNEL_LANGUAGE:
-                kernel.language = kParser.parseValueString();
+                kernel.language = toCString(kParser.parseValueStringRef());
                 break;
             case ROCMMP_KERNEL_LANGUAGE_VERSION:
                 parseMsgPackValueTypedArrayForMap(kParser, kernel.langVersion,
@@ -893,7 +1005,7 @@ static void parseROCmMetadataKernelMsgPack(MsgPackArrayParser& kernelsParser,
                                     parseValueInteger(MSGPACK_WS_UNSIGNED);
                 break;
             case ROCMMP_KERNEL_NAME:
-                kernel.name = kParser.parseValueString();
+                kernel.name = toCString(kParser.parseValueStringRef());
                 break;
             case ROCMMP_KERNEL_PRIVATE_SEGMENT_FIXED_SIZE:
                 kernel.privateSegmentFixedSize = kParser.
@@ -910,10 +1022,10 @@ static void parseROCmMetadataKernelMsgPack(MsgPackArrayParser& kernelsParser,
                 kernel.spilledSgprs = kParser.parseValueInteger(MSGPACK_WS_UNSIGNED);
                 break;
             case ROCMMP_KERNEL_SYMBOL:
-                kernel.symbolName = kParser.parseValueString();
+                kernel.symbolName = toCString(kParser.parseValueStringRef());
                 break;
             case ROCMMP_KERNEL_VEC_TYPE_HINT:
-                kernel.vecTypeHint = kParser.parseValueString();
+                kernel.vecTypeHint = toCString(kParser.parseValueStringRef());
                 break;
             case ROCMMP_KERNEL_VGPR_COUNT:
                 kernel.vgprsNum = kParser.parseValueInteger(MSGPACK_WS_UNSIGNED);
@@ -948,30 +1060,30 @@ void CLRX::parseROCmMetadataMsgPack(size_t metadataSize, const cxbyte* metadata,
     MsgPackMapParser mainMap(metadata, metadata+metadataSize);
     while (mainMap.haveElements())
     {
-        const CString name = mainMap.parseKeyString();
-        if (name == "amdhsa.version")
+        const MsgPackDataRef name = mainMap.parseKeyStringRef();
+        if (equalMsgPackStr(name, "amdhsa.version"))
             parseMsgPackValueTypedArrayForMap(mainMap, metadataInfo.version,
                                         2, MSGPACK_WS_UNSIGNED);
-        else if (name == "amdhsa.kernels")
+        else if (equalMsgPackStr(name, "amdhsa.kernels"))
         {
             MsgPackArrayParser kernelsParser = mainMap.parseValueArray();
             while (kernelsParser.haveElements())
             {
-                ROCmKernelMetadata kernel{};
-                kernel.initialize();
-                parseROCmMetadataKernelMsgPack(kernelsParser, kernel);
-                kernels.push_back(kernel);
+                // parse directly into the new kernel
+                kernels.push_back(ROCmKernelMetadata{});
+                kernels.back().initialize();
+                parseROCmMetadataKernelMsgPack(kernelsParser, kernels.back());
             }
         }
-        else if (name == "amdhsa.printf")
+        else if (equalMsgPackStr(name, "amdhsa.printf"))
         {
             std::unordered_set<cxuint> printfIds;
             MsgPackArrayParser printfsParser = mainMap.parseValueArray();
             while (printfsParser.haveElements())
             {
                 ROCmPrintfInfo printfInfo{};
-                std::string pistr = printfsParser.parseString();
-                parsePrintfInfoString(pistr.c_str(), pistr.c_str() + pistr.size(),
+                const MsgPackDataRef pistr = printfsParser.parseStringRef();
+                parsePrintfInfoString(pistr.str(), pistr.str() + pistr.size,
                                 0, 0, printfInfo, printfIds);
                 metadataInfo.printfInfos.push_back(printfInfo);
             }
@@ -1242,13 +1354,141 @@ static std::string escapePrintfFormat(const std::string& fmt)
     return out;
 }
 
-void CLRX::generateROCmMetadataMsgPack(const ROCmMetadata& mdInfo,
-                    const ROCmKernelDescriptor** kdescs, std::vector<cxbyte>& output)
+/* MsgPack metadata is generated in two passes: first pass computes size of output,
+ * second pass writes MsgPack data directly to preallocated output */
+
+/// computes size of MsgPack data
+class CLRX_INTERNAL MsgPackSizeCounter
 {
-    output.clear();
-    MsgPackMapWriter writer(2 + (!mdInfo.printfInfos.empty()), output);
-    writer.putKeyString("amdhsa.kernels");
-    MsgPackArrayWriter kernelsWriter = writer.putValueArray(mdInfo.kernels.size());
+private:
+    size_t size;
+public:
+    MsgPackSizeCounter() : size(0)
+    { }
+    
+    void putArray(size_t elemsNum)
+    { size += (elemsNum < 16) ? 1 : (elemsNum < 0x10000U) ? 3 : 5; }
+    void putMap(size_t elemsNum)
+    { size += (elemsNum < 16) ? 1 : (elemsNum < 0x10000U) ? 3 : 5; }
+    void putString(const char* str, size_t len)
+    { size += ((len < 32) ? 1 : (len < 256) ? 2 : (len < 0x10000U) ? 3 : 5) + len; }
+    void putString(const char* str)
+    { putString(str, ::strlen(str)); }
+    void putBool(bool b)
+    { size++; }
+    void putUInt(uint64_t v)
+    {
+        size += (v < 128) ? 1 : (v < 256) ? 2 : (v < 0x10000U) ? 3 :
+                (v < 0x100000000ULL) ? 5 : 9;
+    }
+    
+    size_t getSize() const
+    { return size; }
+};
+
+/// writes MsgPack data to preallocated output
+class CLRX_INTERNAL MsgPackRawWriter
+{
+private:
+    cxbyte* out;
+    
+    void putBigEndian(uint64_t v, cxuint bytesNum)
+    {
+        for (cxuint i = bytesNum; i > 0; i--, v>>=8)
+            out[i-1] = v&0xff;
+        out += bytesNum;
+    }
+    
+    void putContainer(size_t elemsNum, cxbyte fixCode, cxbyte code16)
+    {
+        if (elemsNum < 16)
+            *out++ = fixCode + elemsNum;
+        else if (elemsNum < 0x10000U)
+        {
+            *out++ = code16;
+            putBigEndian(elemsNum, 2);
+        }
+        else
+        {
+            *out++ = code16+1;
+            putBigEndian(elemsNum, 4);
+        }
+    }
+public:
+    explicit MsgPackRawWriter(cxbyte* _out) : out(_out)
+    { }
+    
+    void putArray(size_t elemsNum)
+    { putContainer(elemsNum, 0x90, 0xdc); }
+    void putMap(size_t elemsNum)
+    { putContainer(elemsNum, 0x80, 0xde); }
+    
+    void putString(const char* str, size_t len)
+    {
+        if (len < 32)
+            *out++ = 0xa0 + len;
+        else if (len < 256)
+        {
+            *out++ = 0xd9;
+            *out++ = len;
+        }
+        else if (len < 0x10000U)
+        {
+            *out++ = 0xda;
+            putBigEndian(len, 2);
+        }
+        else
+        {
+            *out++ = 0xdb;
+            putBigEndian(len, 4);
+        }
+        ::memcpy(out, str, len);
+        out += len;
+    }
+    void putString(const char* str)
+    { putString(str, ::strlen(str)); }
+    
+    void putBool(bool b)
+    { *out++ = b ? 0xc3 : 0xc2; }
+    
+    void putUInt(uint64_t v)
+    {
+        if (v < 128)
+            *out++ = cxbyte(v);
+        else if (v < 256)
+        {
+            *out++ = 0xcc;
+            *out++ = cxbyte(v);
+        }
+        else if (v < 0x10000U)
+        {
+            *out++ = 0xcd;
+            putBigEndian(v, 2);
+        }
+        else if (v < 0x100000000ULL)
+        {
+            *out++ = 0xce;
+            putBigEndian(v, 4);
+        }
+        else
+        {
+            *out++ = 0xcf;
+            putBigEndian(v, 8);
+        }
+    }
+    
+    const cxbyte* getCurrent() const
+    { return out; }
+};
+
+template<typename MPWriter>
+static void generateROCmMetadataMsgPackData(const ROCmMetadata& mdInfo,
+                    const ROCmKernelDescriptor** kdescs,
+                    const std::vector<std::string>& printfStrings, MPWriter& writer)
+{
+    writer.putMap(2 + (!mdInfo.printfInfos.empty()));
+    writer.putString("amdhsa.kernels");
+    writer.putArray(mdInfo.kernels.size());
     for (size_t i = 0; i < mdInfo.kernels.size(); i++)
     {
         const ROCmKernelMetadata& kernelMD = mdInfo.kernels[i];
@@ -1262,11 +1502,10 @@ void CLRX::generateROCmMetadataMsgPack(const ROCmMetadata& mdInfo,
                  kernelMD.workGroupSizeHint[2]!=0) +
                 (!kernelMD.language.empty()) +
                 (kernelMD.langVersion[0]!=BINGEN_NOTSUPPLIED);
-        MsgPackMapWriter kwriter = kernelsWriter.putMap(mapSize);
-        kwriter.putKeyString(".args");
+        writer.putMap(mapSize);
+        writer.putString(".args");
         // kernel arguments
-        {
-        MsgPackArrayWriter kargsWriter = kwriter.putValueArray(kernelMD.argInfos.size());
+        writer.putArray(kernelMD.argInfos.size());
         for (const ROCmKernelArgInfo& arg: kernelMD.argInfos)
         {
             const bool hasAccess = (arg.accessQual != ROCmAccessQual::DEFAULT &&
@@ -1284,160 +1523,172 @@ void CLRX::generateROCmMetadataMsgPack(const ROCmMetadata& mdInfo,
                     (arg.isRestrict) + (arg.isVolatile) +
                     (!arg.name.empty()) + (!arg.typeName.empty()) +
                      hasAddrSpace + hasAccess + hasActualAccess + (arg.pointeeAlign!=0);
-            MsgPackMapWriter argWriter = kargsWriter.putMap(amapSize);
+            writer.putMap(amapSize);
             if (hasAccess)
             {
                 if (arg.accessQual > ROCmAccessQual::MAX_VALUE)
                     throw BinGenException("Unknown AccessQualifier");
-                argWriter.putKeyString(".access");
-                argWriter.putValueString(
-                        rocmMPAccessQualifierTbl[cxuint(arg.accessQual)-1]);
+                writer.putString(".access");
+                writer.putString(rocmMPAccessQualifierTbl[cxuint(arg.accessQual)-1]);
             }
             if (hasActualAccess)
             {
                 if (arg.actualAccessQual > ROCmAccessQual::MAX_VALUE)
                     throw BinGenException("Unknown ActualAccessQualifier");
-                argWriter.putKeyString(".actual_access");
-                argWriter.putValueString(
-                        rocmMPAccessQualifierTbl[cxuint(arg.actualAccessQual)-1]);
+                writer.putString(".actual_access");
+                writer.putString(rocmMPAccessQualifierTbl[cxuint(arg.actualAccessQual)-1]);
             }
             if (hasAddrSpace)
             {
                 if (arg.addressSpace > ROCmAddressSpace::MAX_VALUE ||
                     arg.addressSpace == ROCmAddressSpace::NONE)
                     throw BinGenException("Unknown AddressSpace");
-                argWriter.putKeyString(".address_space");
-                argWriter.putValueString(
-                        rocmMPAddrSpaceTypesTbl[cxuint(arg.addressSpace)-1]);
+                writer.putString(".address_space");
+                writer.putString(rocmMPAddrSpaceTypesTbl[cxuint(arg.addressSpace)-1]);
             }
             if (arg.isConst)
             {
-                argWriter.putKeyString(".is_const");
-                argWriter.putValueBool(true);
+                writer.putString(".is_const");
+                writer.putBool(true);
             }
             if (arg.isPipe)
             {
-                argWriter.putKeyString(".is_pipe");
-                argWriter.putValueBool(true);
+                writer.putString(".is_pipe");
+                writer.putBool(true);
             }
             if (arg.isRestrict)
             {
-                argWriter.putKeyString(".is_restrict");
-                argWriter.putValueBool(true);
+                writer.putString(".is_restrict");
+                writer.putBool(true);
             }
             if (arg.isVolatile)
             {
-                argWriter.putKeyString(".is_volatile");
-                argWriter.putValueBool(true);
+                writer.putString(".is_volatile");
+                writer.putBool(true);
             }
             if (!arg.name.empty())
             {
-                argWriter.putKeyString(".name");
-                argWriter.putValueString(arg.name.c_str());
+                writer.putString(".name");
+                writer.putString(arg.name.c_str(), arg.name.size());
             }
-            argWriter.putKeyString(".offset");
-            argWriter.putValueUInt(arg.offset);
-            argWriter.putKeyString(".size");
-            argWriter.putValueUInt(arg.size);
+            writer.putString(".offset");
+            writer.putUInt(arg.offset);
+            writer.putString(".size");
+            writer.putUInt(arg.size);
             if (arg.pointeeAlign!=0)
             {
-                argWriter.putKeyString(".pointee_align");
-                argWriter.putValueUInt(arg.pointeeAlign);
+                writer.putString(".pointee_align");
+                writer.putUInt(arg.pointeeAlign);
             }
             if (!arg.typeName.empty())
             {
-                argWriter.putKeyString(".type_name");
-                argWriter.putValueString(arg.typeName.c_str());
+                writer.putString(".type_name");
+                writer.putString(arg.typeName.c_str(), arg.typeName.size());
             }
             
             if (arg.valueKind > ROCmValueKind::MAX_VALUE)
                 throw BinGenException("Unknown ValueKind");
-            argWriter.putKeyString(".value_kind");
-            argWriter.putValueString(rocmMPValueKindNames[cxuint(arg.valueKind)]);
+            writer.putString(".value_kind");
+            writer.putString(rocmMPValueKindNames[cxuint(arg.valueKind)]);
             
             if (arg.valueType > ROCmValueType::MAX_VALUE)
                 throw BinGenException("Unknown ValueType");
-            argWriter.putKeyString(".value_type");
-            argWriter.putValueString(rocmMPValueTypeNames[cxuint(arg.valueType)]);
+            writer.putString(".value_type");
+            writer.putString(rocmMPValueTypeNames[cxuint(arg.valueType)]);
         }
-        } //
         if (!kernelMD.deviceEnqueueSymbol.empty())
         {
-            kwriter.putKeyString(".device_enqueue_symbol");
-            kwriter.putValueString(kernelMD.deviceEnqueueSymbol.c_str());
+            writer.putString(".device_enqueue_symbol");
+            writer.putString(kernelMD.deviceEnqueueSymbol.c_str(),
+                        kernelMD.deviceEnqueueSymbol.size());
         }
         
         const ROCmKernelDescriptor& kdesc = *(kdescs[i]);
         
-        kwriter.putKeyString(".group_segment_fixed_size");
-        kwriter.putValueUInt(hasValue(kernelMD.groupSegmentFixedSize) ?
+        writer.putString(".group_segment_fixed_size");
+        writer.putUInt(hasValue(kernelMD.groupSegmentFixedSize) ?
                 kernelMD.groupSegmentFixedSize : ULEV(kdesc.groupSegmentFixedSize));
-        kwriter.putKeyString(".kernarg_segment_align");
-        kwriter.putValueUInt(kernelMD.kernargSegmentAlign);
-        kwriter.putKeyString(".kernarg_segment_size");
-        kwriter.putValueUInt(kernelMD.kernargSegmentSize);
+        writer.putString(".kernarg_segment_align");
+        writer.putUInt(kernelMD.kernargSegmentAlign);
+        writer.putString(".kernarg_segment_size");
+        writer.putUInt(kernelMD.kernargSegmentSize);
         
         if (!kernelMD.language.empty())
         {
-            kwriter.putKeyString(".language");
-            kwriter.putValueString(kernelMD.language.c_str());
+            writer.putString(".language");
+            writer.putString(kernelMD.language.c_str(), kernelMD.language.size());
         }
         if (kernelMD.langVersion[0]!=BINGEN_NOTSUPPLIED)
         {
-            kwriter.putKeyString(".language_version");
-            MsgPackArrayWriter verWriter = kwriter.putValueArray(2);
-            verWriter.putUInt(kernelMD.langVersion[0]);
-            verWriter.putUInt(kernelMD.langVersion[1]);
+            writer.putString(".language_version");
+            writer.putArray(2);
+            writer.putUInt(kernelMD.langVersion[0]);
+            writer.putUInt(kernelMD.langVersion[1]);
         }
         
-        kwriter.putKeyString(".max_flat_workgroup_size");
-        kwriter.putValueUInt(kernelMD.maxFlatWorkGroupSize);
-        kwriter.putKeyString(".name");
-        kwriter.putValueString(kernelMD.name.c_str());
-        kwriter.putKeyString(".private_segment_fixed_size");
-        kwriter.putValueUInt(hasValue(kernelMD.privateSegmentFixedSize) ?
+        writer.putString(".max_flat_workgroup_size");
+        writer.putUInt(kernelMD.maxFlatWorkGroupSize);
+        writer.putString(".name");
+        writer.putString(kernelMD.name.c_str(), kernelMD.name.size());
+        writer.putString(".private_segment_fixed_size");
+        writer.putUInt(hasValue(kernelMD.privateSegmentFixedSize) ?
                 kernelMD.privateSegmentFixedSize : ULEV(kdesc.privateSegmentFixedSize));
         
         if (kernelMD.reqdWorkGroupSize[0] != 0 || kernelMD.reqdWorkGroupSize[1] != 0 ||
             kernelMD.reqdWorkGroupSize[2] != 0)
         {
-            kwriter.putKeyString(".reqd_workgroup_size");
-            MsgPackArrayWriter rwriter = kwriter.putValueArray(3);
+            writer.putString(".reqd_workgroup_size");
+            writer.putArray(3);
             for (cxuint i = 0; i < 3; i++)
-                rwriter.putUInt(kernelMD.reqdWorkGroupSize[i]);
+                writer.putUInt(kernelMD.reqdWorkGroupSize[i]);
         }
         
-        kwriter.putKeyString(".sgpr_count");
-        kwriter.putValueUInt(kernelMD.sgprsNum);
-        kwriter.putKeyString(".sgpr_spill_count");
-        kwriter.putValueUInt(kernelMD.spilledSgprs);
-        kwriter.putKeyString(".symbol");
-        kwriter.putValueString(kernelMD.symbolName.c_str());
+        writer.putString(".sgpr_count");
+        writer.putUInt(kernelMD.sgprsNum);
+        writer.putString(".sgpr_spill_count");
+        writer.putUInt(kernelMD.spilledSgprs);
+        writer.putString(".symbol");
+        writer.putString(kernelMD.symbolName.c_str(), kernelMD.symbolName.size());
         if (!kernelMD.vecTypeHint.empty())
         {
-            kwriter.putKeyString(".vec_type_hint");
-            kwriter.putValueString(kernelMD.vecTypeHint.c_str());
+            writer.putString(".vec_type_hint");
+            writer.putString(kernelMD.vecTypeHint.c_str(), kernelMD.vecTypeHint.size());
         }
-        kwriter.putKeyString(".vgpr_count");
-        kwriter.putValueUInt(kernelMD.vgprsNum);
-        kwriter.putKeyString(".vgpr_spill_count");
-        kwriter.putValueUInt(kernelMD.spilledVgprs);
-        kwriter.putKeyString(".wavefront_size");
-        kwriter.putValueUInt(kernelMD.wavefrontSize);
+        writer.putString(".vgpr_count");
+        writer.putUInt(kernelMD.vgprsNum);
+        writer.putString(".vgpr_spill_count");
+        writer.putUInt(kernelMD.spilledVgprs);
+        writer.putString(".wavefront_size");
+        writer.putUInt(kernelMD.wavefrontSize);
         
         if (kernelMD.workGroupSizeHint[0] != 0 || kernelMD.workGroupSizeHint[1] != 0 ||
             kernelMD.workGroupSizeHint[2] != 0)
         {
-            kwriter.putKeyString(".workgroup_size_hint");
-            MsgPackArrayWriter rwriter = kwriter.putValueArray(3);
+            writer.putString(".workgroup_size_hint");
+            writer.putArray(3);
             for (cxuint i = 0; i < 3; i++)
-                rwriter.putUInt(kernelMD.workGroupSizeHint[i]);
+                writer.putUInt(kernelMD.workGroupSizeHint[i]);
         }
     }
     if (!mdInfo.printfInfos.empty())
     {
-        writer.putKeyString("amdhsa.printf");
-        MsgPackArrayWriter pwriter = writer.putValueArray(mdInfo.printfInfos.size());
+        writer.putString("amdhsa.printf");
+        writer.putArray(printfStrings.size());
+        for (const std::string& prStr: printfStrings)
+            writer.putString(prStr.c_str(), prStr.size());
+    }
+    writer.putString("amdhsa.version");
+    writer.putArray(2);
+    writer.putUInt(mdInfo.version[0]);
+    writer.putUInt(mdInfo.version[1]);
+}
+
+void CLRX::generateROCmMetadataMsgPack(const ROCmMetadata& mdInfo,
+                    const ROCmKernelDescriptor** kdescs, std::vector<cxbyte>& output)
+{
+    std::vector<std::string> printfStrings;
+    if (!mdInfo.printfInfos.empty())
+    {
         std::unordered_set<cxuint> printfIds;
         for (const ROCmPrintfInfo& printfInfo: mdInfo.printfInfos)
             if (printfInfo.id!=BINGEN_DEFAULT)
@@ -1446,6 +1697,7 @@ void CLRX::generateROCmMetadataMsgPack(const ROCmMetadata& mdInfo,
         // printfs
         uint32_t freePrintfId = 1;
         char numBuf[24];
+        printfStrings.reserve(mdInfo.printfInfos.size());
         for (const ROCmPrintfInfo& printfInfo: mdInfo.printfInfos)
         {
             // skip used printfids;
@@ -1472,13 +1724,18 @@ void CLRX::generateROCmMetadataMsgPack(const ROCmMetadata& mdInfo,
                 prStr += ':';
             }
             // printf format
-            std::string escaped = escapePrintfFormat(printfInfo.format.c_str());
-            prStr += escaped;
-            pwriter.putString(prStr.c_str());
+            prStr += escapePrintfFormat(printfInfo.format.c_str());
+            printfStrings.push_back(std::move(prStr));
         }
     }
-    writer.putKeyString("amdhsa.version");
-    MsgPackArrayWriter vwriter = writer.putValueArray(2);
-    vwriter.putUInt(mdInfo.version[0]);
-    vwriter.putUInt(mdInfo.version[1]);
+    
+    // first pass: compute size of output
+    MsgPackSizeCounter sizeCounter;
+    generateROCmMetadataMsgPackData(mdInfo, kdescs, printfStrings, sizeCounter);
+    // second pass: write directly to output
+    output.resize(sizeCounter.getSize());
+    MsgPackRawWriter writer(output.data());
+    generateROCmMetadataMsgPackData(mdInfo, kdescs, printfStrings, writer);
+    if (writer.getCurrent() != output.data() + output.size())
+        throw BinGenException("MsgPack: Wrong size of generated metadata");
 }
@@ -27,6 +27,7 @@
 #include <CLRX/amdbin/AmdBinaries.h>
 #include <CLRX/amdbin/GalliumBinaries.h>
 #include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdasm/GCNPerfModel.h>
 
 using namespace CLRX;
 
@@ -63,6 +64,33 @@ static const CLIOption programOptions[] =
         "use old modifier parametrization", nullptr },
     { "noMacroCase", 'm', CLIArgType::NONE, false, false,
         "do not ignore letter's case in macro names", nullptr },
+    { "regAlloc", 'R', CLIArgType::NONE, false, false,
+        "allocate registers for register variables", nullptr },
+    { "occupancy", 0, CLIArgType::UINT, false, false,
+        "set target occupancy (waves per SIMD) for register allocation", "WAVES" },
+    { "regAllocStats", 0, CLIArgType::NONE, false, false,
+        "print register allocation statistics", nullptr },
+    { "regPressure", 0, CLIArgType::NONE, false, false,
+        "print register pressure and occupancy report (in JSON format)", nullptr },
+    { "perfModel", 0, CLIArgType::NONE, false, false,
+        "print static performance model report (in JSON format)", nullptr },
+    { "autoWait", 0, CLIArgType::NONE, false, false,
+        "insert waits for results of delayed operations", nullptr },
+    { "checkWaits", 0, CLIArgType::NONE, false, false,
+        "warn about waits that wait for more than needed", nullptr },
+    { "relaxWaits", 0, CLIArgType::NONE, false, false,
+        "relax waits that wait for more than needed", nullptr },
+    { "schedule", 0, CLIArgType::NONE, false, false,
+        "schedule instructions in basic blocks to hide latencies", nullptr },
+    { "shrink", 0, CLIArgType::NONE, false, false,
+        "choose shortest encoding of instructions", nullptr },
+    { "shrinkStats", 0, CLIArgType::NONE, false, false,
+        "print number of code bytes saved by shrinking", nullptr },
+    { "mergeStrings", 0, CLIArgType::NONE, false, false,
+        "merge strings in string tables of binaries", nullptr },
+    { "threads", 'j', CLIArgType::UINT, false, false,
+        "set number of threads for processing code and generating binary "
+        "(0 - all CPUs)", "THREADS" },
     { "policy", 0, CLIArgType::UINT, false, false,
         "set policy version", "VERSION" },
     { "noWarnings", 'w', CLIArgType::NONE, false, false, "disable warnings", nullptr },
@@ -141,6 +169,22 @@ try
         flags |= ASM_OLDMODPARAM;
     if (cli.hasShortOption('3'))
         flags |= ASM_WAVE32;
+    if (cli.hasShortOption('R') || cli.hasLongOption("occupancy"))
+        flags |= ASM_REGALLOC;
+    if (cli.hasLongOption("regPressure"))
+        flags |= ASM_REGPRESSURE;
+    if (cli.hasLongOption("autoWait"))
+        flags |= ASM_AUTOWAIT;
+    if (cli.hasLongOption("checkWaits"))
+        flags |= ASM_CHECKWAITS;
+    if (cli.hasLongOption("relaxWaits"))
+        flags |= ASM_RELAXWAITS;
+    if (cli.hasLongOption("schedule"))
+        flags |= ASM_SCHEDULE;
+    if (cli.hasLongOption("shrink") || cli.hasLongOption("shrinkStats"))
+        flags |= ASM_SHRINK;
+    if (cli.hasLongOption("mergeStrings"))
+        flags |= ASM_MERGESTRINGS;
     if (cli.hasLongOption("newROCmBinFormat"))
         newROCmBinFormat = true;
     if (cli.hasLongOption("policy"))
@@ -165,6 +209,10 @@ try
     assembler->setNewROCmBinFormat(newROCmBinFormat);
     if (havePolicy)
         assembler->setPolicyVersion(policyVersion);
+    if (cli.hasLongOption("occupancy"))
+        assembler->setTargetOccupancy(cli.getLongOptArg<cxuint>("occupancy"));
+    if (cli.hasShortOption('j'))
+        assembler->setThreadsNum(cli.getShortOptArg<cxuint>('j'));
     
     size_t defSymsNum = 0;
     const char* const* defSyms = nullptr;
@@ -232,6 +280,22 @@ try
     if (cli.hasShortOption('o'))
         outputName = cli.getShortOptArg<const char*>('o');
     assembler->writeBinary(outputName);
+    if (cli.hasLongOption("regAllocStats"))
+        std::cout << "Coalesced moves: " << assembler->getCoalescedMovesNum() <<
+                "\nRemoved moves: " << assembler->getRemovedMovesNum() <<
+                "\nSpilled SGPRs: " << assembler->getSpilledRegsNums()[REGTYPE_SGPR] <<
+                "\nSpilled VGPRs: " << assembler->getSpilledRegsNums()[REGTYPE_VGPR] <<
+                std::endl;
+    if (cli.hasLongOption("shrinkStats"))
+        std::cout << "Saved bytes: " << assembler->getSavedBytesNum() << std::endl;
+    if (cli.hasLongOption("regPressure"))
+        assembler->writeRegPressureReport(std::cout);
+    if (cli.hasLongOption("perfModel"))
+    {
+        GCNPerfModel perfModel(assembler->getDeviceType());
+        perfModel.analyzeAssembler(*assembler);
+        perfModel.writeReport(std::cout);
+    }
     return 0;
 }
 catch(const Exception& ex)
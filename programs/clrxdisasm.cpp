@@ -19,7 +19,12 @@
 
 #include <CLRX/Config.h>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <CLRX/utils/Utilities.h>
 #include <CLRX/utils/CLIParser.h>
 #include <CLRX/amdbin/AmdBinaries.h>
@@ -27,6 +32,7 @@
 #include <CLRX/amdbin/ROCmBinaries.h>
 #include <CLRX/amdbin/GalliumBinaries.h>
 #include <CLRX/amdasm/Disassembler.h>
+#include <CLRX/amdasm/GCNPerfModel.h>
 
 using namespace CLRX;
 
@@ -59,10 +65,159 @@ static const CLIOption programOptions[] =
         "set LLVM version (for Gallium)", "VERSION" },
     { "buggyFPLit", 0, CLIArgType::NONE, false, false,
         "use old and buggy fplit rules", nullptr },
+    { "perfModel", 0, CLIArgType::NONE, false, false,
+        "print static performance model report (in JSON format)", nullptr },
+    { "threads", 'j', CLIArgType::UINT, false, false,
+        "set number of threads to process files (0 - all CPUs)", "THREADS" },
     CLRX_CLI_AUTOHELP
     { nullptr, 0 }
 };
 
+// options of disassembling
+struct DisasmOptions
+{
+    Flags disasmFlags;
+    bool fromRawCode;
+    bool hasGPUDeviceType;
+    GPUDeviceType gpuDeviceType;
+    cxuint driverVersion;
+    cxuint llvmVersion;
+    bool perfModel;
+};
+
+// disassemble code or write performance model report
+static void processDisassembler(Disassembler& disasm, const char* filename,
+            const DisasmOptions& opts, std::ostream& os)
+{
+    if (opts.perfModel)
+    {
+        GCNPerfModel perfModel(disasm.getDeviceType());
+        perfModel.analyzeDisassembler(disasm);
+        perfModel.writeReport(os, filename);
+    }
+    else
+        disasm.disassemble();
+}
+
+// process single file, returns false if error encountered
+static bool processFile(const char* filename, const DisasmOptions& opts,
+            std::ostream& os, std::ostream& errOs)
+{
+    if (!opts.perfModel)
+        os << "/* Disassembling '" << filename << "\' */" << std::endl;
+    Array<cxbyte> binaryData;
+    std::unique_ptr<AmdMainBinaryBase> base = nullptr;
+    try
+    {
+        binaryData = loadDataFromFile(filename);
+        
+        if (!opts.fromRawCode)
+        {
+            // standard flags for binary format creators,
+            // needed by disassemblers to correctly getting all datas to dump
+            Flags binFlags = AMDBIN_CREATE_KERNELINFO | AMDBIN_CREATE_KERNELINFOMAP |
+                    AMDBIN_CREATE_INNERBINMAP | AMDBIN_CREATE_KERNELHEADERS |
+                    AMDBIN_CREATE_KERNELHEADERMAP;
+            // supply additional flags for CALNotes and info strings
+            if ((opts.disasmFlags & (DISASM_CALNOTES|DISASM_CONFIG)) != 0)
+                binFlags |= AMDBIN_INNER_CREATE_CALNOTES;
+            if ((opts.disasmFlags & (DISASM_METADATA|DISASM_CONFIG)) != 0)
+                binFlags |= AMDBIN_CREATE_INFOSTRINGS;
+            
+            if (isAmdBinary(binaryData.size(), binaryData.data()))
+            {
+                // if amd binary
+                base.reset(createAmdBinaryFromCode(binaryData.size(),
+                        binaryData.data(), binFlags));
+                if (base->getType() == AmdMainType::GPU_BINARY)
+                {
+                    AmdMainGPUBinary32* amdGpuBin =
+                            static_cast<AmdMainGPUBinary32*>(base.get());
+                    Disassembler disasm(*amdGpuBin, os, opts.disasmFlags);
+                    processDisassembler(disasm, filename, opts, os);
+                }
+                else if (base->getType() == AmdMainType::GPU_64_BINARY)
+                {
+                    AmdMainGPUBinary64* amdGpuBin =
+                            static_cast<AmdMainGPUBinary64*>(base.get());
+                    Disassembler disasm(*amdGpuBin, os, opts.disasmFlags);
+                    processDisassembler(disasm, filename, opts, os);
+                }
+                else
+                    throw Exception("This is not AMDGPU binary file!");
+            }
+            else if (isAmdCL2Binary(binaryData.size(), binaryData.data()))
+            {   // AMD OpenCL 2.0 binary
+                // extra (extra data) flags for OpenCL 2.0 disassembler
+                binFlags |= AMDCL2BIN_INNER_CREATE_KERNELDATA |
+                            AMDCL2BIN_INNER_CREATE_KERNELDATAMAP |
+                            AMDCL2BIN_INNER_CREATE_KERNELSTUBS;
+                base.reset(createAmdCL2BinaryFromCode(binaryData.size(),
+                                       binaryData.data(), binFlags));
+                if (base->getType() == AmdMainType::GPU_CL2_BINARY)
+                {
+                    AmdCL2MainGPUBinary32* amdGpuBin =
+                            static_cast<AmdCL2MainGPUBinary32*>(base.get());
+                    Disassembler disasm(*amdGpuBin, os, opts.disasmFlags,
+                                        opts.driverVersion);
+                    processDisassembler(disasm, filename, opts, os);
+                }
+                else if (base->getType() == AmdMainType::GPU_CL2_64_BINARY)
+                {
+                    AmdCL2MainGPUBinary64* amdGpuBin =
+                            static_cast<AmdCL2MainGPUBinary64*>(base.get());
+                    Disassembler disasm(*amdGpuBin, os, opts.disasmFlags,
+                                        opts.driverVersion);
+                    processDisassembler(disasm, filename, opts, os);
+                }
+                else
+                    throw Exception("This is not AMDGPU binary file!");
+            }
+            else if (isROCmBinary(binaryData.size(), binaryData.data()))
+            {
+                // ROCm binary
+                ROCmBinary rocmBin(binaryData.size(), binaryData.data(), 0);
+                Disassembler disasm(rocmBin, os, opts.hasGPUDeviceType, opts.gpuDeviceType,
+                                    opts.disasmFlags);
+                processDisassembler(disasm, filename, opts, os);
+            }
+            else
+            {
+                // if gallium binary
+                GalliumBinary galliumBin(binaryData.size(),binaryData.data(), 0);
+                Disassembler disasm(opts.gpuDeviceType, galliumBin, os,
+                        opts.disasmFlags, opts.llvmVersion);
+                processDisassembler(disasm, filename, opts, os);
+            }
+        }
+        else
+        {
+            /* raw binaries */
+            Disassembler disasm(opts.gpuDeviceType, binaryData.size(), binaryData.data(),
+                    os, opts.disasmFlags);
+            processDisassembler(disasm, filename, opts, os);
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        if (!opts.perfModel)
+            os << "/* ERROR for '" << filename << "\' */" << std::endl;
+        errOs << "Error during disassemblying '" << filename << "': " <<
+                ex.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// result of processing of single file (in multithreaded mode)
+struct FileResult
+{
+    std::string output;
+    std::string errors;
+    bool good;
+    bool done;
+};
+
 int main(int argc, const char** argv)
 try
 {
@@ -115,111 +270,87 @@ try
     if (cli.hasLongOption("llvmVersion"))
         llvmVersion = cli.getLongOptArg<cxuint>("llvmVersion");
     
+    const DisasmOptions opts{ disasmFlags, fromRawCode, hasGPUDeviceType, gpuDeviceType,
+            driverVersion, llvmVersion, cli.hasLongOption("perfModel") };
+    const size_t filesNum = cli.getArgsNum();
+    const char* const* filenames = cli.getArgs();
+    size_t threadsNum = 1;
+    if (cli.hasShortOption('j'))
+    {
+        threadsNum = cli.getShortOptArg<cxuint>('j');
+        if (threadsNum == 0)
+            threadsNum = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threadsNum = std::min(threadsNum, filesNum);
+    
     int ret = 0;
-    for (const char* const* args = cli.getArgs();*args != nullptr; args++)
+    bool firstReport = true;
+    if (opts.perfModel)
+        std::cout << "[\n";
+    // print output of file (reports of performance model are in JSON array)
+    auto printOutput = [&opts, &firstReport](std::string& output)
     {
-        std::cout << "/* Disassembling '" << *args << "\' */" << std::endl;
-        Array<cxbyte> binaryData;
-        std::unique_ptr<AmdMainBinaryBase> base = nullptr;
-        try
+        if (opts.perfModel)
         {
-            binaryData = loadDataFromFile(*args);
-            
-            if (!fromRawCode)
+            if (!output.empty() && output.back() == '\n')
+                output.pop_back();
+            std::cout << (firstReport ? "" : ",\n") << output << '\n';
+            firstReport = false;
+        }
+        else
+            std::cout << output;
+        std::cout.flush();
+    };
+    
+    if (threadsNum <= 1 && !opts.perfModel)
+    {
+        // disassemble directly to output
+        for (size_t i = 0; i < filesNum; i++)
+            if (!processFile(filenames[i], opts, std::cout, std::cerr))
+                ret = 1;
+    }
+    else if (threadsNum <= 1)
+    {
+        for (size_t i = 0; i < filesNum; i++)
+        {
+            std::ostringstream oss;
+            if (processFile(filenames[i], opts, oss, std::cerr))
             {
-                // standard flags for binary format creators,
-                // needed by disassemblers to correctly getting all datas to dump
-                Flags binFlags = AMDBIN_CREATE_KERNELINFO | AMDBIN_CREATE_KERNELINFOMAP |
-                        AMDBIN_CREATE_INNERBINMAP | AMDBIN_CREATE_KERNELHEADERS |
-                        AMDBIN_CREATE_KERNELHEADERMAP;
-                // supply additional flags for CALNotes and info strings
-                if ((disasmFlags & (DISASM_CALNOTES|DISASM_CONFIG)) != 0)
-                    binFlags |= AMDBIN_INNER_CREATE_CALNOTES;
-                if ((disasmFlags & (DISASM_METADATA|DISASM_CONFIG)) != 0)
-                    binFlags |= AMDBIN_CREATE_INFOSTRINGS;
-                
-                if (isAmdBinary(binaryData.size(), binaryData.data()))
-                {
-                    // if amd binary
-                    base.reset(createAmdBinaryFromCode(binaryData.size(),
-                            binaryData.data(), binFlags));
-                    if (base->getType() == AmdMainType::GPU_BINARY)
-                    {
-                        AmdMainGPUBinary32* amdGpuBin =
-                                static_cast<AmdMainGPUBinary32*>(base.get());
-                        Disassembler disasm(*amdGpuBin, std::cout, disasmFlags);
-                        disasm.disassemble();
-                    }
-                    else if (base->getType() == AmdMainType::GPU_64_BINARY)
-                    {
-                        AmdMainGPUBinary64* amdGpuBin =
-                                static_cast<AmdMainGPUBinary64*>(base.get());
-                        Disassembler disasm(*amdGpuBin, std::cout, disasmFlags);
-                        disasm.disassemble();
-                    }
-                    else
-                        throw Exception("This is not AMDGPU binary file!");
-                }
-                else if (isAmdCL2Binary(binaryData.size(), binaryData.data()))
-                {   // AMD OpenCL 2.0 binary
-                    // extra (extra data) flags for OpenCL 2.0 disassembler
-                    binFlags |= AMDCL2BIN_INNER_CREATE_KERNELDATA |
-                                AMDCL2BIN_INNER_CREATE_KERNELDATAMAP |
-                                AMDCL2BIN_INNER_CREATE_KERNELSTUBS;
-                    base.reset(createAmdCL2BinaryFromCode(binaryData.size(),
-                                           binaryData.data(), binFlags));
-                    if (base->getType() == AmdMainType::GPU_CL2_BINARY)
-                    {
-                        AmdCL2MainGPUBinary32* amdGpuBin =
-                                static_cast<AmdCL2MainGPUBinary32*>(base.get());
-                        Disassembler disasm(*amdGpuBin, std::cout, disasmFlags,
-                                            driverVersion);
-                        disasm.disassemble();
-                    }
-                    else if (base->getType() == AmdMainType::GPU_CL2_64_BINARY)
-                    {
-                        AmdCL2MainGPUBinary64* amdGpuBin =
-                                static_cast<AmdCL2MainGPUBinary64*>(base.get());
-                        Disassembler disasm(*amdGpuBin, std::cout, disasmFlags,
-                                            driverVersion);
-                        disasm.disassemble();
-                    }
-                    else
-                        throw Exception("This is not AMDGPU binary file!");
-                }
-                else if (isROCmBinary(binaryData.size(), binaryData.data()))
-                {
-                    // ROCm binary
-                    ROCmBinary rocmBin(binaryData.size(), binaryData.data(), 0);
-                    Disassembler disasm(rocmBin, std::cout, hasGPUDeviceType, gpuDeviceType,
-                                        disasmFlags);
-                    disasm.disassemble();
-                }
-                else
-                {
-                    // if gallium binary
-                    GalliumBinary galliumBin(binaryData.size(),binaryData.data(), 0);
-                    Disassembler disasm(gpuDeviceType, galliumBin, std::cout,
-                            disasmFlags, llvmVersion);
-                    disasm.disassemble();
-                }
+                std::string output = oss.str();
+                printOutput(output);
             }
             else
-            {
-                /* raw binaries */
-                Disassembler disasm(gpuDeviceType, binaryData.size(), binaryData.data(),
-                        std::cout, disasmFlags);
-                disasm.disassemble();
-            }
+                ret = 1;
         }
-        catch(const std::exception& ex)
+    }
+    else
+    {
+        /* process files in thread pool, outputs are printed in order of files
+         * by worker that finished file to be printed next */
+        std::vector<FileResult> results(filesNum);
+        size_t nextPrinted = 0;
+        std::mutex resultMutex;
+        runParallelTasks(filesNum, threadsNum, [&](size_t i)
         {
-            ret = 1;
-            std::cout << "/* ERROR for '" << *args << "\' */" << std::endl;
-            std::cerr << "Error during disassemblying '" << *args << "': " <<
-                    ex.what() << std::endl;
-        }
+            std::ostringstream oss, errOss;
+            const bool good = processFile(filenames[i], opts, oss, errOss);
+            std::lock_guard<std::mutex> lock(resultMutex);
+            results[i] = { oss.str(), errOss.str(), good, true };
+            for (; nextPrinted < filesNum && results[nextPrinted].done; nextPrinted++)
+            {
+                FileResult& result = results[nextPrinted];
+                if (result.good || !opts.perfModel)
+                    printOutput(result.output);
+                std::cerr << result.errors;
+                if (!result.good)
+                    ret = 1;
+                // free printed output
+                result.output = result.errors = std::string();
+            }
+        });
     }
+    if (opts.perfModel)
+        std::cout << "]\n";
     
     return ret;
 }
@@ -0,0 +1,709 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdbin/ROCmBinaries.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct AsmAutoWaitCase
+{
+    GPUDeviceType deviceType;
+    const char* input;  // source in autowait mode
+    const char* expected;   // source with explicit waits
+    size_t insertedWaitsNum;
+    bool good;
+    const char* errorMessages;
+};
+
+static const AsmAutoWaitCase autoWaitTestCases[] =
+{
+    {   // 0 - loads, branch (jump must be updated)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        s_load_dword s6, s[0:1], 8
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_load_dword v2, v0, s[8:11], 0 offen offset:4
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:8
+        v_add_f32 v4, v1, v0
+        s_add_u32 s7, s4, 1
+        ds_read_b32 v5, v0
+        ds_read_b32 v6, v0 offset:4
+        v_mov_b32 v7, v5
+        s_cbranch_scc0 l1
+        v_add_f32 v4, v2, v4
+l1:     v_add_f32 v4, v3, v4
+        buffer_store_dword v4, v0, s[8:11], 0 offen
+        v_mov_b32 v4, 0
+        v_mov_b32 v8, v6
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        s_load_dword s6, s[0:1], 8
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_load_dword v2, v0, s[8:11], 0 offen offset:4
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:8
+        s_waitcnt vmcnt(2)
+        v_add_f32 v4, v1, v0
+        s_waitcnt lgkmcnt(0)
+        s_add_u32 s7, s4, 1
+        ds_read_b32 v5, v0
+        ds_read_b32 v6, v0 offset:4
+        s_waitcnt lgkmcnt(1)
+        v_mov_b32 v7, v5
+        s_cbranch_scc0 l1
+        s_waitcnt vmcnt(1)
+        v_add_f32 v4, v2, v4
+l1:     s_waitcnt vmcnt(0)
+        v_add_f32 v4, v3, v4
+        buffer_store_dword v4, v0, s[8:11], 0 offen
+        v_mov_b32 v4, 0
+        s_waitcnt lgkmcnt(0)
+        v_mov_b32 v8, v6
+        s_endpgm
+)ffDXD",
+        6, true, ""
+    },
+    {   // 1 - GCN 1.0 - store data must be read out before writing register
+        GPUDeviceType::PITCAIRN,
+        R"ffDXD(.autowait
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_store_dword v2, v0, s[8:11], 0 offen
+        v_mov_b32 v2, v1
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_store_dword v2, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(1) expcnt(0)
+        v_mov_b32 v2, v1
+        s_endpgm
+)ffDXD",
+        1, true, ""
+    },
+    {   // 2 - loop (waits for loads from previous iteration)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        s_mov_b32 s4, 0
+loop:   buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_add_f32 v2, v2, v3
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:4
+        s_add_u32 s4, s4, 1
+        s_cmp_lt_u32 s4, 10
+        s_cbranch_scc1 loop
+        v_add_f32 v2, v1, v2
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_mov_b32 s4, 0
+loop:   buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(1)
+        v_add_f32 v2, v2, v3
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:4
+        s_add_u32 s4, s4, 1
+        s_cmp_lt_u32 s4, 10
+        s_cbranch_scc1 loop
+        s_waitcnt vmcnt(1)
+        v_add_f32 v2, v1, v2
+        s_endpgm
+)ffDXD",
+        2, true, ""
+    },
+    {   // 3 - explicit waits are honored
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_load_dword s4, s[0:1], 0
+        s_waitcnt vmcnt(0) & lgkmcnt(0)
+        v_add_f32 v2, s4, v1
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_load_dword s4, s[0:1], 0
+        s_waitcnt vmcnt(0) & lgkmcnt(0)
+        v_add_f32 v2, s4, v1
+        s_endpgm
+)ffDXD",
+        0, true, ""
+    },
+    {   // 4 - with register allocation
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regvar a:v, b:v, c:v, d:s:2
+        .regalloc
+        .autowait
+        s_load_dwordx2 d[0:1], s[0:1], 0
+        v_mov_b32 a, d[0]
+        buffer_load_dword b, v0, s[8:11], 0 offen
+        buffer_load_dword c, v0, s[8:11], 0 offen offset:4
+        v_add_f32 a, b, a
+        v_add_f32 a, c, a
+        buffer_store_dword a, v0, s[8:11], 0 offen
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_load_dwordx2 s[0:1], s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        v_mov_b32 v3, s0
+        buffer_load_dword v2, v0, s[8:11], 0 offen
+        buffer_load_dword v1, v0, s[8:11], 0 offen offset:4
+        s_waitcnt vmcnt(1)
+        v_add_f32 v2, v2, v3
+        s_waitcnt vmcnt(0)
+        v_add_f32 v1, v1, v2
+        buffer_store_dword v1, v0, s[8:11], 0 offen
+        s_endpgm
+)ffDXD",
+        3, true, ""
+    },
+    {   // 5 - calls are not supported
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        .cf_call routine
+        s_swappc_b64 s[0:1], s[2:3]
+        v_mov_b32 v2, v1
+        s_endpgm
+routine:
+        .cf_ret
+        s_setpc_b64 s[0:1]
+)ffDXD",
+        "", 0, false,
+        "test.s:4:9: Error: Waits can not be inserted to code with calls, returns or "
+        "unresolved jumps\n"
+    },
+    {   // 6 - autowait after code
+        GPUDeviceType::FIJI,
+        R"ffDXD(s_endpgm
+        .autowait
+)ffDXD",
+        "", 0, false,
+        "test.s:2:18: Error: Automatic waits must be enabled before code\n"
+    },
+    {   // 7 - difference of labels in instruction (PC-relative address)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_getpc_b64 s[0:1]
+        s_add_u32 s0, s0, data-.
+        v_mov_b32 v2, v1
+        s_endpgm
+data:   .int 1
+)ffDXD",
+        "", 0, false,
+        "test.s:4:27: Error: Waits can not be inserted to code, because difference "
+        "of its labels is used\n"
+    },
+    {   // 8 - difference of labels in data in code section
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+l1:     buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_mov_b32 v2, v1
+        s_endpgm
+l2:     .int l2-l1
+)ffDXD",
+        "", 0, false,
+        "test.s:5:14: Error: Waits can not be inserted to code, because difference "
+        "of its labels is used\n"
+    },
+    {   // 9 - noautowait after code (mode applies to whole code)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_mov_b32 v2, v1
+        .noautowait
+        s_endpgm
+)ffDXD",
+        "", 0, false,
+        "test.s:4:20: Error: Automatic waits must be disabled before code\n"
+    },
+    {   // 10 - symbol size is updated after inserting waits
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+kernel: buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_mov_b32 v2, v1
+        s_endpgm
+        .size kernel, .-kernel
+)ffDXD",
+        R"ffDXD(
+kernel: buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(0)
+        v_mov_b32 v2, v1
+        s_endpgm
+)ffDXD",
+        1, true, ""
+    }
+};
+
+struct AsmRelaxWaitCase
+{
+    GPUDeviceType deviceType;
+    const char* input;  // source with explicit waits
+    const char* expected;   // source with relaxed waits
+    size_t relaxedWaitsNum;
+    bool good;
+    const char* errorMessages;
+};
+
+static const AsmRelaxWaitCase relaxWaitTestCases[] =
+{
+    {   // 0 - relax vmcnt, keep waits that finish memory ops before barrier
+        GPUDeviceType::FIJI,
+        R"ffDXD(.relaxwaits
+        .checkwaits
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_load_dword v2, v0, s[8:11], 0 offen offset:4
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:8
+        buffer_load_dword v4, v0, s[8:11], 0 offen offset:12
+        s_waitcnt vmcnt(0)
+        v_add_f32 v5, v1, v0
+        s_waitcnt vmcnt(0)
+        v_add_f32 v5, v2, v5
+        ds_write_b32 v0, v5
+        s_load_dword s4, s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        s_barrier
+        v_add_f32 v5, v3, v5
+        s_waitcnt vmcnt(0) & expcnt(0)
+        v_add_f32 v6, v4, v4
+        s_waitcnt lgkmcnt(0)
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_load_dword v2, v0, s[8:11], 0 offen offset:4
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:8
+        buffer_load_dword v4, v0, s[8:11], 0 offen offset:12
+        s_waitcnt vmcnt(3)
+        v_add_f32 v5, v1, v0
+        s_waitcnt vmcnt(0)
+        v_add_f32 v5, v2, v5
+        ds_write_b32 v0, v5
+        s_load_dword s4, s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        s_barrier
+        v_add_f32 v5, v3, v5
+        s_waitcnt vmcnt(0)
+        v_add_f32 v6, v4, v4
+        s_endpgm
+)ffDXD",
+        3, true,
+        "test.s:7:9: Warning: Wait instruction can be relaxed to "
+        "'s_waitcnt vmcnt(3)'\n"
+        "test.s:16:9: Warning: Wait instruction can be relaxed to "
+        "'s_waitcnt vmcnt(0)'\n"
+        "test.s:18:9: Warning: Wait instruction is not needed\n"
+    },
+    {   // 1 - only warnings, waits in loop
+        GPUDeviceType::FIJI,
+        R"ffDXD(.checkwaits
+        s_mov_b32 s4, 0
+loop:   buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:4
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v1, v2
+        s_add_u32 s4, s4, 1
+        s_cmp_lt_u32 s4, 10
+        s_cbranch_scc1 loop
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v3, v2
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_mov_b32 s4, 0
+loop:   buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:4
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v1, v2
+        s_add_u32 s4, s4, 1
+        s_cmp_lt_u32 s4, 10
+        s_cbranch_scc1 loop
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v3, v2
+        s_endpgm
+)ffDXD",
+        0, true,
+        "test.s:5:9: Warning: Wait instruction can be relaxed to "
+        "'s_waitcnt vmcnt(1)'\n"
+    },
+    {   // 2 - minimal waits and GCN 1.0 store (expcnt must not be relaxed)
+        GPUDeviceType::PITCAIRN,
+        R"ffDXD(.relaxwaits
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_store_dword v2, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(1) & expcnt(0)
+        v_mov_b32 v2, v1
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        buffer_store_dword v2, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(1) & expcnt(0)
+        v_mov_b32 v2, v1
+        s_endpgm
+)ffDXD",
+        0, true, ""
+    },
+    {   // 3 - checkwaits after code
+        GPUDeviceType::FIJI,
+        R"ffDXD(s_endpgm
+        .checkwaits
+)ffDXD",
+        "", 0, false,
+        "test.s:2:20: Error: Checking waits must be enabled before code\n"
+    },
+    {   // 4 - not needed wait is removed, jump is retargeted
+        GPUDeviceType::FIJI,
+        R"ffDXD(.relaxwaits
+        s_mov_b32 s4, 0
+        s_waitcnt vmcnt(0) & lgkmcnt(0)
+loop:   s_add_u32 s4, s4, 1
+        s_cmp_lt_u32 s4, 10
+        s_cbranch_scc1 loop
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_mov_b32 s4, 0
+loop:   s_add_u32 s4, s4, 1
+        s_cmp_lt_u32 s4, 10
+        s_cbranch_scc1 loop
+        s_endpgm
+)ffDXD",
+        1, true, ""
+    },
+    {   // 5 - not needed wait is replaced by nop if difference of labels is used
+        GPUDeviceType::FIJI,
+        R"ffDXD(.relaxwaits
+l1:     s_mov_b32 s4, 0
+        s_waitcnt vmcnt(0) & lgkmcnt(0)
+        s_endpgm
+l2:     .int l2-l1
+)ffDXD",
+        R"ffDXD(
+l1:     s_mov_b32 s4, 0
+        s_nop 0
+        s_endpgm
+l2:     .int l2-l1
+)ffDXD",
+        1, true, ""
+    },
+    {   // 6 - LDS read must be finished before barrier (other waves write LDS)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.relaxwaits
+        .checkwaits
+        ds_read_b32 v2, v0
+        s_waitcnt lgkmcnt(0)
+        s_barrier
+        ds_write_b32 v0, v1
+        s_waitcnt lgkmcnt(0)
+        v_mov_b32 v3, v2
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        ds_read_b32 v2, v0
+        s_waitcnt lgkmcnt(0)
+        s_barrier
+        ds_write_b32 v0, v1
+        s_waitcnt lgkmcnt(0)
+        v_mov_b32 v3, v2
+        s_endpgm
+)ffDXD",
+        0, true, ""
+    }
+};
+
+static std::vector<cxbyte> assembleRawCode(const std::string& testCaseName,
+            GPUDeviceType deviceType, const char* input, bool& good,
+            std::string& errorMessages, size_t* insertedWaitsNum = nullptr,
+            size_t* relaxedWaitsNum = nullptr)
+{
+    std::istringstream input2(input);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input2, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, deviceType, errorStream);
+    good = assembler.assemble();
+    errorMessages = errorStream.str();
+    if (insertedWaitsNum != nullptr)
+        *insertedWaitsNum = assembler.getInsertedWaitsNum();
+    if (relaxedWaitsNum != nullptr)
+        *relaxedWaitsNum = assembler.getRelaxedWaitsNum();
+    if (!good)
+        return std::vector<cxbyte>();
+    if (assembler.getSections().size() < 1)
+        throw Exception(testCaseName+": No sections");
+    return assembler.getSections()[0].content;
+}
+
+static void testAutoWait(cxuint i, const AsmAutoWaitCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "autoWaitCase#" << i;
+    const std::string testCaseName = oss.str();
+    bool good;
+    std::string errorMessages;
+    size_t insertedWaitsNum;
+    const std::vector<cxbyte> result = assembleRawCode(testCaseName,
+                testCase.deviceType, testCase.input, good, errorMessages,
+                &insertedWaitsNum);
+    assertValue("testAutoWait", testCaseName+".good", testCase.good, good);
+    assertString("testAutoWait", testCaseName+".errorMessages",
+                testCase.errorMessages, errorMessages);
+    if (!good)
+        return;
+    assertValue("testAutoWait", testCaseName+".insertedWaitsNum",
+                testCase.insertedWaitsNum, insertedWaitsNum);
+
+    bool expGood;
+    std::string expErrorMessages;
+    const std::vector<cxbyte> expResult = assembleRawCode(testCaseName+"Exp",
+                testCase.deviceType, testCase.expected, expGood, expErrorMessages);
+    if (!expGood)
+        throw Exception(testCaseName+": Expected source can not be assembled");
+    assertArray<cxbyte>("testAutoWait", testCaseName+".content",
+                Array<cxbyte>(expResult.begin(), expResult.end()), result);
+}
+
+static void testRelaxWait(cxuint i, const AsmRelaxWaitCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "relaxWaitCase#" << i;
+    const std::string testCaseName = oss.str();
+    bool good;
+    std::string errorMessages;
+    size_t relaxedWaitsNum;
+    const std::vector<cxbyte> result = assembleRawCode(testCaseName,
+                testCase.deviceType, testCase.input, good, errorMessages,
+                nullptr, &relaxedWaitsNum);
+    assertValue("testRelaxWait", testCaseName+".good", testCase.good, good);
+    assertString("testRelaxWait", testCaseName+".errorMessages",
+                testCase.errorMessages, errorMessages);
+    if (!good)
+        return;
+    assertValue("testRelaxWait", testCaseName+".relaxedWaitsNum",
+                testCase.relaxedWaitsNum, relaxedWaitsNum);
+    
+    bool expGood;
+    std::string expErrorMessages;
+    const std::vector<cxbyte> expResult = assembleRawCode(testCaseName+"Exp",
+                testCase.deviceType, testCase.expected, expGood, expErrorMessages);
+    if (!expGood)
+        throw Exception(testCaseName+": Expected source can not be assembled");
+    assertArray<cxbyte>("testRelaxWait", testCaseName+".content",
+                Array<cxbyte>(expResult.begin(), expResult.end()), result);
+}
+
+static void testAutoWaitSymbolSize()
+{
+    std::istringstream input(R"ffDXD(.autowait
+kernel: buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_mov_b32 v2, v1
+        s_endpgm
+        .size kernel, .-kernel
+after:
+)ffDXD");
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+    const bool good = assembler.assemble();
+    assertTrue("testAutoWaitSymbolSize", "good", good);
+    assertString("testAutoWaitSymbolSize", "errorMessages", "", errorStream.str());
+    const AsmSymbolMap& symbolMap = assembler.getSymbolMap();
+    const AsmSymbolMap::const_iterator kernelIt = symbolMap.find("kernel");
+    const AsmSymbolMap::const_iterator afterIt = symbolMap.find("after");
+    assertTrue("testAutoWaitSymbolSize", "kernel", kernelIt != symbolMap.end());
+    assertTrue("testAutoWaitSymbolSize", "after", afterIt != symbolMap.end());
+    assertValue("testAutoWaitSymbolSize", "kernel.value", uint64_t(0),
+                kernelIt->second.value);
+    assertValue("testAutoWaitSymbolSize", "kernel.size", uint64_t(20),
+                kernelIt->second.size);
+    assertValue("testAutoWaitSymbolSize", "after.value", uint64_t(20),
+                afterIt->second.value);
+}
+
+struct AsmROCmWaitCase
+{
+    const char* input;  // ROCm source with automatic or relaxed waits
+    const char* expected;   // ROCm source with explicit waits
+};
+
+/* binary generator of ROCm binaries gets code of sections before section differences
+ * resolving, hence inserted waits must be in binary */
+static const AsmROCmWaitCase rocmWaitTestCases[] =
+{
+    {   // 0 - inserted wait
+        R"ffDXD(.rocm
+        .gpu Fiji
+        .autowait
+.text
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        s_add_u32 s6, s4, 1
+        s_endpgm
+)ffDXD",
+        R"ffDXD(.rocm
+        .gpu Fiji
+.text
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        s_add_u32 s6, s4, 1
+        s_endpgm
+)ffDXD"
+    },
+    {   // 1 - two kernels with configs
+        R"ffDXD(.rocm
+        .gpu Fiji
+        .autowait
+.kernel k1
+    .config
+        .dims x
+.kernel k2
+    .config
+        .dims x
+.text
+k1:
+        .skip 256
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_add_f32 v2, v1, v1
+        s_endpgm
+.p2align 8
+k2:
+        .skip 256
+        s_load_dword s4, s[0:1], 0
+        v_mov_b32 v1, s4
+        s_endpgm
+)ffDXD",
+        R"ffDXD(.rocm
+        .gpu Fiji
+.kernel k1
+    .config
+        .dims x
+.kernel k2
+    .config
+        .dims x
+.text
+k1:
+        .skip 256
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v1, v1
+        s_endpgm
+.p2align 8
+k2:
+        .skip 256
+        s_load_dword s4, s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        v_mov_b32 v1, s4
+        s_endpgm
+)ffDXD"
+    },
+    {   // 2 - removed wait
+        R"ffDXD(.rocm
+        .gpu Fiji
+        .relaxwaits
+.text
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        s_add_u32 s6, s4, 1
+        s_waitcnt lgkmcnt(0)
+        s_endpgm
+)ffDXD",
+        R"ffDXD(.rocm
+        .gpu Fiji
+.text
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        s_add_u32 s6, s4, 1
+        s_endpgm
+)ffDXD"
+    }
+};
+
+static Array<cxbyte> assembleROCmBinary(const std::string& testCaseName,
+            const char* source)
+{
+    std::istringstream input(source);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO, BinaryFormat::ROCM,
+                GPUDeviceType::FIJI, errorStream);
+    if (!assembler.assemble())
+        throw Exception(testCaseName+": Can't assemble: "+errorStream.str());
+    Array<cxbyte> binary;
+    assembler.writeBinary(binary);
+    return binary;
+}
+
+static void testROCmWait(cxuint i, const AsmROCmWaitCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "rocmWaitCase#" << i;
+    const std::string testCaseName = oss.str();
+    Array<cxbyte> result = assembleROCmBinary(testCaseName, testCase.input);
+    Array<cxbyte> expResult = assembleROCmBinary(testCaseName+"Exp", testCase.expected);
+    ROCmBinary rocmBin(result.size(), result.data(), 0);
+    ROCmBinary expRocmBin(expResult.size(), expResult.data(), 0);
+    assertArray<cxbyte>("testROCmWait", testCaseName+".code",
+                Array<cxbyte>(expRocmBin.getCode(),
+                    expRocmBin.getCode() + expRocmBin.getCodeSize()),
+                rocmBin.getCodeSize(), rocmBin.getCode());
+    assertArray<cxbyte>("testROCmWait", testCaseName+".binary", expResult, result);
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    for (cxuint i = 0; i < sizeof(autoWaitTestCases)/sizeof(AsmAutoWaitCase); i++)
+        try
+        { testAutoWait(i, autoWaitTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    try
+    { testAutoWaitSymbolSize(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    for (cxuint i = 0; i < sizeof(relaxWaitTestCases)/sizeof(AsmRelaxWaitCase); i++)
+        try
+        { testRelaxWait(i, relaxWaitTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    for (cxuint i = 0; i < sizeof(rocmWaitTestCases)/sizeof(AsmROCmWaitCase); i++)
+        try
+        { testROCmWait(i, rocmWaitTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    return retVal;
+}
@@ -1613,6 +1613,63 @@ static void testAssembler(cxuint testId, const AsmTestCase& testCase)
     assertString(testName, "errorMessages", testCase.errors, errorStream.str());
 }
 
+static Array<cxbyte> assembleROCmBinary(const char* source, Flags flags)
+{
+    std::istringstream input(source);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, flags, BinaryFormat::ROCM,
+                GPUDeviceType::FIJI, errorStream);
+    if (!assembler.assemble())
+        throw Exception("Can't assemble: "+errorStream.str());
+    Array<cxbyte> binary;
+    assembler.writeBinary(binary);
+    return binary;
+}
+
+// assembler with ASM_MERGESTRINGS must generate smaller binary with same kernels
+static void testMergeStrings()
+{
+    static const char* source = R"ffDXD(.rocm
+        .gpu Fiji
+.kernel kernel
+    .config
+        .dims x
+.kernel testkernel
+    .config
+        .dims x
+.kernel mytestkernel
+    .config
+        .dims x
+.text
+kernel:
+        .skip 256
+        s_endpgm
+.align 256
+testkernel:
+        .skip 256
+        s_endpgm
+.align 256
+mytestkernel:
+        .skip 256
+        s_endpgm
+)ffDXD";
+    const Array<cxbyte> binary = assembleROCmBinary(source, ASM_ALL&~ASM_ALTMACRO);
+    Array<cxbyte> mergedBinary = assembleROCmBinary(source,
+                (ASM_ALL&~ASM_ALTMACRO) | ASM_MERGESTRINGS);
+    assertTrue("testMergeStrings", "smaller", mergedBinary.size() < binary.size());
+    
+    ROCmBinary rocmBin(mergedBinary.size(), mergedBinary.data(), ROCMBIN_CREATE_REGIONMAP);
+    assertValue("testMergeStrings", "regionsNum", size_t(3), rocmBin.getRegionsNum());
+    const char* kernelNames[3] = { "kernel", "testkernel", "mytestkernel" };
+    for (cxuint i = 0; i < 3; i++)
+    {
+        const ROCmRegion& region = rocmBin.getRegion(kernelNames[i]);
+        assertString("testMergeStrings", "kernelName", kernelNames[i], region.regionName);
+        assertValue("testMergeStrings", "kernelOffset", size_t(i*0x200),
+                    size_t(region.offset - (rocmBin.getCode()-rocmBin.getBinaryCode())));
+    }
+}
+
 int main(int argc, const char** argv)
 {
     int retVal = 0;
@@ -1624,5 +1681,12 @@ int main(int argc, const char** argv)
             std::cerr << ex.what() << std::endl;
             retVal = 1;
         }
+    try
+    { testMergeStrings(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
     return retVal;
 }
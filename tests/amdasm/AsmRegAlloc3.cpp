@@ -2743,7 +2743,7 @@ b1:     s_xor_b32 sa[3], sa[3], sa[0]   # 128
                 { }, { }, { } } } }
         },
         {   // vidxCallMap
-            { 3, { { { 18 }, { }, { }, { } } } }, // ?
+            { 3, { { { }, { }, { }, { } } } },
             { 7, { { { }, { }, { }, { } } } }
         },
         true, ""
@@ -0,0 +1,295 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstring>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include <CLRX/utils/Containers.h>
+#include "../TestUtils.h"
+#include "AsmRegAlloc.h"
+
+using namespace CLRX;
+
+typedef AsmRegAllocator::OutLiveness OutLiveness;
+typedef AsmRegAllocator::InterGraph InterGraph;
+
+// generate kernel with many regvars, every regvar is live over 'window' instructions
+static std::string generateRegVarsKernel(size_t regVarsNum, size_t window)
+{
+    std::ostringstream oss;
+    for (size_t i = 0; i < regVarsNum; i++)
+        oss << ".regvar vx" << i << ":v, sx" << i << ":s\n";
+    for (size_t i = 0; i < regVarsNum+window; i++)
+    {
+        if (i < regVarsNum)
+            oss << "v_mov_b32 vx" << i << ", v0\n"
+                "s_mov_b32 sx" << i << ", s0\n";
+        if (i >= window)
+            oss << "v_add_f32 v1, vx" << (i-window) << ", v1\n"
+                "s_add_u32 s1, sx" << (i-window) << ", s1\n";
+    }
+    return oss.str();
+}
+
+// compare interference graph with brute force comparison of live ranges
+static void checkInterGraph(const std::string& testName, const std::string& caseName,
+            const Array<OutLiveness>& livenesses, const InterGraph& interGraph)
+{
+    const size_t nodesNum = livenesses.size();
+    assertTrue(testName, caseName+"size", interGraph.size() >= nodesNum);
+    size_t edgesNum = 0;
+    for (size_t a = 0; a < interGraph.size(); a++)
+    {
+        std::vector<size_t> expected;
+        if (a < nodesNum)
+            for (size_t b = 0; b < nodesNum; b++)
+            {
+                if (a == b)
+                    continue;
+                bool overlap = false;
+                for (const std::pair<size_t, size_t>& ra: livenesses[a])
+                    for (const std::pair<size_t, size_t>& rb: livenesses[b])
+                        if (ra.first < rb.second && rb.first < ra.second)
+                            overlap = true;
+                if (overlap)
+                    expected.push_back(b);
+            }
+        std::ostringstream oss;
+        oss << caseName << "node#" << a;
+        const InterGraph::NodeRange nbs = interGraph[a];
+        assertValue(testName, oss.str()+".size", expected.size(), nbs.size());
+        assertTrue(testName, oss.str()+".nodes",
+                    std::equal(expected.begin(), expected.end(), nbs.begin()));
+        for (size_t b = 0; b < nodesNum; b++)
+            assertValue(testName, oss.str()+".hasEdge", bool(std::binary_search(
+                    expected.begin(), expected.end(), b)), interGraph.hasEdge(a, b));
+        edgesNum += expected.size();
+    }
+    assertValue(testName, caseName+"edgesNum", edgesNum>>1, interGraph.edgesNum());
+}
+
+// check whether coloring is valid and real registers have its own indices
+static void checkColoring(const std::string& testName, const std::string& caseName,
+            const InterGraph& interGraph, const Array<cxuint>& gcMap,
+            const AsmRegAllocator::VarIndexMap& vregIndexMap, cxuint regStart)
+{
+    assertValue(testName, caseName+"colorsSize", interGraph.size(), gcMap.size());
+    for (size_t a = 0; a < interGraph.size(); a++)
+    {
+        std::ostringstream oss;
+        oss << caseName << "node#" << a;
+        assertTrue(testName, oss.str()+".colored", gcMap[a] != UINT_MAX);
+        for (size_t b: interGraph[a])
+            assertTrue(testName, oss.str()+".conflict", gcMap[a] != gcMap[b]);
+    }
+    for (const auto& entry: vregIndexMap)
+        if (entry.first.regVar == nullptr)
+            assertValue(testName, caseName+"realReg", cxuint(entry.first.index-regStart),
+                    gcMap[entry.second[0]]);
+}
+
+// get number of used registers (colors)
+static cxuint getColorsNum(const Array<cxuint>& gcMap)
+{
+    cxuint colorsNum = 0;
+    for (cxuint color: gcMap)
+        colorsNum = std::max(colorsNum, color+1);
+    return colorsNum;
+}
+
+enum class BenchPhase
+{
+    NONE,
+    INTERGRAPH,
+    COLORING
+};
+
+/* if benchPhase is not NONE, then only measure time of this phase and add it to
+ * benchTime, colorsNums are set only for coloring benchmark */
+static bool testRegAllocCase(const std::string& caseName, const char* source,
+            BenchPhase benchPhase = BenchPhase::NONE, double* benchTime = nullptr,
+            size_t repeats = 1, cxuint* colorsNums = nullptr)
+{
+    std::istringstream input(source);
+    std::ostringstream errorStream;
+    
+    Assembler assembler("test.s", input,
+                    (ASM_ALL&~ASM_ALTMACRO) | ASM_TESTRUN | ASM_TESTRESOLVE,
+                    BinaryFormat::RAWCODE, GPUDeviceType::CAPE_VERDE, errorStream);
+    if (!assembler.assemble() || assembler.getSections().size()<1)
+        return false;
+    const AsmSection& section = assembler.getSections()[0];
+    if (section.getSize() == 0)
+        return false; // no code
+    
+    AsmRegAllocator regAlloc(assembler);
+    regAlloc.createCodeStructure(section.codeFlow, section.getSize(),
+                            section.content.data());
+    regAlloc.createSSAData(*section.usageHandler, *section.linearDepHandler);
+    regAlloc.applySSAReplaces();
+    regAlloc.createLivenesses(*section.usageHandler, *section.linearDepHandler);
+    
+    Array<OutLiveness> livenesses[MAX_REGTYPES_NUM];
+    std::copy(regAlloc.getOutLivenesses(), regAlloc.getOutLivenesses()+MAX_REGTYPES_NUM,
+                livenesses);
+    if (benchPhase == BenchPhase::INTERGRAPH)
+    {
+        // createInterferenceGraph clears livenesses, hence build graphs directly
+        InterGraph interGraph;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < repeats; k++)
+            for (size_t r = 0; r < MAX_REGTYPES_NUM; r++)
+                interGraph.build(livenesses[r].size(), livenesses[r]);
+        *benchTime += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+    
+    regAlloc.createInterferenceGraph();
+    if (benchPhase == BenchPhase::COLORING)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < repeats; k++)
+            regAlloc.colorInterferenceGraph();
+        *benchTime += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+        for (size_t r = 0; r < MAX_REGTYPES_NUM; r++)
+            colorsNums[r] = getColorsNum(regAlloc.getGraphColorMaps()[r]);
+        return true;
+    }
+    
+    for (size_t r = 0; r < MAX_REGTYPES_NUM; r++)
+    {
+        std::ostringstream oss;
+        oss << caseName << "rt" << r << ".";
+        checkInterGraph("testCreateInterGraph", oss.str(), livenesses[r],
+                    regAlloc.getInterGraphs()[r]);
+    }
+    
+    regAlloc.colorInterferenceGraph();
+    size_t regTypesNum;
+    cxuint regRanges[MAX_REGTYPES_NUM*2];
+    assembler.getISAAssembler()->getRegisterRanges(regTypesNum, regRanges);
+    for (size_t r = 0; r < regTypesNum; r++)
+    {
+        std::ostringstream oss;
+        oss << caseName << "rt" << r << ".";
+        checkColoring("testColorInterGraph", oss.str(), regAlloc.getInterGraphs()[r],
+                    regAlloc.getGraphColorMaps()[r], regAlloc.getVregIndexMaps()[r],
+                    regRanges[2*r]);
+    }
+    return true;
+}
+
+static const AsmSSADataCase* ssaDataCaseTbls[3] =
+{ ssaDataTestCases1Tbl, ssaDataTestCases2Tbl, ssaDataTestCases3Tbl };
+
+// measure time of creation of interference graph and coloring for test cases
+// and big kernels
+static void benchRegAlloc()
+{
+    const BenchPhase phases[2] = { BenchPhase::INTERGRAPH, BenchPhase::COLORING };
+    const char* phaseNames[2] = { "interference graph", "coloring" };
+    for (cxuint p = 0; p < 2; p++)
+    {
+        double time = 0.0;
+        size_t casesNum = 0;
+        cxuint colorsNums[MAX_REGTYPES_NUM];
+        for (const AsmSSADataCase* tbl: ssaDataCaseTbls)
+            for (size_t i = 0; tbl[i].input!=nullptr; i++)
+                if (tbl[i].good && testRegAllocCase("", tbl[i].input, phases[p],
+                            &time, 1000, colorsNums))
+                    casesNum++;
+        std::cout << phaseNames[p] << ": AsmRegAllocCase* (" << casesNum <<
+                " cases, 1000 times): " << time << " ms" << std::endl;
+    }
+    
+    const size_t graphKernels[4][2] = { { 1000, 100 }, { 3000, 200 },
+            { 6000, 500 }, { 8000, 2000 } };
+    for (const auto& bk: graphKernels)
+    {
+        double time = 0.0;
+        const std::string source = generateRegVarsKernel(bk[0], bk[1]);
+        testRegAllocCase("", source.c_str(), BenchPhase::INTERGRAPH, &time);
+        std::cout << "interference graph: regvars=" << bk[0] << " window=" << bk[1] <<
+                    ": " << time << " ms" << std::endl;
+    }
+    // window must be lower than number of available SGPRs
+    const size_t colorKernels[3][2] = { { 1000, 50 }, { 4000, 90 }, { 8000, 90 } };
+    for (const auto& bk: colorKernels)
+    {
+        double time = 0.0;
+        cxuint colorsNums[MAX_REGTYPES_NUM];
+        const std::string source = generateRegVarsKernel(bk[0], bk[1]);
+        testRegAllocCase("", source.c_str(), BenchPhase::COLORING, &time, 1, colorsNums);
+        std::cout << "coloring: regvars=" << bk[0] << " window=" << bk[1] << ": " <<
+                    time << " ms, SGPRs=" << colorsNums[0] << ", VGPRs=" <<
+                    colorsNums[1] << std::endl;
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    if (argc > 1 && ::strcmp(argv[1], "bench") == 0)
+    {
+        benchRegAlloc();
+        return 0;
+    }
+    int retVal = 0;
+    for (cxuint t = 0; t < 3; t++)
+        for (size_t i = 0; ssaDataCaseTbls[t][i].input!=nullptr; i++)
+            try
+            {
+                if (!ssaDataCaseTbls[t][i].good)
+                    continue;
+                std::ostringstream oss;
+                oss << "ssaDataCase#" << t << "." << i << ".";
+                testRegAllocCase(oss.str(), ssaDataCaseTbls[t][i].input);
+            }
+            catch(const std::exception& ex)
+            {
+                std::cerr << ex.what() << std::endl;
+                retVal = 1;
+            }
+    // big kernels (sparse and dense graphs)
+    const size_t bigKernels[3][2] = { { 50, 3 }, { 300, 40 }, { 2000, 3 } };
+    for (const auto& bk: bigKernels)
+        try
+        {
+            std::ostringstream oss;
+            oss << "regVarsKernel" << bk[0] << "." << bk[1] << ".";
+            const std::string source = generateRegVarsKernel(bk[0], bk[1]);
+            if (!testRegAllocCase(oss.str(), source.c_str()))
+                throw Exception(oss.str()+" can not be assembled");
+        }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    return retVal;
+}
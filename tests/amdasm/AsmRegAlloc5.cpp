@@ -0,0 +1,1040 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdasm/AsmFormats.h>
+#include <CLRX/amdbin/ROCmBinaries.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct AsmRegAllocApplyCase
+{
+    GPUDeviceType deviceType;
+    const char* input;  // source with register variables
+    const char* expected;   // source with allocated registers
+    size_t coalescedMovesNum;
+    size_t removedMovesNum;
+    bool good;
+    const char* errorMessages;
+};
+
+static const AsmRegAllocApplyCase regAllocApplyTestCases[] =
+{
+    {   /* 0 - SMRD, VOP2, MUBUF, linear register variable */
+        GPUDeviceType::BONAIRE,
+        R"ffDXD(.regalloc
+.regvar sa:s:4, sb:s:2, va:v:4, vb:v
+    s_load_dwordx4 sa[0:3], s[0:1], 0
+    s_load_dwordx2 sb[0:1], s[0:1], 16
+    s_waitcnt lgkmcnt(0)
+    v_mov_b32 vb, sb[0]
+    v_add_f32 va[0], sb[1], v0
+    v_add_f32 va[1], va[0], vb
+    v_mov_b32 va[2], va[1]
+    v_mov_b32 va[3], vb
+    buffer_store_dwordx4 va[0:3], v0, sa[0:3], 0 offen
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+    s_load_dwordx4 s[4:7], s[0:1], 0
+    s_load_dwordx2 s[0:1], s[0:1], 16
+    s_waitcnt lgkmcnt(0)
+    v_mov_b32 v4, s0
+    v_add_f32 v1, s1, v0
+    v_add_f32 v2, v1, v4
+    v_mov_b32 v3, v2
+    buffer_store_dwordx4 v[1:4], v0, s[4:7], 0 offen
+    s_endpgm
+)ffDXD",
+        0, 1, true, ""
+    },
+    {   /* 1 - loop */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar sc:s, vc:v, vd:v, ve:v
+    s_mov_b32 sc, 10
+    v_mov_b32 vc, 0
+    v_mov_b32 ve, 1.0
+loop:
+    v_add_f32 vc, vc, ve
+    s_sub_u32 sc, sc, 1
+    s_cbranch_scc0 loop
+    v_mul_f32 vd, vc, v1
+    v_mov_b32 v2, vd
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+    s_mov_b32 s0, 10
+    v_mov_b32 v2, 0
+    v_mov_b32 v0, 1.0
+loop:
+    v_add_f32 v2, v2, v0
+    s_sub_u32 s0, s0, 1
+    s_cbranch_scc0 loop
+    v_mul_f32 v2, v2, v1
+    s_endpgm
+)ffDXD",
+        1, 1, true, ""
+    },
+    {   /* 2 - SMEM, VOP3, VOPC, DS, FLAT, MIMG */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar sa:s:2, sb:s:8, vx:v:2, vy:v:2, vz:v
+    s_load_dwordx2 sa[0:1], s[0:1], 8
+    s_load_dwordx8 sb[0:7], s[0:1], 16
+    s_waitcnt lgkmcnt(0)
+    v_mad_f32 vz, sa[0], v0, v1
+    v_cmp_gt_f32 sa[0:1], vz, v1
+    v_cndmask_b32 vz, vz, v0, sa[0:1]
+    ds_read_b64 vx[0:1], vz
+    s_waitcnt lgkmcnt(0)
+    flat_load_dwordx2 vy[0:1], vx[0:1]
+    s_waitcnt vmcnt(0) & lgkmcnt(0)
+    image_sample v[2:5], vy[0:1], sb[0:7], s[4:7] dmask:15
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+    s_load_dwordx2 s[2:3], s[0:1], 8
+    s_load_dwordx8 s[8:15], s[0:1], 16
+    s_waitcnt lgkmcnt(0)
+    v_mad_f32 v2, s2, v0, v1
+    v_cmp_gt_f32 s[0:1], v2, v1
+    v_cndmask_b32 v0, v2, v0, s[0:1]
+    ds_read_b64 v[0:1], v0
+    s_waitcnt lgkmcnt(0)
+    flat_load_dwordx2 v[0:1], v[0:1]
+    s_waitcnt vmcnt(0) & lgkmcnt(0)
+    image_sample v[2:5], v[0:1], s[8:15], s[4:7] dmask:15
+    s_endpgm
+)ffDXD",
+        0, 0, true, ""
+    },
+    {   /* 3 - SMEM soffset, global, VINTRP, EXP */
+        GPUDeviceType::GFX900,
+        R"ffDXD(.regalloc
+.regvar so:s, sd:s:4, sa:s:2, va:v:4, vb:v:2
+    s_mov_b32 so, 16
+    s_mov_b64 sa[0:1], s[4:5]
+    s_load_dwordx4 sd[0:3], s[0:1], so offset:8
+    s_waitcnt lgkmcnt(0)
+    global_load_dwordx2 vb[0:1], v0, sa[0:1]
+    v_interp_p1_f32 va[0], v1, attr0.x
+    s_waitcnt vmcnt(0)
+    v_add_f32 va[1], vb[0], sd[1]
+    v_add_f32 va[2], vb[1], sd[2]
+    v_mov_b32 va[3], sd[3]
+    buffer_load_dword va[1], v0, sd[0:3], so offen
+    s_waitcnt vmcnt(0)
+    exp mrt0, va[0], va[1], va[2], va[3] done
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+    s_mov_b32 s6, 16
+    s_mov_b64 s[4:5], s[4:5]
+    s_load_dwordx4 s[0:3], s[0:1], s6 offset:8
+    s_waitcnt lgkmcnt(0)
+    global_load_dwordx2 v[2:3], v0, s[4:5]
+    v_interp_p1_f32 v1, v1, attr0.x
+    s_waitcnt vmcnt(0)
+    v_add_f32 v2, v2, s1
+    v_add_f32 v3, v3, s2
+    v_mov_b32 v2, s3
+    buffer_load_dword v0, v0, s[0:3], s6 offen
+    s_waitcnt vmcnt(0)
+    exp mrt0, v1, v0, v3, v2 done
+    s_endpgm
+)ffDXD",
+        0, 0, true, ""
+    },
+    {   /* 4 - without register variables */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+    v_mov_b32 v1, v2
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+    v_mov_b32 v1, v2
+    s_endpgm
+)ffDXD",
+        0, 0, true, ""
+    },
+    {   /* 5 - coalescing moves */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar va:v, vb:v, vc:v, sa:s, sb:s
+    v_add_f32 va, v0, v1
+    v_mov_b32 vb, va
+    v_mov_b32 vc, vb
+    s_mov_b32 sa, s2
+    s_mov_b32 sb, sa
+    v_mul_f32 v2, vc, v0
+    v_add_f32 vc, vc, v2
+    v_mov_b32 v3, vc
+    s_add_u32 s2, sb, s3
+    s_mov_b32 sa, s2
+    s_mov_b32 s4, sa
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+    v_add_f32 v1, v0, v1
+    v_mul_f32 v2, v1, v0
+    v_add_f32 v3, v1, v2
+    s_add_u32 s2, s2, s3
+    s_mov_b32 s4, s2
+    s_endpgm
+)ffDXD",
+        6, 6, true, ""
+    },
+    {   /* 6 - enable register allocation after code */
+        GPUDeviceType::FIJI,
+        R"ffDXD(    s_endpgm
+.regalloc
+.regalloc 0
+)ffDXD",
+        "", 0, 0, false,
+        "test.s:2:10: Error: Register allocation must be enabled before code\n"
+        "test.s:3:11: Error: Target occupancy must be non-zero\n"
+    },
+    {   /* 7 - removed moves before label (jump and label are moved) */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar va:v, vb:v
+    v_add_f32 va, v0, v1
+    s_cbranch_scc0 skip
+    v_mov_b32 vb, va
+    v_mul_f32 vb, vb, v0
+    v_mov_b32 va, vb
+skip:
+    v_mov_b32 v2, va
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+    v_add_f32 v2, v0, v1
+    s_cbranch_scc0 skip
+    v_mul_f32 v2, v2, v0
+skip:
+    s_endpgm
+)ffDXD",
+        3, 3, true, ""
+    },
+    {   /* 8 - difference of labels is evaluated, moves are replaced by nops */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar va:v, vb:v
+l1:
+    v_add_f32 va, v0, v1
+    v_mov_b32 vb, va
+    v_mul_f32 v2, vb, v0
+    .int l2-l1
+l2:
+    s_endpgm
+)ffDXD",
+        R"ffDXD(
+l1:
+    v_add_f32 v1, v0, v1
+    s_nop 0
+    v_mul_f32 v2, v1, v0
+    .int l2-l1
+l2:
+    s_endpgm
+)ffDXD",
+        1, 1, true, ""
+    },
+    { GPUDeviceType::CAPE_VERDE, nullptr, nullptr, 0, 0, false, nullptr }
+};
+
+static std::vector<cxbyte> assembleRawCode(const std::string& testCaseName,
+            GPUDeviceType deviceType, const char* input, bool& good,
+            std::string& errorMessages, size_t* movesNums = nullptr)
+{
+    std::istringstream input2(input);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input2, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, deviceType, errorStream);
+    good = assembler.assemble();
+    errorMessages = errorStream.str();
+    if (movesNums != nullptr)
+    {
+        movesNums[0] = assembler.getCoalescedMovesNum();
+        movesNums[1] = assembler.getRemovedMovesNum();
+    }
+    if (!good)
+        return std::vector<cxbyte>();
+    if (assembler.getSections().size() < 1)
+        throw Exception(testCaseName+": No sections");
+    return assembler.getSections()[0].content;
+}
+
+static void testRegAllocApply(cxuint i, const AsmRegAllocApplyCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "regAllocApplyCase#" << i;
+    const std::string testCaseName = oss.str();
+    bool good;
+    std::string errorMessages;
+    size_t movesNums[2];
+    const std::vector<cxbyte> result = assembleRawCode(testCaseName,
+                testCase.deviceType, testCase.input, good, errorMessages, movesNums);
+    assertValue("testRegAllocApply", testCaseName+".good", testCase.good, good);
+    assertString("testRegAllocApply", testCaseName+".errorMessages",
+                testCase.errorMessages, errorMessages);
+    if (!good)
+        return;
+    assertValue("testRegAllocApply", testCaseName+".coalescedMovesNum",
+                testCase.coalescedMovesNum, movesNums[0]);
+    assertValue("testRegAllocApply", testCaseName+".removedMovesNum",
+                testCase.removedMovesNum, movesNums[1]);
+
+    bool expGood;
+    std::string expErrorMessages;
+    const std::vector<cxbyte> expResult = assembleRawCode(testCaseName+"Exp",
+                testCase.deviceType, testCase.expected, expGood, expErrorMessages);
+    if (!expGood)
+        throw Exception(testCaseName+": Expected source can not be assembled");
+    assertArray<cxbyte>("testRegAllocApply", testCaseName+".content",
+                Array<cxbyte>(expResult.begin(), expResult.end()), result);
+}
+
+// generate code with many register variables live at the same time
+static std::string generateManyRegVarsCode(cxuint regVarsNum, cxuint occupancy)
+{
+    std::ostringstream oss;
+    oss << ".regalloc " << occupancy << "\n.regvar va:v:" << regVarsNum << "\n";
+    for (cxuint i = 0; i < regVarsNum; i++)
+        oss << "v_mov_b32 va[" << i << "], v0\n";
+    for (cxuint i = 0; i < regVarsNum; i++)
+        oss << "v_add_f32 v1, va[" << i << "], v1\n";
+    oss << "s_endpgm\n";
+    return oss.str();
+}
+
+static void testOccupancyLimit()
+{
+    bool good;
+    std::string errorMessages;
+    // 28 register variables and v1 (last register variable can be in v0)
+    std::string source = generateManyRegVarsCode(28, 10);
+    assembleRawCode("occupancy10", GPUDeviceType::FIJI, source.c_str(), good,
+                errorMessages);
+    assertValue("testOccupancy", "occupancy10.good", false, good);
+    assertString("testOccupancy", "occupancy10.errorMessages",
+            ": Error: Register variables need more than 24 VGPRs\n", errorMessages);
+    // 22 register variables and v1 fit in VGPRs for occupancy 10
+    source = generateManyRegVarsCode(22, 10);
+    assembleRawCode("occupancy10fit", GPUDeviceType::FIJI, source.c_str(), good,
+                errorMessages);
+    assertValue("testOccupancy", "occupancy10fit.good", true, good);
+    assertString("testOccupancy", "occupancy10fit.errorMessages", "", errorMessages);
+    source = generateManyRegVarsCode(28, 8);
+    assembleRawCode("occupancy8", GPUDeviceType::FIJI, source.c_str(), good,
+                errorMessages);
+    assertValue("testOccupancy", "occupancy8.good", true, good);
+    assertString("testOccupancy", "occupancy8.errorMessages", "", errorMessages);
+}
+
+// errors of register allocation are reported at instructions
+static void testRegAllocErrorPos()
+{
+    bool good;
+    std::string errorMessages;
+    assembleRawCode("unreachable", GPUDeviceType::FIJI, R"ffDXD(.regalloc
+.regvar va:v, vb:v
+    v_mov_b32 va, v0
+    v_add_f32 v1, va, v1
+    s_endpgm
+.cf_start
+    v_mov_b32 vb, v0
+    v_add_f32 v1, vb, v1
+    s_endpgm
+)ffDXD", good, errorMessages);
+    assertValue("testRegAllocErrorPos", "unreachable.good", false, good);
+    assertString("testRegAllocErrorPos", "unreachable.errorMessages",
+            "test.s:7:5: Error: Register variables in code not reachable from start "
+            "of code are not supported\n", errorMessages);
+}
+
+static const char* amdRegAllocSource = R"ffDXD(.amd
+.gpu Bonaire
+.driver_version 200406
+.regalloc
+.kernel test
+    .config
+        .dims x
+        .uavid 11
+        .arg n, uint
+    .text
+.regvar sa:s:4, va:v:4, vb:v
+    s_load_dwordx4 sa[0:3], s[2:3], 0
+    s_waitcnt lgkmcnt(0)
+    v_mov_b32 vb, sa[0]
+    v_add_f32 va[0], sa[1], v0
+    v_add_f32 va[1], va[0], vb
+    v_mov_b32 va[2], va[1]
+    v_mov_b32 va[3], vb
+    buffer_store_dwordx4 va[0:3], v0, sa[0:3], 0 offen
+    s_endpgm
+)ffDXD";
+
+// check whether allocated registers are counted in kernel configuration
+static void testAmdKernelRegsNum()
+{
+    std::istringstream input(amdRegAllocSource);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::AMD, GPUDeviceType::CAPE_VERDE, errorStream);
+    bool good = assembler.assemble();
+    assertValue("testAmdKernelRegsNum", "good", true, good);
+    assertString("testAmdKernelRegsNum", "errorMessages", "", errorStream.str());
+    const AmdInput* output = static_cast<const AsmAmdHandler*>(
+                assembler.getFormatHandler())->getOutput();
+    assertValue("testAmdKernelRegsNum", "kernelsNum", size_t(1), output->kernels.size());
+    const AmdKernelConfig& config = output->kernels[0].config;
+    // v0 and va[0:3] in v[1:4], sa[0:3] in s[0:3] (replaces kernel argument pointer)
+    assertValue("testAmdKernelRegsNum", "usedSGPRsNum", 4U, config.usedSGPRsNum);
+    assertValue("testAmdKernelRegsNum", "usedVGPRsNum", 5U, config.usedVGPRsNum);
+}
+
+// generate AMD program with many kernels (code sections) with register variables
+static std::string generateManyKernelsCode(cxuint kernelsNum)
+{
+    std::ostringstream oss;
+    oss << ".amd\n.gpu Fiji\n.driver_version 200406\n.regalloc 10\n";
+    for (cxuint k = 0; k < kernelsNum; k++)
+    {
+        const cxuint regVarsNum = 4 + (k*7)%40;
+        oss << ".kernel test" << k << "\n    .config\n        .dims x\n"
+            ".text\n.regvar sa" << k << ":s:4, va" << k << ":v:" << regVarsNum << "\n"
+            "    s_load_dwordx4 sa" << k << "[0:3], s[2:3], 0\n    s_waitcnt lgkmcnt(0)\n";
+        for (cxuint i = 0; i < regVarsNum; i++)
+            oss << "    v_add_f32 va" << k << "[" << i << "], sa" << k << "[" << (i&3) <<
+                    "], v0\n";
+        for (cxuint i = 0; i < regVarsNum; i++)
+            oss << "    v_add_f32 v1, va" << k << "[" << i << "], v1\n";
+        oss << "    buffer_store_dword v1, v0, sa" << k << "[0:3], 0 offen\n"
+                "    s_endpgm\n";
+    }
+    return oss.str();
+}
+
+// register allocation in many threads should give same result as in single thread
+static void testParallelRegAlloc()
+{
+    const std::string source = generateManyKernelsCode(24);
+    std::vector<std::vector<cxbyte> > contents[2];
+    std::vector<cxuint> vgprsNums[2];
+    std::string errorMessages[2];
+    const cxuint threadsNums[2] = { 1, 4 };
+    for (cxuint t = 0; t < 2; t++)
+    {
+        std::istringstream input(source);
+        std::ostringstream errorStream;
+        Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::AMD, GPUDeviceType::FIJI, errorStream);
+        assembler.setThreadsNum(threadsNums[t]);
+        bool good = assembler.assemble();
+        // some kernels do not fit in VGPRs for occupancy 10
+        assertValue("testParallelRegAlloc", "good", false, good);
+        errorMessages[t] = errorStream.str();
+        for (const AsmSection& section: assembler.getSections())
+            contents[t].push_back(section.content);
+        const AmdInput* output = static_cast<const AsmAmdHandler*>(
+                assembler.getFormatHandler())->getOutput();
+        for (const AmdKernelInput& kernel: output->kernels)
+            vgprsNums[t].push_back(kernel.config.usedVGPRsNum);
+    }
+    // errors for occupancy in kernel order
+    assertTrue("testParallelRegAlloc", "haveErrors", !errorMessages[0].empty());
+    assertString("testParallelRegAlloc", "errorMessages", errorMessages[0].c_str(),
+                errorMessages[1]);
+    assertValue("testParallelRegAlloc", "sectionsNum", contents[0].size(),
+                contents[1].size());
+    for (size_t i = 0; i < contents[0].size(); i++)
+    {
+        std::ostringstream oss;
+        oss << "section#" << i;
+        assertArray<cxbyte>("testParallelRegAlloc", oss.str()+".content",
+                Array<cxbyte>(contents[0][i].begin(), contents[0][i].end()),
+                contents[1][i]);
+    }
+    assertValue("testParallelRegAlloc", "kernelsNum", size_t(24), vgprsNums[1].size());
+    for (size_t i = 0; i < vgprsNums[0].size(); i++)
+    {
+        std::ostringstream oss;
+        oss << "kernel#" << i << ".usedVGPRsNum";
+        assertValue("testParallelRegAlloc", oss.str(), vgprsNums[0][i], vgprsNums[1][i]);
+    }
+}
+
+struct AsmRegAllocSpillCase
+{
+    GPUDeviceType deviceType;
+    const char* input;  // source with register variables
+    cxuint regsNumLimits[2];    // SGPRs and VGPRs limits
+    cxuint spillLdsReg;     // VGPR with LDS window address (UINT_MAX - none)
+    const char* expected;   // source with allocated registers and spill code
+    size_t spilledRegsNums[2];
+};
+
+static const AsmRegAllocSpillCase regAllocSpillTestCases[] =
+{
+    {   /* 0 - SGPRs spilled to VGPR lanes, wait for SMEM loads */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar sa:s, sb:s, sc:s, va:v, vb:v, vc:v
+    s_load_dword sa, s[8:9], 0
+    s_load_dword sb, s[8:9], 4
+    s_load_dword sc, s[8:9], 8
+    buffer_load_dword va, v5, s[4:7], 0 offen
+    buffer_load_dword vb, v5, s[4:7], 4 offen
+    buffer_load_dword vc, v5, s[4:7], 8 offen
+    s_waitcnt vmcnt(0) & lgkmcnt(0)
+    v_add_f32 va, va, vb
+    v_add_f32 va, va, vc
+    s_add_u32 sa, sa, sb
+    s_add_u32 sa, sa, sc
+    v_add_f32 va, va, sa
+    buffer_store_dword va, v5, s[4:7], 0 offen
+    s_endpgm
+.noregalloc
+)ffDXD",
+        { 2, 4 }, UINT_MAX,
+        R"ffDXD(
+    s_load_dword s1, s[8:9], 0
+    s_waitcnt lgkmcnt(0)
+    v_writelane_b32 v3, s1, 0
+    s_load_dword s0, s[8:9], 4
+    s_load_dword s1, s[8:9], 8
+    s_waitcnt lgkmcnt(0)
+    v_writelane_b32 v3, s1, 1
+    buffer_load_dword v2, v5, s[4:7], 0 offen
+    buffer_load_dword v1, v5, s[4:7], 4 offen
+    buffer_load_dword v0, v5, s[4:7], 8 offen
+    s_waitcnt vmcnt(0) & lgkmcnt(0)
+    v_add_f32 v1, v2, v1
+    v_add_f32 v0, v1, v0
+    v_readlane_b32 s1, v3, 0
+    s_nop 4
+    s_add_u32 s0, s1, s0
+    v_readlane_b32 s1, v3, 1
+    s_nop 4
+    s_add_u32 s0, s0, s1
+    v_add_f32 v0, v0, s0
+    buffer_store_dword v0, v5, s[4:7], 0 offen
+    s_endpgm
+)ffDXD",
+        { 2, 0 }
+    },
+    {   /* 1 - VGPRs spilled to LDS, loop (jump must be updated) */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar sc:s, va:v, vb:v, vc:v, vd:v
+    s_mov_b32 sc, 10
+    v_mov_b32 va, 1.0
+    v_mov_b32 vb, 2.0
+    v_mov_b32 vc, 3.0
+    v_mov_b32 vd, 4.0
+loop:
+    v_add_f32 va, va, vb
+    v_add_f32 va, va, vc
+    s_sub_u32 sc, sc, 1
+    s_cbranch_scc0 loop
+    v_add_f32 va, va, vd
+    buffer_load_dword vb, v0, s[0:3], 0 offen
+    v_add_f32 va, va, vb
+    v_mov_b32 v1, va
+    s_endpgm
+.noregalloc
+)ffDXD",
+        { 10, 4 }, 256,
+        R"ffDXD(
+    s_mov_b32 s4, 10
+    v_mov_b32 v2, 1.0
+    v_mov_b32 v3, 2.0
+    ds_write_b32 v0, v3 offset:256
+    v_mov_b32 v1, 3.0
+    v_mov_b32 v3, 4.0
+    ds_write_b32 v0, v3
+loop:
+    ds_read_b32 v3, v0 offset:256
+    s_waitcnt lgkmcnt(0)
+    v_add_f32 v2, v2, v3
+    v_add_f32 v2, v2, v1
+    s_sub_u32 s4, s4, 1
+    s_cbranch_scc0 loop
+    ds_read_b32 v3, v0
+    s_waitcnt lgkmcnt(0)
+    v_add_f32 v1, v2, v3
+    buffer_load_dword v2, v0, s[0:3], 0 offen
+    v_add_f32 v1, v1, v2
+    s_endpgm
+)ffDXD",
+        { 0, 2 }
+    },
+    {   /* 2 - VGPRs can not be spilled without LDS window */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar va:v, vb:v, vc:v
+    v_mov_b32 va, 1.0
+    v_mov_b32 vb, 2.0
+    v_mov_b32 vc, 3.0
+    v_add_f32 va, va, vb
+    v_add_f32 va, va, vc
+    v_mov_b32 v0, va
+    s_endpgm
+.noregalloc
+)ffDXD",
+        { 10, 2 }, UINT_MAX, nullptr, { 0, 0 }
+    },
+    {   /* 3 - VGPRs can not be spilled if difference of labels is evaluated */
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+.regvar sc:s, va:v, vb:v, vc:v, vd:v
+    s_mov_b32 sc, 10
+    v_mov_b32 va, 1.0
+    v_mov_b32 vb, 2.0
+    v_mov_b32 vc, 3.0
+    v_mov_b32 vd, 4.0
+loop:
+    v_add_f32 va, va, vb
+    v_add_f32 va, va, vc
+    s_sub_u32 sc, sc, 1
+    s_add_u32 s0, s0, end-loop
+    s_cbranch_scc0 loop
+    v_add_f32 va, va, vd
+    buffer_load_dword vb, v0, s[0:3], 0 offen
+    v_add_f32 va, va, vb
+    v_mov_b32 v1, va
+end:
+    s_endpgm
+.noregalloc
+)ffDXD",
+        { 10, 4 }, 256, nullptr, { 0, 0 }
+    }
+};
+
+static void testRegAllocSpill(cxuint i, const AsmRegAllocSpillCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "regAllocSpillCase#" << i;
+    const std::string testCaseName = oss.str();
+    std::istringstream input(testCase.input);
+    std::ostringstream errorStream;
+    // register allocation is disabled at end of source, allocator is called directly
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, testCase.deviceType, errorStream);
+    if (!assembler.assemble())
+        throw Exception(testCaseName+": Input source can not be assembled");
+    AsmRegAllocator regAllocator(assembler);
+    regAllocator.setRegsNumLimit(REGTYPE_SGPR, testCase.regsNumLimits[0]);
+    regAllocator.setRegsNumLimit(REGTYPE_VGPR, testCase.regsNumLimits[1]);
+    if (testCase.spillLdsReg != UINT_MAX)
+        regAllocator.setSpillLds(testCase.spillLdsReg, 256);
+    bool good = true;
+    try
+    { good = regAllocator.allocateRegisters(0); }
+    catch(const AsmException& ex)
+    { good = false; }
+    assertValue("testRegAllocSpill", testCaseName+".good",
+                testCase.expected != nullptr, good);
+    if (!good)
+        return;
+    assertValue("testRegAllocSpill", testCaseName+".spilledSGPRsNum",
+                testCase.spilledRegsNums[0], regAllocator.getSpilledRegsNums()[0]);
+    assertValue("testRegAllocSpill", testCaseName+".spilledVGPRsNum",
+                testCase.spilledRegsNums[1], regAllocator.getSpilledRegsNums()[1]);
+    
+    bool expGood;
+    std::string expErrorMessages;
+    const std::vector<cxbyte> expResult = assembleRawCode(testCaseName+"Exp",
+                testCase.deviceType, testCase.expected, expGood, expErrorMessages);
+    if (!expGood)
+        throw Exception(testCaseName+": Expected source can not be assembled");
+    const std::vector<cxbyte>& result = assembler.getSections()[0].content;
+    assertArray<cxbyte>("testRegAllocSpill", testCaseName+".content",
+                Array<cxbyte>(expResult.begin(), expResult.end()), result);
+}
+
+// spilled VGPRs instead of lower occupancy, labels must be moved after spill code
+static void testOccupancySpill()
+{
+    std::string source = generateManyRegVarsCode(28, 10);
+    // LDS window address for spilled VGPRs
+    source.insert(source.find("v_mov_b32"), ".spill_lds v2, 256\nv_lshlrev_b32 v2, 2, v0\n");
+    source.insert(source.rfind("s_endpgm"), "end:\n");
+    std::istringstream input(source);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+    bool good = assembler.assemble();
+    assertValue("testOccupancySpill", "good", true, good);
+    assertString("testOccupancySpill", "errorMessages", "", errorStream.str());
+    assertValue("testOccupancySpill", "spilledSGPRsNum", size_t(0),
+                assembler.getSpilledRegsNums()[REGTYPE_SGPR]);
+    assertValue("testOccupancySpill", "spilledVGPRsNum", size_t(7),
+                assembler.getSpilledRegsNums()[REGTYPE_VGPR]);
+    const std::vector<cxbyte>& content = assembler.getSections()[0].content;
+    /* shift, 28 moves (move to v0 is removed), 28 adds, 7 spill stores,
+     * 7 spill loads with waits and s_endpgm */
+    assertValue("testOccupancySpill", "contentSize", size_t(4*(28+28) + 8*7 + 12*7 + 4),
+                content.size());
+    auto symIt = assembler.getSymbolMap().find("end");
+    assertTrue("testOccupancySpill", "endSymbol", symIt != assembler.getSymbolMap().end());
+    assertValue("testOccupancySpill", "endSymbol.value", uint64_t(content.size()-4),
+                symIt->second.value);
+}
+
+// spill code in kernel of ROCm binary (code is taken while preparing section diffs)
+static void testROCmOccupancySpill()
+{
+    std::string spillSource = generateManyRegVarsCode(28, 10);
+    spillSource.insert(spillSource.find("v_mov_b32"),
+                ".spill_lds v2, 256\nv_lshlrev_b32 v2, 2, v0\n");
+    std::istringstream rawInput(spillSource);
+    std::ostringstream errorStream;
+    Assembler rawAssembler("test.s", rawInput, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+    bool good = rawAssembler.assemble();
+    assertValue("testROCmOccupancySpill", "raw.good", true, good);
+    const std::vector<cxbyte>& rawContent = rawAssembler.getSections()[0].content;
+    
+    // register allocation must be enabled before kernel config in code
+    const size_t regAllocEnd = spillSource.find('\n')+1;
+    std::string source = ".rocm\n.gpu Fiji\n"
+            ".kernel k1\n    .config\n        .dims x\n"
+            ".kernel k2\n    .config\n        .dims x\n"
+            ".text\n" + spillSource.substr(0, regAllocEnd) + "k1:\n    .skip 256\n" +
+            spillSource.substr(regAllocEnd) +
+            ".p2align 8\nk2:\n    .skip 256\n    s_endpgm\n";
+    std::istringstream input(source);
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::ROCM, GPUDeviceType::FIJI, errorStream);
+    good = assembler.assemble();
+    assertValue("testROCmOccupancySpill", "good", true, good);
+    assertString("testROCmOccupancySpill", "errorMessages", "", errorStream.str());
+    assertValue("testROCmOccupancySpill", "spilledVGPRsNum", size_t(7),
+                assembler.getSpilledRegsNums()[REGTYPE_VGPR]);
+    Array<cxbyte> binary;
+    assembler.writeBinary(binary);
+    ROCmBinary rocmBin(binary.size(), binary.data(), 0);
+    const cxbyte* code = rocmBin.getCode();
+    // code of first kernel with spill code, second kernel is still aligned
+    const size_t k2Offset = (256 + rawContent.size() + 255) & ~size_t(255);
+    assertValue("testROCmOccupancySpill", "codeSize", k2Offset + 256 + 4,
+                size_t(rocmBin.getCodeSize()));
+    assertArray<cxbyte>("testROCmOccupancySpill", "k1.code",
+                Array<cxbyte>(rawContent.begin(), rawContent.end()),
+                rawContent.size(), code + 256);
+    // region offsets are relative to address of code
+    assertValue("testROCmOccupancySpill", "k2.offset", uint64_t(k2Offset),
+                uint64_t(rocmBin.getRegion("k2").offset - rocmBin.getRegion("k1").offset));
+    // end of second kernel is s_endpgm
+    assertValue("testROCmOccupancySpill", "k2.endpgm", uint32_t(0xbf810000),
+                ULEV(*reinterpret_cast<const uint32_t*>(code + k2Offset + 256)));
+}
+
+// assemble raw code of kernel (register variables are allocated)
+static Array<cxbyte> assembleKernelRawCode(const std::string& source)
+{
+    std::istringstream input(source);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+    const bool good = assembler.assemble();
+    assertString("testROCmKernelsRegAlloc", "raw.errorMessages", "", errorStream.str());
+    assertValue("testROCmKernelsRegAlloc", "raw.good", true, good);
+    const std::vector<cxbyte>& content = assembler.getSections()[0].content;
+    return Array<cxbyte>(content.begin(), content.end());
+}
+
+/* code of kernels in single section is allocated separately (in parallel),
+ * spill code in first kernel moves second kernel */
+static void testROCmKernelsRegAlloc()
+{
+    std::string k1Source = generateManyRegVarsCode(28, 10);
+    k1Source.insert(k1Source.find("v_mov_b32"),
+                ".spill_lds v2, 256\nv_lshlrev_b32 v2, 2, v0\n");
+    std::string k2Source = generateManyRegVarsCode(22, 10);
+    // register variables of second kernel are 'vb'
+    for (size_t pos = 0; (pos = k2Source.find(" va", pos)) != std::string::npos; )
+        k2Source[pos+2] = 'b';
+    const Array<cxbyte> k1Code = assembleKernelRawCode(k1Source);
+    const Array<cxbyte> k2Code = assembleKernelRawCode(k2Source);
+    
+    const size_t regAllocEnd = k1Source.find('\n')+1;
+    const std::string source = ".rocm\n.gpu Fiji\n"
+            ".kernel k1\n    .config\n        .dims x\n"
+            ".kernel k2\n    .config\n        .dims x\n"
+            ".text\n" + k1Source.substr(0, regAllocEnd) + "k1:\n    .skip 256\n" +
+            k1Source.substr(regAllocEnd) + ".p2align 8\nk2:\n    .skip 256\n" +
+            k2Source.substr(k2Source.find('\n')+1);
+    Array<cxbyte> binaries[2];
+    const cxuint threadsNums[2] = { 1, 4 };
+    for (cxuint t = 0; t < 2; t++)
+    {
+        std::istringstream input(source);
+        std::ostringstream errorStream;
+        Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::ROCM, GPUDeviceType::FIJI, errorStream);
+        assembler.setThreadsNum(threadsNums[t]);
+        bool good = assembler.assemble();
+        assertValue("testROCmKernelsRegAlloc", "good", true, good);
+        assertString("testROCmKernelsRegAlloc", "errorMessages", "",
+                    errorStream.str());
+        assembler.writeBinary(binaries[t]);
+    }
+    assertArray<cxbyte>("testROCmKernelsRegAlloc", "binary", binaries[0], binaries[1]);
+    
+    ROCmBinary rocmBin(binaries[1].size(), binaries[1].data(), 0);
+    const cxbyte* code = rocmBin.getCode();
+    const size_t k2Offset = (256 + k1Code.size() + 255) & ~size_t(255);
+    assertValue("testROCmKernelsRegAlloc", "k2.offset", uint64_t(k2Offset),
+                uint64_t(rocmBin.getRegion("k2").offset - rocmBin.getRegion("k1").offset));
+    assertValue("testROCmKernelsRegAlloc", "codeSize", k2Offset + 256 + k2Code.size(),
+                size_t(rocmBin.getCodeSize()));
+    assertArray<cxbyte>("testROCmKernelsRegAlloc", "k1.code", k1Code,
+                k1Code.size(), code + 256);
+    assertArray<cxbyte>("testROCmKernelsRegAlloc", "k2.code", k2Code,
+                k2Code.size(), code + k2Offset + 256);
+}
+
+static const char* regPressureSource = R"ffDXD(.regalloc
+.regvar sc:s, va:v, vb:v, vc:v, vd:v
+    s_mov_b32 sc, 10
+    v_mov_b32 va, 1.0
+    v_mov_b32 vb, 2.0
+    v_mov_b32 vc, 3.0
+    v_mov_b32 vd, 4.0
+loop:
+    v_add_f32 va, va, vb
+    v_add_f32 va, va, vc
+    s_sub_u32 sc, sc, 1
+    s_cbranch_scc0 loop
+    v_add_f32 va, va, vd
+    buffer_load_dword vb, v0, s[0:3], 0 offen
+    v_add_f32 va, va, vb
+    v_mov_b32 v1, va
+    s_endpgm
+)ffDXD";
+
+static const char* regPressureJSON = R"ffDXD({
+  "device": "Fiji",
+  "sections": [
+    {
+      "section": ".text",
+      "kernel": null,
+      "localSize": 0,
+      "workGroupSize": 0,
+      "extraSGPRs": 2,
+      "maxSGPRs": 5,
+      "maxVGPRs": 5,
+      "waves": 10,
+      "blocks": [
+        { "start": 0, "end": 24, "maxSGPRs": 5, "sgprsPeakOffset": 0, "maxVGPRs": 5, "vgprsPeakOffset": 20, "waves": 10 },
+        { "start": 24, "end": 40, "maxSGPRs": 5, "sgprsPeakOffset": 24, "maxVGPRs": 5, "vgprsPeakOffset": 24, "waves": 10 },
+        { "start": 40, "end": 64, "maxSGPRs": 4, "sgprsPeakOffset": 40, "maxVGPRs": 3, "vgprsPeakOffset": 40, "waves": 10 }
+      ]
+    }
+  ]
+}
+)ffDXD";
+
+static void testRegPressure()
+{
+    std::istringstream input(regPressureSource);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+    assembler.setRegPressureReport(true);
+    bool good = assembler.assemble();
+    assertValue("testRegPressure", "good", true, good);
+    assertString("testRegPressure", "errorMessages", "", errorStream.str());
+    std::ostringstream reportStream;
+    assembler.writeRegPressureReport(reportStream);
+    assertString("testRegPressure", "report", regPressureJSON, reportStream.str());
+    
+    // register pressure flag only collects usages, registers are not allocated
+    std::string noAllocSource = regPressureSource;
+    noAllocSource.erase(0, noAllocSource.find('\n')+1);
+    std::istringstream noAllocInput(noAllocSource);
+    Assembler noAllocAssembler("test.s", noAllocInput,
+                    (ASM_ALL&~ASM_ALTMACRO)|ASM_REGPRESSURE,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+    good = noAllocAssembler.assemble();
+    assertValue("testRegPressure", "noAlloc.good", true, good);
+    assertString("testRegPressure", "noAlloc.errorMessages", "", errorStream.str());
+    std::ostringstream noAllocReportStream;
+    noAllocAssembler.writeRegPressureReport(noAllocReportStream);
+    assertString("testRegPressure", "noAlloc.report", regPressureJSON,
+                noAllocReportStream.str());
+    assertValue("testRegPressure", "noAlloc.isRegAlloc", false,
+                noAllocAssembler.isRegAlloc());
+    std::istringstream plainInput(noAllocSource);
+    Assembler plainAssembler("test.s", plainInput, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+    good = plainAssembler.assemble();
+    assertValue("testRegPressure", "plain.good", true, good);
+    const std::vector<cxbyte>& plainContent = plainAssembler.getSections()[0].content;
+    assertArray<cxbyte>("testRegPressure", "noAlloc.content",
+                Array<cxbyte>(plainContent.begin(), plainContent.end()),
+                noAllocAssembler.getSections()[0].content);
+    
+    // LDS size from kernel config limits occupancy
+    std::string source = amdRegAllocSource;
+    source.insert(source.find("        .uavid"), "        .hwlocal 16384\n");
+    std::istringstream amdInput(source);
+    Assembler amdAssembler("test.s", amdInput, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::AMD, GPUDeviceType::CAPE_VERDE, errorStream);
+    amdAssembler.setRegPressureReport(true);
+    good = amdAssembler.assemble();
+    assertValue("testRegPressure", "amd.good", true, good);
+    assertString("testRegPressure", "amd.errorMessages", "", errorStream.str());
+    const std::vector<AsmRegPressureSection>& pressures = amdAssembler.getRegPressures();
+    assertValue("testRegPressure", "amd.sectionsNum", size_t(1), pressures.size());
+    assertValue("testRegPressure", "amd.localSize", size_t(16384),
+                pressures[0].localSize);
+    assertValue("testRegPressure", "amd.maxSGPRs", 4U,
+                pressures[0].maxLiveRegs[REGTYPE_SGPR]);
+    assertValue("testRegPressure", "amd.maxVGPRs", 5U,
+                pressures[0].maxLiveRegs[REGTYPE_VGPR]);
+    assertValue("testRegPressure", "amd.extraSGPRs", 2U, pressures[0].extraSGPRsNum);
+    assertValue("testRegPressure", "amd.waves", 4U, pressures[0].wavesNum);
+    assertValue("testRegPressure", "amd.blocksNum", size_t(1), pressures[0].blocks.size());
+    
+    // smaller work-group (reqd_work_group_size) has less waves for this same LDS
+    source.insert(source.find("        .uavid"), "        .cws 64,1,1\n");
+    std::istringstream amdCwsInput(source);
+    Assembler amdCwsAssembler("test.s", amdCwsInput, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::AMD, GPUDeviceType::CAPE_VERDE, errorStream);
+    amdCwsAssembler.setRegPressureReport(true);
+    good = amdCwsAssembler.assemble();
+    assertValue("testRegPressure", "amdCws.good", true, good);
+    assertString("testRegPressure", "amdCws.errorMessages", "", errorStream.str());
+    const std::vector<AsmRegPressureSection>& cwsPressures =
+                amdCwsAssembler.getRegPressures();
+    assertValue("testRegPressure", "amdCws.sectionsNum", size_t(1), cwsPressures.size());
+    assertValue("testRegPressure", "amdCws.workGroupSize", 64U,
+                cwsPressures[0].workGroupSize);
+    assertValue("testRegPressure", "amdCws.waves", 1U, cwsPressures[0].wavesNum);
+
+    // errors of analysis are reported at instructions
+    std::ostringstream unreachErrorStream;
+    std::istringstream unreachInput(R"ffDXD(.regvar va:v, vb:v
+    v_mov_b32 va, v0
+    v_add_f32 v1, va, v1
+    s_endpgm
+.cf_start
+    v_mov_b32 vb, v0
+    v_add_f32 v1, vb, v1
+    s_endpgm
+)ffDXD");
+    Assembler unreachAssembler("test.s", unreachInput, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, unreachErrorStream);
+    unreachAssembler.setRegPressureReport(true);
+    good = unreachAssembler.assemble();
+    assertValue("testRegPressure", "unreach.good", false, good);
+    assertString("testRegPressure", "unreach.errorMessages",
+            "test.s:6:5: Error: Register variables in code not reachable from start "
+            "of code are not supported\n", unreachErrorStream.str());
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    for (cxuint i = 0; regAllocApplyTestCases[i].input!=nullptr; i++)
+        try
+        { testRegAllocApply(i, regAllocApplyTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    try
+    { testOccupancyLimit(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testRegAllocErrorPos(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testAmdKernelRegsNum(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    for (cxuint i = 0; i < sizeof(regAllocSpillTestCases)/
+                sizeof(AsmRegAllocSpillCase); i++)
+        try
+        { testRegAllocSpill(i, regAllocSpillTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    try
+    { testRegPressure(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testOccupancySpill(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testROCmOccupancySpill(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testROCmKernelsRegAlloc(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    try
+    { testParallelRegAlloc(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    return retVal;
+}
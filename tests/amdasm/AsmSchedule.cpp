@@ -0,0 +1,412 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct AsmScheduleCase
+{
+    GPUDeviceType deviceType;
+    const char* input;  // source in schedule mode
+    const char* expected;   // source with scheduled instructions
+    size_t movedInstrsNum;
+    bool good;
+    const char* errorMessages;
+};
+
+static const AsmScheduleCase scheduleTestCases[] =
+{
+    {   // 0 - loads are hoisted, waits are inserted after scheduling
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        .schedule
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        s_load_dwordx2 s[6:7], s[0:1], 8
+        v_lshlrev_b32 v0, 2, v0
+        v_add_u32 v1, vcc, s4, v0
+        v_mov_b32 v2, s5
+        buffer_load_dword v3, v1, s[8:11], 0 offen
+        v_add_f32 v4, v3, v3
+        buffer_load_dword v5, v1, s[8:11], 0 offset:4 offen
+        v_mul_f32 v6, v5, v5
+        v_add_f32 v7, v0, v0
+        v_add_f32 v8, v1, v1
+        v_add_f32 v9, v2, v2
+        v_add_f32 v10, v4, v6
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_load_dwordx2 s[4:5], s[0:1], 0
+        v_lshlrev_b32 v0, 2, v0
+        s_load_dwordx2 s[6:7], s[0:1], 8
+        v_add_f32 v7, v0, v0
+        s_waitcnt lgkmcnt(0)
+        v_add_u32 v1, vcc, s4, v0
+        buffer_load_dword v3, v1, s[8:11], 0 offen
+        buffer_load_dword v5, v1, s[8:11], 0 offset:4 offen
+        v_mov_b32 v2, s5
+        v_add_f32 v8, v1, v1
+        v_add_f32 v9, v2, v2
+        s_waitcnt vmcnt(1)
+        v_add_f32 v4, v3, v3
+        s_waitcnt vmcnt(0)
+        v_mul_f32 v6, v5, v5
+        v_add_f32 v10, v4, v6
+        s_endpgm
+)ffDXD", 10, true, ""
+    },
+    {   // 1 - explicit waits are barriers
+        GPUDeviceType::FIJI,
+        R"ffDXD(.schedule
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v1, v1
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:4
+        v_mul_f32 v4, v2, v2
+        v_mul_f32 v5, v4, v4
+        s_waitcnt vmcnt(0)
+        v_add_f32 v6, v3, v5
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(0)
+        buffer_load_dword v3, v0, s[8:11], 0 offen offset:4
+        v_add_f32 v2, v1, v1
+        v_mul_f32 v4, v2, v2
+        v_mul_f32 v5, v4, v4
+        s_waitcnt vmcnt(0)
+        v_add_f32 v6, v3, v5
+        s_endpgm
+)ffDXD", 2, true, ""
+    },
+    {   // 2 - instructions are not moved across labels
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        .schedule
+        v_add_f32 v1, v0, v0
+        v_mul_f32 v2, v1, v1
+l1:     s_load_dword s4, s[0:1], 0
+        v_add_f32 v3, s4, v2
+        s_load_dword s5, s[0:1], 4
+        v_add_f32 v4, v3, v2
+        v_add_f32 v5, s5, v4
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        v_add_f32 v1, v0, v0
+        v_mul_f32 v2, v1, v1
+l1:     s_load_dword s4, s[0:1], 0
+        s_load_dword s5, s[0:1], 4
+        s_waitcnt lgkmcnt(0)
+        v_add_f32 v3, s4, v2
+        v_add_f32 v4, v3, v2
+        v_add_f32 v5, s5, v4
+        s_endpgm
+)ffDXD", 2, true, ""
+    },
+    {   // 3 - with register allocation and loop
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+        .autowait
+        .schedule
+        .regvar sa:s:4, va:v:8
+        s_load_dwordx2 sa[0:1], s[0:1], 0
+        v_mov_b32 va[0], v0
+        s_waitcnt lgkmcnt(0)
+        buffer_load_dword va[1], va[0], s[8:11], 0 offen
+        v_add_f32 va[2], va[1], va[1]
+        buffer_load_dword va[3], va[0], s[8:11], 0 offset:4 offen
+        v_mul_f32 va[4], va[3], va[3]
+        v_add_f32 va[5], va[0], va[0]
+loop:
+        v_add_f32 va[6], va[5], va[5]
+        buffer_load_dword va[7], va[0], s[8:11], 0 offset:8 offen
+        v_mul_f32 va[7], va[7], va[6]
+        v_add_f32 va[5], va[4], va[2]
+        s_cbranch_vccnz loop
+        buffer_store_dword va[7], va[0], s[8:11], 0 offen
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_load_dwordx2 s[0:1], s[0:1], 0
+        s_waitcnt lgkmcnt(0)
+        buffer_load_dword v3, v0, s[8:11], 0 offen
+        buffer_load_dword v2, v0, s[8:11], 0 offset:4 offen
+        v_add_f32 v1, v0, v0
+        s_waitcnt vmcnt(1)
+        v_add_f32 v4, v3, v3
+        s_waitcnt vmcnt(0)
+        v_mul_f32 v3, v2, v2
+loop:
+        buffer_load_dword v2, v0, s[8:11], 0 offset:8 offen
+        v_add_f32 v1, v1, v1
+        s_waitcnt vmcnt(0)
+        v_mul_f32 v2, v2, v1
+        v_add_f32 v1, v3, v4
+        s_cbranch_vccnz loop
+        buffer_store_dword v2, v0, s[8:11], 0 offen
+        s_endpgm
+)ffDXD", 6, true, ""
+    },
+    {   // 4 - dependency chain (nothing to move)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.autowait
+        .schedule
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_add_f32 v2, v1, v1
+        v_mul_f32 v3, v2, v2
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v1, v1
+        v_mul_f32 v3, v2, v2
+        s_endpgm
+)ffDXD", 0, true, ""
+    },
+    {   // 5 - error (schedule mode after code)
+        GPUDeviceType::FIJI,
+        R"ffDXD(        s_endpgm
+        .schedule
+)ffDXD",
+        "", 0, false,
+        "test.s:2:18: Error: Scheduling must be enabled before code\n"
+    },
+    {   // 6 - hazard: VGPR written by VALU and read by DPP (2 wait states)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.schedule
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_add_f32 v3, v1, v1
+        v_add_f32 v4, v0, v0
+        v_add_f32 v5, v0, v0
+        v_add_f32 v7, v0, v0
+        v_mov_b32 v6, v3 quad_perm:[1,0,3,2]
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_add_f32 v4, v0, v0
+        v_add_f32 v3, v1, v1
+        v_add_f32 v5, v0, v0
+        v_add_f32 v7, v0, v0
+        v_mov_b32 v6, v3 quad_perm:[1,0,3,2]
+        s_endpgm
+)ffDXD", 2, true, ""
+    },
+    {   // 7 - hazard: SGPR written by VALU and read by VMEM (5 wait states)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.schedule
+        v_cmp_eq_u32 s[12:13], v0, v1
+        v_add_f32 v4, v0, v0
+        v_add_f32 v5, v0, v0
+        v_add_f32 v6, v0, v0
+        buffer_load_dword v9, v2, s[12:15], 0 offen
+        v_add_f32 v7, v0, v0
+        v_add_f32 v8, v9, v9
+        buffer_load_dword v10, v2, s[16:19], 0 offen
+        v_add_f32 v11, v10, v10
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        v_cmp_eq_u32 s[12:13], v0, v1
+        v_add_f32 v4, v0, v0
+        v_add_f32 v5, v0, v0
+        v_add_f32 v6, v0, v0
+        buffer_load_dword v9, v2, s[12:15], 0 offen
+        buffer_load_dword v10, v2, s[16:19], 0 offen
+        v_add_f32 v7, v0, v0
+        v_add_f32 v8, v9, v9
+        v_add_f32 v11, v10, v10
+        s_endpgm
+)ffDXD", 3, true, ""
+    },
+    {   // 8 - hazard: lane select written by VALU and read by readlane (4 wait states)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.schedule
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_cmp_eq_u32 s[12:13], v1, v0
+        v_add_f32 v4, v0, v0
+        v_add_f32 v5, v0, v0
+        v_add_f32 v6, v0, v0
+        v_add_f32 v7, v0, v0
+        v_add_f32 v8, v0, v0
+        v_readlane_b32 s20, v5, s12
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        buffer_load_dword v1, v0, s[8:11], 0 offen
+        v_add_f32 v4, v0, v0
+        v_cmp_eq_u32 s[12:13], v1, v0
+        v_add_f32 v5, v0, v0
+        v_add_f32 v6, v0, v0
+        v_add_f32 v7, v0, v0
+        v_add_f32 v8, v0, v0
+        v_readlane_b32 s20, v5, s12
+        s_endpgm
+)ffDXD", 2, true, ""
+    },
+    {   // 9 - hazard: M0 written by SALU and read by interpolation (1 wait state)
+        GPUDeviceType::FIJI,
+        R"ffDXD(.schedule
+        s_mov_b32 m0, s2
+        v_add_f32 v4, v0, v0
+        v_add_f32 v9, v0, v0
+        v_interp_p1_f32 v5, v0, attr0.x
+        buffer_load_dword v6, v5, s[12:15], 0 offen
+        v_add_f32 v7, v6, v6
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        s_mov_b32 m0, s2
+        v_add_f32 v4, v0, v0
+        v_interp_p1_f32 v5, v0, attr0.x
+        buffer_load_dword v6, v5, s[12:15], 0 offen
+        v_add_f32 v9, v0, v0
+        v_add_f32 v7, v6, v6
+        s_endpgm
+)ffDXD", 3, true, ""
+    }
+};
+
+static std::vector<cxbyte> assembleRawCode(const std::string& testCaseName,
+            GPUDeviceType deviceType, const char* input, bool& good,
+            std::string& errorMessages, size_t* movedInstrsNum = nullptr)
+{
+    std::istringstream input2(input);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input2, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, deviceType, errorStream);
+    good = assembler.assemble();
+    errorMessages = errorStream.str();
+    if (movedInstrsNum != nullptr)
+        *movedInstrsNum = assembler.getMovedInstrsNum();
+    if (!good)
+        return std::vector<cxbyte>();
+    if (assembler.getSections().size() < 1)
+        throw Exception(testCaseName+": No sections");
+    return assembler.getSections()[0].content;
+}
+
+static void testSchedule(cxuint i, const AsmScheduleCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "scheduleCase#" << i;
+    const std::string testCaseName = oss.str();
+    bool good;
+    std::string errorMessages;
+    size_t movedInstrsNum;
+    const std::vector<cxbyte> result = assembleRawCode(testCaseName,
+                testCase.deviceType, testCase.input, good, errorMessages,
+                &movedInstrsNum);
+    assertValue("testSchedule", testCaseName+".good", testCase.good, good);
+    assertString("testSchedule", testCaseName+".errorMessages",
+                testCase.errorMessages, errorMessages);
+    if (!good)
+        return;
+    assertValue("testSchedule", testCaseName+".movedInstrsNum",
+                testCase.movedInstrsNum, movedInstrsNum);
+
+    bool expGood;
+    std::string expErrorMessages;
+    const std::vector<cxbyte> expResult = assembleRawCode(testCaseName+"Exp",
+                testCase.deviceType, testCase.expected, expGood, expErrorMessages);
+    if (!expGood)
+        throw Exception(testCaseName+": Expected source can not be assembled");
+    assertArray<cxbyte>("testSchedule", testCaseName+".content",
+                Array<cxbyte>(expResult.begin(), expResult.end()), result);
+}
+
+// generate code with many kernels in single section (like ROCm binaries)
+static std::string generateManyKernelsCode(cxuint kernelsNum)
+{
+    std::ostringstream oss;
+    oss << ".autowait\n.schedule\n";
+    for (cxuint k = 0; k < kernelsNum; k++)
+    {
+        oss << "kernel" << k << ":\n"
+            "    s_load_dwordx2 s[4:5], s[0:1], " << (k*8) << "\n"
+            "    v_lshlrev_b32 v0, 2, v0\n"
+            "    v_add_u32 v1, vcc, s4, v0\n";
+        for (cxuint i = 0; i < 2 + k%5; i++)
+            oss << "    buffer_load_dword v" << (3+2*i) << ", v1, s[8:11], 0 offset:" <<
+                    (i*4) << " offen\n"
+                "    v_mul_f32 v" << (4+2*i) << ", v" << (3+2*i) << ", v0\n";
+        oss << "    v_add_f32 v20, v0, v0\n    v_add_f32 v21, v1, v1\n"
+                "    s_endpgm\n";
+    }
+    return oss.str();
+}
+
+// scheduling in many threads should give same result as in single thread
+static void testParallelSchedule()
+{
+    const std::string source = generateManyKernelsCode(24);
+    std::vector<cxbyte> contents[2];
+    size_t movedInstrsNums[2];
+    const cxuint threadsNums[2] = { 1, 4 };
+    for (cxuint t = 0; t < 2; t++)
+    {
+        std::istringstream input(source);
+        std::ostringstream errorStream;
+        Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, GPUDeviceType::FIJI, errorStream);
+        assembler.setThreadsNum(threadsNums[t]);
+        bool good = assembler.assemble();
+        assertValue("testParallelSchedule", "good", true, good);
+        assertString("testParallelSchedule", "errorMessages", "", errorStream.str());
+        contents[t] = assembler.getSections()[0].content;
+        movedInstrsNums[t] = assembler.getMovedInstrsNum();
+    }
+    assertTrue("testParallelSchedule", "moved", movedInstrsNums[0] != 0);
+    assertValue("testParallelSchedule", "movedInstrsNum", movedInstrsNums[0],
+                movedInstrsNums[1]);
+    assertArray<cxbyte>("testParallelSchedule", "content",
+                Array<cxbyte>(contents[0].begin(), contents[0].end()), contents[1]);
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    for (cxuint i = 0; i < sizeof(scheduleTestCases)/sizeof(AsmScheduleCase); i++)
+        try
+        { testSchedule(i, scheduleTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    try
+    { testParallelSchedule(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
+    return retVal;
+}
@@ -0,0 +1,223 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct AsmShrinkCase
+{
+    GPUDeviceType deviceType;
+    const char* input;  // source in shrink mode
+    const char* expected;   // source with shortest encodings
+    size_t savedBytesNum;
+    bool good;
+    const char* errorMessages;
+};
+
+static const AsmShrinkCase shrinkTestCases[] =
+{
+    {   // 0 - VOP3 to VOP2/VOPC/VOP1, swapped operands, inline constants
+        GPUDeviceType::FIJI,
+        R"ffDXD(.shrink
+        v_add_f32_e64 v0, v1, v2
+        v_add_f32 v0, v1, s2
+        v_sub_f32 v0, v1, s2
+        v_subrev_f32 v0, v1, 1.0
+        v_lshlrev_b32 v0, v1, 4
+        v_add_i32 v0, vcc, v1, s3
+        v_cmp_lt_f32 vcc, v1, s2
+        v_cmp_class_f32 vcc, v1, s2
+        v_cmp_eq_u32 vcc, v1, 5
+        v_mov_b32 v0, 0x3f800000
+        v_mov_b32 v0, 0xfffffff0
+        s_mov_b32 s0, 0x40800000
+        v_add_u16 v0, 0x3c00, v1
+        v_add_f16 v0, 0x3c00, v1
+        v_mov_b32_e64 v0, v1
+        v_cndmask_b32 v0, v1, 0, vcc
+        v_mul_f32 v0, v1, 0x12345
+        v_add_f32_e64 v0, v1, v2 clamp
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        v_add_f32 v0, v1, v2
+        v_add_f32 v0, s2, v1
+        v_subrev_f32 v0, s2, v1
+        v_sub_f32 v0, 1.0, v1
+        v_lshlrev_b32 v0, v1, 4
+        v_add_u32 v0, vcc, s3, v1
+        v_cmp_gt_f32 vcc, s2, v1
+        v_cmp_class_f32 vcc, v1, s2
+        v_cmp_eq_u32 vcc, 5, v1
+        v_mov_b32 v0, 0x3f800000
+        v_mov_b32 v0, -16
+        s_mov_b32 s0, 4.0
+        v_add_u16 v0, 0x3c00, v1
+        v_add_f16 v0, 1.0, v1
+        v_mov_b32 v0, v1
+        v_cndmask_b32 v0, v1, 0, vcc
+        v_mul_f32 v0, 0x12345, v1
+        v_add_f32_e64 v0, v1, v2 clamp
+        s_endpgm
+)ffDXD", 44, true, ""
+    },
+    {   // 1 - GCN1.0 (non-reversed shifts, no 1/(2*PI) constant)
+        GPUDeviceType::PITCAIRN,
+        R"ffDXD(.shrink
+        v_lshlrev_b32 v0, v1, 4
+        v_ashr_i32 v0, v1, s5
+        v_cmp_nge_f32 s[0:1], v1, s2
+        v_cmpx_le_i32 vcc, v1, s2
+        v_add_f32 v0, v1, 0x3e22f983
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        v_lshl_b32 v0, 4, v1
+        v_ashrrev_i32 v0, s5, v1
+        v_cmp_nge_f32 s[0:1], v1, s2
+        v_cmpx_ge_i32 vcc, s2, v1
+        v_add_f32 v0, 0x3e22f983, v1
+        s_endpgm
+)ffDXD", 12, true, ""
+    },
+    {   // 2 - with register allocation
+        GPUDeviceType::FIJI,
+        R"ffDXD(.regalloc
+        .shrink
+        .regvar sa:s:2, va:v:4
+        s_mov_b32 sa[0], s4
+        v_mov_b32 va[0], v0
+        v_sub_f32 va[1], va[0], sa[0]
+        v_cmp_lt_f32 vcc, va[1], sa[0]
+        v_cndmask_b32 va[2], va[1], va[0], vcc
+        buffer_store_dword va[2], v0, s[8:11], 0 offen
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        v_mov_b32 v2, v0
+        v_subrev_f32 v1, s4, v2
+        v_cmp_gt_f32 vcc, s4, v1
+        v_cndmask_b32 v1, v1, v2, vcc
+        buffer_store_dword v1, v0, s[8:11], 0 offen
+        s_endpgm
+)ffDXD", 8, true, ""
+    },
+    {   // 3 - disable shrink mode
+        GPUDeviceType::FIJI,
+        R"ffDXD(.shrink
+        v_add_f32_e64 v0, v1, v2
+        .noshrink
+        v_add_f32_e64 v0, v1, v2
+        v_mov_b32 v0, 0xfffffff0
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        v_add_f32 v0, v1, v2
+        v_add_f32_e64 v0, v1, v2
+        v_mov_b32 v0, 0xfffffff0
+        s_endpgm
+)ffDXD", 4, true, ""
+    },
+    {   // 4 - GCN1.5 (VOP3 encoding can hold literal)
+        GPUDeviceType::GFX1010,
+        R"ffDXD(.shrink
+        v_add_f32_e64 v0, v1, 0x12345
+        v_mov_b32_e64 v0, 0x12345
+        v_cmp_eq_u32_e64 vcc, 0x12345, v1
+        v_add_f32_e64 v0, v1, v2
+        s_endpgm
+)ffDXD",
+        R"ffDXD(
+        v_add_f32 v0, 0x12345, v1
+        v_mov_b32 v0, 0x12345
+        v_cmp_eq_u32 vcc, 0x12345, v1
+        v_add_f32 v0, v1, v2
+        s_endpgm
+)ffDXD", 16, true, ""
+    }
+};
+
+static std::vector<cxbyte> assembleRawCode(const std::string& testCaseName,
+            GPUDeviceType deviceType, const char* input, bool& good,
+            std::string& errorMessages, size_t* savedBytesNum = nullptr)
+{
+    std::istringstream input2(input);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input2, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, deviceType, errorStream);
+    good = assembler.assemble();
+    errorMessages = errorStream.str();
+    if (savedBytesNum != nullptr)
+        *savedBytesNum = assembler.getSavedBytesNum();
+    if (!good)
+        return std::vector<cxbyte>();
+    if (assembler.getSections().size() < 1)
+        throw Exception(testCaseName+": No sections");
+    return assembler.getSections()[0].content;
+}
+
+static void testShrink(cxuint i, const AsmShrinkCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "shrinkCase#" << i;
+    const std::string testCaseName = oss.str();
+    bool good;
+    std::string errorMessages;
+    size_t savedBytesNum;
+    const std::vector<cxbyte> result = assembleRawCode(testCaseName,
+                testCase.deviceType, testCase.input, good, errorMessages,
+                &savedBytesNum);
+    assertValue("testShrink", testCaseName+".good", testCase.good, good);
+    assertString("testShrink", testCaseName+".errorMessages",
+                testCase.errorMessages, errorMessages);
+    if (!good)
+        return;
+    assertValue("testShrink", testCaseName+".savedBytesNum",
+                testCase.savedBytesNum, savedBytesNum);
+
+    bool expGood;
+    std::string expErrorMessages;
+    const std::vector<cxbyte> expResult = assembleRawCode(testCaseName+"Exp",
+                testCase.deviceType, testCase.expected, expGood, expErrorMessages);
+    if (!expGood)
+        throw Exception(testCaseName+": Expected source can not be assembled");
+    assertArray<cxbyte>("testShrink", testCaseName+".content",
+                Array<cxbyte>(expResult.begin(), expResult.end()), result);
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    for (cxuint i = 0; i < sizeof(shrinkTestCases)/sizeof(AsmShrinkCase); i++)
+        try
+        { testShrink(i, shrinkTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    return retVal;
+}
@@ -0,0 +1,196 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <CLRX/utils/Utilities.h>
+#include <CLRX/amdasm/Assembler.h>
+#include <CLRX/amdasm/GCNPerfModel.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct GCNPerfBlockCase
+{
+    size_t start;
+    size_t end;
+    // salu, valu, vmem, smem, lds, export, branch, wait, illegal
+    cxuint instrsNum[GCNPERF_CLASSES_NUM];
+    uint64_t issueCycles;
+    cxuint literalsNum;
+    uint64_t literalCycles;
+    uint64_t stallCycles;
+    std::vector<GCNPerfStall> stalls;
+};
+
+struct GCNPerfModelCase
+{
+    GPUDeviceType deviceType;
+    const char* input;
+    std::vector<GCNPerfBlockCase> blocks;
+};
+
+static const GCNPerfModelCase perfModelTestCases[] =
+{
+    {   // 0 - literal cycles (GCN 1.0), branch, stalls
+        GPUDeviceType::PITCAIRN,
+        R"ffDXD(
+        s_load_dwordx2 s[0:1], s[4:5], 0
+        s_waitcnt lgkmcnt(0)
+        v_mov_b32 v1, 0x3f800000
+        buffer_load_dword v2, v0, s[8:11], 0 offen
+        v_add_f32 v3, v1, v1
+        v_rcp_f32 v4, v3
+        s_waitcnt vmcnt(0)
+        v_add_f32 v2, v2, v4
+        s_cbranch_vccz label
+        v_mul_f64 v[6:7], v[6:7], v[6:7]
+label:
+        buffer_store_dword v2, v0, s[8:11], 0 offen
+        s_endpgm
+)ffDXD",
+        {
+            { 0, 44, { 0, 4, 1, 1, 0, 0, 1, 2, 0 }, 56, 1, 4, 392,
+                {
+                    { 4, GCNPERF_LGKMCNT, 0, 0, 4, 24 },
+                    { 32, GCNPERF_VMCNT, 0, 16, 28, 368 }
+                } },
+            { 44, 52, { 0, 1, 0, 0, 0, 0, 0, 0, 0 }, 64, 0, 0, 0, { } },
+            { 52, 64, { 0, 0, 1, 0, 0, 0, 1, 0, 0 }, 20, 0, 0, 0, { } }
+        }
+    },
+    {   // 1 - partial waits, export, no literal cycles (GCN 1.2)
+        GPUDeviceType::FIJI,
+        R"ffDXD(
+        s_load_dwordx8 s[0:7], s[4:5], 0
+        ds_read_b32 v1, v0
+        s_add_u32 s8, s9, 0x1234
+        s_waitcnt lgkmcnt(1)
+        v_mov_b32 v2, 0x3f800000
+        v_fma_f64 v[4:5], v[4:5], v[4:5], v[4:5]
+        s_waitcnt lgkmcnt(0)
+        exp  mrt0, v1, v1, v1, v1 done
+        s_waitcnt expcnt(0)
+        s_endpgm
+)ffDXD",
+        {
+            { 0, 64, { 1, 2, 0, 1, 1, 1, 1, 3, 0 }, 104, 2, 0, 20,
+                {
+                    { 24, GCNPERF_LGKMCNT, 1, 0, 16, 12 },
+                    { 44, GCNPERF_LGKMCNT, 0, 8, 92, 0 },
+                    { 56, GCNPERF_EXPCNT, 0, 48, 4, 8 }
+                } }
+        }
+    }
+};
+
+static void testPerfModel(cxuint i, const GCNPerfModelCase& testCase)
+{
+    std::ostringstream oss;
+    oss << "perfModelCase#" << i;
+    const std::string testCaseName = oss.str();
+    std::istringstream input(testCase.input);
+    std::ostringstream errorStream;
+    Assembler assembler("test.s", input, ASM_ALL&~ASM_ALTMACRO,
+                    BinaryFormat::RAWCODE, testCase.deviceType, errorStream);
+    if (!assembler.assemble())
+        throw Exception(testCaseName+": Can not assemble code:\n"+errorStream.str());
+    
+    GCNPerfModel perfModel(testCase.deviceType);
+    perfModel.analyzeAssembler(assembler);
+    const std::vector<GCNPerfKernel>& kernels = perfModel.getKernels();
+    assertValue("testPerfModel", testCaseName+".kernels.size", size_t(1), kernels.size());
+    const GCNPerfKernel& kernel = kernels[0];
+    assertValue("testPerfModel", testCaseName+".kernel.offset", size_t(0), kernel.offset);
+    assertValue("testPerfModel", testCaseName+".kernel.size",
+                assembler.getSections()[0].content.size(), kernel.size);
+    assertValue("testPerfModel", testCaseName+".blocks.size",
+                testCase.blocks.size(), kernel.blocks.size());
+    
+    for (size_t j = 0; j < kernel.blocks.size(); j++)
+    {
+        std::ostringstream bOss;
+        bOss << testCaseName << ".block#" << j;
+        const std::string bname = bOss.str();
+        const GCNPerfBlockCase& expBlock = testCase.blocks[j];
+        const GCNPerfBlock& resBlock = kernel.blocks[j];
+        assertValue("testPerfModel", bname+".start", expBlock.start, resBlock.start);
+        assertValue("testPerfModel", bname+".end", expBlock.end, resBlock.end);
+        assertArray<cxuint>("testPerfModel", bname+".instrsNum",
+                Array<cxuint>(expBlock.instrsNum, expBlock.instrsNum+GCNPERF_CLASSES_NUM),
+                GCNPERF_CLASSES_NUM, resBlock.instrsNum);
+        assertValue("testPerfModel", bname+".issueCycles",
+                expBlock.issueCycles, resBlock.issueCycles);
+        assertValue("testPerfModel", bname+".literalsNum",
+                expBlock.literalsNum, resBlock.literalsNum);
+        assertValue("testPerfModel", bname+".literalCycles",
+                expBlock.literalCycles, resBlock.literalCycles);
+        assertValue("testPerfModel", bname+".stallCycles",
+                expBlock.stallCycles, resBlock.stallCycles);
+        assertValue("testPerfModel", bname+".stalls.size",
+                expBlock.stalls.size(), resBlock.stalls.size());
+        for (size_t k = 0; k < resBlock.stalls.size(); k++)
+        {
+            std::ostringstream sOss;
+            sOss << bname << ".stall#" << k;
+            const std::string sname = sOss.str();
+            const GCNPerfStall& expStall = expBlock.stalls[k];
+            const GCNPerfStall& resStall = resBlock.stalls[k];
+            assertValue("testPerfModel", sname+".offset", expStall.offset,
+                        resStall.offset);
+            assertValue("testPerfModel", sname+".counter", cxuint(expStall.counter),
+                        cxuint(resStall.counter));
+            assertValue("testPerfModel", sname+".count", expStall.count, resStall.count);
+            assertValue("testPerfModel", sname+".opOffset", expStall.opOffset,
+                        resStall.opOffset);
+            assertValue("testPerfModel", sname+".coveredCycles",
+                        expStall.coveredCycles, resStall.coveredCycles);
+            assertValue("testPerfModel", sname+".stallCycles",
+                        expStall.stallCycles, resStall.stallCycles);
+        }
+    }
+    // sum of block statistics
+    uint64_t issueCycles = 0, stallCycles = 0;
+    for (const GCNPerfBlockCase& block: testCase.blocks)
+    {
+        issueCycles += block.issueCycles;
+        stallCycles += block.stallCycles;
+    }
+    assertValue("testPerfModel", testCaseName+".kernel.issueCycles",
+                issueCycles, kernel.issueCycles);
+    assertValue("testPerfModel", testCaseName+".kernel.stallCycles",
+                stallCycles, kernel.stallCycles);
+}
+
+int main(int argc, const char** argv)
+{
+    int retVal = 0;
+    for (cxuint i = 0; i < sizeof(perfModelTestCases)/sizeof(GCNPerfModelCase); i++)
+        try
+        { testPerfModel(i, perfModelTestCases[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    return retVal;
+}
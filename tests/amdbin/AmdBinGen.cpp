@@ -22,6 +22,7 @@
 #include <sstream>
 #include <map>
 #include <memory>
+#include <vector>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/amdbin/AmdBinaries.h>
 #include <CLRX/amdbin/AmdBinGen.h>
@@ -674,6 +675,69 @@ static void testOrigBinary(cxuint testCase, const char* origBinaryFilename, bool
                     ": byte=" << i;
             throw Exception(oss.str());
         }
+    
+    // generating to output stream must give same binary
+    std::ostringstream streamOut;
+    binGen.generate(streamOut);
+    if (streamOut.str() != std::string(reinterpret_cast<const char*>(output.data()),
+                output.size()))
+    {
+        std::ostringstream oss;
+        oss << "Failed for #" << testCase << " file=" << origBinaryFilename <<
+                ": stream output differs";
+        throw Exception(oss.str());
+    }
+}
+
+// inner binaries generated by many threads must be identical to serial output
+static void testParallelGeneration()
+{
+    const cxuint kernelsNum = 24;
+    AmdInput amdInput{};
+    amdInput.is64Bit = false;
+    amdInput.deviceType = GPUDeviceType::PITCAIRN;
+    amdInput.driverVersion = 180005;
+    std::vector<std::vector<cxbyte> > codes(kernelsNum);
+    std::vector<std::string> kernelNames(kernelsNum);
+    for (cxuint k = 0; k < kernelsNum; k++)
+    {
+        // different code sizes to get different offsets of inner binaries
+        codes[k].resize(8 + (k*12)%64);
+        for (size_t i = 0; i < codes[k].size(); i++)
+            codes[k][i] = cxbyte(k*7 + i);
+        kernelNames[k] = "kernel" + std::to_string(k);
+        amdInput.addEmptyKernel(kernelNames[k].c_str());
+        AmdKernelInput& kernel = amdInput.kernels.back();
+        kernel.useConfig = true;
+        kernel.config.usedVGPRsNum = 4;
+        kernel.config.usedSGPRsNum = 12;
+        kernel.codeSize = codes[k].size();
+        kernel.code = codes[k].data();
+    }
+    
+    AmdGPUBinGenerator serialGen(&amdInput);
+    serialGen.setThreadsNum(1);
+    Array<cxbyte> serialOutput;
+    serialGen.generate(serialOutput);
+    
+    AmdGPUBinGenerator parallelGen(&amdInput);
+    parallelGen.setThreadsNum(4);
+    Array<cxbyte> arrayOutput;
+    parallelGen.generate(arrayOutput);
+    std::vector<char> vectorOutput;
+    parallelGen.generate(vectorOutput);
+    std::ostringstream streamOutput;
+    parallelGen.generate(streamOutput);
+    
+    const std::string serialStr(reinterpret_cast<const char*>(serialOutput.data()),
+                serialOutput.size());
+    if (serialStr != std::string(reinterpret_cast<const char*>(arrayOutput.data()),
+                arrayOutput.size()))
+        throw Exception("Parallel generation: array output differs");
+    if (serialStr != std::string(vectorOutput.begin(), vectorOutput.end()))
+        throw Exception("Parallel generation: vector output differs");
+    if (serialStr != streamOutput.str())
+        throw Exception("Parallel generation: stream output differs");
 }
 
 int main(int argc, const char** argv)
@@ -702,5 +766,12 @@ int main(int argc, const char** argv)
             retVal = 1;
         }
     }
+    try
+    { testParallelGeneration(); }
+    catch(const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        retVal = 1;
+    }
     return retVal;
 }
@@ -545,6 +545,68 @@ static void testAmdGPUMetadataGen()
 ;value:stage:u32:1:)blaB");
 }
 
+// compare lazy loaded binary with fully loaded binary
+static void testLazyLoading(const char* filename)
+{
+    const std::string testName = std::string("testLazyLoading:") + filename;
+    
+    Array<cxbyte> data = loadDataFromFile(filename);
+    std::unique_ptr<AmdMainGPUBinaryBase> expBase(static_cast<AmdMainGPUBinaryBase*>(
+                createAmdBinaryFromCode(data.size(), data.data())));
+    std::unique_ptr<AmdMainGPUBinaryBase> base(static_cast<AmdMainGPUBinaryBase*>(
+        createAmdBinaryFromCode(data.size(), data.data(),
+                AMDBIN_CREATE_ALL | AMDBIN_CREATE_LAZY)));
+    
+    assertValue(testName, "innerBinariesNum", expBase->getInnerBinariesNum(),
+                base->getInnerBinariesNum());
+    // access in reverse order by name
+    for (size_t i = expBase->getInnerBinariesNum(); i > 0; i--)
+    {
+        const AmdInnerGPUBinary32& expInner = expBase->getInnerBinary(i-1);
+        std::ostringstream oss;
+        oss << "inner#" << (i-1);
+        const std::string caseName = oss.str();
+        const AmdInnerGPUBinary32& inner = base->getInnerBinary(
+                    expInner.getKernelName().c_str());
+        assertValue(testName, caseName+" kernelName", expInner.getKernelName(),
+                    inner.getKernelName());
+        assertValue(testName, caseName+" size", expInner.getSize(), inner.getSize());
+        assertValue(testName, caseName+" encodingsNum",
+                    expInner.getCALEncodingEntriesNum(),
+                    inner.getCALEncodingEntriesNum());
+        for (cxuint k = 0; k < expInner.getCALEncodingEntriesNum(); k++)
+            assertValue(testName, caseName+" calNotesNum", expInner.getCALNotesNum(k),
+                    inner.getCALNotesNum(k));
+        assertValue(testName, caseName+" sectionsNum", expInner.getSectionHeadersNum(),
+                    inner.getSectionHeadersNum());
+    }
+    
+    assertValue(testName, "kernelInfosNum", expBase->getKernelInfosNum(),
+                base->getKernelInfosNum());
+    for (size_t i = 0; i < expBase->getKernelInfosNum(); i++)
+    {
+        const KernelInfo& expKernelInfo = expBase->getKernelInfo(i);
+        std::ostringstream oss;
+        oss << "kernelInfo#" << i;
+        const std::string caseName = oss.str();
+        const KernelInfo& kernelInfo = base->getKernelInfo(
+                    expKernelInfo.kernelName.c_str());
+        assertValue(testName, caseName+" kernelName", expKernelInfo.kernelName,
+                    kernelInfo.kernelName);
+        assertValue(testName, caseName+" argInfosNum", expKernelInfo.argInfos.size(),
+                    kernelInfo.argInfos.size());
+        for (size_t k = 0; k < expKernelInfo.argInfos.size(); k++)
+            assertValue(testName, caseName+" argName", expKernelInfo.argInfos[k].argName,
+                    kernelInfo.argInfos[k].argName);
+    }
+    // all kernel infos must be parsed
+    const KernelInfo* kernelInfos = base->getKernelInfos();
+    for (size_t i = 0; i < expBase->getKernelInfosNum(); i++)
+        assertValue(testName, "kernelInfos argInfosNum",
+                    expBase->getKernelInfo(i).argInfos.size(),
+                    kernelInfos[i].argInfos.size());
+}
+
 struct BinLoadingFailCase
 {
     const char* filename;
@@ -657,6 +719,10 @@ int main(int argc, const char** argv)
             "/tests/amdbin/amdbins/structkernel2_cpu64.clo", "myKernel1",
             sizeof(expectedCPUKernelArgs2)/sizeof(AmdKernelArg), expectedCPUKernelArgs2);
     retVal |= callTest(testAmdGPUMetadataGen);
+    retVal |= callTest(testLazyLoading, CLRX_SOURCE_DIR
+            "/tests/amdbin/amdbins/prginfo4_14_12.clo.1_0.reconf");
+    retVal |= callTest(testLazyLoading, CLRX_SOURCE_DIR
+            "/tests/amdbin/amdbins/prginfo8_14_12_64.clo.1_0.reconf");
     
     for (cxuint i = 0; i < sizeof(binLoadingTestCases)/sizeof(BinLoadingFailCase); i++)
     {
@@ -21,8 +21,10 @@
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <cstring>
 #include <CLRX/utils/Containers.h>
 #include <CLRX/amdbin/ROCmBinaries.h>
+#include "../TestUtils.h"
 
 using namespace CLRX;
 
@@ -148,6 +150,301 @@ static void testOrigBinary(cxuint testCase, const char* origBinaryFilename)
         }
 }
 
+static void compareBinaries(cxuint testCase, const char* origBinaryFilename,
+            const char* caseName, const Array<cxbyte>& expected,
+            const Array<cxbyte>& result)
+{
+    if (expected.size() != result.size())
+    {
+        std::ostringstream oss;
+        oss << "Failed for #" << testCase << " file=" << origBinaryFilename <<
+                " " << caseName << ": expectedSize=" << expected.size() <<
+                ", resultSize=" << result.size();
+        throw Exception(oss.str());
+    }
+    for (size_t i = 0; i < expected.size(); i++)
+        if (expected[i] != result[i])
+        {
+            std::ostringstream oss;
+            oss << "Failed for #" << testCase << " file=" << origBinaryFilename <<
+                    " " << caseName << ": byte=" << i;
+            throw Exception(oss.str());
+        }
+}
+
+// patch kernels in generated binary and compare with fully regenerated binary
+static void testPatchKernel(cxuint testCase, const char* origBinaryFilename)
+{
+    std::string origBinFilenameStr(origBinaryFilename);
+    filesystemPath(origBinFilenameStr); // convert to system path (native separators)
+    
+    Array<cxbyte> inputData = loadDataFromFile(origBinFilenameStr.c_str());
+    ROCmBinary rocmBin(inputData.size(), inputData.data(), 0);
+    ROCmInput rocmInput = genROCmInput(rocmBin);
+    // function kernels must be patched too
+    if (!rocmInput.llvm10BinFormat)
+        for (ROCmSymbolInput& symbol: rocmInput.symbols)
+            if (symbol.type == ROCmRegionType::KERNEL)
+            {
+                symbol.type = ROCmRegionType::FKERNEL;
+                break;
+            }
+    ROCmBinGenerator binGen(&rocmInput);
+    Array<cxbyte> output;
+    binGen.generate(output);
+    
+    // change code of all kernels (skip kernel descriptor)
+    Array<cxbyte> newCode(rocmInput.code, rocmInput.code + rocmInput.codeSize);
+    Array<cxbyte> newGlobalData(rocmInput.globalData,
+                rocmInput.globalData + rocmInput.globalDataSize);
+    for (const ROCmSymbolInput& symbol: rocmInput.symbols)
+        if (symbol.type == ROCmRegionType::KERNEL ||
+            symbol.type == ROCmRegionType::FKERNEL)
+        {
+            if (symbol.offset + 260 <= newCode.size())
+                newCode[symbol.offset + 259] ^= 0x5a;
+            if (rocmInput.llvm10BinFormat && !newGlobalData.empty())
+                newGlobalData[0] ^= 0x11;
+        }
+    rocmInput.code = newCode.data();
+    rocmInput.globalData = newGlobalData.data();
+    for (const ROCmSymbolInput& symbol: rocmInput.symbols)
+        if (symbol.type == ROCmRegionType::KERNEL ||
+            symbol.type == ROCmRegionType::FKERNEL)
+            assertTrue("testPatchKernel", "patched in place",
+                    binGen.patchKernel(output, symbol.symbolName.c_str()));
+    
+    Array<cxbyte> expected;
+    {
+        ROCmBinGenerator binGen2(&rocmInput);
+        binGen2.generate(expected);
+    }
+    compareBinaries(testCase, origBinaryFilename, "patched", expected, output);
+    
+    // change code size (binary must be regenerated)
+    newCode.resize(newCode.size() + 256);
+    std::fill(newCode.end()-256, newCode.end(), cxbyte(0));
+    rocmInput.code = newCode.data();
+    rocmInput.codeSize = newCode.size();
+    for (const ROCmSymbolInput& symbol: rocmInput.symbols)
+        if (symbol.type == ROCmRegionType::KERNEL ||
+            symbol.type == ROCmRegionType::FKERNEL)
+        {
+            assertTrue("testPatchKernel", "regenerated",
+                    !binGen.patchKernel(output, symbol.symbolName.c_str()));
+            break;
+        }
+    {
+        ROCmBinGenerator binGen2(&rocmInput);
+        binGen2.generate(expected);
+    }
+    compareBinaries(testCase, origBinaryFilename, "regenerated", expected, output);
+}
+
+// patching kernel with changed register counts must regenerate metadata
+static void testPatchKernelMetadata(cxuint testCase, const char* origBinaryFilename)
+{
+    std::string origBinFilenameStr(origBinaryFilename);
+    filesystemPath(origBinFilenameStr); // convert to system path (native separators)
+    
+    Array<cxbyte> inputData = loadDataFromFile(origBinFilenameStr.c_str());
+    ROCmBinary rocmBin(inputData.size(), inputData.data(), ROCMBIN_CREATE_METADATAINFO);
+    if (!rocmBin.hasMetadataInfo() || rocmBin.isMetadataV3Format())
+        return; // only binaries with YAML metadata
+    ROCmInput rocmInput = genROCmInput(rocmBin);
+    rocmInput.useMetadataInfo = true;
+    rocmInput.metadataInfo = rocmBin.getMetadataInfo();
+    ROCmBinGenerator binGen(&rocmInput);
+    Array<cxbyte> output;
+    binGen.generate(output);
+    const ROCmSymbolInput* kernel = nullptr;
+    for (const ROCmSymbolInput& symbol: rocmInput.symbols)
+        if (symbol.type == ROCmRegionType::KERNEL)
+        {
+            kernel = &symbol;
+            break;
+        }
+    if (kernel == nullptr)
+        throw Exception("No kernel in binary");
+    assertTrue("testPatchKernelMetadata", "unchanged patched in place",
+                binGen.patchKernel(output, kernel->symbolName.c_str()));
+    
+    // metadata of other kernels are not compared while patching
+    for (ROCmKernelMetadata& mdKernel: rocmInput.metadataInfo.kernels)
+        if (mdKernel.name != kernel->symbolName)
+            mdKernel.vgprsNum++;
+    assertTrue("testPatchKernelMetadata", "otherKernels patched in place",
+                binGen.patchKernel(output, kernel->symbolName.c_str()));
+    for (ROCmKernelMetadata& mdKernel: rocmInput.metadataInfo.kernels)
+        if (mdKernel.name != kernel->symbolName)
+            mdKernel.vgprsNum--;
+    
+    // change only VGPRs number in metadata
+    for (ROCmKernelMetadata& mdKernel: rocmInput.metadataInfo.kernels)
+        if (mdKernel.name == kernel->symbolName)
+            mdKernel.vgprsNum++;
+    assertTrue("testPatchKernelMetadata", "regenerated",
+                !binGen.patchKernel(output, kernel->symbolName.c_str()));
+    Array<cxbyte> expected;
+    {
+        ROCmBinGenerator binGen2(&rocmInput);
+        binGen2.generate(expected);
+    }
+    compareBinaries(testCase, origBinaryFilename, "metadataVGPRs", expected, output);
+    
+    // VGPRs number from kernel config in code
+    for (ROCmKernelMetadata& mdKernel: rocmInput.metadataInfo.kernels)
+        mdKernel.vgprsNum = BINGEN_NOTSUPPLIED;
+    binGen.generate(output);
+    Array<cxbyte> newCode(rocmInput.code, rocmInput.code + rocmInput.codeSize);
+    ROCmKernelConfig* config = reinterpret_cast<ROCmKernelConfig*>(
+                newCode.data() + kernel->offset);
+    SULEV(config->workitemVgprCount, ULEV(config->workitemVgprCount)+4);
+    rocmInput.code = newCode.data();
+    assertTrue("testPatchKernelMetadata", "configVGPRs regenerated",
+                !binGen.patchKernel(output, kernel->symbolName.c_str()));
+    {
+        ROCmBinGenerator binGen2(&rocmInput);
+        binGen2.generate(expected);
+    }
+    compareBinaries(testCase, origBinaryFilename, "configVGPRs", expected, output);
+}
+
+static void testMergeStrings(cxuint testCase, const char* origBinaryFilename)
+{
+    std::string origBinFilenameStr(origBinaryFilename);
+    filesystemPath(origBinFilenameStr); // convert to system path (native separators)
+    
+    Array<cxbyte> inputData = loadDataFromFile(origBinFilenameStr.c_str());
+    ROCmBinary rocmBin(inputData.size(), inputData.data(), 0);
+    ROCmInput rocmInput = genROCmInput(rocmBin);
+    Array<cxbyte> output, mergedOutput;
+    {
+        ROCmBinGenerator binGen(&rocmInput);
+        binGen.generate(output);
+    }
+    {
+        ROCmBinGenerator binGen(&rocmInput);
+        binGen.setMergeStrings(true);
+        binGen.generate(mergedOutput);
+    }
+    
+    std::ostringstream oss;
+    oss << "testMergeStrings#" << testCase;
+    const std::string testName = oss.str();
+    assertTrue(testName, "mergedSize", mergedOutput.size() <= output.size());
+    
+    ROCmBinary bin(output.size(), output.data(), ROCMBIN_CREATE_REGIONMAP);
+    ROCmBinary mergedBin(mergedOutput.size(), mergedOutput.data(),
+                ROCMBIN_CREATE_REGIONMAP);
+    assertValue(testName, "sectionsNum", bin.getSectionHeadersNum(),
+                mergedBin.getSectionHeadersNum());
+    for (cxuint i = 0; i < bin.getSectionHeadersNum(); i++)
+        assertString(testName, "sectionName", bin.getSectionName(i),
+                mergedBin.getSectionName(i));
+    assertValue(testName, "symbolsNum", bin.getSymbolsNum(), mergedBin.getSymbolsNum());
+    for (size_t i = 0; i < bin.getSymbolsNum(); i++)
+        assertString(testName, "symbolName", bin.getSymbolName(i),
+                mergedBin.getSymbolName(i));
+    assertValue(testName, "dynSymbolsNum", bin.getDynSymbolsNum(),
+                mergedBin.getDynSymbolsNum());
+    for (size_t i = 0; i < bin.getDynSymbolsNum(); i++)
+        assertString(testName, "dynSymbolName", bin.getDynSymbolName(i),
+                mergedBin.getDynSymbolName(i));
+    assertValue(testName, "regionsNum", bin.getRegionsNum(), mergedBin.getRegionsNum());
+    for (size_t i = 0; i < bin.getRegionsNum(); i++)
+    {
+        const ROCmRegion& region = bin.getRegion(i);
+        const ROCmRegion& mergedRegion = mergedBin.getRegion(region.regionName.c_str());
+        assertValue(testName, "regionSize", region.size, mergedRegion.size);
+        assertValue(testName, "regionOffset", region.offset, mergedRegion.offset);
+        assertTrue(testName, "regionType", region.type == mergedRegion.type);
+    }
+    assertValue(testName, "codeSize", bin.getCodeSize(), mergedBin.getCodeSize());
+    assertTrue(testName, "code", ::memcmp(bin.getCode(), mergedBin.getCode(),
+                bin.getCodeSize()) == 0);
+}
+
+static void testGnuHash(cxuint testCase, const char* origBinaryFilename)
+{
+    std::string origBinFilenameStr(origBinaryFilename);
+    filesystemPath(origBinFilenameStr); // convert to system path (native separators)
+    
+    Array<cxbyte> inputData = loadDataFromFile(origBinFilenameStr.c_str());
+    ROCmBinary rocmBin(inputData.size(), inputData.data(), 0);
+    ROCmInput rocmInput = genROCmInput(rocmBin);
+    // add GOT entries (indices of dynamic symbols without null symbol)
+    rocmInput.gotSymbols = { 0, size_t(rocmBin.getDynSymbolsNum()-2) };
+    Array<cxbyte> output, hashOutput;
+    {
+        ROCmBinGenerator binGen(&rocmInput);
+        binGen.generate(output);
+    }
+    {
+        ROCmBinGenerator binGen(&rocmInput);
+        binGen.setGnuHash(true);
+        binGen.generate(hashOutput);
+    }
+    
+    std::ostringstream oss;
+    oss << "testGnuHash#" << testCase;
+    const std::string testName = oss.str();
+    
+    // lookup through SysV hash table
+    ROCmBinary bin(output.size(), output.data(), 0);
+    // lookup through GNU hash table
+    ROCmBinary hashBin(hashOutput.size(), hashOutput.data(), 0);
+    assertTrue(testName, "hasHashTable", bin.hasDynSymbolHashTable());
+    assertTrue(testName, "hasGnuHashTable", hashBin.hasDynSymbolHashTable());
+    hashBin.getSectionIndex(".gnu.hash");
+    assertValue(testName, "dynSymbolsNum", bin.getDynSymbolsNum(),
+                hashBin.getDynSymbolsNum());
+    for (size_t i = 1; i < bin.getDynSymbolsNum(); i++)
+    {
+        const char* symName = bin.getDynSymbolName(i);
+        assertValue(testName, "sysvHashIndex", uint64_t(i), bin.getDynSymbolIndex(symName));
+        const uint64_t index = hashBin.getDynSymbolIndex(symName);
+        assertString(testName, "gnuHashName", symName, hashBin.getDynSymbolName(index));
+        assertValue(testName, "gnuHashValue", ULEV(bin.getDynSymbol(i).st_value),
+                    ULEV(hashBin.getDynSymbol(index).st_value));
+    }
+    uint64_t index;
+    assertTrue(testName, "sysvHashNotFound",
+               !bin.findDynSymbolIndex("__xxxx_not_found", index));
+    assertTrue(testName, "gnuHashNotFound",
+               !hashBin.findDynSymbolIndex("__xxxx_not_found", index));
+    
+    // buckets number of SysV hash table as in GNU linker
+    {
+        static const uint32_t linkerBucketsTbl[] = { 1, 3, 17, 37, 67, 97, 131, 197 };
+        const uint32_t hashedNum = hashBin.getDynSymbolsNum()-1;
+        uint32_t expectedBucketsNum = 1;
+        for (uint32_t bucketsNum: linkerBucketsTbl)
+            if (hashedNum >= bucketsNum)
+                expectedBucketsNum = bucketsNum;
+        const uint32_t* hashTable = reinterpret_cast<const uint32_t*>(
+                    hashBin.getSectionContent(".hash"));
+        assertValue(testName, "sysvBucketsNum", expectedBucketsNum, ULEV(hashTable[0]));
+    }
+    
+    // regions by name without region map
+    assertValue(testName, "regionsNum", bin.getRegionsNum(), hashBin.getRegionsNum());
+    for (size_t i = 0; i < bin.getRegionsNum(); i++)
+    {
+        const ROCmRegion& region = bin.getRegion(i);
+        const ROCmRegion& hashRegion = hashBin.getRegion(region.regionName.c_str());
+        assertValue(testName, "regionOffset", region.offset, hashRegion.offset);
+        assertValue(testName, "regionSize", region.size, hashRegion.size);
+    }
+    // GOT symbols must point to same symbols
+    assertValue(testName, "gotSymbolsNum", size_t(2), bin.getGotSymbolsNum());
+    assertValue(testName, "gotSymbolsNum", bin.getGotSymbolsNum(),
+                hashBin.getGotSymbolsNum());
+    for (size_t i = 0; i < bin.getGotSymbolsNum(); i++)
+        assertString(testName, "gotSymbol", bin.getDynSymbolName(bin.getGotSymbol(i)),
+                hashBin.getDynSymbolName(hashBin.getGotSymbol(i)));
+}
+
 int main(int argc, const char** argv)
 {
     int retVal = 0;
@@ -159,5 +456,37 @@ int main(int argc, const char** argv)
             std::cerr << ex.what() << std::endl;
             retVal = 1;
         }
+    for (cxuint i = 0; i < sizeof(origBinaryFiles)/sizeof(const char*); i++)
+        try
+        { testPatchKernel(i, origBinaryFiles[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    for (cxuint i = 0; i < sizeof(origBinaryFiles)/sizeof(const char*); i++)
+        try
+        { testPatchKernelMetadata(i, origBinaryFiles[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    for (cxuint i = 0; i < sizeof(origBinaryFiles)/sizeof(const char*); i++)
+        try
+        { testMergeStrings(i, origBinaryFiles[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
+    for (cxuint i = 0; i < sizeof(origBinaryFiles)/sizeof(const char*); i++)
+        try
+        { testGnuHash(i, origBinaryFiles[i]); }
+        catch(const std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            retVal = 1;
+        }
     return retVal;
 }
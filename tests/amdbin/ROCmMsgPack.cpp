@@ -867,6 +867,36 @@ static void testMsgPackBytes()
     }
 }
 
+static void testMsgPackRefs()
+{
+    // map: "name" -> "abc", "data" -> bin(3), array: [ "xy", bin(2) ]
+    const cxbyte tc0[26] = { 0x83,
+        0xa4, 'n', 'a', 'm', 'e', 0xa3, 'a', 'b', 'c',
+        0xa4, 'd', 'a', 't', 'a', 0xc4, 0x03, 0x11, 0x22, 0x33,
+        0xa2, 'a', 'r', 0x92, 0xa2, 'x' };
+    const cxbyte* dataPtr = tc0;
+    {
+        MsgPackMapParser mapParser(dataPtr, dataPtr + sizeof(tc0));
+        MsgPackDataRef ref = mapParser.parseKeyStringRef();
+        assertValue("MsgPackRefs", "tc0.key0.data", ref.data, tc0+2);
+        assertValue("MsgPackRefs", "tc0.key0.size", ref.size, size_t(4));
+        ref = mapParser.parseValueStringRef();
+        assertValue("MsgPackRefs", "tc0.value0.data", ref.data, tc0+7);
+        assertValue("MsgPackRefs", "tc0.value0.size", ref.size, size_t(3));
+        ref = mapParser.parseKeyStringRef();
+        assertValue("MsgPackRefs", "tc0.key1.size", ref.size, size_t(4));
+        ref = mapParser.parseValueDataRef();
+        assertValue("MsgPackRefs", "tc0.value1.data", ref.data, tc0+17);
+        assertValue("MsgPackRefs", "tc0.value1.size", ref.size, size_t(3));
+        ref = mapParser.parseKeyStringRef();
+        assertValue("MsgPackRefs", "tc0.key2.data", ref.data, tc0+21);
+        MsgPackArrayParser arrParser = mapParser.parseValueArray();
+        // unterminated string
+        assertCLRXException("MsgPackRefs", "tc0.Ex", "MsgPack: Can't parse string",
+                    [&arrParser]() { arrParser.parseStringRef(); });
+    }
+}
+
 static void testMsgPackSkip()
 {
     const cxbyte tc0[3] = { 0x81, 0xc0, 0xc0 };
@@ -2411,6 +2441,7 @@ int main(int argc, const char** argv)
 {
     int retVal = 0;
     retVal |= callTest(testMsgPackBytes);
+    retVal |= callTest(testMsgPackRefs);
     retVal |= callTest(testMsgPackSkip);
     for (cxuint i = 0; i < sizeof(rocmMsgPackMDTestCases)/
                             sizeof(ROCmMsgPackMDTestCase); i++)
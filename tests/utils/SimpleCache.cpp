@@ -0,0 +1,356 @@
+/*
+ *  CLRadeonExtender - Unofficial OpenCL Radeon Extensions Library
+ *  Copyright (C) 2014-2018 Mateusz Szpakowski
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <CLRX/Config.h>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <CLRX/utils/Containers.h>
+#include "../TestUtils.h"
+
+using namespace CLRX;
+
+struct TestValue
+{
+    size_t value;
+    size_t weight_;
+
+    size_t weight() const
+    { return weight_; }
+};
+
+static void testSimpleCacheBasic()
+{
+    const std::string testName = "SimpleCacheBasic";
+    SimpleCache<size_t, TestValue> cache(10);
+    assertTrue(testName, "empty.hasKey", !cache.hasKey(1));
+    assertTrue(testName, "empty.use", cache.use(1) == nullptr);
+    cache.put(1, { 11, 2 });
+    cache.put(2, { 12, 3 });
+    assertTrue(testName, "hasKey1", cache.hasKey(1));
+    assertTrue(testName, "hasKey2", cache.hasKey(2));
+    assertValue(testName, "size", size_t(2), cache.size());
+    assertValue(testName, "weight", size_t(5), cache.weight());
+    TestValue* v = cache.use(2);
+    assertTrue(testName, "use2", v != nullptr);
+    assertValue(testName, "use2.value", size_t(12), v->value);
+    // replace value
+    cache.put(2, { 22, 1 });
+    assertValue(testName, "replace.size", size_t(2), cache.size());
+    assertValue(testName, "replace.weight", size_t(3), cache.weight());
+    assertValue(testName, "replace.value", size_t(22), cache.use(2)->value);
+}
+
+static void testSimpleCacheEviction()
+{
+    const std::string testName = "SimpleCacheEviction";
+    SimpleCache<size_t, TestValue> cache(3);
+    cache.put(1, { 1, 1 });
+    cache.put(2, { 2, 1 });
+    cache.put(3, { 3, 1 });
+    cache.use(1);
+    cache.use(1);
+    cache.use(2);
+    // evict min usage element
+    cache.put(4, { 4, 1 });
+    assertTrue(testName, "evict3.hasKey3", !cache.hasKey(3));
+    assertTrue(testName, "evict3.hasKey1", cache.hasKey(1));
+    assertTrue(testName, "evict3.hasKey2", cache.hasKey(2));
+    assertTrue(testName, "evict3.hasKey4", cache.hasKey(4));
+    // evict min usage elements for heavier element
+    cache.put(5, { 5, 2 });
+    assertTrue(testName, "evict42.hasKey4", !cache.hasKey(4));
+    assertTrue(testName, "evict42.hasKey2", !cache.hasKey(2));
+    assertTrue(testName, "evict42.hasKey1", cache.hasKey(1));
+    assertTrue(testName, "evict42.hasKey5", cache.hasKey(5));
+    assertValue(testName, "evict42.weight", size_t(3), cache.weight());
+
+    // least recently used is evicted between elements with same usage
+    SimpleCache<size_t, TestValue> cache2(3);
+    cache2.put(1, { 1, 1 });
+    cache2.put(2, { 2, 1 });
+    cache2.put(3, { 3, 1 });
+    cache2.use(2);
+    cache2.use(1);
+    cache2.use(3);
+    cache2.use(2);
+    cache2.put(4, { 4, 1 });
+    assertTrue(testName, "lru.hasKey1", !cache2.hasKey(1));
+    assertTrue(testName, "lru.hasKey3", cache2.hasKey(3));
+    cache2.put(5, { 5, 1 });
+    assertTrue(testName, "lru2.hasKey4", !cache2.hasKey(4));
+    assertTrue(testName, "lru2.hasKey3", cache2.hasKey(3));
+    cache2.put(6, { 6, 1 });
+    assertTrue(testName, "lru3.hasKey5", !cache2.hasKey(5));
+    cache2.use(6);
+    cache2.put(7, { 7, 1 });
+    assertTrue(testName, "lru4.hasKey3", !cache2.hasKey(3));
+    assertTrue(testName, "lru4.hasKey2", cache2.hasKey(2));
+    assertTrue(testName, "lru4.hasKey6", cache2.hasKey(6));
+
+    // element heavier than max weight
+    SimpleCache<size_t, TestValue> cache3(2);
+    cache3.put(1, { 1, 1 });
+    cache3.put(2, { 2, 5 });
+    assertTrue(testName, "heavy.hasKey1", cache3.hasKey(1));
+    assertTrue(testName, "heavy.hasKey2", cache3.hasKey(2));
+    assertValue(testName, "heavy.weight", size_t(6), cache3.weight());
+}
+
+// reference cache: evicts element with minimal (usage, last access time)
+class RefCache
+{
+private:
+    struct Entry
+    {
+        size_t usage;
+        size_t lastAccess;
+        TestValue value;
+    };
+    size_t totalWeight;
+    size_t maxWeight;
+    size_t time;
+    std::unordered_map<size_t, Entry> entryMap;
+public:
+    explicit RefCache(size_t _maxWeight) : totalWeight(0), maxWeight(_maxWeight), time(0)
+    { }
+
+    TestValue* use(size_t key)
+    {
+        auto it = entryMap.find(key);
+        if (it == entryMap.end())
+            return nullptr;
+        it->second.usage++;
+        it->second.lastAccess = ++time;
+        return &it->second.value;
+    }
+
+    void put(size_t key, const TestValue& value)
+    {
+        auto it = entryMap.find(key);
+        if (it != entryMap.end())
+        {
+            totalWeight -= it->second.value.weight();
+            entryMap.erase(it);
+        }
+        if (value.weight() > maxWeight)
+            maxWeight = value.weight()<<1;
+        while (totalWeight + value.weight() > maxWeight)
+        {
+            auto minIt = entryMap.begin();
+            for (auto eit = entryMap.begin(); eit != entryMap.end(); ++eit)
+                if (eit->second.usage < minIt->second.usage ||
+                    (eit->second.usage == minIt->second.usage &&
+                     eit->second.lastAccess < minIt->second.lastAccess))
+                    minIt = eit;
+            totalWeight -= minIt->second.value.weight();
+            entryMap.erase(minIt);
+        }
+        entryMap.insert({ key, Entry{ 0, ++time, value } });
+        totalWeight += value.weight();
+    }
+
+    size_t size() const
+    { return entryMap.size(); }
+
+    size_t weight() const
+    { return totalWeight; }
+};
+
+static void testSimpleCacheRandom()
+{
+    const std::string testName = "SimpleCacheRandom";
+    std::mt19937 rnd(2134);
+    SimpleCache<size_t, TestValue> cache(64);
+    RefCache refCache(64);
+    for (size_t i = 0; i < 20000; i++)
+    {
+        std::ostringstream oss;
+        oss << "op#" << i;
+        const size_t key = rnd() % 100;
+        if ((rnd() & 3) != 0)
+        {
+            TestValue* v = cache.use(key);
+            TestValue* refV = refCache.use(key);
+            assertTrue(testName, oss.str() + ".use", (v == nullptr) == (refV == nullptr));
+            if (v != nullptr)
+                assertValue(testName, oss.str() + ".value", refV->value, v->value);
+        }
+        else
+        {
+            const TestValue value = { i, 1 + (rnd() % 8) };
+            cache.put(key, value);
+            refCache.put(key, value);
+        }
+        assertValue(testName, oss.str() + ".size", refCache.size(), cache.size());
+        assertValue(testName, oss.str() + ".weight", refCache.weight(), cache.weight());
+    }
+}
+
+// previous SimpleCache implementation (sorted vector of entries), for benchmark
+template<typename K, typename V>
+class SortedVectorCache
+{
+private:
+    struct Entry
+    {
+        size_t sortedPos;
+        size_t usage;
+        V value;
+    };
+
+    size_t totalWeight;
+    size_t maxWeight;
+
+    typedef typename std::unordered_map<K, Entry>::iterator EntryMapIt;
+    std::vector<EntryMapIt> sortedEntries;
+    std::unordered_map<K, Entry> entryMap;
+
+    void updateInSortedEntries(EntryMapIt it)
+    {
+        const size_t curPos = it->second.sortedPos;
+        if (curPos == 0)
+            return;
+        if (sortedEntries[curPos-1]->second.usage < it->second.usage &&
+            (curPos==1 || sortedEntries[curPos-2]->second.usage >= it->second.usage))
+        {
+            std::swap(sortedEntries[curPos-1]->second.sortedPos, it->second.sortedPos);
+            std::swap(sortedEntries[curPos-1], sortedEntries[curPos]);
+            return;
+        }
+        auto fit = std::upper_bound(sortedEntries.begin(),
+            sortedEntries.begin()+it->second.sortedPos, it,
+            [](EntryMapIt it1, EntryMapIt it2)
+            { return it1->second.usage > it2->second.usage; });
+        if (fit != sortedEntries.begin()+it->second.sortedPos)
+        {
+            const size_t curPos = it->second.sortedPos;
+            std::swap((*fit)->second.sortedPos, it->second.sortedPos);
+            std::swap(*fit, sortedEntries[curPos]);
+        }
+    }
+
+    void removeFromSortedEntries(size_t pos)
+    {
+        for (size_t i = pos+1; i < sortedEntries.size(); i++)
+            (sortedEntries[i]->second.sortedPos)--;
+        sortedEntries.erase(sortedEntries.begin() + pos);
+    }
+public:
+    explicit SortedVectorCache(size_t _maxWeight) : totalWeight(0), maxWeight(_maxWeight)
+    { }
+
+    V* use(const K& key)
+    {
+        auto it = entryMap.find(key);
+        if (it != entryMap.end())
+        {
+            it->second.usage++;
+            updateInSortedEntries(it);
+            return &(it->second.value);
+        }
+        return nullptr;
+    }
+
+    void put(const K& key, const V& value)
+    {
+        auto res = entryMap.insert({ key, Entry{ 0, 0, value } });
+        if (!res.second)
+        {
+            removeFromSortedEntries(res.first->second.sortedPos);
+            totalWeight -= res.first->second.value.weight();
+            res.first->second = Entry{ 0, 0, value };
+        }
+        const size_t elemWeight = value.weight();
+        if (elemWeight > maxWeight)
+            maxWeight = elemWeight<<1;
+        while (totalWeight+elemWeight > maxWeight)
+        {
+            auto minUsageIt = sortedEntries.back();
+            sortedEntries.pop_back();
+            totalWeight -= minUsageIt->second.value.weight();
+            entryMap.erase(minUsageIt);
+        }
+        res.first->second.sortedPos = sortedEntries.size();
+        sortedEntries.push_back(res.first);
+        totalWeight += elemWeight;
+    }
+};
+
+/* workload similar to createSSAData and AsmWaitScheduler: many keys (code blocks),
+ * puts of new values and uses of recently put values */
+template<typename Cache>
+static double benchCache(size_t keysNum, size_t maxWeight, size_t opsNum, size_t& hits)
+{
+    std::mt19937 rnd(1451);
+    Cache cache(maxWeight);
+    hits = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < opsNum; i++)
+    {
+        const size_t key = rnd() % keysNum;
+        if ((rnd() & 3) != 0)
+        {
+            if (cache.use(key) != nullptr)
+                hits++;
+        }
+        else
+            cache.put(key, TestValue{ i, 1 + (rnd() & 15) });
+    }
+    return std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchSimpleCache()
+{
+    const size_t benchCases[4][3] = { { 1000, 2000, 1000000 }, { 10000, 20000, 1000000 },
+            { 100000, 200000, 1000000 }, { 100000, 800000, 200000 } };
+    for (const auto& bc: benchCases)
+    {
+        size_t hits, oldHits;
+        const double time = benchCache<SimpleCache<size_t, TestValue> >(
+                    bc[0], bc[1], bc[2], hits);
+        const double oldTime = benchCache<SortedVectorCache<size_t, TestValue> >(
+                    bc[0], bc[1], bc[2], oldHits);
+        std::cout << "keys=" << bc[0] << " maxWeight=" << bc[1] << " ops=" << bc[2] <<
+                ": LFU buckets: " << time << " ms (hits " << hits <<
+                "), sorted vector: " << oldTime << " ms (hits " << oldHits << ")" <<
+                std::endl;
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    if (argc > 1 && ::strcmp(argv[1], "bench") == 0)
+    {
+        benchSimpleCache();
+        return 0;
+    }
+    int retVal = 0;
+    retVal |= callTest(testSimpleCacheBasic);
+    retVal |= callTest(testSimpleCacheEviction);
+    retVal |= callTest(testSimpleCacheRandom);
+    return retVal;
+}
@@ -1386,6 +1386,33 @@ static const CStrtofXTestCase cstrtofXTestCases[] =
             0x433fffffffffffffULL },
         { FT_D, "5.0216813883093451685872615018317116712748411717802652598273e58",
             0x4c20000000000001ULL },
+        
+        /*
+         * fast path roundings (up to 19 significant digits)
+         */
+        { FT_H, "2049", 0x6800 },
+        { FT_H, "2051", 0x6802 },
+        { FT_H, "2049.0000000000000000000001", 0x6801 },
+        { FT_H, "0.00048828125", 0x1000 },
+        { FT_H, "65504", 0x7bff },
+        { FT_F, "16777217", 0x4b800000 },
+        { FT_F, "16777219", 0x4b800002 },
+        { FT_F, "16777217.000000000000000000000", 0x4b800000 },
+        { FT_F, "0.1", 0x3dcccccd },
+        { FT_F, "3.14159265", 0x40490fdb },
+        { FT_F, "1.00000005960464477539062500", 0x3f800000 },
+        { FT_F, "1.000000059604644775390625", 0x3f800000 },
+        { FT_F, "340282346638528859811704183484516925440", 0x7f7fffff },
+        { FT_D, "9007199254740993", 0x4340000000000000ULL },
+        { FT_D, "9007199254740995", 0x4340000000000002ULL },
+        { FT_D, "9007199254740993000", 0x43df400000000001ULL },
+        { FT_D, "9007199254740993e-3", 0x42a0624dd2f1a9fcULL },
+        { FT_D, "1.2345678901234567890000000000000000", 0x3ff3c0ca428c59fbULL },
+        { FT_D, "1e-64", 0x32a50ffd44f4a73dULL },
+        { FT_D, "1e64", 0x4d384f03e93ff9f5ULL },
+        { FT_D, "7.2057594037927933e16", 0x4370000000000000ULL },
+        { FT_D, "0.1e1", 0x3ff0000000000000ULL },
+        { FT_D, "123.456e-2", 0x3ff3c0c1fc8f3238ULL },
 };
 
 int main(int argc, const char** argv)
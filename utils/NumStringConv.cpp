@@ -806,6 +806,82 @@ static void dumpIntermediateResults(cxuint bigSize, const uint64_t* bigValue,
 }
 #endif
 
+/* fast path for decimal values (Eisel-Lemire algorithm)
+ * value - decimal mantisa (all significant digits, not zero),
+ * powerof10 - decimal exponent of last digit of value.
+ * product of normalized value and power of 5 from pow5_128Table is computed
+ * in 192-bit precision. returns false if result is too close to half of value
+ * (can not be determined without bigger precision) */
+static bool cstrtofXDecFastPath(uint64_t value, int64_t powerof10, cxuint expBits,
+            cxuint mantisaBits, uint64_t& out)
+{
+    if (powerof10 < -64 || powerof10 > 64 || mantisaBits > 52)
+        return false;
+    const Pow5Num128TableEntry& pow5 = pow5_128Table[powerof10+64];
+    // powers between 0 and 55 are exact in table (fits in 128 bits)
+    const bool exactPow5 = (powerof10 >= 0 && powerof10 <= 55);
+    // factor with highest bit (one): (1<<127) | (pow5.value>>1)
+    const uint64_t factor[2] = { (pow5.value[0]>>1) | (pow5.value[1]<<63),
+                (pow5.value[1]>>1) | (1ULL<<63) };
+    // normalize value
+    const cxuint valueShift = CLZ64(value);
+    const uint64_t normValue = value<<valueShift;
+    uint64_t rescaled[3];
+    uint64_t t[2];
+    mul64Full(normValue, factor[0], rescaled);
+    mul64Full(normValue, factor[1], t);
+    rescaled[1] += t[0];
+    rescaled[2] = t[1] + (rescaled[1] < t[0]);
+    // rescaled value have 191 or 192 bits
+    const cxuint rescaledBits = 192 - CLZ64(rescaled[2]);
+
+    const int minExpNonDenorm = -((1U<<(expBits-1))-2);
+    const cxint binaryExp = cxint(rescaledBits)-128 + pow5.exponent -
+                cxint(valueShift) + powerof10;
+    if (binaryExp < minExpNonDenorm)
+        // do not handle denormalized values (only in slow path)
+        return false;
+    if (binaryExp > (1<<(expBits-1))-1) // out of max exponent
+        throw ParseException("Absolute value of number is too big");
+
+    // position of rounding bit in last 64-bit word
+    const cxuint roundShift = rescaledBits-128-mantisaBits-2;
+    const uint64_t roundBit = (1ULL<<roundShift);
+    const uint64_t lowerMask = roundBit-1ULL;
+    const uint64_t lower = rescaled[2]&lowerMask;
+    const bool isSecondHalf = (rescaled[2]&roundBit) != 0;
+    bool addRoundings = isSecondHalf;
+    uint64_t fpMantisa = (rescaled[2]>>(roundShift+1))&((1ULL<<mantisaBits)-1ULL);
+    if (!exactPow5)
+    {
+        /* error of rescaled value is smaller than 2**65. if value is too close to
+         * half of value, then go to slow path */
+        if (isSecondHalf && lower == 0 && rescaled[1] <= 2)
+            return false;
+        if (!isSecondHalf && lower == lowerMask && rescaled[1] >= UINT64_MAX-2)
+            return false;
+    }
+    else if (isSecondHalf && lower == 0 && rescaled[1] == 0 && rescaled[0] == 0)
+        // is exact half, round to even
+        addRoundings = (fpMantisa&1) != 0;
+
+    cxuint fpExponent = binaryExp+(1U<<(expBits-1))-1;
+    if (addRoundings)
+    {
+        fpMantisa++;
+        // check promotion to next exponent
+        if (fpMantisa >= (1ULL<<mantisaBits))
+        {
+            fpExponent++;
+            fpMantisa = 0; // zeroing value
+        }
+    }
+    if (fpExponent >= ((1U<<expBits)-1))
+        throw ParseException("Absolute value of number is too big");
+    out |= fpMantisa | (uint64_t(fpExponent)<<mantisaBits);
+    return true;
+}
+
 uint64_t CLRX::cstrtofXCStyle(const char* str, const char* inend,
              const char*& outend, cxuint expBits, cxuint mantisaBits)
 {
@@ -1020,6 +1096,12 @@ uint64_t CLRX::cstrtofXCStyle(const char* str, const char* inend,
         cxint decimalExp = 0;
         const char* expstr = p;
         bool comma = false;
+        /* collect first 19 significant digits for fast path.
+         * value = fastValue * 10**(fastExp + decimalExp) */
+        uint64_t fastValue = 0;
+        cxuint fastDigits = 0;
+        int64_t fastExp = 0;
+        bool fastPath = true;
         for (;expstr != inend && (*expstr == '.' || isDigit(*expstr));
              expstr++)
             if (*expstr == '.')
@@ -1028,6 +1110,23 @@ uint64_t CLRX::cstrtofXCStyle(const char* str, const char* inend,
                 if (comma) break;
                 comma = true;
             }
+            else if (fastDigits < 19)
+            {
+                if (fastValue != 0 || *expstr != '0')
+                {
+                    fastValue = fastValue*10 + *expstr-'0';
+                    fastDigits++;
+                }
+                if (comma)
+                    fastExp--;
+            }
+            else
+            {
+                // only zeroes can be after 19 significant digits
+                fastPath = fastPath && *expstr == '0';
+                if (!comma)
+                    fastExp++;
+            }
         
         if (p == expstr || (p+1 == expstr && *p == '.'))
         {
@@ -1048,6 +1147,10 @@ uint64_t CLRX::cstrtofXCStyle(const char* str, const char* inend,
         else
             outend = expstr;
         
+        if (fastPath && fastValue != 0 && cstrtofXDecFastPath(fastValue,
+                    fastExp+decimalExp, expBits, mantisaBits, out))
+            return out;
+        
         // determine real exponent
         cxint decExpOfValue = 0;
         const char* vs = nullptr;
@@ -35,6 +35,10 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <string>
@@ -804,3 +808,43 @@ std::string CLRX::findLLVMConfig()
     }
     return "";
 }
+
+void CLRX::runParallelTasks(size_t tasksNum, cxuint threadsNum,
+            const std::function<void(size_t)>& func)
+{
+    std::atomic<size_t> nextTask(0);
+    std::exception_ptr taskException;
+    std::mutex exceptionMutex;
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = nextTask.fetch_add(1)) < tasksNum)
+            try
+            { func(i); }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+                if (!taskException)
+                    taskException = std::current_exception();
+                nextTask = tasksNum; // stop all workers
+                break;
+            }
+    };
+    
+    size_t workersNum = (threadsNum != 0) ? threadsNum :
+                std::max(std::thread::hardware_concurrency(), 1U);
+    workersNum = std::min(workersNum, tasksNum);
+    if (workersNum <= 1)
+        worker();
+    else
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < workersNum; i++)
+            workers.push_back(std::thread(worker));
+        worker();
+        for (std::thread& thread: workers)
+            thread.join();
+    }
+    if (taskException)
+        std::rethrow_exception(taskException);
+}